@@ -22,6 +22,9 @@
 // - No race conditions can exist that could cause reading of an incomplete message.
 // - Support for notifying the app when data has been dropped (not enough buffer space) and
 //   report the number of dropped messages.
+// - Support handling streams of messages without an event per message: for "batched" inboxes, the
+//   app keeps handling the messages that complete while it is handling others.
+// - Support letting the app use a message after handling it, without copying it (pinning).
 //
 // Non-goals:
 // - Sharing the same buffer between multiple kernel services (1:1 service to buffer relation is OK)
@@ -36,6 +39,7 @@ typedef enum {
 #ifdef UNITTEST
   AppInboxServiceTagUnitTest,
   AppInboxServiceTagUnitTestAlt,
+  AppInboxServiceTagUnitTestBatched,
 #endif
   NumAppInboxServiceTag,
 } AppInboxServiceTag;
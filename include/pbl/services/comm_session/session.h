@@ -47,6 +47,7 @@ typedef enum {
   CommSessionWorkoutAppSupport = 1 << 13,
   CommSessionSmoothFwInstallProgressSupport = 1 << 14,
   CommSessionSettingsSyncSupport = 1 << 23,
+  CommSessionDataLoggingWindowSupport = 1 << 24,
   CommSessionOutOfRange
 } CommSessionCapability;
 
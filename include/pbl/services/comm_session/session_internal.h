@@ -42,6 +42,16 @@ typedef struct CommSession {
   //! The send queue of this session. See session_send_queue.c
   SessionSendQueueJob *send_queue_head;
 
+  //! Total length in bytes of the jobs in the send queue, updated as they're added and consumed.
+  size_t send_queue_length;
+
+  //! The job the last read from the send queue started in, and the offset of that job into the
+  //! send queue. Transports read at increasing offsets, so reads start here instead of at the head.
+  struct {
+    SessionSendQueueJob *job;
+    uint32_t offset;
+  } send_queue_cursor;
+
   ReceiveRouter recv_router;
 
   //! Absolute number of ticks since session opened.
@@ -33,6 +33,15 @@ typedef struct {
   size_t (*get_read_pointer)(const SessionSendQueueJob *send_job,
                              const uint8_t **data_out);
 
+  //! Gets a read pointer at an offset into the remaining data, like get_read_pointer() does
+  //! for an offset of zero.
+  //! @param start_offset The offset into the send buffer
+  //! @param data_out Pointer to the pointer to assign the read pointer to.
+  //! @return The number of bytes that can be read starting at the read pointer.
+  //! @note The caller will ensure start_offset is smaller than get_length().
+  size_t (*get_read_pointer_at_offset)(const SessionSendQueueJob *send_job, uint32_t start_offset,
+                                       const uint8_t **data_out);
+
   //! Indicates that `length` bytes have been consumed and sent out by the transport.
   void (*consume)(const SessionSendQueueJob *send_job, size_t length);
 
@@ -144,6 +144,27 @@ size_t comm_session_send_queue_get_read_pointer(const CommSession *session,
 //! @note bt_lock() is expected to be taken by the caller!
 void comm_session_send_queue_consume(CommSession *session, size_t length);
 
+//! A contiguous part of the data in the send queue
+typedef struct SessionSendQueueSegment {
+  const uint8_t *data;
+  size_t length;
+} SessionSendQueueSegment;
+
+//! Gets read pointers into the buffers of the jobs in the send queue, so the transport can gather
+//! the data it sends out from them instead of having it copied into a buffer first.
+//! @param start_offset The offset into the send buffer
+//! @param length The number of bytes to get read pointers for
+//! @param[out] segments_out The segments that make up the data, in order
+//! @param max_segments The maximum number of segments to return
+//! @return The number of segments returned. They cover fewer than `length` bytes when there
+//! is less data available or more than max_segments segments would be needed. In that case,
+//! call this function again with the offset moved past the segments returned.
+//! @note The read pointers are valid until comm_session_send_queue_consume() is called.
+//! @note bt_lock() is expected to be taken by the caller!
+size_t comm_session_send_queue_get_segments(CommSession *session, uint32_t start_offset,
+                                            size_t length, SessionSendQueueSegment *segments_out,
+                                            size_t max_segments);
+
 //! Schedule a KernelBG callback to the send_next function of the transport, if needed.
 //! In case a callback is already pending, this function is a no-op.
 //! If, by the time the callback executes, the send buffer is empty, no callback to send_next will
@@ -121,6 +121,10 @@ void compositor_freeze(void);
 //! compositor_freeze.
 void compositor_unfreeze(void);
 
+//! Makes the next app render copy the whole app framebuffer rather than only what the app changed.
+//! Call this after drawing into the compositor framebuffer from outside of the compositor.
+void compositor_invalidate_framebuffer(void);
+
 //! Copy app FB into the given region of the system framebuffer, scaling or centering the app
 //! framebuffer content in the destination as needed based on user preference.
 //! If the update_rect points off the edge of the screen, the region updated will be clipped as needed.
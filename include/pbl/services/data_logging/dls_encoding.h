@@ -0,0 +1,35 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#pragma once
+
+#include "applib/data_logging.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+//! How the data of a windowed data message is encoded. The phone decodes it back into the items
+//! as they were logged (little endian, like everything else in data logging).
+typedef enum {
+  //! The items as they were logged
+  DataLoggingEncodingRaw = 0x00,
+  //! Integer items: the difference of each item to the one before it (of the first one to 0),
+  //! zigzag encoded into a LEB128 varint
+  DataLoggingEncodingDeltaVarint = 0x01,
+  //! A single LZ4 block, see https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+  DataLoggingEncodingLZ4 = 0x02,
+} DataLoggingEncoding;
+
+//! @return The encoding that compresses items of the given type best
+DataLoggingEncoding dls_encoding_for_items(DataLoggingItemType item_type, uint16_t item_size);
+
+//! Encodes whole items.
+//! @param data The items to encode
+//! @param num_bytes Number of bytes of items, a multiple of item_size
+//! @param out Buffer for the encoded data
+//! @param out_size Size of the buffer
+//! @return The number of encoded bytes, or 0 if they don't fit into the buffer (or there isn't
+//! enough memory to encode them)
+size_t dls_encoding_encode(DataLoggingEncoding encoding, DataLoggingItemType item_type,
+                           uint16_t item_size, const uint8_t *data, size_t num_bytes,
+                           uint8_t *out, size_t out_size);
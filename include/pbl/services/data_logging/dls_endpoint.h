@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "dls_encoding.h"
 #include "dls_private.h"
 
 #include <stdint.h>
@@ -13,5 +14,22 @@ void dls_endpoint_close_session(uint8_t session_id);
 
 bool dls_endpoint_send_data(DataLoggingSession *logging_session, const uint8_t *data, unsigned int num_bytes);
 
+//! @return true if the phone takes windowed data messages, see DataLoggingSendWindowedDataMessage
+bool dls_endpoint_is_windowed(void);
+
+//! @return How many data messages of the session can be sent right now
+unsigned int dls_endpoint_get_num_messages_to_send(DataLoggingSession *logging_session);
+
+//! Sends a windowed data message, only if the phone supports them.
+//! @param data The encoded data
+//! @param num_bytes Number of bytes of encoded data
+//! @param num_decoded_bytes Number of bytes of storage the data was read from, which get consumed
+//! once the phone acks it
+//! @param crc32 legacy_defective_checksum_memory() of those bytes
+bool dls_endpoint_send_windowed_data(DataLoggingSession *logging_session,
+                                     DataLoggingEncoding encoding, const uint8_t *data,
+                                     unsigned int num_bytes, unsigned int num_decoded_bytes,
+                                     uint32_t crc32);
+
 bool dls_endpoint_open_session(DataLoggingSession *logging_session);
 
@@ -25,6 +25,11 @@
 
 // File name is formatted as: ("%s%d", DLS_FILE_NAME_PREFIX, session_id)
 #define DLS_FILE_NAME_PREFIX          "dls_storage_"
+// Files with the larger chunks of storage version 0x21 use this prefix instead of
+// DLS_FILE_NAME_PREFIX, so firmware that only knows version 0x20 files never opens them.
+// Such firmware doesn't remove them either: they keep their flash until a firmware that knows
+// them runs again, which sends their data and moves any whose session id was reused meanwhile.
+#define DLS_V1_FILE_NAME_PREFIX       "dls1_storage_"
 static const uint32_t DLS_FILE_NAME_MAX_LEN = 20;
 static const uint32_t DLS_FILE_INIT_SIZE_BYTES = KiBYTES(4);
 
@@ -67,6 +72,9 @@ typedef enum {
   DataLoggingEndpointCmdGetSendEnableReq = 0x09,
   DataLoggingEndpointCmdGetSendEnableRsp = 0x0A,
   DataLoggingEndpointCmdSetSendEnable = 0x0B,
+  //! Only sent to phones with CommSessionDataLoggingWindowSupport, see
+  //! DataLoggingSendWindowedDataMessage
+  DataLoggingEndpointCmdWindowedData = 0x0C,
 } DataLoggingEndpointCmd;
 
 //! Every command starts off with a 8-bit command byte. Commands from the phone will have their
@@ -88,6 +96,9 @@ typedef struct DataLoggingSessionStorage {
 
   //! Number of unread bytes in storage
   uint32_t num_bytes;
+
+  //! The DLSFileHeaderVersion of the file, which determines how its chunks are laid out
+  uint8_t version;
 } DataLoggingSessionStorage;
 
 
@@ -99,6 +110,10 @@ typedef struct DataLoggingSessionStorage {
 //                                  ^                         |
 //                                  |       Rx Ack            |
 //                                  +-------------------------+
+//
+// If the phone supports windowed data (CommSessionDataLoggingWindowSupport), we keep sending
+// while in the Sending state until DLS_ENDPOINT_MAX_MESSAGES_IN_FLIGHT messages are waiting for
+// an ack, and only go back to Idle once all of them have been acked.
 
 typedef enum {
   //! The session is opening and waiting for the phone to acknowledge our open command.
@@ -109,6 +124,9 @@ typedef enum {
   DataLoggingSessionCommStateSending,
 } DataLoggingSessionCommState;
 
+//! The most windowed data messages of a session that can be waiting for an ack
+#define DLS_ENDPOINT_MAX_MESSAGES_IN_FLIGHT (4)
+
 typedef struct {
   //! A session ID that is chosen by the watch and is unique to all the session IDs that the
   //! watch knows about.
@@ -122,6 +140,20 @@ typedef struct {
   //! How many bytes we've sent to the phone that haven't been acked yet.
   int num_bytes_pending;
 
+  //! Sequence number of the next windowed data message, starts over whenever the session opens
+  uint8_t next_sequence;
+
+  //! How many windowed data messages we've sent to the phone that haven't been acked yet
+  uint8_t num_messages_pending;
+
+  //! Number of storage bytes in each of those, indexed by sequence number modulo
+  //! DLS_ENDPOINT_MAX_MESSAGES_IN_FLIGHT
+  uint16_t message_bytes_pending[DLS_ENDPOINT_MAX_MESSAGES_IN_FLIGHT];
+
+  //! How many bytes to read from storage for the next encoded message, learnt from how well the
+  //! previous ones compressed. 0 until the first one has been sent.
+  uint16_t encoded_read_size;
+
   //! The time in RtcTicks at which the current state will timeout while waiting for an ack. Set
   //! to zero if we're not waiting for one.
   RtcTicks ack_timeout;
@@ -191,6 +223,23 @@ typedef struct PACKED {
   uint8_t bytes[];
 } DataLoggingSendDataMessage;
 
+//! Data message that doesn't have to be acked before the next one is sent. The phone acks it with
+//! its sequence number appended to the usual ack, which also acks all the messages of the session
+//! sent before it. If the phone nacks one, it drops the ones after it until the session has been
+//! opened again, after which we resend them.
+typedef struct PACKED {
+  uint8_t command;
+  uint8_t session_id;
+  uint8_t sequence;
+  //! DataLoggingEncoding of bytes
+  uint8_t encoding;
+  //! Number of bytes once decoded, always whole items
+  uint16_t num_bytes;
+  //! legacy_defective_checksum_memory() of the decoded bytes
+  uint32_t crc32;
+  uint8_t bytes[];
+} DataLoggingSendWindowedDataMessage;
+
 
 //! Size of the buffer we create for buffered sessions. This is the largest item size allowed
 //! for buffered sessions.
@@ -205,6 +254,9 @@ static const uint32_t DLS_SESSION_MAX_BUFFERED_ITEM_SIZE = 300;
 static const uint32_t DLS_ENDPOINT_MAX_PAYLOAD = (COMM_MAX_OUTBOUND_PAYLOAD_SIZE
                                                   - sizeof(DataLoggingSendDataMessage));
 
+//! The most bytes we read from storage to encode into a single windowed data message
+#define DLS_ENDPOINT_MAX_ENCODED_READ_SIZE  (4 * DLS_ENDPOINT_MAX_PAYLOAD)
+
 
 //! Unit tests only
 int dls_test_read(DataLoggingSession *logging_session, uint8_t *buffer, int num_bytes);
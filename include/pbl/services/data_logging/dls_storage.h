@@ -28,6 +28,16 @@ void dls_storage_delete_logging_storage(DataLoggingSession *session);
 int32_t dls_storage_read(DataLoggingSession *logging_session, uint8_t *buffer, int32_t num_bytes,
                          uint32_t *new_read_offset);
 
+//! Like dls_storage_read(), but skips over the first skip_bytes of unread data first. Used to read
+//! the data that follows what has already been sent to the phone but hasn't been consumed yet.
+//! @param[in] logging_session session to read from
+//! @param[in] skip_bytes number of unread bytes to skip, must end on a chunk boundary
+//! @param[in] buffer buffer to read bytes into
+//! @param[in] num_bytes number of bytes to read
+//! @return number of bytes read, or -1 if error
+int32_t dls_storage_read_after(DataLoggingSession *logging_session, uint32_t skip_bytes,
+                               uint8_t *buffer, int32_t num_bytes);
+
 //! Consume data from the session without reading it into a buffer.
 //! @param[in] logging_session session to read from
 //! @param[in] num_bytes number of bytes to consume.
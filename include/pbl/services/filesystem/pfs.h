@@ -87,7 +87,9 @@ typedef struct {
 //!   OP_FLAG_USE_PAGE_CACHE - Turns on caching for the translation from
 //!    virtual filesystem pages to their physical address. For large files with
 //!    a lot of random access this is advantageous because we need to read
-//!    flash bytes to get to the correct page. Ideally this should only be
+//!    flash bytes to get to the correct page. The full translation is built
+//!    the first time the file seeks across a page so no page headers need to
+//!    be read afterwards. Ideally this should only be
 //!    used for read operations so that heap corruption does not lead to us
 //!    corrupting a file
 //!
@@ -176,6 +178,14 @@ extern int pfs_sector_optimal_size(int min_size, int namelen);
 //! Returns the number of bytes available on the filesystem
 extern uint32_t get_available_pfs_space(void);
 
+//! Garbage collects at most one erase sector if the amount of pre-erased space
+//! on the filesystem has dropped below the free sector watermark. Victims are
+//! the sectors with the most reclaimable pages, preferring the least worn ones.
+//! This is normally run from the system task so that file creation does not
+//! have to garbage collect inline.
+//! @return true if more garbage collection is needed to reach the watermark
+extern bool pfs_gc_incremental_step(void);
+
 //! Watch a file. The callback is called whenever the given file (by name) is closed with
 //! modifications or deleted
 //! @param filename - name of the file to watch
@@ -27,6 +27,12 @@
 //! you will be accessing a SettingsFile from multiple threads, make sure you
 //! use locks!
 
+//! Entry of the in-RAM record index, see CONFIG_SERVICE_SETTINGS_INDEX.
+typedef struct {
+  uint32_t record_pos:24;
+  uint32_t key_hash:8;
+} SettingsFileIndexEntry;
+
 // NOTE: These fields are internal, modify them at your own risk!
 typedef struct SettingsFile {
   SettingsRawIter iter;
@@ -69,6 +75,24 @@ typedef struct SettingsFile {
   //! settings_file_each()/settings_file_rewrite()),  without messing up the
   //! state of the iteration. Set to 0 if not in use.
   int cur_record_pos;
+
+  //! Position of the EOF marker, i.e. where the next record will be written.
+  int eof_record_pos;
+
+  //! Every record a lookup can return (i.e. which hasn't been overwritten),
+  //! sorted by key hash and then position. NULL if the index is disabled or
+  //! could not be allocated, in which case lookups scan the file instead.
+  SettingsFileIndexEntry *index;
+  int index_len;
+  int index_capacity;
+
+  //! Operations buffered since settings_file_begin_transaction(), in order.
+  struct SettingsFileTxnOp *txn_ops;
+  struct SettingsFileTxnOp *txn_ops_tail;
+  //! One bit per key hash of the buffered operations, so adding a key which isn't in the batch
+  //! yet doesn't have to walk it.
+  uint32_t txn_key_hashes[256 / 32];
+  bool in_transaction;
 } SettingsFile;
 
 
@@ -129,6 +153,26 @@ typedef void (*SettingsFileChangeCallback)(SettingsFile *file, const void *key,
 //! @param callback the callback to register (NULL to unregister)
 void settings_file_set_change_callback(SettingsFileChangeCallback callback);
 
+//! Start buffering settings_file_set(), settings_file_set_with_timestamp() and
+//! settings_file_delete() calls in RAM instead of writing each one out to
+//! flash. Lookups keep returning the previously committed values until
+//! settings_file_commit_transaction() is called.
+//! Only one transaction can be open on a file at a time.
+status_t settings_file_begin_transaction(SettingsFile *file);
+
+//! Write out every operation buffered since settings_file_begin_transaction().
+//! The file is compacted (or grown) at most once to make room, the new records
+//! are appended in large sequential writes and a single commit marker makes
+//! them valid. Should we reboot before the marker is written, none of the
+//! operations will have happened; afterwards all of them have.
+//! The transaction is closed even if committing it fails.
+//! @return E_OUT_OF_STORAGE if the batch doesn't fit into the file, in which
+//! case nothing was written
+status_t settings_file_commit_transaction(SettingsFile *file);
+
+//! Drop every operation buffered since settings_file_begin_transaction()
+void settings_file_abort_transaction(SettingsFile *file);
+
 //! set a byte in a setting. This can only be used a byte at a time to guarantee
 //! atomicity. Do not use to modify several bytes in a row!
 //! Note that only the reset bits will be applied (it writes flash directly)
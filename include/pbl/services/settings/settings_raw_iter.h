@@ -31,6 +31,12 @@ _Static_assert(
 #define SETTINGS_FLAG_OVERWRITE_COMPLETE  (1 << 2)
 // Indicate that a record is in sync with the phone
 #define SETTINGS_FLAG_SYNCED              (1 << 3)
+// Record was written as part of a batch by settings_file_commit_transaction()
+#define SETTINGS_FLAG_TXN                 (1 << 4)
+// Set up front on every record of a batch except the first one, which only
+// gets it once the whole batch has been written out. This is the commit
+// marker for the batch, none of its records are valid until it is set.
+#define SETTINGS_FLAG_TXN_COMMITTED       (1 << 5)
 
 #define SETTINGS_KEY_MAX_LEN 127
 #define SETTINGS_VAL_MAX_LEN (SETTINGS_EOF_MARKER - 1) // we reserve the largest value for EOF
@@ -126,6 +132,11 @@ void settings_raw_iter_write_val(SettingsRawIter *iter, const uint8_t *val);
 //! Layout matches settings_raw_iter_read_key_val.
 void settings_raw_iter_write_key_val(SettingsRawIter *iter, const uint8_t *key_val);
 
+//! Append several already serialized records in one PFS call. The current
+//! record must be the EOF marker, and the iterator is left on the new EOF
+//! marker after the records.
+void settings_raw_iter_write_records(SettingsRawIter *iter, const uint8_t *records, int len);
+
 //! Write a byte in place for the current record
 void settings_raw_iter_write_byte(SettingsRawIter *iter, int offset, uint8_t byte);
 
@@ -2,6 +2,7 @@
 /* SPDX-License-Identifier: Apache-2.0 */
 
 #pragma once
+#include "kernel/pebble_tasks.h"
 #include "pbl/services/timeline/item.h"
 #include "system/status_codes.h"
 #include "pbl/util/iterator.h"
@@ -28,6 +29,10 @@ typedef struct {
 //! initialize the timeline (builds the list of TimelineNodes)
 status_t timeline_init(TimelineNode **timeline);
 
+//! Forgets about the TimelineNodes of a process that is being cleaned up, they went away with its
+//! heap.
+void timeline_process_cleanup(PebbleTask task);
+
 //! Add a timeline pin we've created to the timeline.
 //! Call \ref timeline_destroy_item after this in order to free up the memory used by the item.
 //! @return true on success, false otherwise
@@ -18,6 +18,7 @@
 //!   XorOut: FFFFFFFF
 //!   Check: CBF43926
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -36,6 +37,22 @@
 //! \endcode
 uint32_t crc32(uint32_t crc, const void * restrict data, size_t length);
 
+//! A CRC peripheral that crc32() hands large buffers to.
+typedef struct Crc32Backend {
+  //! Buffers shorter than this are checksummed in software, where the setup
+  //! cost of the peripheral doesn't pay off
+  size_t min_length;
+  //! Updates *crc with length bytes of data, with the same semantics as
+  //! crc32(). May be called from any task, concurrently.
+  //! @return false if the peripheral can't take the buffer right now (busy,
+  //!   unsupported alignment, ...), crc32() falls back to software then
+  bool (*update)(uint32_t *crc, const void *data, size_t length);
+} Crc32Backend;
+
+//! Makes crc32() use a CRC peripheral. Meant to be called once by the SoC
+//! driver at boot, pass NULL to go back to the software engine.
+void crc32_set_backend(const Crc32Backend *backend);
+
 //! The initial CRC register value for a standard CRC-32 checksum.
 //!
 //! It is the same value as is returned by the `crc32` function when data is
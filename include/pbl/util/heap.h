@@ -22,6 +22,11 @@ typedef struct HeapLockImpl {
 typedef void (*DoubleFreeHandler)(void*);
 typedef void (*CorruptionHandler)(void*);
 
+typedef struct HeapProfiler HeapProfiler;
+
+//! Number of segregated free lists, see prv_size_class() in heap.c
+#define HEAP_NUM_FREE_LISTS 56
+
 typedef struct Heap {
   // These HeapInfo_t structure pointers are initialized to the start and the end of the heap area.
   // The begin will point to the first block that's in the heap area, where the end is actually a
@@ -42,6 +47,16 @@ typedef struct Heap {
 
   void *corrupt_block;
   CorruptionHandler corruption_handler;
+
+#ifdef CONFIG_MALLOC_PROFILING
+  //! Records allocations by call site while set, see heap_profiler.h
+  HeapProfiler *profiler;
+#endif
+
+  //! Bit n is set iff free_lists[n] isn't empty
+  uint64_t free_list_bitmap;
+  //! Heads of the free lists of each size class, as offsets from begin in units of alignment
+  uint16_t free_lists[HEAP_NUM_FREE_LISTS];
 } Heap;
 
 //! Initialize the heap inside the specified boundaries, zero-ing out the free
@@ -65,10 +80,18 @@ void heap_set_double_free_handler(Heap *heap, DoubleFreeHandler double_free_hand
 //! If this isn't configured on a heap, the default behaviour is to trigger a PBL_CROAK.
 void heap_set_corruption_handler(Heap *heap, CorruptionHandler corruption_handler);
 
-//! Allocate a fragment of memory on the given heap. Tries to avoid
-//! fragmentation by obtaining memory requests larger than LARGE_SIZE from the
-//! endo of the buffer, while small fragments are taken from the start of the
-//! buffer.
+#ifdef CONFIG_MALLOC_PROFILING
+//! Start recording the allocations of this heap with the given profiler, NULL to stop. Blocks
+//! allocated while no profiler was set are ignored when they get freed.
+void heap_set_profiler(Heap *heap, HeapProfiler *profiler);
+#endif
+
+//! Allocate a fragment of memory on the given heap. The free block is taken
+//! from the request's own size class or the smallest larger one, looking at a
+//! bounded number of blocks, so this doesn't depend on how fragmented the heap
+//! is. Tries to avoid fragmentation by obtaining memory requests larger than
+//! LARGE_SIZE from the end of the heap and of free blocks, while small fragments
+//! are taken from their start.
 //! @note heap_init() must be called prior to using heap_malloc().
 //! @param nbytes Number of bytes to be allocated. Must be > 0.
 //! @param client_pc The PC register of the client who caused this malloc. Only used when
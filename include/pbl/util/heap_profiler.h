@@ -0,0 +1,103 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//! @file heap_profiler.h
+//!
+//! Aggregates the allocations of a heap by the PC that made them. For every call site the profiler
+//! keeps allocation and free counts, the bytes allocated in total, the bytes currently live and the
+//! peak of those, and a histogram of how long the allocations lived. Sites are kept in a fixed-size
+//! table supplied by the client, allocations from sites that don't fit anymore are only counted.
+//!
+//! The profiler is hooked into a heap with heap_set_profiler() when CONFIG_MALLOC_PROFILING is
+//! enabled. It doesn't lock, all calls happen under the lock of the heap it's attached to.
+
+//! Lifetime histogram buckets are powers of HEAP_PROFILER_LIFETIME_BUCKET_BASE milliseconds:
+//! < 10ms, < 100ms, < 1s, < 10s, < 100s and everything longer
+#define HEAP_PROFILER_NUM_LIFETIME_BUCKETS (6)
+#define HEAP_PROFILER_LIFETIME_BUCKET_BASE (10)
+
+//! Identifies the binary format written by heap_profiler_serialize()
+#define HEAP_PROFILER_MAGIC (0x46525048) // "HPRF"
+#define HEAP_PROFILER_VERSION (1)
+
+typedef struct HeapProfilerSite {
+  //! The PC that made the allocations, 0 for unused sites
+  uintptr_t pc;
+  uint32_t num_allocs;
+  uint32_t num_frees;
+  uint32_t total_bytes;
+  uint32_t live_bytes;
+  uint32_t peak_live_bytes;
+  //! Number of freed allocations by lifetime, saturates at UINT16_MAX
+  uint16_t lifetime_histogram[HEAP_PROFILER_NUM_LIFETIME_BUCKETS];
+} HeapProfilerSite;
+
+typedef uint32_t (*HeapProfilerTimeFunction)(void);
+
+typedef struct HeapProfiler {
+  HeapProfilerSite *sites;
+  uint16_t num_sites;
+  uint16_t num_used_sites;
+  //! Allocations that weren't recorded because the site table was full or their PC was unknown
+  uint32_t num_dropped;
+  //! Time of the last reset, allocations made before it are ignored when they get freed
+  uint32_t start_time_ms;
+  HeapProfilerTimeFunction get_time_ms;
+} HeapProfiler;
+
+//! Header of the binary format, followed by num_used_sites packed HeapProfilerSiteRecords. All
+//! fields are little endian.
+typedef struct __attribute__((packed)) HeapProfilerHeader {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t num_lifetime_buckets;
+  uint16_t num_sites;
+  uint32_t num_dropped;
+  uint32_t duration_ms;
+} HeapProfilerHeader;
+
+typedef struct __attribute__((packed)) HeapProfilerSiteRecord {
+  uint32_t pc;
+  uint32_t num_allocs;
+  uint32_t num_frees;
+  uint32_t total_bytes;
+  uint32_t live_bytes;
+  uint32_t peak_live_bytes;
+  uint16_t lifetime_histogram[HEAP_PROFILER_NUM_LIFETIME_BUCKETS];
+} HeapProfilerSiteRecord;
+
+//! @param sites table of num_sites sites to record into
+//! @param get_time_ms returns a millisecond timestamp used for the lifetime histograms
+void heap_profiler_init(HeapProfiler *profiler, HeapProfilerSite *sites, uint16_t num_sites,
+                        HeapProfilerTimeFunction get_time_ms);
+
+//! Forgets everything that has been recorded so far
+void heap_profiler_reset(HeapProfiler *profiler);
+
+//! Records an allocation of bytes made by pc
+//! @return the timestamp to pass to heap_profiler_record_free() for this allocation, never 0 which
+//!   can be passed for allocations that weren't recorded
+uint32_t heap_profiler_record_alloc(HeapProfiler *profiler, uintptr_t pc, size_t bytes);
+
+//! Records that an allocation made by pc at alloc_time_ms was freed
+void heap_profiler_record_free(HeapProfiler *profiler, uintptr_t pc, size_t bytes,
+                               uint32_t alloc_time_ms);
+
+//! @return the site of pc, NULL if there's none
+const HeapProfilerSite *heap_profiler_find_site(const HeapProfiler *profiler, uintptr_t pc);
+
+//! @return the lifetime histogram bucket allocations living lifetime_ms fall into
+unsigned int heap_profiler_get_lifetime_bucket(uint32_t lifetime_ms);
+
+//! @return the number of bytes heap_profiler_serialize() needs
+size_t heap_profiler_get_serialized_size(const HeapProfiler *profiler);
+
+//! Writes the recorded sites in the binary format described by HeapProfilerHeader
+//! @return the number of bytes written, 0 if buffer_size is too small
+size_t heap_profiler_serialize(const HeapProfiler *profiler, uint8_t *buffer, size_t buffer_size);
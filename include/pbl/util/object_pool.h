@@ -0,0 +1,97 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#pragma once
+
+#include "pbl/util/list.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//! @file object_pool.h
+//!
+//! Fixed-size object pools for small structures that get allocated and freed a lot.
+//!
+//! A pool hands out objects from slabs of objects_per_slab objects each. Slabs are allocated with
+//! the pool's slab_alloc function when the pool runs out of free objects. Once all objects of a slab
+//! have been freed again, the pool keeps it as its spare slab if it doesn't have one yet and gives it
+//! back otherwise, so an object that keeps getting created and destroyed right at a slab boundary
+//! doesn't allocate and free a slab every time. Compared to allocating every object on its
+//! own this saves a heap header per object, makes allocating and freeing constant time and keeps
+//! the churn of short-lived objects from fragmenting the heap.
+//!
+//! The pools and the registry of pools are protected by the lock set with
+//! object_pool_set_lock_impl(). Until one is set, which is what the unit tests do, there is no
+//! locking at all.
+
+typedef struct ObjectPoolSlab ObjectPoolSlab;
+
+//! @param client_pc the caller of object_pool_alloc() the slab is allocated for, for the malloc
+//! instrumentation
+typedef void *(*ObjectPoolSlabAlloc)(size_t bytes, uintptr_t client_pc);
+typedef void (*ObjectPoolSlabFree)(void *ptr);
+
+//! Passed as stats_key for pools that shouldn't be reported to analytics
+#define OBJECT_POOL_NO_STATS_KEY (-1)
+
+typedef struct ObjectPoolLockImpl {
+  void (*lock_function)(void *context);
+  void (*unlock_function)(void *context);
+  void *lock_context;
+} ObjectPoolLockImpl;
+
+typedef struct ObjectPool {
+  ListNode list_node;
+  const char *name;
+  ObjectPoolSlabAlloc slab_alloc;
+  ObjectPoolSlabFree slab_free;
+  ObjectPoolSlab *slabs;
+  //! Empty slab kept around for the next time the pool runs out of free objects, counted in
+  //! num_slabs
+  ObjectPoolSlab *spare_slab;
+  uint16_t object_size;
+  uint16_t objects_per_slab;
+  uint16_t num_slabs;
+  uint16_t num_allocated;
+  //! Peak number of allocated objects
+  uint16_t high_water_mark;
+  //! Key the firmware reports the high water mark under, OBJECT_POOL_NO_STATS_KEY for none
+  int stats_key;
+} ObjectPool;
+
+typedef bool (*ObjectPoolEachCb)(ObjectPool *pool, void *context);
+
+//! Sets the lock that object_pool_each() and all pool operations run under. Has to be set before
+//! pools get used from more than one task.
+void object_pool_set_lock_impl(ObjectPoolLockImpl lock_impl);
+
+//! Initializes an object pool and registers it so it shows up in object_pool_each(). Calling this
+//! again on a pool forgets about all of its slabs without freeing them, which is what has to be
+//! done for pools on a heap that has been reset.
+//! @param name name of the pool, must stay valid for as long as the pool exists
+//! @param object_size size of the objects in the pool
+//! @param objects_per_slab number of objects to allocate at a time
+//! @param slab_alloc allocates slabs, e.g. kernel_malloc_check_with_pc
+//! @param slab_free frees slabs allocated with slab_alloc, e.g. kernel_free
+//! @param stats_key key to report the high water mark under, OBJECT_POOL_NO_STATS_KEY for none
+void object_pool_init(ObjectPool *pool, const char *name, size_t object_size,
+                      uint16_t objects_per_slab, ObjectPoolSlabAlloc slab_alloc,
+                      ObjectPoolSlabFree slab_free, int stats_key);
+
+//! Deregisters a pool so it no longer shows up in object_pool_each() and forgets about all of its
+//! slabs without freeing them. Used for pools on a heap that is about to go away, none of their
+//! objects may be used any more.
+void object_pool_deinit(ObjectPool *pool);
+
+//! @return an uninitialized object, NULL if a new slab was needed and slab_alloc failed
+void *object_pool_alloc(ObjectPool *pool);
+
+//! Returns an object to the pool it was allocated from, does nothing for NULL
+void object_pool_free(ObjectPool *pool, void *object);
+
+//! @return the number of bytes a new slab of the pool takes
+size_t object_pool_get_slab_size(const ObjectPool *pool);
+
+//! Calls cb for every initialized pool until it returns false, with the pool lock held
+void object_pool_each(ObjectPoolEachCb cb, void *context);
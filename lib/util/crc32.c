@@ -3,17 +3,32 @@
 
 #include "pbl/util/crc32.h"
 
+#include "pbl/util/math.h"
+
 #include <stdint.h>
 #include <string.h>
 
-// Nybble-wide table driven CRC-32 algorithm
+// The software engine is picked at build time, trading flash for speed:
 //
-// A compromise between speed and size, this algorithm uses a lookup table to
-// calculate the CRC four bits at a time with a size cost of only 64 bytes. By
-// contrast, a byte-wide algorithm requires a lookup table sixteen times larger!
+// - Nybble-wide (the default): a lookup table calculates the CRC four bits at
+//   a time with a size cost of only 64 bytes. By contrast, a byte-wide
+//   algorithm requires a lookup table sixteen times larger!
+// - Slice-by-4 (CONFIG_CRC32_SLICE_BY_4): four byte-wide tables (4 KiB) fold a
+//   word into the CRC per step using aligned word loads.
+// - Slice-by-8 (CONFIG_CRC32_SLICE_BY_8): eight tables (8 KiB), two words per
+//   step.
 //
-// The lookup table is generated by the crc32_lut.py
+// The lookup tables are generated by the crc32_lut.py
+
+#if defined(CONFIG_CRC32_SLICE_BY_8) || UNITTEST
+#define CRC32_NUM_SLICES (8)
+#elif defined(CONFIG_CRC32_SLICE_BY_4)
+#define CRC32_NUM_SLICES (4)
+#else
+#define CRC32_NUM_SLICES (0)
+#endif
 
+#if (CRC32_NUM_SLICES == 0) || UNITTEST
 static const uint32_t s_lookup_table[] = {
   0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
   0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
@@ -21,18 +36,107 @@ static const uint32_t s_lookup_table[] = {
   0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
 };
 
+static uint32_t prv_crc32_nybble(uint32_t crc, const uint8_t * restrict bytes, size_t length) {
+  while (length--) {
+    crc = (crc >> 4) ^ s_lookup_table[(crc ^ *bytes) & 0xf];
+    crc = (crc >> 4) ^ s_lookup_table[(crc ^ (*bytes >> 4)) & 0xf];
+    bytes++;
+  }
+  return crc;
+}
+#endif
+
+#if CRC32_NUM_SLICES > 0
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The slicing CRC-32 engines assume little-endian word loads"
+#endif
+
+#include "crc32_slice_tables.h"
+
+static uint32_t prv_crc32_bytes(uint32_t crc, const uint8_t * restrict bytes, size_t length) {
+  while (length--) {
+    crc = (crc >> 8) ^ s_slice_tables[0][(crc ^ *bytes++) & 0xff];
+  }
+  return crc;
+}
+
+static uint32_t prv_crc32_fold_word(uint32_t word) {
+  return s_slice_tables[3][word & 0xff] ^ s_slice_tables[2][(word >> 8) & 0xff] ^
+         s_slice_tables[1][(word >> 16) & 0xff] ^ s_slice_tables[0][word >> 24];
+}
+
+//! Gets inlined with a constant num_slices for every engine that is compiled in
+static inline __attribute__((always_inline))
+uint32_t prv_crc32_slice(uint32_t crc, const uint8_t * restrict bytes, size_t length,
+                         unsigned int num_slices) {
+  // Head bytes up to the first word boundary
+  const size_t head_length = MIN((size_t)(-(uintptr_t)bytes & 3), length);
+  crc = prv_crc32_bytes(crc, bytes, head_length);
+  bytes += head_length;
+  length -= head_length;
+
+  const uint32_t * restrict words = (const uint32_t *)(const void *)bytes;
+#if CRC32_NUM_SLICES > 4
+  if (num_slices == 8) {
+    for (; length >= 8; length -= 8) {
+      const uint32_t one = *words++ ^ crc;
+      const uint32_t two = *words++;
+      crc = s_slice_tables[7][one & 0xff] ^ s_slice_tables[6][(one >> 8) & 0xff] ^
+            s_slice_tables[5][(one >> 16) & 0xff] ^ s_slice_tables[4][one >> 24] ^
+            prv_crc32_fold_word(two);
+    }
+  }
+#else
+  (void)num_slices;
+#endif
+  for (; length >= 4; length -= 4) {
+    crc = prv_crc32_fold_word(*words++ ^ crc);
+  }
+
+  return prv_crc32_bytes(crc, (const uint8_t *)words, length);
+}
+#endif
+
+static uint32_t prv_crc32_software(uint32_t crc, const uint8_t * restrict bytes, size_t length) {
+#if CRC32_NUM_SLICES > 0
+  return prv_crc32_slice(crc, bytes, length, CRC32_NUM_SLICES);
+#else
+  return prv_crc32_nybble(crc, bytes, length);
+#endif
+}
+
+static const Crc32Backend *s_backend;
+
+void crc32_set_backend(const Crc32Backend *backend) {
+  s_backend = backend;
+}
+
 uint32_t crc32(uint32_t crc, const void * restrict data, size_t length) {
   if (data == 0) {
     return 0;
   }
-  const uint8_t * restrict bytes = data;
 
-  crc ^= 0xffffffff;
-  while (length--) {
-    crc = (crc >> 4) ^ s_lookup_table[(crc ^ *bytes) & 0xf];
-    crc = (crc >> 4) ^ s_lookup_table[(crc ^ (*bytes >> 4)) & 0xf];
-    bytes++;
+  const Crc32Backend *backend = s_backend;
+  if (backend && (length >= backend->min_length) && backend->update(&crc, data, length)) {
+    return crc;
   }
+
+  crc ^= 0xffffffff;
+  crc = prv_crc32_software(crc, data, length);
   crc ^= 0xffffffff;
   return crc;
 }
+
+#if UNITTEST
+uint32_t crc32_prv_nybble(uint32_t crc, const void *data, size_t length) {
+  return ~prv_crc32_nybble(~crc, data, length);
+}
+
+uint32_t crc32_prv_slice_by_4(uint32_t crc, const void *data, size_t length) {
+  return ~prv_crc32_slice(~crc, data, length, 4);
+}
+
+uint32_t crc32_prv_slice_by_8(uint32_t crc, const void *data, size_t length) {
+  return ~prv_crc32_slice(~crc, data, length, 8);
+}
+#endif
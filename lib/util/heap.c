@@ -4,10 +4,12 @@
 #include "pbl/util/heap.h"
 
 #include "pbl/util/assert.h"
+#include "pbl/util/heap_profiler.h"
 #include "pbl/util/math.h"
 #include "pbl/util/logging.h"
 
 #include <inttypes.h>
+#include <limits.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdio.h>
@@ -62,6 +64,10 @@ typedef struct _tagHeapInfo_t
   uintptr_t pc; //<! The address that called malloc.
 #endif
 
+#ifdef CONFIG_MALLOC_PROFILING
+  uint32_t alloc_time_ms; //<! When the block was allocated, for the heap profiler.
+#endif
+
   //! This is the actual buffer that's returned to the caller. We use this struct to make
   //! sure the buffer we return is appropriately aligned.
   AlignmentStruct_t Data;
@@ -76,6 +82,34 @@ typedef struct _tagHeapInfo_t
 
 _Static_assert((offsetof(HeapInfo_t, Data) % ALIGNMENT_SIZE) == 0, "Heap not properly aligned.");
 
+//! Free blocks are kept on doubly linked lists segregated by size. The links
+//! live in the last word of the free block, which keeps the start of freed
+//! memory intact, and as offsets from heap->begin in units of ALIGNMENT_SIZE
+//! so they fit into the smallest possible block even with 32-bit pointers.
+typedef struct {
+  uint16_t next;
+  uint16_t prev;
+} FreeListLinks;
+
+_Static_assert(sizeof(FreeListLinks) <= ALIGNMENT_SIZE * MINIMUM_MEMORY_SIZE,
+               "Free list links don't fit into the smallest block");
+
+//! Marks the end of a free list, offsets are always < SEGMENT_SIZE_MAX
+#define FREE_LIST_END           (0xFFFF)
+
+//! Blocks smaller than this many units each get their own size class, larger
+//! ones are split into FREE_LIST_SUBCLASSES classes per power of two
+#define FREE_LIST_EXACT_CLASSES (8)
+#define FREE_LIST_SUBCLASS_BITS (2)
+#define FREE_LIST_SUBCLASSES    (1 << FREE_LIST_SUBCLASS_BITS)
+//! Number of blocks of a free list find_segment() looks at before moving on
+#define FREE_LIST_MAX_SCAN      (4)
+
+_Static_assert(HEAP_NUM_FREE_LISTS == FREE_LIST_EXACT_CLASSES +
+                   ((15 - 3) * FREE_LIST_SUBCLASSES),
+               "HEAP_NUM_FREE_LISTS doesn't match the number of size classes");
+_Static_assert(HEAP_NUM_FREE_LISTS <= 64, "Free list bitmap too small");
+
 //! Heap is assumed corrupt if expr does not evaluate true
 #define HEAP_ASSERT_SANE(heap, expr, log_addr) \
             if (!(expr)) { prv_handle_corruption(heap, log_addr); }
@@ -111,6 +145,90 @@ static void prv_handle_corruption(Heap * const heap, void *ptr) {
 static HeapInfo_t *find_segment(Heap* const heap, unsigned long n_units);
 static HeapInfo_t *allocate_block(Heap* const heap, unsigned long n_units, HeapInfo_t* heap_info_ptr);
 
+#if UNITTEST
+static uint32_t s_num_blocks_searched;
+#endif
+
+//! @return the size class of blocks of the given size in units of ALIGNMENT_SIZE
+static int prv_size_class(unsigned long n_units) {
+  if (n_units < FREE_LIST_EXACT_CLASSES) {
+    return n_units;
+  }
+  const int msb = 31 - __builtin_clz(n_units);
+  const int subclass = (n_units >> (msb - FREE_LIST_SUBCLASS_BITS)) & (FREE_LIST_SUBCLASSES - 1);
+  return FREE_LIST_EXACT_CLASSES + ((msb - 3) * FREE_LIST_SUBCLASSES) + subclass;
+}
+
+//! @return true if every block of the size class n_units falls into is at least n_units large
+static bool prv_is_size_class_floor(unsigned long n_units) {
+  if (n_units < FREE_LIST_EXACT_CLASSES) {
+    return true;
+  }
+  const int msb = 31 - __builtin_clz(n_units);
+  return (n_units & ((1 << (msb - FREE_LIST_SUBCLASS_BITS)) - 1)) == 0;
+}
+
+static FreeListLinks *prv_free_list_links(HeapInfo_t *block) {
+  return (FreeListLinks *)(((Alignment_t *)block) + block->Size - 1);
+}
+
+static HeapInfo_t *prv_free_list_block(Heap * const heap, uint16_t offset) {
+  return (HeapInfo_t *)(((Alignment_t *)heap->begin) + offset);
+}
+
+static uint16_t prv_free_list_offset(Heap * const heap, HeapInfo_t *block) {
+  return ((Alignment_t *)block) - ((Alignment_t *)heap->begin);
+}
+
+//! @return true if offset points at a free block within the heap
+static bool prv_is_valid_free_list_entry(Heap * const heap, uint16_t offset) {
+  if (offset == FREE_LIST_END) {
+    return true;
+  }
+  HeapInfo_t *block = prv_free_list_block(heap, offset);
+  return (block < heap->end) && !block->is_allocated;
+}
+
+static void prv_free_list_insert(Heap * const heap, HeapInfo_t *block) {
+  const int size_class = prv_size_class(block->Size);
+  const uint16_t offset = prv_free_list_offset(heap, block);
+  const uint16_t head = heap->free_lists[size_class];
+
+  *prv_free_list_links(block) = (FreeListLinks) {
+    .next = head,
+    .prev = FREE_LIST_END,
+  };
+  if (head != FREE_LIST_END) {
+    prv_free_list_links(prv_free_list_block(heap, head))->prev = offset;
+  }
+  heap->free_lists[size_class] = offset;
+  heap->free_list_bitmap |= ((uint64_t)1 << size_class);
+}
+
+//! Note: must be called before the size of the block changes
+static void prv_free_list_remove(Heap * const heap, HeapInfo_t *block) {
+  const int size_class = prv_size_class(block->Size);
+  const FreeListLinks links = *prv_free_list_links(block);
+
+  if (!prv_is_valid_free_list_entry(heap, links.next) ||
+      !prv_is_valid_free_list_entry(heap, links.prev)) {
+    prv_handle_corruption(heap, block);
+    return;
+  }
+
+  if (links.prev == FREE_LIST_END) {
+    heap->free_lists[size_class] = links.next;
+    if (links.next == FREE_LIST_END) {
+      heap->free_list_bitmap &= ~((uint64_t)1 << size_class);
+    }
+  } else {
+    prv_free_list_links(prv_free_list_block(heap, links.prev))->next = links.next;
+  }
+  if (links.next != FREE_LIST_END) {
+    prv_free_list_links(prv_free_list_block(heap, links.next))->prev = links.prev;
+  }
+}
+
 //! Advance the block pointer to the next block.
 static HeapInfo_t* get_next_block(Heap * const heap, HeapInfo_t* block) {
   HEAP_ASSERT_SANE(heap, block->Size != 0, block);
@@ -150,7 +268,7 @@ static void prv_calc_totals(Heap* const heap, unsigned int *used, unsigned int *
 
       /* Check to see if the current fragment is larger that any  */
       /* we have seen and update the Max Value if it is larger.   */
-      if(heap_info_ptr->Size > *max_free) {
+      if(heap_info_ptr->Size * ALIGNMENT_SIZE > *max_free) {
         *max_free = heap_info_ptr->Size * ALIGNMENT_SIZE;
       }
     }
@@ -206,6 +324,9 @@ void heap_init(Heap* const heap, void* start, void* end, bool fuzz_on_free) {
     .is_allocated = false,
     .Size = heap_size
   };
+
+  memset(heap->free_lists, 0xFF, sizeof(heap->free_lists));
+  prv_free_list_insert(heap, heap->begin);
 }
 
 void heap_set_lock_impl(Heap *heap, HeapLockImpl lock_impl) {
@@ -220,6 +341,14 @@ void heap_set_corruption_handler(Heap *heap, CorruptionHandler corruption_handle
   heap->corruption_handler = corruption_handler;
 }
 
+#ifdef CONFIG_MALLOC_PROFILING
+void heap_set_profiler(Heap *heap, HeapProfiler *profiler) {
+  heap_lock(heap);
+  heap->profiler = profiler;
+  heap_unlock(heap);
+}
+#endif
+
 void *heap_malloc(Heap* const heap, unsigned long nbytes, uintptr_t client_pc) {
   // Check to make sure the heap we have is initialized.
   UTIL_ASSERT(heap->begin);
@@ -250,6 +379,12 @@ void *heap_malloc(Heap* const heap, unsigned long nbytes, uintptr_t client_pc) {
       allocated_block->pc = client_pc;
 #endif
 
+#ifdef CONFIG_MALLOC_PROFILING
+      allocated_block->alloc_time_ms = heap->profiler ?
+          heap_profiler_record_alloc(heap->profiler, client_pc,
+                                     allocated_block->Size * ALIGNMENT_SIZE) : 0;
+#endif
+
       heap->current_size += allocated_block->Size * ALIGNMENT_SIZE;
       if (heap->current_size > heap->high_water_mark) {
         heap->high_water_mark = heap->current_size;
@@ -306,6 +441,13 @@ void heap_free(Heap* const heap, void *ptr, uintptr_t client_pc) {
 #endif
 
     // Update metrics
+#ifdef CONFIG_MALLOC_PROFILING
+    if (heap->profiler) {
+      heap_profiler_record_free(heap->profiler, heap_info_ptr->pc,
+                                heap_info_ptr->Size * ALIGNMENT_SIZE,
+                                heap_info_ptr->alloc_time_ms);
+    }
+#endif
 #ifdef CONFIG_MALLOC_INSTRUMENTATION
     heap_info_ptr->pc = client_pc;
 #endif
@@ -323,6 +465,8 @@ void heap_free(Heap* const heap, void *ptr, uintptr_t client_pc) {
 
       /* Check to see if the previous segment can be combined. */
       if(!previous_block->is_allocated) {
+        prv_free_list_remove(heap, previous_block);
+
         /* Add the segment to be freed to the new beginer.     */
         previous_block->Size += heap_info_ptr->Size;
 
@@ -353,6 +497,7 @@ void heap_free(Heap* const heap, void *ptr, uintptr_t client_pc) {
       } else {
         /* The next segment is free, so merge it with the     */
         /* current segment.                                   */
+        prv_free_list_remove(heap, next_block);
         heap_info_ptr->Size += next_block->Size;
 
         /* Since we merged the next segment, we have to update*/
@@ -369,6 +514,8 @@ void heap_free(Heap* const heap, void *ptr, uintptr_t client_pc) {
         }
       }
     }
+
+    prv_free_list_insert(heap, heap_info_ptr);
   }
   heap_unlock(heap);
 }
@@ -411,47 +558,70 @@ static void prv_sanity_check_block(Heap * const heap, HeapInfo_t *block) {
   HEAP_ASSERT_SANE(heap, next_block >= heap->end || next_block->PrevSize == block->Size, block);
 }
 
+//! Scans up to max_blocks blocks of a free list, starting at the given offset.
+//! @param[in,out] offset the block to start at, set to the block after the last one scanned
+//! @return the first block which is at least n_units large or heap->end if there is none
+static HeapInfo_t *prv_free_list_scan(Heap* const heap, uint16_t *offset, unsigned long n_units,
+                                      int max_blocks) {
+  for (int i = 0; (*offset != FREE_LIST_END) && (i < max_blocks); i++) {
+    HeapInfo_t *heap_info_ptr = prv_free_list_block(heap, *offset);
+#if UNITTEST
+    s_num_blocks_searched++;
+#endif
+    prv_sanity_check_block(heap, heap_info_ptr);
+    HEAP_ASSERT_SANE(heap, !heap_info_ptr->is_allocated, heap_info_ptr);
+    *offset = prv_free_list_links(heap_info_ptr)->next;
+    if (heap_info_ptr->Size >= n_units) {
+      return heap_info_ptr;
+    }
+  }
+  return heap->end;
+}
+
 //! Finds a segment where data of the size n_units  will fit.
 //!     @param n_units number of ALIGNMENT_SIZE units this segment requires.
+//!     @return the segment or heap->end if there is none
 static HeapInfo_t *find_segment(Heap* const heap, unsigned long n_units) {
-  HeapInfo_t *heap_info_ptr = NULL;
-  /* If we are allocating a large segment, then start at the  */
-  /* end of the heap.  Otherwise, start at the beginning of   */
-  /* the heap.  If there is only one segment in the heap, then*/
-  /* heap->begin will be used either way.                      */
-  if (n_units >= LARGE_SIZE) {
-    heap_info_ptr = (HeapInfo_t *)(((Alignment_t *)heap->end) - heap->begin->PrevSize);
-  } else {
-    heap_info_ptr = heap->begin;
+  const int size_class = prv_size_class(n_units);
+  const bool is_floor = prv_is_size_class_floor(n_units);
+
+  // A block in n_units' own class wastes the least space, but not all of them fit
+  uint16_t own_class_offset = heap->free_lists[size_class];
+  if (!is_floor) {
+    HeapInfo_t *heap_info_ptr = prv_free_list_scan(heap, &own_class_offset, n_units,
+                                                   FREE_LIST_MAX_SCAN);
+    if (heap_info_ptr != heap->end) {
+      return heap_info_ptr;
+    }
   }
 
-  /* Loop until we have walked the entire list.               */
-  while (((n_units < LARGE_SIZE) || (heap_info_ptr > heap->begin)) && (heap_info_ptr < heap->end)) {
-
-    prv_sanity_check_block(heap, heap_info_ptr);
-
-    /* Check to see if the current entry is free and is large*/
-    /* enough to hold the data being requested.              */
-    if (heap_info_ptr->is_allocated || (heap_info_ptr->Size < n_units)) {
-      /* If the requested size is larger than the limit then*/
-      /* search backwards for an available buffer, else go  */
-      /* forward.  This will hopefully help to reduce       */
-      /* fragmentataion problems.                           */
-      if (n_units >= LARGE_SIZE) {
-        heap_info_ptr = get_previous_block(heap, heap_info_ptr);
-      } else {
-        heap_info_ptr = get_next_block(heap, heap_info_ptr);
+  // Every block in the classes above it is large enough. Like the first-fit
+  // search this replaced, pack small blocks towards the start of the heap and
+  // large ones towards the end: take the lowest (or highest) of the first few
+  // blocks of the smallest such class.
+  const int first_fitting_class = is_floor ? size_class : size_class + 1;
+  const uint64_t fitting_lists = (first_fitting_class < HEAP_NUM_FREE_LISTS) ?
+      (heap->free_list_bitmap & ~(((uint64_t)1 << first_fitting_class) - 1)) : 0;
+  if (fitting_lists) {
+    uint16_t offset = heap->free_lists[__builtin_ctzll(fitting_lists)];
+    uint16_t best_offset = offset;
+    for (int i = 0; i < FREE_LIST_MAX_SCAN; i++) {
+      const uint16_t block_offset = offset;
+      if (prv_free_list_scan(heap, &offset, 0 /* n_units */, 1 /* max_blocks */) == heap->end) {
+        break;
+      }
+      if ((n_units >= LARGE_SIZE) ? (block_offset > best_offset) : (block_offset < best_offset)) {
+        best_offset = block_offset;
       }
-    } else {
-      break;
     }
+    return prv_free_list_block(heap, best_offset);
   }
 
-  // make sure the space we found is within the bounds of the heap
-  UTIL_ASSERT((heap_info_ptr >= heap->begin) &&
-      (heap_info_ptr <= heap->end));
-
-  return heap_info_ptr;
+  // Otherwise the rest of n_units' own class might still have a block which fits
+  if (!is_floor) {
+    return prv_free_list_scan(heap, &own_class_offset, n_units, INT_MAX);
+  }
+  return heap->end;
 }
 
 //! Split a block into two smaller blocks, returning a pointer to the new second block.
@@ -490,6 +660,8 @@ static HeapInfo_t *allocate_block(Heap* const heap, unsigned long n_units, HeapI
     return NULL;
   }
 
+  prv_free_list_remove(heap, heap_info_ptr);
+
   /* Check to see if we need to split this into two        */
   /* entries.                                              */
   /* * NOTE * If there is not enough room to make another  */
@@ -507,11 +679,13 @@ static HeapInfo_t *allocate_block(Heap* const heap, unsigned long n_units, HeapI
   if (n_units >= LARGE_SIZE) {
     HeapInfo_t *second_block = split_block(heap, heap_info_ptr, heap_info_ptr->Size - n_units);
     second_block->is_allocated = true;
+    prv_free_list_insert(heap, heap_info_ptr);
     return second_block;
   }
 
-  split_block(heap, heap_info_ptr, n_units);
+  HeapInfo_t *second_block = split_block(heap, heap_info_ptr, n_units);
   heap_info_ptr->is_allocated = true;
+  prv_free_list_insert(heap, second_block);
   return heap_info_ptr;
 }
 
@@ -619,3 +793,9 @@ void heap_dump_malloc_instrumentation_to_dbgserial(Heap *heap) {
 
 }
 #endif
+
+#if UNITTEST
+uint32_t heap_prv_get_num_blocks_searched(void) {
+  return s_num_blocks_searched;
+}
+#endif
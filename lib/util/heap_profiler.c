@@ -0,0 +1,147 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "pbl/util/heap_profiler.h"
+
+#include "pbl/util/assert.h"
+#include "pbl/util/math.h"
+
+#include <string.h>
+
+static unsigned int prv_hash_index(const HeapProfiler *profiler, uintptr_t pc) {
+  // Thumb PCs are at least 2 byte aligned, drop the bit that never changes
+  return ((uint32_t)(pc >> 1) * 2654435761u) % profiler->num_sites;
+}
+
+//! @return the site of pc, the unused site it should go into if it has none yet or NULL if it has
+//! none and the table is full
+static HeapProfilerSite *prv_lookup(const HeapProfiler *profiler, uintptr_t pc) {
+  unsigned int index = prv_hash_index(profiler, pc);
+  for (unsigned int i = 0; i < profiler->num_sites; i++) {
+    HeapProfilerSite *site = &profiler->sites[index];
+    if ((site->pc == pc) || (site->pc == 0)) {
+      return site;
+    }
+    index = (index + 1) % profiler->num_sites;
+  }
+  return NULL;
+}
+
+void heap_profiler_init(HeapProfiler *profiler, HeapProfilerSite *sites, uint16_t num_sites,
+                        HeapProfilerTimeFunction get_time_ms) {
+  UTIL_ASSERT(sites && (num_sites > 0) && get_time_ms);
+  *profiler = (HeapProfiler) {
+    .sites = sites,
+    .num_sites = num_sites,
+    .get_time_ms = get_time_ms,
+  };
+  heap_profiler_reset(profiler);
+}
+
+void heap_profiler_reset(HeapProfiler *profiler) {
+  memset(profiler->sites, 0, profiler->num_sites * sizeof(HeapProfilerSite));
+  profiler->num_used_sites = 0;
+  profiler->num_dropped = 0;
+  profiler->start_time_ms = profiler->get_time_ms();
+}
+
+uint32_t heap_profiler_record_alloc(HeapProfiler *profiler, uintptr_t pc, size_t bytes) {
+  // Zero is reserved for allocations that weren't recorded
+  const uint32_t now = MAX(profiler->get_time_ms(), 1);
+
+  HeapProfilerSite *site = (pc != 0) ? prv_lookup(profiler, pc) : NULL;
+  if (!site) {
+    profiler->num_dropped++;
+    return now;
+  }
+  if (site->pc == 0) {
+    site->pc = pc;
+    profiler->num_used_sites++;
+  }
+
+  site->num_allocs++;
+  site->total_bytes += bytes;
+  site->live_bytes += bytes;
+  site->peak_live_bytes = MAX(site->peak_live_bytes, site->live_bytes);
+  return now;
+}
+
+unsigned int heap_profiler_get_lifetime_bucket(uint32_t lifetime_ms) {
+  unsigned int bucket = 0;
+  uint32_t limit = HEAP_PROFILER_LIFETIME_BUCKET_BASE;
+  while ((bucket < HEAP_PROFILER_NUM_LIFETIME_BUCKETS - 1) && (lifetime_ms >= limit)) {
+    bucket++;
+    limit *= HEAP_PROFILER_LIFETIME_BUCKET_BASE;
+  }
+  return bucket;
+}
+
+void heap_profiler_record_free(HeapProfiler *profiler, uintptr_t pc, size_t bytes,
+                               uint32_t alloc_time_ms) {
+  // Allocations from before the last reset were never recorded
+  if ((alloc_time_ms == 0) || ((int32_t)(alloc_time_ms - profiler->start_time_ms) < 0)) {
+    return;
+  }
+
+  HeapProfilerSite *site = prv_lookup(profiler, pc);
+  if (!site || (site->pc == 0)) {
+    return;
+  }
+
+  site->num_frees++;
+  site->live_bytes -= MIN(site->live_bytes, bytes);
+
+  const uint32_t lifetime_ms = profiler->get_time_ms() - alloc_time_ms;
+  uint16_t *count = &site->lifetime_histogram[heap_profiler_get_lifetime_bucket(lifetime_ms)];
+  if (*count < UINT16_MAX) {
+    (*count)++;
+  }
+}
+
+const HeapProfilerSite *heap_profiler_find_site(const HeapProfiler *profiler, uintptr_t pc) {
+  const HeapProfilerSite *site = prv_lookup(profiler, pc);
+  return (site && (site->pc == pc)) ? site : NULL;
+}
+
+size_t heap_profiler_get_serialized_size(const HeapProfiler *profiler) {
+  return sizeof(HeapProfilerHeader) +
+         (profiler->num_used_sites * sizeof(HeapProfilerSiteRecord));
+}
+
+size_t heap_profiler_serialize(const HeapProfiler *profiler, uint8_t *buffer, size_t buffer_size) {
+  const size_t size = heap_profiler_get_serialized_size(profiler);
+  if (buffer_size < size) {
+    return 0;
+  }
+
+  const HeapProfilerHeader header = {
+    .magic = HEAP_PROFILER_MAGIC,
+    .version = HEAP_PROFILER_VERSION,
+    .num_lifetime_buckets = HEAP_PROFILER_NUM_LIFETIME_BUCKETS,
+    .num_sites = profiler->num_used_sites,
+    .num_dropped = profiler->num_dropped,
+    .duration_ms = profiler->get_time_ms() - profiler->start_time_ms,
+  };
+  memcpy(buffer, &header, sizeof(header));
+  buffer += sizeof(header);
+
+  for (unsigned int i = 0; i < profiler->num_sites; i++) {
+    const HeapProfilerSite *site = &profiler->sites[i];
+    if (site->pc == 0) {
+      continue;
+    }
+    HeapProfilerSiteRecord record = {
+      .pc = site->pc,
+      .num_allocs = site->num_allocs,
+      .num_frees = site->num_frees,
+      .total_bytes = site->total_bytes,
+      .live_bytes = site->live_bytes,
+      .peak_live_bytes = site->peak_live_bytes,
+    };
+    memcpy(record.lifetime_histogram, site->lifetime_histogram,
+           sizeof(record.lifetime_histogram));
+    memcpy(buffer, &record, sizeof(record));
+    buffer += sizeof(record);
+  }
+  return size;
+}
@@ -0,0 +1,187 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "pbl/util/object_pool.h"
+
+#include "pbl/util/assert.h"
+#include "pbl/util/math.h"
+
+//! Objects are aligned like heap allocations so any structure can be pooled
+#define OBJECT_POOL_ALIGNMENT (sizeof(unsigned long))
+
+struct ObjectPoolSlab {
+  ObjectPoolSlab *next;
+  //! Freed objects of this slab, linked through their first word
+  void *free_head;
+  uint16_t num_free;
+  //! Number of objects at the end of the slab that have never been handed out
+  uint16_t num_untouched;
+  uint8_t objects[] __attribute__((aligned(OBJECT_POOL_ALIGNMENT)));
+};
+
+static ListNode *s_pools;
+static ObjectPoolLockImpl s_lock_impl;
+
+static void prv_lock(void) {
+  if (s_lock_impl.lock_function) {
+    s_lock_impl.lock_function(s_lock_impl.lock_context);
+  }
+}
+
+static void prv_unlock(void) {
+  if (s_lock_impl.unlock_function) {
+    s_lock_impl.unlock_function(s_lock_impl.lock_context);
+  }
+}
+
+void object_pool_set_lock_impl(ObjectPoolLockImpl lock_impl) {
+  s_lock_impl = lock_impl;
+}
+
+size_t object_pool_get_slab_size(const ObjectPool *pool) {
+  return sizeof(ObjectPoolSlab) + (pool->object_size * pool->objects_per_slab);
+}
+
+static bool prv_slab_contains(const ObjectPool *pool, const ObjectPoolSlab *slab,
+                              const void *object) {
+  const uint8_t *ptr = object;
+  return (ptr >= slab->objects) &&
+         (ptr < slab->objects + (pool->object_size * pool->objects_per_slab));
+}
+
+static ObjectPoolSlab *prv_slab_create(ObjectPool *pool, uintptr_t client_pc) {
+  ObjectPoolSlab *slab = pool->spare_slab;
+  if (slab) {
+    // The spare slab is empty, so all of its objects are on its free list or untouched already
+    pool->spare_slab = NULL;
+  } else {
+    slab = pool->slab_alloc(object_pool_get_slab_size(pool), client_pc);
+    if (!slab) {
+      return NULL;
+    }
+    // Objects only get threaded onto the free list once they are freed, so creating a slab
+    // doesn't have to touch all of its memory
+    *slab = (ObjectPoolSlab) {
+      .num_free = pool->objects_per_slab,
+      .num_untouched = pool->objects_per_slab,
+    };
+    pool->num_slabs++;
+  }
+  slab->next = pool->slabs;
+  pool->slabs = slab;
+  return slab;
+}
+
+void object_pool_init(ObjectPool *pool, const char *name, size_t object_size,
+                      uint16_t objects_per_slab, ObjectPoolSlabAlloc slab_alloc,
+                      ObjectPoolSlabFree slab_free, int stats_key) {
+  UTIL_ASSERT(pool && slab_alloc && slab_free && (objects_per_slab > 0));
+  object_size = ROUND_TO_MOD_CEIL(MAX(object_size, sizeof(void *)), OBJECT_POOL_ALIGNMENT);
+  UTIL_ASSERT(object_size <= UINT16_MAX);
+
+  prv_lock();
+  const bool is_registered = list_contains(s_pools, &pool->list_node);
+  const ListNode list_node = pool->list_node;
+  *pool = (ObjectPool) {
+    .list_node = is_registered ? list_node : (ListNode) {},
+    .name = name,
+    .slab_alloc = slab_alloc,
+    .slab_free = slab_free,
+    .object_size = object_size,
+    .objects_per_slab = objects_per_slab,
+    .stats_key = stats_key,
+  };
+  if (!is_registered) {
+    s_pools = list_prepend(s_pools, &pool->list_node);
+  }
+  prv_unlock();
+}
+
+void object_pool_deinit(ObjectPool *pool) {
+  prv_lock();
+  if (list_contains(s_pools, &pool->list_node)) {
+    list_remove(&pool->list_node, &s_pools, NULL);
+  }
+  pool->slabs = NULL;
+  pool->spare_slab = NULL;
+  pool->num_slabs = 0;
+  pool->num_allocated = 0;
+  prv_unlock();
+}
+
+void *object_pool_alloc(ObjectPool *pool) {
+  prv_lock();
+  ObjectPoolSlab *slab = pool->slabs;
+  while (slab && (slab->num_free == 0)) {
+    slab = slab->next;
+  }
+  if (!slab) {
+    slab = prv_slab_create(pool, (uintptr_t)__builtin_return_address(0));
+    if (!slab) {
+      prv_unlock();
+      return NULL;
+    }
+  }
+
+  void *object;
+  if (slab->free_head) {
+    object = slab->free_head;
+    slab->free_head = *(void **)object;
+  } else {
+    UTIL_ASSERT(slab->num_untouched > 0);
+    object = slab->objects +
+             (pool->object_size * (pool->objects_per_slab - slab->num_untouched));
+    slab->num_untouched--;
+  }
+  slab->num_free--;
+
+  pool->num_allocated++;
+  pool->high_water_mark = MAX(pool->high_water_mark, pool->num_allocated);
+  prv_unlock();
+  return object;
+}
+
+void object_pool_free(ObjectPool *pool, void *object) {
+  if (!object) {
+    return;
+  }
+
+  prv_lock();
+  ObjectPoolSlab **slab_ref = &pool->slabs;
+  while (*slab_ref && !prv_slab_contains(pool, *slab_ref, object)) {
+    slab_ref = &(*slab_ref)->next;
+  }
+  ObjectPoolSlab *slab = *slab_ref;
+  // Object isn't from this pool
+  UTIL_ASSERT(slab);
+  UTIL_ASSERT((((uint8_t *)object - slab->objects) % pool->object_size) == 0);
+
+  *(void **)object = slab->free_head;
+  slab->free_head = object;
+  slab->num_free++;
+  pool->num_allocated--;
+
+  if (slab->num_free == pool->objects_per_slab) {
+    *slab_ref = slab->next;
+    if (!pool->spare_slab) {
+      pool->spare_slab = slab;
+    } else {
+      pool->num_slabs--;
+      pool->slab_free(slab);
+    }
+  }
+  prv_unlock();
+}
+
+void object_pool_each(ObjectPoolEachCb cb, void *context) {
+  prv_lock();
+  ListNode *node = s_pools;
+  while (node) {
+    ListNode *next = list_get_next(node);
+    if (!cb((ObjectPool *)node, context)) {
+      break;
+    }
+    node = next;
+  }
+  prv_unlock();
+}
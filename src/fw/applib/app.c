@@ -3,6 +3,7 @@
 
 #include "app.h"
 
+#include "applib/graphics/framebuffer.h"
 #include "applib/graphics/graphics_private.h"
 #include "applib/ui/app_window_stack.h"
 #include "applib/ui/window_stack.h"
@@ -14,13 +15,58 @@
 #include "system/logging.h"
 #include "system/profiler.h"
 
+//! @return whether the window has to be redrawn entirely rather than only where it was damaged.
+//! This is decided before any update_proc runs so that no frame is ever drawn twice. Only system
+//! apps render partially, and they capture the framebuffer through the drawing routines alone,
+//! which stay within the clip box.
+static bool prv_is_full_render_required(const Window *window, const GRect *damage_bounds) {
+  // Legacy 2.x windows are drawn below the status bar, their damage is offset by it
+  if (!window->is_fullscreen || *app_state_get_full_render_required()) {
+    return true;
+  }
+  const GRect screen = { GPointZero, app_state_get_framebuffer()->size };
+  GRect damaged_screen = *damage_bounds;
+  grect_clip(&damaged_screen, &screen);
+  return grect_equal(&damaged_screen, &screen);
+}
+
+//! Redraws the window where it was damaged since its last render. The framebuffer still holds
+//! that render as anything else drawing into it, like a window transition, damages all of it.
+static void prv_render_window(Window *window, GContext *ctx) {
+  const GRect damage_bounds = gdirty_region_get_bounds(app_state_get_render_damage());
+  if (prv_is_full_render_required(window, &damage_bounds)) {
+    window_render(window, ctx);
+  } else {
+    window_render_rect(window, ctx, &damage_bounds);
+  }
+}
+
+//! Rendering marks everything that was drawn as dirty, which always includes the background of
+//! the whole window. Replace that with the damage scheduled since the last render so that the
+//! compositor only copies and flushes the parts of the screen that changed.
+static void prv_publish_render_damage(Window *window) {
+  FrameBuffer *fb = app_state_get_framebuffer();
+  GDirtyRegion *damage = app_state_get_render_damage();
+  if (!window->is_fullscreen || *app_state_get_full_render_required()) {
+    framebuffer_dirty_all(fb);
+  } else {
+    framebuffer_reset_dirty(fb);
+    for (unsigned int i = 0; i < damage->num_rects; i++) {
+      framebuffer_mark_dirty_rect(fb, damage->rects[i]);
+    }
+  }
+  gdirty_region_reset(damage);
+}
+
 static void prv_render_app(void) {
   WindowStack *stack = app_state_get_window_stack();
   GContext *ctx = app_state_get_graphics_context();
   if (!window_stack_is_animating(stack)) {
     SYS_PROFILER_NODE_START(render_app);
-    window_render(app_window_stack_get_top_window(), ctx);
+    Window *window = app_window_stack_get_top_window();
+    prv_render_window(window, ctx);
     SYS_PROFILER_NODE_STOP(render_app);
+    prv_publish_render_damage(window);
   } else {
     // TODO: PBL-17645 render container layer instead of the two windows
     WindowTransitioningContext *transition_context = &stack->transition_context;
@@ -28,6 +74,11 @@ static void prv_render_app(void) {
     if (transition_context->implementation->render) {
       transition_context->implementation->render(transition_context, ctx);
     }
+    // The windows move across the whole screen: copy all of it to the display now, and redraw all
+    // of the window the next time it's rendered on its own
+    FrameBuffer *fb = app_state_get_framebuffer();
+    framebuffer_dirty_all(fb);
+    gdirty_region_add(app_state_get_render_damage(), &fb->dirty_rect);
   }
 
   *app_state_get_framebuffer_render_pending() = true;
@@ -45,3 +45,11 @@ uint32_t app_inbox_destroy_and_deregister(AppInbox *app_inbox) {
 void app_inbox_consume(AppInboxConsumerInfo *consumer_info) {
   sys_app_inbox_service_consume(consumer_info);
 }
+
+void app_inbox_pin(AppInboxConsumerInfo *consumer_info) {
+  sys_app_inbox_service_pin(consumer_info);
+}
+
+void app_inbox_release(AppInbox *app_inbox) {
+  sys_app_inbox_service_release((uint8_t *)app_inbox);
+}
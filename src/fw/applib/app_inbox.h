@@ -44,3 +44,17 @@ uint32_t app_inbox_destroy_and_deregister(AppInbox *app_inbox_ref);
 //! up the space in the buffer that was occupied by the message.
 //! @param consume_info The opaque context object as passed into the AppInboxMessageHandler.
 void app_inbox_consume(AppInboxConsumerInfo *consume_info);
+
+//! Call this function from a AppInboxMessageHandler to keep the message in the buffer after it has
+//! been consumed, so its data can still be used after the handler returns, without copying it.
+//! The data stays valid until the message is released with app_inbox_release().
+//! @note No space is freed up while any message is pinned, not even the space of the messages
+//! that are consumed after it. Messages that don't fit into the remaining space get dropped, so
+//! release pinned messages as soon as possible.
+//! @param consume_info The opaque context object as passed into the AppInboxMessageHandler.
+void app_inbox_pin(AppInboxConsumerInfo *consume_info);
+
+//! Releases a message that was pinned with app_inbox_pin(). Once all pinned messages have been
+//! released, the space of the consumed messages is freed up.
+//! @param app_inbox_ref The app inbox that the message was received in.
+void app_inbox_release(AppInbox *app_inbox_ref);
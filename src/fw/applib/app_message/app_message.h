@@ -371,6 +371,22 @@ void app_message_close(void);
 
 // -------- AppMessage Inbox --------------------------------------------------------------------------------------- //
 
+//! Keeps the message that is being handled by the \ref AppMessageInboxReceived callback in the Inbox after the
+//! callback returns, so the data of its tuples can still be used without copying it.
+//! The data stays valid until the message is released with \ref app_message_inbox_release().
+//!
+//! \return true if the message was pinned, false if this was not called from the
+//!   \ref AppMessageInboxReceived callback.
+//!
+//! \note No Inbox space is freed up while any message is pinned, messages that don't fit into the remaining space
+//!   get dropped. Release pinned messages as soon as possible.
+//!
+bool app_message_inbox_pin(void);
+
+//! Releases a message that was pinned with \ref app_message_inbox_pin().
+//!
+void app_message_inbox_release(void);
+
 // Note: the Inbox has no direct functions, only callbacks.
 
 
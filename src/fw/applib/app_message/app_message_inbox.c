@@ -1,6 +1,7 @@
 /* SPDX-FileCopyrightText: 2024 Google LLC */
 /* SPDX-License-Identifier: Apache-2.0 */
 
+#include "applib/app_inbox.h"
 #include "applib/app_message/app_message_internal.h"
 #include "applib/app_message/app_message_receiver.h"
 #include "process_state/app_state/app_state.h"
@@ -66,6 +67,24 @@ void app_message_inbox_handle_dropped_messages(uint32_t num_drops) {
   }
 }
 
+bool app_message_inbox_pin(void) {
+  AppMessageCtxInbox *inbox = &app_state_get_app_message_ctx()->inbox;
+  if (!inbox->is_receiving) {
+    APP_LOG(LOG_LEVEL_ERROR,
+            "app_message_inbox_pin() must be called from the inbox received callback");
+    return false;
+  }
+  inbox->should_pin = true;
+  return true;
+}
+
+void app_message_inbox_release(void) {
+  AppInbox *app_inbox = *app_state_get_app_message_inbox();
+  if (app_inbox) {
+    app_inbox_release(app_inbox);
+  }
+}
+
 static bool prv_is_app_with_uuid_running(const Uuid *uuid) {
   Uuid app_uuid = {};
   sys_get_app_uuid(&app_uuid);
@@ -95,7 +114,14 @@ void app_message_inbox_receive(CommSession *session, AppMessagePush *push_messag
   dict_read_begin_from_buffer(&iterator, (const uint8_t *) &push_message->dictionary, dict_size);
 
   if (inbox->received_callback) {
+    inbox->is_receiving = true;
     inbox->received_callback(&iterator, inbox->user_context);
+    inbox->is_receiving = false;
+  }
+
+  if (inbox->should_pin) {
+    inbox->should_pin = false;
+    app_inbox_pin(consumer_info);
   }
 
   // Mark data as consumed...
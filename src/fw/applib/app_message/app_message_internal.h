@@ -67,6 +67,10 @@ typedef enum AppMessagePhaseOut {
 
 typedef struct AppMessageCtxInbox {
   bool is_open;
+  //! True while received_callback is handling a message
+  bool is_receiving;
+  //! Set by app_message_inbox_pin(), the message gets pinned once received_callback returns
+  bool should_pin;
   void *user_context;
   AppMessageInboxReceived received_callback;
   AppMessageInboxDropped dropped_callback;
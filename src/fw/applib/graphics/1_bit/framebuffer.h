@@ -13,6 +13,7 @@ typedef struct FrameBuffer {
   uint32_t buffer[FRAMEBUFFER_SIZE_DWORDS];
   GSize size;
   GRect dirty_rect; //<! Smallest rect covering all dirty pixels.
+  GDirtyRegion dirty_region; //<! The dirty pixels, dirty_rect is its bounding box.
   bool is_dirty;
 } FrameBuffer;
 
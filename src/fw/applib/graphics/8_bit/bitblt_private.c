@@ -10,6 +10,8 @@
 #include "util/bitset.h"
 #include "pbl/util/math.h"
 
+#include <string.h>
+
 #if !defined(__clang__)
 #pragma GCC optimize("O2")
 #endif
@@ -126,129 +128,180 @@ void bitblt_bitmap_into_bitmap_tiled_palette_to_8bit(GBitmap* dest_bitmap,
   }
 }
 
+//! What the span procs of bitblt_bitmap_into_bitmap_tiled_8bit_to_8bit() need to composite
+typedef struct Bitblt8BitSpanContext {
+  GColor8 tint_color;
+  GColor8 tint_luminance_lookup_table[GCOLOR8_COMPONENT_NUM_VALUES];
+} Bitblt8BitSpanContext;
+
+//! Composites a span of pixels that all lie within the data of a source row
+typedef void (*Bitblt8BitSpanProc)(uint8_t *dest, const uint8_t *src, int16_t width,
+                                   const Bitblt8BitSpanContext *context);
+
+//! Whether dest starts within src, where copying from left to right reads pixels that have
+//! already been overwritten. That happens when drawing a bitmap into itself further right, see
+//! graphics_draw_bitmap_in_rect_processed().
+static bool prv_span_overlaps_forward(const uint8_t *dest, const uint8_t *src, int16_t width) {
+  return ((uintptr_t)dest > (uintptr_t)src) && ((uintptr_t)dest < (uintptr_t)src + width);
+}
+
+static void prv_span_assign(uint8_t *dest, const uint8_t *src, int16_t width,
+                            const Bitblt8BitSpanContext *context) {
+  if (prv_span_overlaps_forward(dest, src, width)) {
+    // Repeat the overwritten pixels like the per pixel loop this replaced did
+    for (int16_t x = 0; x < width; x++) {
+      dest[x] = src[x];
+    }
+    return;
+  }
+  memmove(dest, src, width);
+}
+
+// The top bit of each of the alpha channels in a word of four GColor8 pixels
+#define ALPHA_HIGH_BITS_WORD (0x80808080)
+
+static void prv_span_set(uint8_t *dest, const uint8_t *src, int16_t width,
+                         const Bitblt8BitSpanContext *context) {
+  int16_t x = 0;
+  // Sprites are mostly made of pixels that are either opaque or transparent, four of those can be
+  // selected into the destination at once without looking up any blend. Reading four pixels
+  // ahead would miss the ones a self overlapping span has just overwritten though.
+  const int16_t words_end_x = prv_span_overlaps_forward(dest, src, width) ? 0 : width;
+  for (; x + (int16_t)sizeof(uint32_t) <= words_end_x; x += sizeof(uint32_t)) {
+    uint32_t src_word;
+    memcpy(&src_word, &src[x], sizeof(src_word));
+    // 0x80 in the bytes of the pixels with an alpha of 3, and of those with an alpha of 0
+    const uint32_t opaque = src_word & (src_word << 1) & ALPHA_HIGH_BITS_WORD;
+    const uint32_t transparent = ~(src_word | (src_word << 1)) & ALPHA_HIGH_BITS_WORD;
+    if (opaque == ALPHA_HIGH_BITS_WORD) {
+      memcpy(&dest[x], &src_word, sizeof(src_word));
+    } else if ((opaque | transparent) == ALPHA_HIGH_BITS_WORD) {
+      uint32_t dest_word;
+      memcpy(&dest_word, &dest[x], sizeof(dest_word));
+      // 0xff in the bytes of the opaque pixels
+      const uint32_t opaque_mask = (opaque >> 7) * 0xff;
+      dest_word = (src_word & opaque_mask) | (dest_word & ~opaque_mask);
+      memcpy(&dest[x], &dest_word, sizeof(dest_word));
+    } else {
+      for (int16_t i = x; i < x + (int16_t)sizeof(uint32_t); i++) {
+        dest[i] = gcolor_alpha_blend((GColor8)src[i], (GColor8)dest[i]).argb;
+      }
+    }
+  }
+  for (; x < width; x++) {
+    dest[x] = gcolor_alpha_blend((GColor8)src[x], (GColor8)dest[x]).argb;
+  }
+}
+
+static void prv_span_tint(uint8_t *dest, const uint8_t *src, int16_t width,
+                          const Bitblt8BitSpanContext *context) {
+  for (int16_t x = 0; x < width; x++) {
+    GColor actual_color = context->tint_color;
+    actual_color.a = ((GColor8)src[x]).a;
+    dest[x] = gcolor_alpha_blend(actual_color, (GColor8)dest[x]).argb;
+  }
+}
+
+static void prv_span_tint_luminance(uint8_t *dest, const uint8_t *src, int16_t width,
+                                    const Bitblt8BitSpanContext *context) {
+  for (int16_t x = 0; x < width; x++) {
+    const GColor actual_color = gcolor_perform_lookup_using_color_luminance_and_multiply_alpha(
+        (GColor8)src[x], context->tint_luminance_lookup_table);
+    dest[x] = gcolor_alpha_blend(actual_color, (GColor8)dest[x]).argb;
+  }
+}
+
 void bitblt_bitmap_into_bitmap_tiled_8bit_to_8bit(GBitmap *dest_bitmap,
                                                   const GBitmap *src_bitmap,
                                                   GRect dest_rect,
                                                   GPoint src_origin_offset,
                                                   GCompOp compositing_mode,
                                                   GColor8 tint_color) {
-  const int16_t dest_begin_y = dest_rect.origin.y;
-  const int16_t dest_end_y = grect_get_max_y(&dest_rect);
-  const int16_t src_begin_y = src_bitmap->bounds.origin.y;
-  const int16_t src_end_y = grect_get_max_y(&src_bitmap->bounds);
-  int16_t src_y = src_begin_y + src_origin_offset.y;
-
+  Bitblt8BitSpanContext span_context = {
+    .tint_color = tint_color,
+  };
+  Bitblt8BitSpanProc span_proc;
   // Default all compositing modes to GCompAssign except for GCompOpSet
-  // and GCompOpOr.
+  // and the tints.
   switch (compositing_mode) {
     case GCompOpAssign:
     case GCompOpAssignInverted:
     case GCompOpAnd:
     case GCompOpOr:
-    case GCompOpClear: {
-      for (int16_t dest_y = dest_begin_y; dest_y < dest_end_y; ++dest_y, ++src_y) {
-        // Wrap-around source bitmap vertically
-        if (src_y >= src_end_y) {
-          src_y = src_begin_y;
-        }
-
-        const GBitmapDataRowInfo dest_row_info = gbitmap_get_data_row_info(dest_bitmap, dest_y);
-        uint8_t *dest = dest_row_info.data;
-        const int16_t dest_delta_begin_x = MAX(dest_row_info.min_x - dest_rect.origin.x, 0);
-        const int16_t dest_begin_x = dest_delta_begin_x ? dest_row_info.min_x : dest_rect.origin.x;
-        const int16_t dest_end_x = MIN(grect_get_max_x(&dest_rect), dest_row_info.max_x + 1);
-        if (dest_end_x < dest_begin_x) {
-          continue;
-        }
-
-        const GBitmapDataRowInfo src_row_info = gbitmap_get_data_row_info(src_bitmap, src_y);
-        const uint8_t *src = src_row_info.data;
-        // This is the initial position that takes into account destination delta shift
-        const int16_t src_initial_x = src_bitmap->bounds.origin.x + dest_delta_begin_x;
-        const int16_t src_begin_x = MAX(src_row_info.min_x, src_bitmap->bounds.origin.x);
-        const int16_t src_end_x = MIN(grect_get_max_x(&src_bitmap->bounds),
-                                      src_row_info.max_x + 1);
-
-        int16_t src_x = src_initial_x + src_origin_offset.x;
-        for (int16_t dest_x = dest_begin_x; dest_x < dest_end_x; ++dest_x, ++src_x) {
-          if (!WITHIN(src_x, src_begin_x, src_end_x - 1)) {
-            // Check if content should wrap (under and over) for tiling
-            if (!WITHIN(src_x, src_bitmap->bounds.origin.x,
-                        grect_get_max_x(&src_bitmap->bounds) - 1)) {
-              // keep correct bounds alignment for circular when tiling
-              src_x = src_bitmap->bounds.origin.x +
-                ((src_x - src_bitmap->bounds.origin.x) % src_bitmap->bounds.size.w);
-            } else {
-              // Increment source but don't draw
-              continue;
-            }
-          }
-          dest[dest_x] = src[src_x];
-        }
-      }
+    case GCompOpClear:
+      span_proc = prv_span_assign;
       break;
-    }
     case GCompOpTint:
+      span_proc = prv_span_tint;
+      break;
     case GCompOpTintLuminance:
+      gcolor_tint_luminance_lookup_table_init(tint_color,
+                                              span_context.tint_luminance_lookup_table);
+      span_proc = prv_span_tint_luminance;
+      break;
     case GCompOpSet:
-    default: {
-      // Initialize the tint luminance lookup table if necessary
-      GColor8 tint_luminance_lookup_table[GCOLOR8_COMPONENT_NUM_VALUES] = {};
-      if (compositing_mode == GCompOpTintLuminance) {
-        gcolor_tint_luminance_lookup_table_init(tint_color, tint_luminance_lookup_table);
-      }
+    default:
+      span_proc = prv_span_set;
+      break;
+  }
 
-      for (int16_t dest_y = dest_begin_y; dest_y < dest_end_y; ++dest_y, ++src_y) {
-        // Wrap-around source bitmap vertically
-        if (src_y >= src_end_y) {
-          src_y = src_begin_y;
-        }
+  const int16_t dest_begin_y = dest_rect.origin.y;
+  const int16_t dest_end_y = grect_get_max_y(&dest_rect);
+  const int16_t src_begin_y = src_bitmap->bounds.origin.y;
+  const int16_t src_end_y = grect_get_max_y(&src_bitmap->bounds);
+  const int16_t src_bounds_begin_x = src_bitmap->bounds.origin.x;
+  const int16_t src_bounds_end_x = grect_get_max_x(&src_bitmap->bounds);
+  int16_t src_y = src_begin_y + src_origin_offset.y;
 
-        const GBitmapDataRowInfo dest_row_info = gbitmap_get_data_row_info(dest_bitmap, dest_y);
-        uint8_t *dest = dest_row_info.data;
-        const int16_t dest_delta_begin_x = MAX(dest_row_info.min_x - dest_rect.origin.x, 0);
-        const int16_t dest_begin_x = dest_delta_begin_x ? dest_row_info.min_x : dest_rect.origin.x;
-        const int16_t dest_end_x = MIN(grect_get_max_x(&dest_rect), dest_row_info.max_x + 1);
-        if (dest_end_x < dest_begin_x) {
-          continue;
-        }
+  for (int16_t dest_y = dest_begin_y; dest_y < dest_end_y; ++dest_y, ++src_y) {
+    // Wrap-around source bitmap vertically
+    if (src_y >= src_end_y) {
+      src_y = src_begin_y;
+    }
 
-        const GBitmapDataRowInfo src_row_info = gbitmap_get_data_row_info(src_bitmap, src_y);
-        const uint8_t *src = src_row_info.data;
-        // This is the initial position that takes into account destination delta shift
-        const int16_t src_initial_x = src_bitmap->bounds.origin.x + dest_delta_begin_x;
-        const int16_t src_begin_x = MAX(src_row_info.min_x, src_bitmap->bounds.origin.x);
-        const int16_t src_end_x = MIN(grect_get_max_x(&src_bitmap->bounds),
-                                      src_row_info.max_x + 1);
-
-        int16_t src_x = src_initial_x + src_origin_offset.x;
-        for (int16_t dest_x = dest_begin_x; dest_x < dest_end_x; ++dest_x, ++src_x) {
-          if (!WITHIN(src_x, src_begin_x, src_end_x - 1)) {
-            // Check if content should wrap (under and over) for tiling
-            if (!WITHIN(src_x, src_bitmap->bounds.origin.x,
-                        grect_get_max_x(&src_bitmap->bounds) - 1)) {
-              // keep correct bounds alignment for circular when tiling
-              src_x = src_bitmap->bounds.origin.x +
-                (((src_x - src_bitmap->bounds.origin.x)) % src_bitmap->bounds.size.w);
-            } else {
-              // Increment source but don't draw
-              continue;
-            }
-          }
-          GColor src_color = *(GColor8 *) &src[src_x];
-
-          GColor actual_color = src_color;
-          if (compositing_mode == GCompOpTint) {
-            actual_color = tint_color;
-            actual_color.a = src_color.a;
-          } else if (compositing_mode == GCompOpTintLuminance) {
-            actual_color = gcolor_perform_lookup_using_color_luminance_and_multiply_alpha(
-                src_color, tint_luminance_lookup_table);
-          }
-          dest[dest_x] = gcolor_alpha_blend(actual_color, (GColor8)dest[dest_x]).argb;
+    const GBitmapDataRowInfo dest_row_info = gbitmap_get_data_row_info(dest_bitmap, dest_y);
+    uint8_t *dest = dest_row_info.data;
+    const int16_t dest_delta_begin_x = MAX(dest_row_info.min_x - dest_rect.origin.x, 0);
+    const int16_t dest_begin_x = dest_delta_begin_x ? dest_row_info.min_x : dest_rect.origin.x;
+    const int16_t dest_end_x = MIN(grect_get_max_x(&dest_rect), dest_row_info.max_x + 1);
+    if (dest_end_x < dest_begin_x) {
+      continue;
+    }
+
+    const GBitmapDataRowInfo src_row_info = gbitmap_get_data_row_info(src_bitmap, src_y);
+    const uint8_t *src = src_row_info.data;
+    // This is the initial position that takes into account destination delta shift
+    const int16_t src_initial_x = src_bounds_begin_x + dest_delta_begin_x;
+    const int16_t src_begin_x = MAX(src_row_info.min_x, src_bounds_begin_x);
+    const int16_t src_end_x = MIN(src_bounds_end_x, src_row_info.max_x + 1);
+
+    // Walk the row in spans of pixels that are composited the same way rather than checking the
+    // bounds of the source for every pixel
+    int16_t src_x = src_initial_x + src_origin_offset.x;
+    int16_t dest_x = dest_begin_x;
+    while (dest_x < dest_end_x) {
+      int16_t span_width = 1;
+      if (!WITHIN(src_x, src_begin_x, src_end_x - 1)) {
+        if (WITHIN(src_x, src_bounds_begin_x, src_bounds_end_x - 1)) {
+          // Increment source but don't draw up to where the row has data or the bounds end
+          const int16_t skip_end_x = (src_x < src_begin_x) ? MIN(src_begin_x, src_bounds_end_x) :
+                                                             src_bounds_end_x;
+          span_width = MIN(skip_end_x - src_x, dest_end_x - dest_x);
+          dest_x += span_width;
+          src_x += span_width;
+          continue;
         }
+        // Content wraps (under and over) for tiling,
+        // keep correct bounds alignment for circular when tiling
+        src_x = src_bounds_begin_x +
+          ((src_x - src_bounds_begin_x) % src_bitmap->bounds.size.w);
       }
-      break;
+      if (WITHIN(src_x, src_begin_x, src_end_x - 1)) {
+        span_width = MIN(src_end_x - src_x, dest_end_x - dest_x);
+      }
+      span_proc(&dest[dest_x], &src[src_x], span_width, &span_context);
+      dest_x += span_width;
+      src_x += span_width;
     }
   }
 }
@@ -56,13 +56,14 @@ void framebuffer_clear(FrameBuffer *f) {
 void framebuffer_mark_dirty_rect(FrameBuffer *f, GRect rect) {
   PBL_ASSERTN(!gsize_equal(&f->size, &GSizeZero));
   if (!f->is_dirty) {
-    f->dirty_rect = rect;
-  } else {
-    f->dirty_rect = grect_union(&f->dirty_rect, &rect);
+    gdirty_region_reset(&f->dirty_region);
   }
 
+  grect_standardize(&rect);
   const GRect clip_rect = (GRect) { GPointZero, f->size };
-  grect_clip(&f->dirty_rect, &clip_rect);
+  grect_clip(&rect, &clip_rect);
+  gdirty_region_add(&f->dirty_region, &rect);
+  f->dirty_rect = gdirty_region_get_bounds(&f->dirty_region);
 
   f->is_dirty = true;
 }
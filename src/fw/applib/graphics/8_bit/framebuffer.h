@@ -18,6 +18,7 @@ typedef struct FrameBuffer {
   uint8_t buffer[FRAMEBUFFER_SIZE_BYTES];
   GSize size; //<! Active size of the framebuffer
   GRect dirty_rect; //<! Smallest rect covering all dirty pixels.
+  GDirtyRegion dirty_region; //<! The dirty pixels, dirty_rect is its bounding box.
   bool is_dirty;
 } FrameBuffer;
 #else // UNITTEST
@@ -26,6 +27,7 @@ typedef struct FrameBuffer {
 typedef struct PACKED FrameBuffer {
   GSize size; //<! Active size of the framebuffer
   GRect dirty_rect; //<! Smallest rect covering all dirty pixels.
+  GDirtyRegion dirty_region; //<! The dirty pixels, dirty_rect is its bounding box.
   bool is_dirty;
   uint8_t buffer[FRAMEBUFFER_SIZE_BYTES];
 } FrameBuffer;
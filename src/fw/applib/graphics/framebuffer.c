@@ -42,12 +42,17 @@ GBitmap framebuffer_get_as_bitmap(FrameBuffer *fb, const GSize *size) {
 void framebuffer_dirty_all(FrameBuffer *fb) {
   PBL_ASSERTN(!gsize_equal(&fb->size, &GSizeZero));
   fb->dirty_rect = (GRect) { GPointZero, fb->size };
+  fb->dirty_region = (GDirtyRegion) {
+    .rects = { fb->dirty_rect },
+    .num_rects = 1,
+  };
   fb->is_dirty = true;
 }
 
 void framebuffer_reset_dirty(FrameBuffer *fb) {
   PBL_ASSERTN(!gsize_equal(&fb->size, &GSizeZero));
   fb->dirty_rect = GRectZero;
+  gdirty_region_reset(&fb->dirty_region);
   fb->is_dirty = false;
 }
 
@@ -27,7 +27,8 @@ size_t framebuffer_get_size_bytes(FrameBuffer *f);
 //! Will not be visible on the display until graphics_flush_frame_buffer is called.
 void framebuffer_clear(FrameBuffer* f);
 
-//! Mark the given rect of pixels as dirty
+//! Mark the given rect of pixels as dirty. The rects are kept apart in the framebuffer's
+//! dirty_region so that only the changed parts need to be copied and flushed.
 void framebuffer_mark_dirty_rect(FrameBuffer* f, GRect rect);
 
 //! Mark the entire framebuffer as dirty
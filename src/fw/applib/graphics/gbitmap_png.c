@@ -5,10 +5,13 @@
 
 #include "applib/app_logging.h"
 #include "applib/applib_malloc.auto.h"
+#include "pbl/util/math.h"
 #include "system/logging.h"
 #include "syscall/syscall.h"
 #include "util/net.h"
 
+#include "tinflate.h"
+
 #define PNG_DECODE_ERROR "PNG decoding failed"
 #define PNG_MEMORY_ERROR "PNG memory allocation failed"
 #define PNG_FORMAT_ERROR "Unsupported PNG format, only PNG8 is supported!"
@@ -87,6 +90,32 @@ int32_t png_seek_chunk_in_resource_system(ResAppNum app_num, uint32_t resource_i
   return -1; // Error
 }
 
+// Sets the decoded pixels of a PNG as the data of the bitmap. 8-bit images are de-palettized in
+// place, as we don't support palettized bitdepths above 4, and their palette gets freed.
+static void prv_set_png_pixels(GBitmap *bitmap, uint8_t *pixels, uint32_t width, uint32_t height,
+                               uint32_t bpp, GColor8 *palette) {
+  // Get the GBitmap format based on the bit depth of the raw data
+  GBitmapFormat format = prv_get_format_for_bpp(bpp);
+
+  if (format == GBitmapFormat8Bit) {
+    for (uint32_t i = 0; i < width * height; i++) {
+      pixels[i] = palette[pixels[i]].argb;  // De-palettize the image data
+    }
+    applib_free(palette);  // Free the palette to avoid storing it as part of GBitmap
+    palette = NULL;
+  }
+
+  // Set the image or pixel data
+  gbitmap_set_data(bitmap, pixels, format,
+      gbitmap_format_get_row_size_bytes(width, format), true);
+  gbitmap_set_bounds(bitmap, (GRect){.origin = {0, 0}, .size = {width, height}});
+  bitmap->info.version = GBITMAP_VERSION_CURRENT;
+
+  if (palette) {
+    gbitmap_set_palette(bitmap, palette, true);
+  }
+}
+
 GBitmap* gbitmap_create_from_png_data(const uint8_t *png_data, size_t png_data_size) {
   GBitmap *bitmap = applib_type_malloc(GBitmap);
   if (bitmap) {
@@ -129,40 +158,209 @@ bool gbitmap_init_with_png_data(GBitmap *bitmap, const uint8_t *data, size_t dat
     goto cleanup;
   }
 
-  // Get the GBitmap format based on the bit depth of the raw data
-  GBitmapFormat format = prv_get_format_for_bpp(bpp);
+  prv_set_png_pixels(bitmap, upng_buffer, width, height, bpp, palette);
+  palette = NULL;
 
-  // Convert 8-bit palettized PNGs to raw ARGB color images in-place
-  // as we don't support palettized bitdepths above 4
-  if (format == GBitmapFormat8Bit) {
-    for (uint32_t i = 0; i < width * height; i++) {
-      upng_buffer[i] = palette[upng_buffer[i]].argb;  // De-palettize the image data
+  retval = true;
+
+cleanup:
+  if (!retval) {
+    // bitmap init failed, free palette
+    APP_LOG(APP_LOG_LEVEL_ERROR, PNG_LOAD_ERROR);
+    applib_free(palette);
+  }
+
+  // we are keeping the image data to avoid copying it
+  upng_destroy(upng, !retval);
+  return retval;
+}
+
+// Where the IDAT chunks of a PNG resource are read from while inflating them
+typedef struct PNGResourceStream {
+  ResAppNum app_num;
+  uint32_t resource_id;
+  uint32_t resource_size;
+  //! Offset of the next byte to read in the resource
+  uint32_t offset;
+  //! Bytes left to read in the current IDAT chunk
+  uint32_t chunk_remaining;
+  //! The image data is the consecutive IDAT chunks, anything after them isn't part of it
+  bool in_image_data;
+  bool failed;
+} PNGResourceStream;
+
+// Moves the stream to the data of the next IDAT chunk, returns false at the end of the image data
+static bool prv_stream_next_idat(PNGResourceStream *stream) {
+  struct png_chunk_marker {
+    uint32_t length;
+    uint32_t chunk_type;
+  } marker;
+
+  while (stream->offset + sizeof(marker) < stream->resource_size) {
+    if (sys_resource_load_range(stream->app_num, stream->resource_id, stream->offset,
+                                (uint8_t *)&marker, sizeof(marker)) != sizeof(marker)) {
+      stream->failed = true;
+      return false;
     }
-    applib_free(palette);  // Free the palette to avoid storing it as part of GBitmap
-    palette = NULL;
+    marker.length = ntohl(marker.length);
+    marker.chunk_type = ntohl(marker.chunk_type);
+    if (marker.chunk_type == CHUNK_IDAT) {
+      stream->offset += sizeof(marker);
+      stream->chunk_remaining = marker.length;
+      stream->in_image_data = true;
+      return true;
+    }
+    if (marker.chunk_type == CHUNK_IEND || stream->in_image_data) {
+      break;
+    }
+    stream->offset += CHUNK_META_SIZE + marker.length;
+  }
+  return false;
+}
+
+static unsigned int prv_stream_read(void *context, unsigned char *buffer, unsigned int length) {
+  PNGResourceStream *stream = context;
+  unsigned int total_read = 0;
+  while (total_read < length && !stream->failed) {
+    if (stream->chunk_remaining == 0) {
+      // Skip the CRC of the IDAT chunk we just read, the following chunk has to be an IDAT too
+      stream->offset += sizeof(uint32_t);
+      if (!prv_stream_next_idat(stream)) {
+        break;
+      }
+      continue;
+    }
+    const uint32_t num_bytes = MIN(length - total_read, stream->chunk_remaining);
+    if (sys_resource_load_range(stream->app_num, stream->resource_id, stream->offset,
+                                buffer + total_read, num_bytes) != num_bytes) {
+      stream->failed = true;
+      break;
+    }
+    stream->offset += num_bytes;
+    stream->chunk_remaining -= num_bytes;
+    total_read += num_bytes;
   }
+  return total_read;
+}
 
-  // Set the image or pixel data
-  gbitmap_set_data(bitmap, upng_buffer, format,
-      gbitmap_format_get_row_size_bytes(width, format), true);
-  gbitmap_set_bounds(bitmap, (GRect){.origin = {0, 0}, .size = {width, height}});
-  bitmap->info.version = GBITMAP_VERSION_CURRENT;
+// Inflates the image data of a PNG resource and unfilters it row by row, in place.
+// Returns the pixels with rows of (width * bpp + 7) / 8 bytes, NULL on failure.
+static uint8_t *prv_decode_png_resource_pixels(ResAppNum app_num, uint32_t resource_id,
+                                               uint32_t metadata_size, uint32_t width,
+                                               uint32_t height, uint32_t bpp) {
+  PNGResourceStream stream = {
+    .app_num = app_num,
+    .resource_id = resource_id,
+    .resource_size = sys_resource_size(app_num, resource_id),
+    .offset = metadata_size,
+  };
+  uint8_t zlib_header[2];
+  if (!prv_stream_next_idat(&stream) ||
+      prv_stream_read(&stream, zlib_header, sizeof(zlib_header)) != sizeof(zlib_header) ||
+      upng_check_zlib_header(zlib_header) != UPNG_EOK) {
+    return NULL;
+  }
 
-  if (palette) {
-    gbitmap_set_palette(bitmap, palette, true);
+  // Every row is inflated with the byte of its filter type in front of it
+  const uint32_t row_size_bytes = (width * bpp + 7) / 8;
+  const uint32_t inflated_size = (row_size_bytes + 1) * height;
+  uint8_t *pixels = applib_malloc(inflated_size);
+  if (!pixels) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, PNG_MEMORY_ERROR);
+    return NULL;
   }
 
+  unsigned int inflated_length = inflated_size;
+  if (tinflate_uncompress_stream(pixels, &inflated_length, prv_stream_read, &stream) != 0 ||
+      stream.failed || inflated_length != inflated_size) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, PNG_DECODE_ERROR);
+    applib_free(pixels);
+    return NULL;
+  }
+
+  // Unfiltered rows move up over the filter type bytes, so they never overtake the next row
+  const uint8_t *prev_row = NULL;
+  for (uint32_t y = 0; y < height; y++) {
+    const uint8_t *scanline = &pixels[y * (row_size_bytes + 1)];
+    uint8_t *row = &pixels[y * row_size_bytes];
+    if (upng_unfilter_scanline(row, scanline + 1, prev_row, bpp, row_size_bytes,
+                               scanline[0]) != UPNG_EOK) {
+      APP_LOG(APP_LOG_LEVEL_ERROR, PNG_DECODE_ERROR);
+      applib_free(pixels);
+      return NULL;
+    }
+    prev_row = row;
+  }
+  return pixels;
+}
+
+bool gbitmap_init_with_png_resource(GBitmap *bitmap, ResAppNum app_num, uint32_t resource_id) {
+  GColor8 *palette = NULL;
+  uint8_t *metadata = NULL;
+  bool retval = false;
+
+  // Only the chunks in front of the image data are loaded, the image data gets streamed.
+  // Seeking can start after SIG + IHDR
+  int32_t metadata_size = png_seek_chunk_in_resource_system(app_num, resource_id,
+                                                            PNG_HEADER_SIZE, false, NULL);
+  upng_t *upng = upng_create();
+  if (metadata_size < 0 || !upng) {
+    goto cleanup;
+  }
+  metadata_size += PNG_HEADER_SIZE;
+  metadata = applib_malloc(metadata_size);
+  if (!metadata ||
+      sys_resource_load_range(app_num, resource_id, 0, metadata, metadata_size) !=
+          (size_t)metadata_size) {
+    goto cleanup;
+  }
+  upng_load_bytes(upng, metadata, metadata_size);
+  upng_error upng_state = upng_decode_metadata(upng);
+  if (upng_state != UPNG_EOK) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, (upng_state == UPNG_ENOMEM) ? PNG_MEMORY_ERROR : PNG_DECODE_ERROR);
+    goto cleanup;
+  }
+
+  if (!gbitmap_png_is_format_supported(upng)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, PNG_FORMAT_ERROR);
+    goto cleanup;
+  }
+
+  // Create a color palette in GColor8 format from RGB24 + ALPHA8 PNG Palettes (or Grayscale)
+  if (gbitmap_png_load_palette(upng, &palette) == 0) {
+    goto cleanup;
+  }
+
+  const uint32_t width = upng_get_width(upng);
+  const uint32_t height = upng_get_height(upng);
+  const uint32_t bpp = upng_get_bpp(upng);
+
+  // The metadata isn't needed anymore, free it before the pixels get allocated
+  upng_destroy(upng, true);
+  upng = NULL;
+  applib_free(metadata);
+  metadata = NULL;
+
+  uint8_t *pixels = prv_decode_png_resource_pixels(app_num, resource_id, metadata_size,
+                                                   width, height, bpp);
+  if (!pixels) {
+    goto cleanup;
+  }
+
+  prv_set_png_pixels(bitmap, pixels, width, height, bpp, palette);
+  palette = NULL;
+
   retval = true;
 
 cleanup:
   if (!retval) {
-    // bitmap init failed, free palette
     APP_LOG(APP_LOG_LEVEL_ERROR, PNG_LOAD_ERROR);
     applib_free(palette);
   }
-
-  // we are keeping the image data to avoid copying it
-  upng_destroy(upng, !retval);
+  if (upng) {
+    upng_destroy(upng, true);
+  }
+  applib_free(metadata);
   return retval;
 }
 
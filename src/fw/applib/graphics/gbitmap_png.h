@@ -80,6 +80,16 @@ GBitmap* gbitmap_create_from_png_data(const uint8_t *png_data, size_t png_data_s
 
 bool gbitmap_init_with_png_data(GBitmap *bitmap, const uint8_t *data, size_t data_size);
 
+//! @internal
+//! Initializes a \ref GBitmap with a PNG resource, without loading the resource into memory.
+//! The compressed image data is read from the resource while it gets inflated straight into
+//! the pixel data of the bitmap, which is then unfiltered row by row in place.
+//! @param bitmap the bitmap to initialize
+//! @param app_num the app resource space from which to read the resource
+//! @param resource_id the PNG resource
+//! @return True if the bitmap could be initialized, False otherwise
+bool gbitmap_init_with_png_resource(GBitmap *bitmap, ResAppNum app_num, uint32_t resource_id);
+
 //!   @} // end addtogroup GraphicsTypes
 //! @} // end addtogroup Graphics
 
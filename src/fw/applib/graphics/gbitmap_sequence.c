@@ -66,6 +66,15 @@ static ALWAYS_INLINE void prv_gbitmap_sequence_blend_over(GColor8 src_color, GCo
   }
 }
 
+static bool prv_palette_is_opaque(const GColor8 *palette, uint8_t palette_entries) {
+  for (uint32_t i = 0; i < palette_entries; i++) {
+    if (palette[i].a != 3) {
+      return false;
+    }
+  }
+  return true;
+}
+
 GBitmapSequence *gbitmap_sequence_create_with_resource(uint32_t resource_id) {
   ResAppNum app_num = sys_get_current_resource_num();
   return gbitmap_sequence_create_with_resource_system(app_num, resource_id);
@@ -140,6 +149,9 @@ GBitmapSequence *gbitmap_sequence_create_with_resource_system(ResAppNum app_num,
       APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to load palette");
       goto cleanup;
     }
+    bitmap_sequence->png_decoder_data.palette_is_opaque =
+        prv_palette_is_opaque(bitmap_sequence->png_decoder_data.palette,
+                              bitmap_sequence->png_decoder_data.palette_entries);
   }
 
   bitmap_sequence->header_loaded = true;
@@ -159,8 +171,98 @@ bool gbitmap_sequence_restart(GBitmapSequence *bitmap_sequence) {
   return prv_gbitmap_sequence_restart(bitmap_sequence, true);
 }
 
+static void prv_frame_cache_destroy(GBitmapSequence *bitmap_sequence) {
+  GBitmapSequenceFrameCache *frame_cache = bitmap_sequence->png_decoder_data.frame_cache;
+  if (frame_cache) {
+    for (uint32_t i = 0; i < bitmap_sequence->total_frames; i++) {
+      applib_free(frame_cache->frames[i]);
+    }
+    applib_free(frame_cache);
+    bitmap_sequence->png_decoder_data.frame_cache = NULL;
+  }
+}
+
+bool gbitmap_sequence_set_frame_cache_budget(GBitmapSequence *bitmap_sequence,
+                                             uint32_t budget_bytes) {
+  if (!bitmap_sequence || !bitmap_sequence->header_loaded ||
+      (bitmap_sequence->png_decoder_data.palette_entries == 0)) {
+    return false;
+  }
+
+  GBitmapSequenceFrameCache *frame_cache = bitmap_sequence->png_decoder_data.frame_cache;
+  if (frame_cache && (budget_bytes >= frame_cache->used_bytes)) {
+    frame_cache->budget_bytes = budget_bytes;
+    return true;
+  }
+  // Shrinking below what's already cached starts over
+  prv_frame_cache_destroy(bitmap_sequence);
+  if (budget_bytes == 0) {
+    return true;
+  }
+
+  const size_t cache_size = sizeof(GBitmapSequenceFrameCache) +
+                            (bitmap_sequence->total_frames * sizeof(GBitmapSequenceFrame *));
+  if (cache_size > budget_bytes) {
+    return false;
+  }
+  frame_cache = applib_zalloc(cache_size);
+  if (frame_cache == NULL) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, APNG_MEMORY_ERROR);
+    return false;
+  }
+  frame_cache->budget_bytes = budget_bytes;
+  frame_cache->used_bytes = cache_size;
+  bitmap_sequence->png_decoder_data.frame_cache = frame_cache;
+  return true;
+}
+
+//! Keeps a copy of a decoded frame if the sequence is going to loop and the frame fits the budget
+static void prv_frame_cache_add(GBitmapSequence *bitmap_sequence, uint32_t frame_index,
+                                uint32_t chunk_bytes, const apng_fctl *fctl, bool has_fctl,
+                                const uint8_t *pixels, size_t pixels_size) {
+  GBitmapSequenceFrameCache *frame_cache = bitmap_sequence->png_decoder_data.frame_cache;
+  const bool will_loop = (bitmap_sequence->play_count == PLAY_COUNT_INFINITE) ||
+                         (bitmap_sequence->play_index + 1 < bitmap_sequence->play_count);
+  if (!frame_cache || !will_loop || (frame_index >= bitmap_sequence->total_frames) ||
+      frame_cache->frames[frame_index]) {
+    return;
+  }
+
+  const size_t frame_size = sizeof(GBitmapSequenceFrame) + pixels_size;
+  if (frame_cache->used_bytes + frame_size > frame_cache->budget_bytes) {
+    return;
+  }
+  GBitmapSequenceFrame *frame = applib_malloc(frame_size);
+  if (frame == NULL) {
+    // Not an error, the frame just gets decoded again on the next loop
+    return;
+  }
+  frame->fctl = *fctl;
+  frame->has_fctl = has_fctl;
+  frame->chunk_bytes = chunk_bytes;
+  memcpy(frame->pixels, pixels, pixels_size);
+  frame_cache->frames[frame_index] = frame;
+  frame_cache->used_bytes += frame_size;
+}
+
+static const GBitmapSequenceFrame *prv_frame_cache_get(GBitmapSequence *bitmap_sequence,
+                                                       uint32_t frame_index) {
+  GBitmapSequenceFrameCache *frame_cache = bitmap_sequence->png_decoder_data.frame_cache;
+  if (!frame_cache || (frame_index >= bitmap_sequence->total_frames)) {
+    return NULL;
+  }
+  const GBitmapSequenceFrame *frame = frame_cache->frames[frame_index];
+  if (frame) {
+    frame_cache->stats.hits++;
+  } else {
+    frame_cache->stats.misses++;
+  }
+  return frame;
+}
+
 void gbitmap_sequence_destroy(GBitmapSequence *bitmap_sequence) {
   if (bitmap_sequence) {
+    prv_frame_cache_destroy(bitmap_sequence);
     upng_destroy(bitmap_sequence->png_decoder_data.upng, true);
     applib_free(bitmap_sequence->png_decoder_data.palette);
     applib_free(bitmap_sequence);
@@ -191,6 +293,34 @@ static void prv_set_pixel_in_row(uint8_t *row_data, GBitmapFormat bitmap_format,
   }
 }
 
+//! Blends the palette indices of a frame row into [x_begin, x_end) of dst, which points at the
+//! bitmap pixel the frame row starts at
+static void prv_blend_palette_span(GColor8 *dst, const uint8_t *src_row, uint32_t bpp,
+                                   int32_t x_begin, int32_t x_end, const GColor8 *palette,
+                                   bool blend_over) {
+  if (bpp == 8) {
+    if (blend_over) {
+      for (int32_t x = x_begin; x < x_end; x++) {
+        prv_gbitmap_sequence_blend_over(palette[src_row[x]], &dst[x]);
+      }
+    } else {
+      for (int32_t x = x_begin; x < x_end; x++) {
+        dst[x] = palette[src_row[x]];
+      }
+    }
+    return;
+  }
+
+  for (int32_t x = x_begin; x < x_end; x++) {
+    const GColor8 src = palette[raw_image_get_value_for_bitdepth(src_row, x, 0, 0, bpp)];
+    if (blend_over) {
+      prv_gbitmap_sequence_blend_over(src, &dst[x]);
+    } else {
+      dst[x] = src;
+    }
+  }
+}
+
 bool gbitmap_sequence_update_bitmap_next_frame(GBitmapSequence *bitmap_sequence,
                                                GBitmap *bitmap, uint32_t *delay_ms) {
   bool retval = false;
@@ -234,44 +364,68 @@ bool gbitmap_sequence_update_bitmap_next_frame(GBitmapSequence *bitmap_sequence,
     }
   }
 
-  const int32_t metadata_bytes =
-     png_seek_chunk_in_resource(bitmap_sequence->resource_id,
-                                png_decoder_data->read_cursor, true, NULL);
+  const uint32_t width = bitmap_sequence->bitmap_size.w;
+  const uint32_t height = bitmap_sequence->bitmap_size.h;
+  const uint32_t bpp = upng_get_bpp(upng);
 
-  if (metadata_bytes <= 0) {
-    goto cleanup;
-  }
+  apng_fctl fctl = {0}; // Defaults work for IDAT frame without fctl data
+  bool has_fctl;
+  const uint8_t *frame_buffer;
+
+  const GBitmapSequenceFrame *cached_frame =
+      prv_frame_cache_get(bitmap_sequence, bitmap_sequence->current_frame);
+  if (cached_frame) {
+    png_decoder_data->read_cursor += cached_frame->chunk_bytes;
+    fctl = cached_frame->fctl;
+    has_fctl = cached_frame->has_fctl;
+    frame_buffer = cached_frame->pixels;
+  } else {
+    const int32_t metadata_bytes =
+       png_seek_chunk_in_resource(bitmap_sequence->resource_id,
+                                  png_decoder_data->read_cursor, true, NULL);
 
-  buffer = applib_zalloc(metadata_bytes);
-  if (buffer == NULL) {
-    goto cleanup;
-  }
+    if (metadata_bytes <= 0) {
+      goto cleanup;
+    }
 
-  ResAppNum app_num = sys_get_current_resource_num();
-  const size_t bytes_read = sys_resource_load_range(
-      app_num, bitmap_sequence->resource_id,
-      png_decoder_data->read_cursor, buffer, metadata_bytes);
+    buffer = applib_zalloc(metadata_bytes);
+    if (buffer == NULL) {
+      goto cleanup;
+    }
 
-  if (bytes_read != (size_t)metadata_bytes) {
-    goto cleanup;
-  }
+    ResAppNum app_num = sys_get_current_resource_num();
+    const size_t bytes_read = sys_resource_load_range(
+        app_num, bitmap_sequence->resource_id,
+        png_decoder_data->read_cursor, buffer, metadata_bytes);
 
-  png_decoder_data->read_cursor += metadata_bytes;
+    if (bytes_read != (size_t)metadata_bytes) {
+      goto cleanup;
+    }
 
-  upng_load_bytes(upng, buffer, metadata_bytes);
-  upng_error upng_state = upng_decode_image(upng);
-  if (upng_state != UPNG_EOK) {
-    APP_LOG(APP_LOG_LEVEL_ERROR,
-            (upng_state == UPNG_ENOMEM) ? APNG_MEMORY_ERROR : APNG_DECODE_ERROR);
-    goto cleanup;
+    png_decoder_data->read_cursor += metadata_bytes;
+
+    upng_load_bytes(upng, buffer, metadata_bytes);
+    upng_error upng_state = upng_decode_image(upng);
+    if (upng_state != UPNG_EOK) {
+      APP_LOG(APP_LOG_LEVEL_ERROR,
+              (upng_state == UPNG_ENOMEM) ? APNG_MEMORY_ERROR : APNG_DECODE_ERROR);
+      goto cleanup;
+    }
+    applib_free(buffer);
+    buffer = NULL;
+
+    has_fctl = upng_get_apng_fctl(upng, &fctl);
+    frame_buffer = upng_get_buffer(upng);
+
+    const uint32_t frame_width = has_fctl ? fctl.width : width;
+    const uint32_t frame_height = has_fctl ? fctl.height : height;
+    prv_frame_cache_add(bitmap_sequence, bitmap_sequence->current_frame, metadata_bytes,
+                        &fctl, has_fctl, frame_buffer,
+                        ((frame_width * bpp + 7) / 8) * frame_height);
   }
-  applib_free(buffer);
 
   bitmap_sequence->current_frame++;
 
-  const uint32_t width = bitmap_sequence->bitmap_size.w;
-  const uint32_t height = bitmap_sequence->bitmap_size.h;
-
   const bool bitmap_supports_transparency = (bitmap_format != GBitmapFormat1Bit);
 
   // DISPOSE_OP_BACKGROUND sets the background to black with transparency (0x00)
@@ -293,10 +447,8 @@ bool gbitmap_sequence_update_bitmap_next_frame(GBitmapSequence *bitmap_sequence,
     }
   }
 
-  apng_fctl fctl = {0}; // Defaults work for IDAT frame without fctl data
-
   // If this frame doesn't have fctl, use the full width & height
-  if (!upng_get_apng_fctl(upng, &fctl)) {
+  if (!has_fctl) {
     fctl.width = width;
     fctl.height = height;
     // As a PNG image is only a single frame, display it forever
@@ -319,35 +471,26 @@ bool gbitmap_sequence_update_bitmap_next_frame(GBitmapSequence *bitmap_sequence,
     *delay_ms = bitmap_sequence->current_frame_delay_ms;
   }
 
-  uint32_t bpp = upng_get_bpp(upng);
   upng_format png_format = upng_get_format(upng);
-  uint8_t *upng_buffer = (uint8_t*)upng_get_buffer(upng);
 
   // Byte aligned rows for image at bpp
   uint16_t row_stride_bytes = (fctl.width *  bpp + 7) / 8;
 
   if (png_format >= UPNG_INDEXED1 && png_format <= UPNG_INDEXED8) {
     const GColor8 *palette = png_decoder_data->palette;
+    // Blending over fully opaque colors just copies them
+    const bool blend_over = (fctl.blend_op == APNG_BLEND_OP_OVER) &&
+                            !png_decoder_data->palette_is_opaque;
 
     for (uint32_t y = 0; y < fctl.height; y++) {
       const uint16_t corrected_dst_y = fctl.y_offset + y + bitmap->bounds.origin.y;
       const GBitmapDataRowInfo row_info = gbitmap_get_data_row_info(bitmap, corrected_dst_y);
       int16_t delta_x = fctl.x_offset + bitmap->bounds.origin.x;
-      for (int32_t x = MAX(0, row_info.min_x - delta_x);
-           x < MIN((int32_t)fctl.width, row_info.max_x - delta_x + 1);
-           x++) {
-        const uint32_t corrected_dst_x = x + delta_x;
-        const uint8_t palette_index = raw_image_get_value_for_bitdepth(upng_buffer, x, y,
-            row_stride_bytes, bpp);
-
-        const GColor8 src = palette[palette_index];
-        GColor8 *const dst = (GColor8 *)(row_info.data + corrected_dst_x);
-        if (fctl.blend_op == APNG_BLEND_OP_OVER) {
-          prv_gbitmap_sequence_blend_over(src, dst);
-        } else {
-          *dst = src;
-        }
-      }
+      prv_blend_palette_span((GColor8 *)(row_info.data + delta_x),
+                             &frame_buffer[y * row_stride_bytes], bpp,
+                             MAX(0, row_info.min_x - delta_x),
+                             MIN((int32_t)fctl.width, row_info.max_x - delta_x + 1),
+                             palette, blend_over);
     }
   } else if (png_format >= UPNG_LUMINANCE1 && png_format <= UPNG_LUMINANCE8) {
     const int32_t transparent_gray = gbitmap_png_get_transparent_gray_value(upng);
@@ -365,7 +508,7 @@ bool gbitmap_sequence_update_bitmap_next_frame(GBitmapSequence *bitmap_sequence,
            x++) {
 
         const uint32_t corrected_dst_x = x + delta_x;
-        uint8_t channel = raw_image_get_value_for_bitdepth(upng_buffer, x, y,
+        uint8_t channel = raw_image_get_value_for_bitdepth(frame_buffer, x, y,
                                                            row_stride_bytes, bpp);
         if (transparent_gray >= 0 && channel == transparent_gray) {
           // Grayscale only has fully transparent, so only modify pixels
@@ -10,16 +10,36 @@
 #include <stdbool.h>
 #include <string.h>
 
+//! A frame of a palettized sequence as it was decoded, so later loops don't decode it again
+typedef struct GBitmapSequenceFrame {
+  apng_fctl fctl;
+  bool has_fctl;
+  uint32_t chunk_bytes; // size of the frame's chunks in the resource, to advance the read_cursor
+  uint8_t pixels[];     // palette indices in byte aligned rows, at the bit depth of the image
+} GBitmapSequenceFrame;
+
+typedef struct GBitmapSequenceFrameCache {
+  uint32_t budget_bytes;
+  uint32_t used_bytes; // includes the cache itself
+  struct {
+    uint32_t hits;
+    uint32_t misses;
+  } stats;
+  GBitmapSequenceFrame *frames[]; // one entry per frame of the sequence, NULL if not cached
+} GBitmapSequenceFrameCache;
+
 typedef struct GBitmapSequencePNGDecoderData {
   upng_t *upng;
   size_t read_cursor; // relative to file start, advanced to the control chunk of the next frame
   GColor8 *palette;   // required for palettized images (rgba)
   uint8_t palette_entries;
+  bool palette_is_opaque; // blending over is the same as copying the source
   apng_dispose_ops last_dispose_op;
   uint32_t previous_xoffset;
   uint32_t previous_yoffset;
   uint32_t previous_width;
   uint32_t previous_height;
+  GBitmapSequenceFrameCache *frame_cache; // NULL unless a budget was set
 } GBitmapSequencePNGDecoderData;
 
 typedef struct {
@@ -60,6 +80,17 @@ GBitmapSequence *gbitmap_sequence_create_with_resource_system(ResAppNum app_num,
 //! @param bitmap_sequence Pointer to the bitmap sequence to free (delete)
 void gbitmap_sequence_destroy(GBitmapSequence *bitmap_sequence);
 
+//! @internal
+//! Keeps the decoded frames of a looping sequence on the app heap, so the loops after the first
+//! one blend them without reading and inflating the resource again. Frames are cached in the
+//! order they are decoded until budget_bytes are used up. Only palettized sequences are cached.
+//! @param bitmap_sequence Pointer to loaded bitmap sequence
+//! @param budget_bytes Heap memory the cached frames may use, 0 frees them and stops caching
+//! @return True if the budget was applied, false otherwise (includes sequences that aren't
+//! palettized and out of memory errors)
+bool gbitmap_sequence_set_frame_cache_budget(GBitmapSequence *bitmap_sequence,
+                                             uint32_t budget_bytes);
+
 //! Restarts the GBitmapSequence to the first frame \ref gbitmap_sequence_update_bitmap_next_frame
 //! @param bitmap_sequence Pointer to loaded bitmap sequence
 //! @return True if sequence was restarted, false otherwise
@@ -0,0 +1,385 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "gdraw_command_prepared.h"
+#include "gdraw_command_private.h"
+
+#include "applib/applib_malloc.auto.h"
+#include "applib/graphics/gpath.h"
+#include "pbl/util/math.h"
+
+#include <string.h>
+
+//! Room around the points of a command for the antialiased edges of its fill and stroke
+#define PREPARED_BOUNDS_MARGIN (2)
+
+GDrawCommandPrepared *gdraw_command_prepared_create(size_t max_size_bytes) {
+  GDrawCommandPrepared *prepared = applib_type_zalloc(GDrawCommandPrepared);
+  if (prepared) {
+    prepared->max_size_bytes = max_size_bytes;
+  }
+  return prepared;
+}
+
+void gdraw_command_prepared_invalidate(GDrawCommandPrepared *prepared) {
+  if (!prepared) {
+    return;
+  }
+  applib_free(prepared->commands);
+  prepared->commands = NULL;
+  prepared->points = NULL;
+  prepared->spans = NULL;
+  prepared->is_prepared = false;
+  prepared->list = NULL;
+}
+
+void gdraw_command_prepared_destroy(GDrawCommandPrepared *prepared) {
+  gdraw_command_prepared_invalidate(prepared);
+  applib_free(prepared);
+}
+
+////////////////////
+// preparing
+
+//! FNV-1a over the data of the list, any change to a command prepares the list again
+static uint32_t prv_hash_list(GDrawCommandList *list) {
+  const uint8_t *data = (const uint8_t *)list;
+  const size_t size = gdraw_command_list_get_data_size(list);
+  uint32_t hash = 2166136261;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 16777619;
+  }
+  return hash;
+}
+
+static bool prv_command_has_fill(const GDrawCommand *command) {
+  return (!command->hidden && (command->type != GDrawCommandTypeCircle) &&
+          (command->num_points > 1) && (command->fill_color.a != 0));
+}
+
+//! The points of the command as drawn: scaled and, for precise paths, rounded down to pixels
+static void prv_get_drawn_points(const GDrawCommand *command, GSize from, GSize to,
+                                 GPoint *points_out) {
+  for (uint16_t i = 0; i < command->num_points; i++) {
+    const GPoint point = gpoint_scale_by_gsize(command->points[i], from, to);
+    if (command->type == GDrawCommandTypePrecisePath) {
+      const GPointPrecise precise_point = { .x.raw_value = point.x, .y.raw_value = point.y };
+      points_out[i] = GPointFromGPointPrecise(precise_point);
+    } else {
+      points_out[i] = point;
+    }
+  }
+}
+
+typedef struct {
+  GPathFilledSpan *spans;
+  uint32_t max_spans;
+  uint32_t num_spans;
+} SpanRecorder;
+
+static void prv_record_span_cb(GContext *ctx, int16_t y,
+                               Fixed_S16_3 x_range_begin, Fixed_S16_3 x_range_end,
+                               Fixed_S16_3 delta_begin, Fixed_S16_3 delta_end, void *user_data) {
+  SpanRecorder *recorder = user_data;
+  if (recorder->num_spans < recorder->max_spans) {
+    recorder->spans[recorder->num_spans] = (GPathFilledSpan) {
+      .y = y,
+      .x_range_begin = x_range_begin,
+      .x_range_end = x_range_end,
+      .delta_begin = delta_begin,
+      .delta_end = delta_end,
+    };
+  }
+  recorder->num_spans++;
+}
+
+typedef struct {
+  GContext *ctx;
+  GDrawCommandPrepared *prepared;
+  //! The drawn points of the current command
+  GPoint *drawn_points;
+  uint32_t num_points;
+  SpanRecorder recorder;
+} PrepareCBData;
+
+//! Counts the scanlines of the fills, when the prepared form has no room for them yet
+static bool prv_count_spans_cb(GDrawCommand *command, uint32_t index, void *context) {
+  PrepareCBData *data = context;
+  if (prv_command_has_fill(command)) {
+    prv_get_drawn_points(command, data->prepared->from, data->prepared->to, data->drawn_points);
+    GPath path = {
+      .num_points = command->num_points,
+      .points = data->drawn_points,
+    };
+    gpath_fill_spans_with_cb(data->ctx, &path, prv_record_span_cb, &data->recorder);
+  }
+  return true;
+}
+
+static bool prv_prepare_command_cb(GDrawCommand *command, uint32_t index, void *context) {
+  PrepareCBData *data = context;
+  GDrawCommandPrepared *prepared = data->prepared;
+  GDrawCommandPreparedCommand *prepared_command = &prepared->commands[index];
+  *prepared_command = (GDrawCommandPreparedCommand) {
+    .first_point = data->num_points,
+    .first_span = data->recorder.num_spans,
+  };
+
+  // Points are scaled like gdraw_command_list_scale() does, precise ones included
+  for (uint16_t i = 0; i < command->num_points; i++) {
+    prepared->points[data->num_points++] =
+        gpoint_scale_by_gsize(command->points[i], prepared->from, prepared->to);
+  }
+  if (command->num_points == 0) {
+    return true;
+  }
+
+  prv_get_drawn_points(command, prepared->from, prepared->to, data->drawn_points);
+  int32_t min_x, max_x, min_y, max_y;
+  min_x = max_x = data->drawn_points[0].x;
+  min_y = max_y = data->drawn_points[0].y;
+  for (uint16_t i = 1; i < command->num_points; i++) {
+    min_x = MIN(min_x, data->drawn_points[i].x);
+    max_x = MAX(max_x, data->drawn_points[i].x);
+    min_y = MIN(min_y, data->drawn_points[i].y);
+    max_y = MAX(max_y, data->drawn_points[i].y);
+  }
+  int32_t margin = PREPARED_BOUNDS_MARGIN + command->stroke_width;
+  if (command->type == GDrawCommandTypeCircle) {
+    margin += command->radius;
+  }
+  prepared_command->min_x = CLIP(min_x - margin, INT16_MIN, INT16_MAX);
+  prepared_command->max_x = CLIP(max_x + margin, INT16_MIN, INT16_MAX);
+  prepared_command->min_y = CLIP(min_y - margin, INT16_MIN, INT16_MAX);
+  prepared_command->max_y = CLIP(max_y + margin, INT16_MIN, INT16_MAX);
+
+  if (prv_command_has_fill(command)) {
+    GPath path = {
+      .num_points = command->num_points,
+      .points = data->drawn_points,
+    };
+    gpath_fill_spans_with_cb(data->ctx, &path, prv_record_span_cb, &data->recorder);
+  }
+  prepared_command->num_spans = data->recorder.num_spans - prepared_command->first_span;
+  return true;
+}
+
+static bool prv_iterate_max_num_points(GDrawCommand *command, uint32_t index, void *context) {
+  uint16_t *max_num_points = context;
+  *max_num_points = MAX(*max_num_points, command->num_points);
+  return true;
+}
+
+//! @return whether the list fit into the memory of the prepared form
+static bool prv_prepare(GContext *ctx, GDrawCommandList *list, GDrawCommandPrepared *prepared) {
+  uint16_t max_num_points = 0;
+  gdraw_command_list_iterate(list, prv_iterate_max_num_points, &max_num_points);
+  const size_t num_points = gdraw_command_list_get_num_points(list);
+
+  PrepareCBData data = {
+    .ctx = ctx,
+    .prepared = prepared,
+    .drawn_points = applib_malloc(MAX(max_num_points, 1) * sizeof(GPoint)),
+  };
+  if (!data.drawn_points) {
+    return false;
+  }
+
+  gdraw_command_list_iterate(list, prv_count_spans_cb, &data);
+  const uint32_t num_spans = data.recorder.num_spans;
+  const size_t size = (list->num_commands * sizeof(GDrawCommandPreparedCommand)) +
+                      (num_points * sizeof(GPoint)) + (num_spans * sizeof(GPathFilledSpan));
+  bool success = false;
+  if (size > prepared->max_size_bytes) {
+    goto cleanup;
+  }
+
+  prepared->commands = applib_malloc(size);
+  if (!prepared->commands) {
+    goto cleanup;
+  }
+  prepared->points = (GPoint *)&prepared->commands[list->num_commands];
+  prepared->spans = (GPathFilledSpan *)&prepared->points[num_points];
+
+  data.recorder = (SpanRecorder) {
+    .spans = prepared->spans,
+    .max_spans = num_spans,
+  };
+  gdraw_command_list_iterate(list, prv_prepare_command_cb, &data);
+  success = true;
+
+cleanup:
+  applib_free(data.drawn_points);
+  return success;
+}
+
+////////////////////
+// drawing
+
+typedef struct {
+  GContext *ctx;
+  const GDrawCommandPrepared *prepared;
+  //! The clip box in drawing_box coordinates
+  int16_t clip_min_x;
+  int16_t clip_min_y;
+  int16_t clip_max_x;
+  int16_t clip_max_y;
+} DrawPreparedCBData;
+
+static bool prv_draw_prepared_command_cb(GDrawCommand *command, uint32_t index, void *context) {
+  DrawPreparedCBData *data = context;
+  const GDrawCommandPreparedCommand *prepared_command = &data->prepared->commands[index];
+  if (command->hidden || (command->num_points == 0) ||
+      (prepared_command->max_x < data->clip_min_x) ||
+      (prepared_command->min_x > data->clip_max_x) ||
+      (prepared_command->max_y < data->clip_min_y) ||
+      (prepared_command->min_y > data->clip_max_y)) {
+    return true;
+  }
+
+  GContext *ctx = data->ctx;
+  GPoint *points = &data->prepared->points[prepared_command->first_point];
+  const bool has_stroke = ((command->stroke_color.a != 0) && (command->stroke_width > 0));
+  if (has_stroke) {
+    graphics_context_set_stroke_color(ctx, command->stroke_color);
+    graphics_context_set_stroke_width(ctx, command->stroke_width);
+  }
+
+  if (command->type == GDrawCommandTypeCircle) {
+    // same as drawing the command itself
+    if ((command->fill_color.a != 0) && (command->radius > 0)) {
+      graphics_context_set_fill_color(ctx, command->fill_color);
+      graphics_fill_circle(ctx, points[0], command->radius);
+    }
+    if (has_stroke) {
+      graphics_draw_circle(ctx, points[0], command->radius);
+    }
+    return true;
+  }
+
+  if (command->num_points <= 1) {
+    return true;
+  }
+  if (prv_command_has_fill(command)) {
+    graphics_context_set_fill_color(ctx, command->fill_color);
+    gpath_draw_filled_spans(ctx, &data->prepared->spans[prepared_command->first_span],
+                            prepared_command->num_spans);
+  }
+  if (has_stroke) {
+    if (command->type == GDrawCommandTypePrecisePath) {
+      gpath_draw_outline_precise_internal(ctx, (GPointPrecise *)points, command->num_points,
+                                          command->path_open);
+    } else {
+      GPath path = {
+        .num_points = command->num_points,
+        .points = points,
+      };
+      gpath_draw_stroke(ctx, &path, command->path_open);
+    }
+  }
+  return true;
+}
+
+typedef struct {
+  GDrawCommandProcessor processor;
+  GSize from;
+  GSize to;
+} ScaleProcessor;
+
+static void prv_scale_processed_command(GDrawCommandProcessor *processor,
+                                        GDrawCommand *processed_command,
+                                        size_t processed_command_max_size,
+                                        const GDrawCommandList *list,
+                                        const GDrawCommand *command) {
+  ScaleProcessor *scale = (ScaleProcessor *)processor;
+  for (uint16_t i = 0; i < processed_command->num_points; i++) {
+    processed_command->points[i] =
+        gpoint_scale_by_gsize(processed_command->points[i], scale->from, scale->to);
+  }
+}
+
+//! Draws the list scaled without a prepared form
+static void prv_draw_unprepared(GContext *ctx, GDrawCommandList *list, GSize from, GSize to) {
+  if (gsize_equal(&from, &to)) {
+    gdraw_command_list_draw(ctx, list);
+    return;
+  }
+  ScaleProcessor scale = {
+    .processor.command = prv_scale_processed_command,
+    .from = from,
+    .to = to,
+  };
+  gdraw_command_list_draw_processed(ctx, list, &scale.processor);
+}
+
+void gdraw_command_list_draw_prepared(GContext *ctx, GDrawCommandList *list, GSize from,
+                                      GSize to, GDrawCommandPrepared *prepared) {
+  if (!ctx || !list) {
+    return;
+  }
+  if (!prepared) {
+    prv_draw_unprepared(ctx, list, from, to);
+    return;
+  }
+
+  const bool antialiased = PBL_IF_COLOR_ELSE(ctx->draw_state.antialiased, false);
+  const uint32_t list_hash = prv_hash_list(list);
+  const bool is_same_list = ((prepared->list == list) && (prepared->list_hash == list_hash) &&
+                             gsize_equal(&prepared->from, &from) &&
+                             gsize_equal(&prepared->to, &to) &&
+                             (prepared->antialiased == antialiased));
+  if (!is_same_list) {
+    gdraw_command_prepared_invalidate(prepared);
+    // Remembered even when the list doesn't fit, so it isn't tried again on every draw
+    prepared->list = list;
+    prepared->list_hash = list_hash;
+    prepared->from = from;
+    prepared->to = to;
+    prepared->antialiased = antialiased;
+    prepared->is_prepared = prv_prepare(ctx, list, prepared);
+    prepared->stats.prepares++;
+  }
+
+  if (!prepared->is_prepared) {
+    prepared->stats.fallbacks++;
+    prv_draw_unprepared(ctx, list, from, to);
+    return;
+  }
+
+  prepared->stats.hits++;
+  const GDrawState *draw_state = &ctx->draw_state;
+  const int16_t clip_min_x = draw_state->clip_box.origin.x - draw_state->drawing_box.origin.x;
+  const int16_t clip_min_y = draw_state->clip_box.origin.y - draw_state->drawing_box.origin.y;
+  DrawPreparedCBData data = {
+    .ctx = ctx,
+    .prepared = prepared,
+    .clip_min_x = clip_min_x,
+    .clip_min_y = clip_min_y,
+    .clip_max_x = clip_min_x + draw_state->clip_box.size.w,
+    .clip_max_y = clip_min_y + draw_state->clip_box.size.h,
+  };
+  gdraw_command_list_iterate(list, prv_draw_prepared_command_cb, &data);
+}
+
+void gdraw_command_image_draw_prepared(GContext *ctx, GDrawCommandImage *image, GPoint offset,
+                                       GSize size, GDrawCommandPrepared *prepared) {
+  if (!ctx || !image) {
+    return;
+  }
+
+  graphics_context_move_draw_box(ctx, offset);
+  gdraw_command_list_draw_prepared(ctx, &image->command_list, image->size, size, prepared);
+  graphics_context_move_draw_box(ctx, GPoint(-offset.x, -offset.y));
+}
+
+void gdraw_command_frame_draw_prepared(GContext *ctx, GDrawCommandSequence *sequence,
+                                       GDrawCommandFrame *frame, GPoint offset, GSize size,
+                                       GDrawCommandPrepared *prepared) {
+  if (!ctx || !sequence || !frame) {
+    return;
+  }
+
+  graphics_context_move_draw_box(ctx, offset);
+  gdraw_command_list_draw_prepared(ctx, &frame->command_list, sequence->size, size, prepared);
+  graphics_context_move_draw_box(ctx, GPoint(-offset.x, -offset.y));
+}
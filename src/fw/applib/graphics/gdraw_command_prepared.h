@@ -0,0 +1,93 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#pragma once
+
+#include "applib/graphics/gdraw_command_frame.h"
+#include "applib/graphics/gdraw_command_image.h"
+#include "applib/graphics/gdraw_command_list.h"
+#include "applib/graphics/gpath.h"
+#include "applib/graphics/graphics.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//! @internal
+//! What a command of a prepared list draws
+typedef struct GDrawCommandPreparedCommand {
+  //! Everything the command can draw into, in drawing_box coordinates, to leave out the commands
+  //! outside of the clip box
+  int16_t min_x;
+  int16_t min_y;
+  int16_t max_x;
+  int16_t max_y;
+  //! Index of the first of its scaled points
+  uint32_t first_point;
+  //! The scanlines of its fill
+  uint32_t first_span;
+  uint32_t num_spans;
+} GDrawCommandPreparedCommand;
+
+//! @internal
+//! The prepared form of a draw command list: the points of its commands scaled to the size the
+//! list is drawn at, the bounds of the commands and the scanlines of their fills. Drawing through
+//! it leaves only the drawing itself to be done, for the commands the clip box touches.
+//! The list is prepared again whenever its data, the size or the antialiasing mode change. The
+//! scanlines are relative to the drawing_box, so drawing the list at another offset or under
+//! another clip box doesn't have to prepare it again.
+typedef struct GDrawCommandPrepared {
+  //! What the list was prepared for
+  const GDrawCommandList *list;
+  uint32_t list_hash;
+  GSize from;
+  GSize to;
+  bool antialiased;
+  //! Whether the commands, points and spans below are valid
+  bool is_prepared;
+  //! Lists needing more than max_size_bytes are drawn like they'd be without a prepared form
+  size_t max_size_bytes;
+  //! The commands, their points and spans share one allocation
+  GDrawCommandPreparedCommand *commands;
+  GPoint *points;
+  GPathFilledSpan *spans;
+  struct {
+    //! Lists drawn through their prepared form
+    uint32_t hits;
+    //! Lists prepared
+    uint32_t prepares;
+    //! Lists drawn without it, as they were too large to be prepared
+    uint32_t fallbacks;
+  } stats;
+} GDrawCommandPrepared;
+
+//! @internal
+//! Creates an empty prepared form, lists are prepared as they get drawn through it
+//! @param max_size_bytes Most memory the prepared form of a list may take up
+GDrawCommandPrepared *gdraw_command_prepared_create(size_t max_size_bytes);
+
+//! @internal
+void gdraw_command_prepared_destroy(GDrawCommandPrepared *prepared);
+
+//! @internal
+//! Drops the prepared list, the next draw prepares it again
+void gdraw_command_prepared_invalidate(GDrawCommandPrepared *prepared);
+
+//! @internal
+//! Draws a list scaled from one size to another, as \ref gdraw_command_list_scale() followed by
+//! \ref gdraw_command_list_draw() would, without changing the list.
+void gdraw_command_list_draw_prepared(GContext *ctx, GDrawCommandList *list, GSize from,
+                                      GSize to, GDrawCommandPrepared *prepared);
+
+//! @internal
+//! Draws an image scaled to the given size through its prepared form
+//! @see gdraw_command_image_draw
+void gdraw_command_image_draw_prepared(GContext *ctx, GDrawCommandImage *image, GPoint offset,
+                                       GSize size, GDrawCommandPrepared *prepared);
+
+//! @internal
+//! Draws a frame scaled to the given size through its prepared form
+//! @see gdraw_command_frame_draw
+void gdraw_command_frame_draw_prepared(GContext *ctx, GDrawCommandSequence *sequence,
+                                       GDrawCommandFrame *frame, GPoint offset, GSize size,
+                                       GDrawCommandPrepared *prepared);
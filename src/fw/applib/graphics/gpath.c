@@ -22,10 +22,47 @@
 void prv_fill_path_with_cb_aa(GContext *ctx, GPath *path, GPathDrawFilledCallback cb,
                               void *user_data);
 
-typedef struct Intersection {
-  Fixed_S16_3 x;
+//! An edge of the path that isn't horizontal, as it crosses the scanlines from top to bottom.
+//! Its x on a scanline is stepped from the one on the previous scanline.
+typedef struct GPathEdge {
+  //! First and last scanline the edge is counted on
+  int16_t y_begin;
+  int16_t y_end;
+  //! The start of the edge in the direction of the path, x is interpolated from there. When
+  //! antialiasing x is a Fixed_S16_3 raw value.
+  int16_t x_origin;
+  int16_t y_origin;
+  //! x on the current scanline
+  int16_t x;
+  //! Position of the edge in the path
+  uint16_t index;
+  bool is_down;
+  bool is_x_decreasing;
+  //! From one scanline to the next x moves by x_step, and by x_carry as well whenever the
+  //! remainder adds up to dy. That keeps x where interpolating it from x_origin rounds to.
+  int16_t x_carry;
+  int32_t x_step;
+  int32_t remainder;
+  int32_t remainder_step;
+  int32_t dx;
+  int32_t dy;
+  //! When antialiasing: the gradient of the edge, the one used on the current scanline and the
+  //! range of x the gradient has to stay within
   Fixed_S16_3 delta;
-} Intersection;
+  Fixed_S16_3 scanline_delta;
+  int16_t x_min;
+  int16_t x_max;
+} GPathEdge;
+
+//! Paths with up to this many points are filled without allocating
+#define GPATH_FILL_STACK_POINTS (4)
+
+//! The edges of a small path with their order down the scanlines and the lists of active edges
+//! going up and down
+typedef struct GPathFillScratch {
+  GPathEdge edges[GPATH_FILL_STACK_POINTS];
+  uint16_t edge_indices[3 * GPATH_FILL_STACK_POINTS];
+} GPathFillScratch;
 
 void gpath_init(GPath *path, const GPathInfo *init) {
   memset(path, 0, sizeof(GPath));
@@ -60,34 +97,6 @@ static GPoint rotate_offset_point(const GPoint *orig, int32_t rotation, const GP
   return result;
 }
 
-static void sort16(int16_t *values, size_t length) {
-  for (unsigned int i = 0; i < length; i++) {
-    for (unsigned int j = i+1; j < length; j++) {
-      if (values[i] > values[j]) {
-        swap16(&values[i], &values[j]);
-      }
-    }
-  }
-}
-
-#if PBL_COLOR
-static void swapIntersections(Intersection *a, Intersection *b) {
-  Intersection t = *a;
-  *a = *b;
-  *b = t;
-}
-
-static void sortIntersections(Intersection *values, size_t length) {
-  for (unsigned int i = 0; i < length; i++) {
-    for (unsigned int j = i+1; j < length; j++) {
-      if (values[i].x.raw_value > values[j].x.raw_value) {
-        swapIntersections(&values[i], &values[j]);
-      }
-    }
-  }
-}
-#endif
-
 static inline bool prv_is_in_range(int16_t min_a, int16_t max_a, int16_t min_b, int16_t max_b) {
   return (max_a >= min_b) && (min_a <= max_b);
 }
@@ -197,343 +206,407 @@ GRect gpath_outer_rect(GPath *path) {
   return GRect(min_x, min_y, (max_x - min_x), (max_y - min_y));
 }
 
-#if PBL_COLOR
-void prv_fill_path_with_cb_aa(GContext *ctx, GPath *path, GPathDrawFilledCallback cb,
-                              void *user_data) {
-  /*
-   * Filling gpaths with antialiasing for integral-coordinates based paths:
-   *
-   * Custom linescanner using simple mathematic trick to determine anti-aliased edges
-   *  1. Rotate all points in path
-   *  2. Progress line-by-line finding intersections with paths
-   *  2.1 Calculate delta (angle) of the intersecting lines
-   *  2.2 Sort intersections
-   *  2.3 Draw lines between intersections
-   *
-   * This algorithm relies on few tricks:
-   *  - For intersections with delta less than 1 (angle is less than 45°) we will use exact
-   *      position of the intersection and fill edge pixel based on that information
-   *  - For intersections with delta bigger than 1 (angle is bigger than 45°) we will use delta to
-   *      draw gradient line responding to the angle
-   *      + If gradient is bigger than distance from the start/end of the intersecting line
-   *          we will adjust the delta to match starting/ending point and avoid nasty
-   *          gradients diving in/out the path
-   *      + Gradients too close to clipping rect will be properly cut off
-   */
+//! Returns a point of the path in the units it's filled in. Without antialiasing that's pixels,
+//! with antialiasing x is a Fixed_S16_3 raw value and y is still a scanline.
+static GPoint prv_get_fill_point(const GPath *path, uint32_t index, bool antialiased) {
+  const GPoint point = rotate_offset_point(&path->points[index], path->rotation, &path->offset);
+  if (!antialiased) {
+    return point;
+  }
+  const GPointPrecise precise_point = GPointPreciseFromGPoint(point);
+  return GPoint(precise_point.x.raw_value, precise_point.y.integer);
+}
 
+static int16_t prv_get_fill_point_pixel_x(GPoint point, bool antialiased) {
+  return antialiased ? Fixed_S16_3(point.x).integer : point.x;
+}
 
-  // Protect against apps calling with no points to draw (Upright watchface)
-  if (!path || path->num_points < 2) {
+static void prv_edge_init(GPathEdge *edge, GPoint start, GPoint end, bool antialiased) {
+  int32_t delta_x = end.x - start.x;
+  if (antialiased) {
+    delta_x = (int16_t)delta_x;
+  }
+  const int32_t delta_y = end.y - start.y;
+  *edge = (GPathEdge) {
+    .x_origin = start.x,
+    .y_origin = start.y,
+    .is_down = (delta_y > 0),
+    .is_x_decreasing = (delta_x < 0),
+    .dx = ABS(delta_x),
+    .dy = ABS(delta_y),
+  };
+  if (edge->dy == 0) {
+    // Horizontal edges are never crossed by a scanline, the edges around them are
     return;
   }
+  const int16_t x_direction = edge->is_x_decreasing ? -1 : 1;
+  edge->x_carry = edge->is_down ? x_direction : -x_direction;
+  edge->x_step = (edge->dx / edge->dy) * edge->x_carry;
+  edge->remainder_step = edge->dx % edge->dy;
+
+  if (antialiased) {
+    const int16_t precise_delta_y = delta_y * FIXED_S16_3_ONE.raw_value;
+    edge->delta = (Fixed_S16_3) {
+      .raw_value = ABS(delta_x / precise_delta_y) * FIXED_S16_3_ONE.raw_value,
+    };
+    edge->x_min = MIN(start.x, end.x);
+    edge->x_max = MAX(start.x, end.x);
+  }
+}
 
-  GPointPrecise* rot_points = applib_malloc(path->num_points * sizeof(GPointPrecise));
-  if (!rot_points) {
-    return;
+//! Interpolates x on the first scanline the edge is active on
+static void prv_edge_start(GPathEdge *edge, int16_t y) {
+  const int32_t distance = edge->dx * ABS(y - edge->y_origin);
+  const int32_t quotient = distance / edge->dy;
+  const int32_t remainder = distance % edge->dy;
+  edge->x = edge->x_origin + (edge->is_x_decreasing ? -quotient : quotient);
+  // Going up the distance to the origin shrinks, so the remainder is counted down from dy
+  edge->remainder = edge->is_down ? remainder : (edge->dy - 1 - remainder);
+}
+
+static ALWAYS_INLINE void prv_edge_step(GPathEdge *edge) {
+  edge->x += edge->x_step;
+  edge->remainder += edge->remainder_step;
+  if (edge->remainder >= edge->dy) {
+    edge->remainder -= edge->dy;
+    edge->x += edge->x_carry;
   }
+}
 
-  int min_x, max_x, min_y, max_y;
-  GPointPrecise rot_start, rot_end;
-  bool found_start_direction = false;
-  bool start_is_down = false;
-  Intersection *intersections_up = NULL;
-  Intersection *intersections_down = NULL;
-
-  rot_points[0] = rot_end = GPointPreciseFromGPoint(
-      rotate_offset_point(&path->points[0], path->rotation, &path->offset));
-  min_x = max_x = rot_points[0].x.integer;
-  min_y = max_y = rot_points[0].y.integer;
-
-  // begin finding the last path segment's direction going backwards through the path
-  // we must go backwards because we find intersections going forwards
-  for (int i = path->num_points - 1; i > 0; --i) {
-    rot_points[i] = rot_start = GPointPreciseFromGPoint(
-        rotate_offset_point(&path->points[i], path->rotation, &path->offset));
-    if (min_x > rot_points[i].x.integer) { min_x = rot_points[i].x.integer; }
-    if (max_x < rot_points[i].x.integer) { max_x = rot_points[i].x.integer; }
-    if (min_y > rot_points[i].y.integer) { min_y = rot_points[i].y.integer; }
-    if (max_y < rot_points[i].y.integer) { max_y = rot_points[i].y.integer; }
-
-    if (found_start_direction) {
-      continue;
+static void prv_edge_update_scanline_delta(GPathEdge *edge) {
+  Fixed_S16_3 delta = edge->delta;
+  if (delta.integer > 1) {
+    // this is where we try to fix edges diving in and out of paths
+    if (edge->x - (delta.raw_value / 2) < edge->x_min) {
+      delta.raw_value = (edge->x - edge->x_min) * 2;
     }
 
-    // use the first non-horizontal path segment's direction as the start direction
-    if (rot_end.y.integer != rot_start.y.integer) {
-      start_is_down = rot_end.y.integer > rot_start.y.integer;
-      found_start_direction = true;
+    if (edge->x + (delta.raw_value / 2) > edge->x_max) {
+      delta.raw_value = (edge->x_max - edge->x) * 2;
     }
-
-    rot_end = rot_start;
-  }
-
-  const int16_t clip_min_x = ctx->draw_state.clip_box.origin.x
-      - ctx->draw_state.drawing_box.origin.x;
-  const int16_t clip_max_x = ctx->draw_state.clip_box.size.w + clip_min_x;
-  if (!prv_is_in_range(min_x, max_x, clip_min_x, clip_max_x)) {
-    goto cleanup;
   }
+  edge->scanline_delta = delta;
+}
 
-  // x-intersections of path segments whose direction is up
-  intersections_up = applib_zalloc(path->num_points * sizeof(Intersection));
-  // x-intersections of path segments whose direction is down
-  intersections_down = applib_zalloc(path->num_points * sizeof(Intersection));
+static void prv_swap_edge_indices(uint16_t *a, uint16_t *b) {
+  const uint16_t t = *a;
+  *a = *b;
+  *b = t;
+}
 
-  // If either malloc failed, log message and cleanup
-  if (!intersections_up || !intersections_down) {
-    APP_LOG(APP_LOG_LEVEL_ERROR, GPATH_ERROR);
-    goto cleanup;
+//! Insertion sort, the edges are mostly still in order from the scanline before
+static ALWAYS_INLINE void prv_sort_active_edges(const GPathEdge *edges, uint16_t *active,
+                                                uint16_t count) {
+  for (uint16_t i = 1; i < count; i++) {
+    const uint16_t edge_index = active[i];
+    uint16_t j = i;
+    for (; (j > 0) && (edges[active[j - 1]].x > edges[edge_index].x); j--) {
+      active[j] = active[j - 1];
+    }
+    active[j] = edge_index;
   }
+}
 
-  int intersection_up_count;
-  int intersection_down_count;
-
-  // convert clip coordinates to drawing coordinates
-  const int16_t clip_min_y = ctx->draw_state.clip_box.origin.y
-      - ctx->draw_state.drawing_box.origin.y;
-  const int16_t clip_max_y = ctx->draw_state.clip_box.size.h + clip_min_y;
-  min_y = MAX(min_y, clip_min_y);
-  max_y = MIN(max_y, clip_max_y);
-
-  // filling color hack
-  GColor tmp = ctx->draw_state.stroke_color;
-  ctx->draw_state.stroke_color = ctx->draw_state.fill_color;
-
-  // find all of the horizontal intersections and draw them
-  for (int16_t i = min_y; i <= max_y; ++i) {
-    // initialize with 0 intersections
-    intersection_down_count = 0;
-    intersection_up_count = 0;
-
-    // horizontal path segments don't have a direction and depend
-    // upon the last path segment's direction
-    // keep track of the last path direction for horizontal path segments to use
-    bool last_is_down = start_is_down;
-    rot_end = rot_points[0];
-
-    // find the intersections
-    for (uint32_t j = 0; j < path->num_points; ++j) {
-      rot_start = rot_points[j];
-      if (j + 1 < path->num_points) {
-        rot_end = rot_points[j + 1];
-      } else {
-        // wrap to the first point
-        rot_end = rot_points[0];
-      }
-
-      // if the line is on/crosses this height
-      if ((rot_start.y.integer - i) * (rot_end.y.integer - i) <= 0) {
-        bool is_down = rot_end.y.integer != rot_start.y.integer ?
-                       rot_end.y.integer > rot_start.y.integer : last_is_down;
-        // don't count end points in the same direction to avoid double intersections
-        if (!(rot_start.y.integer == i && last_is_down == is_down)) {
-          // linear interpolation of the line intersection
-
-          int16_t delta_x = rot_end.x.raw_value - rot_start.x.raw_value;
-          int16_t delta_y = rot_end.y.raw_value - rot_start.y.raw_value;
-
-          Fixed_S16_3 x = (Fixed_S16_3){.raw_value = rot_start.x.raw_value + delta_x
-                          * (i * FIXED_S16_3_ONE.raw_value - rot_start.y.raw_value) / delta_y};
-
-          Fixed_S16_3 delta = (Fixed_S16_3){.raw_value = ABS(delta_x / delta_y) *
-                                                          FIXED_S16_3_ONE.raw_value};
-
-          if (delta.integer > 1) {
-            // this is where we try to fix edges diving in and out of paths
-            int16_t min_x = rot_end.x.raw_value < rot_start.x.raw_value ?
-                              rot_end.x.raw_value : rot_start.x.raw_value;
-            int16_t max_x = rot_end.x.raw_value > rot_start.x.raw_value ?
-                              rot_end.x.raw_value : rot_start.x.raw_value;
-
-            if (x.raw_value - (delta.raw_value / 2) < min_x) {
-              delta.raw_value = (x.raw_value - min_x) * 2;
-            }
-
-            if (x.raw_value + (delta.raw_value / 2) > max_x) {
-              delta.raw_value = (max_x - x.raw_value) * 2;
-            }
-          }
-
-          if (is_down) {
-            intersections_down[intersection_down_count].x.raw_value = x.raw_value;
-            intersections_down[intersection_down_count].delta = delta;
-            intersection_down_count++;
-          } else {
-            intersections_up[intersection_up_count].x.raw_value = x.raw_value;
-            intersections_up[intersection_up_count].delta = delta;
-            intersection_up_count++;
-          }
-        }
-        last_is_down = is_down;
-      }
+//! Edges crossing the scanline at the same x get paired up by the order they end up in, which
+//! only makes a difference if their gradients differ
+static bool prv_active_edges_pair_by_order(const GPathEdge *edges, const uint16_t *active,
+                                           uint16_t count) {
+  for (uint16_t i = 1; i < count; i++) {
+    if ((edges[active[i - 1]].x == edges[active[i]].x) &&
+        (edges[active[i - 1]].scanline_delta.raw_value !=
+         edges[active[i]].scanline_delta.raw_value)) {
+      return true;
     }
+  }
+  return false;
+}
 
-    // sort the intersections
-    sortIntersections(intersections_up, intersection_up_count);
-    sortIntersections(intersections_down, intersection_down_count);
-
-    // draw the line segments
-    for (int j = 0; j < MIN(intersection_up_count, intersection_down_count); j++) {
-      Intersection x_a = intersections_up[j];
-      Intersection x_b = intersections_down[j];
-      if (x_a.x.integer != x_b.x.integer) {
-        if (x_a.x.integer > x_b.x.integer) {
-          swapIntersections(&x_a, &x_b);
-        }
-        // this is done by callback now...
-        // x_a.x.integer++;
-        // x_b.x.integer--;
-
-        cb(ctx, i, x_a.x, x_b.x, x_a.delta, x_b.delta, user_data);
+//! Puts the active edges in the order the intersections of the path have always been sorted in:
+//! gathered in the order of the path, then exchange sorted
+static void prv_sort_active_edges_in_path_order(const GPathEdge *edges, uint16_t *active,
+                                                uint16_t count) {
+  for (uint16_t i = 1; i < count; i++) {
+    for (uint16_t j = i; (j > 0) && (edges[active[j - 1]].index > edges[active[j]].index); j--) {
+      prv_swap_edge_indices(&active[j - 1], &active[j]);
+    }
+  }
+  for (uint16_t i = 0; i < count; i++) {
+    for (uint16_t j = i + 1; j < count; j++) {
+      if (edges[active[i]].x > edges[active[j]].x) {
+        prv_swap_edge_indices(&active[i], &active[j]);
       }
     }
   }
+}
 
-  // restore original stroke color
-  ctx->draw_state.stroke_color = tmp;
+//! Sorts the active edges by x, and works out the gradients they're drawn with
+static ALWAYS_INLINE void prv_sort_active_edges_for_scanline(GPathEdge *edges, uint16_t *active,
+                                                             uint16_t count, bool antialiased) {
+  prv_sort_active_edges(edges, active, count);
+  if (antialiased) {
+    for (uint16_t i = 0; i < count; i++) {
+      prv_edge_update_scanline_delta(&edges[active[i]]);
+    }
+    if (prv_active_edges_pair_by_order(edges, active, count)) {
+      prv_sort_active_edges_in_path_order(edges, active, count);
+    }
+  }
+}
 
-cleanup:
-  applib_free(rot_points);
-  applib_free(intersections_up);
-  applib_free(intersections_down);
+//! Steps the active edges on to the next scanline, dropping the ones that end on this one
+static ALWAYS_INLINE uint16_t prv_step_active_edges(GPathEdge *edges, uint16_t *active,
+                                                    uint16_t count, int16_t y) {
+  uint16_t num_active = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    GPathEdge *edge = &edges[active[i]];
+    if (edge->y_end > y) {
+      prv_edge_step(edge);
+      active[num_active++] = active[i];
+    }
+  }
+  return num_active;
 }
-#endif // PBL_COLOR
 
-void gpath_draw_filled_with_cb(GContext *ctx, GPath *path, GPathDrawFilledCallback cb,
-                               void *user_data) {
-  //Protect against apps calling with no points to draw (Upright watchface)
+//! Fills the path scanline by scanline. The edges of the path are sorted by the first scanline
+//! they cross and stay in the lists of active edges until their last one, so every scanline only
+//! looks at the edges crossing it. The intersections of edges going up are paired with the ones
+//! of edges going down, in the order of x, and handed to the callback.
+//! Without clipping every scanline of the path is handed to the callback.
+static void prv_fill_path(GContext *ctx, GPath *path, GPathDrawFilledCallback cb,
+                          void *user_data, bool antialiased, bool clipped) {
+  // Protect against apps calling with no points to draw (Upright watchface)
   if (!path || path->num_points < 2) {
     return;
   }
 
-  GPoint* rot_points = applib_malloc(path->num_points * sizeof(GPoint));
-  if (!rot_points) {
-    APP_LOG(APP_LOG_LEVEL_ERROR, GPATH_ERROR);
-    return;
+  // One scratch buffer for the edges, their order down the scanlines and the lists of active
+  // edges going up and down. Small paths, like most hands and icons, don't touch the heap.
+  const uint32_t num_points = path->num_points;
+  GPathFillScratch stack_scratch;
+  GPathEdge *edges = stack_scratch.edges;
+  uint16_t *edge_order = stack_scratch.edge_indices;
+  if (num_points > GPATH_FILL_STACK_POINTS) {
+    edges = applib_malloc(num_points * (sizeof(GPathEdge) + (3 * sizeof(uint16_t))));
+    if (!edges) {
+      APP_LOG(APP_LOG_LEVEL_ERROR, GPATH_ERROR);
+      return;
+    }
+    edge_order = (uint16_t *)&edges[num_points];
   }
+  uint16_t *active_up = &edge_order[num_points];
+  uint16_t *active_down = &active_up[num_points];
 
+  const GPoint first_point = prv_get_fill_point(path, 0, antialiased);
+  GPoint end = first_point;
   int min_x, max_x, min_y, max_y;
-  GPoint rot_start, rot_end;
-  bool found_start_direction = false;
-  bool start_is_down = false;
-  int16_t *intersections_up = NULL;
-  int16_t *intersections_down = NULL;
-
-  rot_points[0] = rot_end = rotate_offset_point(&path->points[0], path->rotation, &path->offset);
-  min_x = max_x = rot_points[0].x;
-  min_y = max_y = rot_points[0].y;
-
-  // begin finding the last path segment's direction going backwards through the path
-  // we must go backwards because we find intersections going forwards
-  for (int i = path->num_points - 1; i > 0; --i) {
-    rot_points[i] = rot_start = rotate_offset_point(&path->points[i], path->rotation, &path->offset);
-    if (min_x > rot_points[i].x) { min_x = rot_points[i].x; }
-    if (max_x < rot_points[i].x) { max_x = rot_points[i].x; }
-    if (min_y > rot_points[i].y) { min_y = rot_points[i].y; }
-    if (max_y < rot_points[i].y) { max_y = rot_points[i].y; }
-
-    if (found_start_direction) {
-      continue;
-    }
-
-    // use the first non-horizontal path segment's direction as the start direction
-    if (rot_end.y != rot_start.y) {
-      start_is_down = rot_end.y > rot_start.y;
-      found_start_direction = true;
+  min_x = max_x = prv_get_fill_point_pixel_x(first_point, antialiased);
+  min_y = max_y = first_point.y;
+
+  for (uint32_t i = 0; i < num_points; i++) {
+    const GPoint start = end;
+    if (i + 1 < num_points) {
+      end = prv_get_fill_point(path, i + 1, antialiased);
+      const int16_t end_x = prv_get_fill_point_pixel_x(end, antialiased);
+      if (min_x > end_x) { min_x = end_x; }
+      if (max_x < end_x) { max_x = end_x; }
+      if (min_y > end.y) { min_y = end.y; }
+      if (max_y < end.y) { max_y = end.y; }
+    } else {
+      // wrap to the first point
+      end = first_point;
     }
-
-    rot_end = rot_start;
+    prv_edge_init(&edges[i], start, end, antialiased);
   }
 
-
   const int16_t clip_min_x = ctx->draw_state.clip_box.origin.x
       - ctx->draw_state.drawing_box.origin.x;
   const int16_t clip_max_x = ctx->draw_state.clip_box.size.w + clip_min_x;
-  if (!prv_is_in_range(min_x, max_x, clip_min_x, clip_max_x)) {
+  if (clipped && !prv_is_in_range(min_x, max_x, clip_min_x, clip_max_x)) {
     goto cleanup;
   }
 
-  // x-intersections of path segments whose direction is up
-  intersections_up = applib_zalloc(path->num_points * sizeof(int16_t));
-  // x-intersections of path segments whose direction is down
-  intersections_down = applib_zalloc(path->num_points * sizeof(int16_t));
+  // horizontal path segments don't have a direction and depend upon the last path segment's
+  // direction, the first path segment carries on from the last one that isn't horizontal
+  bool last_is_down = false;
+  for (uint32_t i = num_points - 1; i > 0; --i) {
+    if (edges[i].dy != 0) {
+      last_is_down = edges[i].is_down;
+      break;
+    }
+  }
 
-  // If either malloc failed, log message and cleanup
-  if (!intersections_up || !intersections_down) {
-    APP_LOG(APP_LOG_LEVEL_ERROR, GPATH_ERROR);
-    goto cleanup;
+  // Find the scanlines each edge crosses and leave out the horizontal ones
+  uint16_t num_edges = 0;
+  for (uint32_t i = 0; i < num_points; i++) {
+    GPathEdge edge = edges[i];
+    if (edge.dy == 0) {
+      continue;
+    }
+    // don't count end points in the same direction to avoid double intersections, the edge
+    // before already counted its end on that scanline
+    const int16_t skip_start = (edge.is_down == last_is_down) ? 1 : 0;
+    if (edge.is_down) {
+      edge.y_begin = edge.y_origin + skip_start;
+      edge.y_end = edge.y_origin + edge.dy;
+    } else {
+      edge.y_begin = edge.y_origin - edge.dy;
+      edge.y_end = edge.y_origin - skip_start;
+    }
+    edge.index = i;
+    last_is_down = edge.is_down;
+    edge_order[num_edges] = num_edges;
+    edges[num_edges++] = edge;
   }
 
-  int intersection_up_count;
-  int intersection_down_count;
+  // The edge table: edges in the order of the first scanline they cross
+  for (uint16_t i = 1; i < num_edges; i++) {
+    const uint16_t edge_index = edge_order[i];
+    uint16_t j = i;
+    for (; (j > 0) && (edges[edge_order[j - 1]].y_begin > edges[edge_index].y_begin); j--) {
+      edge_order[j] = edge_order[j - 1];
+    }
+    edge_order[j] = edge_index;
+  }
 
+  // convert clip coordinates to drawing coordinates
   const int16_t clip_min_y = ctx->draw_state.clip_box.origin.y
       - ctx->draw_state.drawing_box.origin.y;
   const int16_t clip_max_y = ctx->draw_state.clip_box.size.h + clip_min_y;
-  min_y = MAX(min_y, clip_min_y);
-  max_y = MIN(max_y, clip_max_y);
-
-  // find all of the horizontal intersections and draw them
-  for (int16_t i = min_y; i <= max_y; ++i) {
-    // initialize with 0 intersections
-    intersection_down_count = 0;
-    intersection_up_count = 0;
-
-    // horizontal path segments don't have a direction and depend upon the last path segment's direction
-    // keep track of the last path direction for horizontal path segments to use
-    bool last_is_down = start_is_down;
-    rot_end = rot_points[0];
-
-    // find the intersections
-    for (uint32_t j = 0; j < path->num_points; ++j) {
-      rot_start = rot_points[j];
-      if (j + 1 < path->num_points) {
-        rot_end = rot_points[j + 1];
-      } else {
-        // wrap to the first point
-        rot_end = rot_points[0];
-      }
+  if (clipped) {
+    min_y = MAX(min_y, clip_min_y);
+    max_y = MIN(max_y, clip_max_y);
+  }
 
-      // if the line is on/crosses this height
-      if ((rot_start.y - i) * (rot_end.y - i) <= 0) {
-        bool is_down = rot_end.y != rot_start.y ? rot_end.y > rot_start.y : last_is_down;
-        // don't count end points in the same direction to avoid double intersections
-        if (!(rot_start.y == i && last_is_down == is_down)) {
-          // linear interpolation of the line intersection
-          int16_t x = rot_start.x + (rot_end.x - rot_start.x) * (i - rot_start.y) / (rot_end.y - rot_start.y);
-          if (is_down) {
-            intersections_down[intersection_down_count] = x;
-            intersection_down_count++;
-          } else {
-            intersections_up[intersection_up_count] = x;
-            intersection_up_count++;
-          }
-        }
-        last_is_down = is_down;
+  uint16_t next_edge = 0;
+  uint16_t num_active_up = 0;
+  uint16_t num_active_down = 0;
+  for (int16_t y = min_y; y <= max_y; ++y) {
+    // Edges reaching this scanline join the active edges, ones that ended above it never do
+    while ((next_edge < num_edges) && (edges[edge_order[next_edge]].y_begin <= y)) {
+      const uint16_t edge_index = edge_order[next_edge++];
+      GPathEdge *edge = &edges[edge_index];
+      if (edge->y_end < y) {
+        continue;
+      }
+      prv_edge_start(edge, y);
+      if (edge->is_down) {
+        active_down[num_active_down++] = edge_index;
+      } else {
+        active_up[num_active_up++] = edge_index;
       }
     }
 
-    // sort the intersections
-    sort16(intersections_up, intersection_up_count);
-    sort16(intersections_down, intersection_down_count);
+    if ((num_active_up == 0) && (num_active_down == 0) && (next_edge == num_edges)) {
+      break;
+    }
+    prv_sort_active_edges_for_scanline(edges, active_up, num_active_up, antialiased);
+    prv_sort_active_edges_for_scanline(edges, active_down, num_active_down, antialiased);
 
     // draw the line segments
-    for (int j = 0; j < MIN(intersection_up_count, intersection_down_count); j++) {
-      int16_t x_a = intersections_up[j];
-      int16_t x_b = intersections_down[j];
-      if (x_a != x_b) {
-        if (x_a > x_b) {
-          swap16(&x_a, &x_b);
+    for (uint16_t j = 0; j < MIN(num_active_up, num_active_down); j++) {
+      const GPathEdge *edge_a = &edges[active_up[j]];
+      const GPathEdge *edge_b = &edges[active_down[j]];
+      if (antialiased) {
+        if (Fixed_S16_3(edge_a->x).integer != Fixed_S16_3(edge_b->x).integer) {
+          if (Fixed_S16_3(edge_a->x).integer > Fixed_S16_3(edge_b->x).integer) {
+            const GPathEdge *t = edge_a;
+            edge_a = edge_b;
+            edge_b = t;
+          }
+          cb(ctx, y, Fixed_S16_3(edge_a->x), Fixed_S16_3(edge_b->x),
+             edge_a->scanline_delta, edge_b->scanline_delta, user_data);
+        }
+      } else {
+        int16_t x_a = edge_a->x;
+        int16_t x_b = edge_b->x;
+        if (x_a != x_b) {
+          if (x_a > x_b) {
+            swap16(&x_a, &x_b);
+          }
+          cb(ctx, y, (Fixed_S16_3){.integer = x_a}, (Fixed_S16_3){.integer = x_b},
+             (Fixed_S16_3){.integer = -1}, (Fixed_S16_3){.integer = -1}, user_data);
         }
-        cb(ctx, i, (Fixed_S16_3){.integer = x_a}, (Fixed_S16_3){.integer = x_b},
-           (Fixed_S16_3){.integer = -1}, (Fixed_S16_3){.integer = -1}, user_data);
       }
     }
+
+    num_active_up = prv_step_active_edges(edges, active_up, num_active_up, y);
+    num_active_down = prv_step_active_edges(edges, active_down, num_active_down, y);
   }
+
 cleanup:
-  applib_free(rot_points);
-  applib_free(intersections_up);
-  applib_free(intersections_down);
+  if (edges != stack_scratch.edges) {
+    applib_free(edges);
+  }
+}
+
+#if PBL_COLOR
+void prv_fill_path_with_cb_aa(GContext *ctx, GPath *path, GPathDrawFilledCallback cb,
+                              void *user_data) {
+  /*
+   * Filling gpaths with antialiasing for integral-coordinates based paths:
+   *
+   * Custom linescanner using simple mathematic trick to determine anti-aliased edges
+   *  1. Rotate all points in path
+   *  2. Progress line-by-line stepping the intersections of the edges crossing the line
+   *  2.1 Calculate delta (angle) of the intersecting lines
+   *  2.2 Keep intersections sorted
+   *  2.3 Draw lines between intersections
+   *
+   * This algorithm relies on few tricks:
+   *  - For intersections with delta less than 1 (angle is less than 45°) we will use exact
+   *      position of the intersection and fill edge pixel based on that information
+   *  - For intersections with delta bigger than 1 (angle is bigger than 45°) we will use delta to
+   *      draw gradient line responding to the angle
+   *      + If gradient is bigger than distance from the start/end of the intersecting line
+   *          we will adjust the delta to match starting/ending point and avoid nasty
+   *          gradients diving in/out the path
+   *      + Gradients too close to clipping rect will be properly cut off
+   */
+
+  // filling color hack
+  GColor tmp = ctx->draw_state.stroke_color;
+  ctx->draw_state.stroke_color = ctx->draw_state.fill_color;
+
+  prv_fill_path(ctx, path, cb, user_data, true /* antialiased */, true /* clipped */);
+
+  // restore original stroke color
+  ctx->draw_state.stroke_color = tmp;
+}
+#endif // PBL_COLOR
+
+void gpath_draw_filled_with_cb(GContext *ctx, GPath *path, GPathDrawFilledCallback cb,
+                               void *user_data) {
+  prv_fill_path(ctx, path, cb, user_data, false /* antialiased */, true /* clipped */);
+}
+
+void gpath_fill_spans_with_cb(GContext *ctx, GPath *path, GPathDrawFilledCallback cb,
+                              void *user_data) {
+  const bool antialiased = PBL_IF_COLOR_ELSE(ctx->draw_state.antialiased, false);
+  prv_fill_path(ctx, path, cb, user_data, antialiased, false /* clipped */);
+}
+
+void gpath_draw_filled_spans(GContext *ctx, const GPathFilledSpan *spans, uint32_t num_spans) {
+  if (!spans) {
+    return;
+  }
+
+#if PBL_COLOR
+  // same filling color hack as prv_fill_path_with_cb_aa
+  GColor tmp = ctx->draw_state.stroke_color;
+  if (ctx->draw_state.antialiased) {
+    ctx->draw_state.stroke_color = ctx->draw_state.fill_color;
+  }
+#endif
+
+  for (uint32_t i = 0; i < num_spans; i++) {
+    const GPathFilledSpan *span = &spans[i];
+    prv_gpath_draw_filled_cb(ctx, span->y, span->x_range_begin, span->x_range_end,
+                             span->delta_begin, span->delta_end, NULL);
+  }
+
+#if PBL_COLOR
+  ctx->draw_state.stroke_color = tmp;
+#endif
 }
 
 void gpath_fill_precise_internal(GContext *ctx, GPointPrecise *points, size_t num_points) {
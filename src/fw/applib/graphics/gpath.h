@@ -180,6 +180,29 @@ typedef void (*GPathDrawFilledCallback)(
 void gpath_draw_filled_with_cb(GContext *ctx, GPath *path, GPathDrawFilledCallback cb,
                                void *user_data);
 
+//! @internal
+//! A scanline of a filled path, as handed to a GPathDrawFilledCallback
+typedef struct GPathFilledSpan {
+  int16_t y;
+  Fixed_S16_3 x_range_begin;
+  Fixed_S16_3 x_range_end;
+  Fixed_S16_3 delta_begin;
+  Fixed_S16_3 delta_end;
+} GPathFilledSpan;
+
+//! @internal
+//! Hands every scanline of the filled path to the callback, like \ref gpath_draw_filled() draws
+//! them in the GContext's current antialiasing mode, but without clipping them. The scanlines
+//! are relative to the drawing_box and stay valid as long as the path and the antialiasing mode
+//! don't change, they can be drawn with \ref gpath_draw_filled_spans() under any clip box.
+void gpath_fill_spans_with_cb(GContext *ctx, GPath *path, GPathDrawFilledCallback cb,
+                              void *user_data);
+
+//! @internal
+//! Draws scanlines recorded with \ref gpath_fill_spans_with_cb() in the fill color, with the
+//! same result as filling the path they were recorded from.
+void gpath_draw_filled_spans(GContext *ctx, const GPathFilledSpan *spans, uint32_t num_spans);
+
 //! @internal
 void gpath_fill_precise_internal(GContext *ctx, GPointPrecise *points, size_t num_points);
 
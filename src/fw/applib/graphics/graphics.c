@@ -459,12 +459,8 @@ void graphics_context_init(GContext *context, FrameBuffer *framebuffer,
     .lock = false
   };
 
-  // init the font cache
-  FontCache *font_cache = &context->font_cache;
-  memset(font_cache->cache_keys, 0, sizeof(font_cache->cache_keys));
-  memset(font_cache->cache_data, 0, sizeof(font_cache->cache_data));
-  keyed_circular_cache_init(&font_cache->line_cache, font_cache->cache_keys,
-                            font_cache->cache_data, sizeof(LineCacheData), LINE_CACHE_SIZE);
+  // The font cache starts out empty and without a glyph cache, it was zeroed along with the rest
+  // of the context. The kernel and the app attach theirs with text_resources_init_font_cache().
 
   graphics_context_set_default_drawing_state(context, init_mode);
 }
@@ -291,6 +291,132 @@ bool grect_overlaps_grect(const GRect *r1, const GRect *r2) {
   return false;
 }
 
+static int32_t prv_grect_area(const GRect *rect) {
+  return (int32_t)rect->size.w * rect->size.h;
+}
+
+static bool prv_grect_contains_grect(const GRect *outer, const GRect *inner) {
+  return (inner->origin.x >= outer->origin.x) &&
+         (inner->origin.y >= outer->origin.y) &&
+         (inner->origin.x + inner->size.w <= outer->origin.x + outer->size.w) &&
+         (inner->origin.y + inner->size.h <= outer->origin.y + outer->size.h);
+}
+
+//! Same as grect_union() for standardized rectangles, without limiting the result to 8 bits
+static GRect prv_grect_union(const GRect *r1, const GRect *r2) {
+  const int16_t min_x = MIN(r1->origin.x, r2->origin.x);
+  const int16_t min_y = MIN(r1->origin.y, r2->origin.y);
+  const int16_t max_x = MAX(r1->origin.x + r1->size.w, r2->origin.x + r2->size.w);
+  const int16_t max_y = MAX(r1->origin.y + r1->size.h, r2->origin.y + r2->size.h);
+  return GRect(min_x, min_y, max_x - min_x, max_y - min_y);
+}
+
+static void prv_dirty_region_remove(GDirtyRegion *region, unsigned int index) {
+  region->rects[index] = region->rects[--region->num_rects];
+}
+
+void gdirty_region_reset(GDirtyRegion *region) {
+  region->num_rects = 0;
+}
+
+void gdirty_region_add(GDirtyRegion *region, const GRect *rect) {
+  GRect new_rect = *rect;
+  grect_standardize(&new_rect);
+  if (grect_is_empty(&new_rect)) {
+    return;
+  }
+
+  // Fold the new rectangle into every rectangle it can be merged with without covering more
+  // pixels than the two did. It grows with every merge, so start over after each one.
+  unsigned int i = 0;
+  while (i < region->num_rects) {
+    const GRect *rect_i = &region->rects[i];
+    if (prv_grect_contains_grect(rect_i, &new_rect)) {
+      return;
+    }
+    const GRect merged = prv_grect_union(rect_i, &new_rect);
+    if (prv_grect_area(&merged) <= prv_grect_area(rect_i) + prv_grect_area(&new_rect)) {
+      new_rect = merged;
+      prv_dirty_region_remove(region, i);
+      i = 0;
+    } else {
+      i++;
+    }
+  }
+
+  if (region->num_rects < GDIRTY_REGION_MAX_RECTS) {
+    region->rects[region->num_rects++] = new_rect;
+    return;
+  }
+
+  // The region is full, merge the pair of rectangles (the new one included) whose union covers
+  // the fewest pixels that neither of them did
+  const unsigned int new_rect_index = GDIRTY_REGION_MAX_RECTS;
+  unsigned int best_a = 0;
+  unsigned int best_b = new_rect_index;
+  int32_t best_waste = INT32_MAX;
+  for (unsigned int a = 0; a < GDIRTY_REGION_MAX_RECTS; a++) {
+    for (unsigned int b = a + 1; b <= new_rect_index; b++) {
+      const GRect *rect_a = &region->rects[a];
+      const GRect *rect_b = (b == new_rect_index) ? &new_rect : &region->rects[b];
+      const GRect merged = prv_grect_union(rect_a, rect_b);
+      const int32_t waste =
+          prv_grect_area(&merged) - prv_grect_area(rect_a) - prv_grect_area(rect_b);
+      if (waste < best_waste) {
+        best_waste = waste;
+        best_a = a;
+        best_b = b;
+      }
+    }
+  }
+
+  GRect merged;
+  if (best_b == new_rect_index) {
+    merged = prv_grect_union(&region->rects[best_a], &new_rect);
+    prv_dirty_region_remove(region, best_a);
+  } else {
+    merged = prv_grect_union(&region->rects[best_a], &region->rects[best_b]);
+    region->rects[best_a] = new_rect;
+    prv_dirty_region_remove(region, best_b);
+  }
+  // There's room for it now, this doesn't recurse any further
+  gdirty_region_add(region, &merged);
+}
+
+void gdirty_region_add_region(GDirtyRegion *region, const GDirtyRegion *other) {
+  for (unsigned int i = 0; i < other->num_rects; i++) {
+    gdirty_region_add(region, &other->rects[i]);
+  }
+}
+
+GRect gdirty_region_get_bounds(const GDirtyRegion *region) {
+  if (region->num_rects == 0) {
+    return GRectZero;
+  }
+  GRect bounds = region->rects[0];
+  for (unsigned int i = 1; i < region->num_rects; i++) {
+    bounds = prv_grect_union(&bounds, &region->rects[i]);
+  }
+  return bounds;
+}
+
+bool gdirty_region_overlaps_grect(const GDirtyRegion *region, const GRect *rect) {
+  for (unsigned int i = 0; i < region->num_rects; i++) {
+    if (grect_overlaps_grect(&region->rects[i], rect)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t gdirty_region_get_area(const GDirtyRegion *region) {
+  uint32_t area = 0;
+  for (unsigned int i = 0; i < region->num_rects; i++) {
+    area += prv_grect_area(&region->rects[i]);
+  }
+  return area;
+}
+
 void grect_precise_standardize(GRectPrecise *rect) {
   if (rect->size.w.raw_value < 0) {
     rect->origin.x.raw_value += rect->size.w.raw_value;
@@ -1369,6 +1369,44 @@ GRect grect_to_local_coordinates(const GRect rect, GContext *ctx);
 //! Returns true if the two GRects overlap at all.
 bool grect_overlaps_grect(const GRect *r1, const GRect *r2);
 
+//! @internal
+//! Maximum number of rectangles a GDirtyRegion tracks before it starts merging them
+#define GDIRTY_REGION_MAX_RECTS (8)
+
+//! @internal
+//! A bounded list of rectangles that need to be redrawn. Rectangles that overlap or sit next to
+//! each other are merged as they are added, and once the list is full the two rectangles whose
+//! union wastes the fewest pixels are merged to make room. The rectangles may still overlap.
+typedef struct GDirtyRegion {
+  GRect rects[GDIRTY_REGION_MAX_RECTS];
+  uint8_t num_rects;
+} GDirtyRegion;
+
+//! @internal
+//! Empties the region
+void gdirty_region_reset(GDirtyRegion *region);
+
+//! @internal
+//! Adds rect to the region, empty rectangles are ignored
+void gdirty_region_add(GDirtyRegion *region, const GRect *rect);
+
+//! @internal
+//! Adds all rectangles of other to the region
+void gdirty_region_add_region(GDirtyRegion *region, const GDirtyRegion *other);
+
+//! @internal
+//! @return the smallest rectangle covering all rectangles of the region, GRectZero if it's empty
+GRect gdirty_region_get_bounds(const GDirtyRegion *region);
+
+//! @internal
+//! @return whether any rectangle of the region overlaps rect
+bool gdirty_region_overlaps_grect(const GDirtyRegion *region, const GRect *rect);
+
+//! @internal
+//! @return the number of pixels covered by the region, pixels covered by several rectangles are
+//!   counted once for every one of them
+uint32_t gdirty_region_get_area(const GDirtyRegion *region);
+
 //! @internal
 BitmapInfo gbitmap_get_info(const GBitmap *bitmap);
 
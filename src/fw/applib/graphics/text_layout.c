@@ -31,7 +31,6 @@
 #include "process_state/app_state/app_state.h"
 #include "system/logging.h"
 #include "system/passert.h"
-#include "pbl/util/hash.h"
 #include "pbl/util/iterator.h"
 #include "pbl/util/math.h"
 
@@ -1191,8 +1190,161 @@ static void prv_apply_orphan_state(const OrphanLineState *state, Line *line) {
   line->width_px = state->width_px;
 }
 
+////////////////////////////////////////////////////////////
+// Line cache
+
+//! @return whether the lines of the text in text_box_params may be cached, which isn't the case
+//! when they depend on where the box is on screen or the text is too long to index
+static bool prv_line_cache_is_usable(GTextLayoutCacheRef layout,
+                                     const TextBoxParams *text_box_params) {
+  const TextLayoutFlowData *flow_data = graphics_text_layout_get_flow_data(layout);
+  if (flow_data->paging.page_on_screen.size_h != 0 || flow_data->perimeter.impl != NULL) {
+    return false;
+  }
+  const Utf8Bounds *utf8_bounds = text_box_params->utf8_bounds;
+  return ((utf8_bounds->end - utf8_bounds->start) < TEXT_LINE_CACHE_NO_START);
+}
+
+//! A font freed and another one loaded at the same address look the same by pointer alone
+static uint32_t prv_line_cache_font_resource_id(GFont font) {
+  return font ? font->base.resource_id : 0;
+}
+
+//! @return whether entry was laid out for the text and parameters in text_box_params
+static bool prv_line_cache_entry_is_fresh(const TextLineCacheEntry *entry,
+                                          const TextBoxParams *text_box_params,
+                                          uint32_t text_hash) {
+  const Utf8Bounds *utf8_bounds = text_box_params->utf8_bounds;
+  return ((entry->text_hash == text_hash) &&
+          (entry->text_length == (utf8_bounds->end - utf8_bounds->start)) &&
+          (entry->line_spacing_delta == text_box_params->line_spacing_delta) &&
+          gsize_equal(&entry->box_size, &text_box_params->box.size) &&
+          (entry->font == text_box_params->font) &&
+          (entry->font_resource_id == prv_line_cache_font_resource_id(text_box_params->font)) &&
+          (entry->overflow_mode == text_box_params->overflow_mode) &&
+          (entry->alignment == text_box_params->alignment));
+}
+
+//! @return the entry with the lines of the text in text_box_params, or NULL if there is none
+static TextLineCacheEntry *prv_line_cache_find(TextLineCache *line_cache,
+                                               const TextBoxParams *text_box_params,
+                                               uint32_t text_hash) {
+  for (unsigned int i = 0; i < TEXT_LINE_CACHE_NUM_ENTRIES; i++) {
+    TextLineCacheEntry *entry = &line_cache->entries[i];
+    if (prv_line_cache_entry_is_fresh(entry, text_box_params, text_hash)) {
+      entry->last_used = ++line_cache->clock;
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+//! @return the least recently used entry
+static TextLineCacheEntry *prv_line_cache_get_lru(TextLineCache *line_cache) {
+  TextLineCacheEntry *lru = &line_cache->entries[0];
+  for (unsigned int i = 1; i < TEXT_LINE_CACHE_NUM_ENTRIES; i++) {
+    const uint16_t age = line_cache->clock - line_cache->entries[i].last_used;
+    if (age > (uint16_t)(line_cache->clock - lru->last_used)) {
+      lru = &line_cache->entries[i];
+    }
+  }
+  return lru;
+}
+
+//! Empties entry for the lines of the text in text_box_params
+static void prv_line_cache_entry_reset(TextLineCache *line_cache, TextLineCacheEntry *entry,
+                                       const TextBoxParams *text_box_params,
+                                       uint32_t text_hash) {
+  const Utf8Bounds *utf8_bounds = text_box_params->utf8_bounds;
+  *entry = (TextLineCacheEntry) {
+    .text_hash = text_hash,
+    .text_length = (utf8_bounds->end - utf8_bounds->start),
+    .line_spacing_delta = text_box_params->line_spacing_delta,
+    .box_size = text_box_params->box.size,
+    .font = text_box_params->font,
+    .font_resource_id = prv_line_cache_font_resource_id(text_box_params->font),
+    .overflow_mode = text_box_params->overflow_mode,
+    .alignment = text_box_params->alignment,
+    .last_used = ++line_cache->clock,
+  };
+}
+
+static void prv_line_cache_record(TextLineCacheEntry *entry, const Line *line,
+                                  const TextBoxParams *text_box_params) {
+  if (entry->num_lines >= TEXT_LINE_CACHE_MAX_LINES) {
+    entry->is_truncated = true;
+    return;
+  }
+  entry->lines[entry->num_lines++] = (TextCachedLine) {
+    .start_offset = line->start ? (line->start - text_box_params->utf8_bounds->start)
+                                : TEXT_LINE_CACHE_NO_START,
+    .origin_x = line->origin.x - text_box_params->box.origin.x,
+    .width_px = line->width_px,
+    .suffix_codepoint = line->suffix_codepoint,
+  };
+}
+
+//! Rebuilds the line at index as line_add_words() laid it out
+static void prv_line_cache_get_line(const TextLineCacheEntry *entry, unsigned int index,
+                                    const TextBoxParams *text_box_params, Line *line) {
+  const TextCachedLine *cached_line = &entry->lines[index];
+  *line = (Line) {
+    .start = (cached_line->start_offset == TEXT_LINE_CACHE_NO_START) ?
+        NULL : (text_box_params->utf8_bounds->start + cached_line->start_offset),
+    .origin = {
+      .x = text_box_params->box.origin.x + cached_line->origin_x,
+      .y = text_box_params->box.origin.y + (index * prv_get_line_height(text_box_params)),
+    },
+    .height_px = fonts_get_font_height(text_box_params->font),
+    .width_px = cached_line->width_px,
+    .max_width_px = text_box_params->box.size.w,
+    .suffix_codepoint = cached_line->suffix_codepoint,
+  };
+}
+
+//! Visits the cached lines like prv_walk_lines_down() visits the lines it lays out
+//! @return false if the cached lines don't reach as far as the walk would go
+static bool prv_line_cache_replay(const TextLineCacheEntry *entry, TextLayout* const layout,
+                                  GContext *ctx, const WalkLinesCallbacks *callbacks) {
+  const TextBoxParams* const text_box_params = &ctx->text_draw_state.text_box;
+  Line* line = &ctx->text_draw_state.line;
+
+  if (!entry->is_complete) {
+    // The stop condition only gets more true further down, so the last line tells whether the
+    // walk stops within the cached lines
+    if (!callbacks->stop_condition_cb || (entry->num_lines == 0)) {
+      return false;
+    }
+    prv_line_cache_get_line(entry, entry->num_lines - 1, text_box_params, line);
+    if (!callbacks->stop_condition_cb(ctx, line, text_box_params)) {
+      return false;
+    }
+  }
+
+  for (unsigned int i = 0; i < entry->num_lines; i++) {
+    prv_line_cache_get_line(entry, i, text_box_params, line);
+
+    const int32_t line_max_y = line->origin.y + line->height_px +
+                               TEXT_LINE_DESCENDER_LINE(line) +
+                               text_box_params->line_spacing_delta;
+    if ((line_max_y > ctx->draw_state.clip_box.origin.y) && callbacks->render_line_cb) {
+      callbacks->render_line_cb(ctx, line, text_box_params);
+    }
+
+    if (callbacks->layout_update_cb) {
+      callbacks->layout_update_cb(layout, line, text_box_params);
+    }
+
+    if (callbacks->stop_condition_cb && callbacks->stop_condition_cb(ctx, line, text_box_params)) {
+      break;
+    }
+  }
+  return true;
+}
+
 //! Iterate over lines in the text box
 static inline void prv_walk_lines_down(Iterator* const line_iter, TextLayout* const layout,
+                                       TextLineCacheEntry* const line_cache,
                                        WalkLinesCallbacks* const callbacks) {
   LineIterState* line_iter_state = (LineIterState*) line_iter->state;
   GContext* ctx = line_iter_state->ctx;
@@ -1279,6 +1431,9 @@ static inline void prv_walk_lines_down(Iterator* const line_iter, TextLayout* co
 render_line: {} // this {} is just an empty statement that both C and our linter accepts
     const bool is_text_remaining = line_add_words(
         line, &line_iter_state->word_iter, callbacks->last_line_cb);
+    if (line_cache) {
+      prv_line_cache_record(line_cache, line, text_box_params);
+    }
     // NOTE: Account for descender - assume descender is no more than half the line height
     const int16_t line_spacing_delta = prv_layout_get_line_spacing_delta(layout);
     const int32_t line_max_y = line->origin.y + line->height_px +
@@ -1311,7 +1466,7 @@ render_line: {} // this {} is just an empty statement that both C and our linter
 
     if (callbacks->stop_condition_cb) {
       if (callbacks->stop_condition_cb(ctx, line, text_box_params)) {
-        break;
+        return;
       }
     }
 
@@ -1322,6 +1477,11 @@ render_line: {} // this {} is just an empty statement that both C and our linter
     // Shouldn't have rendered the line if there was insufficient space
     PBL_ASSERTN(iter_next(line_iter));
   }
+
+  // Every line that fits in the box was laid out
+  if (line_cache) {
+    line_cache->is_complete = !line_cache->is_truncated;
+  }
 }
 
 ////////////////////////////////////////////////////////////
@@ -1519,6 +1679,22 @@ static inline void prv_text_walk_lines(GContext* ctx, TextLayout* const layout,
     callbacks->last_line_cb = NULL;
   }
 
+  TextLineCacheEntry *line_cache = NULL;
+  if (prv_line_cache_is_usable(layout, text_box)) {
+    const uint32_t text_hash = text_box->text_hash;
+    TextLineCache *cache = &ctx->text_draw_state.line_cache;
+    line_cache = prv_line_cache_find(cache, text_box, text_hash);
+    if (line_cache && prv_line_cache_replay(line_cache, layout, ctx, callbacks)) {
+      return;
+    }
+    // Either not laid out yet or the cached lines stop short of where this walk goes, lay the
+    // text out again and remember the lines
+    if (!line_cache) {
+      line_cache = prv_line_cache_get_lru(cache);
+    }
+    prv_line_cache_entry_reset(cache, line_cache, text_box, text_hash);
+  }
+
   ctx->text_draw_state.line = (Line) {
     .start = utf8_bounds->start,
     // set initial bounding values for line
@@ -1530,7 +1706,7 @@ static inline void prv_text_walk_lines(GContext* ctx, TextLayout* const layout,
   Iterator line_iter;
   line_iter_init(&line_iter, &ctx->text_draw_state.line_iter_state, ctx);
 
-  prv_walk_lines_down(&line_iter, layout, callbacks);
+  prv_walk_lines_down(&line_iter, layout, line_cache, callbacks);
 }
 
 static void prv_graphics_text_layout_update(GContext* ctx, const char* text, GFont const font,
@@ -1540,16 +1716,14 @@ static void prv_graphics_text_layout_update(GContext* ctx, const char* text, GFo
   PBL_ASSERTN(layout);
 
   bool success = false;
-  const Utf8Bounds utf8_bounds = utf8_get_bounds(&success, text);
+  uint32_t text_hash = 0;
+  const Utf8Bounds utf8_bounds = utf8_get_bounds_and_hash(&success, text, &text_hash);
   if (!success) {
     layout->max_used_size = GSizeZero;
     PBL_LOG_DBG("Invalid UTF8");
     return;
   }
 
-  int str_len_bytes = (utf8_bounds.end - utf8_bounds.start);
-  Codepoint text_hash = hash((const uint8_t*) utf8_bounds.start, str_len_bytes);
-
   if (prv_text_layout_is_fresh(layout, font, box, overflow_mode, alignment, text_hash)) {
     return;
   }
@@ -1573,6 +1747,7 @@ static void prv_graphics_text_layout_update(GContext* ctx, const char* text, GFo
     .overflow_mode = overflow_mode,
     .alignment = alignment,
     .line_spacing_delta = line_spacing_delta,
+    .text_hash = text_hash,
   };
 
   prv_text_walk_lines(ctx, layout, &callbacks);
@@ -1633,7 +1808,8 @@ void graphics_draw_text(GContext* ctx, const char* text, GFont const font,
   }
 
   bool success = false;
-  const Utf8Bounds utf8_bounds = utf8_get_bounds(&success, text);
+  uint32_t text_hash = 0;
+  const Utf8Bounds utf8_bounds = utf8_get_bounds_and_hash(&success, text, &text_hash);
   if (!success) {
     PBL_LOG_DBG("Invalid UTF8");
     return;
@@ -1667,6 +1843,7 @@ void graphics_draw_text(GContext* ctx, const char* text, GFont const font,
     .overflow_mode = overflow_mode,
     .alignment = alignment,
     .line_spacing_delta = line_spacing_delta,
+    .text_hash = text_hash,
   };
 
   prv_text_walk_lines(ctx, layout, &callbacks);
@@ -20,6 +20,7 @@ typedef struct {
   GTextOverflowMode overflow_mode;
   GTextAlignment alignment;
   int16_t line_spacing_delta;
+  uint32_t text_hash; //<! hash() of the bytes between utf8_bounds start and end
 } TextBoxParams;
 
 //! Parameters required to render a line 
@@ -32,6 +33,54 @@ typedef struct {
   Codepoint suffix_codepoint;
 } Line;
 
+//! Number of texts a graphics context remembers the line breaks of
+#define TEXT_LINE_CACHE_NUM_ENTRIES (8)
+
+//! Maximum number of lines remembered per text, a text with more lines is laid out again unless
+//! only its first lines get drawn
+#define TEXT_LINE_CACHE_MAX_LINES (8)
+
+//! Start offset of a cached line that has no start, see line_add_words()
+#define TEXT_LINE_CACHE_NO_START (UINT16_MAX)
+
+//! A line as line_add_words() laid it out, relative to the text and the text box
+typedef struct {
+  uint16_t start_offset; //<! Byte offset of the line in the text
+  int16_t origin_x; //<! Relative to the text box origin, after alignment
+  int16_t width_px;
+  uint16_t suffix_codepoint; //<! Hyphen or ellipsis, if any
+} TextCachedLine;
+
+//! The lines of a text laid out in a box. They only depend on the parameters below and not on
+//! where the box is, line y coordinates follow from the line height.
+typedef struct {
+  //! Invalidate the lines if these parameters have changed
+  uint32_t text_hash;
+  uint16_t text_length;
+  int16_t line_spacing_delta;
+  GSize box_size;
+  GFont font;
+  uint32_t font_resource_id;
+  GTextOverflowMode overflow_mode;
+  GTextAlignment alignment;
+
+  //! Whether the lines are all the lines that fit in the box. Otherwise they are the lines down to
+  //! where the walk that laid them out stopped.
+  bool is_complete;
+  //! Whether the walk laid out more lines than fit in lines[]
+  bool is_truncated;
+  uint8_t num_lines;
+  uint16_t last_used;
+  TextCachedLine lines[TEXT_LINE_CACHE_MAX_LINES];
+} TextLineCacheEntry;
+
+//! Line breaks of the texts last laid out with a graphics context, so that drawing or measuring
+//! an unchanged text doesn't look up the metrics of its glyphs again
+typedef struct {
+  uint16_t clock;
+  TextLineCacheEntry entries[TEXT_LINE_CACHE_NUM_ENTRIES];
+} TextLineCache;
+
 //! Definition of a word:
 //!  "A brown   dog\njumps" becomes:
 //!   - "A"
@@ -83,6 +132,7 @@ typedef struct {
   TextBoxParams text_box;
   Line line;
   LineIterState line_iter_state;
+  TextLineCache line_cache;
 } TextDrawState;
 
 void char_iter_init(Iterator* char_iter, CharIterState* char_iter_state, const TextBoxParams* const text_box_params, utf8_t* start);
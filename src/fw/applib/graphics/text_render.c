@@ -5,6 +5,8 @@
 
 #include "gcontext.h"
 #include "graphics.h"
+#include "applib/applib_malloc.auto.h"
+#include "kernel/pebble_tasks.h"
 #include "process_state/app_state/app_state.h"
 #include "system/passert.h"
 #include "text_resources.h"
@@ -48,6 +50,85 @@ T_STATIC int32_t prv_convert_1bit_addr_to_8bit_x(GBitmap *dest_bitmap, uint32_t
 }
 #endif
 
+#ifdef CONFIG_TEXT_GLYPH_ATLAS
+//! The app's atlas is allocated on the app heap the first time the app draws a glyph that goes in
+//! it, rather than taking up the app runtime RAM of every app. Only system apps get one, see
+//! app_state_configure().
+static GlyphAtlas *prv_get_glyph_atlas(GContext *ctx) {
+  FontCache *font_cache = &ctx->font_cache;
+  if (font_cache->glyph_atlas || (pebble_task_get_current() != PebbleTask_App) ||
+      (ctx != app_state_get_graphics_context())) {
+    return font_cache->glyph_atlas;
+  }
+
+  TextRenderState *state = app_state_get_text_render_state();
+  if (state->glyph_atlas_unavailable) {
+    return NULL;
+  }
+  GlyphAtlas *atlas = applib_type_malloc(GlyphAtlas);
+  if (!atlas) {
+    state->glyph_atlas_unavailable = true;
+    return NULL;
+  }
+  text_resources_init_glyph_atlas(atlas);
+  font_cache->glyph_atlas = atlas;
+  return atlas;
+}
+
+//! Draws a glyph that's already expanded to one byte per pixel, each row is a masked copy
+static void prv_render_atlas_glyph(GContext *ctx, const GlyphAtlasEntry *entry,
+                                   const GRect cursor) {
+  const GlyphHeaderData *header = &entry->header;
+  const GRect glyph_target = {
+    .origin = { .x = cursor.origin.x + header->left_offset_px,
+                .y = cursor.origin.y + header->top_offset_px },
+    .size = { .w = header->width_px, .h = header->height_px },
+  };
+  GRect clipped_glyph_target = glyph_target;
+  grect_clip(&clipped_glyph_target, &ctx->draw_state.clip_box);
+  if (clipped_glyph_target.size.h == 0 || clipped_glyph_target.size.w == 0) {
+    return;
+  }
+
+  GBitmap *dest_bitmap = graphics_context_get_bitmap(ctx);
+  const uint8_t *glyph_pixels = &ctx->font_cache.glyph_atlas->pixels[entry->offset];
+  // Blending only makes a difference for a translucent color, an opaque one replaces the pixel
+  const bool blend = (ctx->draw_state.compositing_mode == GCompOpSet) &&
+                     (ctx->draw_state.text_color.a != 3);
+  GColor color = ctx->draw_state.text_color;
+  color.a = 3;
+
+  const int16_t max_y = grect_get_max_y(&clipped_glyph_target);
+  for (int16_t y = clipped_glyph_target.origin.y; y < max_y; y++) {
+    const GBitmapDataRowInfo data_row = gbitmap_get_data_row_info(dest_bitmap, y);
+    const int16_t min_x = MAX(clipped_glyph_target.origin.x, data_row.min_x);
+    const int16_t max_x = MIN(grect_get_max_x(&clipped_glyph_target) - 1, data_row.max_x);
+    if (min_x > max_x) {
+      continue;
+    }
+
+    const uint8_t *mask = glyph_pixels + ((y - glyph_target.origin.y) * glyph_target.size.w) +
+                          (min_x - glyph_target.origin.x);
+    uint8_t *dest = data_row.data + min_x;
+    const int16_t num_pixels = max_x - min_x + 1;
+    if (blend) {
+      for (int16_t i = 0; i < num_pixels; i++) {
+        if (mask[i]) {
+          dest[i] = gcolor_alpha_blend(ctx->draw_state.text_color,
+                                       (GColor) { .argb = dest[i] }).argb;
+        }
+      }
+    } else {
+      for (int16_t i = 0; i < num_pixels; i++) {
+        dest[i] = (dest[i] & ~mask[i]) | (color.argb & mask[i]);
+      }
+    }
+  }
+
+  graphics_context_mark_dirty_rect(ctx, clipped_glyph_target);
+}
+#endif
+
 // PRO TIP: if you have to modify this function, expect to waste the rest of your day on it
 void render_glyph(GContext* const ctx, const uint32_t codepoint, FontInfo* const font,
                   const GRect cursor) {
@@ -60,6 +141,17 @@ void render_glyph(GContext* const ctx, const uint32_t codepoint, FontInfo* const
     return;
   }
 
+#ifdef CONFIG_TEXT_GLYPH_ATLAS
+  if (text_resources_is_atlas_glyph(codepoint, font) && prv_get_glyph_atlas(ctx)) {
+    const GlyphAtlasEntry *atlas_entry = text_resources_get_atlas_glyph(&ctx->font_cache,
+                                                                        codepoint, font);
+    if (atlas_entry) {
+      prv_render_atlas_glyph(ctx, atlas_entry, cursor);
+      return;
+    }
+  }
+#endif
+
   const GlyphData* glyph = text_resources_get_glyph(&ctx->font_cache, codepoint, font);
 
   PBL_ASSERTN(glyph);
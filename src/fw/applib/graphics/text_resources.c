@@ -292,6 +292,20 @@ static GlyphData *prv_decompress_glyph_data(GlyphData *g, uint8_t *src) {
   return g;
 }
 
+//! Number of bytes the glyph's bitmap takes up in the font resource
+static size_t prv_get_glyph_size_bytes(const FontResource *font_res,
+                                       const GlyphHeaderData *header) {
+  // Handle RLE4 compressed glyphs. header.height_px has been 'borrowed' to mean the number of
+  // 4-bit RLE units used to encode the glyph. We determine the height by decoding the number of
+  // bits and then dividing by the width. glyph.height_px must be updated!
+  if (HAS_FEATURE(font_res->md.version, VERSION_FIELD_FEATURE_RLE4)) {
+    // Two RLE4 units per byte. Round up to the next whole byte
+    return (header->num_rle_units + (RLE4_UNITS_PER_BYTE - 1)) / RLE4_UNITS_PER_BYTE;
+  }
+  // Number of bytes, make sure we round up to the next whole byte
+  return ((header->width_px * header->height_px) + (8 - 1)) / 8;
+}
+
 static bool prv_load_glyph_bitmap(Codepoint codepoint, const FontResource *font_res,
                                   LineCacheData *data) {
   GlyphData *g = &data->glyph_data;
@@ -300,18 +314,7 @@ static bool prv_load_glyph_bitmap(Codepoint codepoint, const FontResource *font_
                                sizeof(GlyphHeaderDataV1) : sizeof(GlyphHeaderData);
   const uint32_t bitmap_addr = data->resource_offset + bitmap_offset;
 
-  size_t glyph_size_bytes;
-
-  // Handle RLE4 compressed glyphs. header.height_px has been 'borrowed' to mean the number of
-  // 4-bit RLE units used to encode the glyph. We determine the height by decoding the number of
-  // bits and then dividing by the width. glyph.height_px must be updated!
-  if (HAS_FEATURE(font_res->md.version, VERSION_FIELD_FEATURE_RLE4)) {
-    // Two RLE4 units per byte. Round up to the next whole byte
-    glyph_size_bytes = (g->header.height_px + (RLE4_UNITS_PER_BYTE - 1)) / RLE4_UNITS_PER_BYTE;
-  } else {
-    // Number of bytes, make sure we round up to the next whole byte
-    glyph_size_bytes = ((g->header.width_px * g->header.height_px) + (8 - 1)) / 8;
-  }
+  const size_t glyph_size_bytes = prv_get_glyph_size_bytes(font_res, &g->header);
 
   PBL_ASSERT(glyph_size_bytes <= CACHE_GLYPH_SIZE,
              "text codepoint %"PRIx32" is %zu bytes, overflowing %zu max size", codepoint,
@@ -349,118 +352,331 @@ static bool prv_load_glyph_bitmap(Codepoint codepoint, const FontResource *font_
   return true;
 }
 
-static const GlyphData *prv_get_glyph_metadata_from_spi(Codepoint codepoint,
-                                                        FontCache *font_cache,
-                                                        const FontResource *font_res,
-                                                        bool need_bitmap) {
-  const uint32_t cache_key = prv_get_cache_key(font_res, codepoint);
-  LineCacheData *cached = NULL;
+///////////////////////////
+// Glyph cache
+
+_Static_assert((GLYPH_CACHE_NUM_ENTRIES & (GLYPH_CACHE_NUM_ENTRIES - 1)) == 0,
+               "GLYPH_CACHE_NUM_ENTRIES must be a power of two");
+_Static_assert(GLYPH_CACHE_NUM_ENTRIES <= UINT8_MAX, "num_entries is a uint8_t");
+_Static_assert(GLYPH_CACHE_NUM_BITMAPS < GLYPH_CACHE_NO_BITMAP, "bitmap_index is a uint8_t");
+_Static_assert(GLYPH_CACHE_MAX_PINNED < GLYPH_CACHE_MAX_LOAD,
+               "pinned glyphs can't take up the whole cache");
+
+static unsigned int prv_glyph_cache_home(uint32_t key) {
+  // Fibonacci hashing, the codepoint sits in the low bits of the key and the multiplication
+  // spreads it over the middle bits
+  return ((key * 2654435769u) >> 16) & (GLYPH_CACHE_NUM_ENTRIES - 1);
+}
 
-  // If we don't have bitmap caching, we have a single glyph_buffer that contains the last used
-  // glyph. If this matches the glyph we're looking for right now, that's what we want to use.
-  // Potentially this also has the bitmap loaded already.
-  if (font_cache->glyph_buffer_key == cache_key) {
-    cached = (LineCacheData *)(font_cache->glyph_buffer);
+static unsigned int prv_glyph_cache_next(unsigned int index) {
+  return (index + 1) & (GLYPH_CACHE_NUM_ENTRIES - 1);
+}
+
+static GlyphCacheEntry *prv_glyph_cache_find(GlyphCache *cache, uint32_t key) {
+  // The table is never full, so the probe always ends on an unused entry
+  for (unsigned int index = prv_glyph_cache_home(key); cache->entries[index].is_used;
+       index = prv_glyph_cache_next(index)) {
+    if (cache->entries[index].key == key) {
+      return &cache->entries[index];
+    }
   }
-  PBL_LOG_D_DBG(LOG_DOMAIN_TEXT, "looking up cp: %"PRIx32", key:%"PRIx32,
-            codepoint, cache_key);
+  return NULL;
+}
+
+static void prv_glyph_cache_free_bitmap(GlyphCache *cache, uint8_t bitmap_index) {
+  if (bitmap_index != GLYPH_CACHE_NO_BITMAP) {
+    cache->bitmaps[bitmap_index].is_used = false;
+  }
+}
 
-  // If the glyph_buffer doesn't match this glyph, or we have bitmap caching, check the
-  // keyed_circular_cache for this glyph.
-  if (!cached) {
-    cached = keyed_circular_cache_get(&font_cache->line_cache, cache_key);
-    // The keyed_circular_cache entry cannot store the bitmap.
-    // Therefore, we need to copy the matched entry into `glyph_buffer` which does have the space
-    // to store the bitmap.
-    if (cached) {
-      memcpy(font_cache->glyph_buffer, cached, sizeof(LineCacheData));
-      font_cache->glyph_buffer_key = cache_key;
-      // Point `cached` at the glyph buffer.
-      cached = (LineCacheData *)(font_cache->glyph_buffer);
-      cached->is_bitmap_loaded = false;
+//! Removes the entry and shifts back the entries after it that were pushed past it when they
+//! were inserted, so lookups don't need tombstones
+static void prv_glyph_cache_remove(GlyphCache *cache, unsigned int index) {
+  prv_glyph_cache_free_bitmap(cache, cache->entries[index].bitmap_index);
+  if (cache->entries[index].is_pinned) {
+    cache->num_pinned--;
+  }
+  cache->num_entries--;
+
+  unsigned int hole = index;
+  for (unsigned int next = prv_glyph_cache_next(hole); cache->entries[next].is_used;
+       next = prv_glyph_cache_next(next)) {
+    // The entry can fill the hole if the hole is between its home and where it is now
+    const unsigned int home = prv_glyph_cache_home(cache->entries[next].key);
+    const unsigned int mask = GLYPH_CACHE_NUM_ENTRIES - 1;
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      cache->entries[hole] = cache->entries[next];
+      hole = next;
     }
   }
+  cache->entries[hole].is_used = false;
+}
 
-  if (cached) {
-    if (cached->resource_offset == 0) {
-      // missing character
-      return NULL;
+static void prv_glyph_cache_evict_lru(GlyphCache *cache) {
+  int lru_index = -1;
+  uint16_t lru_age = 0;
+  for (unsigned int i = 0; i < GLYPH_CACHE_NUM_ENTRIES; i++) {
+    const GlyphCacheEntry *entry = &cache->entries[i];
+    if (!entry->is_used || entry->is_pinned) {
+      continue;
     }
-    if (need_bitmap &&
-        !cached->is_bitmap_loaded &&
-        !prv_load_glyph_bitmap(codepoint, font_res, cached)) {
-      return NULL;
+    const uint16_t age = cache->clock - entry->last_used;
+    if ((lru_index < 0) || (age > lru_age)) {
+      lru_index = i;
+      lru_age = age;
     }
-    return &cached->glyph_data;
   }
+  // There are always unpinned entries to evict, pinned ones can only take up part of the cache
+  PBL_ASSERTN(lru_index >= 0);
+  prv_glyph_cache_remove(cache, lru_index);
+  cache->stats.evictions++;
+}
 
-  // We missed the cache, so we need to build a new cache entry.
-  LineCacheData *data = &font_cache->cache_data_scratch;
-  data->is_bitmap_loaded = false;
-  data->resource_offset = prv_get_glyph_data_offset(codepoint, font_cache, font_res);
-  GlyphData *g = &data->glyph_data;
+static bool prv_glyph_should_pin(const FontResource *font_res, Codepoint codepoint) {
+  // The letters and digits of the system fonts make up most of the text drawn on the watch
+  if (font_res->app_num != SYSTEM_APP) {
+    return false;
+  }
+  return ((codepoint >= '0') && (codepoint <= '9')) ||
+         ((codepoint >= 'A') && (codepoint <= 'Z')) ||
+         ((codepoint >= 'a') && (codepoint <= 'z'));
+}
 
-  if (data->resource_offset == 0) {
+static GlyphCacheEntry *prv_glyph_cache_insert(GlyphCache *cache, uint32_t key, bool pin) {
+  if (cache->num_entries >= GLYPH_CACHE_MAX_LOAD) {
+    prv_glyph_cache_evict_lru(cache);
+  }
+
+  unsigned int index = prv_glyph_cache_home(key);
+  while (cache->entries[index].is_used) {
+    index = prv_glyph_cache_next(index);
+  }
+
+  pin = pin && (cache->num_pinned < GLYPH_CACHE_MAX_PINNED);
+  cache->num_entries++;
+  if (pin) {
+    cache->num_pinned++;
+  }
+  GlyphCacheEntry *entry = &cache->entries[index];
+  *entry = (GlyphCacheEntry) {
+    .key = key,
+    .is_used = true,
+    .is_pinned = pin,
+    .bitmap_index = GLYPH_CACHE_NO_BITMAP,
+  };
+  return entry;
+}
+
+//! Finds room for a decoded bitmap. The least recently used bitmap is taken, preferring the ones
+//! of glyphs that aren't pinned.
+static uint8_t prv_glyph_cache_get_bitmap_slot(GlyphCache *cache) {
+  int lru_index = -1;
+  uint16_t lru_age = 0;
+  bool lru_is_pinned = true;
+  for (uint8_t i = 0; i < GLYPH_CACHE_NUM_BITMAPS; i++) {
+    const GlyphCacheBitmap *bitmap = &cache->bitmaps[i];
+    if (!bitmap->is_used) {
+      return i;
+    }
+    const uint16_t age = cache->clock - bitmap->last_used;
+    if ((lru_index < 0) || (lru_is_pinned && !bitmap->is_pinned) ||
+        ((lru_is_pinned == bitmap->is_pinned) && (age > lru_age))) {
+      lru_index = i;
+      lru_age = age;
+      lru_is_pinned = bitmap->is_pinned;
+    }
+  }
+
+  GlyphCacheEntry *owner = prv_glyph_cache_find(cache, cache->bitmaps[lru_index].key);
+  if (owner) {
+    owner->bitmap_index = GLYPH_CACHE_NO_BITMAP;
+  }
+  cache->bitmaps[lru_index].is_used = false;
+  return lru_index;
+}
+
+//! Reads the metrics of a glyph from flash
+//! @param[out] resource_offset offset of the glyph in the font, 0 if the font doesn't have it
+//! @return false if the metrics couldn't be read
+static bool prv_read_glyph_header(Codepoint codepoint, FontCache *font_cache,
+                                  const FontResource *font_res, uint32_t *resource_offset,
+                                  GlyphHeaderData *header) {
+  *resource_offset = prv_get_glyph_data_offset(codepoint, font_cache, font_res);
+  if (*resource_offset == 0) {
     PBL_LOG_D_DBG(LOG_DOMAIN_TEXT, "offset for cp: %"PRIx32" is NULL", codepoint);
-    // Put the missing character into our cache so we don't waste time looking for it again
-    keyed_circular_cache_push(&font_cache->line_cache, cache_key, data);
-    return NULL;
+    return true;
   }
 
   size_t num_bytes_loaded;
   if (FONT_VERSION(font_res->md.version) == FONT_VERSION_1) {
-    GlyphHeaderDataV1 header;
+    GlyphHeaderDataV1 header_v1;
     PBL_LOG_D_DBG(LOG_DOMAIN_TEXT, "LGMD READ: offset: %"PRIx32", bytes: %zu",
-              data->resource_offset, sizeof(header));
+              *resource_offset, sizeof(header_v1));
     SYS_PROFILER_NODE_START(text_render_flash);
     num_bytes_loaded = sys_resource_load_range(font_res->app_num, font_res->resource_id,
-                                               data->resource_offset, (uint8_t *)&header,
-                                               sizeof(header));
+                                               *resource_offset, (uint8_t *)&header_v1,
+                                               sizeof(header_v1));
     SYS_PROFILER_NODE_STOP(text_render_flash);
 
     // convert to a GlyphHeaderData struct
-    memcpy(&g->header, &header, sizeof(GlyphHeaderData));
-    g->header.horiz_advance = header.horiz_advance;
+    memcpy(header, &header_v1, sizeof(GlyphHeaderData));
+    header->horiz_advance = header_v1.horiz_advance;
   } else {
     PBL_LOG_D_DBG(LOG_DOMAIN_TEXT, "GMD read: cp: %"PRIx32", offset: %"PRId32", bytes: %zu", codepoint,
-              data->resource_offset, sizeof(GlyphHeaderData));
+              *resource_offset, sizeof(GlyphHeaderData));
     SYS_PROFILER_NODE_START(text_render_flash);
     num_bytes_loaded = sys_resource_load_range(font_res->app_num, font_res->resource_id,
-                                               data->resource_offset, (uint8_t *)&g->header,
+                                               *resource_offset, (uint8_t *)header,
                                                sizeof(GlyphHeaderData));
     SYS_PROFILER_NODE_STOP(text_render_flash);
   }
 
   if (!num_bytes_loaded) {
     PBL_LOG_WRN("Failed to load glyph metadata from resources; cp: %"PRIx32", offset: %"PRIx32,
-            codepoint, data->resource_offset);
+            codepoint, *resource_offset);
+    return false;
+  }
+  return true;
+}
+
+//! Reads the metrics of a glyph that isn't cached from flash and caches them
+static GlyphCacheEntry *prv_glyph_cache_load(Codepoint codepoint, FontCache *font_cache,
+                                             const FontResource *font_res, uint32_t cache_key) {
+  GlyphCache *cache = font_cache->glyph_cache;
+  uint32_t resource_offset;
+  GlyphHeaderData header;
+  if (!prv_read_glyph_header(codepoint, font_cache, font_res, &resource_offset, &header)) {
+    return NULL;
+  }
+
+  if (resource_offset == 0) {
+    // Put the missing character into our cache so we don't waste time looking for it again
+    return prv_glyph_cache_insert(cache, cache_key, false /* pin */);
+  }
+
+  GlyphCacheEntry *entry = prv_glyph_cache_insert(cache, cache_key,
+                                                  prv_glyph_should_pin(font_res, codepoint));
+  entry->resource_offset = resource_offset;
+  entry->header = header;
+  return entry;
+}
+
+static const GlyphData *prv_get_glyph_bitmap(Codepoint codepoint, FontCache *font_cache,
+                                             const FontResource *font_res,
+                                             GlyphCacheEntry *entry) {
+  GlyphCache *cache = font_cache->glyph_cache;
+
+  // Glyphs without a bitmap, like spaces, don't need anything past the header
+  if (prv_get_glyph_size_bytes(font_res, &entry->header) == 0) {
+    cache->stats.bitmap_hits++;
+    return (const GlyphData *)&entry->header;
+  }
+
+  if (entry->bitmap_index != GLYPH_CACHE_NO_BITMAP) {
+    GlyphCacheBitmap *bitmap = &cache->bitmaps[entry->bitmap_index];
+    bitmap->last_used = cache->clock;
+    cache->stats.bitmap_hits++;
+    return (const GlyphData *)bitmap->glyph;
+  }
+
+  // Glyphs too big for the bitmap cache are only kept in glyph_buffer until the next one is decoded
+  LineCacheData *data = (LineCacheData *)font_cache->glyph_buffer;
+  if ((font_cache->glyph_buffer_key == entry->key) && data->is_bitmap_loaded) {
+    cache->stats.bitmap_hits++;
+    return &data->glyph_data;
+  }
+
+  cache->stats.bitmap_misses++;
+  // Decode into glyph_buffer, which has room for the biggest glyph and its encoded data. Loading
+  // the bitmap may modify the header, so the cache entry keeps its own copy.
+  data->resource_offset = entry->resource_offset;
+  data->is_bitmap_loaded = false;
+  data->glyph_data.header = entry->header;
+  font_cache->glyph_buffer_key = entry->key;
+  if (!prv_load_glyph_bitmap(codepoint, font_res, data)) {
     return NULL;
   }
 
-  // Copy the info into the glyph_buffer.
-  // This must be done _before_ loading the bitmap, otherwise loading the bitmap may modify the
-  // metadata! We will use `glyph_buffer` as the final data, and leave `data` as the uncooked
-  // version, that way we can push `data` into the circular cache.
-  memcpy(font_cache->glyph_buffer, data, sizeof(LineCacheData));
-  font_cache->glyph_buffer_key = cache_key;
+  const GlyphHeaderData *header = &data->glyph_data.header;
+  const size_t bitmap_size_bytes = ((header->width_px * header->height_px) + (8 - 1)) / 8;
+  if (bitmap_size_bytes > GLYPH_CACHE_BITMAP_SIZE) {
+    return &data->glyph_data;
+  }
 
-  LineCacheData *final_data = (LineCacheData *)(font_cache->glyph_buffer);
+  const uint8_t bitmap_index = prv_glyph_cache_get_bitmap_slot(cache);
+  GlyphCacheBitmap *bitmap = &cache->bitmaps[bitmap_index];
+  bitmap->key = entry->key;
+  bitmap->last_used = cache->clock;
+  bitmap->is_used = true;
+  bitmap->is_pinned = entry->is_pinned;
+  memcpy(bitmap->glyph, &data->glyph_data, sizeof(GlyphHeaderData) + bitmap_size_bytes);
+  entry->bitmap_index = bitmap_index;
+  return (const GlyphData *)bitmap->glyph;
+}
 
-  if (need_bitmap &&
-      !prv_load_glyph_bitmap(codepoint, font_res, final_data)) {
+//! Looks up a glyph for a font cache without a glyph cache, only the last glyph read is kept in
+//! the glyph_buffer
+static const GlyphData *prv_get_glyph_uncached(Codepoint codepoint, FontCache *font_cache,
+                                               const FontResource *font_res, uint32_t cache_key,
+                                               bool need_bitmap) {
+  LineCacheData *data = (LineCacheData *)font_cache->glyph_buffer;
+  if (font_cache->glyph_buffer_key != cache_key) {
+    uint32_t resource_offset;
+    GlyphHeaderData header;
+    if (!prv_read_glyph_header(codepoint, font_cache, font_res, &resource_offset, &header)) {
+      return NULL;
+    }
+    data->resource_offset = resource_offset;
+    data->is_bitmap_loaded = false;
+    data->glyph_data.header = header;
+    font_cache->glyph_buffer_key = cache_key;
+  }
+
+  if (data->resource_offset == 0) {
+    // missing character
     return NULL;
   }
+  if (need_bitmap && !data->is_bitmap_loaded &&
+      !prv_load_glyph_bitmap(codepoint, font_res, data)) {
+    return NULL;
+  }
+  return &data->glyph_data;
+}
 
-  // We push `data`, which will be cooked data if the bitmap is stored along with it, or
-  // the uncooked data if it's not. In reality, this only matters to compressed glyphs, since
-  // compressed glyphs are the only case where the metadata gets modified.
-  // The only time the data is cooked is when loading a bitmap and the glyph is compressed, in
-  // which case the `num_rle_units` field is turned back into `height_px`.
-  keyed_circular_cache_push(&font_cache->line_cache, cache_key, data);
+static const GlyphData *prv_get_glyph_metadata_from_spi(Codepoint codepoint,
+                                                        FontCache *font_cache,
+                                                        const FontResource *font_res,
+                                                        bool need_bitmap) {
+  GlyphCache *cache = font_cache->glyph_cache;
+  const uint32_t cache_key = prv_get_cache_key(font_res, codepoint);
+  PBL_LOG_D_DBG(LOG_DOMAIN_TEXT, "looking up cp: %"PRIx32", key:%"PRIx32,
+            codepoint, cache_key);
 
-  // We return `final_data` though, because that has the actual metadata info that needs to be
-  // used.
-  return &final_data->glyph_data;
+  if (!cache) {
+    return prv_get_glyph_uncached(codepoint, font_cache, font_res, cache_key, need_bitmap);
+  }
+
+  GlyphCacheEntry *entry = prv_glyph_cache_find(cache, cache_key);
+  if (entry) {
+    cache->stats.hits++;
+  } else {
+    cache->stats.misses++;
+    entry = prv_glyph_cache_load(codepoint, font_cache, font_res, cache_key);
+    if (!entry) {
+      return NULL;
+    }
+  }
+  entry->last_used = ++cache->clock;
+
+  if (entry->resource_offset == 0) {
+    // missing character
+    return NULL;
+  }
+  if (!need_bitmap) {
+    // Only the metrics are needed, which the entry's header has
+    return (const GlyphData *)&entry->header;
+  }
+  return prv_get_glyph_bitmap(codepoint, font_cache, font_res, entry);
 }
 
 static void prv_check_font_cache(FontCache *font_cache, const FontResource *font_res) {
@@ -561,6 +777,23 @@ static void prv_resource_changed_callback(void *data) {
 
 ///////////////////////////
 // Public API
+void text_resources_init_font_cache(FontCache *font_cache, GlyphCache *glyph_cache) {
+  if (glyph_cache) {
+    *glyph_cache = (GlyphCache) {};
+  }
+  font_cache->glyph_cache = glyph_cache;
+  font_cache->glyph_buffer_key = 0;
+  ((LineCacheData *)font_cache->glyph_buffer)->is_bitmap_loaded = false;
+}
+
+void text_resources_get_glyph_cache_stats(const FontCache *font_cache, GlyphCacheStats *stats) {
+  if (!font_cache->glyph_cache) {
+    *stats = (GlyphCacheStats) {};
+    return;
+  }
+  *stats = font_cache->glyph_cache->stats;
+}
+
 bool text_resources_init_font(ResAppNum app_num, uint32_t font_resource,
                               uint32_t extended_resource, FontInfo *font_info) {
   // load the base of the font or bail
@@ -642,8 +875,9 @@ static const GlyphData *prv_get_glyph(FontCache *font_cache, Codepoint codepoint
   return NULL;
 }
 
-int8_t text_resources_get_glyph_horiz_advance(FontCache *font_cache, const Codepoint codepoint,
-                                              FontInfo *font_info) {
+MOCKABLE int8_t text_resources_get_glyph_horiz_advance(FontCache *font_cache,
+                                                       const Codepoint codepoint,
+                                                       FontInfo *font_info) {
   // Metadata only: measuring must not pay the deep bitmap load; render pre-loads it in walk_line().
   const GlyphData *g = prv_get_glyph(font_cache, codepoint, font_info, false /* need_bitmap */);
   if (!g) {
@@ -656,3 +890,83 @@ const GlyphData *text_resources_get_glyph(FontCache *font_cache, const Codepoint
                                           FontInfo *font_info) {
   return prv_get_glyph(font_cache, codepoint, font_info, true /* need_bitmap */);
 }
+
+#ifdef CONFIG_TEXT_GLYPH_ATLAS
+///////////////////////////
+// Glyph atlas
+
+_Static_assert((GLYPH_ATLAS_NUM_ENTRIES & (GLYPH_ATLAS_NUM_ENTRIES - 1)) == 0,
+               "GLYPH_ATLAS_NUM_ENTRIES must be a power of two");
+_Static_assert(CONFIG_TEXT_GLYPH_ATLAS_SIZE <= UINT16_MAX, "atlas offsets are a uint16_t");
+
+static unsigned int prv_glyph_atlas_home(uint32_t key) {
+  return ((key * 2654435769u) >> 16) & (GLYPH_ATLAS_NUM_ENTRIES - 1);
+}
+
+void text_resources_init_glyph_atlas(GlyphAtlas *glyph_atlas) {
+  memset(glyph_atlas, 0, sizeof(*glyph_atlas));
+}
+
+bool text_resources_is_atlas_glyph(Codepoint codepoint, const FontInfo *font_info) {
+  // Latin glyphs of the system fonts never change while the firmware runs, unlike the glyphs that
+  // come from language packs or app resources
+  return font_info->loaded && (font_info->base.app_num == SYSTEM_APP) &&
+         codepoint_is_latin(codepoint);
+}
+
+const GlyphAtlasEntry *text_resources_get_atlas_glyph(FontCache *font_cache, Codepoint codepoint,
+                                                      FontInfo *font_info) {
+  GlyphAtlas *atlas = font_cache->glyph_atlas;
+  if (!atlas || !text_resources_is_atlas_glyph(codepoint, font_info)) {
+    return NULL;
+  }
+
+  const uint32_t key = prv_get_cache_key(&font_info->base, codepoint);
+  unsigned int index = prv_glyph_atlas_home(key);
+  for (; atlas->entries[index].is_used; index = (index + 1) & (GLYPH_ATLAS_NUM_ENTRIES - 1)) {
+    if (atlas->entries[index].key == key) {
+      atlas->stats.hits++;
+      return &atlas->entries[index];
+    }
+  }
+
+  const GlyphData *glyph = text_resources_get_glyph(font_cache, codepoint, font_info);
+  if (!glyph) {
+    return NULL;
+  }
+  const unsigned int num_pixels = glyph->header.width_px * glyph->header.height_px;
+  if (num_pixels > GLYPH_ATLAS_MAX_GLYPH_PIXELS) {
+    return NULL;
+  }
+
+  if ((atlas->num_entries >= GLYPH_ATLAS_MAX_LOAD) ||
+      ((atlas->pixels_used + num_pixels) > CONFIG_TEXT_GLYPH_ATLAS_SIZE)) {
+    // Start over, the glyphs that are drawn from now on fill it up again
+    memset(atlas->entries, 0, sizeof(atlas->entries));
+    atlas->num_entries = 0;
+    atlas->pixels_used = 0;
+    atlas->stats.resets++;
+    index = prv_glyph_atlas_home(key);
+  }
+
+  GlyphAtlasEntry *entry = &atlas->entries[index];
+  *entry = (GlyphAtlasEntry) {
+    .key = key,
+    .offset = atlas->pixels_used,
+    .is_used = true,
+    .header = glyph->header,
+  };
+
+  // Bit n of the glyph is the pixel at (n % width_px, n / width_px)
+  const uint8_t *bits = (const uint8_t *)glyph->data;
+  uint8_t *pixels = &atlas->pixels[atlas->pixels_used];
+  for (unsigned int i = 0; i < num_pixels; i++) {
+    pixels[i] = (bits[i / 8] & (1 << (i % 8))) ? 0xff : 0;
+  }
+
+  atlas->pixels_used += num_pixels;
+  atlas->num_entries++;
+  atlas->stats.misses++;
+  return entry;
+}
+#endif
@@ -5,7 +5,7 @@
 
 #include "applib/fonts/fonts_private.h"
 #include "applib/fonts/codepoint.h"
-#include "pbl/util/keyed_circular_cache.h"
+#include "pbl/util/attributes.h"
 
 #include <stdint.h>
 
@@ -75,7 +75,125 @@ typedef struct {
   };
 } LineCacheData;
 
-#define LINE_CACHE_SIZE 30
+//! Number of glyphs whose metrics are cached. Must be a power of two, the cache is an open
+//! addressed hash table.
+#if !defined(GLYPH_CACHE_NUM_ENTRIES)
+  #define GLYPH_CACHE_NUM_ENTRIES CONFIG_TEXT_GLYPH_CACHE_ENTRIES
+#endif
+
+//! Number of decoded glyph bitmaps that are cached along with the metrics
+#if !defined(GLYPH_CACHE_NUM_BITMAPS)
+  #define GLYPH_CACHE_NUM_BITMAPS CONFIG_TEXT_GLYPH_CACHE_BITMAPS
+#endif
+
+//! Largest decoded bitmap that is cached, in bytes. Bigger glyphs only live in the glyph_buffer.
+#if !defined(GLYPH_CACHE_BITMAP_SIZE)
+  #define GLYPH_CACHE_BITMAP_SIZE 32
+#endif
+
+//! How many of the entries can be taken by pinned glyphs, the letters and digits of the system
+//! fonts. Pinned glyphs are never evicted. Set to 0 to disable pinning.
+#if !defined(GLYPH_CACHE_MAX_PINNED)
+  #define GLYPH_CACHE_MAX_PINNED (GLYPH_CACHE_NUM_ENTRIES / 4)
+#endif
+
+//! The table is never filled more than this, to keep the probe sequences short
+#define GLYPH_CACHE_MAX_LOAD ((GLYPH_CACHE_NUM_ENTRIES * 3) / 4)
+
+#define GLYPH_CACHE_NO_BITMAP (UINT8_MAX)
+
+typedef struct GlyphCacheEntry {
+  uint32_t key;
+  //! Offset of the glyph in the font resource, 0 if the font doesn't have the glyph
+  uint32_t resource_offset;
+  uint16_t last_used;
+  bool is_used:1;
+  bool is_pinned:1;
+  //! Index into the bitmaps holding the decoded glyph or GLYPH_CACHE_NO_BITMAP
+  uint8_t bitmap_index;
+  //! The header as stored in the font, height_px is still num_rle_units for RLE4 glyphs
+  GlyphHeaderData header;
+} GlyphCacheEntry;
+
+typedef struct GlyphCacheBitmap {
+  //! Key of the entry this bitmap belongs to
+  uint32_t key;
+  uint16_t last_used;
+  bool is_used:1;
+  //! Bitmaps of pinned glyphs are only taken for other glyphs once all of them are pinned
+  bool is_pinned:1;
+  //! A GlyphData with the decoded bitmap. The extra word is there because glyphs are drawn by
+  //! reading whole words of the bitmap.
+  uint8_t glyph[sizeof(GlyphHeaderData) + GLYPH_CACHE_BITMAP_SIZE + sizeof(uint32_t)];
+} GlyphCacheBitmap;
+
+typedef struct GlyphCacheStats {
+  //! Glyph metrics that were served from the cache
+  uint32_t hits;
+  //! Glyph metrics that had to be read from flash
+  uint32_t misses;
+  //! Glyph bitmaps that were served from the cache
+  uint32_t bitmap_hits;
+  //! Glyph bitmaps that had to be read from flash and decoded
+  uint32_t bitmap_misses;
+  //! Glyphs dropped to make room for others
+  uint32_t evictions;
+} GlyphCacheStats;
+
+//! Metrics and bitmaps of recently used glyphs. The kernel and the app each have one, graphics
+//! contexts without one read every glyph from flash.
+typedef struct GlyphCache {
+  GlyphCacheEntry entries[GLYPH_CACHE_NUM_ENTRIES];
+  GlyphCacheBitmap bitmaps[GLYPH_CACHE_NUM_BITMAPS];
+  //! Bumped on every lookup, entries and bitmaps with the oldest stamp are evicted first
+  uint16_t clock;
+  uint8_t num_entries;
+  uint8_t num_pinned;
+  GlyphCacheStats stats;
+} GlyphCache;
+
+#ifdef CONFIG_TEXT_GLYPH_ATLAS
+//! Number of glyphs an atlas can index. Must be a power of two, the index is an open addressed
+//! hash table.
+#if !defined(GLYPH_ATLAS_NUM_ENTRIES)
+  #define GLYPH_ATLAS_NUM_ENTRIES 128
+#endif
+
+//! The index is never filled more than this, to keep the probe sequences short
+#define GLYPH_ATLAS_MAX_LOAD ((GLYPH_ATLAS_NUM_ENTRIES * 3) / 4)
+
+//! Glyphs bigger than this, in pixels, are drawn from their bits rather than take up the atlas
+#define GLYPH_ATLAS_MAX_GLYPH_PIXELS (CONFIG_TEXT_GLYPH_ATLAS_SIZE / 8)
+
+typedef struct GlyphAtlasEntry {
+  uint32_t key;
+  //! Offset of the glyph's pixels in the atlas
+  uint16_t offset;
+  bool is_used;
+  //! The decoded header, height_px is the height even for RLE4 glyphs
+  GlyphHeaderData header;
+} GlyphAtlasEntry;
+
+typedef struct GlyphAtlasStats {
+  //! Glyphs that were drawn from the atlas
+  uint32_t hits;
+  //! Glyphs that were expanded into the atlas
+  uint32_t misses;
+  //! Times the atlas was full and started over
+  uint32_t resets;
+} GlyphAtlasStats;
+
+//! Latin glyphs of the system fonts, expanded to one byte per pixel: 0xff where the glyph is
+//! drawn and 0 elsewhere. Drawing them is a masked copy of each row into an 8-bit framebuffer.
+//! Glyphs are added as they're drawn until the atlas is full, then it starts over.
+typedef struct GlyphAtlas {
+  GlyphAtlasEntry entries[GLYPH_ATLAS_NUM_ENTRIES];
+  uint16_t num_entries;
+  uint16_t pixels_used;
+  GlyphAtlasStats stats;
+  uint8_t pixels[CONFIG_TEXT_GLYPH_ATLAS_SIZE];
+} GlyphAtlas;
+#endif
 
 // Allow 1K max for offset tables
 #define OFFSET_TABLE_MAX_SIZE (1024)
@@ -91,26 +209,47 @@ typedef struct FontCache {
     OffsetTableEntry_4_2 offsets_buffer_4_2[OFFSET_TABLE_MAX_SIZE / sizeof(OffsetTableEntry_4_2)];
     OffsetTableEntry_4_4 offsets_buffer_4_4[OFFSET_TABLE_MAX_SIZE / sizeof(OffsetTableEntry_4_4)];
   };
-  //! line_cache's backing storage for keys
-  KeyedCircularCacheKey cache_keys[LINE_CACHE_SIZE];
-  //! line_cache's backing storage for data
-  LineCacheData cache_data[LINE_CACHE_SIZE];
-  //! some scratch space so we don't need to create a LineCacheData on the stack
-  LineCacheData cache_data_scratch;
-
-  //! cache_key for the last used glyph
+  //! Metrics and bitmaps of recently used glyphs, NULL if this context doesn't have a cache
+  GlyphCache *glyph_cache;
+
+  //! cache_key for the last decoded glyph
   uint32_t glyph_buffer_key;
-  //! data for the last used glyph
+  //! data for the last decoded glyph, also where glyphs get decoded
   uint8_t glyph_buffer[sizeof(LineCacheData) + CACHE_GLYPH_SIZE];
-  KeyedCircularCache line_cache;
   const FontResource *cached_font;
+#ifdef CONFIG_TEXT_GLYPH_ATLAS
+  //! Where glyphs get expanded for drawing, NULL if this context doesn't have an atlas
+  GlyphAtlas *glyph_atlas;
+#endif
 } FontCache;
 
+//! Empties the font cache and the glyph cache and clears its stats
+//! @param glyph_cache where the font cache keeps recently used glyphs, NULL to read every glyph
+//! from flash
+void text_resources_init_font_cache(FontCache *font_cache, GlyphCache *glyph_cache);
+
+void text_resources_get_glyph_cache_stats(const FontCache *font_cache, GlyphCacheStats *stats);
+
+#ifdef CONFIG_TEXT_GLYPH_ATLAS
+//! @return whether the glyph is one an atlas holds, a latin glyph of a loaded system font
+bool text_resources_is_atlas_glyph(Codepoint codepoint, const FontInfo *font_info);
+
+//! Looks up a glyph in the font cache's atlas, expanding it into the atlas if it isn't there yet.
+//! The glyph's pixels are at glyph_atlas->pixels[entry->offset], one row of width_px after the
+//! other.
+//! @return NULL if the glyph isn't one the atlas holds, it has to be drawn from its bits
+const GlyphAtlasEntry *text_resources_get_atlas_glyph(FontCache *font_cache, Codepoint codepoint,
+                                                      FontInfo *font_info);
+
+//! Empties the atlas and clears its stats
+void text_resources_init_glyph_atlas(GlyphAtlas *glyph_atlas);
+#endif
+
 const GlyphData *text_resources_get_glyph(FontCache *font_cache, Codepoint codepoint,
                                           FontInfo *font_info);
 
-int8_t text_resources_get_glyph_horiz_advance(FontCache *font_cache, Codepoint codepoint,
-                                              FontInfo *font_info);
+MOCKABLE int8_t text_resources_get_glyph_horiz_advance(FontCache *font_cache,
+                                                       Codepoint codepoint, FontInfo *font_info);
 
 //! Initialize a FontInfo struct with resource contents
 //! A FontInfo contains references to up to *two* font resources: a "base" font and an "extension".
@@ -3,6 +3,7 @@
 #include "system/passert.h"
 #include "system/logging.h"
 
+#include "pbl/util/attributes.h"
 #include "pbl/util/iterator.h"
 #include "pbl/util/math.h"
 #include "pbl/util/size.h"
@@ -150,8 +151,9 @@ utf8_t *utf8_get_previous(utf8_t *start, utf8_t *stream) {
 ////////////////////////////////////////////////////////////
 // Public API
 
-//! Return NULL if not successful in decoding text
-utf8_t *utf8_get_end(const char *text) {
+//! Return NULL if not successful in decoding text. Also hashes the text like hash() does if
+//! text_hash isn't NULL, so callers that need both don't read the text twice.
+static ALWAYS_INLINE utf8_t *prv_get_end(const char *text, uint32_t *text_hash) {
   if (text == NULL) {
     return (utf8_t *) text;
   }
@@ -159,9 +161,13 @@ utf8_t *utf8_get_end(const char *text) {
   uint8_t *stream = (uint8_t *) text;
   uint32_t codepoint = 0;
   uint8_t state = 0;
+  uint32_t hash = 5381; // DJB2
 
   while (*stream) {
     utf8_decode(&state, &codepoint, *stream);
+    if (text_hash) {
+      hash = ((hash << 5) + hash) + *stream;
+    }
     stream++;
   }
 
@@ -170,20 +176,27 @@ utf8_t *utf8_get_end(const char *text) {
     return NULL;
   }
 
+  if (text_hash) {
+    *text_hash = hash;
+  }
   return (utf8_t *) stream;
 }
 
+utf8_t *utf8_get_end(const char *text) {
+  return prv_get_end(text, NULL);
+}
+
 
 bool utf8_is_valid_string(const char *char_stream) {
   return (utf8_get_end(char_stream) != NULL);
 }
 
-Utf8Bounds utf8_get_bounds(bool *const success, char const  *text) {
+static Utf8Bounds prv_get_bounds(bool *const success, char const *text, uint32_t *text_hash) {
   Utf8Bounds bounds;
   bounds.start = (utf8_t *) text;
   bounds.end = bounds.start;
 
-  utf8_t *end = utf8_get_end(text);
+  utf8_t *end = prv_get_end(text, text_hash);
 
   if (NULL == end) {
     *success = false;
@@ -195,6 +208,15 @@ Utf8Bounds utf8_get_bounds(bool *const success, char const  *text) {
   return bounds;
 }
 
+Utf8Bounds utf8_get_bounds(bool *const success, char const  *text) {
+  return prv_get_bounds(success, text, NULL);
+}
+
+Utf8Bounds utf8_get_bounds_and_hash(bool *const success, char const *text,
+                                    uint32_t *const text_hash) {
+  return prv_get_bounds(success, text, text_hash);
+}
+
 bool utf8_bounds_init(Utf8Bounds *bounds, const char *text) {
   bounds->start = (utf8_t *) text;
   bounds->end = bounds->start;
@@ -83,6 +83,11 @@ typedef struct {
 
 Utf8Bounds utf8_get_bounds(bool *const success, char const *text);
 
+//! Same as \ref utf8_get_bounds(), and hashes the text with hash() in the same pass
+//! @param[out] text_hash hash of the bytes of the text, only set on success
+Utf8Bounds utf8_get_bounds_and_hash(bool *const success, char const *text,
+                                    uint32_t *const text_hash);
+
 void utf8_iter_init(Iterator *utf8_iter, Utf8IterState *utf8_iter_state, Utf8Bounds const  *bounds, utf8_t *start);
 
 bool utf8_iter_next(IteratorState state);
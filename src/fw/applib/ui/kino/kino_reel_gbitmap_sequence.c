@@ -5,6 +5,7 @@
 
 #include "applib/applib_malloc.auto.h"
 #include "applib/graphics/gbitmap_sequence.h"
+#include "kernel/pebble_tasks.h"
 #include "syscall/syscall.h"
 #include "system/logging.h"
 #include "pbl/util/struct.h"
@@ -132,5 +133,12 @@ KinoReel *kino_reel_gbitmap_sequence_create_with_resource_system(ResAppNum app_n
   if (sequence == NULL) {
     return NULL;
   }
+#if CONFIG_APNG_FRAME_CACHE_SIZE
+  // The kernel heap is too small to keep frames around, only animations of the app are cached.
+  // If the budget doesn't apply, the frames just get decoded on every loop.
+  if (pebble_task_get_current() == PebbleTask_App) {
+    gbitmap_sequence_set_frame_cache_budget(sequence, CONFIG_APNG_FRAME_CACHE_SIZE);
+  }
+#endif
   return kino_reel_gbitmap_sequence_create(sequence, true);
 }
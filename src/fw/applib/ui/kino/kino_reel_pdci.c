@@ -4,6 +4,8 @@
 #include "kino_reel_pdci.h"
 
 #include "applib/applib_malloc.auto.h"
+#include "applib/graphics/gdraw_command_prepared.h"
+#include "kernel/pebble_tasks.h"
 #include "syscall/syscall.h"
 #include "pbl/util/struct.h"
 
@@ -11,6 +13,10 @@ typedef struct {
   KinoReel base;
   GDrawCommandImage *image;
   bool owns_image;
+#if CONFIG_PDC_PREPARED_SIZE
+  //! Created on the first unprocessed draw on the app task
+  GDrawCommandPrepared *prepared;
+#endif
 } KinoReelImplPDCI;
 
 static void prv_destructor(KinoReel *reel) {
@@ -18,6 +24,9 @@ static void prv_destructor(KinoReel *reel) {
   if (dci_reel->owns_image) {
     gdraw_command_image_destroy(dci_reel->image);
   }
+#if CONFIG_PDC_PREPARED_SIZE
+  gdraw_command_prepared_destroy(dci_reel->prepared);
+#endif
 
   applib_free(dci_reel);
 }
@@ -25,9 +34,25 @@ static void prv_destructor(KinoReel *reel) {
 static void prv_draw_processed_func(KinoReel *reel, GContext *ctx, GPoint offset,
                                     KinoReelProcessor *processor) {
   KinoReelImplPDCI *dci_reel = (KinoReelImplPDCI *)reel;
+  GDrawCommandProcessor *draw_command_processor =
+      NULL_SAFE_FIELD_ACCESS(processor, draw_command_processor, NULL);
+
+#if CONFIG_PDC_PREPARED_SIZE
+  // Processors may change the commands on every draw, only unprocessed images of the app are
+  // prepared. The kernel heap has no room to keep them around.
+  if (!draw_command_processor && (pebble_task_get_current() == PebbleTask_App)) {
+    if (!dci_reel->prepared) {
+      dci_reel->prepared = gdraw_command_prepared_create(CONFIG_PDC_PREPARED_SIZE);
+    }
+    if (dci_reel->prepared) {
+      const GSize size = gdraw_command_image_get_bounds_size(dci_reel->image);
+      gdraw_command_image_draw_prepared(ctx, dci_reel->image, offset, size, dci_reel->prepared);
+      return;
+    }
+  }
+#endif
 
-  gdraw_command_image_draw_processed(
-    ctx, dci_reel->image, offset, NULL_SAFE_FIELD_ACCESS(processor, draw_command_processor, NULL));
+  gdraw_command_image_draw_processed(ctx, dci_reel->image, offset, draw_command_processor);
 }
 
 static GSize prv_get_size(KinoReel *reel) {
@@ -77,13 +77,30 @@ void layer_destroy(Layer* layer) {
   applib_free(layer);
 }
 
+//! Schedules a render of the layer's window that updates the part of the screen the layer covers
+static void prv_schedule_render(Layer *layer) {
+  Window *window = layer->window;
+  if (!window) {
+    return;
+  }
+  if ((layer == &window->layer) || !layer->clips) {
+    // Layers that don't clip can draw anywhere
+    window_schedule_render(window);
+    return;
+  }
+  // Same as layer_get_global_frame() but the layer's own bounds don't move its frame
+  const GRect screen_frame = {
+    .origin = layer_convert_point_to_screen(layer->parent, layer->frame.origin),
+    .size = layer->frame.size,
+  };
+  window_schedule_render_rect(window, &screen_frame);
+}
+
 void layer_mark_dirty(Layer *layer) {
   if (layer->property_changed_proc) {
     layer->property_changed_proc(layer);
   }
-  if (layer->window) {
-    window_schedule_render(layer->window);
-  }
+  prv_schedule_render(layer);
 }
 
 static bool layer_process_tree_level(Layer *node, void *ctx, LayerIteratorFunc iterator_func);
@@ -156,6 +173,10 @@ Layer *__layer_tree_traverse_next__test_accessor(Layer *stack[],
 void layer_render_tree(Layer *node, GContext *ctx) {
   // NOTE: make sure to restore ctx->draw_state before leaving this function
   const GDrawState root_draw_state = ctx->draw_state;
+  const LayerTreeLevel root_level = {
+    .clip_box = root_draw_state.clip_box,
+    .drawing_origin = root_draw_state.drawing_box.origin,
+  };
   uint8_t current_depth = 0;
 
   // We render our layout tree using a stack as opposed to using recursion to optimize for task
@@ -163,10 +184,13 @@ void layer_render_tree(Layer *node, GContext *ctx) {
   // up when doing a few common operations. We don't want to allocate this on the app heap as we
   // didn't before and that would cause less RAM to be available to apps after a firmware upgrade.
   Layer **stack;
+  LayerTreeLevel *levels;
   if (pebble_task_get_current() == PebbleTask_App) {
     stack = app_state_get_layer_tree_stack();
+    levels = app_state_get_layer_tree_levels();
   } else {
     stack = kernel_applib_get_layer_tree_stack();
+    levels = kernel_applib_get_layer_tree_levels();
   }
   stack[0] = node;
 
@@ -175,32 +199,33 @@ void layer_render_tree(Layer *node, GContext *ctx) {
     if (node->hidden) {
       goto node_hidden_do_not_descend;
     }
-    // prepare draw_state for the current layer
-    // it will not be stored and restored but recalculated from the root
-    // for every layer
-    for (unsigned int level = 0; level <= current_depth; level++) {
-      const Layer *levels_layer = stack[level];
-      if (levels_layer->clips) {
-        const GRect levels_layer_frame_in_ctx_space = {
-            .origin = {
-                // drawing_box is expected to be setup as the bounds of the parent:
-                .x = ctx->draw_state.drawing_box.origin.x + levels_layer->frame.origin.x,
-                .y = ctx->draw_state.drawing_box.origin.y + levels_layer->frame.origin.y,
-            },
-            .size = levels_layer->frame.size,
-        };
-        grect_clip(&ctx->draw_state.clip_box, &levels_layer_frame_in_ctx_space);
-      }
-
-      // translate the drawing_box to the bounds of the layer:
-      ctx->draw_state.drawing_box.origin.x +=
-          levels_layer->frame.origin.x + levels_layer->bounds.origin.x;
-      ctx->draw_state.drawing_box.origin.y +=
-          levels_layer->frame.origin.y + levels_layer->bounds.origin.y;
-      ctx->draw_state.drawing_box.size = levels_layer->bounds.size;
+    // prepare the draw state for the current layer from the one of its parent, which was stored
+    // in levels[] when the parent was rendered
+    const LayerTreeLevel *parent_level =
+        (current_depth > 0) ? &levels[current_depth - 1] : &root_level;
+    LayerTreeLevel *level = &levels[current_depth];
+    level->clip_box = parent_level->clip_box;
+    if (node->clips) {
+      const GRect frame_in_ctx_space = {
+        // the parent's drawing origin is the origin of its bounds:
+        .origin = gpoint_add(parent_level->drawing_origin, node->frame.origin),
+        .size = node->frame.size,
+      };
+      grect_clip(&level->clip_box, &frame_in_ctx_space);
     }
+    // translate the drawing origin to the bounds of the layer:
+    level->drawing_origin = gpoint_add(parent_level->drawing_origin,
+                                       gpoint_add(node->frame.origin, node->bounds.origin));
+
+    // The clip box of the children is within the one of their parent, if it's empty the whole
+    // subtree is outside of the area that is being rendered
+    if (!grect_is_empty(&level->clip_box)) {
+      ctx->draw_state.clip_box = level->clip_box;
+      ctx->draw_state.drawing_box = (GRect) {
+        .origin = level->drawing_origin,
+        .size = node->bounds.size,
+      };
 
-    if (!grect_is_empty(&ctx->draw_state.clip_box)) {
       // call the current node's render procedure
       if (node->update_proc) {
         node->update_proc(node, ctx);
@@ -239,6 +264,8 @@ void layer_set_frame(Layer *layer, const GRect *frame) {
   const bool bounds_in_sync = gpoint_equal(&layer->bounds.origin, &GPointZero) &&
                               gsize_equal(&layer->bounds.size, &layer->frame.size);
 
+  // The area the layer is moving away from needs to be redrawn too
+  prv_schedule_render(layer);
   layer->frame = *frame;
 
   if (bounds_in_sync && !process_manager_compiled_with_legacy2_sdk()) {
@@ -461,6 +488,8 @@ void layer_set_clips(Layer *layer, bool clips) {
   if (clips == layer->clips) {
     return;
   }
+  // Redraw what the layer might have drawn outside of its frame so far
+  prv_schedule_render(layer);
   layer->clips = clips;
   layer_mark_dirty(layer);
 }
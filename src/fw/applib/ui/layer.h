@@ -14,6 +14,16 @@ struct Animation;
 //! How deep our layer tree is allowed to be.
 #define LAYER_TREE_STACK_SIZE 16
 
+//! @internal
+//! Where a level of the layer tree draws, kept for each level of the tree while it's rendered so
+//! that a layer only has to apply its own frame and bounds on top of its parent's
+typedef struct LayerTreeLevel {
+  //! The clip box of the level's layer, in the coordinates of the graphics context
+  GRect clip_box;
+  //! The origin of the level's layer bounds, in the coordinates of the graphics context
+  GPoint drawing_origin;
+} LayerTreeLevel;
+
 //! @file layer.h
 //! @addtogroup UI
 //! @{
@@ -942,7 +942,8 @@ static void prv_menu_layer_update_selection_highlight(MenuLayer *menu_layer, boo
     if (change_ongoing_animation) {
       prv_cancel_selection_animation(menu_layer);
     }
-    // Move selection inverter layer:
+    // Move selection inverter layer, redrawing where the selection was as well:
+    layer_mark_dirty(&menu_layer->inverter.layer);
     const int16_t w = menu_layer->scroll_layer.layer.frame.size.w;
     const GSize size = GSize(w, menu_layer->selection.h);
     menu_layer->inverter.layer.bounds = (GRect) {
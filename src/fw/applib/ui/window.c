@@ -14,6 +14,7 @@
 #include "applib/ui/window_stack.h"
 #include "applib/applib_malloc.auto.h"
 #include "applib/legacy2/ui/status_bar_legacy2.h"
+#include "kernel/pebble_tasks.h"
 #include "kernel/ui/kernel_ui.h"
 #include "kernel/ui/modals/modal_manager.h"
 #include "process_management/process_manager.h"
@@ -109,6 +110,12 @@ void prv_render_legacy2_system_status_bar(GContext *ctx, Window *window) {
   }
 }
 
+//! Only apps track what they damage: their framebuffer is copied to the display piecewise, while
+//! kernel windows render straight into the compositor framebuffer.
+static bool prv_is_tracking_render_damage(void) {
+  return pebble_task_get_current() == PebbleTask_App;
+}
+
 void window_render(Window *window, GContext *ctx) {
   PBL_ASSERTN(window);
 
@@ -136,6 +143,15 @@ void window_render(Window *window, GContext *ctx) {
   window->is_render_scheduled = false;
 }
 
+void window_render_rect(Window *window, GContext *ctx, const GRect *rect) {
+  const GRect saved_clip_box = ctx->draw_state.clip_box;
+  grect_clip(&ctx->draw_state.clip_box, rect);
+
+  window_render(window, ctx);
+
+  ctx->draw_state.clip_box = saved_clip_box;
+}
+
 void window_call_handler(Window *window, WindowHandlerOffset handler_offset) {
   if (window == NULL) {
     return;
@@ -147,6 +163,14 @@ void window_call_handler(Window *window, WindowHandlerOffset handler_offset) {
 }
 
 void window_schedule_render(Window *window) {
+  const GRect screen = GRect(0, 0, DISP_COLS, DISP_ROWS);
+  window_schedule_render_rect(window, &screen);
+}
+
+void window_schedule_render_rect(Window *window, const GRect *rect) {
+  if (prv_is_tracking_render_damage()) {
+    gdirty_region_add(app_state_get_render_damage(), rect);
+  }
   window->is_render_scheduled = true;
 }
 
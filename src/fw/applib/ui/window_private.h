@@ -11,6 +11,21 @@
 //! @param window Pointer to the window to schedule
 void window_schedule_render(Window *window);
 
+//! Internal interface for glayer to schedule a render for the window that only needs to update
+//! part of the screen. Only rect, along with the other areas scheduled since the last render, is
+//! redrawn and copied to the display, see window_render_rect().
+//! @param window Pointer to the window to schedule
+//! @param rect The area to update, in screen coordinates
+void window_schedule_render_rect(Window *window, const GRect *rect);
+
+//! Renders the part of the window within rect, layers that are entirely outside of it are skipped.
+//! The rest of the graphics context is left as it is, it must still hold the last render of the
+//! window.
+//! @param window Pointer to the window to render
+//! @param ctx The graphics context to render to
+//! @param rect The area to redraw, in the coordinates of the graphics context
+void window_render_rect(Window *window, GContext *ctx, const GRect *rect);
+
 //! Setup the click config provider
 //! @param window Pointer to the window to setup the click config provider
 void window_setup_click_config_provider(Window *window);
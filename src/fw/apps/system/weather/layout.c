@@ -523,8 +523,9 @@ static void prv_up_animation_update(Animation *animation, AnimationProgress norm
     layout->animation_state.next_forecast = NULL;
   }
 
-  layout->root_layer.frame.origin.y = root_layer_top_margin;
-  layer_set_frame(&layout->root_layer, &layout->root_layer.frame);
+  GRect root_layer_frame = layout->root_layer.frame;
+  root_layer_frame.origin.y = root_layer_top_margin;
+  layer_set_frame(&layout->root_layer, &root_layer_frame);
 }
 
 static void prv_animation_stopped(Animation *animation, bool finished, void *context) {
@@ -100,14 +100,45 @@ typedef struct PPoGATTClient {
     uint8_t tx_window_size;
     uint8_t rx_window_size;
 
+    //! Timeout of the reset procedure
     AckTimeoutState ack_timeout_state;
 
     //! Number of consecutive timeouts so far
     uint8_t timeouts_counter;
+    //! Number of times in a row the last Ack'd packet got Ack'd again
+    uint8_t duplicate_acks_counter;
 
     uint8_t next_expected_ack_sn;
     uint8_t next_data_sn;
 
+    //! Congestion control (RFC 5681): the number of data packets allowed in flight, which never
+    //! exceeds tx_window_size. It grows by one per Ack'd packet up to the slow start threshold,
+    //! and by one per window of Ack'd packets after that.
+    uint8_t congestion_window;
+    uint8_t slow_start_threshold;
+    //! Number of packets Ack'd since the congestion window last grew past the threshold
+    uint8_t congestion_window_acked;
+
+    //! Round trip time estimation (RFC 6298). One data packet is timed at a time and retransmitted
+    //! packets are never timed, as their Ack can't be told apart from the original's (Karn).
+    bool is_timing_rtt;
+    bool has_rtt_estimate;
+    uint8_t rtt_sn;
+    RtcTicks rtt_start_ticks;
+    uint16_t srtt_ms;
+    uint16_t rttvar_ms;
+    //! The retransmission timeout of retransmit_timer. Backed off on timeouts, it goes back to the
+    //! estimate once packets get Ack'd again.
+    uint16_t rto_ms;
+
+    //! Selective retransmit, for servers with the enhanced throughput features. After a timeout
+    //! only the oldest packet in flight is retransmitted. The Ack for it tells whether the server
+    //! held on to the packets after it: if so, only the next missing packet is retransmitted,
+    //! until everything up to recovery_end_sn is Ack'd. Otherwise, it's back to go-back-N.
+    bool is_recovering;
+    bool is_retransmit_pending;
+    uint8_t recovery_end_sn;
+
     bool send_rx_ack_now; //! True if we want to flush the Ack immediately!
     uint8_t outstanding_rx_ack_count; //! Count of how many data packets we have yet to Ack
   } out;
@@ -121,6 +152,7 @@ typedef struct PPoGATTClient {
   bool disconnect_requested; //! True if the client requested a disconnect
 
   TimerID rx_ack_timer;   //! Timer to ensure Acks for data are dispatched regularly
+  TimerID retransmit_timer;  //! Timer to retransmit data packets that didn't get Ack'd in time
 
   //! Whether the PPoGATT server transports "System", "App" or "Hybrid" PP sessions.
   TransportDestination destination;
@@ -155,6 +187,7 @@ static bool s_rediscovery_requested_this_connection;
 
 static void prv_send_next_packets(PPoGATTClient *client);
 static void prv_start_reset(PPoGATTClient *client);
+static void prv_retransmit_timer_cb(void *data);
 static void prv_request_meta_rediscovery(PPoGATTClient *client);
 
 extern BTErrno gatt_client_discovery_rediscover_all(const BTDeviceInternal *device);
@@ -283,35 +316,170 @@ static void prv_clear_payload_sizes_up_to(PPoGATTClient *client,
 }
 
 // -------------------------------------------------------------------------------------------------
-// Ack Time-out related things.
-// The effective timeout duration will be between 2 and 3 seconds, depending on when in the second
-// the timeout is set (RegularTimer is used).
+// Congestion control related things.
+
+static void prv_init_congestion_control(PPoGATTClient *client) {
+  client->out.congestion_window =
+      MIN(PPOGATT_INITIAL_CONGESTION_WINDOW, client->out.tx_window_size);
+  client->out.slow_start_threshold = client->out.tx_window_size;
+  client->out.congestion_window_acked = 0;
+  client->out.duplicate_acks_counter = 0;
+  client->out.rto_ms = PPOGATT_INITIAL_RTO_MS;
+}
+
+static void prv_grow_congestion_window(PPoGATTClient *client, uint32_t num_packets_acked) {
+  uint32_t window = client->out.congestion_window;
+  if (window < client->out.slow_start_threshold) {
+    window = MIN(window + num_packets_acked, client->out.slow_start_threshold);
+  } else {
+    const uint32_t acked = client->out.congestion_window_acked + num_packets_acked;
+    client->out.congestion_window_acked = (acked >= window) ? (acked - window) : acked;
+    if (acked >= window) {
+      ++window;
+    }
+  }
+  client->out.congestion_window = MIN(window, client->out.tx_window_size);
+  if (client->out.congestion_window == client->out.tx_window_size) {
+    client->out.congestion_window_acked = 0;
+  }
+}
+
+//! A timeout starts over from a single packet, a loss detected by duplicate Acks halves the window
+static void prv_shrink_congestion_window(PPoGATTClient *client, bool is_timeout) {
+  const uint32_t threshold = MAX(prv_num_packets_in_flight(client) / 2,
+                                 PPOGATT_MIN_SLOW_START_THRESHOLD);
+  client->out.slow_start_threshold = MIN(threshold, client->out.tx_window_size);
+  client->out.congestion_window = is_timeout ? 1 : client->out.slow_start_threshold;
+  client->out.congestion_window_acked = 0;
+}
+
+static void prv_set_rto_from_rtt_estimate(PPoGATTClient *client) {
+  const uint32_t rto_ms = client->out.srtt_ms + 4 * client->out.rttvar_ms;
+  client->out.rto_ms = CLIP(rto_ms, PPOGATT_MIN_RTO_MS, PPOGATT_MAX_RTO_MS);
+}
+
+//! Updates the round trip time estimate, if the packet being timed is among the Ack'd ones
+static void prv_update_rtt_estimate(PPoGATTClient *client, uint32_t num_packets_acked) {
+  if (!client->out.is_timing_rtt ||
+      prv_sn_distance(client->out.next_expected_ack_sn, client->out.rtt_sn) >= num_packets_acked) {
+    // Without a new sample, an Ack still shows the link works again, drop the back off:
+    if (client->out.has_rtt_estimate) {
+      prv_set_rto_from_rtt_estimate(client);
+    }
+    return;
+  }
+  client->out.is_timing_rtt = false;
+
+  const RtcTicks elapsed_ticks = rtc_get_ticks() - client->out.rtt_start_ticks;
+  const int32_t rtt_ms = MIN(elapsed_ticks * 1000 / RTC_TICKS_HZ, PPOGATT_MAX_RTO_MS);
+  if (!client->out.has_rtt_estimate) {
+    client->out.srtt_ms = rtt_ms;
+    client->out.rttvar_ms = rtt_ms / 2;
+    client->out.has_rtt_estimate = true;
+  } else {
+    const int32_t delta_ms = ABS((int32_t)client->out.srtt_ms - rtt_ms);
+    client->out.rttvar_ms = (3 * client->out.rttvar_ms + delta_ms) / 4;
+    client->out.srtt_ms = (7 * client->out.srtt_ms + rtt_ms) / 8;
+  }
+  prv_set_rto_from_rtt_estimate(client);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Time-out related things.
+// Data packets time out through the retransmit_timer, after the timeout estimated from the round
+// trip times. The reset procedure times out through the RegularTimer: the effective timeout
+// duration will be between 2 and 3 ticks, depending on when in the tick the timeout is set.
 
 static void prv_reset_ack_timeout(PPoGATTClient *client) {
   client->out.ack_timeout_state = AckTimeoutState_Active;
 }
 
+static void prv_start_retransmit_timer(PPoGATTClient *client) {
+  new_timer_start(client->retransmit_timer, client->out.rto_ms, prv_retransmit_timer_cb, client,
+                  0 /* flags */);
+}
+
+static void prv_stop_retransmit_timer(PPoGATTClient *client) {
+  new_timer_stop(client->retransmit_timer);
+}
+
 static void prv_roll_back(PPoGATTClient *client, uint32_t sn) {
-  if (++client->out.timeouts_counter >= PPOGATT_TIMEOUT_COUNT_MAX) {
+  PBL_LOG_WRN("Rolling back from (%u, %u) to %"PRIu32,
+          client->out.next_data_sn, client->out.next_expected_ack_sn, sn);
+
+  // Go back and send again. The payload sizes of the packets are kept, to retransmit them with
+  // the same fragmentation.
+  client->out.next_data_sn = sn;
+  client->out.next_expected_ack_sn = sn;
+}
+
+static void prv_start_selective_retransmit(PPoGATTClient *client) {
+  PBL_LOG_WRN("Retransmitting %u (next data sn: %u)",
+              client->out.next_expected_ack_sn, client->out.next_data_sn);
+  if (!client->out.is_recovering) {
+    client->out.is_recovering = true;
+    client->out.recovery_end_sn = client->out.next_data_sn;
+  }
+  client->out.is_retransmit_pending = true;
+}
+
+static void prv_handle_retransmit_timeout(PPoGATTClient *client) {
+  // Only start counting once the timeout is backed off all the way:
+  if (client->out.rto_ms >= PPOGATT_MAX_RTO_MS &&
+      ++client->out.timeouts_counter >= PPOGATT_TIMEOUT_COUNT_MAX) {
     PBL_LOG_ERR("Resetting because max timeouts reached...");
     prv_start_reset(client);
     return;
   }
 
-  PBL_LOG_WRN("Rolling back from (%u, %u) to %"PRIu32,
-          client->out.next_data_sn, client->out.next_expected_ack_sn, sn);
+  // Back off the timeout and stop timing the packets in flight, they're all suspect now:
+  client->out.rto_ms = MIN(2 * (uint32_t)client->out.rto_ms, PPOGATT_MAX_RTO_MS);
+  client->out.is_timing_rtt = false;
 
-  // Go back and send again:
-  // No need to worry about the timeouts of these packets hitting, because prv_check_timeouts uses
-  // next_data_sn and next_expected_ack_sn to determine which packets can time-out.
-  client->out.next_data_sn = sn;
-  client->out.next_expected_ack_sn = sn;
-  prv_reset_ack_timeout(client);
+  // Take the loss as a sign of congestion:
+  prv_shrink_congestion_window(client, true /* is_timeout */);
+
+  if (prv_client_supports_enhanced_throughput_features(client)) {
+    prv_start_selective_retransmit(client);
+  } else {
+    prv_roll_back(client, client->out.next_expected_ack_sn);
+  }
+  prv_start_retransmit_timer(client);
 
   // Don't send from Timer task
   prv_send_next_packets_async(client);
 }
 
+static void prv_handle_fast_retransmit(PPoGATTClient *client) {
+  client->out.duplicate_acks_counter = 0;
+  client->out.is_timing_rtt = false;
+  prv_shrink_congestion_window(client, false /* is_timeout */);
+  prv_start_selective_retransmit(client);
+  prv_start_retransmit_timer(client);
+  prv_send_next_packets(client);
+}
+
+//! Handles an Ack during selective retransmit
+static void prv_handle_recovery_ack(PPoGATTClient *client, uint32_t num_packets_acked,
+                                    uint32_t next_sn) {
+  client->out.is_retransmit_pending = false;
+  const uint32_t num_packets_to_recover =
+      prv_sn_distance(client->out.next_expected_ack_sn, client->out.recovery_end_sn);
+  if (num_packets_acked >= num_packets_to_recover) {
+    // Everything that was in flight at the time-out made it
+    client->out.is_recovering = false;
+  } else if (num_packets_acked > 1) {
+    // The server held on to packets after the retransmitted one, retransmit the next missing one:
+    client->out.is_retransmit_pending = true;
+  } else {
+    // The server dropped the packets after the retransmitted one, go back and send them all again
+    // (prv_handle_ack() moves next_expected_ack_sn up to next_sn):
+    PBL_LOG_WRN("Rolling back from %u to %"PRIu32, client->out.next_data_sn, next_sn);
+    client->out.is_recovering = false;
+    client->out.next_data_sn = next_sn;
+  }
+}
+
 static bool prv_has_timeout(const PPoGATTClient *client) {
   return (client->out.ack_timeout_state != AckTimeoutState_Inactive &&
           client->out.ack_timeout_state >= AckTimeoutState_TimedOut);
@@ -331,17 +499,6 @@ static void prv_check_timeouts(PPoGATTClient *client) {
       PBL_LOG_WRN("Timed out waiting for Reset Complete, Resetting again...");
       prv_start_reset(client);
     }
-    return;
-  } else if (client->state == StateConnectedClosedAwaitingResetCompleteSelfInitiatedResetStalled) {
-    return;
-  }
-
-  uint8_t sn = client->out.next_expected_ack_sn;
-  if (prv_has_timeout(client)) {
-    prv_roll_back(client, sn);
-    // Return, because all packets after the timed-out one have been "rolled back" now,
-    // no point in continuing.
-    return;
   }
 }
 
@@ -360,7 +517,7 @@ static void prv_timer_callback(void *unused) {
 
 // -------------------------------------------------------------------------------------------------
 
-static PPoGATTClient *prv_create_client(TimerID timer) {
+static PPoGATTClient *prv_create_client(TimerID timer, TimerID retransmit_timer) {
   PPoGATTClient *client = kernel_malloc(sizeof(PPoGATTClient));
   if (!client) {
     return NULL;
@@ -368,6 +525,7 @@ static PPoGATTClient *prv_create_client(TimerID timer) {
   *client = (PPoGATTClient){};
   client->app_uuid = UUID_INVALID;
   client->rx_ack_timer = timer;
+  client->retransmit_timer = retransmit_timer;
   client->created_ticks = rtc_get_ticks();
   s_ppogatt_head = (PPoGATTClient *) list_prepend((ListNode *)s_ppogatt_head, &client->node);
   if (!regular_timer_is_scheduled(&s_ack_timer)) {
@@ -398,6 +556,7 @@ static void prv_delete_client(PPoGATTClient *client, bool is_disconnected, Delet
 
   list_remove(&client->node, (ListNode **) &s_ppogatt_head, NULL);
   new_timer_delete(client->rx_ack_timer);
+  new_timer_delete(client->retransmit_timer);
   kernel_free(client);
 
   if (s_ppogatt_head == NULL) {
@@ -477,6 +636,7 @@ static void prv_enter_awaiting_reset_complete(PPoGATTClient *client, bool self_i
   client->in.next_expected_data_sn = 0;
   // FIXME: Use SN for RR / RC (https://pebbletechnology.atlassian.net/browse/PBL-12424)
   client->out = (__typeof__(client->out)) {};
+  prv_stop_retransmit_timer(client);
 
   if (prv_client_supports_enhanced_throughput_features(client)) {
     // Set our desired window sizes
@@ -616,6 +776,8 @@ static void prv_handle_reset_complete(PPoGATTClient *client, const PPoGATTPacket
       client->out.rx_window_size = MIN(client->out.rx_window_size, payload->ppogatt_max_tx_window);
     }
   }
+  client->out.ack_timeout_state = AckTimeoutState_Inactive;
+  prv_init_congestion_control(client);
 
   {
     const uint32_t elapsed_ms =
@@ -630,17 +792,26 @@ static void prv_handle_reset_complete(PPoGATTClient *client, const PPoGATTPacket
 static void prv_handle_ack(PPoGATTClient *client, uint32_t sn) {
   if (prv_is_packet_with_sn_awaiting_ack(client, sn)) {
     client->out.timeouts_counter = 0;
-    client->out.ack_timeout_state = AckTimeoutState_Inactive;
+    client->out.duplicate_acks_counter = 0;
 
     // Ack'd one of the packets in flight
     const uint32_t next_sn = prv_next_sn(sn);
+    const uint32_t num_packets_acked = prv_sn_distance(client->out.next_expected_ack_sn, next_sn);
     const uint16_t num_bytes_acked = prv_total_num_bytes_awaiting_ack_up_to(client, next_sn);
     comm_session_send_queue_consume(client->session, num_bytes_acked);
 
-    // If next_data_sn is before the Ack'd sn, the packet pending retransmission has just been
-    // Ack'd. We can determine whether or not a packet is pending retransmission by checking if the
-    // payload size for next_data_sn is not 0. This means the packet has been enqueued to get sent
-    if (prv_is_packet_with_sn_awaiting_ack(client, client->out.next_data_sn)) {
+    prv_update_rtt_estimate(client, num_packets_acked);
+    if (client->out.is_recovering) {
+      prv_handle_recovery_ack(client, num_packets_acked, next_sn);
+    }
+    if (!client->out.is_recovering) {
+      prv_grow_congestion_window(client, num_packets_acked);
+    }
+
+    // If next_data_sn is before the Ack'd sn, packets pending retransmission after a roll back
+    // have just been Ack'd. Skip them, but keep retransmitting the ones after the Ack'd sn.
+    if (prv_sn_distance(client->out.next_expected_ack_sn,
+                        client->out.next_data_sn) < num_packets_acked) {
       client->out.next_data_sn = next_sn;
     }
 
@@ -651,7 +822,9 @@ static void prv_handle_ack(PPoGATTClient *client, uint32_t sn) {
     client->out.next_expected_ack_sn = next_sn;
 
     if (prv_get_payload_size_for_sn(client, next_sn) != 0) { // Still awaiting ACKs
-      prv_reset_ack_timeout(client);
+      prv_start_retransmit_timer(client);
+    } else {
+      prv_stop_retransmit_timer(client);
     }
 
     prv_send_next_packets(client);
@@ -659,7 +832,15 @@ static void prv_handle_ack(PPoGATTClient *client, uint32_t sn) {
     // Data we had sent got dropped causing the other side to re-ACK the last data it had received.
     // Don't roll back directly to avoid creating an Sorcerer's Apprentice bug
     // https://en.wikipedia.org/wiki/Sorcerer%27s_Apprentice_Syndrome
-    // We'll rely on the ACK timeout for the next data packet to fire and roll back.
+    // We'll rely on the ACK timeout for the next data packet to fire and roll back, unless
+    // the server supports selective retransmit: then only the missing packet is sent again, once.
+    if (prv_client_supports_enhanced_throughput_features(client) &&
+        !client->out.is_recovering &&
+        prv_is_packet_with_sn_awaiting_ack(client, client->out.next_expected_ack_sn) &&
+        ++client->out.duplicate_acks_counter >= PPOGATT_FAST_RETRANSMIT_DUPLICATE_ACKS) {
+      prv_handle_fast_retransmit(client);
+      return;
+    }
     PBL_LOG_WRN("Received retransmitted Ack for sn:%"PRIu32". Ignoring it.", sn);
   } else {
     PBL_LOG_ERR("Ack'd packet out of range %"PRIu32", [%u-%u].",
@@ -998,14 +1179,17 @@ void ppogatt_handle_service_discovered(BLECharacteristic *characteristics) {
   // when it's trying to acquire bt_lock, leading to a lock ordering deadlock.
   TimerID timer = new_timer_create();
   PBL_ASSERTN(timer);
+  TimerID retransmit_timer = new_timer_create();
+  PBL_ASSERTN(retransmit_timer);
 
   bt_lock();
   {
     // Create new clients:
-    PPoGATTClient *client = prv_create_client(timer);
+    PPoGATTClient *client = prv_create_client(timer, retransmit_timer);
     if (!client) {
       bt_unlock();
       new_timer_delete(timer);
+      new_timer_delete(retransmit_timer);
       return;
     }
     BLECharacteristic meta = characteristics[PPoGATTCharacteristicMeta];
@@ -1170,6 +1354,36 @@ static const PPoGATTPacket * prv_prepare_next_reset_packet(const PPoGATTClient *
 
 // -------------------------------------------------------------------------------------------------
 
+//! Number of send queue segments gathered at a time. A packet's payload usually spans one or two
+//! Pebble Protocol messages.
+#define PPOGATT_MAX_SEGMENTS_PER_GATHER (4)
+
+//! Gathers the payload of a data packet straight from the buffers of the send queue jobs.
+//! The GATT write needs the packet header in front of the payload, so this is the one copy the
+//! payload gets on its way out.
+//! @return The number of bytes gathered
+static size_t prv_gather_payload(CommSession *session, uint32_t offset, size_t payload_size,
+                                 uint8_t *payload_out) {
+  size_t gathered_size = 0;
+  while (gathered_size < payload_size) {
+    SessionSendQueueSegment segments[PPOGATT_MAX_SEGMENTS_PER_GATHER];
+    const size_t num_segments =
+        comm_session_send_queue_get_segments(session, offset + gathered_size,
+                                             payload_size - gathered_size, segments,
+                                             PPOGATT_MAX_SEGMENTS_PER_GATHER);
+    if (num_segments == 0) {
+      break;
+    }
+    for (size_t i = 0; i < num_segments; i++) {
+      memcpy(payload_out + gathered_size, segments[i].data, segments[i].length);
+      gathered_size += segments[i].length;
+    }
+  }
+  return gathered_size;
+}
+
+// -------------------------------------------------------------------------------------------------
+
 void rx_ack_timer_cb(void *data) {
   PPoGATTClient *client = (PPoGATTClient *)data;
   bt_lock();
@@ -1183,6 +1397,21 @@ void rx_ack_timer_cb(void *data) {
   bt_unlock();
 }
 
+static void prv_retransmit_timer_cb(void *data) {
+  PPoGATTClient *client = (PPoGATTClient *)data;
+  bt_lock();
+  {
+    // Make sure we didn't disconnect, reset or get the Ack in between. If the timer got started
+    // again, this is a stale callback:
+    if (prv_is_client_valid(client) && client->state == StateConnectedOpen &&
+        !new_timer_scheduled(client->retransmit_timer, NULL) &&
+        prv_is_packet_with_sn_awaiting_ack(client, client->out.next_expected_ack_sn)) {
+      prv_handle_retransmit_timeout(client);
+    }
+  }
+  bt_unlock();
+}
+
 static const PPoGATTPacket * prv_prepare_next_packet(PPoGATTClient *client,
                                                      PPoGATTPacket **heap_packet_in_out,
                                                      uint16_t *payload_size_out) {
@@ -1221,39 +1450,52 @@ static const PPoGATTPacket * prv_prepare_next_packet(PPoGATTClient *client,
   if (client->state != StateConnectedOpen) {
     return NULL;
   };
-  if (prv_num_packets_in_flight(client) >= client->out.tx_window_size) {
-    // Max number of data packets in flight, try again when we got some of them Ack'd.
-    return NULL;
-  }
-  uint16_t read_space = comm_session_send_queue_get_length(client->session);
-  if (read_space == 0) {
-    return NULL;
-  }
 
-  const uint16_t max_payload_size = prv_get_max_payload_size(client);
-  if (!max_payload_size) {
-    return NULL;
-  }
+  uint32_t sn;
+  uint16_t offset;
+  uint16_t payload_size;
+  if (client->out.is_retransmit_pending) {
+    // Selective retransmit of the oldest packet in flight, using the same fragmentation as the
+    // previous transmission. It doesn't take up an extra spot in the window.
+    sn = client->out.next_expected_ack_sn;
+    offset = 0;
+    payload_size = prv_get_payload_size_for_sn(client, sn);
+  } else {
+    if (prv_num_packets_in_flight(client) >= client->out.congestion_window) {
+      // Max number of data packets in flight, try again when we got some of them Ack'd.
+      return NULL;
+    }
+    uint16_t read_space = comm_session_send_queue_get_length(client->session);
+    if (read_space == 0) {
+      return NULL;
+    }
 
-  // Bytes that are awaiting an Ack, have already been handed to Bluetopia, but are still
-  // sitting in the send buffer, until they are Ack'd in case we need to retransmit them.
-  uint16_t offset = prv_total_num_bytes_awaiting_ack(client);
+    const uint16_t max_payload_size = prv_get_max_payload_size(client);
+    if (!max_payload_size) {
+      return NULL;
+    }
 
-  // If retransmitting, we need to use the same fragmentation as the previous transmission.
-  // The payload_sizes field will still contain the previously used size, unless it was zero'ed
-  // out because it got Ack'd.
-  uint16_t payload_size = prv_get_payload_size_for_sn(client, client->out.next_data_sn);
-  if (payload_size == 0) {
-    PBL_ASSERTN(read_space >= offset);
-    payload_size = read_space - offset;
+    // Bytes that are awaiting an Ack, have already been handed to Bluetopia, but are still
+    // sitting in the send buffer, until they are Ack'd in case we need to retransmit them.
+    sn = client->out.next_data_sn;
+    offset = prv_total_num_bytes_awaiting_ack(client);
 
+    // If retransmitting, we need to use the same fragmentation as the previous transmission.
+    // The payload_sizes field will still contain the previously used size, unless it was zero'ed
+    // out because it got Ack'd.
+    payload_size = prv_get_payload_size_for_sn(client, sn);
     if (payload_size == 0) {
-      // No data to send
-      return NULL;
-    }
+      PBL_ASSERTN(read_space >= offset);
+      payload_size = read_space - offset;
 
-    // Cap to the size that the GATT MTU allows:
-    payload_size = MIN(payload_size, max_payload_size);
+      if (payload_size == 0) {
+        // No data to send
+        return NULL;
+      }
+
+      // Cap to the size that the GATT MTU allows:
+      payload_size = MIN(payload_size, max_payload_size);
+    }
   }
 
   PPoGATTPacket *packet = prv_lazily_allocate_packet_if_needed(client, heap_packet_in_out);
@@ -1261,9 +1503,9 @@ static const PPoGATTPacket * prv_prepare_next_packet(PPoGATTClient *client,
     return NULL;
   }
   packet->type = PPoGATTPacketTypeData;
-  packet->sn = client->out.next_data_sn;
-  PBL_ASSERTN(comm_session_send_queue_copy(client->session, offset,
-                                           payload_size, packet->payload));
+  packet->sn = sn;
+  PBL_ASSERTN(prv_gather_payload(client->session, offset,
+                                 payload_size, packet->payload) == payload_size);
   *payload_size_out = payload_size;
   return packet;
 }
@@ -1277,11 +1519,20 @@ static void prv_finalize_queued_packet(PPoGATTClient *client, uint16_t payload_s
     client->out.ack_packet_byte = 0;
     client->out.send_rx_ack_now = false;
     client->out.outstanding_rx_ack_count = 0;
+  } else if (client->out.is_retransmit_pending) {
+    client->out.is_retransmit_pending = false;
+    prv_start_retransmit_timer(client);
   } else { // we are sending a data packet
     const uint32_t sn = client->out.next_data_sn;
+    if (!prv_is_packet_with_sn_awaiting_ack(client, sn) && !client->out.is_timing_rtt) {
+      // Time this packet, it isn't a retransmission:
+      client->out.is_timing_rtt = true;
+      client->out.rtt_sn = sn;
+      client->out.rtt_start_ticks = rtc_get_ticks();
+    }
     prv_set_payload_size_for_sn(client, sn, payload_size);
-    if (client->out.ack_timeout_state == AckTimeoutState_Inactive) {
-      prv_reset_ack_timeout(client); // Enable timeout if we don't already have it set
+    if (!new_timer_scheduled(client->retransmit_timer, NULL)) {
+      prv_start_retransmit_timer(client); // Enable timeout if we don't already have it set
     }
     client->out.next_data_sn = prv_next_sn(sn);
   }
@@ -1473,6 +1724,18 @@ uint32_t ppogatt_client_count(void) {
   return list_count((ListNode *) s_ppogatt_head);
 }
 
+TimerID ppogatt_get_retransmit_timer(Transport *transport) {
+  return ((PPoGATTClient *)transport)->retransmit_timer;
+}
+
+uint32_t ppogatt_get_retransmit_timeout_ms(Transport *transport) {
+  return ((PPoGATTClient *)transport)->out.rto_ms;
+}
+
+uint8_t ppogatt_get_congestion_window(Transport *transport) {
+  return ((PPoGATTClient *)transport)->out.congestion_window;
+}
+
 void ppogatt_trigger_rx_ack_send_timeout(void) {
   PPoGATTClient *client = s_ppogatt_head;
   while (client) {
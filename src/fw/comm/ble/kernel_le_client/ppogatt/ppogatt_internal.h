@@ -18,11 +18,28 @@
 #define PPOGATT_SN_MOD_DIV (1 << PPOGATT_SN_BITS)
 #define PPOGATT_V0_WINDOW_SIZE (4)
 #define PPOGATT_TIMEOUT_TICK_INTERVAL_SECS (2)
-//! Effective timeout: between 5 - 6 secs, because packet could be sent out just before the
-//! RegularTimer second tick is about to fire.
+//! Effective timeout of the reset procedure: between 5 - 6 secs, because the Reset Request could
+//! be sent out just before the RegularTimer second tick is about to fire.
 #define PPOGATT_TIMEOUT_TICKS (3)
 
-//! Number of maximum consecutive timeouts without getting a packet Ack'd
+//! Retransmission timeout of data packets, before a round trip time has been measured
+#define PPOGATT_INITIAL_RTO_MS (3000)
+//! Bounds of the retransmission timeout, as estimated from the round trip times (RFC 6298)
+#define PPOGATT_MIN_RTO_MS (500)
+#define PPOGATT_MAX_RTO_MS (6000)
+
+//! Number of data packets in flight the data transfer starts out with. The congestion window
+//! grows up to the negotiated TX window as packets get Ack'd, and shrinks when they time out.
+#define PPOGATT_INITIAL_CONGESTION_WINDOW (PPOGATT_V0_WINDOW_SIZE)
+//! Smallest slow start threshold a timeout can lower the congestion window's growth to
+#define PPOGATT_MIN_SLOW_START_THRESHOLD (2)
+//! Number of duplicate Acks after which the oldest packet in flight is retransmitted right away,
+//! instead of waiting for it to time out (RFC 5681 fast retransmit). Only with the enhanced
+//! throughput features, as it relies on selective retransmit.
+#define PPOGATT_FAST_RETRANSMIT_DUPLICATE_ACKS (3)
+
+//! Number of maximum consecutive timeouts without getting a packet Ack'd, once the timeout has
+//! backed off to PPOGATT_MAX_RTO_MS. The timeouts backing it off don't count.
 #define PPOGATT_TIMEOUT_COUNT_MAX (2)
 //! Number of maximum consecutive resets without getting a packet Ack'd
 #define PPOGATT_RESET_COUNT_MAX (5)
@@ -1264,6 +1264,7 @@ static GContext s_perftest_ctx = {};
 static GContext *prv_perftest_get_context(void) {
   GContext *ctx = &s_perftest_ctx;
   FrameBuffer *fb = compositor_get_framebuffer();
+  compositor_invalidate_framebuffer();
   memset(fb->buffer, 0xff, FRAMEBUFFER_SIZE_BYTES);
   graphics_context_init(ctx, fb, GContextInitializationMode_App);
   return ctx;
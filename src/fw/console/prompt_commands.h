@@ -48,6 +48,11 @@ extern void command_dump_malloc_kernel(void);
 extern void command_dump_malloc_app(void);
 extern void command_dump_malloc_worker(void);
 extern void command_dump_malloc_bt(void);
+extern void command_object_pool_stats(void);
+extern void command_heap_profile_start(void);
+extern void command_heap_profile_stop(void);
+extern void command_heap_profile_dump(void);
+extern void command_heap_profile_export(void);
 
 extern void command_read_word(const char*);
 
@@ -80,6 +85,7 @@ extern void command_flash_benchmark(void);
 extern void command_flash_validate(void);
 extern void command_flash_apicheck(const char *len);
 extern void command_flash_unprotect(void);
+extern void command_flash_cache_stats(void);
 //extern void command_flash_signal_test_init(void);
 //extern void command_flash_signal_test_run(void);
 extern void command_flash_show_erased_sectors(const char *arg);
@@ -482,12 +488,21 @@ static const Command s_prompt_commands[] = {
   */
   { "croak", command_croak, 0 },
 
+  { "pool stats", command_object_pool_stats, 0 },
+
 #ifdef CONFIG_MALLOC_INSTRUMENTATION
   { "dump malloc kernel", command_dump_malloc_kernel, 0 },
   { "dump malloc app", command_dump_malloc_app, 0 },
   { "dump malloc worker", command_dump_malloc_worker, 0 },
 #endif /* CONFIG_MALLOC_INSTRUMENTATION */
 
+#ifdef CONFIG_MALLOC_PROFILING
+  { "heap profile start", command_heap_profile_start, 0 },
+  { "heap profile stop", command_heap_profile_stop, 0 },
+  { "heap profile dump", command_heap_profile_dump, 0 },
+  { "heap profile export", command_heap_profile_export, 0 },
+#endif /* CONFIG_MALLOC_PROFILING */
+
   /*
   { "read word", command_read_word, 1 },
 
@@ -513,6 +528,9 @@ static const Command s_prompt_commands[] = {
   // { "format flash", command_format_flash, 0 },
 
   { "flash unprotect", command_flash_unprotect, 0 },
+#ifdef CONFIG_FLASH_READ_CACHE
+  { "flash cache stats", command_flash_cache_stats, 0 },
+#endif
 
 #ifndef CONFIG_RECOVERY_FW
   { "worker launch", command_worker_launch, 1 },
@@ -63,6 +63,7 @@ static status_t framebuffer_domain_open(uint8_t *packet_data, size_t length, voi
 
 static void framebuffer_domain_close_cb(void *foo) {
   FrameBuffer *fb = compositor_get_framebuffer();
+  compositor_invalidate_framebuffer();
   framebuffer_dirty_all(fb);
   compositor_display_update(NULL);
 }
@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "drivers/flash/flash_cache.h"
 #include "drivers/flash/flash_impl.h"
 #include "drivers/task_watchdog.h"
 #include "drivers/watchdog.h"
@@ -56,6 +57,10 @@ void flash_init(void) {
   s_erase_poll_timer = new_timer_create();
   s_erase_suspend_timer = new_timer_create();
 
+#ifdef CONFIG_FLASH_READ_CACHE
+  flash_cache_init();
+#endif
+
   flash_erase_init();
 }
 
@@ -103,9 +108,15 @@ static void prv_erase_suspend_timer_cb(void *unused) {
   mutex_unlock(s_flash_lock);
 }
 
-void flash_read_bytes(uint8_t* buffer, uint32_t start_addr,
-                      uint32_t buffer_size) {
-  mutex_lock(s_flash_lock);
+//! Assumes that s_flash_lock is held.
+static void prv_cache_invalidate(uint32_t start_addr, uint32_t length) {
+#ifdef CONFIG_FLASH_READ_CACHE
+  flash_cache_invalidate(start_addr, length);
+#endif
+}
+
+//! Assumes that s_flash_lock is held.
+static void prv_read_bytes(uint8_t *buffer, uint32_t start_addr, uint32_t buffer_size) {
   // TODO: use DMA when possible
   // TODO: be smarter about pausing erases. Some flash chips allow concurrent
   // reads while an erase is in progress, as long as the read is to another bank
@@ -115,6 +126,17 @@ void flash_read_bytes(uint8_t* buffer, uint32_t start_addr,
     new_timer_start(s_erase_suspend_timer, 5, prv_erase_suspend_timer_cb, NULL, 0);
   }
   flash_impl_read_sync(buffer, start_addr, buffer_size);
+}
+
+void flash_read_bytes(uint8_t* buffer, uint32_t start_addr,
+                      uint32_t buffer_size) {
+  mutex_lock(s_flash_lock);
+#ifdef CONFIG_FLASH_READ_CACHE
+  // Cache hits don't need to suspend an erase that is in progress
+  flash_cache_read(buffer, start_addr, buffer_size, prv_read_bytes);
+#else
+  prv_read_bytes(buffer, start_addr, buffer_size);
+#endif
   mutex_unlock(s_flash_lock);
 }
 
@@ -134,6 +156,7 @@ void flash_write_bytes(const uint8_t *buffer, uint32_t start_addr,
   }
 
   PBL_ANALYTICS_ADD(flash_spi_write_bytes, buffer_size);
+  prv_cache_invalidate(start_addr, buffer_size);
 
   while (buffer_size) {
     int written = flash_impl_write_page_begin(buffer, start_addr, buffer_size);
@@ -201,6 +224,10 @@ static uint32_t prv_flash_erase_start(uint32_t addr,
         flash_impl_get_typical_subsector_erase_duration_ms() :
         flash_impl_get_typical_sector_erase_duration_ms(),
   };
+  // Reads of the sector while the erase is running may cache partially erased data, so the range
+  // gets invalidated again once the erase has finished
+  prv_cache_invalidate(s_erase.address,
+                       is_subsector ? SUBSECTOR_SIZE_BYTES : SECTOR_SIZE_BYTES);
   status_t status = is_subsector? flash_impl_blank_check_subsector(addr)
                                 : flash_impl_blank_check_sector(addr);
   PBL_ASSERT(PASSED(status), "Blank check error: %" PRId32, status);
@@ -253,6 +280,8 @@ static uint32_t prv_flash_erase_poll(void) {
 
   if (erase_finished) {
     s_erase.in_progress = false;
+    prv_cache_invalidate(saved_ctx.address,
+                         saved_ctx.is_subsector ? SUBSECTOR_SIZE_BYTES : SECTOR_SIZE_BYTES);
   }
   mutex_unlock(s_flash_lock);
 
@@ -534,3 +563,19 @@ void command_flash_unprotect(void) {
   flash_impl_unprotect();
   prompt_send_response("OK");
 }
+
+#ifdef CONFIG_FLASH_READ_CACHE
+void command_flash_cache_stats(void) {
+  FlashCacheStats stats;
+  mutex_lock(s_flash_lock);
+  flash_cache_get_stats(&stats);
+  mutex_unlock(s_flash_lock);
+
+  char buffer[96];
+  prompt_send_response_fmt(buffer, sizeof(buffer),
+                           "hits: %"PRIu32", misses: %"PRIu32", bypasses: %"PRIu32
+                           ", invalidations: %"PRIu32,
+                           stats.hits, stats.misses, stats.bypasses, stats.invalidations);
+}
+#endif
+
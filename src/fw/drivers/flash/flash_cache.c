@@ -0,0 +1,102 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "drivers/flash/flash_cache.h"
+
+#include "pbl/util/math.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+//! Line addresses are aligned, so this never matches one
+#define INVALID_LINE_ADDR (UINT32_MAX)
+
+typedef struct FlashCacheLine {
+  uint32_t addr;
+  //! Value of s_use_counter when the line was last read, the lowest one gets evicted. 0 for
+  //! empty lines so they get used first.
+  uint32_t last_used;
+  uint8_t data[FLASH_CACHE_LINE_SIZE];
+} FlashCacheLine;
+
+static FlashCacheLine s_lines[CONFIG_FLASH_READ_CACHE_NUM_LINES];
+static uint32_t s_use_counter;
+static FlashCacheStats s_stats;
+
+void flash_cache_init(void) {
+  for (unsigned int i = 0; i < CONFIG_FLASH_READ_CACHE_NUM_LINES; i++) {
+    s_lines[i].addr = INVALID_LINE_ADDR;
+    s_lines[i].last_used = 0;
+  }
+  s_use_counter = 0;
+  s_stats = (FlashCacheStats) {};
+}
+
+//! @return the line holding line_addr or, if there's none, the line to replace
+static FlashCacheLine *prv_lookup(uint32_t line_addr, bool *hit) {
+  FlashCacheLine *lru = &s_lines[0];
+  for (unsigned int i = 0; i < CONFIG_FLASH_READ_CACHE_NUM_LINES; i++) {
+    FlashCacheLine *line = &s_lines[i];
+    if (line->addr == line_addr) {
+      *hit = true;
+      return line;
+    }
+    if (line->last_used < lru->last_used) {
+      lru = line;
+    }
+  }
+  *hit = false;
+  return lru;
+}
+
+void flash_cache_read(uint8_t *buffer, uint32_t start_addr, uint32_t buffer_size,
+                      FlashCacheFillFn fill) {
+  // Bulk reads (resources, CRCs, file contents) would only flush the cache
+  if (buffer_size > FLASH_CACHE_LINE_SIZE) {
+    s_stats.bypasses++;
+    fill(buffer, start_addr, buffer_size);
+    return;
+  }
+
+  while (buffer_size) {
+    const uint32_t line_addr = start_addr & ~(FLASH_CACHE_LINE_SIZE - 1);
+    const uint32_t offset = start_addr - line_addr;
+    const uint32_t length = MIN(buffer_size, FLASH_CACHE_LINE_SIZE - offset);
+
+    bool hit;
+    FlashCacheLine *line = prv_lookup(line_addr, &hit);
+    if (hit) {
+      s_stats.hits++;
+    } else {
+      s_stats.misses++;
+      fill(line->data, line_addr, FLASH_CACHE_LINE_SIZE);
+      line->addr = line_addr;
+    }
+    line->last_used = ++s_use_counter;
+    memcpy(buffer, &line->data[offset], length);
+
+    buffer += length;
+    start_addr += length;
+    buffer_size -= length;
+  }
+}
+
+void flash_cache_invalidate(uint32_t start_addr, uint32_t length) {
+  if (length == 0) {
+    return;
+  }
+  const uint32_t end_addr = start_addr + length;
+  for (unsigned int i = 0; i < CONFIG_FLASH_READ_CACHE_NUM_LINES; i++) {
+    FlashCacheLine *line = &s_lines[i];
+    if ((line->addr != INVALID_LINE_ADDR) && (line->addr < end_addr) &&
+        (line->addr + FLASH_CACHE_LINE_SIZE > start_addr)) {
+      line->addr = INVALID_LINE_ADDR;
+      line->last_used = 0;
+      s_stats.invalidations++;
+    }
+  }
+}
+
+void flash_cache_get_stats(FlashCacheStats *stats) {
+  *stats = s_stats;
+}
@@ -0,0 +1,44 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#pragma once
+
+#include <stdint.h>
+
+//! @file flash_cache.h
+//!
+//! A small LRU cache of flash lines that sits between flash_read_bytes() and the flash
+//! implementation when CONFIG_FLASH_READ_CACHE is enabled. Filesystem header checks, settings
+//! iteration and glyph lookups read the same few bytes over and over, each of which would
+//! otherwise cost a full flash transaction.
+//!
+//! The cache doesn't lock, its callers hold the flash lock. Anything that changes the contents
+//! of flash has to invalidate the range it touched.
+
+//! Size and alignment of a cache line
+#define FLASH_CACHE_LINE_SIZE (256)
+
+typedef void (*FlashCacheFillFn)(uint8_t *buffer, uint32_t start_addr, uint32_t buffer_size);
+
+typedef struct FlashCacheStats {
+  //! Lines that were served from the cache
+  uint32_t hits;
+  //! Lines that had to be read from flash
+  uint32_t misses;
+  //! Reads larger than a line, which go straight to flash
+  uint32_t bypasses;
+  //! Lines dropped because the flash they held was written or erased
+  uint32_t invalidations;
+} FlashCacheStats;
+
+//! Empties the cache and clears the stats
+void flash_cache_init(void);
+
+//! Reads buffer_size bytes at start_addr, calling fill for the lines that aren't cached
+void flash_cache_read(uint8_t *buffer, uint32_t start_addr, uint32_t buffer_size,
+                      FlashCacheFillFn fill);
+
+//! Drops the lines that overlap the given range
+void flash_cache_invalidate(uint32_t start_addr, uint32_t length);
+
+void flash_cache_get_stats(FlashCacheStats *stats);
@@ -156,6 +156,11 @@ Layer** kernel_applib_get_layer_tree_stack(void) {
   return layer_tree_stack;
 }
 
+LayerTreeLevel *kernel_applib_get_layer_tree_levels(void) {
+  static LayerTreeLevel layer_tree_levels[LAYER_TREE_STACK_SIZE];
+  return layer_tree_levels;
+}
+
 // -------------------------------------------------------------------------------------------------------------
 void kernel_applib_init(void) {
   s_log_state_mutex = mutex_create_recursive();
@@ -38,3 +38,8 @@ struct Layer;
 typedef struct Layer Layer;
 
 Layer** kernel_applib_get_layer_tree_stack(void);
+
+struct LayerTreeLevel;
+typedef struct LayerTreeLevel LayerTreeLevel;
+
+LayerTreeLevel *kernel_applib_get_layer_tree_levels(void);
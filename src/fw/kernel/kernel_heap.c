@@ -1,13 +1,24 @@
 /* SPDX-FileCopyrightText: 2024 Google LLC */
 /* SPDX-License-Identifier: Apache-2.0 */
 
+#include "console/prompt.h"
+#include "drivers/rtc.h"
 #include "drivers/task_watchdog.h"
 #include "kernel_heap.h"
+#include "kernel/pbl_malloc.h"
 #include "pbl/mcu/interrupts.h"
+#include "pbl/os/mutex.h"
 #include "pbl/services/analytics/analytics.h"
 #include "pbl/util/heap.h"
+#include "pbl/util/heap_profiler.h"
+#include "pbl/util/math.h"
+#include "pbl/util/object_pool.h"
+#include "pbl/util/size.h"
+#include "pbl/util/string.h"
 
 #include <cmsis_core.h>
+#include <inttypes.h>
+#include <pbl/os/tick.h>
 
 static Heap s_kernel_heap;
 static bool s_interrupts_disabled_by_heap;
@@ -45,6 +56,36 @@ void kernel_heap_init(void) {
   });
 }
 
+// Object pools are used from several tasks but only after FreeRTOS is up, so unlike the heap they
+// can use a mutex.
+static PebbleRecursiveMutex *s_object_pool_mutex;
+
+static void prv_object_pool_lock(void *ctx) {
+  mutex_lock_recursive(ctx);
+}
+
+static void prv_object_pool_unlock(void *ctx) {
+  mutex_unlock_recursive(ctx);
+}
+
+void kernel_heap_init_object_pool_lock(void) {
+  s_object_pool_mutex = mutex_create_recursive();
+  object_pool_set_lock_impl((ObjectPoolLockImpl) {
+    .lock_function = prv_object_pool_lock,
+    .unlock_function = prv_object_pool_unlock,
+    .lock_context = s_object_pool_mutex,
+  });
+}
+
+static bool prv_collect_object_pool_stats(ObjectPool *pool, void *context) {
+  if (pool->stats_key != OBJECT_POOL_NO_STATS_KEY) {
+    sys_pbl_analytics_set_unsigned((enum pbl_analytics_key)pool->stats_key,
+                                   pool->high_water_mark);
+  }
+  pool->high_water_mark = pool->num_allocated;
+  return true;
+}
+
 void pbl_analytics_external_collect_kernel_heap_stats(void) {
   uint32_t headroom = heap_get_minimum_headroom(&s_kernel_heap);
   size_t total_size = heap_size(&s_kernel_heap);
@@ -61,6 +102,9 @@ void pbl_analytics_external_collect_kernel_heap_stats(void) {
   // Reset the high water mark so we can see if there are certain periods of time
   // where we really tax the heap
   s_kernel_heap.high_water_mark = s_kernel_heap.current_size;
+
+  // Same for the object pools, most of which live on the kernel heap
+  object_pool_each(prv_collect_object_pool_stats, NULL);
 }
 
 Heap* kernel_heap_get(void) {
@@ -69,8 +113,109 @@ Heap* kernel_heap_get(void) {
 
 // Serial Commands
 ///////////////////////////////////////////////////////////
+static bool prv_print_object_pool_stats(ObjectPool *pool, void *context) {
+  char buffer[80];
+  prompt_send_response_fmt(buffer, sizeof(buffer),
+                           "%s: %u allocated, %u max, %u slabs of %u x %uB", pool->name,
+                           pool->num_allocated, pool->high_water_mark, pool->num_slabs,
+                           pool->objects_per_slab, pool->object_size);
+  return true;
+}
+
+void command_object_pool_stats(void) {
+  object_pool_each(prv_print_object_pool_stats, NULL);
+}
+
 #ifdef CONFIG_MALLOC_INSTRUMENTATION
 void command_dump_malloc_kernel(void) {
   heap_dump_malloc_instrumentation_to_dbgserial(&s_kernel_heap);
 }
 #endif
+
+#ifdef CONFIG_MALLOC_PROFILING
+static HeapProfilerSite s_profiler_sites[CONFIG_MALLOC_PROFILING_NUM_SITES];
+static HeapProfiler s_profiler;
+
+//! Bytes of the binary profile printed per line of "heap profile export"
+#define PROFILE_EXPORT_BYTES_PER_LINE (32)
+//! Extra sites to make room for when exporting, for the allocations made in the meantime
+#define PROFILE_EXPORT_SPARE_SITES (4)
+
+static uint32_t prv_profiler_get_time_ms(void) {
+  return ticks_to_milliseconds(rtc_get_ticks());
+}
+
+void command_heap_profile_start(void) {
+  heap_set_profiler(&s_kernel_heap, NULL);
+  heap_profiler_init(&s_profiler, s_profiler_sites, ARRAY_LENGTH(s_profiler_sites),
+                     prv_profiler_get_time_ms);
+  heap_set_profiler(&s_kernel_heap, &s_profiler);
+  prompt_send_response("Profiling kernel heap");
+}
+
+void command_heap_profile_stop(void) {
+  heap_set_profiler(&s_kernel_heap, NULL);
+  prompt_send_response("Stopped profiling kernel heap");
+}
+
+static bool prv_profiler_check_started(void) {
+  if (!s_profiler.sites) {
+    prompt_send_response("Run 'heap profile start' first");
+    return false;
+  }
+  return true;
+}
+
+void command_heap_profile_dump(void) {
+  if (!prv_profiler_check_started()) {
+    return;
+  }
+  char buffer[128];
+  prompt_send_response_fmt(buffer, sizeof(buffer), "Heap profile: %u sites, %"PRIu32" dropped",
+                           s_profiler.num_used_sites, s_profiler.num_dropped);
+  for (unsigned int i = 0; i < s_profiler.num_sites; i++) {
+    const HeapProfilerSite *site = &s_profiler.sites[i];
+    if (site->pc == 0) {
+      continue;
+    }
+    const uint16_t *lifetimes = site->lifetime_histogram;
+    prompt_send_response_fmt(buffer, sizeof(buffer),
+                             "PC:0x%08"PRIxPTR" allocs:%"PRIu32" frees:%"PRIu32" bytes:%"PRIu32
+                             " live:%"PRIu32" peak:%"PRIu32" lifetimes:%u,%u,%u,%u,%u,%u",
+                             site->pc, site->num_allocs, site->num_frees, site->total_bytes,
+                             site->live_bytes, site->peak_live_bytes, lifetimes[0], lifetimes[1],
+                             lifetimes[2], lifetimes[3], lifetimes[4], lifetimes[5]);
+  }
+}
+
+//! Prints the binary profile as lines of hex prefixed with "HPRF:" which
+//! tools/parse_heap_profile.py symbolizes against the ELF
+void command_heap_profile_export(void) {
+  if (!prv_profiler_check_started()) {
+    return;
+  }
+  const size_t buffer_size = heap_profiler_get_serialized_size(&s_profiler) +
+                             (PROFILE_EXPORT_SPARE_SITES * sizeof(HeapProfilerSiteRecord));
+  uint8_t *profile = kernel_malloc(buffer_size);
+  if (!profile) {
+    prompt_send_response("Not enough memory to export the heap profile");
+    return;
+  }
+
+  // Keep the profile consistent while it's copied out
+  prv_heap_lock(NULL);
+  const size_t size = heap_profiler_serialize(&s_profiler, profile, buffer_size);
+  prv_heap_unlock(NULL);
+
+  char line[(PROFILE_EXPORT_BYTES_PER_LINE * 2) + 8] = "HPRF:";
+  for (size_t offset = 0; offset < size; offset += PROFILE_EXPORT_BYTES_PER_LINE) {
+    byte_stream_to_hex_string(&line[5], sizeof(line) - 5, &profile[offset],
+                              MIN(PROFILE_EXPORT_BYTES_PER_LINE, size - offset), false);
+    prompt_send_response(line);
+  }
+  if (size == 0) {
+    prompt_send_response("Heap profile changed while exporting, try again");
+  }
+  kernel_free(profile);
+}
+#endif
@@ -7,5 +7,8 @@
 
 void kernel_heap_init(void);
 
+//! Sets up the lock of the object pools, has to be called before the first pool is initialized
+void kernel_heap_init_object_pool_lock(void);
+
 Heap* kernel_heap_get(void);
 
@@ -59,6 +59,16 @@ void *task_malloc_check(size_t bytes) {
   return mem;
 }
 
+void *task_malloc_check_with_pc(size_t bytes, uintptr_t client_pc) {
+  Heap *heap = task_heap_get_for_current_task();
+  void *mem = heap_malloc(heap, bytes, client_pc);
+
+  if (!mem && bytes != 0) {
+    PBL_CROAK_OOM(bytes, client_pc, heap);
+  }
+  return mem;
+}
+
 #if defined(CONFIG_MALLOC_INSTRUMENTATION)
 void task_free_with_pc(void *ptr, uintptr_t client_pc) {
   heap_free(task_heap_get_for_current_task(), ptr, client_pc);
@@ -231,6 +241,15 @@ void *kernel_malloc_check(size_t bytes) {
   return mem;
 }
 
+void *kernel_malloc_check_with_pc(size_t bytes, uintptr_t client_pc) {
+  Heap *heap = kernel_heap_get();
+  void *mem = heap_malloc(heap, bytes, client_pc);
+  if (!mem && bytes != 0) {
+    PBL_CROAK_OOM(bytes, client_pc, heap);
+  }
+  return mem;
+}
+
 void *kernel_calloc(size_t count, size_t size) {
   register uintptr_t lr __asm("lr");
   uintptr_t saved_lr = lr;
@@ -22,6 +22,9 @@ void *task_malloc(size_t bytes);
 void *task_malloc_with_pc(size_t bytes, uintptr_t client_pc);
 #endif
 void *task_malloc_check(size_t bytes);
+//! Like task_malloc_check(), but attributes the allocation to client_pc, for allocators that
+//! allocate on behalf of their callers (see ObjectPool)
+void *task_malloc_check_with_pc(size_t bytes, uintptr_t client_pc);
 void *task_realloc(void *ptr, size_t size);
 void *task_zalloc(size_t size);
 void *task_zalloc_check(size_t size);
@@ -45,6 +48,9 @@ char* app_strdup(const char* s);
 
 void *kernel_malloc(size_t bytes);
 void *kernel_malloc_check(size_t bytes);
+//! Like kernel_malloc_check(), but attributes the allocation to client_pc, for allocators that
+//! allocate on behalf of their callers (see ObjectPool)
+void *kernel_malloc_check_with_pc(size_t bytes, uintptr_t client_pc);
 void *kernel_realloc(void *ptr, size_t bytes);
 void *kernel_zalloc(size_t size);
 void *kernel_zalloc_check(size_t size);
@@ -14,6 +14,12 @@
 
 static GContext s_kernel_grahics_context;
 
+static GlyphCache s_kernel_glyph_cache;
+
+#ifdef CONFIG_TEXT_GLYPH_ATLAS
+static GlyphAtlas s_kernel_glyph_atlas;
+#endif
+
 T_STATIC ContentIndicatorsBuffer s_kernel_content_indicators_buffer;
 
 static TimelineItemActionSource s_kernel_current_timeline_item_action_source;
@@ -21,6 +27,11 @@ static TimelineItemActionSource s_kernel_current_timeline_item_action_source;
 void kernel_ui_init(void) {
   graphics_context_init(&s_kernel_grahics_context, compositor_get_framebuffer(),
                         GContextInitializationMode_System);
+  text_resources_init_font_cache(&s_kernel_grahics_context.font_cache, &s_kernel_glyph_cache);
+#ifdef CONFIG_TEXT_GLYPH_ATLAS
+  text_resources_init_glyph_atlas(&s_kernel_glyph_atlas);
+  s_kernel_grahics_context.font_cache.glyph_atlas = &s_kernel_glyph_atlas;
+#endif
   animation_private_state_init(kernel_applib_get_animation_state());
   content_indicator_init_buffer(&s_kernel_content_indicators_buffer);
   s_kernel_current_timeline_item_action_source = TimelineItemActionSourceModalNotification;
@@ -269,6 +269,8 @@ static NOINLINE void prv_main_task_init(void) {
 
   task_init();
 
+  kernel_heap_init_object_pool_lock();
+
   memory_layout_setup_mpu();
 
   board_early_init();
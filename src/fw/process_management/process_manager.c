@@ -26,6 +26,7 @@
 #include "pbl/services/hrm/hrm_manager.h"
 #include "pbl/services/filesystem/pfs.h"
 #include "pbl/services/system_task.h"
+#include "pbl/services/timeline/timeline.h"
 #include "pbl/services/app_cache.h"
 #include "pbl/services/data_logging/data_logging_service.h"
 #include "pbl/services/persist.h"
@@ -550,6 +551,7 @@ void process_manager_process_cleanup(PebbleTask task) {
   voice_kill_app_session(task);
 #endif
   dls_inactivate_sessions(task);
+  timeline_process_cleanup(task);
 
   if (task == PebbleTask_App) {
   }
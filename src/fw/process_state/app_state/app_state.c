@@ -92,6 +92,10 @@ typedef struct {
   UnobstructedAreaState unobstructed_area_service_state;
 
   Layer* layer_tree_stack[LAYER_TREE_STACK_SIZE];
+  LayerTreeLevel layer_tree_levels[LAYER_TREE_STACK_SIZE];
+
+  GDirtyRegion render_damage;
+  bool full_render_required;
 
   WakeupHandler wakeup_handler;
 
@@ -114,6 +118,8 @@ typedef struct {
 
   TextRenderState text_render_state;
 
+  GlyphCache glyph_cache;
+
   bool text_perimeter_debugging_enabled;
 
   TimelineItemActionSource current_timeline_item_action_source;
@@ -133,6 +139,12 @@ bool app_state_configure(MemorySegment *app_state_ram,
 
   s_app_state_ptr->sdk_type = sdk_type;
   s_app_state_ptr->initial_obstruction_origin_y = obstruction_origin_y;
+  s_app_state_ptr->full_render_required = (sdk_type != ProcessAppSDKType_System);
+#ifdef CONFIG_TEXT_GLYPH_ATLAS
+  // The atlas takes up about 10 KiB of app heap, which third-party apps were built without
+  s_app_state_ptr->text_render_state.glyph_atlas_unavailable =
+      (sdk_type != ProcessAppSDKType_System);
+#endif
 
   if (GBITMAP_NATIVE_FORMAT != GBitmapFormat1Bit &&
       sdk_type == ProcessAppSDKType_Legacy2x) {
@@ -192,6 +204,8 @@ NOINLINE void app_state_init(void) {
                                                             GContextInitializationMode_App;
   graphics_context_init(&s_app_state_ptr->graphics_context,
                         &s_app_state_ptr->framebuffer, init_mode);
+  text_resources_init_font_cache(&s_app_state_ptr->graphics_context.font_cache,
+                                 &s_app_state_ptr->glyph_cache);
 
 
   ble_init_app_state();
@@ -353,6 +367,18 @@ Layer** app_state_get_layer_tree_stack(void) {
   return s_app_state_ptr->layer_tree_stack;
 }
 
+LayerTreeLevel *app_state_get_layer_tree_levels(void) {
+  return s_app_state_ptr->layer_tree_levels;
+}
+
+GDirtyRegion *app_state_get_render_damage(void) {
+  return &s_app_state_ptr->render_damage;
+}
+
+bool *app_state_get_full_render_required(void) {
+  return &s_app_state_ptr->full_render_required;
+}
+
 AppFocusState *app_state_get_app_focus_state(void) {
   return &s_app_state_ptr->app_focus_state;
 }
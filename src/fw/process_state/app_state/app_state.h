@@ -57,6 +57,11 @@ typedef struct AppFocusState {
 typedef struct TextRenderState {
   SpecialCodepointHandlerCb special_codepoint_handler_cb;
   void *special_codepoint_handler_context;
+#ifdef CONFIG_TEXT_GLYPH_ATLAS
+  //! The app doesn't get a glyph atlas, so glyphs are drawn from their bits: either it isn't a
+  //! system app or its heap didn't have room for one
+  bool glyph_atlas_unavailable;
+#endif
 } TextRenderState;
 
 
@@ -160,6 +165,19 @@ typedef struct Layer Layer;
 
 Layer** app_state_get_layer_tree_stack(void);
 
+struct LayerTreeLevel;
+typedef struct LayerTreeLevel LayerTreeLevel;
+
+LayerTreeLevel *app_state_get_layer_tree_levels(void);
+
+//! @return the screen areas that need to be redrawn the next time the app renders its window
+GDirtyRegion *app_state_get_render_damage(void);
+
+//! @return whether every render of the app has to redraw its whole window and copy all of it to
+//! the display. Only system apps redraw just their damage: third-party apps may draw without
+//! marking what changed as dirty or post-process the whole captured framebuffer.
+bool *app_state_get_full_render_required(void);
+
 WakeupHandler app_state_get_wakeup_handler(void);
 void app_state_set_wakeup_handler(WakeupHandler handler);
 
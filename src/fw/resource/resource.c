@@ -11,7 +11,9 @@
 #include "flash_region/flash_region.h"
 #include "kernel/pbl_malloc.h"
 #include "pbl/os/mutex.h"
+#include "pbl/services/analytics/analytics.h"
 #include "pbl/services/process_management/app_storage.h"
+#include "pbl/util/object_pool.h"
 #include "system/logging.h"
 #include "system/passert.h"
 
@@ -27,6 +29,12 @@ PebbleRecursiveMutex *s_resource_mutex = NULL;
 
 static CachedResource *s_resource_list = NULL;
 
+//! Number of CachedResources to allocate from the kernel heap at a time
+#define CACHED_RESOURCE_POOL_SLAB_SIZE (8)
+
+//! Cached resources stay around forever, pool them to save a heap header each
+static ObjectPool s_cached_resource_pool;
+
 // Last-resolved app resource; invalidated in resource_init_app().
 typedef struct {
   bool valid;
@@ -97,6 +105,9 @@ void resource_init(void) {
   resource_storage_init();
 
   s_resource_mutex = mutex_create_recursive();
+  object_pool_init(&s_cached_resource_pool, "cached_resource", sizeof(CachedResource),
+                   CACHED_RESOURCE_POOL_SLAB_SIZE, kernel_malloc_check_with_pc, kernel_free,
+                   PBL_ANALYTICS_KEY(memory_pool_cached_resources_max));
 }
 
 uint32_t resource_get_and_cache(ResAppNum app_num, uint32_t resource_id) {
@@ -114,7 +125,7 @@ uint32_t resource_get_and_cache(ResAppNum app_num, uint32_t resource_id) {
   CachedResource *cached_resource = (CachedResource *)list_find((ListNode *)s_resource_list,
       prv_resource_filter, (void *)(uintptr_t)resource_id);
   if (cached_resource == NULL) {
-    cached_resource = kernel_malloc_check(sizeof(CachedResource));
+    cached_resource = object_pool_alloc(&s_cached_resource_pool);
     *cached_resource = (CachedResource){};
     cached_resource->id = resource_id;
     s_resource_list = (CachedResource *)list_prepend((ListNode *)s_resource_list,
@@ -28,6 +28,16 @@ typedef struct AppInboxNode {
   bool write_failed;
   bool has_pending_event;
 
+  //! Whether the app keeps handling messages that complete while it is handling others, without
+  //! needing another event for them. See s_event_handler_map.
+  bool is_batched;
+  //! True while the app is handling a batch of messages, no events need to be sent in the mean time
+  bool is_being_consumed;
+
+  //! Number of messages that the app has pinned, see app_inbox_pin().
+  //! Nothing gets moved and no space gets freed up while it's non-zero.
+  uint32_t num_pinned;
+
   uint32_t num_failed;
   uint32_t num_success;
 
@@ -39,6 +49,10 @@ typedef struct AppInboxNode {
     //! (incomplete) message has been written.
     size_t current_offset;
 
+    //! Index up until which the app has consumed the completed messages. The space before it gets
+    //! freed up by moving the remaining data to the front of the buffer, see prv_compact().
+    size_t read_index;
+
     //! Index after which the current message should get written.
     //! If this index is non-zero, there are completed message(s) in the buffer.
     size_t write_index;
@@ -56,6 +70,12 @@ typedef struct AppInboxConsumerInfo {
   uint32_t num_success;
   uint8_t *it;
   uint8_t *end;
+  //! Whether more messages can be picked up after these have been handled, see s_event_handler_map
+  bool is_batched;
+  //! Set on the last consume of a batch, after which events need to be sent again
+  bool ends_batch;
+  //! Set on the consume after each round of handled messages, which always frees up the space
+  bool ends_round;
 } AppInboxConsumerInfo;
 
 
@@ -80,32 +100,49 @@ extern void test_dropped_handler(uint32_t num_dropped_messages);
 extern void test_alt_message_handler(const uint8_t *data, size_t length,
                                      AppInboxConsumerInfo *consumer_info);
 extern void test_alt_dropped_handler(uint32_t num_dropped_messages);
+extern void test_batched_message_handler(const uint8_t *data, size_t length,
+                                         AppInboxConsumerInfo *consumer_info);
+extern void test_batched_dropped_handler(uint32_t num_dropped_messages);
 #endif
 
+//! The maximum number of times the app picks up the messages that completed while it was handling
+//! the previous ones, before it goes back to its event loop to handle other events.
+#define APP_INBOX_MAX_BATCH_ROUNDS (8)
+
+static const struct {
+  AppInboxMessageHandler message_handler;
+  AppInboxDroppedHandler dropped_handler;
+  //! Messages that complete while the app is handling others are handled in the same callback
+  //! event, instead of one event per message. Useful for streams of messages.
+  bool is_batched;
+} s_event_handler_map[] = {
+  [AppInboxServiceTagAppMessageReceiver] = {
+    .message_handler = app_message_receiver_message_handler,
+    .dropped_handler = app_message_receiver_dropped_handler,
+    .is_batched = true,
+  },
+#ifdef UNITTEST
+  [AppInboxServiceTagUnitTest] = {
+    .message_handler = test_message_handler,
+    .dropped_handler = test_dropped_handler,
+  },
+  [AppInboxServiceTagUnitTestAlt] = {
+    .message_handler = test_alt_message_handler,
+    .dropped_handler = test_alt_dropped_handler,
+  },
+  [AppInboxServiceTagUnitTestBatched] = {
+    .message_handler = test_batched_message_handler,
+    .dropped_handler = test_batched_dropped_handler,
+    .is_batched = true,
+  },
+#endif
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Syscalls
 
 static AppInboxServiceTag prv_tag_for_event_handlers(const AppInboxMessageHandler message_handler,
                                                      const AppInboxDroppedHandler dropped_handler) {
-  static const struct {
-    AppInboxMessageHandler message_handler;
-    AppInboxDroppedHandler dropped_handler;
-  } s_event_handler_map[] = {
-    [AppInboxServiceTagAppMessageReceiver] = {
-      .message_handler = app_message_receiver_message_handler,
-      .dropped_handler = app_message_receiver_dropped_handler,
-    },
-#ifdef UNITTEST
-    [AppInboxServiceTagUnitTest] = {
-      .message_handler = test_message_handler,
-      .dropped_handler = test_dropped_handler,
-    },
-    [AppInboxServiceTagUnitTestAlt] = {
-      .message_handler = test_alt_message_handler,
-      .dropped_handler = test_alt_dropped_handler,
-    }
-#endif
-  };
   for (AppInboxServiceTag tag = 0; tag < NumAppInboxServiceTag; ++tag) {
     if (s_event_handler_map[tag].message_handler == message_handler &&
         s_event_handler_map[tag].dropped_handler == dropped_handler) {
@@ -159,6 +196,22 @@ DEFINE_SYSCALL(void, sys_app_inbox_service_consume, AppInboxConsumerInfo *consum
   prv_consume(consumer_info);
 }
 
+static void prv_pin(AppInboxServiceTag tag);
+
+DEFINE_SYSCALL(void, sys_app_inbox_service_pin, AppInboxConsumerInfo *consumer_info) {
+  if (PRIVILEGE_WAS_ELEVATED) {
+    syscall_assert_userspace_buffer(consumer_info, sizeof(*consumer_info));
+  }
+  prv_pin(consumer_info->tag);
+}
+
+static void prv_release(uint8_t *storage);
+
+DEFINE_SYSCALL(void, sys_app_inbox_service_release, uint8_t *storage) {
+  // No check is needed on the value of `storage `, we're not going to derefence it.
+  prv_release(storage);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 static void prv_lock(void) {
@@ -197,6 +250,40 @@ static AppInboxNode *prv_find_inbox_by_tag_and_log_if_not_found(AppInboxServiceT
   return inbox;
 }
 
+static bool prv_has_pending_messages(const AppInboxNode *inbox) {
+  return (inbox->num_success || inbox->num_failed);
+}
+
+static void prv_send_event_if_needed(AppInboxNode *inbox);
+
+//! Frees up the space of the consumed messages, by moving the remaining data to the front of the
+//! buffer. Only called from the app's consume, because the app needs to know about the move.
+static void prv_compact(AppInboxNode *inbox, AppInboxConsumerInfo *consumer_info) {
+  const size_t bytes_consumed = inbox->buffer.read_index;
+  if (0 == bytes_consumed || inbox->num_pinned) {
+    // Pinned messages must stay where they are, and so must the messages after them.
+    return;
+  }
+  const bool is_all_consumed = (inbox->buffer.read_index == inbox->buffer.write_index);
+  uint8_t * const consumed_up_to_ptr = inbox->buffer.storage + inbox->buffer.read_index;
+  const size_t remaining_size =
+      (inbox->buffer.write_index + inbox->buffer.current_offset - inbox->buffer.read_index);
+  // When the app consumes a batch message by message, only move the unconsumed messages once they
+  // are no more than the space that gets freed up, so handling a batch stays linear in its size.
+  // The writer can't use the consumed space before it's moved, so do move it after every round:
+  if (!is_all_consumed && !consumer_info->ends_round && remaining_size > bytes_consumed) {
+    return;
+  }
+  if (remaining_size) {
+    // New data has been written in the mean-time, move it all to the front of the buffer:
+    memmove(inbox->buffer.storage, consumed_up_to_ptr, remaining_size);
+  }
+  inbox->buffer.write_index -= bytes_consumed;
+  inbox->buffer.read_index = 0;
+  consumer_info->it -= bytes_consumed;
+  consumer_info->end -= bytes_consumed;
+}
+
 //! We don't report "number of messages consumed", because that would force the system to parse
 //! the contents of the (app space) buffer, which might have been corrupted by the app.
 //! Note that it's in theory possible for a misbehaving app to pass in a consumed_up_to_ptr that is
@@ -211,24 +298,50 @@ static void prv_consume(AppInboxConsumerInfo *consumer_info) {
     }
     uint8_t *const consumed_up_to_ptr = consumer_info->it;
     uint8_t * const completed_messages_end = (inbox->buffer.storage + inbox->buffer.write_index);
-    if (consumed_up_to_ptr < inbox->buffer.storage ||
+    if (consumed_up_to_ptr < inbox->buffer.storage + inbox->buffer.read_index ||
         consumed_up_to_ptr > completed_messages_end) {
       PBL_LOG_ERR("Out of bounds");
-      goto unlock;
+    } else {
+      inbox->buffer.read_index = (consumed_up_to_ptr - inbox->buffer.storage);
+      prv_compact(inbox, consumer_info);
+    }
+
+    if (consumer_info->ends_batch) {
+      inbox->is_being_consumed = false;
+      if (prv_has_pending_messages(inbox)) {
+        prv_send_event_if_needed(inbox);
+      }
+    }
+  }
+unlock:
+  prv_unlock();
+}
+
+static void prv_pin(AppInboxServiceTag tag) {
+  prv_lock();
+  {
+    AppInboxNode *inbox = prv_find_inbox_by_tag_and_log_if_not_found(tag);
+    if (inbox) {
+      ++inbox->num_pinned;
     }
-    const size_t bytes_consumed = (consumed_up_to_ptr - inbox->buffer.storage);
-    if (0 == bytes_consumed) {
+  }
+  prv_unlock();
+}
+
+static void prv_release(uint8_t *storage) {
+  prv_lock();
+  {
+    AppInboxNode *inbox = prv_find_inbox_by_storage(storage);
+    if (!inbox || !inbox->num_pinned) {
+      PBL_LOG_ERR("No pinned AppInbox message for storage <%p>", storage);
       goto unlock;
     }
-    uint8_t * const partial_message_end = completed_messages_end + inbox->buffer.current_offset;
-    const size_t remaining_size = partial_message_end - consumed_up_to_ptr;
-    consumer_info->it = inbox->buffer.storage;
-    consumer_info->end = inbox->buffer.storage + remaining_size;
-    if (remaining_size) {
-      // New data has been written in the mean-time, move it all to the front of the buffer:
-      memmove(inbox->buffer.storage, consumed_up_to_ptr, remaining_size);
+    --inbox->num_pinned;
+    if (!inbox->num_pinned && inbox->buffer.read_index) {
+      // The consumed messages can't be moved from here, the app might be handling messages. Let
+      // the app consume again, which frees up the space:
+      prv_send_event_if_needed(inbox);
     }
-    inbox->buffer.write_index -= bytes_consumed;
   }
 unlock:
   prv_unlock();
@@ -252,12 +365,16 @@ static bool prv_get_consumer_info(AppInboxServiceTag tag, AppInboxConsumerInfo *
       .dropped_handler = inbox->dropped_handler,
       .num_failed = inbox->num_failed,
       .num_success = inbox->num_success,
-      .it = inbox->buffer.storage,
+      .it = inbox->buffer.storage + inbox->buffer.read_index,
       .end = inbox->buffer.storage + inbox->buffer.write_index,
+      .is_batched = inbox->is_batched,
     };
 
     // Also mark that there is no event pending any more:
     inbox->has_pending_event = false;
+    // While the app handles a batch, it will pick up new messages without an event. Once it asks
+    // for messages and there are none, it's done:
+    inbox->is_being_consumed = (inbox->is_batched && prv_has_pending_messages(inbox));
 
     // Reset counters because the info is communicated to app and it's about to consume the data.
     inbox->num_failed = 0;
@@ -271,53 +388,69 @@ unlock:
 }
 
 //! @note Executes on app task, therefore we need to go through syscalls to access AppInbox!
-static void prv_callback_event_handler(void *ctx) {
-  AppInboxServiceTag tag = (AppInboxServiceTag)(uintptr_t)ctx;
-  AppInboxConsumerInfo info = {};
+static void prv_handle_messages(AppInboxConsumerInfo *info) {
   size_t num_message_consumed = 0;
-  if (!sys_app_inbox_service_get_consumer_info(tag, &info)) {
-    // Inbox wasn't there any more
-    return;
-  }
-  if (!info.message_handler) {
-    // Shouldn't ever happen, but better not PBL_ASSERTN on app task
-    PBL_LOG_ERR("No AppInbox message handler!");
-    return;
-  }
-  if (!info.num_success && !info.num_failed) {
-    // Shouldn't ever happen, but better not PBL_ASSERTN on app task
-    PBL_LOG_ERR("Got callback, but zero messages!?");
-    // fall-through
-  }
-
   // These conditions are redundant, just for safety:
-  while ((num_message_consumed < info.num_success) && (info.it < info.end)) {
-    AppInboxMessageHeader *msg = (AppInboxMessageHeader *)info.it;
+  while ((num_message_consumed < info->num_success) && (info->it < info->end)) {
+    AppInboxMessageHeader *msg = (AppInboxMessageHeader *)info->it;
 
     // Increment now so that if the message_handler calls into sys_app_inbox_service_consume(),
     // it will be pointing *after* the message that is just handled:
-    info.it += (sizeof(AppInboxMessageHeader) + msg->length);
+    info->it += (sizeof(AppInboxMessageHeader) + msg->length);
 
     // Check for safety, just in case the app has corrupted the buffer in the mean time:
-    if (msg->data + msg->length <= info.end) {
-      info.message_handler(msg->data, msg->length, &info);
+    if (msg->data + msg->length <= info->end) {
+      info->message_handler(msg->data, msg->length, info);
     } else {
       PBL_LOG_ERR("Corrupted AppInbox message!");
     }
     ++num_message_consumed;
   }
 
-  if (info.num_failed) {
-    if (info.dropped_handler) {
-      info.dropped_handler(info.num_failed);
+  if (info->num_failed) {
+    if (info->dropped_handler) {
+      info->dropped_handler(info->num_failed);
     } else {
       PBL_LOG_ERR("Dropped %"PRIu32" messages but no dropped_handler",
-              info.num_failed);
+              info->num_failed);
     }
   }
+}
+
+//! @note Executes on app task, therefore we need to go through syscalls to access AppInbox!
+static void prv_callback_event_handler(void *ctx) {
+  AppInboxServiceTag tag = (AppInboxServiceTag)(uintptr_t)ctx;
+  AppInboxConsumerInfo info = {};
+  if (!sys_app_inbox_service_get_consumer_info(tag, &info)) {
+    // Inbox wasn't there any more
+    return;
+  }
+  if (!info.message_handler) {
+    // Shouldn't ever happen, but better not PBL_ASSERTN on app task
+    PBL_LOG_ERR("No AppInbox message handler!");
+    return;
+  }
+  // Zero messages is expected after releasing a pinned message, the consume below frees up the
+  // space of the messages that were consumed while it was pinned.
+
+  int num_rounds = 0;
+  while (true) {
+    prv_handle_messages(&info);
+    info.ends_batch = (!info.is_batched || ++num_rounds == APP_INBOX_MAX_BATCH_ROUNDS);
+    info.ends_round = true;
+
+    // Report back up to which byte we've consumed the data.
+    sys_app_inbox_service_consume(&info);
+    if (info.ends_batch) {
+      return;
+    }
 
-  // Report back up to which byte we've consumed the data.
-  sys_app_inbox_service_consume(&info);
+    // Pick up the messages that completed in the mean time, without waiting for another event:
+    if (!sys_app_inbox_service_get_consumer_info(tag, &info) ||
+        (!info.num_success && !info.num_failed)) {
+      return;
+    }
+  }
 }
 
 bool app_inbox_service_register(uint8_t *storage, size_t storage_size,
@@ -352,6 +485,7 @@ bool app_inbox_service_register(uint8_t *storage, size_t storage_size,
       new_node->tag = tag;
       new_node->message_handler = message_handler;
       new_node->dropped_handler = dropped_handler;
+      new_node->is_batched = s_event_handler_map[tag].is_batched;
       new_node->event_handler_task = pebble_task_get_current();
       new_node->buffer.storage = storage;
       new_node->buffer.size = storage_size;
@@ -412,7 +546,7 @@ bool prv_check_space_remaining(AppInboxNode *inbox, size_t required_free_length)
 }
 
 static void prv_send_event_if_needed(AppInboxNode *inbox) {
-  if (!inbox || inbox->has_pending_event) {
+  if (!inbox || inbox->has_pending_event || inbox->is_being_consumed) {
     return;
   }
   PebbleEvent event = {
@@ -120,6 +120,18 @@ static size_t prv_send_job_impl_get_read_pointer(const SessionSendQueueJob *send
                               app_message_send_job->consumed_length, data_out);
 }
 
+static size_t prv_send_job_impl_get_read_pointer_at_offset(const SessionSendQueueJob *send_job,
+                                                           uint32_t start_offset,
+                                                           const uint8_t **data_out) {
+  AppMessageSendJob *app_message_send_job = (AppMessageSendJob *)send_job;
+  prv_request_fast_connection(app_message_send_job->session);
+
+  const size_t length_available =
+      prv_get_read_pointer(app_message_send_job,
+                           app_message_send_job->consumed_length + start_offset, data_out);
+  return MIN(length_available, prv_get_length(app_message_send_job) - start_offset);
+}
+
 static void prv_send_job_impl_consume(const SessionSendQueueJob *send_job, size_t length) {
   AppMessageSendJob *app_message_send_job = (AppMessageSendJob *)send_job;
   app_message_send_job->consumed_length += length;
@@ -145,6 +157,7 @@ T_STATIC const SessionSendJobImpl s_app_message_send_job_impl = {
   .get_length = prv_send_job_impl_get_length,
   .copy = prv_send_job_impl_copy,
   .get_read_pointer = prv_send_job_impl_get_read_pointer,
+  .get_read_pointer_at_offset = prv_send_job_impl_get_read_pointer_at_offset,
   .consume = prv_send_job_impl_consume,
   .free = prv_send_job_impl_free,
 };
@@ -165,6 +165,14 @@ static size_t prv_send_job_impl_get_read_pointer(const SessionSendQueueJob *send
   return prv_get_remaining_length(sb);
 }
 
+static size_t prv_send_job_impl_get_read_pointer_at_offset(const SessionSendQueueJob *send_job,
+                                                           uint32_t start_offset,
+                                                           const uint8_t **data_out) {
+  SendBuffer *sb = (SendBuffer *)send_job;
+  *data_out = prv_get_read_pointer(sb) + start_offset;
+  return (prv_get_remaining_length(sb) - start_offset);
+}
+
 static void prv_send_job_impl_consume(const SessionSendQueueJob *send_job, size_t length) {
   SendBuffer *sb = (SendBuffer *)send_job;
   sb->consumed_length += length;
@@ -178,6 +186,7 @@ T_STATIC const SessionSendJobImpl s_default_kernel_send_job_impl = {
   .get_length = prv_send_job_impl_get_length,
   .copy = prv_send_job_impl_copy,
   .get_read_pointer = prv_send_job_impl_get_read_pointer,
+  .get_read_pointer_at_offset = prv_send_job_impl_get_read_pointer_at_offset,
   .consume = prv_send_job_impl_consume,
   .free = prv_send_job_impl_free,
 };
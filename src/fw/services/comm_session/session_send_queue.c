@@ -23,6 +23,8 @@ void comm_session_send_queue_cleanup(CommSession *session) {
     job = next;
   }
   session->send_queue_head = NULL;
+  session->send_queue_length = 0;
+  session->send_queue_cursor.job = NULL;
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -44,6 +46,7 @@ void comm_session_send_queue_add_job(CommSession *session, SessionSendQueueJob *
     } else {
       session->send_queue_head = job;
     }
+    session->send_queue_length += job->impl->get_length(job);
     // Schedule to let the transport to send the enqueued data:
     comm_session_send_next(session);
   }
@@ -56,32 +59,72 @@ unlock:
 // bt_lock is assumed to be taken by the caller of each of the below functions:
 
 size_t comm_session_send_queue_get_length(const CommSession *session) {
-  size_t length = 0;
-  const SessionSendQueueJob *job = session->send_queue_head;
+  return session->send_queue_length;
+}
+
+//! Finds the job that the byte at the given offset into the send queue is part of. The search
+//! starts at the cursor if the offset isn't before it, and leaves the cursor at the job found.
+//! @param[in,out] offset_in_out The offset into the send queue, set to the offset into the job
+static SessionSendQueueJob *prv_find_job(CommSession *session, uint32_t *offset_in_out) {
+  SessionSendQueueJob *job = session->send_queue_head;
+  uint32_t job_offset = 0;
+  if (session->send_queue_cursor.job && (session->send_queue_cursor.offset <= *offset_in_out)) {
+    job = session->send_queue_cursor.job;
+    job_offset = session->send_queue_cursor.offset;
+  }
   while (job) {
-    length += job->impl->get_length(job);
-    job = (const SessionSendQueueJob *)job->node.next;
+    const size_t job_length = job->impl->get_length(job);
+    if (*offset_in_out < (job_offset + job_length)) {
+      session->send_queue_cursor.job = job;
+      session->send_queue_cursor.offset = job_offset;
+      *offset_in_out -= job_offset;
+      return job;
+    }
+    job_offset += job_length;
+    job = (SessionSendQueueJob *)job->node.next;
   }
-  return length;
+  return NULL;
 }
 
 size_t comm_session_send_queue_copy(CommSession *session, uint32_t start_offset,
                                     size_t length, uint8_t *data_out) {
   size_t remaining_length = length;
-  const SessionSendQueueJob *job = session->send_queue_head;
+  SessionSendQueueJob *job = prv_find_job(session, &start_offset);
   while (job && remaining_length) {
+    const size_t copied_length = job->impl->copy(job, start_offset, remaining_length, data_out);
+    remaining_length -= copied_length;
+    data_out += copied_length;
+    start_offset = 0;
+    job = (SessionSendQueueJob *)job->node.next;
+  }
+  return (length - remaining_length);
+}
+
+size_t comm_session_send_queue_get_segments(CommSession *session, uint32_t start_offset,
+                                            size_t length, SessionSendQueueSegment *segments_out,
+                                            size_t max_segments) {
+  size_t num_segments = 0;
+  SessionSendQueueJob *job = prv_find_job(session, &start_offset);
+  while (job && length && (num_segments < max_segments)) {
     const size_t job_length = job->impl->get_length(job);
-    if (job_length <= start_offset) {
-      start_offset -= job_length;
-    } else {
-      const size_t copied_length = job->impl->copy(job, start_offset, remaining_length, data_out);
-      remaining_length -= copied_length;
-      data_out += copied_length;
+    const uint8_t *data;
+    size_t segment_length = job->impl->get_read_pointer_at_offset(job, start_offset, &data);
+    segment_length = MIN(MIN(segment_length, job_length - start_offset), length);
+    if (segment_length == 0) {
+      break;
+    }
+    segments_out[num_segments++] = (const SessionSendQueueSegment) {
+      .data = data,
+      .length = segment_length,
+    };
+    length -= segment_length;
+    start_offset += segment_length;
+    if (start_offset == job_length) {
+      job = (SessionSendQueueJob *)job->node.next;
       start_offset = 0;
     }
-    job = (SessionSendQueueJob *)job->node.next;
   }
-  return (length - remaining_length);
+  return num_segments;
 }
 
 size_t comm_session_send_queue_get_read_pointer(const CommSession *session,
@@ -93,10 +136,11 @@ size_t comm_session_send_queue_get_read_pointer(const CommSession *session,
   return job->impl->get_read_pointer(job, data_out);
 }
 
-void comm_session_send_queue_consume(CommSession *session, size_t remaining_length) {
+void comm_session_send_queue_consume(CommSession *session, size_t length) {
   // The data has sucessfully been sent out at this point
   PBL_ASSERTN(session->send_queue_head);
   SessionSendQueueJob *job = session->send_queue_head;
+  size_t remaining_length = length;
   while (job && remaining_length) {
     const size_t job_length = job->impl->get_length(job);
     const size_t consume_length = MIN(remaining_length, job_length);
@@ -110,4 +154,14 @@ void comm_session_send_queue_consume(CommSession *session, size_t remaining_leng
     remaining_length -= consume_length;
     job = next;
   }
+
+  const size_t consumed_length = (length - remaining_length);
+  session->send_queue_length -= consumed_length;
+  // The offsets into the send queue moved by the consumed length, unless the cursor's job got
+  // consumed (in part), then the next read starts at the head again:
+  if (session->send_queue_cursor.offset >= consumed_length) {
+    session->send_queue_cursor.offset -= consumed_length;
+  } else {
+    session->send_queue_cursor.job = NULL;
+  }
 }
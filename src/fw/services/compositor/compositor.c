@@ -81,6 +81,10 @@ static CompositorTransitionState s_animation_state;
 
 static bool s_framebuffer_frozen;
 
+//! Whether s_framebuffer holds nothing but the last unscaled copy of the app framebuffer. If it
+//! does, the next app render only needs to copy the parts of the app framebuffer that changed.
+static bool s_app_framebuffer_copied;
+
 //! Animation .update function for the AnimationImplementation we use to drive our transitions.
 //! Wraps the .update function of the current CompositorTransition.
 static void prv_animation_update(Animation *animation, const AnimationProgress distance_normalized);
@@ -104,6 +108,8 @@ void compositor_init(void) {
   s_animation_state = (CompositorTransitionState) { 0 };
 
   s_framebuffer_frozen = false;
+
+  s_app_framebuffer_copied = false;
 }
 
 // Helper functions to make implementing transitions easier
@@ -133,6 +139,51 @@ void compositor_set_modal_transition_offset(GPoint modal_offset) {
   s_animation_state.modal_offset = modal_offset;
 }
 
+static bool prv_is_app_framebuffer_copied_unscaled(void);
+static void prv_scaled_app_fb_copy(const GBitmap *app_bitmap, const GRect update_rect,
+                                   bool copy_relative_to_origin, int16_t offset_y);
+
+//! Only system apps are known to mark everything they draw as dirty. Third-party apps can draw
+//! without calling layer_mark_dirty() and still expect all of their frame on the display.
+static bool prv_is_app_damage_trusted(void) {
+  const PebbleProcessMd *app_md = app_manager_get_current_app_md();
+  return app_md && !app_md->is_unprivileged;
+}
+
+//! Copies the parts of the app framebuffer the app marked as dirty since its last render
+static void prv_copy_app_framebuffer_damage(const FrameBuffer *app_framebuffer,
+                                            const GBitmap *app_bitmap) {
+  if (!app_framebuffer->is_dirty) {
+    return;
+  }
+
+  GBitmap dest_bitmap = compositor_get_framebuffer_as_bitmap();
+  const GRect display_rect = dest_bitmap.bounds;
+  // The app framebuffer lives in app memory, don't trust anything in it
+  const GDirtyRegion *damage = &app_framebuffer->dirty_region;
+  const unsigned int num_rects = MIN(damage->num_rects, GDIRTY_REGION_MAX_RECTS);
+  for (unsigned int i = 0; i < num_rects; i++) {
+    GRect rect = damage->rects[i];
+    grect_standardize(&rect);
+    grect_clip(&rect, &display_rect);
+    if (grect_is_empty(&rect)) {
+      continue;
+    }
+    GBitmap sub_bitmap;
+    gbitmap_init_as_sub_bitmap(&sub_bitmap, app_bitmap, rect);
+    bitblt_bitmap_into_bitmap(&dest_bitmap, &sub_bitmap, rect.origin, GCompOpAssign,
+                              GColorWhite);
+    framebuffer_mark_dirty_rect(&s_framebuffer, rect);
+  }
+}
+
+//! Same as framebuffer_reset_dirty() without asserting on the size the app could have modified
+static void prv_reset_app_framebuffer_damage(FrameBuffer *app_framebuffer) {
+  app_framebuffer->dirty_rect = GRectZero;
+  gdirty_region_reset(&app_framebuffer->dirty_region);
+  app_framebuffer->is_dirty = false;
+}
+
 void compositor_render_app(void) {
   PBL_ASSERT_TASK(PebbleTask_KernelMain);
 
@@ -141,24 +192,37 @@ void compositor_render_app(void) {
   // Don't trust the size field within the app framebuffer as the app could modify it.
   GSize app_framebuffer_size;
   app_manager_get_framebuffer_size(&app_framebuffer_size);
+  FrameBuffer *app_framebuffer = app_state_get_framebuffer();
+  const GBitmap app_bitmap = framebuffer_get_as_bitmap(app_framebuffer, &app_framebuffer_size);
 
+  const bool copy_unscaled = prv_is_app_framebuffer_copied_unscaled();
+  if (s_app_framebuffer_copied && copy_unscaled && (s_state == CompositorState_App) &&
+      !framebuffer_is_dirty(&s_framebuffer) && prv_is_app_damage_trusted()) {
+    prv_copy_app_framebuffer_damage(app_framebuffer, &app_bitmap);
+  } else {
+    // Fill entire framebuffer with black first to avoid artifacts
+    GBitmap dest_bitmap = compositor_get_framebuffer_as_bitmap();
+    memset(dest_bitmap.addr, GColorBlack.argb, framebuffer_get_size_bytes(&s_framebuffer));
 
-  // Fill entire framebuffer with black first to avoid artifacts
-  GBitmap dest_bitmap = compositor_get_framebuffer_as_bitmap();
-  memset(dest_bitmap.addr, GColorBlack.argb, framebuffer_get_size_bytes(&s_framebuffer));
+    prv_scaled_app_fb_copy(&app_bitmap, GRect(0, 0, DISP_COLS, DISP_ROWS),
+                           false /* copy_relative_to_origin */, 0 /* offset_y */);
 
-  compositor_scaled_app_fb_copy(GRect(0, 0, DISP_COLS, DISP_ROWS), false /* copy_relative_to_origin */);
+    if (s_state == CompositorState_AppAndModal) {
+      compositor_render_modal();
+    }
 
-  if (s_state == CompositorState_AppAndModal) {
-    compositor_render_modal();
+    framebuffer_dirty_all(&s_framebuffer);
   }
 
   PROFILER_NODE_STOP(compositor);
 
-  framebuffer_dirty_all(&s_framebuffer);
+  prv_reset_app_framebuffer_damage(app_framebuffer);
+  s_app_framebuffer_copied = copy_unscaled && (s_state == CompositorState_App);
 }
 
 void compositor_render_modal(void) {
+  s_app_framebuffer_copied = false;
+
   GContext *ctx = kernel_ui_get_graphics_context();
 
   // We make this GDrawState static to save stack space, thus the declaration and init must be
@@ -307,6 +371,8 @@ void compositor_transition_render(CompositorTransitionUpdateFunc func, Animation
     }
     return;
   }
+  s_app_framebuffer_copied = false;
+
   GContext *ctx = kernel_ui_get_graphics_context();
 
   // Save the draw state in a static to save stack space
@@ -377,6 +443,8 @@ static void prv_animation_teardown(Animation *animation) {
 }
 
 void compositor_transition(const CompositorTransition *compositor_animation) {
+  s_app_framebuffer_copied = false;
+
   if (s_animation_state.animation != NULL) {
     PBL_LOG_DBG("Animation <%u> in progress, cancelling",
             (int) s_animation_state.animation);
@@ -499,6 +567,10 @@ void compositor_unfreeze(void) {
   launcher_task_add_callback(prv_compositor_unfreeze_cb, NULL);
 }
 
+void compositor_invalidate_framebuffer(void) {
+  s_app_framebuffer_copied = false;
+}
+
 static bool prv_app_framebuffer_matches_display(void) {
   GSize app_framebuffer_size;
   app_manager_get_framebuffer_size(&app_framebuffer_size);
@@ -532,13 +604,31 @@ static TimelinePeekUnsupportedFaceMode prv_get_unsupported_face_mode_for_timelin
 }
 #endif
 
+//! @return whether the app framebuffer is copied to the display as it is, without any scaling or
+//! shifting
+static bool prv_is_app_framebuffer_copied_unscaled(void) {
+#if TIMELINE_PEEK_WATCHFACE_FIT_SUPPORTED && !defined(CONFIG_RECOVERY_FW)
+  if (prv_get_unsupported_face_mode_for_timeline_peek() !=
+      TimelinePeekUnsupportedFaceMode_None) {
+    return false;
+  }
+#endif
+  return prv_app_framebuffer_matches_display();
+}
+
 void compositor_scaled_app_fb_copy(const GRect update_rect, bool copy_relative_to_origin) {
   compositor_scaled_app_fb_copy_offset(update_rect, copy_relative_to_origin, 0 /* offset_y */);
 }
 
 void compositor_scaled_app_fb_copy_offset(const GRect update_rect, bool copy_relative_to_origin,
                                           int16_t offset_y) {
-  GBitmap src_bitmap = compositor_get_app_framebuffer_as_bitmap();
+  const GBitmap app_bitmap = compositor_get_app_framebuffer_as_bitmap();
+  prv_scaled_app_fb_copy(&app_bitmap, update_rect, copy_relative_to_origin, offset_y);
+}
+
+static void prv_scaled_app_fb_copy(const GBitmap *app_bitmap, const GRect update_rect,
+                                   bool copy_relative_to_origin, int16_t offset_y) {
+  GBitmap src_bitmap = *app_bitmap;
   GBitmap dst_bitmap = compositor_get_framebuffer_as_bitmap();
 
 #if TIMELINE_PEEK_WATCHFACE_FIT_SUPPORTED && !defined(CONFIG_RECOVERY_FW)
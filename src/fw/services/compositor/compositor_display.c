@@ -35,8 +35,22 @@ static const uint8_t s_corner_shape[] = { 3, 3, 2, 1 };
 #define CORNER_SAVE_ROWS ARRAY_LENGTH(s_corner_shape)
 #define CORNER_MAX_WIDTH 3
 static uint8_t s_saved_corners[CORNER_SAVE_ROWS * 2][CORNER_MAX_WIDTH * 2]; // [row][left+right pixels]
-static uint8_t s_dirty_y0;
-static uint8_t s_dirty_y1;
+//! Which rows of s_saved_corners hold pixels to restore, rows between dirty rects aren't flushed
+static bool s_corner_saved[CORNER_SAVE_ROWS * 2];
+#endif
+
+#ifndef CONFIG_DISPLAY_JDI_SF32LB
+//! @return the first row at or below y that one of the dirty rects covers, y_end if there's none
+static uint16_t prv_next_dirty_row(const FrameBuffer *fb, uint16_t y, uint16_t y_end) {
+  uint16_t next_row = y_end;
+  for (unsigned int i = 0; i < fb->dirty_region.num_rects; i++) {
+    const GRect *rect = &fb->dirty_region.rects[i];
+    if (y < rect->origin.y + rect->size.h) {
+      next_row = MIN(next_row, MAX(y, rect->origin.y));
+    }
+  }
+  return next_row;
+}
 #endif
 
 //! display_update get next line callback
@@ -45,6 +59,11 @@ static bool prv_flush_get_next_line_cb(DisplayRow* row) {
 
   s_current_flush_line = MAX(s_current_flush_line, fb->dirty_rect.origin.y);
   const uint16_t y_end = fb->dirty_rect.origin.y + fb->dirty_rect.size.h;
+#ifndef CONFIG_DISPLAY_JDI_SF32LB
+  // Skip the rows between the dirty rects. The JDI driver sends a single window of rows so it gets
+  // every row the dirty rects span.
+  s_current_flush_line = prv_next_dirty_row(fb, s_current_flush_line, y_end);
+#endif
   if (s_current_flush_line < y_end) {
     row->address = s_current_flush_line;
     void *fb_line = framebuffer_get_line(fb, s_current_flush_line);
@@ -85,6 +104,7 @@ static bool prv_flush_get_next_line_cb(DisplayRow* row) {
         s_saved_corners[save_idx][pixel] = line[pixel];
         s_saved_corners[save_idx][CORNER_MAX_WIDTH + pixel] = line[DISP_COLS - pixel - 1];
       }
+      s_corner_saved[save_idx] = true;
       // Mask corner pixels to black (rounded corner effect)
       for (uint8_t pixel = 0; pixel < corner_width; ++pixel) {
         line[pixel] = GColorBlackARGB8;
@@ -109,17 +129,17 @@ static void prv_flush_complete_cb(void) {
   FrameBuffer *fb = compositor_get_framebuffer();
   for (uint8_t i = 0; i < CORNER_SAVE_ROWS; ++i) {
     uint8_t corner_width = s_corner_shape[i];
-    // Top corners (only if row was in dirty region)
-    if (i >= s_dirty_y0 && i <= s_dirty_y1) {
+    // Top corners (only if the row was flushed)
+    if (s_corner_saved[i]) {
       uint8_t *top_line = framebuffer_get_line(fb, i);
       for (uint8_t pixel = 0; pixel < corner_width; ++pixel) {
         top_line[pixel] = s_saved_corners[i][pixel];
         top_line[DISP_COLS - pixel - 1] = s_saved_corners[i][CORNER_MAX_WIDTH + pixel];
       }
     }
-    // Bottom corners (only if row was in dirty region)
+    // Bottom corners (only if the row was flushed)
     uint8_t bottom_row = DISP_ROWS - i - 1;
-    if (bottom_row >= s_dirty_y0 && bottom_row <= s_dirty_y1) {
+    if (s_corner_saved[CORNER_SAVE_ROWS + i]) {
       uint8_t *bottom_line = framebuffer_get_line(fb, bottom_row);
       for (uint8_t pixel = 0; pixel < corner_width; ++pixel) {
         bottom_line[pixel] = s_saved_corners[CORNER_SAVE_ROWS + i][pixel];
@@ -127,6 +147,7 @@ static void prv_flush_complete_cb(void) {
       }
     }
   }
+  memset(s_corner_saved, 0, sizeof(s_corner_saved));
 #endif
 
   s_current_flush_line = 0;
@@ -144,12 +165,7 @@ void compositor_display_update(void (*handle_update_complete_cb)(void)) {
   }
 #ifdef CONFIG_BOARD_GETAFIX
   // Force full screen updates - partial ROI causes animation issues on getafix display
-  fb->dirty_rect = (GRect){ GPointZero, fb->size };
-#endif
-#ifdef CONFIG_BOARD_OBELIX
-  // Capture dirty region bounds for corner restoration later
-  s_dirty_y0 = fb->dirty_rect.origin.y;
-  s_dirty_y1 = fb->dirty_rect.origin.y + fb->dirty_rect.size.h - 1;
+  framebuffer_dirty_all(fb);
 #endif
   s_update_complete_handler = handle_update_complete_cb;
   s_current_flush_line = 0;
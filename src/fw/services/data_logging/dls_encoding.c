@@ -0,0 +1,196 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "pbl/services/data_logging/dls_encoding.h"
+
+#include "kernel/pbl_malloc.h"
+#include "pbl/util/math.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+// ----------------------------------------------------------------------------------------
+// Delta + varint
+
+static int64_t prv_get_item_value(DataLoggingItemType item_type, uint16_t item_size,
+                                  const uint8_t *item) {
+  uint32_t value = 0;
+  memcpy(&value, item, item_size);
+  if (item_type == DATA_LOGGING_INT && item_size < sizeof(value)) {
+    // Sign extend
+    const uint32_t sign_bit = 1u << (item_size * 8 - 1);
+    return (int64_t)(int32_t)((value ^ sign_bit) - sign_bit);
+  }
+  return (item_type == DATA_LOGGING_INT) ? (int64_t)(int32_t)value : (int64_t)value;
+}
+
+static size_t prv_encode_delta_varint(DataLoggingItemType item_type, uint16_t item_size,
+                                      const uint8_t *data, size_t num_bytes,
+                                      uint8_t *out, size_t out_size) {
+  size_t out_length = 0;
+  int64_t prev_value = 0;
+  for (size_t offset = 0; offset < num_bytes; offset += item_size) {
+    const int64_t value = prv_get_item_value(item_type, item_size, &data[offset]);
+    const int64_t delta = value - prev_value;
+    prev_value = value;
+
+    // Zigzag, so small negative deltas get short varints too:
+    uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    do {
+      if (out_length >= out_size) {
+        return 0;
+      }
+      const uint8_t byte = zigzag & 0x7f;
+      zigzag >>= 7;
+      out[out_length++] = byte | (zigzag ? 0x80 : 0);
+    } while (zigzag);
+  }
+  return out_length;
+}
+
+// ----------------------------------------------------------------------------------------
+// LZ4 block
+
+#define LZ4_MIN_MATCH (4)
+//! The last 5 bytes of a block are always literals
+#define LZ4_LAST_LITERALS (5)
+//! The last match starts at least 12 bytes before the end of the block
+#define LZ4_MATCH_FIND_LIMIT (12)
+#define LZ4_MAX_OFFSET (UINT16_MAX)
+#define LZ4_HASH_BITS (9)
+
+static uint32_t prv_read32(const uint8_t *data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static uint32_t prv_hash(uint32_t value) {
+  return (value * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+//! Writes the part of a length that didn't fit into the token
+static bool prv_write_length(uint8_t **out, const uint8_t *out_end, size_t length) {
+  for (; length >= UINT8_MAX; length -= UINT8_MAX) {
+    if (*out >= out_end) {
+      return false;
+    }
+    *(*out)++ = UINT8_MAX;
+  }
+  if (*out >= out_end) {
+    return false;
+  }
+  *(*out)++ = length;
+  return true;
+}
+
+//! Writes a sequence of literals followed by a match, the last sequence has no match
+static bool prv_write_sequence(uint8_t **out, const uint8_t *out_end, const uint8_t *literals,
+                               size_t num_literals, size_t offset, size_t match_length) {
+  if (*out >= out_end) {
+    return false;
+  }
+  uint8_t *token = (*out)++;
+  *token = MIN(num_literals, 15) << 4;
+  if (num_literals >= 15 && !prv_write_length(out, out_end, num_literals - 15)) {
+    return false;
+  }
+  if ((size_t)(out_end - *out) < num_literals) {
+    return false;
+  }
+  memcpy(*out, literals, num_literals);
+  *out += num_literals;
+
+  if (match_length == 0) {
+    return true;
+  }
+  if (out_end - *out < 2) {
+    return false;
+  }
+  *(*out)++ = offset & 0xff;
+  *(*out)++ = offset >> 8;
+  const size_t length = match_length - LZ4_MIN_MATCH;
+  *token |= MIN(length, 15);
+  return (length < 15 || prv_write_length(out, out_end, length - 15));
+}
+
+//! Greedy, single pass: every position is looked up by the hash of the 4 bytes at it
+static size_t prv_encode_lz4(const uint8_t *data, size_t num_bytes, uint8_t *out,
+                             size_t out_size) {
+  if (num_bytes > LZ4_MAX_OFFSET) {
+    return 0;
+  }
+  uint16_t *table = kernel_zalloc(sizeof(uint16_t) << LZ4_HASH_BITS);
+  if (!table) {
+    return 0;
+  }
+
+  uint8_t *out_ptr = out;
+  const uint8_t *out_end = out + out_size;
+  size_t anchor = 0;
+  size_t pos = 0;
+  bool success = true;
+  if (num_bytes > LZ4_MATCH_FIND_LIMIT) {
+    const size_t match_limit = num_bytes - LZ4_LAST_LITERALS;
+    while (pos < num_bytes - LZ4_MATCH_FIND_LIMIT) {
+      const uint32_t bytes = prv_read32(&data[pos]);
+      const uint32_t hash = prv_hash(bytes);
+      const size_t candidate = table[hash];
+      table[hash] = pos;
+      if (candidate >= pos || prv_read32(&data[candidate]) != bytes) {
+        ++pos;
+        continue;
+      }
+
+      size_t length = LZ4_MIN_MATCH;
+      while (pos + length < match_limit && data[candidate + length] == data[pos + length]) {
+        ++length;
+      }
+      success = prv_write_sequence(&out_ptr, out_end, &data[anchor], pos - anchor,
+                                   pos - candidate, length);
+      if (!success) {
+        break;
+      }
+      pos += length;
+      anchor = pos;
+    }
+  }
+  if (success) {
+    success = prv_write_sequence(&out_ptr, out_end, &data[anchor], num_bytes - anchor,
+                                 0 /* offset */, 0 /* match_length */);
+  }
+
+  kernel_free(table);
+  return success ? (size_t)(out_ptr - out) : 0;
+}
+
+// ----------------------------------------------------------------------------------------
+
+DataLoggingEncoding dls_encoding_for_items(DataLoggingItemType item_type, uint16_t item_size) {
+  switch (item_type) {
+    case DATA_LOGGING_UINT:
+    case DATA_LOGGING_INT:
+      return DataLoggingEncodingDeltaVarint;
+    case DATA_LOGGING_BYTE_ARRAY:
+      return DataLoggingEncodingLZ4;
+  }
+  return DataLoggingEncodingRaw;
+}
+
+size_t dls_encoding_encode(DataLoggingEncoding encoding, DataLoggingItemType item_type,
+                           uint16_t item_size, const uint8_t *data, size_t num_bytes,
+                           uint8_t *out, size_t out_size) {
+  switch (encoding) {
+    case DataLoggingEncodingRaw:
+      if (num_bytes > out_size) {
+        return 0;
+      }
+      memcpy(out, data, num_bytes);
+      return num_bytes;
+    case DataLoggingEncodingDeltaVarint:
+      return prv_encode_delta_varint(item_type, item_size, data, num_bytes, out, out_size);
+    case DataLoggingEncodingLZ4:
+      return prv_encode_lz4(data, num_bytes, out, out_size);
+  }
+  return 0;
+}
@@ -2,6 +2,7 @@
 /* SPDX-License-Identifier: Apache-2.0 */
 
 #include "pbl/services/data_logging/dls_private.h"
+#include "pbl/services/data_logging/dls_encoding.h"
 #include "pbl/services/data_logging/dls_endpoint.h"
 #include "pbl/services/data_logging/dls_list.h"
 #include "pbl/services/data_logging/dls_storage.h"
@@ -59,6 +60,9 @@ typedef struct PACKED {
    uint16_t data_item_size;
 } DataLoggingOpenSessionMessage;
 
+_Static_assert(sizeof(DataLoggingSendWindowedDataMessage) <= sizeof(DataLoggingSendDataMessage),
+               "Windowed data messages must fit DLS_ENDPOINT_MAX_PAYLOAD bytes of data");
+
 static const uint16_t ENDPOINT_ID_DATA_LOGGING = 0x1a7a;
 
 #define ACK_NACK_TIMEOUT_TICKS (30 * RTC_TICKS_HZ)
@@ -95,6 +99,12 @@ static void update_session_state(DataLoggingSession *session, DataLoggingSession
   }
 }
 
+//! Forget about the data sent to the phone that hasn't been acked yet, so it gets sent again
+static void prv_drop_data_in_flight(DataLoggingSession *session) {
+  session->comm.num_bytes_pending = 0;
+  session->comm.num_messages_pending = 0;
+}
+
 static void send_timeout_msg(void *session_id_param) {
   uint8_t session_id = (uint8_t)(uintptr_t)session_id_param;
   CommSession *session = comm_session_get_system_session();
@@ -131,6 +141,7 @@ static bool check_ack_timeout_for_session(DataLoggingSession *session, void *dat
     // we did was process one that already expired, 2.) it can cause an infinite recursion
     // because reschedule_ack_timeout() will call check_ack_timeout() (which we are already in) if
     // any other timers have already expired.
+    prv_drop_data_in_flight(session);
     update_session_state(session, DataLoggingSessionCommStateIdle, false /*reschedule*/);
   }
 
@@ -216,6 +227,13 @@ static void dls_endpoint_print_message(uint8_t *message, int num_bytes) {
         msg->session_id, msg->items_left_hereafter, msg->crc32, num_bytes);
       break;
     }
+    case DataLoggingEndpointCmdWindowedData:
+    {
+      DataLoggingSendWindowedDataMessage *msg = (DataLoggingSendWindowedDataMessage *)message;
+      PBL_LOG_D_DBG(LOG_DOMAIN_DATA_LOGGING, "Sending data with session_id %"PRIu8", sequence %"PRIu8", encoding %"PRIu8", crc 0x%"PRIx32", num_bytes %d of %"PRIu16,
+        msg->session_id, msg->sequence, msg->encoding, msg->crc32, num_bytes, msg->num_bytes);
+      break;
+    }
     default:
       PBL_LOG_D_DBG(LOG_DOMAIN_DATA_LOGGING, "Message type 0x%x not recognized", message[0]);
   }
@@ -239,6 +257,9 @@ bool dls_endpoint_open_session(DataLoggingSession *session) {
 
   dls_endpoint_print_message((uint8_t *)&msg, 0);
 
+  // Whatever hasn't been acked yet gets sent again once the session has opened
+  prv_drop_data_in_flight(session);
+  session->comm.next_sequence = 0;
   update_session_state(session, DataLoggingSessionCommStateOpening, true /*reschedule*/);
 
   return (comm_session_send_data(comm_session, ENDPOINT_ID_DATA_LOGGING,
@@ -315,7 +336,129 @@ bool dls_endpoint_send_data(DataLoggingSession *logging_session, const uint8_t *
   return true;
 }
 
-static void prv_dls_endpoint_handle_ack(uint8_t session_id) {
+bool dls_endpoint_is_windowed(void) {
+  CommSession *session = comm_session_get_system_session();
+  return (session && comm_session_has_capability(session, CommSessionDataLoggingWindowSupport));
+}
+
+unsigned int dls_endpoint_get_num_messages_to_send(DataLoggingSession *logging_session) {
+  mutex_lock(s_endpoint_data.mutex);
+  unsigned int num_messages = 0;
+  switch (logging_session->comm.state) {
+    case DataLoggingSessionCommStateOpening:
+      break;
+    case DataLoggingSessionCommStateIdle:
+      num_messages = dls_endpoint_is_windowed() ? DLS_ENDPOINT_MAX_MESSAGES_IN_FLIGHT : 1;
+      break;
+    case DataLoggingSessionCommStateSending:
+      // Only windowed data messages can be sent before the ones in flight have been acked
+      if (logging_session->comm.num_messages_pending > 0 && dls_endpoint_is_windowed()) {
+        num_messages = DLS_ENDPOINT_MAX_MESSAGES_IN_FLIGHT
+                       - logging_session->comm.num_messages_pending;
+      }
+      break;
+  }
+  mutex_unlock(s_endpoint_data.mutex);
+  return num_messages;
+}
+
+bool dls_endpoint_send_windowed_data(DataLoggingSession *logging_session,
+                                     DataLoggingEncoding encoding, const uint8_t *data,
+                                     unsigned int num_bytes, unsigned int num_decoded_bytes,
+                                     uint32_t crc32) {
+  CommSession *session = comm_session_get_system_session();
+  if (!session) {
+    return false;
+  }
+
+  mutex_lock(s_endpoint_data.mutex);
+  DataLoggingSessionComm *comm = &logging_session->comm;
+  const bool is_window_open =
+      (comm->state == DataLoggingSessionCommStateIdle) ||
+      (comm->state == DataLoggingSessionCommStateSending && comm->num_messages_pending > 0 &&
+       comm->num_messages_pending < DLS_ENDPOINT_MAX_MESSAGES_IN_FLIGHT);
+  if (!is_window_open) {
+    mutex_unlock(s_endpoint_data.mutex);
+    // Same as dls_endpoint_send_data(), we'll send next time around
+    return true;
+  }
+
+  const uint32_t total_length = sizeof(DataLoggingSendWindowedDataMessage) + num_bytes;
+  const uint32_t timeout_ms = 500;
+  SendBuffer *sb = comm_session_send_buffer_begin_write(session, ENDPOINT_ID_DATA_LOGGING,
+                                                        total_length, timeout_ms);
+  if (!sb) {
+    mutex_unlock(s_endpoint_data.mutex);
+    return false;
+  }
+
+  const DataLoggingSendWindowedDataMessage header = (const DataLoggingSendWindowedDataMessage) {
+    .command = DataLoggingEndpointCmdWindowedData,
+    .session_id = comm->session_id,
+    .sequence = comm->next_sequence,
+    .encoding = encoding,
+    .num_bytes = num_decoded_bytes,
+    .crc32 = crc32,
+  };
+  comm_session_send_buffer_write(sb, (const uint8_t *) &header, sizeof(header));
+  comm_session_send_buffer_write(sb, data, num_bytes);
+  comm_session_send_buffer_end_write(sb);
+
+  dls_endpoint_print_message((uint8_t *) &header, num_bytes);
+
+  comm->message_bytes_pending[comm->next_sequence % DLS_ENDPOINT_MAX_MESSAGES_IN_FLIGHT] =
+      num_decoded_bytes;
+  ++comm->next_sequence;
+  ++comm->num_messages_pending;
+  comm->num_bytes_pending += num_decoded_bytes;
+
+  update_session_state(logging_session, DataLoggingSessionCommStateSending, true /*reschedule*/);
+
+  mutex_unlock(s_endpoint_data.mutex);
+
+  return true;
+}
+
+//! Handles an ack of the windowed data messages up to and including the given sequence number.
+//! Must be called with the endpoint mutex held, returns with it released.
+static void prv_handle_windowed_data_ack(DataLoggingSession *session, uint8_t sequence) {
+  DataLoggingSessionComm *comm = &session->comm;
+  const uint8_t oldest_sequence = comm->next_sequence - comm->num_messages_pending;
+  const uint8_t num_messages_acked = (uint8_t)(sequence - oldest_sequence) + 1;
+  if (num_messages_acked > comm->num_messages_pending) {
+    // Acks a message we've already given up on
+    PBL_LOG_D_WRN(LOG_DOMAIN_DATA_LOGGING, "Stale ACK %"PRIu8" for id: %"PRIu8,
+                  sequence, comm->session_id);
+    mutex_unlock(s_endpoint_data.mutex);
+    return;
+  }
+
+  int num_bytes_acked = 0;
+  for (uint8_t i = 0; i < num_messages_acked; ++i) {
+    const uint8_t acked_sequence = oldest_sequence + i;
+    num_bytes_acked += comm->message_bytes_pending[acked_sequence %
+                                                   DLS_ENDPOINT_MAX_MESSAGES_IN_FLIGHT];
+  }
+  comm->num_messages_pending -= num_messages_acked;
+  comm->num_bytes_pending -= num_bytes_acked;
+  comm->nack_count = 0;
+  update_session_state(session, (comm->num_messages_pending > 0)
+                                    ? DataLoggingSessionCommStateSending
+                                    : DataLoggingSessionCommStateIdle,
+                       true /*reschedule*/);
+
+  mutex_unlock(s_endpoint_data.mutex);
+
+  // unlock for time consuming activities
+  dls_storage_consume(session, num_bytes_acked);
+
+  // refill the window
+  dls_private_send_session(session, true);
+}
+
+//! @param sequence The sequence number of the windowed data message acked, NULL for acks of
+//! anything else
+static void prv_dls_endpoint_handle_ack(uint8_t session_id, const uint8_t *sequence) {
   DataLoggingSession *session = dls_list_find_by_session_id(session_id);
   if (session == NULL) {
     PBL_LOG_D_WRN(LOG_DOMAIN_DATA_LOGGING, "Received ack for non-existent session id: %"PRIu8, session_id);
@@ -331,11 +474,21 @@ static void prv_dls_endpoint_handle_ack(uint8_t session_id) {
       PBL_LOG_ERR("Unexpected ACK");
       break;
     case DataLoggingSessionCommStateOpening:
+      if (sequence) {
+        // Ack of data sent before the session got reopened
+        break;
+      }
       update_session_state(session, DataLoggingSessionCommStateIdle, true /*reschedule*/);
       mutex_unlock(s_endpoint_data.mutex);
       dls_private_send_session(session, true);
       return;
     case DataLoggingSessionCommStateSending:
+      if (session->comm.num_messages_pending > 0) {
+        const uint8_t oldest_sequence =
+            session->comm.next_sequence - session->comm.num_messages_pending;
+        prv_handle_windowed_data_ack(session, sequence ? *sequence : oldest_sequence);
+        return;
+      }
       session->comm.nack_count = 0;
       update_session_state(session, DataLoggingSessionCommStateIdle, true /*reschedule*/);
 
@@ -377,7 +530,7 @@ static void prv_dls_endpoint_handle_nack(uint8_t session_id) {
       break;
     case DataLoggingSessionCommStateSending:
       //Maybe queue a resend
-      logging_session->comm.num_bytes_pending = 0;
+      prv_drop_data_in_flight(logging_session);
       if (++logging_session->comm.nack_count > MAX_NACK_COUNT) {
         PBL_LOG_ERR("Too many nacks. Flushing...");
         dls_storage_consume(logging_session, logging_session->storage.num_bytes);
@@ -509,7 +662,7 @@ void data_logging_protocol_msg_callback(CommSession *session, const uint8_t *dat
 
   switch (command & DLS_ENDPOINT_CMD_MASK) {
     case (DataLoggingEndpointCmdAck):
-      prv_dls_endpoint_handle_ack(data[1]);
+      prv_dls_endpoint_handle_ack(data[1], (length >= 2) ? &data[2] : NULL);
       break;
 
     case (DataLoggingEndpointCmdNack):
@@ -558,6 +711,7 @@ void dls_endpoint_init(void) {
 
 static bool prv_handle_disconnect_cb(DataLoggingSession *session, void *data) {
   session->comm.state = DataLoggingSessionCommStateIdle;
+  prv_drop_data_in_flight(session);
   return true;
 }
 
@@ -27,6 +27,8 @@
 #include "pbl/os/mutex.h"
 #include "system/passert.h"
 #include "kernel/util/sleep.h"
+#include "util/legacy_checksum.h"
+#include "pbl/util/math.h"
 #include "pbl/util/string.h"
 
 #include <string.h>
@@ -197,6 +199,110 @@ static void prv_remove_logging_session(DataLoggingSession *data) {
   dls_list_remove_session(logging_session);
 }
 
+// ----------------------------------------------------------------------------------------
+// Read the next whole chunks that haven't been sent yet out of the session's storage and send
+// them in a windowed data message, encoded if that makes them smaller. Reads as much as we expect
+// to fit into the message once encoded, going by how well the previous messages compressed.
+// Returns false on unexpected errors, else true. *sent is set to whether there was data to send.
+static bool prv_send_windowed_message(DataLoggingSession *logging_session,
+                                      DataLoggingEncoding encoding, uint8_t *read_buffer,
+                                      uint32_t read_buffer_size, uint8_t *encoded_buffer,
+                                      bool *sent) {
+  DataLoggingSessionComm *comm = &logging_session->comm;
+  const uint16_t item_size = logging_session->item_size;
+  PBL_ASSERTN(item_size <= DLS_ENDPOINT_MAX_PAYLOAD);
+
+  uint32_t read_size = DLS_ENDPOINT_MAX_PAYLOAD;
+  if (encoding != DataLoggingEncodingRaw && comm->encoded_read_size) {
+    read_size = MIN(comm->encoded_read_size, read_buffer_size);
+  }
+
+  *sent = false;
+  while (true) {
+    const int32_t read_bytes = dls_storage_read_after(logging_session, comm->num_bytes_pending,
+                                                      read_buffer,
+                                                      read_size - (read_size % item_size));
+    if (read_bytes <= 0) {
+      return (read_bytes == 0);
+    }
+
+    size_t encoded_bytes = 0;
+    if (encoding != DataLoggingEncodingRaw) {
+      encoded_bytes = dls_encoding_encode(encoding, logging_session->item_type, item_size,
+                                          read_buffer, read_bytes, encoded_buffer,
+                                          DLS_ENDPOINT_MAX_PAYLOAD);
+      if (encoded_bytes == 0 && (uint32_t)read_bytes > DLS_ENDPOINT_MAX_PAYLOAD) {
+        // Doesn't fit into a message even once encoded, try again with less
+        read_size = MAX((uint32_t)read_bytes / 2, DLS_ENDPOINT_MAX_PAYLOAD);
+        comm->encoded_read_size = read_size;
+        continue;
+      }
+      if (encoded_bytes) {
+        // Aim a little below a full message next time, a retry costs more than a smaller message
+        const uint32_t expected_read_size =
+            ((uint64_t)read_bytes * DLS_ENDPOINT_MAX_PAYLOAD * 7) / (8 * encoded_bytes);
+        comm->encoded_read_size = CLIP(expected_read_size, DLS_ENDPOINT_MAX_PAYLOAD,
+                                       read_buffer_size);
+      }
+    }
+
+    const uint32_t crc32 = legacy_defective_checksum_memory(read_buffer, read_bytes);
+    *sent = true;
+    if (encoded_bytes && encoded_bytes < (size_t)read_bytes) {
+      return dls_endpoint_send_windowed_data(logging_session, encoding, encoded_buffer,
+                                             encoded_bytes, read_bytes, crc32);
+    }
+    return dls_endpoint_send_windowed_data(logging_session, DataLoggingEncodingRaw, read_buffer,
+                                           read_bytes, read_bytes, crc32);
+  }
+}
+
+
+// ----------------------------------------------------------------------------------------
+// Fill the window of data messages the phone hasn't acked yet.
+// Returns false on unexpected errors, else true
+static bool prv_send_windowed_data(DataLoggingSession *logging_session) {
+  unsigned int num_messages = dls_endpoint_get_num_messages_to_send(logging_session);
+  if (num_messages == 0) {
+    return true;
+  }
+
+  DataLoggingEncoding encoding = dls_encoding_for_items(logging_session->item_type,
+                                                        logging_session->item_size);
+  uint32_t read_buffer_size = DLS_ENDPOINT_MAX_PAYLOAD;
+  uint8_t *read_buffer = NULL;
+  uint8_t *encoded_buffer = NULL;
+  if (encoding != DataLoggingEncodingRaw) {
+    read_buffer = kernel_malloc(DLS_ENDPOINT_MAX_ENCODED_READ_SIZE);
+    encoded_buffer = kernel_malloc(DLS_ENDPOINT_MAX_PAYLOAD);
+    if (read_buffer && encoded_buffer) {
+      read_buffer_size = DLS_ENDPOINT_MAX_ENCODED_READ_SIZE;
+    } else {
+      // Not worth failing over, send the data as it is
+      kernel_free(read_buffer);
+      kernel_free(encoded_buffer);
+      read_buffer = NULL;
+      encoded_buffer = NULL;
+      encoding = DataLoggingEncodingRaw;
+    }
+  }
+  if (!read_buffer) {
+    read_buffer = kernel_malloc_check(DLS_ENDPOINT_MAX_PAYLOAD);
+  }
+
+  bool success = true;
+  bool sent = true;
+  for (; success && sent && num_messages > 0; --num_messages) {
+    success = prv_send_windowed_message(logging_session, encoding, read_buffer, read_buffer_size,
+                                        encoded_buffer, &sent);
+  }
+
+  kernel_free(read_buffer);
+  kernel_free(encoded_buffer);
+  return success;
+}
+
+
 // ----------------------------------------------------------------------------------------
 // Grab the next chunk of bytes out of the session's storage and send it to the mobile
 // Returns false on unexpected errors, else true
@@ -229,6 +335,10 @@ bool dls_private_send_session(DataLoggingSession *logging_session, bool empty) {
     return true; // nothing to flush yet
   }
 
+  if (dls_endpoint_is_windowed()) {
+    return prv_send_windowed_data(logging_session);
+  }
+
   bool success = false;
   uint8_t *buffer = kernel_malloc_check(DLS_ENDPOINT_MAX_PAYLOAD);
   unsigned int num_bytes = DLS_ENDPOINT_MAX_PAYLOAD;
@@ -25,17 +25,22 @@ PBL_LOG_MODULE_DECLARE(service_data_logging, CONFIG_SERVICE_DATA_LOGGING_LOG_LEV
 
 
 typedef enum {
+  //! Chunks of up to DLS_MAX_CHUNK_SIZE_BYTES with a DLSChunkHeader
   DLS_VERSION_0 = 0x20,
+  //! Chunks of up to DLS_MAX_LARGE_CHUNK_SIZE_BYTES with a DLSLargeChunkHeader, which always end
+  //! on item boundaries
+  DLS_VERSION_1 = 0x21,
 } DLSFileHeaderVersion;
 
-static const DLSFileHeaderVersion DLS_CURRENT_VERSION = DLS_VERSION_0;
+static const DLSFileHeaderVersion DLS_CURRENT_VERSION = DLS_VERSION_1;
 
 // Set while executing dls_storage_rebuild() which is called from dls_init() during boot time
 // When set, we allow storage accesses from KernelMain whereas normally, only KernelBG is allowed.
 static bool s_initializing_storage = false;
 
 // Each session stores data in a separate pfs file with this data in the front. The file name
-// is constructed as ("%s%d", DLS_FILE_NAME_PREFIX, comm_session_id)
+// is constructed as ("%s%d", DLS_FILE_NAME_PREFIX, comm_session_id), with
+// DLS_V1_FILE_NAME_PREFIX for DLS_VERSION_1 files
 typedef struct PACKED {
   DLSFileHeaderVersion version:8;
 
@@ -66,6 +71,30 @@ typedef struct PACKED {
 _Static_assert(DLS_MAX_CHUNK_SIZE_BYTES < DLS_CHUNK_HDR_NUM_BYTES_UNINITIALIZED,
     "DLS_MAX_CHUNK_SIZE_BYTES must be less than DLS_CHUNK_HDR_NUM_BYTES_UNINITIALIZED");
 
+// Files of version DLS_VERSION_1 and up use larger chunks with this header instead, which costs
+// less flash and lets a single read (and a single data message) cover more data.
+#define DLS_LARGE_CHUNK_HDR_NUM_BYTES_UNINITIALIZED  0x7fff
+typedef struct PACKED {
+  //! Same as DLSChunkHeader.num_bytes
+  uint16_t num_bytes:15;
+  bool valid:1;             // Set to false after chunk is consumed.
+} DLSLargeChunkHeader;
+_Static_assert(sizeof(DLSLargeChunkHeader) == 2, "DLSLargeChunkHeader must be 2 bytes");
+
+// A chunk is always sent in a single data message, so it must fit into one.
+#define DLS_MAX_LARGE_CHUNK_SIZE_BYTES  512
+_Static_assert(DLS_MAX_LARGE_CHUNK_SIZE_BYTES
+               <= COMM_MAX_OUTBOUND_PAYLOAD_SIZE - sizeof(DataLoggingSendDataMessage),
+    "DLS_MAX_LARGE_CHUNK_SIZE_BYTES must fit into a data message");
+
+//! A chunk header of any version
+typedef struct {
+  uint16_t num_bytes;
+  bool valid;
+  //! No data has been written to this chunk yet, it's where the data ends
+  bool is_end;
+} DLSChunk;
+
 // Forward declarations
 static bool prv_realloc_storage(DataLoggingSession *session, uint32_t new_size);
 static bool prv_get_session_file(DataLoggingSession *session, uint32_t space_needed);
@@ -83,9 +112,31 @@ static void prv_assert_valid_task(void) {
 }
 
 
+// ----------------------------------------------------------------------------------------
+static size_t prv_chunk_header_size(const DataLoggingSessionStorage *storage) {
+  return (storage->version == DLS_VERSION_0) ? sizeof(DLSChunkHeader)
+                                             : sizeof(DLSLargeChunkHeader);
+}
+
+
+// ----------------------------------------------------------------------------------------
+static uint32_t prv_max_chunk_size(const DataLoggingSessionStorage *storage) {
+  return (storage->version == DLS_VERSION_0) ? DLS_MAX_CHUNK_SIZE_BYTES
+                                             : DLS_MAX_LARGE_CHUNK_SIZE_BYTES;
+}
+
+
 // -----------------------------------------------------------------------------------------
-static void prv_get_filename(char *name, DataLoggingSession *session) {
-  concat_str_int(DLS_FILE_NAME_PREFIX, session->comm.session_id, name, DLS_FILE_NAME_MAX_LEN);
+// Firmware from before DLS_VERSION_1 only looks at files with DLS_FILE_NAME_PREFIX and doesn't
+// check their version, so the newer files get a prefix of their own
+static void prv_get_filename_for_id(char *name, uint8_t session_id, uint8_t version) {
+  const char *prefix = (version == DLS_VERSION_0) ? DLS_FILE_NAME_PREFIX
+                                                  : DLS_V1_FILE_NAME_PREFIX;
+  concat_str_int(prefix, session_id, name, DLS_FILE_NAME_MAX_LEN);
+}
+
+static void prv_get_filename(char *name, DataLoggingSession *session, uint8_t version) {
+  prv_get_filename_for_id(name, session->comm.session_id, version);
 }
 
 
@@ -144,11 +195,52 @@ static size_t prv_pfs_get_file_size(int fd) {
 }
 
 
+// ----------------------------------------------------------------------------------------
+// Reads the chunk header at the current position of the file. Returns true on success
+static bool prv_read_chunk_header(const DataLoggingSessionStorage *storage, DLSChunk *chunk) {
+  if (storage->version == DLS_VERSION_0) {
+    DLSChunkHeader hdr;
+    if (!prv_pfs_read(storage->fd, &hdr, sizeof(hdr))) {
+      return false;
+    }
+    *chunk = (DLSChunk) {
+      .num_bytes = hdr.num_bytes,
+      .valid = hdr.valid,
+      .is_end = (hdr.valid && hdr.num_bytes == DLS_CHUNK_HDR_NUM_BYTES_UNINITIALIZED),
+    };
+  } else {
+    DLSLargeChunkHeader hdr;
+    if (!prv_pfs_read(storage->fd, &hdr, sizeof(hdr))) {
+      return false;
+    }
+    *chunk = (DLSChunk) {
+      .num_bytes = hdr.num_bytes,
+      .valid = hdr.valid,
+      .is_end = (hdr.valid && hdr.num_bytes == DLS_LARGE_CHUNK_HDR_NUM_BYTES_UNINITIALIZED),
+    };
+  }
+  return true;
+}
+
+
+// ----------------------------------------------------------------------------------------
+// Writes a chunk header at the current position of the file. Returns true on success
+static bool prv_write_chunk_header(const DataLoggingSessionStorage *storage, uint16_t num_bytes,
+                                   bool valid) {
+  if (storage->version == DLS_VERSION_0) {
+    DLSChunkHeader hdr = { .num_bytes = num_bytes, .valid = valid };
+    return prv_pfs_write(storage->fd, &hdr, sizeof(hdr));
+  }
+  DLSLargeChunkHeader hdr = { .num_bytes = num_bytes, .valid = valid };
+  return prv_pfs_write(storage->fd, &hdr, sizeof(hdr));
+}
+
+
 // -----------------------------------------------------------------------------------------
 // Callback passed to pfs_iterate_files. Used to find data logging files by name
 static bool prv_filename_filter_cb(const char *name) {
-  const int prefix_len = strlen(DLS_FILE_NAME_PREFIX);
-  return (strncmp(name, DLS_FILE_NAME_PREFIX, prefix_len) == 0);
+  return (strncmp(name, DLS_FILE_NAME_PREFIX, strlen(DLS_FILE_NAME_PREFIX)) == 0) ||
+         (strncmp(name, DLS_V1_FILE_NAME_PREFIX, strlen(DLS_V1_FILE_NAME_PREFIX)) == 0);
 }
 
 
@@ -241,12 +333,15 @@ static bool prv_make_file_system_space(uint32_t needed) {
 
 // -----------------------------------------------------------------------------------------
 // Open an existing or create a new storage file. If the write_offset in the storage structure
-// is 0, then write a new file header based on the info from the given session.
+// is 0, then write a new file header based on the info from the given session. New files are of
+// the version in the storage structure if it has one, DLS_CURRENT_VERSION otherwise.
 static bool prv_open_file(DataLoggingSessionStorage *storage, uint8_t op_flags,
                           int32_t size, DataLoggingSession *session) {
+  const DLSFileHeaderVersion version = storage->version ? storage->version : DLS_CURRENT_VERSION;
+
   // Open/Create the file
   char name[DLS_FILE_NAME_MAX_LEN];
-  prv_get_filename(name, session);
+  prv_get_filename(name, session, version);
 
   int fd = pfs_open(name, op_flags, FILE_TYPE_STATIC, size);
   if (fd < S_SUCCESS) {
@@ -260,7 +355,7 @@ static bool prv_open_file(DataLoggingSessionStorage *storage, uint8_t op_flags,
   }
 
   DLSFileHeader hdr = (DLSFileHeader) {
-    .version = DLS_CURRENT_VERSION,
+    .version = version,
     .comm_session_id = session->comm.session_id,
     .timestamp = session->session_created_timestamp,
     .tag = session->tag,
@@ -279,7 +374,8 @@ static bool prv_open_file(DataLoggingSessionStorage *storage, uint8_t op_flags,
   *storage = (DataLoggingSessionStorage) {
     .fd = fd,
     .write_offset = sizeof(hdr),
-    .read_offset = sizeof(hdr)
+    .read_offset = sizeof(hdr),
+    .version = hdr.version,
   };
 
   PBL_LOG_D_DBG(LOG_DOMAIN_DATA_LOGGING, "Created session-storage: "
@@ -337,8 +433,7 @@ static bool prv_get_session_file(DataLoggingSession *session, uint32_t space_nee
   }
 
   // Add a minium buffer to needed. This gives us a little insurance and also allows for the
-  // extra space needed for the chunk header byte that occurs at least once evvery
-  // DLS_MAX_CHUNK_SIZE_BYTES bytes.
+  // extra space needed for the chunk headers that occur at least once every chunk.
   space_needed += DLS_MIN_FREE_BYTES;
   uint32_t space_avail = file_size - session->storage.write_offset;
   if (space_needed <= space_avail) {
@@ -381,7 +476,7 @@ static bool prv_get_session_file(DataLoggingSession *session, uint32_t space_nee
   // Lop off old data at the beginning of the file if there is enough there.
   success = false;
   // If we are going to consume, we have to be prepared to consume at least 1 data chunk
-  min_delta_size = MAX(min_delta_size, DLS_MAX_CHUNK_SIZE_BYTES);
+  min_delta_size = MAX(min_delta_size, prv_max_chunk_size(&session->storage));
   if (session->storage.num_bytes <= min_delta_size) {
     // Lopping off the used bytes won't satisfy space_needed
     goto exit;
@@ -411,16 +506,38 @@ exit:
 
 
 // -----------------------------------------------------------------------------------------
-static bool prv_write_data(DataLoggingSessionStorage *storage, const void *data,
-                           uint32_t remaining_bytes) {
+// How many of the remaining bytes to write into the next chunk
+static uint32_t prv_get_chunk_length(const DataLoggingSessionStorage *storage,
+                                     uint16_t item_size, uint32_t remaining_bytes) {
+  if (storage->version == DLS_VERSION_0) {
+    return MIN(DLS_MAX_CHUNK_SIZE_BYTES, remaining_bytes);
+  }
+
+  // End the chunk on an item boundary, so that a read of whole chunks can always stop at any
+  // item. Only whole chunks get consumed, so the unread bytes start on an item boundary too.
+  const uint32_t item_offset = storage->num_bytes % item_size;
+  uint32_t chunk_length;
+  if (item_size <= DLS_MAX_LARGE_CHUNK_SIZE_BYTES) {
+    chunk_length = (DLS_MAX_LARGE_CHUNK_SIZE_BYTES / item_size) * item_size - item_offset;
+  } else {
+    chunk_length = MIN(item_size - item_offset, DLS_MAX_LARGE_CHUNK_SIZE_BYTES);
+  }
+  return MIN(chunk_length, remaining_bytes);
+}
+
+
+// -----------------------------------------------------------------------------------------
+static bool prv_write_data(DataLoggingSessionStorage *storage, uint16_t item_size,
+                           const void *data, uint32_t remaining_bytes) {
   const uint8_t *data_ptr = data;
+  const size_t chunk_header_size = prv_chunk_header_size(storage);
 
   // Write out in chunks
   while (remaining_bytes > 0) {
-    uint8_t data_chunk_length = MIN(DLS_MAX_CHUNK_SIZE_BYTES, remaining_bytes);
+    uint32_t data_chunk_length = prv_get_chunk_length(storage, item_size, remaining_bytes);
 
     // Write the data first, so if an error occurs, the header is left in the uninitialized state
-    if (!prv_pfs_seek(storage->fd, storage->write_offset + sizeof(DLSChunkHeader), FSeekSet)) {
+    if (!prv_pfs_seek(storage->fd, storage->write_offset + chunk_header_size, FSeekSet)) {
       return false;
     }
     if (!prv_pfs_write(storage->fd, (void *)data_ptr, data_chunk_length)) {
@@ -431,13 +548,12 @@ static bool prv_write_data(DataLoggingSessionStorage *storage, const void *data,
     if (!prv_pfs_seek(storage->fd, storage->write_offset, FSeekSet)) {
       return false;
     }
-    DLSChunkHeader data_hdr = { .num_bytes = data_chunk_length, .valid = true };
-    if (!prv_pfs_write(storage->fd, &data_hdr, sizeof(DLSChunkHeader))) {
+    if (!prv_write_chunk_header(storage, data_chunk_length, true /* valid */)) {
       return false;
     }
 
     // Bump pointer and count
-    storage->write_offset += data_chunk_length + sizeof(DLSChunkHeader);
+    storage->write_offset += data_chunk_length + chunk_header_size;
     storage->num_bytes += data_chunk_length;
 
     remaining_bytes -= data_chunk_length;
@@ -460,9 +576,11 @@ static bool prv_realloc_storage(DataLoggingSession *session, uint32_t new_size)
   PBL_LOG_D_DBG(LOG_DOMAIN_DATA_LOGGING, "Before compaction: num_bytes: %"PRIu32", write_offset:%"PRIu32,
             session->storage.num_bytes, session->storage.write_offset);
 
-  // Init a storage struct and create a new file for the compacted data
+  // Init a storage struct and create a new file for the compacted data. It keeps the version, and
+  // with it the name, of the old one so the new file replaces it.
   DataLoggingSessionStorage new_storage = {
     .fd = DLS_INVALID_FILE,
+    .version = session->storage.version,
   };
   success = prv_open_file(&new_storage, OP_FLAG_OVERWRITE | OP_FLAG_READ, new_size,
                           session);
@@ -478,14 +596,16 @@ static bool prv_realloc_storage(DataLoggingSession *session, uint32_t new_size)
   // it and the item size was 645 for example, we might pack 2 items back to back in storage
   // using DLS_MAX_CHUNK_SIZE_BYTES (100) byte chunks and dls_private_send_session() wouldn't be
   // able to get a complete single item because we wrote 1290 bytes using DLS_MAX_CHUNK_SIZE_BYTES
-  // byte chunks and there is no chunk boundary at the 645 byte offset.
+  // byte chunks and there is no chunk boundary at the 645 byte offset. The new file has a chunk
+  // boundary at every item boundary, but the buffer still has to hold the largest chunk of the
+  // old one.
   int32_t max_chunk_size = DLS_ENDPOINT_MAX_PAYLOAD;
   while (true) {
     tmp_buf = kernel_malloc(max_chunk_size);
     if (tmp_buf) {
       break;
     }
-    if (max_chunk_size < 256) {
+    if (max_chunk_size / 2 < (int32_t)prv_max_chunk_size(&session->storage)) {
       PBL_LOG_ERR("Not enough memory for reallocation");
       goto exit;
     }
@@ -502,7 +622,7 @@ static bool prv_realloc_storage(DataLoggingSession *session, uint32_t new_size)
     }
 
     // Write to new file
-    if (!prv_write_data(&new_storage, tmp_buf, bytes_read)) {
+    if (!prv_write_data(&new_storage, session->item_size, tmp_buf, bytes_read)) {
       goto exit;
     }
 
@@ -557,7 +677,7 @@ void dls_storage_delete_logging_storage(DataLoggingSession *session) {
   PBL_ASSERTN(session->storage.fd == DLS_INVALID_FILE);
 
   char name[DLS_FILE_NAME_MAX_LEN];
-  prv_get_filename(name, session);
+  prv_get_filename(name, session, session->storage.version);
   status_t status = pfs_remove(name);
   if (status != S_SUCCESS) {
     PBL_LOG_ERR("Error %d removing file", (int) status);
@@ -582,7 +702,7 @@ bool dls_storage_write_data(DataLoggingSession *session, const void *data, uint3
     goto exit;
   }
 
-  success = prv_write_data(&session->storage, data, num_bytes);
+  success = prv_write_data(&session->storage, session->item_size, data, num_bytes);
 
 exit:
   if (got_session_file) {
@@ -641,7 +761,7 @@ bool dls_storage_write_session(DataLoggingSession *session) {
                                           &session->data->buffer_client,
                                           bytes_remaining, &read_ptr, &bytes_read);
     PBL_ASSERTN(success);
-    success = prv_write_data(&session->storage, read_ptr, bytes_read);
+    success = prv_write_data(&session->storage, session->item_size, read_ptr, bytes_read);
     if (!success) {
       goto exit;
     }
@@ -666,9 +786,10 @@ exit:
 // -----------------------------------------------------------------------------------------
 // Special case: if buffer is NULL, just doesn't perform any reads, it just returns the # of bytes
 // of data available for reading. Returns -1 on error.
+// The first skip_bytes of unread data are skipped, they must end on a chunk boundary.
 // On exit, *new_read_offset contains the new read_offset
-int32_t dls_storage_read(DataLoggingSession *logging_session, uint8_t *buffer, int32_t num_bytes,
-                         uint32_t *new_read_offset) {
+static int32_t prv_read(DataLoggingSession *logging_session, uint32_t skip_bytes,
+                        uint8_t *buffer, int32_t num_bytes, uint32_t *new_read_offset) {
   prv_assert_valid_task();
 
   int32_t read_bytes = 0;
@@ -687,9 +808,10 @@ int32_t dls_storage_read(DataLoggingSession *logging_session, uint8_t *buffer, i
   }
 
   uint32_t read_offset = logging_session->storage.read_offset;
+  const size_t chunk_header_size = prv_chunk_header_size(&logging_session->storage);
 
   while (!buffer || read_bytes < num_bytes) {
-    DLSChunkHeader chunk_hdr;
+    DLSChunk chunk;
 
     // Reached the end of the file?
     // NOTE: we don't do this check if we are scanning for the last written byte (buffer == NULL)
@@ -704,37 +826,48 @@ int32_t dls_storage_read(DataLoggingSession *logging_session, uint8_t *buffer, i
       last_whole_items_read_bytes = -1;
       goto exit;
     }
-    if (!prv_pfs_read(logging_session->storage.fd, &chunk_hdr, sizeof(chunk_hdr))) {
+    if (!prv_read_chunk_header(&logging_session->storage, &chunk)) {
       last_whole_items_read_bytes = -1;
       goto exit;
     }
 
     // Reached the end of the valid data?
-    if (chunk_hdr.valid && chunk_hdr.num_bytes == DLS_CHUNK_HDR_NUM_BYTES_UNINITIALIZED) {
+    if (chunk.is_end) {
       break;
     }
 
+    // Data we were asked to skip?
+    if (chunk.valid && skip_bytes > 0) {
+      if (chunk.num_bytes > skip_bytes) {
+        PBL_LOG_WRN("Read/skip out of sync");
+        break;
+      }
+      skip_bytes -= chunk.num_bytes;
+      read_offset += chunk_header_size + chunk.num_bytes;
+      continue;
+    }
+
     // Valid data?
-    if (chunk_hdr.valid) {
+    if (chunk.valid) {
       if (buffer) {
-        if (chunk_hdr.num_bytes + read_bytes > num_bytes) {
+        if (chunk.num_bytes + read_bytes > num_bytes) {
           // Not enough room in buffer to read next chunk.
           break;
         }
 
-        if (!prv_pfs_read(logging_session->storage.fd, buffer, chunk_hdr.num_bytes)) {
+        if (!prv_pfs_read(logging_session->storage.fd, buffer, chunk.num_bytes)) {
           last_whole_items_read_bytes = -1;
           goto exit;
         }
-        read_bytes += chunk_hdr.num_bytes;
-        buffer += chunk_hdr.num_bytes;
+        read_bytes += chunk.num_bytes;
+        buffer += chunk.num_bytes;
 
       } else {
         // Just scanning for the last written byte
-        read_bytes += chunk_hdr.num_bytes;
+        read_bytes += chunk.num_bytes;
       }
     }
-    read_offset += sizeof(chunk_hdr) + chunk_hdr.num_bytes;
+    read_offset += chunk_header_size + chunk.num_bytes;
 
     // Did we reach a whole item boundary? If so, update our "last_whole_item" bookkeeping now
     if ((read_bytes % logging_session->item_size) == 0) {
@@ -757,6 +890,21 @@ exit:
 }
 
 
+// -----------------------------------------------------------------------------------------
+int32_t dls_storage_read(DataLoggingSession *logging_session, uint8_t *buffer, int32_t num_bytes,
+                         uint32_t *new_read_offset) {
+  return prv_read(logging_session, 0 /* skip_bytes */, buffer, num_bytes, new_read_offset);
+}
+
+
+// -----------------------------------------------------------------------------------------
+int32_t dls_storage_read_after(DataLoggingSession *logging_session, uint32_t skip_bytes,
+                               uint8_t *buffer, int32_t num_bytes) {
+  uint32_t new_read_offset;
+  return prv_read(logging_session, skip_bytes, buffer, num_bytes, &new_read_offset);
+}
+
+
 // -----------------------------------------------------------------------------------------
 // Consume num_bytes of data. As a special case, if num_bytes is 0, this simply advances the
 // internal storage.read_offset to match the # of bytes already consumed without consuming any more.
@@ -781,7 +929,7 @@ int32_t dls_storage_consume(DataLoggingSession *logging_session, int32_t num_byt
 
   bool reset_read_offset = (num_bytes == 0);
   while (reset_read_offset || consumed_bytes < num_bytes) {
-    DLSChunkHeader chunk_hdr;
+    DLSChunk chunk;
 
     // Reached the end of the file?
     if (logging_session->storage.read_offset >= logging_session->storage.write_offset) {
@@ -793,47 +941,48 @@ int32_t dls_storage_consume(DataLoggingSession *logging_session, int32_t num_byt
       consumed_bytes = -1;    // error
       goto exit;
     }
-    if (!prv_pfs_read(logging_session->storage.fd, &chunk_hdr, sizeof(chunk_hdr))) {
+    if (!prv_read_chunk_header(&logging_session->storage, &chunk)) {
       consumed_bytes = -1;    // error
       goto exit;
     }
 
-    if (chunk_hdr.valid && chunk_hdr.num_bytes == DLS_CHUNK_HDR_NUM_BYTES_UNINITIALIZED) {
+    if (chunk.is_end) {
       // End of valid data
       break;
     }
 
-    if (chunk_hdr.valid) {
+    if (chunk.valid) {
       if (reset_read_offset) {
         // If we are only resetting the read offset, break out now.
         break;
       }
-      if (chunk_hdr.num_bytes > num_bytes) {
+      if (chunk.num_bytes > num_bytes) {
         // Somehow the caller tried to consume less than they read?
         PBL_LOG_WRN("Read/consume out of sync");
         goto exit;
       }
       // Invalidate the chunk, now that we have consumed it
-      chunk_hdr.valid = false;
       if (!prv_pfs_seek(logging_session->storage.fd, logging_session->storage.read_offset,
                         FSeekSet)) {
         consumed_bytes = -1;    // error
         goto exit;
       }
-      if (!prv_pfs_write(logging_session->storage.fd, &chunk_hdr, sizeof(chunk_hdr))) {
+      if (!prv_write_chunk_header(&logging_session->storage, chunk.num_bytes,
+                                  false /* valid */)) {
         consumed_bytes = -1;    // error
         goto exit;
       }
-      if (logging_session->storage.num_bytes < chunk_hdr.num_bytes) {
+      if (logging_session->storage.num_bytes < chunk.num_bytes) {
         PBL_LOG_ERR("Inconsistent tracking of num_bytes");
         consumed_bytes = -1;    // error
         goto exit;
       }
-      logging_session->storage.num_bytes -= chunk_hdr.num_bytes;
+      logging_session->storage.num_bytes -= chunk.num_bytes;
     }
 
-    logging_session->storage.read_offset += sizeof(DLSChunkHeader) + chunk_hdr.num_bytes;
-    consumed_bytes += chunk_hdr.num_bytes;
+    logging_session->storage.read_offset += prv_chunk_header_size(&logging_session->storage)
+                                            + chunk.num_bytes;
+    consumed_bytes += chunk.num_bytes;
   }
 
 exit:
@@ -854,6 +1003,87 @@ exit:
 }
 
 
+// -----------------------------------------------------------------------------------------
+// Returns true if a restored session or one of the files in dir_list uses the session id
+static bool prv_is_session_id_taken(uint8_t session_id, PFSFileListEntry *dir_list) {
+  if (dls_list_find_by_session_id(session_id)) {
+    return true;
+  }
+  char v0_name[DLS_FILE_NAME_MAX_LEN];
+  char v1_name[DLS_FILE_NAME_MAX_LEN];
+  prv_get_filename_for_id(v0_name, session_id, DLS_VERSION_0);
+  prv_get_filename_for_id(v1_name, session_id, DLS_VERSION_1);
+  for (PFSFileListEntry *entry = dir_list; entry;
+       entry = (PFSFileListEntry *)entry->list_node.next) {
+    if (!strncmp(entry->name, v0_name, DLS_FILE_NAME_MAX_LEN) ||
+        !strncmp(entry->name, v1_name, DLS_FILE_NAME_MAX_LEN)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+// -----------------------------------------------------------------------------------------
+// Firmware from before DLS_VERSION_1 doesn't see DLS_V1_FILE_NAME_PREFIX files, so after running
+// it and upgrading again, one of its files can have the same session id as one of ours. This
+// copies the session's file to one named after an unused session id and removes the old one.
+static bool prv_move_to_unused_session_id(DataLoggingSession *session, const char *name,
+                                          PFSFileListEntry *dir_list) {
+  // New session ids are picked from the same range, see dls_list_add_new_session()
+  uint8_t session_id = 0;
+  while (prv_is_session_id_taken(session_id, dir_list)) {
+    if (++session_id == 255) {
+      return false;
+    }
+  }
+
+  int old_fd = pfs_open(name, OP_FLAG_READ, FILE_TYPE_STATIC, 0);
+  if (old_fd < S_SUCCESS) {
+    return false;
+  }
+  const size_t size = prv_pfs_get_file_size(old_fd);
+  char new_name[DLS_FILE_NAME_MAX_LEN];
+  prv_get_filename_for_id(new_name, session_id, session->storage.version);
+  int new_fd = pfs_open(new_name, OP_FLAG_WRITE | OP_FLAG_READ, FILE_TYPE_STATIC, size);
+  uint8_t *buf = kernel_malloc(DLS_ENDPOINT_MAX_PAYLOAD);
+
+  // The header goes first with the new id, flash can't be written twice. The rest is copied as
+  // is, so the offsets already restored stay valid.
+  DLSFileHeader hdr;
+  bool success = (new_fd >= S_SUCCESS) && buf && (size >= sizeof(hdr)) &&
+                 prv_pfs_read(old_fd, &hdr, sizeof(hdr));
+  if (success) {
+    hdr.comm_session_id = session_id;
+    success = prv_pfs_write(new_fd, &hdr, sizeof(hdr));
+  }
+  for (size_t offset = sizeof(hdr); success && (offset < size);
+       offset += DLS_ENDPOINT_MAX_PAYLOAD) {
+    const size_t length = MIN(DLS_ENDPOINT_MAX_PAYLOAD, size - offset);
+    success = prv_pfs_read(old_fd, buf, length) && prv_pfs_write(new_fd, buf, length);
+  }
+
+  kernel_free(buf);
+  pfs_close(old_fd);
+  if (new_fd >= S_SUCCESS) {
+    if (success) {
+      pfs_close(new_fd);
+    } else {
+      pfs_close_and_remove(new_fd);
+    }
+  }
+  if (!success) {
+    return false;
+  }
+
+  PBL_LOG_WRN("Moved session %"PRIu8" to unused id %"PRIu8, session->comm.session_id,
+              session_id);
+  pfs_remove(name);
+  session->comm.session_id = session_id;
+  return true;
+}
+
+
 // -----------------------------------------------------------------------------------------
 // Called from dls_init() during boot time to scan for existing DLS storage files in the file
 // system and recreate sessions from them.
@@ -889,6 +1119,11 @@ void dls_storage_rebuild(void) {
     }
     pfs_close(fd);
 
+    if (hdr.version != DLS_VERSION_0 && hdr.version != DLS_VERSION_1) {
+      PBL_LOG_ERR("Unknown version 0x%x of file %s", hdr.version, head->name);
+      goto bad_session;
+    }
+
     // Create a new session based on the file info
     session = dls_list_create_session(hdr.tag, hdr.item_type, hdr.item_size, &hdr.app_uuid,
                                       hdr.timestamp, DataLoggingStatusInactive);
@@ -899,11 +1134,12 @@ void dls_storage_rebuild(void) {
     session->storage = (DataLoggingSessionStorage) {
       .fd = DLS_INVALID_FILE,
       .write_offset = sizeof(hdr),
-      .read_offset = sizeof(hdr)
+      .read_offset = sizeof(hdr),
+      .version = hdr.version,
     };
 
     // Make sure the filename is what we expect
-    prv_get_filename(name, session);
+    prv_get_filename(name, session, hdr.version);
     if (strncmp(name, head->name, DLS_FILE_NAME_MAX_LEN)) {
       PBL_LOG_ERR("Expected name of %s, got %s", head->name, name);
       pfs_remove(head->name);
@@ -931,6 +1167,15 @@ void dls_storage_rebuild(void) {
             session->comm.session_id, session->storage.num_bytes,
             session->storage.read_offset, session->storage.write_offset);
 
+    // Make sure no other session uses the id. The files still to be restored don't count, their
+    // sessions get moved instead when they come up.
+    if (dls_list_find_by_session_id(session->comm.session_id) &&
+        !prv_move_to_unused_session_id(session, head->name,
+                                       (PFSFileListEntry *)head->list_node.next)) {
+      PBL_LOG_ERR("No unused id for duplicate session %"PRIu8, session->comm.session_id);
+      goto bad_session;
+    }
+
     // Insert this session into our list
     dls_list_insert_session(session);
     head = (PFSFileListEntry *)head->list_node.next;
@@ -7,12 +7,14 @@
 #include "pbl/os/tick.h"
 #include "pbl/os/mutex.h"
 #include "kernel/pbl_malloc.h"
+#include "pbl/services/analytics/analytics.h"
 #include "pbl/services/new_timer/new_timer.h"
 #include "system/passert.h"
 #include "syscall/syscall.h"
 #include "syscall/syscall_internal.h"
 #include "system/logging.h"
 #include "process_management/app_manager.h"
+#include "pbl/util/object_pool.h"
 
 PBL_LOG_MODULE_DEFINE(service_evented_timer, CONFIG_SERVICE_EVENTED_TIMER_LOG_LEVEL);
 
@@ -35,6 +37,13 @@ typedef struct EventedTimer {
 //! The list of all the timers that have been created.
 static ListNode* s_timer_list_head;
 
+//! Number of EventedTimers to allocate from the kernel heap at a time
+#define EVENTED_TIMER_POOL_SLAB_SIZE (8)
+
+//! Timers are created and destroyed all the time, so they come out of a pool rather than being
+//! allocated one by one on the kernel heap.
+static ObjectPool s_timer_pool;
+
 static PebbleMutex * s_mutex;
 
 // ------------------------------------------------------------------------------------
@@ -101,9 +110,10 @@ DEFINE_SYSCALL(void, sys_evented_timer_consume, TimerID timer_id, EventedTimerCa
     mutex_unlock(s_mutex);
   } else {
     list_remove(&timer->list_node, &s_timer_list_head, NULL);
+    const TimerID sys_timer_id = timer->sys_timer_id;
+    object_pool_free(&s_timer_pool, timer);
     mutex_unlock(s_mutex);
-    new_timer_delete(timer->sys_timer_id);
-    kernel_free(timer);
+    new_timer_delete(sys_timer_id);
   }
 }
 
@@ -180,8 +190,15 @@ static void prv_sys_timer_callback(void* cb_data) {
 // ========================================================================================================
 // External API
 
+static void prv_timer_pool_init(void) {
+  object_pool_init(&s_timer_pool, "evented_timer", sizeof(EventedTimer),
+                   EVENTED_TIMER_POOL_SLAB_SIZE, kernel_malloc_check_with_pc, kernel_free,
+                   PBL_ANALYTICS_KEY(memory_pool_evented_timers_max));
+}
+
 void evented_timer_init(void) {
   s_mutex = mutex_create();
+  prv_timer_pool_init();
 }
 
 void evented_timer_clear_process_timers(PebbleTask task) {
@@ -198,7 +215,7 @@ void evented_timer_clear_process_timers(PebbleTask task) {
       list_remove(iter, &s_timer_list_head, NULL);
       // The delete operation will stop it for us
       new_timer_delete(timer->sys_timer_id);
-      kernel_free(timer);
+      object_pool_free(&s_timer_pool, timer);
     }
 
     iter = next;
@@ -231,7 +248,7 @@ EventedTimerID evented_timer_register(uint32_t timeout_ms,
 
   mutex_lock(s_mutex);
 
-  EventedTimer* new_timer = kernel_malloc_check(sizeof(EventedTimer));
+  EventedTimer* new_timer = object_pool_alloc(&s_timer_pool);
 
   *new_timer = (EventedTimer) {
     .list_node = { 0 },
@@ -318,7 +335,7 @@ void evented_timer_cancel(EventedTimerID timer_id) {
 
   new_timer_delete(timer->sys_timer_id);    // This automatically stops the timer for us first
   list_remove(&timer->list_node, &s_timer_list_head, NULL);
-  kernel_free(timer);
+  object_pool_free(&s_timer_pool, timer);
 
   mutex_unlock(s_mutex);
 }
@@ -335,6 +352,7 @@ bool evented_timer_is_current_task(EventedTimerID timer_id){
 
 void evented_timer_reset(void) {
   s_timer_list_head = 0;
+  prv_timer_pool_init();
 }
 
 void *evented_timer_get_data(EventedTimerID timer_id) {
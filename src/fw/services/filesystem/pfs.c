@@ -21,10 +21,12 @@
 #include "pbl/os/mutex.h"
 #include "pbl/services/analytics/analytics.h"
 #include "pbl/services/filesystem/flash_translation.h"
+#include "pbl/services/system_task.h"
 #include "system/hexdump.h"
 #include "system/logging.h"
 #include "system/passert.h"
 #include "pbl/util/attributes.h"
+#include "pbl/util/hash.h"
 #include "util/crc8.h"
 #include "util/legacy_checksum.h"
 #include "pbl/util/math.h"
@@ -39,6 +41,15 @@ static PebbleRecursiveMutex *s_pfs_mutex = NULL;
 #define PFS_PAGES_PER_ERASE_SECTOR (SECTOR_SIZE_BYTES / PFS_PAGE_SIZE)
 #define GC_REGION_SIZE             SECTOR_SIZE_BYTES
 
+// Background garbage collection tries to keep at least this many erase sectors'
+// worth of pre-erased pages around so that file creation never has to garbage
+// collect inline
+#define GC_FREE_SECTOR_WATERMARK   4
+
+// Background garbage collection avoids sectors which have been erased this
+// many more times than the least worn sector on the filesystem
+#define GC_WEAR_LEVELING_SLACK     2
+
 // The filesystem is broken into discrete blocks called 'pages'. Each page has
 // a header that describes the contents contained within it. Static fields are
 // CRC protected and are verified each time a file is opened. Convenience
@@ -135,10 +146,12 @@ typedef struct {
 
 #define GCDATA_VALID(flags) ((~(flags) & GC_DATA_VALID) != 0)
 
+//! A run of physically contiguous pages within a file. The page cache of an open file holds one
+//! entry per run, sorted by virtual page, and covers every page of the file.
 typedef struct {
   uint16_t virtual_pg;
   uint16_t physical_pg;
-  uint16_t contiguous_pgs;
+  uint16_t contiguous_pgs; //!< number of pages following physical_pg in the run
 } FilePageCache;
 
 typedef struct File {
@@ -156,7 +169,8 @@ typedef struct File {
   uint32_t      offset; // the current offset within the file
   uint16_t      curr_page; // the current page the offset is on
   FilePageCache *pg_cache;
-  uint8_t       pg_cache_len;
+  uint16_t      pg_cache_len;
+  bool          pg_cache_failed; //!< building the cache ran out of memory since the file was opened
 } File;
 
 // The backing information tracked using the handle returned to callers
@@ -225,6 +239,28 @@ static uint16_t s_pfs_page_count = 0;
 static uint32_t s_pfs_size = 0;
 static ListNode *s_head_callback_node_list = NULL;
 
+// The name index tracks the start page of every file on the filesystem, sorted by a hash of the
+// file name. This lets locate_flash_file() go straight to the few start pages whose name hash
+// matches rather than reading the name of every file on flash. If we ever fail to grow the index
+// it is marked invalid and lookups fall back to scanning all pages until it is rebuilt.
+typedef struct {
+  uint16_t name_hash;
+  uint16_t page;
+} NameIndexEntry;
+
+#define NAME_INDEX_GROW_ENTRIES 32
+
+static NameIndexEntry *s_pfs_name_index = NULL;
+static uint16_t s_pfs_name_index_len = 0;
+static uint16_t s_pfs_name_index_capacity = 0;
+static bool s_pfs_name_index_valid = false;
+
+#if UNITTEST
+// The index lives on the kernel heap for as long as the filesystem is mounted, which upsets the
+// allocation tracking of tests that only use PFS as backing storage, so tests must opt in.
+static bool s_test_name_index_enabled = false;
+#endif
+
 // In the interest of being able to leverage sector erases / minimize seek time
 // for large files, deploying a variable length page size may be beneficial.
 // Therefore, isolating the page offset related calculations to one location.
@@ -271,12 +307,15 @@ static void prv_flash_write(const void *buffer, uint32_t size, uint32_t offset)
   }
 }
 
+static void prv_name_index_remove_page_range(uint16_t start, uint16_t end);
+
 // Erases all pages for the sector which begins at 'start_page'
 static void prv_flash_erase_sector(uint16_t start_page) {
   uint32_t offset = PFS_PAGE_SIZE * start_page;
   if (offset < s_pfs_size) {
     ftl_erase_sector(PFS_PAGE_SIZE * PFS_PAGES_PER_ERASE_SECTOR, offset);
     prv_invalidate_page_flags_cache(offset, PFS_PAGE_SIZE * PFS_PAGES_PER_ERASE_SECTOR);
+    prv_name_index_remove_page_range(start_page, start_page + PFS_PAGES_PER_ERASE_SECTOR);
   } else {
     PBL_LOG_ERR("Erase out of bounds, 0x%x", (int)start_page);
   }
@@ -342,6 +381,113 @@ static void prv_build_page_flags_cache(void) {
   prv_invalidate_page_flags_cache_all();
 }
 
+static uint16_t prv_name_hash(const char *name, uint8_t namelen) {
+  const uint32_t name_hash = hash((const uint8_t *)name, namelen);
+  return (uint16_t)(name_hash ^ (name_hash >> 16));
+}
+
+//! @return the index of the first entry whose hash is >= name_hash
+static uint16_t prv_name_index_lower_bound(uint16_t name_hash) {
+  uint16_t lo = 0;
+  uint16_t hi = s_pfs_name_index_len;
+  while (lo < hi) {
+    const uint16_t mid = lo + ((hi - lo) / 2);
+    if (s_pfs_name_index[mid].name_hash < name_hash) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static void prv_name_index_invalidate(void) {
+  kernel_free(s_pfs_name_index);
+  s_pfs_name_index = NULL;
+  s_pfs_name_index_len = 0;
+  s_pfs_name_index_capacity = 0;
+  s_pfs_name_index_valid = false;
+}
+
+static void prv_name_index_clear(void) {
+#if UNITTEST
+  if (!s_test_name_index_enabled) {
+    return;
+  }
+#endif
+  s_pfs_name_index_len = 0;
+  s_pfs_name_index_valid = true;
+}
+
+static void prv_name_index_add(uint16_t name_hash, uint16_t page) {
+  if (!s_pfs_name_index_valid) {
+    return;
+  }
+
+  if (s_pfs_name_index_len == s_pfs_name_index_capacity) {
+    const uint16_t new_capacity = s_pfs_name_index_capacity + NAME_INDEX_GROW_ENTRIES;
+    NameIndexEntry *new_index =
+        kernel_realloc(s_pfs_name_index, new_capacity * sizeof(NameIndexEntry));
+    if (!new_index) {
+      PBL_LOG_WRN("Out of memory growing name index, falling back to scanning");
+      prv_name_index_invalidate();
+      return;
+    }
+    s_pfs_name_index = new_index;
+    s_pfs_name_index_capacity = new_capacity;
+  }
+
+  const uint16_t pos = prv_name_index_lower_bound(name_hash);
+  memmove(&s_pfs_name_index[pos + 1], &s_pfs_name_index[pos],
+          (s_pfs_name_index_len - pos) * sizeof(NameIndexEntry));
+  s_pfs_name_index[pos] = (NameIndexEntry) {
+    .name_hash = name_hash,
+    .page = page,
+  };
+  s_pfs_name_index_len++;
+}
+
+//! Removes any entries whose start page lies within [start, end)
+static void prv_name_index_remove_page_range(uint16_t start, uint16_t end) {
+  uint16_t kept = 0;
+  for (uint16_t i = 0; i < s_pfs_name_index_len; i++) {
+    const uint16_t page = s_pfs_name_index[i].page;
+    if ((page < start) || (page >= end)) {
+      s_pfs_name_index[kept++] = s_pfs_name_index[i];
+    }
+  }
+  s_pfs_name_index_len = kept;
+}
+
+//! Reads the name stored on a start page and adds the page to the name index
+static void prv_name_index_add_from_flash(uint16_t pg) {
+  uint8_t namelen;
+  prv_flash_read(&namelen, sizeof(namelen), prv_page_to_flash_offset(pg) + FILEHEADER_OFFSET +
+                 offsetof(FileHeader, file_namelen));
+  if (namelen == 0) {
+    return; // corrupt header, locate_flash_file() could never match it anyway
+  }
+
+  char file_name[namelen];
+  prv_flash_read((uint8_t *)file_name, namelen, prv_page_to_flash_offset(pg) + FILE_NAME_OFFSET);
+  prv_name_index_add(prv_name_hash(file_name, namelen), pg);
+}
+
+//! Adds all start pages within [start, end) to the name index
+static void prv_name_index_add_page_range(uint16_t start, uint16_t end) {
+  for (uint16_t pg = start; (pg < end) && s_pfs_name_index_valid; pg++) {
+    if (IS_PAGE_TYPE(prv_get_page_flags(pg), PAGE_FLAG_START_PAGE)) {
+      prv_name_index_add_from_flash(pg);
+    }
+  }
+}
+
+static void prv_build_name_index(void) {
+  prv_name_index_invalidate();
+  prv_name_index_clear();
+  prv_name_index_add_page_range(0, s_pfs_page_count);
+}
+
 static void update_curr_state(uint16_t start_page, uint32_t offset,
     uint16_t state) {
   offset += prv_page_to_flash_offset(start_page) + METADATA_OFFSET;
@@ -453,42 +599,64 @@ static status_t write_pg_header(PageHeader *hdr, uint16_t pg) {
   return (S_SUCCESS);
 }
 
-// note: the goal here is to do as few flash reads as possible
-// while scanning the flash to find a given file.
-static status_t locate_flash_file(const char *name, uint16_t *page) {
-  const int file_namelen_offset = FILEHEADER_OFFSET +
-      offsetof(FileHeader, file_namelen);
-  uint8_t namelen = strlen(name);
+//! Checks whether the file starting at 'pg' is a non-tmp file called 'name'
+static bool prv_start_page_matches_name(uint16_t pg, const char *name, uint8_t namelen) {
+  const int file_namelen_offset = FILEHEADER_OFFSET + offsetof(FileHeader, file_namelen);
 
-  for (uint16_t pg = 0; pg < s_pfs_page_count; pg++) {
-    PageHeader pg_hdr;
-    FileHeader file_hdr;
-    pg_hdr.page_flags = prv_get_page_flags(pg);
+  PageHeader pg_hdr;
+  FileHeader file_hdr;
+  pg_hdr.page_flags = prv_get_page_flags(pg);
 
-    if (!IS_PAGE_TYPE(pg_hdr.page_flags, PAGE_FLAG_START_PAGE)) {
-      continue; // only start pages contain file name info
-    }
+  if (!IS_PAGE_TYPE(pg_hdr.page_flags, PAGE_FLAG_START_PAGE)) {
+    return (false); // only start pages contain file name info
+  }
 
-    prv_flash_read((uint8_t *)&file_hdr.file_namelen, sizeof(file_hdr.file_namelen),
-        prv_page_to_flash_offset(pg) + file_namelen_offset);
+  prv_flash_read((uint8_t *)&file_hdr.file_namelen, sizeof(file_hdr.file_namelen),
+      prv_page_to_flash_offset(pg) + file_namelen_offset);
+
+  if (file_hdr.file_namelen != namelen) {
+    return (false);
+  }
 
-    if (file_hdr.file_namelen == namelen) {
-      char file_name[namelen];
+  char file_name[namelen];
+  prv_flash_read((uint8_t *)file_name, namelen, prv_page_to_flash_offset(pg) +
+      FILE_NAME_OFFSET);
+
+  if ((memcmp(name, file_name, namelen) != 0) || is_tmp_file(pg)) {
+    return (false);
+  }
 
-      prv_flash_read((uint8_t *)file_name, namelen, prv_page_to_flash_offset(pg) +
-          FILE_NAME_OFFSET);
+  if (read_header(pg, &pg_hdr, &file_hdr) == HdrCrcCorrupt) {
+    PBL_LOG_WRN("%d: CRC corrupt", pg);
+    return (false);
+  }
 
-      if ((memcmp(name, file_name, namelen) == 0) && (!is_tmp_file(pg))) {
+  return (true);
+}
 
-        if (read_header(pg, &pg_hdr, &file_hdr) == HdrCrcCorrupt) {
-          PBL_LOG_WRN("%d: CRC corrupt", pg);
-          continue;
-        }
+// note: the goal here is to do as few flash reads as possible
+// while scanning the flash to find a given file.
+static status_t locate_flash_file(const char *name, uint16_t *page) {
+  uint8_t namelen = strlen(name);
 
-        *page = pg;
+  if (s_pfs_name_index_valid) {
+    // only the start pages whose name hash matches need to be looked at
+    const uint16_t name_hash = prv_name_hash(name, namelen);
+    for (uint16_t i = prv_name_index_lower_bound(name_hash);
+         (i < s_pfs_name_index_len) && (s_pfs_name_index[i].name_hash == name_hash); i++) {
+      if (prv_start_page_matches_name(s_pfs_name_index[i].page, name, namelen)) {
+        *page = s_pfs_name_index[i].page;
         return (S_SUCCESS);
       }
     }
+    return (E_DOES_NOT_EXIST);
+  }
+
+  for (uint16_t pg = 0; pg < s_pfs_page_count; pg++) {
+    if (prv_start_page_matches_name(pg, name, namelen)) {
+      *page = pg;
+      return (S_SUCCESS);
+    }
   }
 
   return (E_DOES_NOT_EXIST);
@@ -622,6 +790,7 @@ static int prv_find_free_erase_region(bool skip_gc_region) {
 
 static status_t garbage_collect_sector(uint16_t *free_page,
     uint16_t sector_start_page, uint32_t sectors_active);
+static void prv_schedule_background_gc(void);
 
 //! Updates the last written page to point to next_page
 static NOINLINE void prv_update_last_written_page(uint16_t next_page) {
@@ -712,6 +881,8 @@ static status_t find_free_page(uint16_t *free_page, bool use_gc_allocator,
     int num_erase_regions = s_pfs_page_count / PFS_PAGES_PER_ERASE_SECTOR;
     uint16_t start_region = start_pg / PFS_PAGES_PER_ERASE_SECTOR;
 
+    // prefer pages which have already been erased (i.e by background garbage
+    // collection) anywhere on the filesystem over collecting a sector inline
     for (uint16_t region = 0; region < num_erase_regions; region++) {
       uint16_t curr_region = (region + start_region) % num_erase_regions;
 
@@ -720,11 +891,27 @@ static status_t find_free_page(uint16_t *free_page, bool use_gc_allocator,
         continue;
       }
 
-      uint32_t sectors_active = prv_get_sector_page_status(curr_region, &next_page);
+      prv_get_sector_page_status(curr_region, &next_page);
       if (next_page != INVALID_PAGE) {
-        // we have found a page which is already erased
         break;
-      } else if (__builtin_popcount(sectors_active) < PFS_PAGES_PER_ERASE_SECTOR) {
+      }
+    }
+  }
+
+  if (next_page == INVALID_PAGE) {
+    int num_erase_regions = s_pfs_page_count / PFS_PAGES_PER_ERASE_SECTOR;
+    uint16_t start_region = start_pg / PFS_PAGES_PER_ERASE_SECTOR;
+
+    for (uint16_t region = 0; region < num_erase_regions; region++) {
+      uint16_t curr_region = (region + start_region) % num_erase_regions;
+
+      if (s_gc_block.block_valid && (gc_erase_region == curr_region)) {
+        // don't use pre-allocated garbage collection regions
+        continue;
+      }
+
+      uint32_t sectors_active = prv_get_sector_page_status(curr_region, &next_page);
+      if (__builtin_popcount(sectors_active) < PFS_PAGES_PER_ERASE_SECTOR) {
         // we can erase this region and have at least 1 free page after
         uint16_t sector_start_pg = curr_region * PFS_PAGES_PER_ERASE_SECTOR;
         garbage_collect_sector(&next_page, sector_start_pg, sectors_active);
@@ -836,6 +1023,8 @@ static status_t unlink_flash_file(uint16_t page) {
   // deletion we check for this during reboot to clean up a partial delete
   update_curr_state(first_page, DELETE_STATE_OFFSET, DELETE_STATE_DONE);
 
+  prv_name_index_remove_page_range(first_page, first_page + 1);
+
   return (rv);
 }
 
@@ -901,6 +1090,7 @@ static status_t create_flash_file(File *f) {
 
   prv_flash_write((uint8_t *)f->name, strlen(f->name),
       prv_page_to_flash_offset(start_page) + FILE_NAME_OFFSET);
+  prv_name_index_add(prv_name_hash(f->name, strlen(f->name)), start_page);
 
   if (!f->is_tmp) {
     update_curr_state(f->start_page, TMP_STATE_OFFSET, TMP_STATE_DONE);
@@ -912,6 +1102,52 @@ static status_t create_flash_file(File *f) {
   return (S_SUCCESS);
 }
 
+static void allocate_page_cache(File *f);
+
+//! Translates a page index within a file to its physical page using the file's page cache
+static status_t prv_page_cache_lookup(const File *f, uint16_t virtual_pg, uint16_t *page) {
+  // find the last run which begins at or before the page we are looking for
+  int lo = 0;
+  int hi = f->pg_cache_len - 1;
+  while (lo < hi) {
+    const int mid = (lo + hi + 1) / 2;
+    if (f->pg_cache[mid].virtual_pg <= virtual_pg) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+
+  const FilePageCache *pgc = &f->pg_cache[lo];
+  const uint16_t pgs_into_run = virtual_pg - pgc->virtual_pg;
+  if ((virtual_pg < pgc->virtual_pg) || (pgs_into_run > pgc->contiguous_pgs)) {
+    return (E_RANGE);
+  }
+
+  *page = pgc->physical_pg + pgs_into_run;
+  return (S_SUCCESS);
+}
+
+static bool prv_use_page_cache(File *f) {
+  if ((f->op_flags & OP_FLAG_USE_PAGE_CACHE) == 0) {
+    return (false);
+  }
+
+  // the cache is built the first time we need to find a page other than the current one
+  allocate_page_cache(f);
+  return (f->pg_cache != NULL);
+}
+
+//! Moves f->curr_page on to the page following it in the file
+static status_t prv_advance_to_next_page(File *f) {
+  if (prv_use_page_cache(f)) {
+    const uint16_t virtual_pg = (f->offset + f->start_offset) / free_bytes_in_page(f->curr_page);
+    return (prv_page_cache_lookup(f, virtual_pg, &f->curr_page));
+  }
+
+  return (get_next_page(f->curr_page, &f->curr_page));
+}
+
 static status_t scan_to_offset(File *f, uint32_t *pg_offset) {
   uint32_t data_offset = f->offset + f->start_offset;
 
@@ -921,37 +1157,11 @@ static status_t scan_to_offset(File *f, uint32_t *pg_offset) {
     uint16_t next_page = f->start_page;
     int pages_to_seek = (data_offset / free_bytes_in_page(f->start_page));
 
-    int closest_match = -1;
-    if (((f->op_flags & OP_FLAG_USE_PAGE_CACHE) != 0) && (f->pg_cache != NULL)) {
-
-      // Flash pages are singly linked together with the next pointer located
-      // on the current flash page. This means the optimal page to find in the
-      // cache is the one closest to what we are looking for without going past
-      // it
-      for (int i = 0; i < f->pg_cache_len; i++) {
-        FilePageCache *pgc = &f->pg_cache[i];
-        if (pgc->virtual_pg > pages_to_seek) {
-          continue;
-        } else if ((closest_match == -1) ||
-            (f->pg_cache[closest_match].virtual_pg < pgc->virtual_pg)) {
-          closest_match = i;
-        }
-      }
-    }
-
-    if (closest_match != -1) {
-      FilePageCache *close_pg = &f->pg_cache[closest_match];
-
-      pages_to_seek -= f->pg_cache[closest_match].virtual_pg;
-      next_page = f->pg_cache[closest_match].physical_pg;
-
-      // if we still are not on the page we are looking for, see how
-      // many contiguous pages we can skip ahead.
-      if (pages_to_seek > 0) {
-        uint16_t contig_pgs = MIN(close_pg->contiguous_pgs, pages_to_seek);
-        pages_to_seek -= contig_pgs;
-        next_page += contig_pgs;
+    if (prv_use_page_cache(f)) {
+      if (prv_page_cache_lookup(f, pages_to_seek, &next_page) != S_SUCCESS) {
+        return (E_RANGE);
       }
+      pages_to_seek = 0;
     }
 
     for (uint16_t i = 0; i < pages_to_seek; i++) {
@@ -1092,7 +1302,7 @@ int pfs_read(int fd, void *buf_ptr, size_t size) {
     }
 
     pg_offset = 0; // first usable byte next page
-    if (get_next_page(file->curr_page, &file->curr_page) != S_SUCCESS) {
+    if (prv_advance_to_next_page(file) != S_SUCCESS) {
       PBL_LOG_WRN("R:Couldn't find next page for %d",
           file->curr_page);
       res = E_INTERNAL;
@@ -1182,7 +1392,7 @@ int pfs_write(int fd, const void *buf_ptr, size_t size) {
     }
 
     pg_offset = 0; // first usable byte next page
-    if (get_next_page(file->curr_page, &file->curr_page) != S_SUCCESS) {
+    if (prv_advance_to_next_page(file) != S_SUCCESS) {
       PBL_LOG_WRN("W:Couldn't find next page for %d",
           file->curr_page);
       res = E_INTERNAL;
@@ -1206,8 +1416,9 @@ void pfs_set_size(uint32_t new_size, bool new_region_erased) {
   s_pfs_size = new_size;
   s_pfs_page_count = new_size / PFS_PAGE_SIZE;
 
-  // re-build the flags cache
+  // re-build the flags cache and name index
   prv_build_page_flags_cache();
+  prv_build_name_index();
 
   if (new_region_erased) {
     prv_write_erased_header_on_page_range((prev_size/PFS_PAGE_SIZE),
@@ -1619,59 +1830,27 @@ void pfs_remove_files(PFSFilenameTestCallback callback) {
   mutex_unlock_recursive(s_pfs_mutex);
 }
 
-#define MAX_PAGE_CACHE_ENTRIES    10 // 6 bytes per entry
-static void update_page_cache(FilePageCache *fpc, int *cur_idx,
-    FilePageCache *toadd) {
-
-  int optimal_idx = *cur_idx;
-  if ((*cur_idx) == MAX_PAGE_CACHE_ENTRIES) {
-    // default index to overwrite if nothing better is found
-    optimal_idx = MAX_PAGE_CACHE_ENTRIES - 1;
-
-    uint8_t contiguous_pgs = fpc[0].contiguous_pgs;
-
-    // find the entry with the smallest number of sequential pages as this
-    // will be the best page to remove from the cache
-    for (int i = 0; i < MAX_PAGE_CACHE_ENTRIES; i++) {
-      if (fpc[i].contiguous_pgs < contiguous_pgs) {
-        optimal_idx = i;
-        contiguous_pgs = fpc[i].contiguous_pgs;
-      }
-    }
-
-    // only kick the current cache entry if it's worse than the one
-    // we are adding
-    if (fpc[optimal_idx].contiguous_pgs > toadd->contiguous_pgs) {
-      return;
-    }
-  } else {
-    (*cur_idx)++; // we are adding a new entry
-  }
-
-  fpc[optimal_idx] = *toadd;
-}
-
-static NOINLINE void allocate_page_cache(int fd) {
-  File *f = &PFS_FD(fd).file;
+#define PAGE_CACHE_GROW_ENTRIES   8 // 6 bytes per entry
 
+//! Walks the page chain of a file once and records every run of contiguous pages so that later
+//! seeks never need to read page headers. The cache is sized to the actual fragmentation of the
+//! file; if we run out of memory the file simply falls back to following the page chain.
+static NOINLINE void allocate_page_cache(File *f) {
   if (f->pg_cache != NULL) {
     return;  // already cached
   }
 
+  if (f->pg_cache_failed) {
+    return;  // don't walk the whole page chain again on every page advance while we are OOM
+  }
+
   if ((f->file_size / free_bytes_in_page(f->start_page)) < 1) {
     return; // only one page in use so we don't need to cache anything
   }
 
-  // Note: If there was more space for statics or stack space we could
-  // put this temporary buffer there
-  FilePageCache *fpc =
-      kernel_malloc_check(sizeof(FilePageCache) * MAX_PAGE_CACHE_ENTRIES);
-  memset(fpc, 0x00, sizeof(FilePageCache) * MAX_PAGE_CACHE_ENTRIES);
-
-  uint16_t virtual_pg = 0;
-  uint16_t curr_page = f->start_page;
-  uint16_t next_page;
-  int cur_idx = 0;
+  FilePageCache *fpc = NULL;
+  uint16_t capacity = 0;
+  uint16_t num_entries = 0;
 
   FilePageCache curr = {
     .virtual_pg = 0,
@@ -1679,34 +1858,47 @@ static NOINLINE void allocate_page_cache(int fd) {
     .contiguous_pgs = 0
   };
 
-  while (get_next_page(curr_page, &next_page) == S_SUCCESS) {
-    if (next_page == (curr_page + 1)) {
+  uint16_t curr_page = f->start_page;
+  uint16_t next_page;
+  bool last_run = false;
+  while (!last_run) {
+    last_run = (get_next_page(curr_page, &next_page) != S_SUCCESS);
+    if (!last_run && (next_page == (curr_page + 1))) {
       curr.contiguous_pgs++;
-    } else {
-      update_page_cache(&fpc[0], &cur_idx, &curr);
+      curr_page = next_page;
+      continue;
+    }
 
-      // reset logic for next entry
-      curr.virtual_pg = virtual_pg + 1;
-      curr.physical_pg = next_page;
-      curr.contiguous_pgs = 0;
+    if (num_entries == capacity) {
+      capacity += PAGE_CACHE_GROW_ENTRIES;
+      FilePageCache *new_fpc = kernel_realloc(fpc, sizeof(FilePageCache) * capacity);
+      if (new_fpc == NULL) {
+        kernel_free(fpc);
+        f->pg_cache_failed = true;
+        return; // we are OOM, lookups will follow the page chain until the file is reopened
+      }
+      fpc = new_fpc;
     }
+    fpc[num_entries++] = curr;
 
+    // reset logic for next entry
+    curr.virtual_pg += curr.contiguous_pgs + 1;
+    curr.physical_pg = next_page;
+    curr.contiguous_pgs = 0;
     curr_page = next_page;
-    virtual_pg++;
   }
 
-  // see if the last set should be added to the cache
-  update_page_cache(&fpc[0], &cur_idx, &curr);
-
   // The cache is likely to be around for a while and there is no reason to
   // burn up more memory than necessary for a long duration
-  f->pg_cache = kernel_malloc(sizeof(FilePageCache) * cur_idx);
-  if (f->pg_cache != NULL) { // if we are not OOM
-    memcpy(f->pg_cache, fpc, sizeof(FilePageCache) * cur_idx);
-    f->pg_cache_len = cur_idx;
+  if (num_entries < capacity) {
+    FilePageCache *trimmed_fpc = kernel_realloc(fpc, sizeof(FilePageCache) * num_entries);
+    if (trimmed_fpc != NULL) {
+      fpc = trimmed_fpc;
+    }
   }
 
-  kernel_free(fpc);
+  f->pg_cache = fpc;
+  f->pg_cache_len = num_entries;
 }
 
 ///
@@ -1735,6 +1927,7 @@ static NOINLINE bool file_found_in_cache(const char *name, uint8_t op_flags, int
   file->op_flags = op_flags;
   file->offset = 0; // (re)set seek position
   file->is_tmp = is_tmp;
+  file->pg_cache_failed = false; // memory may have been freed up since the last attempt
 
   if (res == FDAlreadyLoaded) { // we found the FD in cache!
     file->curr_page = file->start_page;
@@ -1878,16 +2071,16 @@ int pfs_open(const char *name, uint8_t op_flags, uint8_t file_type,
 
 cleanup:
   if (res >= S_SUCCESS) {
-    // we are returning a valid file handle so if the user has asked for the
-    // page translations to be cached let's do that now
-    if ((op_flags & OP_FLAG_USE_PAGE_CACHE) != 0) {
-        allocate_page_cache(res);
-    }
     // check to see if we should update the gc block
     prv_update_gc_reserved_region();
   }
 
   mutex_unlock_recursive(s_pfs_mutex);
+
+  if ((res >= S_SUCCESS) && ((op_flags & (OP_FLAG_WRITE | OP_FLAG_OVERWRITE)) != 0)) {
+    // creating files is the only thing which uses up pre-erased pages
+    prv_schedule_background_gc();
+  }
   return (res);
 }
 
@@ -1991,6 +2184,10 @@ static void recover_region_from_file(int fd) {
 
   copy_or_recover_gc_data(fd, &gcdata, false);
 
+  // files keep their start pages across garbage collection, so re-index the restored sector
+  prv_name_index_add_page_range(gcdata.gc_start_page,
+                                gcdata.gc_start_page + PFS_PAGES_PER_ERASE_SECTOR);
+
 done:
   pfs_close_and_remove(fd);
 }
@@ -2063,6 +2260,153 @@ done:
   return (E_INTERNAL);
 }
 
+//! Counts the pre-erased pages outside of the region reserved for garbage collection
+static uint32_t prv_num_erased_pages(void) {
+  const uint16_t gc_erase_region = s_gc_block.gc_start_page / PFS_PAGES_PER_ERASE_SECTOR;
+  uint32_t num_erased = 0;
+  for (uint16_t pg = 0; pg < s_pfs_page_count; pg++) {
+    if (s_gc_block.block_valid && ((pg / PFS_PAGES_PER_ERASE_SECTOR) == gc_erase_region)) {
+      continue;
+    }
+    if (page_is_erased(prv_get_page_flags(pg))) {
+      num_erased++;
+    }
+  }
+  return num_erased;
+}
+
+static bool prv_below_gc_watermark(void) {
+  return (prv_num_erased_pages() < (GC_FREE_SECTOR_WATERMARK * PFS_PAGES_PER_ERASE_SECTOR));
+}
+
+static uint32_t prv_get_sector_erase_count(uint16_t region) {
+  uint32_t erase_count;
+  prv_flash_read((uint8_t *)&erase_count, sizeof(erase_count),
+      prv_page_to_flash_offset(region * PFS_PAGES_PER_ERASE_SECTOR) +
+      offsetof(PageHeader, erase_count));
+  return (erase_count == 0xffffffff) ? 0 : erase_count;
+}
+
+//! Picks the sector to garbage collect next. Sectors which have not been
+//! erased much more than the least worn sector are preferred, then the ones
+//! with the most pages that can be reclaimed, and ties go to the sector which
+//! has been erased the fewest times.
+//! @return the region to collect or -1 if there is nothing worth collecting
+static int prv_find_gc_victim_region(void) {
+  const int num_erase_regions = s_pfs_page_count / PFS_PAGES_PER_ERASE_SECTOR;
+  const uint16_t gc_erase_region = s_gc_block.gc_start_page / PFS_PAGES_PER_ERASE_SECTOR;
+
+  uint32_t min_erase_count = UINT32_MAX;
+  for (int region = 0; region < num_erase_regions; region++) {
+    min_erase_count = MIN(min_erase_count, prv_get_sector_erase_count(region));
+  }
+
+  int victim = -1;
+  bool victim_worn = true;
+  int victim_reclaimable = 0;
+  uint32_t victim_erase_count = 0;
+  for (int region = 0; region < num_erase_regions; region++) {
+    if (s_gc_block.block_valid && (region == gc_erase_region)) {
+      continue;
+    }
+
+    const uint16_t start_pg = region * PFS_PAGES_PER_ERASE_SECTOR;
+    int num_active = 0;
+    int num_erased = 0;
+    for (uint16_t pg = start_pg; pg < start_pg + PFS_PAGES_PER_ERASE_SECTOR; pg++) {
+      const uint8_t page_flags = prv_get_page_flags(pg);
+      if (page_is_erased(page_flags)) {
+        num_erased++;
+      } else if (!page_is_unallocated(page_flags)) {
+        num_active++;
+      }
+    }
+
+    // pages which are in use need the gc region to be copied out of the way
+    if ((num_active != 0) && !s_gc_block.block_valid) {
+      continue;
+    }
+
+    const int reclaimable = PFS_PAGES_PER_ERASE_SECTOR - num_active - num_erased;
+    if (reclaimable == 0) {
+      continue;
+    }
+
+    const uint32_t erase_count = prv_get_sector_erase_count(region);
+    const bool worn = (erase_count > (min_erase_count + GC_WEAR_LEVELING_SLACK));
+    if ((worn && !victim_worn) ||
+        ((worn == victim_worn) && (reclaimable < victim_reclaimable))) {
+      continue;
+    }
+
+    if ((victim == -1) || (worn != victim_worn) || (reclaimable > victim_reclaimable) ||
+        (erase_count < victim_erase_count)) {
+      victim = region;
+      victim_worn = worn;
+      victim_reclaimable = reclaimable;
+      victim_erase_count = erase_count;
+    }
+  }
+
+  return victim;
+}
+
+bool pfs_gc_incremental_step(void) {
+  mutex_lock_recursive(s_pfs_mutex);
+
+  bool more_work = false;
+  if (prv_below_gc_watermark()) {
+    const int region = prv_find_gc_victim_region();
+    if (region >= 0) {
+      uint16_t free_page;
+      const uint32_t sectors_active = prv_get_sector_page_status(region, &free_page);
+      garbage_collect_sector(&free_page, region * PFS_PAGES_PER_ERASE_SECTOR, sectors_active);
+      prv_update_gc_reserved_region();
+      more_work = prv_below_gc_watermark();
+    }
+  }
+
+  mutex_unlock_recursive(s_pfs_mutex);
+  return more_work;
+}
+
+#if CONFIG_SERVICE_FILESYSTEM_BACKGROUND_GC
+//! Protected by s_pfs_mutex, files get written from several tasks at once
+static bool s_background_gc_scheduled = false;
+
+static void prv_background_gc_system_task_cb(void *unused) {
+  mutex_lock_recursive(s_pfs_mutex);
+  s_background_gc_scheduled = false;
+  mutex_unlock_recursive(s_pfs_mutex);
+
+  if (pfs_gc_incremental_step()) {
+    // only collect one sector per callback so other system task work can run in between
+    prv_schedule_background_gc();
+  }
+}
+
+//! Note: must not be called with the pfs mutex held since the system task may
+//! be waiting on it while we wait for room in its queue
+static void prv_schedule_background_gc(void) {
+  // Claim the callback under the lock so only one task adds it
+  mutex_lock_recursive(s_pfs_mutex);
+  const bool already_scheduled = s_background_gc_scheduled;
+  s_background_gc_scheduled = true;
+  mutex_unlock_recursive(s_pfs_mutex);
+  if (already_scheduled) {
+    return;
+  }
+
+  if (!system_task_add_callback(prv_background_gc_system_task_cb, NULL)) {
+    mutex_lock_recursive(s_pfs_mutex);
+    s_background_gc_scheduled = false;
+    mutex_unlock_recursive(s_pfs_mutex);
+  }
+}
+#else
+static void prv_schedule_background_gc(void) {}
+#endif
+
 status_t pfs_init(bool run_filesystem_check) {
   if (s_pfs_mutex == NULL) {
     s_pfs_mutex = mutex_create_recursive();
@@ -2125,6 +2469,7 @@ void pfs_format(bool write_erase_headers) {
   // clear out all pages
   filesystem_regions_erase_all();
   prv_invalidate_page_flags_cache_all();
+  prv_name_index_clear();
 
   if (write_erase_headers) {
     prv_write_erased_header_on_page_range(0, s_pfs_page_count, 1);
@@ -2382,4 +2727,18 @@ void test_force_reboot_during_garbage_collection(uint16_t start_page) {
 void test_override_last_written_page(uint16_t start_page) {
   s_test_last_page_written_override = s_last_page_written;
 }
+
+void test_enable_name_index(bool enabled) {
+  s_test_name_index_enabled = enabled;
+}
+
+void test_get_erase_count_range(uint32_t *min_count, uint32_t *max_count) {
+  *min_count = UINT32_MAX;
+  *max_count = 0;
+  for (uint16_t region = 0; region < s_pfs_page_count / PFS_PAGES_PER_ERASE_SECTOR; region++) {
+    const uint32_t erase_count = prv_get_sector_erase_count(region);
+    *min_count = MIN(*min_count, erase_count);
+    *max_count = MAX(*max_count, erase_count);
+  }
+}
 #endif
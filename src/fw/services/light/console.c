@@ -57,6 +57,7 @@ static volatile bool s_als_flush_done;
 // to the panel, the same way the PULSE framebuffer domain does.
 static void prv_als_flush_cb(void *unused) {
   FrameBuffer *fb = compositor_get_framebuffer();
+  compositor_invalidate_framebuffer();
   framebuffer_dirty_all(fb);
   compositor_display_update(NULL);
   s_als_flush_done = true;
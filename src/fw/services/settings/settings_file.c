@@ -8,6 +8,7 @@
 #include "drivers/task_watchdog.h"
 #include "kernel/pbl_malloc.h"
 #include "pbl/services/filesystem/pfs.h"
+#include "pbl/util/math.h"
 #include "system/logging.h"
 #include "system/passert.h"
 #include "util/crc8.h"
@@ -22,6 +23,7 @@ static SettingsFileChangeCallback s_change_callback = NULL;
 
 static status_t bootup_check(SettingsFile *file);
 static void compute_stats(SettingsFile *file);
+static void prv_index_invalidate(SettingsFile *file);
 
 static bool file_hdr_is_uninitialized(SettingsFileHeader *file_hdr) {
   return (file_hdr->magic == 0xffffffff) && (file_hdr->version == 0xffff)
@@ -141,6 +143,10 @@ status_t settings_file_open_growable(SettingsFile *file, const char *name,
 }
 
 void settings_file_close(SettingsFile *file) {
+  if (file->in_transaction) {
+    settings_file_abort_transaction(file);
+  }
+  prv_index_invalidate(file);
   settings_raw_iter_deinit(&file->iter);
   kernel_free(file->name);
   file->name = NULL;
@@ -187,6 +193,14 @@ static bool overwritten(SettingsRecordHeader *hdr) {
   return flag_is_set(hdr, SETTINGS_FLAG_OVERWRITE_STARTED)
       && flag_is_set(hdr, SETTINGS_FLAG_OVERWRITE_COMPLETE);
 }
+// The first record of a batch written by settings_file_commit_transaction()
+// carries the commit marker for the whole batch. If we find one which isn't
+// committed, we rebooted while writing out the batch, and it and every record
+// after it have to be dropped.
+static bool txn_uncommitted(SettingsRecordHeader *hdr) {
+  return flag_is_set(hdr, SETTINGS_FLAG_TXN)
+      && !flag_is_set(hdr, SETTINGS_FLAG_TXN_COMMITTED);
+}
 
 static uint32_t utc_time() {
   return rtc_get_time();
@@ -197,12 +211,170 @@ static bool deleted_and_expired(SettingsRecordHeader *hdr) {
       && (hdr->last_modified <= (utc_time() - DELETED_LIFETIME));
 }
 
+#if CONFIG_SERVICE_SETTINGS_INDEX
+// Amount of slack to leave in the index when it has to be grown
+#define INDEX_GROW_ENTRIES 16
+
+// Record positions have to fit into SettingsFileIndexEntry.record_pos
+#define INDEX_MAX_RECORD_POS ((1 << 24) - 1)
+
+static uint32_t prv_index_sort_key(const SettingsFileIndexEntry *entry) {
+  return ((uint32_t)entry->key_hash << 24) | entry->record_pos;
+}
+
+static void prv_index_invalidate(SettingsFile *file) {
+  kernel_free(file->index);
+  file->index = NULL;
+  file->index_len = 0;
+  file->index_capacity = 0;
+}
+
+static bool prv_index_reserve(SettingsFile *file, int num_entries) {
+  if (num_entries <= file->index_capacity) {
+    return true;
+  }
+  const int new_capacity = num_entries + MAX(INDEX_GROW_ENTRIES, file->index_len / 2);
+  SettingsFileIndexEntry *new_index =
+      kernel_realloc(file->index, new_capacity * sizeof(*new_index));
+  if (!new_index) {
+    PBL_LOG_WRN("Not enough memory to index settings file %s", file->name);
+    prv_index_invalidate(file);
+    return false;
+  }
+  file->index = new_index;
+  file->index_capacity = new_capacity;
+  return true;
+}
+
+//! @return the index of the first entry which doesn't sort before the given key
+static int prv_index_lower_bound(SettingsFile *file, uint32_t sort_key) {
+  int low = 0;
+  int high = file->index_len;
+  while (low < high) {
+    const int mid = (low + high) / 2;
+    if (prv_index_sort_key(&file->index[mid]) < sort_key) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+static void prv_index_add(SettingsFile *file, uint8_t key_hash, int record_pos) {
+  if (!file->index) {
+    return;
+  }
+  if ((record_pos > INDEX_MAX_RECORD_POS) || !prv_index_reserve(file, file->index_len + 1)) {
+    prv_index_invalidate(file);
+    return;
+  }
+  const SettingsFileIndexEntry entry = {
+    .record_pos = record_pos,
+    .key_hash = key_hash,
+  };
+  const int idx = prv_index_lower_bound(file, prv_index_sort_key(&entry));
+  memmove(&file->index[idx + 1], &file->index[idx],
+          (file->index_len - idx) * sizeof(*file->index));
+  file->index[idx] = entry;
+  file->index_len++;
+}
+
+static void prv_index_remove(SettingsFile *file, uint8_t key_hash, int record_pos) {
+  if (!file->index) {
+    return;
+  }
+  const SettingsFileIndexEntry entry = {
+    .record_pos = record_pos,
+    .key_hash = key_hash,
+  };
+  const int idx = prv_index_lower_bound(file, prv_index_sort_key(&entry));
+  if ((idx == file->index_len) || (file->index[idx].record_pos != (uint32_t)record_pos)) {
+    return;
+  }
+  memmove(&file->index[idx], &file->index[idx + 1],
+          (file->index_len - idx - 1) * sizeof(*file->index));
+  file->index_len--;
+}
+
+static void prv_index_sift_down(SettingsFileIndexEntry *index, int root, int len) {
+  while ((2 * root + 1) < len) {
+    int child = 2 * root + 1;
+    if (((child + 1) < len) &&
+        (prv_index_sort_key(&index[child]) < prv_index_sort_key(&index[child + 1]))) {
+      child++;
+    }
+    if (prv_index_sort_key(&index[root]) >= prv_index_sort_key(&index[child])) {
+      return;
+    }
+    const SettingsFileIndexEntry tmp = index[root];
+    index[root] = index[child];
+    index[child] = tmp;
+    root = child;
+  }
+}
+
+//! Heapsort, since the index can be far too large for a bubble sort and we
+//! don't want to allocate a second copy of it
+static void prv_index_sort(SettingsFile *file) {
+  SettingsFileIndexEntry *index = file->index;
+  for (int root = (file->index_len / 2) - 1; root >= 0; root--) {
+    prv_index_sift_down(index, root, file->index_len);
+  }
+  for (int end = file->index_len - 1; end > 0; end--) {
+    const SettingsFileIndexEntry tmp = index[0];
+    index[0] = index[end];
+    index[end] = tmp;
+    prv_index_sift_down(index, 0, end);
+  }
+}
+
+static void prv_index_build_begin(SettingsFile *file) {
+  prv_index_invalidate(file);
+  file->index = kernel_malloc(INDEX_GROW_ENTRIES * sizeof(*file->index));
+  if (file->index) {
+    file->index_capacity = INDEX_GROW_ENTRIES;
+  }
+}
+
+//! Records are visited in file order while building, so just append them and
+//! sort once at the end
+static void prv_index_build_add(SettingsFile *file, uint8_t key_hash, int record_pos) {
+  if (!file->index) {
+    return;
+  }
+  if ((record_pos > INDEX_MAX_RECORD_POS) || !prv_index_reserve(file, file->index_len + 1)) {
+    prv_index_invalidate(file);
+    return;
+  }
+  file->index[file->index_len++] = (SettingsFileIndexEntry) {
+    .record_pos = record_pos,
+    .key_hash = key_hash,
+  };
+}
+
+static void prv_index_build_end(SettingsFile *file) {
+  if (!file->index) {
+    return;
+  }
+  prv_index_sort(file);
+}
+#else
+static void prv_index_invalidate(SettingsFile *file) {}
+static void prv_index_add(SettingsFile *file, uint8_t key_hash, int record_pos) {}
+static void prv_index_remove(SettingsFile *file, uint8_t key_hash, int record_pos) {}
+static void prv_index_build_begin(SettingsFile *file) {}
+static void prv_index_build_add(SettingsFile *file, uint8_t key_hash, int record_pos) {}
+static void prv_index_build_end(SettingsFile *file) {}
+#endif
+
 static void compute_stats(SettingsFile *file) {
   file->dead_space = 0;
   file->used_space = 0;
   file->last_modified = 0;
   file->used_space += sizeof(SettingsFileHeader);
   file->used_space += sizeof(SettingsRecordHeader); // EOF Marker
+  prv_index_build_begin(file);
   for (settings_raw_iter_begin(&file->iter); !settings_raw_iter_end(&file->iter);
        settings_raw_iter_next(&file->iter)) {
     if (overwritten(&file->iter.hdr) || deleted_and_expired(&file->iter.hdr)) {
@@ -213,11 +385,19 @@ static void compute_stats(SettingsFile *file) {
     if (file->iter.hdr.last_modified > file->last_modified) {
       file->last_modified = file->iter.hdr.last_modified;
     }
+    if (!overwritten(&file->iter.hdr) && !partially_written(&file->iter.hdr)) {
+      prv_index_build_add(file, file->iter.hdr.key_hash,
+                          settings_raw_iter_get_current_record_pos(&file->iter));
+    }
   }
+  file->eof_record_pos = settings_raw_iter_get_current_record_pos(&file->iter);
+  prv_index_build_end(file);
 }
 
 status_t settings_file_rewrite_filtered(
     SettingsFile *file, SettingsFileRewriteFilterCallback filter_cb, void *context) {
+  // Reopening the file would drop the transaction
+  PBL_ASSERTN(!file->in_transaction);
   // One reusable buffer for key+val per record; sized for the worst case.
   // Avoids two malloc/free pairs per record over what can be thousands of
   // records on a large persist file.
@@ -252,11 +432,12 @@ status_t settings_file_rewrite_filtered(
   for (settings_raw_iter_begin(&file->iter); !settings_raw_iter_end(&file->iter);
       settings_raw_iter_next(&file->iter)) {
     SettingsRecordHeader *hdr = &file->iter.hdr;
-    if (partially_written(hdr)) {
+    if (partially_written(hdr) || txn_uncommitted(hdr)) {
       // This should only happen if we reboot in the middle of writing a new
-      // record, and it should always be the most recently written record, so
-      // we shouldn't lose any data here (except for the partially written
-      // record, but we should ignore it's garbage data anyway).
+      // record (or batch of records), and it should always be the most
+      // recently written record, so we shouldn't lose any data here (except
+      // for the partially written record, but we should ignore it's garbage
+      // data anyway).
       break;
     }
     if (overwritten(hdr) || deleted_and_expired(hdr)) {
@@ -271,6 +452,8 @@ status_t settings_file_rewrite_filtered(
       // for this case in bootup_check().
       clear_flag(hdr, SETTINGS_FLAG_OVERWRITE_STARTED);
     }
+    // Batches are only needed for crash consistency until they're committed
+    clear_flag(hdr, SETTINGS_FLAG_TXN | SETTINGS_FLAG_TXN_COMMITTED);
 
     // Read key+val in a single PFS call; key occupies the first key_len bytes.
     settings_raw_iter_read_key_val(&file->iter, kv_buf);
@@ -349,7 +532,7 @@ static bool key_matches(SettingsRawIter *iter, const uint8_t *key, int key_len)
 }
 
 static bool prv_is_desired_hdr(SettingsRawIter *iter, const uint8_t *key, int key_len) {
-  if (overwritten(&iter->hdr) || partially_written(&iter->hdr)) {
+  if (overwritten(&iter->hdr) || partially_written(&iter->hdr) || txn_uncommitted(&iter->hdr)) {
     return false;
   }
 
@@ -380,11 +563,46 @@ static bool search_forward(SettingsRawIter *iter, const uint8_t *key, int key_le
   return false;
 }
 
+#if CONFIG_SERVICE_SETTINGS_INDEX
+static bool prv_index_search(SettingsFile *file, const uint8_t *key, int key_len) {
+  const uint8_t key_hash = crc8_calculate_bytes(key, key_len, true /* big_endian */);
+  for (int idx = prv_index_lower_bound(file, (uint32_t)key_hash << 24);
+       (idx < file->index_len) && (file->index[idx].key_hash == key_hash); idx++) {
+    settings_raw_iter_set_current_record_pos(&file->iter, file->index[idx].record_pos);
+    if (prv_is_desired_hdr(&file->iter, key, key_len)) {
+      return true;
+    }
+  }
+  return false;
+}
+#endif
+
+//! Positions file->iter on the live record for the given key, if there is one
+static bool prv_search(SettingsFile *file, const uint8_t *key, int key_len) {
+#if CONFIG_SERVICE_SETTINGS_INDEX
+  if (file->index) {
+    return prv_index_search(file, key, key_len);
+  }
+#endif
+  settings_raw_iter_resume(&file->iter);
+  return search_forward(&file->iter, key, key_len);
+}
+
+static bool prv_has_uncommitted_txn(SettingsFile *file) {
+  for (settings_raw_iter_begin(&file->iter); !settings_raw_iter_end(&file->iter);
+      settings_raw_iter_next(&file->iter)) {
+    if (txn_uncommitted(&file->iter.hdr)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 static status_t cleanup_partial_transactions(SettingsFile *file) {
   for (settings_raw_iter_begin(&file->iter); !settings_raw_iter_end(&file->iter);
       settings_raw_iter_next(&file->iter)) {
 
-    if (partially_written(&file->iter.hdr)) {
+    if (partially_written(&file->iter.hdr) || txn_uncommitted(&file->iter.hdr)) {
       // Compact will remove partially written records. We could be smarter,
       // but this is something of an edge case.
       return settings_file_compact(file);
@@ -401,7 +619,9 @@ static status_t cleanup_partial_transactions(SettingsFile *file) {
     settings_raw_iter_next(&file->iter); // Skip the current record
     bool found_another = search_forward(&file->iter, key, file->iter.hdr.key_len);
 
-    if (!found_another) {
+    // The other record could belong to a batch which never got committed, in
+    // which case the records after its first one look perfectly valid
+    if (!found_another || prv_has_uncommitted_txn(file)) {
       // No other file->iter.hdr found, we must have rebooted in the middle of
       // writing the new record. Compacting the file will copy over the
       // previous record while clearing the overwrite bits for us, so that we
@@ -426,8 +646,7 @@ static status_t bootup_check(SettingsFile* file) {
 }
 
 int settings_file_get_len(SettingsFile *file, const void *key, size_t key_len) {
-  settings_raw_iter_resume(&file->iter);
-  if (search_forward(&file->iter, key, key_len)) {
+  if (prv_search(file, key, key_len)) {
     return file->iter.hdr.val_len;
   } else {
     return 0;
@@ -440,8 +659,7 @@ bool settings_file_exists(SettingsFile *file, const void *key, size_t key_len) {
 
 status_t settings_file_get(SettingsFile *file, const void *key, size_t key_len,
                            void *val_out, size_t val_out_len) {
-  settings_raw_iter_resume(&file->iter);
-  if (!search_forward(&file->iter, key, key_len)) {
+  if (!prv_search(file, key, key_len)) {
     memset(val_out, 0, val_out_len);
     return E_DOES_NOT_EXIST;
   }
@@ -465,8 +683,7 @@ status_t settings_file_set_byte(SettingsFile *file, const void *key,
   }
 
   // Find the record
-  settings_raw_iter_resume(&file->iter);
-  if (!search_forward(&file->iter, key, key_len) ||
+  if (!prv_search(file, key, key_len) ||
       file->iter.hdr.val_len == 0) {
     return E_DOES_NOT_EXIST;
   }
@@ -504,19 +721,9 @@ static status_t prv_grow(SettingsFile *file, int needed_used_space) {
 // written and returned for all future queries, or, if we reboot/loose power/
 // run into an error, then we will continue to return the previous value.
 // We should never run into a case where neither value exists.
-static status_t prv_settings_file_set_internal(SettingsFile *file, const void *key, size_t key_len,
-                                               const void *val, size_t val_len,
-                                               uint32_t timestamp) {
-  // Cannot set keys while iterating (Try settings_file_rewrite)
-  PBL_ASSERTN(file->cur_record_pos == 0);
-  if (key_len > SETTINGS_KEY_MAX_LEN) {
-    return E_RANGE;
-  }
-  if (val_len > SETTINGS_VAL_MAX_LEN) {
-    return E_RANGE;
-  }
-  const bool is_delete = (val_len == 0);
-  const int rec_size = sizeof(SettingsRecordHeader) + key_len + val_len;
+//! Makes sure that rec_size more bytes of records can be appended to the file,
+//! growing or compacting it if needed.
+static status_t prv_make_room(SettingsFile *file, int rec_size, bool is_delete) {
   if (!is_delete && file->used_space + rec_size > file->max_used_space) {
     return E_OUT_OF_STORAGE;
   }
@@ -533,19 +740,43 @@ static status_t prv_settings_file_set_internal(SettingsFile *file, const void *k
       return status;
     }
   }
+  return S_SUCCESS;
+}
+
+static status_t prv_txn_add(SettingsFile *file, const void *key, size_t key_len,
+                            const void *val, size_t val_len, uint32_t timestamp);
+
+static status_t prv_settings_file_set_internal(SettingsFile *file, const void *key, size_t key_len,
+                                               const void *val, size_t val_len,
+                                               uint32_t timestamp) {
+  // Cannot set keys while iterating (Try settings_file_rewrite)
+  PBL_ASSERTN(file->cur_record_pos == 0);
+  if (key_len > SETTINGS_KEY_MAX_LEN) {
+    return E_RANGE;
+  }
+  if (val_len > SETTINGS_VAL_MAX_LEN) {
+    return E_RANGE;
+  }
+  if (file->in_transaction) {
+    return prv_txn_add(file, key, key_len, val, val_len, timestamp);
+  }
+  const bool is_delete = (val_len == 0);
+  const int rec_size = sizeof(SettingsRecordHeader) + key_len + val_len;
+  status_t status = prv_make_room(file, rec_size, is_delete);
+  if (status < 0) {
+    return status;
+  }
 
   int overwritten_record = -1;
   // Find an existing record, if any, and mark it as overwrite-in-progress.
-  settings_raw_iter_resume(&file->iter);
-  if (search_forward(&file->iter, key, key_len)) {
+  if (prv_search(file, key, key_len)) {
     set_flag(&file->iter.hdr, SETTINGS_FLAG_OVERWRITE_STARTED);
     settings_raw_iter_write_header(&file->iter, &file->iter.hdr);
     overwritten_record = settings_raw_iter_get_current_record_pos(&file->iter);
   }
 
-  while (!settings_raw_iter_end(&file->iter)) {
-    settings_raw_iter_next(&file->iter);
-  }
+  settings_raw_iter_set_current_record_pos(&file->iter, file->eof_record_pos);
+  PBL_ASSERTN(settings_raw_iter_end(&file->iter));
 
   // Create and write out a new record. Writing the header transitions us into
   // the write-in-progress state, since at least once of the bits must be
@@ -566,6 +797,8 @@ static status_t prv_settings_file_set_internal(SettingsFile *file, const void *k
   set_flag(&new_hdr, SETTINGS_FLAG_WRITE_COMPLETE);
   settings_raw_iter_write_header(&file->iter, &new_hdr);
   file->used_space += rec_size;
+  prv_index_add(file, new_hdr.key_hash, file->eof_record_pos);
+  file->eof_record_pos += rec_size;
 
   // Finally, mark the existing record, if any, as overwritten.
   if (overwritten_record >= 0) {
@@ -574,6 +807,7 @@ static status_t prv_settings_file_set_internal(SettingsFile *file, const void *k
     settings_raw_iter_write_header(&file->iter, &file->iter.hdr);
     file->dead_space += record_size(&file->iter.hdr);
     file->used_space -= record_size(&file->iter.hdr);
+    prv_index_remove(file, file->iter.hdr.key_hash, overwritten_record);
   }
 
   // Notify change callback if registered (for settings sync)
@@ -594,6 +828,226 @@ status_t settings_file_set_with_timestamp(SettingsFile *file, const void *key, s
   return prv_settings_file_set_internal(file, key, key_len, val, val_len, timestamp);
 }
 
+  //////////////////
+ // Transactions //
+//////////////////
+
+// Size of the buffer batched records are serialized into before writing them
+// out, unless a single record is larger than this
+#define TXN_WRITE_CHUNK_SIZE 512
+
+typedef struct SettingsFileTxnOp {
+  struct SettingsFileTxnOp *next;
+  uint32_t timestamp;
+  //! Position of the record this operation replaces, if any
+  int overwritten_record;
+  int key_len;
+  int val_len;
+  uint8_t key_hash;
+  //! The key followed by the value
+  uint8_t key_val[];
+} SettingsFileTxnOp;
+
+static void prv_txn_free(SettingsFileTxnOp *op) {
+  while (op) {
+    SettingsFileTxnOp *next = op->next;
+    kernel_free(op);
+    op = next;
+  }
+}
+
+static void prv_txn_reset(SettingsFile *file) {
+  file->txn_ops = NULL;
+  file->txn_ops_tail = NULL;
+  memset(file->txn_key_hashes, 0, sizeof(file->txn_key_hashes));
+}
+
+//! Removes the buffered operation on the given key, if any
+static void prv_txn_remove_key(SettingsFile *file, const void *key, size_t key_len,
+                               uint8_t key_hash) {
+  SettingsFileTxnOp *prev = NULL;
+  for (SettingsFileTxnOp *op = file->txn_ops; op; prev = op, op = op->next) {
+    if ((op->key_hash == key_hash) && (op->key_len == (int)key_len) &&
+        (memcmp(op->key_val, key, key_len) == 0)) {
+      if (prev) {
+        prev->next = op->next;
+      } else {
+        file->txn_ops = op->next;
+      }
+      if (file->txn_ops_tail == op) {
+        file->txn_ops_tail = prev;
+      }
+      kernel_free(op);
+      return;
+    }
+  }
+}
+
+static status_t prv_txn_add(SettingsFile *file, const void *key, size_t key_len,
+                            const void *val, size_t val_len, uint32_t timestamp) {
+  SettingsFileTxnOp *new_op = kernel_malloc(sizeof(*new_op) + key_len + val_len);
+  if (!new_op) {
+    return E_OUT_OF_MEMORY;
+  }
+  *new_op = (SettingsFileTxnOp) {
+    .timestamp = timestamp,
+    .overwritten_record = -1,
+    .key_len = key_len,
+    .val_len = val_len,
+    .key_hash = crc8_calculate_bytes(key, key_len, true /* big_endian */),
+  };
+  memcpy(new_op->key_val, key, key_len);
+  memcpy(new_op->key_val + key_len, val, val_len);
+
+  // A key can only appear once in a batch, the latest operation wins
+  const uint32_t hash_bit = (1u << (new_op->key_hash % 32));
+  uint32_t *hash_word = &file->txn_key_hashes[new_op->key_hash / 32];
+  if (*hash_word & hash_bit) {
+    prv_txn_remove_key(file, key, key_len, new_op->key_hash);
+  }
+  *hash_word |= hash_bit;
+
+  if (file->txn_ops_tail) {
+    file->txn_ops_tail->next = new_op;
+  } else {
+    file->txn_ops = new_op;
+  }
+  file->txn_ops_tail = new_op;
+  return S_SUCCESS;
+}
+
+status_t settings_file_begin_transaction(SettingsFile *file) {
+  PBL_ASSERTN(!file->in_transaction);
+  file->in_transaction = true;
+  prv_txn_reset(file);
+  return S_SUCCESS;
+}
+
+void settings_file_abort_transaction(SettingsFile *file) {
+  prv_txn_free(file->txn_ops);
+  prv_txn_reset(file);
+  file->in_transaction = false;
+}
+
+static int prv_txn_record_size(const SettingsFileTxnOp *op) {
+  return sizeof(SettingsRecordHeader) + op->key_len + op->val_len;
+}
+
+static status_t prv_txn_write(SettingsFile *file, SettingsFileTxnOp *ops) {
+  int batch_size = 0;
+  int chunk_size = TXN_WRITE_CHUNK_SIZE;
+  bool is_delete = true;
+  for (SettingsFileTxnOp *op = ops; op; op = op->next) {
+    batch_size += prv_txn_record_size(op);
+    chunk_size = MAX(chunk_size, prv_txn_record_size(op));
+    is_delete = is_delete && (op->val_len == 0);
+  }
+  if (batch_size == 0) {
+    return S_SUCCESS;
+  }
+  chunk_size = MIN(chunk_size, batch_size);
+
+  uint8_t *chunk = kernel_malloc(chunk_size);
+  if (!chunk) {
+    return E_OUT_OF_MEMORY;
+  }
+
+  // Compact (or grow) at most once for the whole batch
+  status_t status = prv_make_room(file, batch_size, is_delete);
+  if ((status >= 0) &&
+      (file->used_space + file->dead_space + batch_size > file->max_space_total)) {
+    status = E_OUT_OF_STORAGE;
+  }
+  if (status < 0) {
+    kernel_free(chunk);
+    return status;
+  }
+
+  // Mark the records being replaced as overwrite-in-progress. Should we reboot
+  // before the batch is committed, bootup_check() will restore them.
+  for (SettingsFileTxnOp *op = ops; op; op = op->next) {
+    if (prv_search(file, op->key_val, op->key_len)) {
+      set_flag(&file->iter.hdr, SETTINGS_FLAG_OVERWRITE_STARTED);
+      settings_raw_iter_write_header(&file->iter, &file->iter.hdr);
+      op->overwritten_record = settings_raw_iter_get_current_record_pos(&file->iter);
+    }
+  }
+
+  // Append every record of the batch. They are written out complete, but
+  // none of them count until the commit marker on the first one is set.
+  const int batch_pos = file->eof_record_pos;
+  settings_raw_iter_set_current_record_pos(&file->iter, batch_pos);
+  int chunk_len = 0;
+  for (SettingsFileTxnOp *op = ops; op; op = op->next) {
+    const int rec_size = prv_txn_record_size(op);
+    if (chunk_len + rec_size > chunk_size) {
+      settings_raw_iter_write_records(&file->iter, chunk, chunk_len);
+      chunk_len = 0;
+    }
+
+    SettingsRecordHeader hdr;
+    memset(&hdr, 0xff, sizeof(hdr));
+    hdr.last_modified = op->timestamp;
+    hdr.key_hash = op->key_hash;
+    hdr.key_len = op->key_len;
+    hdr.val_len = op->val_len;
+    set_flag(&hdr, SETTINGS_FLAG_WRITE_COMPLETE | SETTINGS_FLAG_TXN);
+    if (op != ops) {
+      set_flag(&hdr, SETTINGS_FLAG_TXN_COMMITTED);
+    }
+
+    memcpy(&chunk[chunk_len], &hdr, sizeof(hdr));
+    memcpy(&chunk[chunk_len + sizeof(hdr)], op->key_val, op->key_len + op->val_len);
+    chunk_len += rec_size;
+  }
+  settings_raw_iter_write_records(&file->iter, chunk, chunk_len);
+  kernel_free(chunk);
+
+  // Commit the batch
+  settings_raw_iter_set_current_record_pos(&file->iter, batch_pos);
+  SettingsRecordHeader first_hdr = file->iter.hdr;
+  set_flag(&first_hdr, SETTINGS_FLAG_TXN_COMMITTED);
+  settings_raw_iter_write_header(&file->iter, &first_hdr);
+
+  // Finally, mark the replaced records as overwritten.
+  int record_pos = batch_pos;
+  for (SettingsFileTxnOp *op = ops; op; op = op->next) {
+    const int rec_size = prv_txn_record_size(op);
+    file->used_space += rec_size;
+    prv_index_add(file, op->key_hash, record_pos);
+    record_pos += rec_size;
+
+    if (op->overwritten_record >= 0) {
+      settings_raw_iter_set_current_record_pos(&file->iter, op->overwritten_record);
+      set_flag(&file->iter.hdr, SETTINGS_FLAG_OVERWRITE_COMPLETE);
+      settings_raw_iter_write_header(&file->iter, &file->iter.hdr);
+      file->dead_space += record_size(&file->iter.hdr);
+      file->used_space -= record_size(&file->iter.hdr);
+      prv_index_remove(file, file->iter.hdr.key_hash, op->overwritten_record);
+    }
+
+    if (s_change_callback) {
+      s_change_callback(file, op->key_val, op->key_len, op->timestamp);
+    }
+  }
+  file->eof_record_pos = record_pos;
+
+  return S_SUCCESS;
+}
+
+status_t settings_file_commit_transaction(SettingsFile *file) {
+  PBL_ASSERTN(file->in_transaction && (file->cur_record_pos == 0));
+
+  // Detach the batch first, compacting the file reopens it
+  SettingsFileTxnOp *ops = file->txn_ops;
+  prv_txn_reset(file);
+  file->in_transaction = false;
+
+  status_t status = prv_txn_write(file, ops);
+  prv_txn_free(ops);
+  return status;
+}
+
 status_t settings_file_mark_synced(SettingsFile *file, const void *key, size_t key_len) {
   // Cannot set keys while iterating (Try settings_file_rewrite)
   PBL_ASSERTN(file->cur_record_pos == 0);
@@ -602,8 +1056,7 @@ status_t settings_file_mark_synced(SettingsFile *file, const void *key, size_t k
   }
 
   // Find an existing record, if any, and mark it as synced
-  settings_raw_iter_resume(&file->iter);
-  if (search_forward(&file->iter, key, key_len)) {
+  if (prv_search(file, key, key_len)) {
     set_flag(&file->iter.hdr, SETTINGS_FLAG_SYNCED);
     settings_raw_iter_write_header(&file->iter, &file->iter.hdr);
     return S_SUCCESS;
@@ -694,6 +1147,7 @@ static bool prv_rewrite_cb(SettingsFile *file, SettingsRecordInfo *info,
 }
 status_t settings_file_rewrite(SettingsFile *file,
                                SettingsFileRewriteCallback cb, void *context) {
+  PBL_ASSERTN(!file->in_transaction);
   char *name = kernel_strdup(file->name);
   if (!name) {
     PBL_LOG_ERR("Could not allocate name to rewrite settings file %s", file->name);
@@ -219,6 +219,20 @@ void settings_raw_iter_write_key_val(SettingsRawIter *iter, const uint8_t *key_v
   sfs_seek(iter, iter->hdr_pos + sizeof(SettingsRecordHeader), FSeekSet);
   sfs_write(iter, key_val, kv_len);
 }
+
+void settings_raw_iter_write_records(SettingsRawIter *iter, const uint8_t *records, int len) {
+  if (!settings_raw_iter_end(iter)) {
+    PBL_LOG_ERR("Appending records at pos %d which isn't the end", iter->hdr_pos);
+    fatal_logic_error(iter);
+  }
+  sfs_seek(iter, iter->hdr_pos, FSeekSet);
+  sfs_write(iter, records, len);
+
+  // Read the new EOF marker
+  iter->hdr_pos += len;
+  sfs_read(iter, (uint8_t*)&iter->hdr, sizeof(iter->hdr));
+}
+
 void settings_raw_iter_write_byte(SettingsRawIter *iter, int offset, uint8_t byte) {
   sfs_seek(iter, iter->hdr_pos +
       sizeof(SettingsRecordHeader) + iter->hdr.key_len + offset, FSeekSet);
@@ -30,6 +30,7 @@
 #include "system/passert.h"
 #include "pbl/util/list.h"
 #include "pbl/util/math.h"
+#include "pbl/util/object_pool.h"
 #include "pbl/util/order.h"
 #include "pbl/util/size.h"
 #include "util/time/time.h"
@@ -52,6 +53,16 @@ static uint32_t i18n_key;
 
 static bool s_bulk_action_mode = false;
 
+//! Number of TimelineNodes to allocate at a time
+#define TIMELINE_NODE_POOL_SLAB_SIZE (16)
+
+//! Building the timeline allocates a node per pin and day, which used to leave the heap of the
+//! timeline app riddled with small allocations. The pool lives on the heap of the task that
+//! builds the timeline and is set up again by every timeline_init().
+static ObjectPool s_node_pool;
+//! The task whose heap s_node_pool's slabs are on, PebbleTask_Unknown if it isn't set up
+static PebbleTask s_node_pool_task = PebbleTask_Unknown;
+
 /////////////////////////
 // Timeline Iterator
 /////////////////////////
@@ -176,7 +187,7 @@ static TimelineNode *prv_find_first(TimelineNode *head, TimelineIterDirection di
 
 static void prv_remove_node(TimelineNode **head, TimelineNode *node) {
   list_remove((ListNode *)node, (ListNode **)head, NULL);
-  task_free(node);
+  object_pool_free(&s_node_pool, node);
 }
 
 static int prv_num_nodes_for_serialized_item(CommonTimelineItemHeader *header) {
@@ -259,8 +270,7 @@ static void prv_add_nodes_for_serialized_item(TimelineNode **list_head,
 
   // copy UUID to all the nodes
   for (int i = 0; i < num_nodes; i++) {
-    // each node requires its own malloc because each node must be individually free-able
-    nodes[i] = task_malloc_check(sizeof(TimelineNode));
+    nodes[i] = object_pool_alloc(&s_node_pool);
     *(nodes[i]) = (TimelineNode){};
     nodes[i]->id = header->id;
   }
@@ -466,6 +476,12 @@ static void prv_put_outgoing_call_event(uint32_t call_identifier, const char *ca
 //////////////////////////////////////////////////
 
 status_t timeline_init(TimelineNode **timeline) {
+  // Any nodes of a previous timeline have either been freed or went away with their heap
+  object_pool_init(&s_node_pool, "timeline_node", sizeof(TimelineNode),
+                   TIMELINE_NODE_POOL_SLAB_SIZE, task_malloc_check_with_pc, task_free,
+                   PBL_ANALYTICS_KEY(memory_pool_timeline_nodes_max));
+  s_node_pool_task = pebble_task_get_current();
+
   PBL_LOG_DBG("Starting to build list.");
   status_t rv = pin_db_each(prv_each, timeline);
   prv_prune_ordered_timeline_list(timeline);
@@ -477,6 +493,15 @@ status_t timeline_init(TimelineNode **timeline) {
   return rv;
 }
 
+void timeline_process_cleanup(PebbleTask task) {
+  if (s_node_pool_task != task) {
+    return;
+  }
+  // Don't leave the pool registered with slabs on a heap that is about to be reset
+  object_pool_deinit(&s_node_pool);
+  s_node_pool_task = PebbleTask_Unknown;
+}
+
 bool timeline_add(TimelineItem *item) {
   return (S_SUCCESS == pin_db_insert_item(item));
 }
@@ -223,6 +223,8 @@ bool sys_app_inbox_service_register(uint8_t *storage, size_t storage_size,
                                     AppInboxDroppedHandler dropped_handler);
 uint32_t sys_app_inbox_service_unregister(uint8_t *storage);
 void sys_app_inbox_service_consume(AppInboxConsumerInfo *consumer_info);
+void sys_app_inbox_service_pin(AppInboxConsumerInfo *consumer_info);
+void sys_app_inbox_service_release(uint8_t *storage);
 
 void sys_app_outbox_send(const uint8_t *data, size_t length,
                          AppOutboxSentHandler sent_handler, void *cb_ctx);
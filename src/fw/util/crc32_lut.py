@@ -2,26 +2,64 @@
 # SPDX-FileCopyrightText: 2024 Google LLC
 # SPDX-License-Identifier: Apache-2.0
 
+"""Generates the lookup tables used by lib/util/crc32.c.
+
+Without arguments the nybble-wide table is printed. With --slices N the byte-wide tables for the
+slice-by-N algorithm are printed instead, the first of which is the plain byte-wide table. These
+live in lib/util/crc32_slice_tables.h.
+"""
 
 from __future__ import print_function
 
+import argparse
+
 CRC_POLY = 0xEDB88320
 
 
 def crc_table(bits):
     lookup_table = []
-    for i in xrange(2**bits):
-        rr = i * 16
-        for x in xrange(8):
+    for i in range(2**bits):
+        rr = i << (8 - bits)
+        for x in range(8):
             rr = (rr >> 1) ^ (-(rr & 1) & CRC_POLY)
         lookup_table.append(rr & 0xFFFFFFFF)
     return lookup_table
 
 
-table = ["0x{:08x},".format(entry) for entry in crc_table(4)]
-chunks = zip(*[iter(table)] * 4)
+def slice_tables(num_slices):
+    # Table k advances the CRC over a byte followed by k zero bytes
+    tables = [crc_table(8)]
+    for k in range(1, num_slices):
+        previous = tables[k - 1]
+        tables.append([(previous[i] >> 8) ^ tables[0][previous[i] & 0xFF] for i in range(256)])
+    return tables
+
+
+def print_table(table, indent):
+    entries = ["0x{:08x},".format(entry) for entry in table]
+    for i in range(0, len(entries), 4):
+        print(indent + " ".join(entries[i : i + 4]))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--slices", type=int)
+    args = parser.parse_args()
 
-print("static const uint32_t s_lookup_table[] = {")
-for chunk in chunks:
-    print("  " + " ".join(chunk))
-print("};")
+    if args.slices:
+        # Only the first CRC32_NUM_SLICES tables are compiled in, slice-by-4 doesn't pay for the
+        # flash of slice-by-8
+        print("static const uint32_t s_slice_tables[CRC32_NUM_SLICES][256] = {")
+        for k, table in enumerate(slice_tables(args.slices)):
+            if k == 4:
+                print("#if CRC32_NUM_SLICES > 4")
+            print("  {")
+            print_table(table, "    ")
+            print("  },")
+        if args.slices > 4:
+            print("#endif")
+        print("};")
+    else:
+        print("static const uint32_t s_lookup_table[] = {")
+        print_table(crc_table(4), "  ")
+        print("};")
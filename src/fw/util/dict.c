@@ -8,6 +8,7 @@
 #include "system/passert.h"
 #include "kernel/pbl_malloc.h"
 #include "pbl/util/list.h"
+#include "pbl/util/math.h"
 #include "util/net.h"
 
 static DictionaryResult dict_init(DictionaryIterator *iter, const uint8_t * const buffer, const uint16_t length) {
@@ -308,17 +309,19 @@ static uint8_t* dict_copy(DictionaryIterator* iter) {
 // Merge orig_iter and new_iter into dest_iter. Keys which exist in both
 // orig_iter and new_iter will get the value they have in new_iter.
 static DictionaryResult dict_merge_to(DictionaryIterator* dest_iter,
-                                      DictionaryIterator* orig_iter,
-                                      DictionaryIterator* new_iter,
+                                      const DictionaryIndex* orig_index,
+                                      const DictionaryIndex* new_index,
                                       const bool update_existing_keys_only,
                                       const DictionaryKeyUpdatedCallback update_key_callback,
                                       void* context) {
   DictionaryResult result = DICT_OK;
+  DictionaryIterator new_iter = new_index->iter;
+  DictionaryIterator orig_iter = orig_index->iter;
 
   // First, write the updated keys.
-  for (Tuple* new = dict_read_first(new_iter); new; new = dict_read_next(new_iter)) {
+  for (Tuple* new = dict_read_first(&new_iter); new; new = dict_read_next(&new_iter)) {
     uint32_t key = new->key;
-    const Tuple* orig = dict_find(orig_iter, key);
+    const Tuple* orig = dict_index_find(orig_index, key);
     if (orig == NULL && update_existing_keys_only) {
       continue;
     }
@@ -335,9 +338,9 @@ static DictionaryResult dict_merge_to(DictionaryIterator* dest_iter,
   // We still call update_key_callback here, even though the values
   // themselves have not changed, because we have shuffled them
   // around in memory, so their old buffers are no longer valid.
-  for (Tuple* orig = dict_read_first(orig_iter); orig; orig = dict_read_next(orig_iter)) {
+  for (Tuple* orig = dict_read_first(&orig_iter); orig; orig = dict_read_next(&orig_iter)) {
     uint32_t key = orig->key;
-    Tuple* new = dict_find(new_iter, key);
+    Tuple* new = dict_index_find(new_index, key);
     if (new != NULL) {
       // We already wrote this key, above.
       continue;
@@ -355,26 +358,89 @@ static DictionaryResult dict_merge_to(DictionaryIterator* dest_iter,
 // of merging orig_iter and new_iter. This logic should always mirror the logic
 // in dict_merge_to, except it should simply count the size, rather than
 // actually merging the results.
-static size_t dict_merge_to_size(DictionaryIterator* orig_iter,
-                                 DictionaryIterator* new_iter,
+static size_t dict_merge_to_size(const DictionaryIndex* orig_index,
+                                 const DictionaryIndex* new_index,
                                  const bool update_existing_keys_only) {
   size_t total_size_required = sizeof(Dictionary);
+  DictionaryIterator new_iter = new_index->iter;
+  DictionaryIterator orig_iter = orig_index->iter;
 
   // First, calculate the size of the new/updated keys.
-  for (Tuple* new = dict_read_first(new_iter); new; new = dict_read_next(new_iter)) {
-    if (dict_find(orig_iter, new->key) == NULL && update_existing_keys_only) continue;
+  for (Tuple* new = dict_read_first(&new_iter); new; new = dict_read_next(&new_iter)) {
+    if (dict_index_find(orig_index, new->key) == NULL && update_existing_keys_only) continue;
     total_size_required += sizeof(*new) + new->length;
   }
 
   // Then, add in the size of the keys which have not changed.
-  for (Tuple* orig = dict_read_first(orig_iter); orig; orig = dict_read_next(orig_iter)) {
-    if (dict_find(new_iter, orig->key) != NULL) continue;
+  for (Tuple* orig = dict_read_first(&orig_iter); orig; orig = dict_read_next(&orig_iter)) {
+    if (dict_index_find(new_index, orig->key) != NULL) continue;
     total_size_required += sizeof(*orig) + orig->length;
   }
 
   return total_size_required;
 }
 
+// The values can be updated in place if every tuple that will be written replaces an existing
+// tuple of the same size. Keys which appear more than once in new_iter all get written by
+// dict_merge_to, so those need a full merge as well.
+static bool dict_merge_can_update_in_place(const DictionaryIndex* orig_index,
+                                           const DictionaryIndex* new_index,
+                                           const bool update_existing_keys_only,
+                                           uint16_t* max_length_out) {
+  uint16_t max_length = 0;
+  DictionaryIterator new_iter = new_index->iter;
+  for (Tuple* new = dict_read_first(&new_iter); new; new = dict_read_next(&new_iter)) {
+    const Tuple* orig = dict_index_find(orig_index, new->key);
+    if (orig == NULL) {
+      if (update_existing_keys_only) {
+        continue;
+      }
+      return false;
+    }
+    if (orig->length != new->length ||
+        dict_index_find(new_index, new->key) != new) {
+      return false;
+    }
+    max_length = MAX(max_length, orig->length);
+  }
+  *max_length_out = max_length;
+  return true;
+}
+
+static DictionaryResult dict_merge_in_place(const DictionaryIndex* dest_index,
+                                            const DictionaryIndex* new_index,
+                                            const uint16_t max_length,
+                                            const DictionaryKeyUpdatedCallback update_key_callback,
+                                            void* context) {
+  // Copy of the old value for update_key_callback, like dict_merge_to passes in
+  Tuple* old = task_malloc(sizeof(Tuple) + max_length);
+  if (old == NULL) return DICT_MALLOC_FAILED;
+
+  DictionaryIterator new_iter = new_index->iter;
+  for (Tuple* new = dict_read_first(&new_iter); new; new = dict_read_next(&new_iter)) {
+    Tuple* dest = dict_index_find(dest_index, new->key);
+    if (dest == NULL) {
+      // Only possible with update_existing_keys_only
+      continue;
+    }
+    memcpy(old, dest, sizeof(Tuple) + dest->length);
+    dest->type = new->type;
+    memcpy(dest->value, new->value, new->length);
+    update_key_callback(dest->key, dest, old, context);
+  }
+  task_free(old);
+
+  // Like dict_merge_to, call back for the keys which were not updated as well. They didn't move,
+  // so the old tuple is the new one.
+  DictionaryIterator dest_iter = dest_index->iter;
+  for (Tuple* dest = dict_read_first(&dest_iter); dest; dest = dict_read_next(&dest_iter)) {
+    if (dict_index_find(new_index, dest->key) == NULL) {
+      update_key_callback(dest->key, dest, dest, context);
+    }
+  }
+  return DICT_OK;
+}
+
 DictionaryResult dict_merge(DictionaryIterator* dest_iter,
                             uint32_t* dest_buf_length_in_out,
                             DictionaryIterator* new_iter,
@@ -385,16 +451,47 @@ DictionaryResult dict_merge(DictionaryIterator* dest_iter,
     return DICT_INVALID_ARGS;
   }
 
-  size_t required_size = dict_merge_to_size(dest_iter, new_iter, update_existing_keys_only);
+  // Index both dictionaries, so the merge doesn't have to search one for every key of the other.
+  // Without memory for the indexes it still works, just with linear searches.
+  const uint32_t dest_index_size = dict_index_calc_storage_size(dest_iter);
+  const uint32_t new_index_size = dict_index_calc_storage_size(new_iter);
+  uint16_t* index_storage = task_malloc(dest_index_size + new_index_size);
+  DictionaryIndex dest_index;
+  DictionaryIndex new_index;
+  dict_index_init(&dest_index, dest_iter, index_storage, dest_index_size);
+  dict_index_init(&new_index, new_iter,
+                  index_storage ? index_storage + (dest_index_size / sizeof(uint16_t)) : NULL,
+                  new_index_size);
+
+  uint8_t* orig_buffer = NULL;
+  DictionaryResult result;
+  uint16_t max_length;
+  if (dict_merge_can_update_in_place(&dest_index, &new_index, update_existing_keys_only,
+                                     &max_length)) {
+    result = dict_merge_in_place(&dest_index, &new_index, max_length,
+                                 update_key_callback, context);
+    if (result != DICT_OK) goto cleanup;
+
+    dest_iter->cursor = (Tuple*)dest_iter->end;
+    *dest_buf_length_in_out = dict_size(dest_iter);
+    goto cleanup;
+  }
+
+  size_t required_size = dict_merge_to_size(&dest_index, &new_index, update_existing_keys_only);
   if (*dest_buf_length_in_out < required_size) {
-    return DICT_NOT_ENOUGH_STORAGE;
+    result = DICT_NOT_ENOUGH_STORAGE;
+    goto cleanup;
   }
 
-  uint8_t* orig_buffer = dict_copy(dest_iter);
-  if (orig_buffer == NULL) return DICT_MALLOC_FAILED;
+  orig_buffer = dict_copy(dest_iter);
+  if (orig_buffer == NULL) {
+    result = DICT_MALLOC_FAILED;
+    goto cleanup;
+  }
 
-  DictionaryIterator orig_iter;
-  DictionaryResult result = dict_init(&orig_iter, orig_buffer, dict_size(dest_iter));
+  // The index refers to tuples by offset, so it works for the copy as well:
+  DictionaryIndex orig_index = dest_index;
+  result = dict_init(&orig_index.iter, orig_buffer, dict_size(dest_iter));
   if (result != DICT_OK) goto cleanup;
 
   result = dict_write_begin(dest_iter,
@@ -402,7 +499,7 @@ DictionaryResult dict_merge(DictionaryIterator* dest_iter,
                             (uint16_t)*dest_buf_length_in_out);
   if (result != DICT_OK) goto cleanup;
 
-  result = dict_merge_to(dest_iter, &orig_iter, new_iter,
+  result = dict_merge_to(dest_iter, &orig_index, &new_index,
                          update_existing_keys_only,
                          update_key_callback, context);
   if (result != DICT_OK) goto cleanup;
@@ -411,6 +508,7 @@ DictionaryResult dict_merge(DictionaryIterator* dest_iter,
 
 cleanup:
   task_free(orig_buffer);
+  task_free(index_storage);
   return result;
 }
 
@@ -425,3 +523,89 @@ Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
   }
   return NULL;
 }
+
+// Keep at least every other slot empty, so probing for a missing key ends quickly
+static uint8_t prv_index_slots_log2(const DictionaryIterator *iter) {
+  DictionaryIterator iter_copy = *iter;
+  uint32_t count = 0;
+  for (Tuple *tuple = dict_read_first(&iter_copy); tuple; tuple = dict_read_next(&iter_copy)) {
+    ++count;
+  }
+  uint8_t slots_log2 = 2;
+  while ((1u << slots_log2) < (count * 2)) {
+    ++slots_log2;
+  }
+  return slots_log2;
+}
+
+static uint32_t prv_index_hash(const uint32_t key, const uint8_t slots_log2) {
+  // Fibonacci hashing: keys are often small consecutive numbers
+  return (key * 2654435761u) >> (32 - slots_log2);
+}
+
+uint32_t dict_index_calc_storage_size(const DictionaryIterator *iter) {
+  if (iter == NULL ||
+      iter->dictionary == NULL) {
+    return 0;
+  }
+  return sizeof(uint16_t) << prv_index_slots_log2(iter);
+}
+
+DictionaryResult dict_index_init(DictionaryIndex *index, const DictionaryIterator *iter,
+                                 uint16_t *storage, uint32_t storage_size) {
+  if (index == NULL ||
+      iter == NULL) {
+    return DICT_INVALID_ARGS;
+  }
+  *index = (DictionaryIndex) {
+    .iter = *iter,
+  };
+  if (iter->dictionary == NULL) {
+    return DICT_INVALID_ARGS;
+  }
+  if (storage == NULL) {
+    return DICT_OK;
+  }
+  const uint8_t slots_log2 = prv_index_slots_log2(iter);
+  const uint32_t num_slots = 1u << slots_log2;
+  if (storage_size < num_slots * sizeof(uint16_t)) {
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+  memset(storage, 0, num_slots * sizeof(uint16_t));
+
+  const uint8_t *base = (const uint8_t *)iter->dictionary;
+  DictionaryIterator iter_copy = *iter;
+  for (Tuple *tuple = dict_read_first(&iter_copy); tuple; tuple = dict_read_next(&iter_copy)) {
+    uint32_t slot = prv_index_hash(tuple->key, slots_log2);
+    while (storage[slot] != 0) {
+      const Tuple *indexed = (const Tuple *)(base + storage[slot]);
+      if (indexed->key == tuple->key) {
+        break;
+      }
+      slot = (slot + 1) & (num_slots - 1);
+    }
+    if (storage[slot] == 0) {
+      storage[slot] = (const uint8_t *)tuple - base;
+    }
+  }
+  index->slots = storage;
+  index->slots_log2 = slots_log2;
+  return DICT_OK;
+}
+
+Tuple *dict_index_find(const DictionaryIndex *index, const uint32_t key) {
+  if (index->slots == NULL) {
+    return dict_find(&index->iter, key);
+  }
+  const uint8_t *base = (const uint8_t *)index->iter.dictionary;
+  const uint32_t slot_mask = (1u << index->slots_log2) - 1;
+  for (uint32_t slot = prv_index_hash(key, index->slots_log2);
+       index->slots[slot] != 0;
+       slot = (slot + 1) & slot_mask) {
+    Tuple *tuple = (Tuple *)(base + index->slots[slot]);
+    if (tuple->key == key) {
+      return tuple;
+    }
+  }
+  return NULL;
+}
@@ -466,5 +466,46 @@ DictionaryResult dict_merge(DictionaryIterator *dest, uint32_t *dest_max_size_in
 //! @return Pointer to a found Tuple, or NULL if there was no Tuple with the specified key.
 Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key);
 
+//! @internal
+//! Hash index over the Tuples of a dictionary, to find Tuples by key without scanning the whole
+//! dictionary like \ref dict_find() does.
+//! The index refers to Tuples by their offset in the dictionary, so it stays valid for a copy of
+//! the dictionary and when values are updated in place, but it has to be built again when Tuples
+//! are added, removed or change size.
+typedef struct {
+  //! The indexed dictionary
+  DictionaryIterator iter;
+  //! Offsets of the Tuples from the start of the dictionary, by the hash of their keys.
+  //! 0 marks an empty slot. NULL if the index falls back to searching linearly.
+  uint16_t *slots;
+  //! The number of slots is (1 << slots_log2)
+  uint8_t slots_log2;
+} DictionaryIndex;
+
+//! @internal
+//! Calculates the number of bytes of storage needed to index a dictionary.
+//! @param iter Iterator to the dictionary to index
+//! @return The number of bytes to pass to \ref dict_index_init()
+uint32_t dict_index_calc_storage_size(const DictionaryIterator *iter);
+
+//! @internal
+//! Indexes the Tuples of a dictionary. If there are Tuples with the same key, the index finds
+//! the first one, same as \ref dict_find().
+//! @param index The index to initialize
+//! @param iter Iterator to the dictionary to index
+//! @param storage Storage for the index, or NULL for an index that searches linearly
+//! @param storage_size The size of `storage`, see \ref dict_index_calc_storage_size()
+//! @return \ref DICT_OK, \ref DICT_INVALID_ARGS or \ref DICT_NOT_ENOUGH_STORAGE. The index
+//! searches linearly if the storage is too small, so it can still be used.
+DictionaryResult dict_index_init(DictionaryIndex *index, const DictionaryIterator *iter,
+                                 uint16_t *storage, uint32_t storage_size);
+
+//! @internal
+//! Tries to find a Tuple with specified key in an indexed dictionary
+//! @param index The index of the dictionary to search in
+//! @param key The key for which to find a Tuple
+//! @return Pointer to a found Tuple, or NULL if there was no Tuple with the specified key.
+Tuple *dict_index_find(const DictionaryIndex *index, const uint32_t key);
+
 //!   @} // end addtogroup Dictionary
 //! @} // end addtogroup Foundation
@@ -205,3 +205,17 @@ void fake_gatt_client_op_assert_write(BLECharacteristic characteristic,
   free(old_write->value);
   free(old_write);
 }
+
+size_t fake_gatt_client_op_pop_write(uint8_t *value_out, size_t max_length) {
+  if (!s_write_head) {
+    return 0;
+  }
+  cl_assert(s_write_head->value_length <= max_length);
+  const size_t value_length = s_write_head->value_length;
+  memcpy(value_out, s_write_head->value, value_length);
+  Write *old_write = s_write_head;
+  s_write_head = (Write *) list_pop_head(&s_write_head->node);
+  free(old_write->value);
+  free(old_write);
+  return value_length;
+}
@@ -25,3 +25,7 @@ void fake_gatt_client_op_assert_no_write(void);
 void fake_gatt_client_op_assert_write(BLECharacteristic characteristic,
                                       const uint8_t *value, size_t value_length,
                                       GAPLEClient client, bool is_response_required);
+
+//! Takes the oldest write off the list, without asserting anything about it
+//! @return The length of the written value, or 0 if there were no writes
+size_t fake_gatt_client_op_pop_write(uint8_t *value_out, size_t max_length);
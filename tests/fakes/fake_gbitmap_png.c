@@ -10,6 +10,10 @@ GBitmap* gbitmap_create_from_png_data(const uint8_t *png_data, size_t png_data_s
 
 bool gbitmap_init_with_png_data(GBitmap *bitmap, const uint8_t *data, size_t data_size) {return true;}
 
+bool gbitmap_init_with_png_resource(GBitmap *bitmap, ResAppNum app_num, uint32_t resource_id) {
+  return true;
+}
+
 uint8_t gbitmap_png_load_palette(upng_t *upng, GColor8 **palette) {return 0;}
 
 bool gbitmap_png_is_format_supported(upng_t *upng) {return true;}
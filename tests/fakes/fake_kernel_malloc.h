@@ -74,6 +74,10 @@ void* kernel_malloc_check(size_t bytes) {
   return kernel_malloc(bytes);
 }
 
+void* kernel_malloc_check_with_pc(size_t bytes, uintptr_t client_pc) {
+  return kernel_malloc(bytes);
+}
+
 char* kernel_strdup(const char* s) {
   char *r = kernel_malloc_check(strlen(s) + 1);
   if (!r) {
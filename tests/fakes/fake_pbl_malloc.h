@@ -131,6 +131,10 @@ void *task_malloc_check(size_t bytes) {
   return malloc_and_track(bytes, __builtin_return_address(0));
 }
 
+void *task_malloc_check_with_pc(size_t bytes, uintptr_t client_pc) {
+  return malloc_and_track(bytes, (void *)client_pc);
+}
+
 void *task_realloc(void *ptr, size_t bytes) {
   return realloc_and_track(ptr, bytes, __builtin_return_address(0));
 }
@@ -197,6 +201,10 @@ void *kernel_malloc_check(size_t bytes) {
   return malloc_and_track(bytes, __builtin_return_address(0));
 }
 
+void *kernel_malloc_check_with_pc(size_t bytes, uintptr_t client_pc) {
+  return malloc_and_track(bytes, (void *)client_pc);
+}
+
 void *kernel_realloc(void *ptr, size_t bytes) {
   return realloc_and_track(ptr, bytes, __builtin_return_address(0));
 }
@@ -16,6 +16,7 @@
 #include "clar_asserts.h"
 
 #include "pbl/util/list.h"
+#include "pbl/util/math.h"
 
 #include <string.h>
 
@@ -40,6 +41,9 @@ static CommSession *s_session_head;
 static int s_session_close_call_count;
 static int s_session_open_call_count;
 
+static CommSessionCapability s_capabilities = ~0;
+static bool s_send_next_when_full;
+
 bool comm_session_is_valid(const CommSession *session) {
   return list_contains((ListNode *) s_session_head, &session->node);
 }
@@ -58,7 +62,7 @@ static bool prv_find_session_is_system_filter(ListNode *found_node, void *data)
 }
 
 bool comm_session_has_capability(CommSession *session, CommSessionCapability capability){
-  return true;
+  return (s_capabilities & capability) != 0;
 }
 
 CommSession * comm_session_get_by_type(CommSessionType type) {
@@ -150,6 +154,27 @@ void comm_session_send_queue_consume(CommSession *session, size_t length) {
   circular_buffer_consume(&session->send_buffer, length);
 }
 
+size_t comm_session_send_queue_get_segments(CommSession *session, uint32_t start_offset,
+                                            size_t length, SessionSendQueueSegment *segments_out,
+                                            size_t max_segments) {
+  cl_assert(list_contains((const ListNode *) s_session_head, &session->node));
+  const CircularBuffer *buffer = &session->send_buffer;
+  size_t num_segments = 0;
+  while ((start_offset < buffer->data_length) && length && (num_segments < max_segments)) {
+    // The data wraps around the end of the buffer at most once
+    const uint16_t index = (buffer->read_index + start_offset) % buffer->buffer_size;
+    const size_t segment_length = MIN(MIN(buffer->buffer_size - index,
+                                          buffer->data_length - start_offset), length);
+    segments_out[num_segments++] = (const SessionSendQueueSegment) {
+      .data = buffer->buffer + index,
+      .length = segment_length,
+    };
+    start_offset += segment_length;
+    length -= segment_length;
+  }
+  return num_segments;
+}
+
 static void prv_send_next_kernel_bg_cb(void *data) {
   CommSession *session = (CommSession *) data;
   if (!list_contains((const ListNode *) s_session_head, (const ListNode *) session)) {
@@ -203,6 +228,13 @@ SendBuffer * comm_session_send_buffer_begin_write(CommSession *session, uint16_t
   if (!comm_session_is_valid(session)) {
     return NULL;
   }
+  if (s_send_next_when_full &&
+      required_free_length + sizeof(PebbleProtocolHeader) >
+      circular_buffer_get_write_space_remaining(&session->send_buffer) &&
+      comm_session_send_queue_get_length(session)) {
+    // Like the real thing does when it's called from the task that sends
+    session->transport_imp->send_next(session->transport);
+  }
   if (required_free_length + sizeof(PebbleProtocolHeader) >
       circular_buffer_get_write_space_remaining(&session->send_buffer)) {
     return NULL;
@@ -286,6 +318,14 @@ int fake_comm_session_close_call_count(void) {
   return s_session_close_call_count;
 }
 
+void fake_comm_session_set_capabilities(CommSessionCapability capabilities) {
+  s_capabilities = capabilities;
+}
+
+void fake_comm_session_set_send_next_when_full(bool send_next_when_full) {
+  s_send_next_when_full = send_next_when_full;
+}
+
 void fake_comm_session_process_send_next(void) {
   CommSession *session = s_session_head;
   while (session) {
@@ -477,6 +517,8 @@ void fake_comm_session_init(void) {
   s_session_close_call_count = 0;
   s_session_open_call_count = 0;
   s_last_responsiveness_granted_handler = NULL;
+  s_capabilities = ~0;
+  s_send_next_when_full = false;
 }
 
 void fake_comm_session_cleanup(void) {
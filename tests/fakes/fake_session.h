@@ -40,6 +40,13 @@ int fake_comm_session_close_call_count(void);
 
 void fake_comm_session_process_send_next(void);
 
+//! Sets the capabilities comm_session_has_capability() reports, all of them by default
+void fake_comm_session_set_capabilities(CommSessionCapability capabilities);
+
+//! Sets whether comm_session_send_buffer_begin_write() sends out what's queued up when the send
+//! buffer is full, instead of failing right away. Off by default.
+void fake_comm_session_set_send_next_when_full(bool send_next_when_full);
+
 uint32_t fake_comm_session_get_responsiveness_max_period(void);
 uint32_t fake_comm_session_is_latency_reduced(void);
 
@@ -3,6 +3,7 @@
 
 #include "fake_spi_flash.h"
 
+#include "drivers/flash/flash_cache.h"
 #include "flash_region/flash_region.h"
 #include "system/status_codes.h"
 
@@ -21,14 +22,23 @@ typedef struct FakeFlashState {
   uint32_t bytes_left_till_write_failure;
   jmp_buf *jmp_on_failure;
   uint8_t* storage; //! Allocated buffer of length bytes.
+  uint32_t read_count;
   uint32_t write_count;
   uint32_t erase_count;
+  bool read_cache_enabled;
 } FakeFlashState;
 
 static FakeFlashState s_state = { 0 };
 
+static void prv_invalidate_read_cache(uint32_t start_addr, uint32_t length) {
+#ifdef CONFIG_FLASH_READ_CACHE
+  flash_cache_invalidate(start_addr, length);
+#endif
+}
+
 void fake_spi_flash_erase(void) {
   memset(s_state.storage, 0xff, s_state.length);
+  prv_invalidate_read_cache(s_state.offset, s_state.length);
 }
 
 void fake_spi_flash_cleanup(void) {
@@ -75,8 +85,18 @@ void fake_spi_flash_init(uint32_t offset, uint32_t length) {
   // Note: this is a harness failure, not a code failure.
   cl_assert(s_state.storage != NULL);
   memset(s_state.storage, 0xff, length);
+#ifdef CONFIG_FLASH_READ_CACHE
+  flash_cache_init();
+#endif
 }
 
+#ifdef CONFIG_FLASH_READ_CACHE
+void fake_spi_flash_enable_read_cache(bool enable) {
+  flash_cache_init();
+  s_state.read_cache_enabled = enable;
+}
+#endif
+
 void fake_flash_assert_region_untouched(uint32_t start_addr, uint32_t length) {
   if (length == 0) {
     return;
@@ -118,6 +138,7 @@ void fake_spi_flash_populate_from_file(char *path, uint32_t offset) {
 
   // copy file to fake flash storage
   cl_assert(fread(&s_state.storage[fake_offset], 1, st.st_size, file) > 0);
+  prv_invalidate_read_cache(offset, st.st_size);
 }
 
 void fake_spi_flash_force_future_failure(int after_n_bytes, jmp_buf *retire_to) {
@@ -125,18 +146,31 @@ void fake_spi_flash_force_future_failure(int after_n_bytes, jmp_buf *retire_to)
   s_state.jmp_on_failure = retire_to;
 }
 
-void flash_read_bytes(uint8_t* buffer, uint32_t start_addr, uint32_t buffer_size) {
+static void prv_read_bytes(uint8_t* buffer, uint32_t start_addr, uint32_t buffer_size) {
   cl_assert(start_addr >= s_state.offset);
   cl_assert(start_addr + buffer_size <= s_state.offset + s_state.length);
 
+  ++s_state.read_count;
+
   memcpy(buffer, s_state.storage + (start_addr - s_state.offset), buffer_size);
 }
 
+void flash_read_bytes(uint8_t* buffer, uint32_t start_addr, uint32_t buffer_size) {
+#ifdef CONFIG_FLASH_READ_CACHE
+  if (s_state.read_cache_enabled) {
+    flash_cache_read(buffer, start_addr, buffer_size, prv_read_bytes);
+    return;
+  }
+#endif
+  prv_read_bytes(buffer, start_addr, buffer_size);
+}
+
 void flash_write_bytes(const uint8_t* buffer, uint32_t start_addr, uint32_t buffer_size) {
   cl_assert(start_addr >= s_state.offset);
   cl_assert(start_addr + buffer_size <= s_state.offset + s_state.length);
 
   ++s_state.write_count;
+  prv_invalidate_read_cache(start_addr, buffer_size);
 
   for (int i = 0; i < buffer_size; ++i) {
     if (s_state.jmp_on_failure != NULL) {
@@ -168,6 +202,7 @@ static void erase_block(uint32_t block_addr, uint32_t block_size) {
   cl_assert(block_start + block_size <= s_state.offset + s_state.length);
 
   memset(&s_state.storage[block_start - s_state.offset], 0xff, block_size);
+  prv_invalidate_read_cache(block_start, block_size);
 }
 
 void flash_erase_sector_blocking(uint32_t sector_addr) {
@@ -186,6 +221,10 @@ uint32_t flash_get_sector_base_address(uint32_t flash_addr) {
   return (flash_addr & ~(SECTOR_SIZE_BYTES - 1));
 }
 
+uint32_t fake_flash_read_count(void) {
+  return s_state.read_count;
+}
+
 uint32_t fake_flash_write_count(void) {
   return s_state.write_count;
 }
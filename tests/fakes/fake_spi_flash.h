@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <setjmp.h>
 
@@ -30,5 +31,10 @@ void fake_spi_flash_force_future_failure(int after_n_bytes, jmp_buf *retire_to);
 
 void fake_flash_assert_region_untouched(uint32_t start_addr, uint32_t length);
 
+//! Route reads through the flash read cache, like flash_api.c does with CONFIG_FLASH_READ_CACHE.
+//! fake_flash_read_count() then only counts the reads that missed the cache.
+void fake_spi_flash_enable_read_cache(bool enable);
+
+uint32_t fake_flash_read_count(void);
 uint32_t fake_flash_write_count(void);
 uint32_t fake_flash_erase_count(void);
@@ -8,6 +8,9 @@
 #include "pbl/services/app_inbox_service.h"
 #include "pbl/util/list.h"
 
+#include <stdio.h>
+#include <sys/time.h>
+
 extern bool app_inbox_service_has_inbox_for_tag(AppInboxServiceTag tag);
 extern bool app_inbox_service_has_inbox_for_storage(uint8_t *storage);
 extern bool app_inbox_service_is_being_written_for_tag(AppInboxServiceTag tag);
@@ -72,6 +75,13 @@ static void prv_cleanup_callback_events(void) {
   prv_process_callback_events_alt(false /* should_execute_callback */);
 }
 
+static void prv_process_next_callback_event(void) {
+  EventNode *node = s_event_head;
+  s_event_head = (EventNode *)list_pop_head((ListNode *)node);
+  node->event.callback.callback(node->event.callback.data);
+  free(node);
+}
+
 #define assert_num_callback_events(num) \
   cl_assert_equal_i(list_count((ListNode *)s_event_head), num);
 
@@ -584,3 +594,216 @@ void test_app_inbox__app_inbox_service_unregister_by_storage_unknown_storage(voi
   uint8_t storage[BUFFER_SIZE];
   cl_assert_equal_i(app_inbox_service_unregister_by_storage(storage), 0);
 }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Batched inboxes & pinning
+
+//! Same as APP_INBOX_MAX_BATCH_ROUNDS
+#define MAX_BATCH_ROUNDS (8)
+
+static struct {
+  //! Number of messages that still have to be sent after the one being handled, a new one gets
+  //! written when the previous one has been consumed, like the phone does after getting the ACK.
+  int num_to_stream;
+  size_t stream_length;
+  //! Don't consume from the handler, only once all messages of a round have been handled
+  bool should_consume_per_round;
+  bool should_pin_next;
+  const uint8_t *pinned_data;
+  int num_messages;
+  size_t num_bytes;
+  int num_dropped;
+} s_batched;
+
+static uint8_t s_batched_data[64];
+
+static void prv_write_message(const uint8_t *data, size_t length) {
+  cl_assert_equal_b(true, app_inbox_service_begin(AppInboxServiceTagUnitTestBatched,
+                                                  length, s_writer));
+  cl_assert_equal_b(true, app_inbox_service_write(AppInboxServiceTagUnitTestBatched,
+                                                  data, length));
+  cl_assert_equal_b(true, app_inbox_service_end(AppInboxServiceTagUnitTestBatched));
+}
+
+void test_batched_message_handler(const uint8_t *data, size_t length,
+                                  AppInboxConsumerInfo *consumer_info) {
+  ++s_batched.num_messages;
+  s_batched.num_bytes += length;
+  if (s_batched.should_pin_next) {
+    s_batched.should_pin_next = false;
+    s_batched.pinned_data = data;
+    app_inbox_pin(consumer_info);
+  }
+  if (!s_batched.should_consume_per_round) {
+    app_inbox_consume(consumer_info);
+  }
+  if (s_batched.num_to_stream) {
+    --s_batched.num_to_stream;
+    prv_write_message(s_batched_data, s_batched.stream_length);
+  }
+}
+
+void test_batched_dropped_handler(uint32_t num_dropped_messages) {
+  s_batched.num_dropped += num_dropped_messages;
+}
+
+static void prv_create_batched_inbox(size_t buffer_size, uint32_t min_num_messages) {
+  memset(&s_batched, 0, sizeof(s_batched));
+  for (size_t i = 0; i < sizeof(s_batched_data); ++i) {
+    s_batched_data[i] = i;
+  }
+  s_inbox = app_inbox_create_and_register(buffer_size, min_num_messages,
+                                          test_batched_message_handler,
+                                          test_batched_dropped_handler);
+  cl_assert(s_inbox != NULL);
+}
+
+//! Unlike prv_process_callback_events(), this also handles events that get sent while handling
+static int prv_process_callback_events_until_done(void) {
+  int num_events = 0;
+  while (s_event_head) {
+    prv_process_next_callback_event();
+    ++num_events;
+  }
+  return num_events;
+}
+
+void test_app_inbox__batched_handles_messages_completed_while_handling(void) {
+  prv_create_batched_inbox(BUFFER_SIZE, 1);
+  s_batched.num_to_stream = MAX_BATCH_ROUNDS - 1;
+  s_batched.stream_length = BUFFER_SIZE;
+  prv_write_message(s_batched_data, BUFFER_SIZE);
+  assert_num_callback_events(1);
+
+  // The messages written while handling the previous ones are handled in the same callback:
+  cl_assert_equal_i(prv_process_callback_events_until_done(), 1);
+  cl_assert_equal_i(s_batched.num_messages, MAX_BATCH_ROUNDS);
+  cl_assert_equal_i(s_batched.num_bytes, MAX_BATCH_ROUNDS * BUFFER_SIZE);
+
+  // Once done, a new message results in an event again:
+  prv_write_message(s_batched_data, 1);
+  assert_num_callback_events(1);
+  cl_assert_equal_i(prv_process_callback_events_until_done(), 1);
+  cl_assert_equal_i(s_batched.num_messages, MAX_BATCH_ROUNDS + 1);
+}
+
+void test_app_inbox__batched_returns_to_event_loop(void) {
+  prv_create_batched_inbox(BUFFER_SIZE, 1);
+  s_batched.num_to_stream = 2 * MAX_BATCH_ROUNDS;
+  s_batched.stream_length = 1;
+  prv_write_message(s_batched_data, 1);
+
+  // After MAX_BATCH_ROUNDS, the app gets to handle other events. The message that was written in
+  // the last round gets an event of its own:
+  prv_process_next_callback_event();
+  cl_assert_equal_i(s_batched.num_messages, MAX_BATCH_ROUNDS);
+  assert_num_callback_events(1);
+
+  cl_assert_equal_i(prv_process_callback_events_until_done(), 2);
+  cl_assert_equal_i(s_batched.num_messages, 2 * MAX_BATCH_ROUNDS + 1);
+}
+
+void test_app_inbox__batched_reports_drops(void) {
+  prv_create_batched_inbox(BUFFER_SIZE, 1);
+  prv_write_message(s_batched_data, BUFFER_SIZE);
+  cl_assert_equal_b(false, app_inbox_service_begin(AppInboxServiceTagUnitTestBatched,
+                                                   1, s_writer));
+  cl_assert_equal_i(prv_process_callback_events_until_done(), 1);
+  cl_assert_equal_i(s_batched.num_messages, 1);
+  cl_assert_equal_i(s_batched.num_dropped, 1);
+}
+
+void test_app_inbox__batched_frees_up_consumed_space_after_every_round(void) {
+  // Room for two messages of this length, which is all that's needed if the consumed space is
+  // freed up before every round, like it was before consuming lazily:
+  const size_t length = BUFFER_SIZE / 2;
+  prv_create_batched_inbox(2 * length, 2);
+  s_batched.should_consume_per_round = true;
+  s_batched.num_to_stream = 2;
+  s_batched.stream_length = length;
+
+  // A short message is handled while a longer one gets written, which is more data than the
+  // consumed space. The third message only fits if the consumed space is freed up anyway:
+  prv_write_message(s_batched_data, 1);
+  cl_assert_equal_i(prv_process_callback_events_until_done(), 1);
+  cl_assert_equal_i(s_batched.num_messages, 3);
+  cl_assert_equal_i(s_batched.num_dropped, 0);
+}
+
+void test_app_inbox__pinned_message_stays_in_buffer(void) {
+  prv_create_batched_inbox(BUFFER_SIZE, 2);
+  const size_t length = 8;
+
+  s_batched.should_pin_next = true;
+  prv_write_message(s_batched_data, length);
+  prv_process_callback_events_until_done();
+  cl_assert(s_batched.pinned_data);
+
+  // Messages after the pinned one get handled, the pinned one isn't overwritten:
+  prv_write_message(s_batched_data + length, length);
+  prv_process_callback_events_until_done();
+  cl_assert_equal_i(s_batched.num_messages, 2);
+  cl_assert_equal_m(s_batched.pinned_data, s_batched_data, length);
+
+  // ... but their space isn't freed up:
+  cl_assert_equal_b(false, app_inbox_service_begin(AppInboxServiceTagUnitTestBatched,
+                                                   BUFFER_SIZE, s_writer));
+  prv_process_callback_events_until_done();
+  cl_assert_equal_i(s_batched.num_dropped, 1);
+
+  // Releasing it frees up all the consumed space:
+  app_inbox_release(s_inbox);
+  cl_assert_equal_i(prv_process_callback_events_until_done(), 1);
+  cl_assert_equal_i(s_batched.num_messages, 2);
+  prv_write_message(s_batched_data, BUFFER_SIZE);
+  prv_process_callback_events_until_done();
+  cl_assert_equal_i(s_batched.num_messages, 3);
+}
+
+void test_app_inbox__release_without_pin(void) {
+  prv_create_batched_inbox(BUFFER_SIZE, 1);
+  app_inbox_release(s_inbox);
+  assert_num_callback_events(0);
+}
+
+static void prv_measure_throughput(const char *name, bool is_streaming) {
+  const int num_messages = 100000;
+  const size_t length = sizeof(s_batched_data);
+  prv_create_batched_inbox(4 * length, 4);
+  s_batched.stream_length = length;
+
+  struct timeval start;
+  gettimeofday(&start, NULL);
+  int num_events = 0;
+  if (is_streaming) {
+    // Every message gets written while the previous one is being handled:
+    s_batched.num_to_stream = num_messages - 1;
+    prv_write_message(s_batched_data, length);
+    num_events = prv_process_callback_events_until_done();
+  } else {
+    // Every message gets handled before the next one is written:
+    for (int i = 0; i < num_messages; ++i) {
+      prv_write_message(s_batched_data, length);
+      num_events += prv_process_callback_events_until_done();
+    }
+  }
+  struct timeval end;
+  gettimeofday(&end, NULL);
+  const double elapsed_s = (end.tv_sec - start.tv_sec) + ((end.tv_usec - start.tv_usec) / 1e6);
+
+  cl_assert_equal_i(s_batched.num_messages, num_messages);
+  cl_assert_equal_i(s_batched.num_dropped, 0);
+  printf("%s: %d messages of %d bytes, %d callback events, %.0f messages/sec\n",
+         name, num_messages, (int)length, num_events, num_messages / elapsed_s);
+  if (is_streaming) {
+    cl_assert(num_events <= (num_messages / MAX_BATCH_ROUNDS) + 1);
+  } else {
+    cl_assert_equal_i(num_events, num_messages);
+  }
+  app_inbox_destroy_and_deregister(s_inbox);
+}
+
+void test_app_inbox__throughput(void) {
+  prv_measure_throughput("One message per event", false /* is_streaming */);
+  prv_measure_throughput("Streaming", true /* is_streaming */);
+}
@@ -3,6 +3,7 @@
 
 #include "clar.h"
 
+#include "applib/app_inbox.h"
 #include "applib/app_message/app_message_internal.h"
 #include "kernel/events.h"
 #include "system/logging.h"
@@ -149,10 +150,16 @@ static void prv_out_failed_callback(DictionaryIterator *failed,
   cl_assert_equal_b(app_message_is_accepting_outbound(), true);
 }
 
+static bool s_should_pin_received;
+static bool s_pin_result;
+
 static void prv_in_received_callback(DictionaryIterator *received, void *context) {
   cl_assert_equal_p(context, &s_context);
   prv_assert_dict_equal(received, &s_expected_iter);
   s_in_received_is_called = true;
+  if (s_should_pin_received) {
+    s_pin_result = app_message_inbox_pin();
+  }
 }
 
 static void prv_in_dropped_callback(AppMessageResult reason, void *context) {
@@ -361,6 +368,21 @@ void app_inbox_consume(AppInboxConsumerInfo *consumer_info) {
   ++s_app_inbox_consume_call_count;
 }
 
+static int s_app_inbox_pin_call_count;
+void app_inbox_pin(AppInboxConsumerInfo *consumer_info) {
+  ++s_app_inbox_pin_call_count;
+}
+
+static AppInbox *s_app_message_inbox = (AppInbox *) 0x11223344;
+AppInbox **app_state_get_app_message_inbox(void) {
+  return &s_app_message_inbox;
+}
+
+static AppInbox *s_released_app_inbox;
+void app_inbox_release(AppInbox *app_inbox) {
+  s_released_app_inbox = app_inbox;
+}
+
 // Setup
 ////////////////////////////////////
 void test_app_message__initialize(void) {
@@ -373,6 +395,10 @@ void test_app_message__initialize(void) {
 
   s_sys_psleep_last_millis = 0;
   s_app_inbox_consume_call_count = 0;
+  s_app_inbox_pin_call_count = 0;
+  s_released_app_inbox = NULL;
+  s_should_pin_received = false;
+  s_pin_result = false;
 
   app_message_init();
   app_message_set_context(&s_context);
@@ -667,6 +693,26 @@ void test_app_message__receive_happy_case(void) {
   check_in_accepting_again();
 }
 
+void test_app_message__receive_and_pin(void) {
+  prv_set_remote_receive_handler(prv_receive_ack_nack_callback);
+  s_should_pin_received = true;
+  prv_receive_test_data(TEST_TRANSACTION_ID_1, false);
+  cl_assert(s_in_received_is_called);
+  cl_assert_equal_b(s_pin_result, true);
+  cl_assert_equal_i(s_app_inbox_pin_call_count, 1);
+  // Pinned messages are still consumed and ACK'd:
+  cl_assert_equal_i(s_app_inbox_consume_call_count, 1);
+  prv_process_sent_data();
+
+  app_message_inbox_release();
+  cl_assert_equal_p(s_released_app_inbox, s_app_message_inbox);
+}
+
+void test_app_message__pin_outside_of_received_callback(void) {
+  cl_assert_equal_b(app_message_inbox_pin(), false);
+  cl_assert_equal_i(s_app_inbox_pin_call_count, 0);
+}
+
 void test_app_message__receive_dropped_because_buffer_too_small(void) {
   // FIXME:
   // https://pebbletechnology.atlassian.net/browse/PBL-22925
@@ -35,6 +35,7 @@
 #define WILDCARD_CODEPOINT 0x25AF
 
 static FontCache s_font_cache;
+static GlyphCache s_glyph_cache;
 static FontInfo s_font_info;
 
 // The renderer obtains the per-glyph fallback font from fonts_get_fallback_font(), which calls
@@ -65,11 +66,7 @@ void test_text_resources__initialize(void) {
   memset(&s_font_cache, 0, sizeof(s_font_cache));
   s_test_fallback_font = NULL;
 
-  FontCache *font_cache = &s_font_cache;
-  memset(font_cache->cache_keys, 0, sizeof(font_cache->cache_keys));
-  memset(font_cache->cache_data, 0, sizeof(font_cache->cache_data));
-  keyed_circular_cache_init(&font_cache->line_cache, font_cache->cache_keys,
-                            font_cache->cache_data, sizeof(LineCacheData), LINE_CACHE_SIZE);
+  text_resources_init_font_cache(&s_font_cache, &s_glyph_cache);
 
   resource_init();
 }
@@ -286,8 +283,7 @@ void test_text_resources__per_glyph_fallback(void) {
 
   // Fresh cache so the primary negative-cache entry from g0 does not short-circuit.
   memset(&s_font_cache, 0, sizeof(s_font_cache));
-  keyed_circular_cache_init(&s_font_cache.line_cache, s_font_cache.cache_keys,
-                            s_font_cache.cache_data, sizeof(LineCacheData), LINE_CACHE_SIZE);
+  text_resources_init_font_cache(&s_font_cache, &s_glyph_cache);
 
   const uint8_t cjk_bytes[] = {0x00, 0x0C, 0xE2, 0x01, 0x0F, 0x80, 0x30, 0x40, 0x08, 0x10, 0x04,
                                0x08, 0x82, 0xFC, 0xFF, 0x80, 0x00, 0x44, 0x00, 0x26, 0x01, 0x11,
@@ -305,8 +301,7 @@ void test_text_resources__fallback_not_used_when_present(void) {
   // Step 1: capture the primary (GOTHIC_18) 'a' bytes.
   cl_assert(text_resources_init_font(0, RESOURCE_ID_GOTHIC_18, 0, &s_font_info));
   memset(&s_font_cache, 0, sizeof(s_font_cache));
-  keyed_circular_cache_init(&s_font_cache.line_cache, s_font_cache.cache_keys,
-                            s_font_cache.cache_data, sizeof(LineCacheData), LINE_CACHE_SIZE);
+  text_resources_init_font_cache(&s_font_cache, &s_glyph_cache);
 
   const GlyphData *primary_g = text_resources_get_glyph(&s_font_cache, 'a', &s_font_info);
   cl_assert(primary_g != NULL);
@@ -327,8 +322,7 @@ void test_text_resources__fallback_not_used_when_present(void) {
 
   // Fresh cache so there is no stale entry from the primary fetch above.
   memset(&s_font_cache, 0, sizeof(s_font_cache));
-  keyed_circular_cache_init(&s_font_cache.line_cache, s_font_cache.cache_keys,
-                            s_font_cache.cache_data, sizeof(LineCacheData), LINE_CACHE_SIZE);
+  text_resources_init_font_cache(&s_font_cache, &s_glyph_cache);
 
   const GlyphData *fallback_g = text_resources_get_glyph(&s_font_cache, 'a', &s_fallback);
   cl_assert(fallback_g != NULL);
@@ -347,8 +341,7 @@ void test_text_resources__fallback_not_used_when_present(void) {
   // The result must equal the CAPTURED PRIMARY bytes, proving the fallback was not consulted.
   s_test_fallback_font = &s_fallback;
   memset(&s_font_cache, 0, sizeof(s_font_cache));
-  keyed_circular_cache_init(&s_font_cache.line_cache, s_font_cache.cache_keys,
-                            s_font_cache.cache_data, sizeof(LineCacheData), LINE_CACHE_SIZE);
+  text_resources_init_font_cache(&s_font_cache, &s_glyph_cache);
 
   const GlyphData *result_g = text_resources_get_glyph(&s_font_cache, 'a', &s_font_info);
   cl_assert(result_g != NULL);
@@ -454,3 +447,153 @@ void test_text_resources__test_glyph_decompression(void) {
   }
 #endif
 }
+
+// Glyph cache
+////////////////////////////////////
+
+void test_text_resources__glyph_cache_hits(void) {
+  cl_assert(text_resources_init_font(0, RESOURCE_ID_GOTHIC_18, 0, &s_font_info));
+
+  GlyphCacheStats stats;
+  text_resources_get_glyph(&s_font_cache, 'a', &s_font_info);
+  text_resources_get_glyph_cache_stats(&s_font_cache, &stats);
+  cl_assert_equal_i(stats.misses, 1);
+  cl_assert_equal_i(stats.bitmap_misses, 1);
+
+  // Measuring and drawing the glyph again is served from the cache
+  text_resources_get_glyph_horiz_advance(&s_font_cache, 'a', &s_font_info);
+  text_resources_get_glyph(&s_font_cache, 'b', &s_font_info);
+  text_resources_get_glyph(&s_font_cache, 'a', &s_font_info);
+  text_resources_get_glyph_cache_stats(&s_font_cache, &stats);
+  cl_assert_equal_i(stats.hits, 2);
+  cl_assert_equal_i(stats.misses, 2);
+  cl_assert_equal_i(stats.bitmap_hits, 1);
+  cl_assert_equal_i(stats.bitmap_misses, 2);
+
+  text_resources_init_font_cache(&s_font_cache, &s_glyph_cache);
+  text_resources_get_glyph_cache_stats(&s_font_cache, &stats);
+  cl_assert_equal_i(stats.hits + stats.misses + stats.bitmap_hits + stats.bitmap_misses, 0);
+}
+
+// A font cache without a glyph cache reads every glyph it doesn't have in its glyph buffer
+void test_text_resources__no_glyph_cache(void) {
+  cl_assert(text_resources_init_font(0, RESOURCE_ID_GOTHIC_18, 0, &s_font_info));
+
+  static uint8_t s_expected['z' + 1][sizeof(GlyphHeaderData) + CACHE_GLYPH_SIZE];
+  for (Codepoint codepoint = 'a'; codepoint <= 'z'; codepoint++) {
+    const GlyphData *glyph = text_resources_get_glyph(&s_font_cache, codepoint, &s_font_info);
+    cl_assert(glyph);
+    memcpy(s_expected[codepoint], glyph, sizeof(GlyphHeaderData) + glyph_get_size_bytes(glyph));
+  }
+
+  text_resources_init_font_cache(&s_font_cache, NULL);
+  for (Codepoint codepoint = 'a'; codepoint <= 'z'; codepoint++) {
+    const GlyphData *expected = (const GlyphData *)s_expected[codepoint];
+    cl_assert_equal_i(text_resources_get_glyph_horiz_advance(&s_font_cache, codepoint,
+                                                             &s_font_info),
+                      expected->header.horiz_advance);
+    const GlyphData *glyph = text_resources_get_glyph(&s_font_cache, codepoint, &s_font_info);
+    cl_assert(glyph);
+    cl_assert_equal_m(glyph, expected, sizeof(GlyphHeaderData) + glyph_get_size_bytes(glyph));
+  }
+
+  // Missing glyphs still fall back to the wildcard
+  cl_assert(text_resources_get_glyph(&s_font_cache, 0x8888 /* absent */, &s_font_info));
+
+  GlyphCacheStats stats;
+  text_resources_get_glyph_cache_stats(&s_font_cache, &stats);
+  cl_assert_equal_i(stats.hits + stats.misses + stats.bitmap_hits + stats.bitmap_misses, 0);
+}
+
+// Reading more glyphs than the cache holds evicts the least recently used ones, but never the
+// pinned letters and digits of the system fonts. Whatever is evicted, the glyphs stay correct.
+void test_text_resources__glyph_cache_eviction(void) {
+  cl_assert(text_resources_init_font(0, RESOURCE_ID_GOTHIC_18, 0, &s_font_info));
+
+  // What each glyph looks like, read with a fresh cache every time
+  static uint8_t s_expected[0x180][sizeof(GlyphHeaderData) + CACHE_GLYPH_SIZE];
+  for (Codepoint codepoint = ' '; codepoint < ARRAY_LENGTH(s_expected); codepoint++) {
+    text_resources_init_font_cache(&s_font_cache, &s_glyph_cache);
+    const GlyphData *glyph = text_resources_get_glyph(&s_font_cache, codepoint, &s_font_info);
+    cl_assert(glyph);
+    memcpy(s_expected[codepoint], glyph,
+           sizeof(GlyphHeaderData) + glyph_get_size_bytes(glyph));
+  }
+
+  text_resources_init_font_cache(&s_font_cache, &s_glyph_cache);
+  for (int pass = 0; pass < 3; pass++) {
+    for (Codepoint codepoint = ' '; codepoint < ARRAY_LENGTH(s_expected); codepoint++) {
+      const GlyphData *glyph = text_resources_get_glyph(&s_font_cache, codepoint, &s_font_info);
+      cl_assert(glyph);
+      cl_assert_equal_m(glyph, s_expected[codepoint],
+                        sizeof(GlyphHeaderData) + glyph_get_size_bytes(glyph));
+    }
+  }
+
+  GlyphCacheStats stats;
+  text_resources_get_glyph_cache_stats(&s_font_cache, &stats);
+  cl_assert(stats.evictions > 0);
+
+  // The letters and digits read first are still cached
+  const uint32_t misses = stats.misses;
+  const char *pinned = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+  for (const char *c = pinned; *c; c++) {
+    text_resources_get_glyph_horiz_advance(&s_font_cache, *c, &s_font_info);
+  }
+  text_resources_get_glyph_cache_stats(&s_font_cache, &stats);
+  cl_assert_equal_i(stats.misses, misses);
+
+  // Other glyphs aren't pinned and were evicted by the ones read after them
+  text_resources_get_glyph_horiz_advance(&s_font_cache, '!', &s_font_info);
+  text_resources_get_glyph_cache_stats(&s_font_cache, &stats);
+  cl_assert_equal_i(stats.misses, misses + 1);
+}
+
+// Lays out and draws a long notification a number of times, the way scrolling through it does,
+// and reports how many glyph lookups had to go to flash.
+void test_text_resources__glyph_cache_notification_benchmark(void) {
+  static const char *s_title = "Jordan Smith";
+  static const char *s_body =
+      "Hey! Are we still on for dinner tomorrow night? I booked a table for 4 at 7:30pm at the "
+      "new Italian place on Market Street (the one with the wood-fired oven). Sam and Alex said "
+      "they can make it, but Quinn might be 15 minutes late because of a meeting. If you'd rather "
+      "go somewhere else, let me know by 10am so I can cancel. Also, don't forget to bring the "
+      "photos from the trip to Yosemite - everyone wants to see them! Parking is $12 after 6pm, "
+      "so we could share a ride. Call me at 555-0142 when you're free. Thanks, J.";
+
+  FontInfo title_font;
+  memset(&title_font, 0, sizeof(title_font));
+  cl_assert(text_resources_init_font(0, RESOURCE_ID_GOTHIC_24_BOLD, 0, &title_font));
+  cl_assert(text_resources_init_font(0, RESOURCE_ID_GOTHIC_24, 0, &s_font_info));
+
+  const int num_frames = 10;
+  unsigned int num_lookups = 0;
+  for (int frame = 0; frame < num_frames; frame++) {
+    const struct {
+      const char *text;
+      FontInfo *font;
+    } parts[] = { { s_title, &title_font }, { s_body, &s_font_info } };
+    for (unsigned int i = 0; i < ARRAY_LENGTH(parts); i++) {
+      for (const char *c = parts[i].text; *c; c++) {
+        // Layout measures the glyph, then rendering draws it
+        text_resources_get_glyph_horiz_advance(&s_font_cache, *c, parts[i].font);
+        cl_assert(text_resources_get_glyph(&s_font_cache, *c, parts[i].font));
+        num_lookups++;
+      }
+    }
+  }
+
+  GlyphCacheStats stats;
+  text_resources_get_glyph_cache_stats(&s_font_cache, &stats);
+  printf("Notification, %d frames, %u glyphs: metrics %"PRIu32" hits %"PRIu32" misses, "
+         "bitmaps %"PRIu32" hits %"PRIu32" misses, %"PRIu32" evictions\n", num_frames,
+         num_lookups, stats.hits, stats.misses, stats.bitmap_hits, stats.bitmap_misses,
+         stats.evictions);
+
+  cl_assert_equal_i(stats.hits + stats.misses, 2 * num_lookups);
+  cl_assert_equal_i(stats.bitmap_hits + stats.bitmap_misses, num_lookups);
+  // Every glyph of the notification only has its metrics read once
+  cl_assert_equal_i(stats.evictions, 0);
+  cl_assert(stats.misses * 20 < stats.hits);
+  cl_assert(stats.bitmap_misses * 4 < stats.bitmap_hits);
+}
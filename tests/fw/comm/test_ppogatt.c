@@ -3,6 +3,7 @@
 
 #include "comm/ble/kernel_le_client/ppogatt/ppogatt.h"
 #include "comm/ble/kernel_le_client/ppogatt/ppogatt_internal.h"
+#include "comm/ble/gatt_client_operations.h"
 #include "pbl/services/comm_session/session_transport.h"
 #include "pbl/services/regular_timer.h"
 
@@ -23,7 +24,6 @@
 #include "stubs_print.h"
 #include "stubs_prompt.h"
 #include "stubs_rand_ptr.h"
-#include "stubs_rtc.h"
 #include "stubs_serial.h"
 
 // Fakes
@@ -33,6 +33,7 @@
 #include "fake_gatt_client_subscriptions.h"
 #include "fake_new_timer.h"
 #include "fake_pbl_malloc.h"
+#include "fake_rtc.h"
 #include "fake_session.h"
 #include "fake_system_task.h"
 
@@ -98,6 +99,9 @@ extern bool ppogatt_has_client_for_uuid(const Uuid *uuid);
 extern uint32_t ppogatt_client_count(void);
 extern void ppogatt_trigger_rx_ack_send_timeout(void);
 extern TransportDestination ppogatt_get_destination(Transport *transport);
+extern TimerID ppogatt_get_retransmit_timer(Transport *transport);
+extern uint32_t ppogatt_get_retransmit_timeout_ms(Transport *transport);
+extern uint8_t ppogatt_get_congestion_window(Transport *transport);
 
 static const uint8_t s_num_service_instances = 2;
 static BLECharacteristic s_characteristics[s_num_service_instances][PPoGATTCharacteristicNum] = {
@@ -254,9 +258,12 @@ static void prv_assert_sent_reset_complete(BLECharacteristic characteristic) {
   };
 
   if (s_ppogatt_version > 0) {
+    // Small MTUs get a larger TX window:
+    const bool is_small_mtu =
+        (s_mtu_size - 3 /* ATT Header size */ - sizeof(PPoGATTPacket) < GATT_MTU_MINIMUM);
     expected_response.payload = (const PPoGATTResetCompleteClientIDPayloadV1) {
       .ppogatt_max_rx_window = PPOGATT_V1_DESIRED_RX_WINDOW_SIZE,
-      .ppogatt_max_tx_window = PPOGATT_V0_WINDOW_SIZE,
+      .ppogatt_max_tx_window = is_small_mtu ? (PPOGATT_SN_MOD_DIV - 1) : PPOGATT_V0_WINDOW_SIZE,
     };
   }
 
@@ -308,6 +315,7 @@ void test_ppogatt__initialize(void) {
   fake_gatt_client_op_init();
   fake_gatt_client_subscriptions_init();
   regular_timer_init();
+  fake_rtc_init(0, 0);
   fake_comm_session_init();
   ppogatt_create();
 }
@@ -919,75 +927,270 @@ void test_ppogatt__handle_bluetooth_stack_queue_full_and_empty_events(void) {
                        s_short_data_fragment, sizeof(s_short_data_fragment));
 }
 
-void test_ppogatt__retransmit_timed_out_data_packets_all_at_once(void) {
-  test_ppogatt__open_session_when_found_pebble_app();
-  uint8_t sn = 0;
-  Transport *transport = ppogatt_client_for_uuid(&s_meta_v0_system.app_uuid);
+static void prv_fire_retransmit_timer(Transport *transport) {
+  const TimerID timer = ppogatt_get_retransmit_timer(transport);
+  cl_assert(stub_new_timer_is_scheduled(timer));
+  stub_new_timer_fire(timer);
+}
 
-  // Get s_tx_window_size packets in flight:
-  for (sn = 0; sn < s_tx_window_size; ++sn) {
-    cl_assert_equal_b(fake_comm_session_send_buffer_write_raw_by_transport(transport,
-                                                         s_short_data_fragment,
-                                                         sizeof(s_short_data_fragment) - sn), true);
+//! Gets data packets in flight, each one byte shorter than the one before
+static void prv_get_packets_in_flight(Transport *transport, uint8_t first_sn, uint8_t num_packets) {
+  for (uint8_t sn = first_sn; sn < first_sn + num_packets; ++sn) {
+    const size_t length = sizeof(s_short_data_fragment) - (sn % sizeof(s_short_data_fragment));
+    cl_assert_equal_b(fake_comm_session_send_buffer_write_raw_by_transport(
+        transport, s_short_data_fragment, length), true);
     ppogatt_send_next(transport);
     prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], sn,
-                         s_short_data_fragment, sizeof(s_short_data_fragment) - sn);
+                         s_short_data_fragment, length);
   }
+}
 
-  // Simulate the regular timer firing a bunch of times to expire the timeout for all the packets:
-  for (int i = 0; i < PPOGATT_TIMEOUT_TICKS; ++i) {
-    regular_timer_fire_seconds(PPOGATT_TIMEOUT_TICK_INTERVAL_SECS);
-  }
+void test_ppogatt__retransmit_timed_out_data_packets_with_same_fragmentation(void) {
+  test_ppogatt__open_session_when_found_pebble_app();
+  uint8_t sn = 0;
+  Transport *transport = ppogatt_client_for_uuid(&s_meta_v0_system.app_uuid);
 
+  // Get s_tx_window_size packets in flight:
+  prv_get_packets_in_flight(transport, 0, s_tx_window_size);
+
+  prv_fire_retransmit_timer(transport);
   fake_comm_session_process_send_next();
 
+  // The time-out collapses the congestion window, only the oldest packet is retransmitted:
+  cl_assert_equal_i(ppogatt_get_congestion_window(transport), 1);
+  prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], 0 /* sn */,
+                       s_short_data_fragment, sizeof(s_short_data_fragment));
+  fake_gatt_client_op_assert_no_write();
+
+  // The server only Acks the retransmitted packet, it didn't get the ones after it either:
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], 0 /* sn */);
+
   // The data should *NOT* get concatenated in a single packet, even though it might fit. The
   // fragmentation should be the same as the previous transmission pass, because there is a race
   // condition where there are Ack(s) in flight for the "original" data packets. Because we're
   // using the same SNs, we cannot change the fragmentation, because we cannot know whether they
   // would refer to the old or new fragmentation.
+  // The packets go out as fast as the congestion window opens up again:
+  for (sn = 1; sn < 3; ++sn) {
+    prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], sn /* sn */,
+                         s_short_data_fragment, sizeof(s_short_data_fragment) - sn);
+  }
+  fake_gatt_client_op_assert_no_write();
 
-  for (sn = 0; sn < s_tx_window_size; ++sn) {
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], 2 /* sn */);
+  for (sn = 3; sn < s_tx_window_size; ++sn) {
     prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], sn /* sn */,
                          s_short_data_fragment, sizeof(s_short_data_fragment) - sn);
   }
+  fake_gatt_client_op_assert_no_write();
 }
 
-void test_ppogatt__retransmit_timed_out_data_packets_first_but_not_later_ones(void) {
+void test_ppogatt__selective_retransmit_when_server_held_on_to_later_packets(void) {
+  if (s_ppogatt_version == 0) {
+    // Selective retransmit is one of the enhanced throughput features
+    return;
+  }
   test_ppogatt__open_session_when_found_pebble_app();
-  uint8_t sn = 0;
   Transport *transport = ppogatt_client_for_uuid(&s_meta_v0_system.app_uuid);
 
-  // Get s_tx_window_size packets in flight:
-  uint8_t secs_passed = 0;
-  for (sn = 0; sn < s_tx_window_size; ++sn) {
-    cl_assert_equal_b(fake_comm_session_send_buffer_write_raw_by_transport(transport,
-                                                         s_short_data_fragment,
-                                                         sizeof(s_short_data_fragment) - sn), true);
-    ppogatt_send_next(transport);
-    prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], sn,
-                         s_short_data_fragment, sizeof(s_short_data_fragment) - sn);
-    if (sn == 0 || sn == 1) {
-      // Make the first and second packet time out each, one second earlier
-      // than the 3rd and 4rd packets:
-      regular_timer_fire_seconds(PPOGATT_TIMEOUT_TICK_INTERVAL_SECS);
-      ++secs_passed;
-    }
-    cl_assert(secs_passed < PPOGATT_TIMEOUT_TICKS);
+  // Get s_tx_window_size packets in flight, pretend sn=0 and sn=2 got lost in the ether:
+  prv_get_packets_in_flight(transport, 0, s_tx_window_size);
+
+  prv_fire_retransmit_timer(transport);
+  fake_comm_session_process_send_next();
+  prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], 0 /* sn */,
+                       s_short_data_fragment, sizeof(s_short_data_fragment));
+  fake_gatt_client_op_assert_no_write();
+
+  // The server held on to sn=1, so the Ack covers it too. Only sn=2 is missing still:
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], 1 /* sn */);
+  prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], 2 /* sn */,
+                       s_short_data_fragment, sizeof(s_short_data_fragment) - 2);
+  fake_gatt_client_op_assert_no_write();
+
+  // The server held on to the rest as well:
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], s_tx_window_size - 1);
+  fake_gatt_client_op_assert_no_write();
+
+  // New data goes out right after:
+  prv_get_packets_in_flight(transport, s_tx_window_size, 1);
+  fake_gatt_client_op_assert_no_write();
+}
+
+void test_ppogatt__fast_retransmit_after_duplicate_acks(void) {
+  if (s_ppogatt_version == 0) {
+    // Fast retransmit relies on selective retransmit, one of the enhanced throughput features
+    return;
   }
+  test_ppogatt__open_session_when_found_pebble_app();
+  Transport *transport = ppogatt_client_for_uuid(&s_meta_v0_system.app_uuid);
+  prv_get_packets_in_flight(transport, 0, 1);
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], 0 /* sn */);
 
-  // Simulate the regular timer firing a bunch of times to expire the timeout for the in-flight packets
-  // This will trigger a retransmit of the un-acked packets
-  for (int i = 0; i < PPOGATT_TIMEOUT_TICKS - 1; ++i) {
-    regular_timer_fire_seconds(PPOGATT_TIMEOUT_TICK_INTERVAL_SECS);
+  // Pretend sn=1 got lost in the ether, the server Acks sn=0 again for each packet after it:
+  const uint8_t num_packets = ppogatt_get_congestion_window(transport);
+  prv_get_packets_in_flight(transport, 1, num_packets);
+  for (int i = 0; i < PPOGATT_FAST_RETRANSMIT_DUPLICATE_ACKS - 1; ++i) {
+    prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], 0 /* sn */);
+    fake_gatt_client_op_assert_no_write();
+  }
+
+  // Retransmitted without waiting for the timeout, the window is halved:
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], 0 /* sn */);
+  prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], 1 /* sn */,
+                       s_short_data_fragment, sizeof(s_short_data_fragment) - 1);
+  fake_gatt_client_op_assert_no_write();
+  cl_assert_equal_i(ppogatt_get_congestion_window(transport), num_packets / 2);
+
+  // More duplicate Acks don't retransmit it again:
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], 0 /* sn */);
+  fake_gatt_client_op_assert_no_write();
+
+  // The server held on to the rest, new data goes out right after:
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], num_packets /* sn */);
+  fake_gatt_client_op_assert_no_write();
+  prv_get_packets_in_flight(transport, num_packets + 1, 1);
+}
+
+void test_ppogatt__retransmit_timeout_estimated_from_round_trip_times(void) {
+  test_ppogatt__open_session_when_found_pebble_app();
+  Transport *transport = ppogatt_client_for_uuid(&s_meta_v0_system.app_uuid);
+  const TimerID timer = ppogatt_get_retransmit_timer(transport);
+
+  cl_assert_equal_i(ppogatt_get_retransmit_timeout_ms(transport), PPOGATT_INITIAL_RTO_MS);
+  prv_get_packets_in_flight(transport, 0, 1);
+  cl_assert_equal_i(stub_new_timer_timeout(timer), PPOGATT_INITIAL_RTO_MS);
+
+  // The first round trip time sets the mean to it, the deviation to half of it:
+  fake_rtc_increment_ticks(RTC_TICKS_HZ);
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], 0 /* sn */);
+  cl_assert_equal_i(ppogatt_get_retransmit_timeout_ms(transport), 1000 + 4 * 500);
+
+  prv_get_packets_in_flight(transport, 1, 1);
+  fake_rtc_increment_ticks(RTC_TICKS_HZ);
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], 1 /* sn */);
+  cl_assert_equal_i(ppogatt_get_retransmit_timeout_ms(transport), 1000 + 4 * ((3 * 500) / 4));
+
+  // A fast link brings it down to the minimum:
+  uint8_t sn;
+  for (sn = 2; sn < 50; ++sn) {
+    prv_get_packets_in_flight(transport, sn, 1);
+    fake_rtc_increment_ticks(RTC_TICKS_HZ / 20);
+    prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], sn);
   }
+  cl_assert_equal_i(ppogatt_get_retransmit_timeout_ms(transport), PPOGATT_MIN_RTO_MS);
+  prv_get_packets_in_flight(transport, sn, 1);
+  cl_assert_equal_i(stub_new_timer_timeout(timer), PPOGATT_MIN_RTO_MS);
+}
 
+void test_ppogatt__retransmitted_packets_are_not_timed(void) {
+  test_ppogatt__open_session_when_found_pebble_app();
+  Transport *transport = ppogatt_client_for_uuid(&s_meta_v0_system.app_uuid);
+
+  prv_get_packets_in_flight(transport, 0, 1);
+  fake_rtc_increment_ticks(PPOGATT_INITIAL_RTO_MS * RTC_TICKS_HZ / 1000);
+  prv_fire_retransmit_timer(transport);
   fake_comm_session_process_send_next();
+  prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], 0 /* sn */,
+                       s_short_data_fragment, sizeof(s_short_data_fragment));
 
-  for (sn = 0; sn < s_tx_window_size; ++sn) {
-    prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], sn /* sn */,
-                         s_short_data_fragment, sizeof(s_short_data_fragment) - sn);
+  // The timeout backs off:
+  const uint32_t backed_off_rto_ms = MIN(2 * PPOGATT_INITIAL_RTO_MS, PPOGATT_MAX_RTO_MS);
+  cl_assert_equal_i(ppogatt_get_retransmit_timeout_ms(transport), backed_off_rto_ms);
+
+  // The Ack could be for either transmission, so it doesn't say anything about the round trip:
+  fake_rtc_increment_ticks(RTC_TICKS_HZ / 10);
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], 0 /* sn */);
+  cl_assert_equal_i(ppogatt_get_retransmit_timeout_ms(transport), backed_off_rto_ms);
+
+  // The next packet is timed again:
+  prv_get_packets_in_flight(transport, 1, 1);
+  fake_rtc_increment_ticks(RTC_TICKS_HZ);
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], 1 /* sn */);
+  cl_assert_equal_i(ppogatt_get_retransmit_timeout_ms(transport), 1000 + 4 * 500);
+}
+
+static uint16_t prv_max_payload_size(void) {
+  return s_mtu_size - 3 /* ATT Header size */ - sizeof(PPoGATTPacket);
+}
+
+static void prv_queue_full_packets(Transport *transport, uint32_t num_packets) {
+  const uint16_t max_payload_size = prv_max_payload_size();
+  uint8_t data[max_payload_size];
+  memset(data, 0x55, max_payload_size);
+  for (uint32_t i = 0; i < num_packets; ++i) {
+    cl_assert_equal_b(fake_comm_session_send_buffer_write_raw_by_transport(transport, data,
+                                                                           max_payload_size),
+                      true);
+  }
+}
+
+//! Lets the queued data go out, as far as the window allows
+//! @return The number of packets sent
+static uint32_t prv_flush_packets(Transport *transport, uint8_t *sn_in_out) {
+  ppogatt_send_next(transport);
+  // prv_send_next_packets() only sends so many packets at a time, let it continue:
+  for (int i = 0; i < PPOGATT_SN_MOD_DIV; ++i) {
+    fake_comm_session_process_send_next();
+  }
+
+  uint32_t num_sent = 0;
+  uint8_t packet[sizeof(PPoGATTPacket) + prv_max_payload_size()];
+  while (fake_gatt_client_op_pop_write(packet, sizeof(packet))) {
+    cl_assert_equal_i(((PPoGATTPacket *)packet)->sn, *sn_in_out % PPOGATT_SN_MOD_DIV);
+    ++*sn_in_out;
+    ++num_sent;
   }
+  return num_sent;
+}
+
+void test_ppogatt__congestion_window_grows_on_acks_and_shrinks_on_timeout(void) {
+  if (s_ppogatt_version == 0) {
+    // A TX window larger than the initial congestion window is one of the enhanced throughput
+    // features
+    return;
+  }
+  // A small MTU gets a larger TX window negotiated:
+  s_mtu_size = GATT_MTU_MINIMUM;
+  test_ppogatt__open_session_when_found_pebble_app();
+  Transport *transport = ppogatt_client_for_uuid(&s_meta_v0_system.app_uuid);
+  const uint32_t tx_window_size = s_tx_window_size;
+  cl_assert(tx_window_size > 2 * PPOGATT_INITIAL_CONGESTION_WINDOW);
+
+  // Slow start, the window doubles with every window of packets Ack'd, up to the TX window:
+  uint8_t sn = 0;
+  uint32_t window = PPOGATT_INITIAL_CONGESTION_WINDOW;
+  while (true) {
+    cl_assert_equal_i(ppogatt_get_congestion_window(transport), window);
+    if (window == tx_window_size) {
+      break;
+    }
+    prv_queue_full_packets(transport, window);
+    cl_assert_equal_i(prv_flush_packets(transport, &sn), window);
+    prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], sn - 1);
+    window = MIN(2 * window, tx_window_size);
+  }
+
+  // No more packets than the window go out:
+  prv_queue_full_packets(transport, tx_window_size + 1);
+  cl_assert_equal_i(prv_flush_packets(transport, &sn), tx_window_size);
+
+  // A time-out halves the threshold and starts over with a single packet:
+  prv_fire_retransmit_timer(transport);
+  cl_assert_equal_i(ppogatt_get_congestion_window(transport), 1);
+  fake_comm_session_process_send_next();
+  fake_gatt_client_op_clear_write_list();
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], sn - 1);
+  const uint32_t threshold = tx_window_size / 2;
+  cl_assert_equal_i(ppogatt_get_congestion_window(transport), threshold);
+  cl_assert_equal_i(prv_flush_packets(transport, &sn), 1);
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], sn - 1);
+
+  // Past the threshold, the window grows by one packet per window of packets Ack'd:
+  prv_queue_full_packets(transport, threshold);
+  cl_assert_equal_i(prv_flush_packets(transport, &sn), threshold);
+  prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], sn - 1);
+  cl_assert_equal_i(ppogatt_get_congestion_window(transport), threshold + 1);
 }
 
 void test_ppogatt__retransmit_timed_out_data_packets_race_everything_acked_at_once(void) {
@@ -1005,12 +1208,10 @@ void test_ppogatt__retransmit_timed_out_data_packets_race_everything_acked_at_on
                          s_short_data_fragment, sizeof(s_short_data_fragment) - sn);
   }
 
-  // Time-out all packets in flight, rolling back for retransmission:
-  for (int i = 0; i < PPOGATT_TIMEOUT_TICKS; ++i) {
-    regular_timer_fire_seconds(PPOGATT_TIMEOUT_TICK_INTERVAL_SECS);
-  }
+  // Time-out the packets in flight, for retransmission:
+  prv_fire_retransmit_timer(transport);
 
-  // Simulate receiving an ack for the last, after the roll-back, but before the packets are
+  // Simulate receiving an ack for the last, after the time-out, but before the packets are
   // retransmitted (the last part shouldn't matter much, but simplifies the test a bit)
   prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData],
                   (sn - 1) % PPOGATT_SN_MOD_DIV);
@@ -1026,6 +1227,7 @@ void test_ppogatt__retransmit_timed_out_data_packets_race_everything_acked_at_on
   // (They all got considered Ack'd by the one Ack)
   prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], sn /* sn */,
                        s_short_data_fragment, sizeof(s_short_data_fragment) - sn);
+  fake_gatt_client_op_assert_no_write();
 }
 
 void test_ppogatt__retransmit_max_number_of_times(void) {
@@ -1041,51 +1243,46 @@ void test_ppogatt__retransmit_max_number_of_times(void) {
   prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], sn,
                        s_short_data_fragment, sizeof(s_short_data_fragment) - sn);
 
-  for (int j = 0; j < PPOGATT_TIMEOUT_COUNT_MAX - 1; ++j) {
-    // Time-out the packet over and over until (max - 1) is reached:
-    for (int i = 0; i < PPOGATT_TIMEOUT_TICKS; ++i) {
-      regular_timer_fire_seconds(PPOGATT_TIMEOUT_TICK_INTERVAL_SECS);
+  // Time-out the packet over and over, until the timeout is backed off all the way and
+  // (max - 1) is reached:
+  int num_timeouts_at_max_rto = 0;
+  while (num_timeouts_at_max_rto < PPOGATT_TIMEOUT_COUNT_MAX - 1) {
+    const uint32_t rto_ms = ppogatt_get_retransmit_timeout_ms(transport);
+    if (rto_ms >= PPOGATT_MAX_RTO_MS) {
+      ++num_timeouts_at_max_rto;
     }
+    prv_fire_retransmit_timer(transport);
     fake_comm_session_process_send_next();
     prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], sn,
                          s_short_data_fragment, sizeof(s_short_data_fragment) - sn);
+    cl_assert_equal_i(ppogatt_get_retransmit_timeout_ms(transport),
+                      MIN(2 * rto_ms, PPOGATT_MAX_RTO_MS));
   }
 
   // The last straw:
-  for (int i = 0; i < PPOGATT_TIMEOUT_TICKS; ++i) {
-    regular_timer_fire_seconds(PPOGATT_TIMEOUT_TICK_INTERVAL_SECS);
-  }
+  prv_fire_retransmit_timer(transport);
   prv_assert_sent_reset_request(s_characteristics[0][PPoGATTCharacteristicData]);
 }
 
 void test_ppogatt__make_sure_timeout_reset_after_data_ack(void) {
   test_ppogatt__open_session_when_found_pebble_app();
   Transport *transport = ppogatt_client_for_uuid(&s_meta_v0_system.app_uuid);
+  const TimerID timer = ppogatt_get_retransmit_timer(transport);
 
   uint8_t num_packets = s_tx_window_size;
+  prv_get_packets_in_flight(transport, 0, num_packets);
 
-  // Get a packet in flight:
-  for (int sn = 0; sn < num_packets; sn++) {
-    cl_assert_equal_b(
-        fake_comm_session_send_buffer_write_raw_by_transport(
-        transport, s_short_data_fragment, sizeof(s_short_data_fragment) - sn), true);
-    ppogatt_send_next(transport);
-  }
-
+  // Each Ack restarts the time-out for the packets still in flight, the last one stops it:
   for (int sn = 0; sn < num_packets; sn++) {
-    for (int i = 0; i < (PPOGATT_TIMEOUT_TICKS - 1); ++i) {
-      regular_timer_fire_seconds(PPOGATT_TIMEOUT_TICK_INTERVAL_SECS);
-    }
-
+    cl_assert(stub_new_timer_is_scheduled(timer));
+    const int num_start_calls = s_num_new_timer_start_calls;
     prv_receive_ack(s_characteristics[0][PPoGATTCharacteristicData], sn /* sn */);
+    if (sn < num_packets - 1) {
+      cl_assert_equal_i(s_num_new_timer_start_calls, num_start_calls + 1);
+      cl_assert_equal_i(s_new_timer_start_param_timer_id, timer);
+    }
   }
-
-  fake_comm_session_process_send_next();
-
-  for (int sn = 0; sn < num_packets; sn++) {
-    prv_assert_sent_data(s_characteristics[0][PPoGATTCharacteristicData], sn,
-                         s_short_data_fragment, sizeof(s_short_data_fragment) - sn);
-  }
+  cl_assert(!stub_new_timer_is_scheduled(timer));
 
   // There should be no writes we haven't already checked for. That would only happen if we timed
   // out!
@@ -1145,3 +1342,258 @@ void test_ppogatt__mtu_zero_due_to_service_rediscovery_while_resetting(void) {
 void test_ppogatt__unsubcribe_when_no_memory_for_comm_session(void) {
   // TODO
 }
+
+// Simulation
+///////////////////////////////////////////////////////////
+
+//! A link to the server that loses packets and Acks on the way
+typedef struct {
+  const char *name;
+  uint32_t loss_percent;
+  //! One way latency
+  uint32_t latency_ms;
+  //! Time a packet takes up the link
+  uint32_t packet_time_ms;
+  //! Whether the server holds on to packets that arrive after a lost one
+  bool is_server_holding_on_to_packets;
+} SimLink;
+
+typedef struct {
+  uint32_t arrival_ms;
+  uint16_t length;
+  uint8_t value[sizeof(PPoGATTPacket) + MAX_PAYLOAD_SIZE];
+} SimPacket;
+
+#define SIM_QUEUE_SIZE (64)
+
+typedef struct {
+  SimPacket packets[SIM_QUEUE_SIZE];
+  uint32_t head;
+  uint32_t tail;
+} SimQueue;
+
+typedef struct {
+  uint32_t goodput_bytes_per_sec;
+  uint32_t num_packets_sent;
+  uint32_t num_timeouts;
+} SimResult;
+
+static uint32_t s_sim_random;
+
+static bool prv_sim_is_lost(const SimLink *link) {
+  s_sim_random = s_sim_random * 1103515245 + 12345;
+  return ((s_sim_random >> 16) % 100) < link->loss_percent;
+}
+
+static uint8_t prv_sim_stream_byte(uint32_t index) {
+  return (index * 7) + (index >> 8);
+}
+
+static void prv_sim_queue_push(SimQueue *queue, uint32_t arrival_ms, const uint8_t *value,
+                               uint16_t length) {
+  cl_assert(queue->tail - queue->head < SIM_QUEUE_SIZE);
+  SimPacket *packet = &queue->packets[queue->tail++ % SIM_QUEUE_SIZE];
+  packet->arrival_ms = arrival_ms;
+  packet->length = length;
+  memcpy(packet->value, value, length);
+}
+
+static SimPacket *prv_sim_queue_peek(SimQueue *queue) {
+  return (queue->head == queue->tail) ? NULL : &queue->packets[queue->head % SIM_QUEUE_SIZE];
+}
+
+//! The server side: delivers the data in order and Acks the last packet it delivered
+typedef struct {
+  uint8_t next_expected_sn;
+  uint32_t num_bytes_received;
+  //! Packets that arrived after a lost one, if the server holds on to them
+  bool is_held[PPOGATT_SN_MOD_DIV];
+  SimPacket held[PPOGATT_SN_MOD_DIV];
+} SimServer;
+
+static void prv_sim_server_deliver(SimServer *server, const SimPacket *packet) {
+  const PPoGATTPacket *data = (const PPoGATTPacket *)packet->value;
+  for (uint16_t i = 0; i < packet->length - sizeof(PPoGATTPacket); ++i) {
+    cl_assert_equal_i(data->payload[i], prv_sim_stream_byte(server->num_bytes_received++));
+  }
+  server->next_expected_sn = (server->next_expected_sn + 1) % PPOGATT_SN_MOD_DIV;
+}
+
+static void prv_sim_server_receive(SimServer *server, const SimLink *link,
+                                   const SimPacket *packet) {
+  const PPoGATTPacket *data = (const PPoGATTPacket *)packet->value;
+  cl_assert_equal_i(data->type, PPoGATTPacketTypeData);
+  const uint32_t distance =
+      (PPOGATT_SN_MOD_DIV + data->sn - server->next_expected_sn) % PPOGATT_SN_MOD_DIV;
+  if (distance == 0) {
+    prv_sim_server_deliver(server, packet);
+    while (server->is_held[server->next_expected_sn]) {
+      server->is_held[server->next_expected_sn] = false;
+      prv_sim_server_deliver(server, &server->held[server->next_expected_sn]);
+    }
+  } else if (distance < (uint32_t)s_tx_window_size && link->is_server_holding_on_to_packets) {
+    server->is_held[data->sn] = true;
+    server->held[data->sn] = *packet;
+  }
+}
+
+//! Runs a transfer till the data is received and the link is idle again
+static SimResult prv_simulate_transfer(const SimLink *link, SimServer *server,
+                                       uint32_t num_bytes) {
+  Transport *transport = ppogatt_client_for_uuid(&s_meta_v0_system.app_uuid);
+  const TimerID timer = ppogatt_get_retransmit_timer(transport);
+  const BLECharacteristic characteristic = s_characteristics[0][PPoGATTCharacteristicData];
+  s_sim_random = 1;
+
+  SimQueue *to_server = calloc(1, sizeof(SimQueue));
+  SimQueue *to_client = calloc(1, sizeof(SimQueue));
+  SimResult result = {};
+  server->num_bytes_received = 0;
+  uint32_t now_ms = 0;
+  uint32_t received_ms = 0;
+  uint32_t link_free_ms = 0;
+  uint32_t num_bytes_queued = 0;
+  bool has_deadline = false;
+  uint32_t deadline_ms = 0;
+  int num_timer_start_calls = s_num_new_timer_start_calls;
+
+  while (true) {
+    cl_assert(now_ms < 10 * 60 * 1000);
+
+    // The app keeps the send buffer full:
+    while (num_bytes_queued < num_bytes) {
+      uint8_t chunk[100];
+      const uint32_t chunk_size = MIN(sizeof(chunk), num_bytes - num_bytes_queued);
+      for (uint32_t i = 0; i < chunk_size; ++i) {
+        chunk[i] = prv_sim_stream_byte(num_bytes_queued + i);
+      }
+      if (!fake_comm_session_send_buffer_write_raw_by_transport(transport, chunk, chunk_size)) {
+        break;
+      }
+      num_bytes_queued += chunk_size;
+    }
+    ppogatt_send_next(transport);
+    fake_comm_session_process_send_next();
+
+    // Put the packets that got written on the link:
+    uint8_t value[sizeof(PPoGATTPacket) + MAX_PAYLOAD_SIZE];
+    uint16_t length;
+    while ((length = fake_gatt_client_op_pop_write(value, sizeof(value)))) {
+      ++result.num_packets_sent;
+      link_free_ms = MAX(link_free_ms, now_ms) + link->packet_time_ms;
+      if (!prv_sim_is_lost(link)) {
+        prv_sim_queue_push(to_server, link_free_ms + link->latency_ms, value, length);
+      }
+    }
+
+    // Keep track of when the retransmit timer is going to fire:
+    if (s_num_new_timer_start_calls != num_timer_start_calls &&
+        s_new_timer_start_param_timer_id == timer) {
+      deadline_ms = now_ms + s_new_timer_start_param_timeout_ms;
+    }
+    num_timer_start_calls = s_num_new_timer_start_calls;
+    has_deadline = stub_new_timer_is_scheduled(timer);
+
+    // Advance to the next event:
+    SimPacket *to_server_packet = prv_sim_queue_peek(to_server);
+    SimPacket *to_client_packet = prv_sim_queue_peek(to_client);
+    if (!to_server_packet && !to_client_packet && !has_deadline) {
+      break;
+    }
+    uint32_t next_ms = UINT32_MAX;
+    if (to_server_packet) {
+      next_ms = MIN(next_ms, to_server_packet->arrival_ms);
+    }
+    if (to_client_packet) {
+      next_ms = MIN(next_ms, to_client_packet->arrival_ms);
+    }
+    if (has_deadline) {
+      next_ms = MIN(next_ms, deadline_ms);
+    }
+    cl_assert(next_ms != UINT32_MAX);
+    fake_rtc_increment_ticks((uint64_t)(next_ms - now_ms) * RTC_TICKS_HZ / 1000);
+    now_ms = next_ms;
+
+    if (to_server_packet && to_server_packet->arrival_ms == now_ms) {
+      prv_sim_server_receive(server, link, to_server_packet);
+      if (server->num_bytes_received == num_bytes && !received_ms) {
+        received_ms = now_ms;
+      }
+      ++to_server->head;
+      const PPoGATTPacket ack = {
+        .sn = (server->next_expected_sn + PPOGATT_SN_MOD_DIV - 1) % PPOGATT_SN_MOD_DIV,
+        .type = PPoGATTPacketTypeAck,
+      };
+      if (server->num_bytes_received && !prv_sim_is_lost(link)) {
+        prv_sim_queue_push(to_client, now_ms + link->latency_ms, (const uint8_t *)&ack,
+                           sizeof(ack));
+      }
+    } else if (to_client_packet && to_client_packet->arrival_ms == now_ms) {
+      prv_receive_ack(characteristic, ((PPoGATTPacket *)to_client_packet->value)->sn);
+      ++to_client->head;
+    } else {
+      ++result.num_timeouts;
+      stub_new_timer_fire(timer);
+      fake_comm_session_process_send_next();
+    }
+  }
+
+  // The transfer didn't get reset:
+  cl_assert_equal_i(fake_comm_session_close_call_count(), 0);
+  cl_assert_equal_i(server->num_bytes_received, num_bytes);
+  result.goodput_bytes_per_sec = (uint64_t)num_bytes * 1000 / received_ms;
+
+  free(to_server);
+  free(to_client);
+  return result;
+}
+
+void test_ppogatt__simulate_goodput_over_lossy_link(void) {
+  if (s_ppogatt_version > 0) {
+    // A small MTU gets a larger TX window negotiated with the enhanced throughput features. Keep
+    // it at half the SN range, so the simulated server can tell retransmissions from new packets:
+    s_mtu_size = GATT_MTU_MINIMUM;
+    s_tx_window_size = s_rx_window_size = PPOGATT_SN_MOD_DIV / 2;
+    free(s_client_reset_complete);
+    prv_create_expected_reset_complete();
+  }
+  test_ppogatt__open_session_when_found_pebble_app();
+  Transport *transport = ppogatt_client_for_uuid(&s_meta_v0_system.app_uuid);
+
+  const SimLink links[] = {
+    { "lossless", 0, 40, 5, false },
+    { "2% loss", 2, 40, 5, false },
+    { "10% loss", 10, 40, 5, false },
+    { "2% loss, holding server", 2, 40, 5, true },
+    { "10% loss, holding server", 10, 40, 5, true },
+  };
+  const uint32_t num_bytes = 16 * 1024;
+  SimServer *server = calloc(1, sizeof(SimServer));
+  SimResult results[ARRAY_LENGTH(links)];
+  printf("\nPPoGATT v%d, TX window %d, %d byte payloads, %"PRIu32" bytes sent:\n",
+         s_ppogatt_version, s_tx_window_size, prv_max_payload_size(), num_bytes);
+  for (size_t i = 0; i < ARRAY_LENGTH(links); ++i) {
+    results[i] = prv_simulate_transfer(&links[i], server, num_bytes);
+    printf("  %-26s goodput %5"PRIu32" B/s, %4"PRIu32" packets sent, %3"PRIu32" timeouts, "
+           "RTO %4"PRIu32" ms, window %d\n",
+           links[i].name, results[i].goodput_bytes_per_sec, results[i].num_packets_sent,
+           results[i].num_timeouts, ppogatt_get_retransmit_timeout_ms(transport),
+           ppogatt_get_congestion_window(transport));
+  }
+  free(server);
+
+  // Without loss, the window fills the link:
+  cl_assert_equal_i(results[0].num_timeouts, 0);
+  const uint32_t round_trip_ms = 2 * links[0].latency_ms + links[0].packet_time_ms;
+  const uint32_t window_goodput =
+      (uint64_t)s_tx_window_size * prv_max_payload_size() * 1000 / round_trip_ms;
+  cl_assert(results[0].goodput_bytes_per_sec >= window_goodput / 2);
+
+  // The round trip times got measured, a loss costs a fraction of the initial timeout. The goodput
+  // degrades gradually with the loss rate:
+  cl_assert(ppogatt_get_retransmit_timeout_ms(transport) < PPOGATT_INITIAL_RTO_MS);
+  for (size_t i = 1; i < ARRAY_LENGTH(links); ++i) {
+    cl_assert(results[i].goodput_bytes_per_sec >=
+              results[0].goodput_bytes_per_sec / (2 * links[i].loss_percent));
+  }
+}
@@ -0,0 +1,223 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "drivers/flash/flash_cache.h"
+
+#include "clar.h"
+
+#include "flash_region/flash_region.h"
+#include "pbl/services/filesystem/pfs.h"
+#include "pbl/services/settings/settings_file.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Stubs
+////////////////////////////////////
+#include "stubs_analytics.h"
+#include "stubs_logging.h"
+#include "stubs_mutex.h"
+#include "stubs_passert.h"
+#include "stubs_pbl_malloc.h"
+#include "stubs_pebble_tasks.h"
+#include "stubs_print.h"
+#include "stubs_prompt.h"
+#include "stubs_rand_ptr.h"
+#include "stubs_serial.h"
+#include "stubs_sleep.h"
+#include "stubs_system_reset.h"
+#include "stubs_task_watchdog.h"
+#include "fake_rtc.h"
+#include "fake_spi_flash.h"
+
+// Fake flash for the cache unit tests
+////////////////////////////////////
+
+#define FAKE_FLASH_SIZE (16 * FLASH_CACHE_LINE_SIZE)
+
+static uint8_t s_flash[FAKE_FLASH_SIZE];
+static int s_num_fills;
+
+static void prv_fill(uint8_t *buffer, uint32_t start_addr, uint32_t buffer_size) {
+  cl_assert(start_addr + buffer_size <= FAKE_FLASH_SIZE);
+  s_num_fills++;
+  memcpy(buffer, &s_flash[start_addr], buffer_size);
+}
+
+static void prv_assert_read(uint32_t start_addr, uint32_t length) {
+  uint8_t buffer[2 * FLASH_CACHE_LINE_SIZE];
+  cl_assert(length <= sizeof(buffer));
+  flash_cache_read(buffer, start_addr, length, prv_fill);
+  cl_assert_equal_m(buffer, &s_flash[start_addr], length);
+}
+
+void test_flash_cache__initialize(void) {
+  for (unsigned int i = 0; i < FAKE_FLASH_SIZE; i++) {
+    s_flash[i] = i * 7;
+  }
+  s_num_fills = 0;
+  flash_cache_init();
+}
+
+void test_flash_cache__hits_after_miss(void) {
+  prv_assert_read(0x10, 4);
+  cl_assert_equal_i(s_num_fills, 1);
+
+  // anything else in the same line is a hit
+  prv_assert_read(0x10, 4);
+  prv_assert_read(0x00, 1);
+  prv_assert_read(FLASH_CACHE_LINE_SIZE - 8, 8);
+  cl_assert_equal_i(s_num_fills, 1);
+
+  FlashCacheStats stats;
+  flash_cache_get_stats(&stats);
+  cl_assert_equal_i(stats.hits, 3);
+  cl_assert_equal_i(stats.misses, 1);
+}
+
+void test_flash_cache__read_across_lines(void) {
+  prv_assert_read(FLASH_CACHE_LINE_SIZE - 3, 10);
+  cl_assert_equal_i(s_num_fills, 2);
+  prv_assert_read(FLASH_CACHE_LINE_SIZE + 20, 10);
+  cl_assert_equal_i(s_num_fills, 2);
+}
+
+void test_flash_cache__large_reads_bypass(void) {
+  prv_assert_read(0, FLASH_CACHE_LINE_SIZE + 1);
+  cl_assert_equal_i(s_num_fills, 1);
+  prv_assert_read(0, 4);
+  cl_assert_equal_i(s_num_fills, 2);
+
+  FlashCacheStats stats;
+  flash_cache_get_stats(&stats);
+  cl_assert_equal_i(stats.bypasses, 1);
+}
+
+void test_flash_cache__evicts_least_recently_used(void) {
+  for (int i = 0; i < CONFIG_FLASH_READ_CACHE_NUM_LINES; i++) {
+    prv_assert_read(i * FLASH_CACHE_LINE_SIZE, 4);
+  }
+  cl_assert_equal_i(s_num_fills, CONFIG_FLASH_READ_CACHE_NUM_LINES);
+
+  // touch line 0 so line 1 is the oldest, then pull in a new line
+  prv_assert_read(0, 4);
+  prv_assert_read(CONFIG_FLASH_READ_CACHE_NUM_LINES * FLASH_CACHE_LINE_SIZE, 4);
+  cl_assert_equal_i(s_num_fills, CONFIG_FLASH_READ_CACHE_NUM_LINES + 1);
+
+  prv_assert_read(0, 4);
+  cl_assert_equal_i(s_num_fills, CONFIG_FLASH_READ_CACHE_NUM_LINES + 1);
+  prv_assert_read(FLASH_CACHE_LINE_SIZE, 4);
+  cl_assert_equal_i(s_num_fills, CONFIG_FLASH_READ_CACHE_NUM_LINES + 2);
+}
+
+void test_flash_cache__invalidate(void) {
+  prv_assert_read(0, 4);
+  prv_assert_read(FLASH_CACHE_LINE_SIZE, 4);
+  prv_assert_read(2 * FLASH_CACHE_LINE_SIZE, 4);
+
+  s_flash[FLASH_CACHE_LINE_SIZE + 1] = 0xab;
+  flash_cache_invalidate(FLASH_CACHE_LINE_SIZE + 1, 1);
+  prv_assert_read(FLASH_CACHE_LINE_SIZE, 4);
+  cl_assert_equal_i(s_num_fills, 4);
+
+  // a range ending right where a line starts doesn't touch it
+  flash_cache_invalidate(FLASH_CACHE_LINE_SIZE - 4, 4);
+  prv_assert_read(FLASH_CACHE_LINE_SIZE, 4);
+  prv_assert_read(0, 4);
+  cl_assert_equal_i(s_num_fills, 5);
+
+  FlashCacheStats stats;
+  flash_cache_get_stats(&stats);
+  cl_assert_equal_i(stats.invalidations, 2);
+}
+
+// PFS and SettingsFile workload
+////////////////////////////////////
+
+#define WORKLOAD_NUM_FILES (16)
+#define WORKLOAD_NUM_SETTINGS (40)
+#define WORKLOAD_NUM_ROUNDS (10)
+
+static void prv_file_name(char *name, size_t size, int i) {
+  snprintf(name, size, "workload%d", i);
+}
+
+static void prv_setup_workload(void) {
+  fake_spi_flash_init(0, 0x1000000);
+  pfs_init(false);
+  pfs_format(false);
+
+  for (int i = 0; i < WORKLOAD_NUM_FILES; i++) {
+    char name[16];
+    prv_file_name(name, sizeof(name), i);
+    const int fd = pfs_open(name, OP_FLAG_WRITE, FILE_TYPE_STATIC, 64);
+    cl_assert(fd >= 0);
+    uint8_t data[64];
+    memset(data, i, sizeof(data));
+    cl_assert_equal_i(pfs_write(fd, data, sizeof(data)), sizeof(data));
+    cl_assert_equal_i(pfs_close(fd), S_SUCCESS);
+  }
+
+  SettingsFile file;
+  cl_assert_equal_i(settings_file_open(&file, "workload_settings", 4096), S_SUCCESS);
+  for (int i = 0; i < WORKLOAD_NUM_SETTINGS; i++) {
+    const uint32_t value = i * 3;
+    cl_assert_equal_i(settings_file_set(&file, &i, sizeof(i), &value, sizeof(value)), S_SUCCESS);
+  }
+  settings_file_close(&file);
+}
+
+static bool prv_count_record(SettingsFile *file, SettingsRecordInfo *info, void *context) {
+  (*(int *)context)++;
+  return true;
+}
+
+//! Reads a few small files, and opens a settings file to look up and iterate its records, the
+//! way apps and services do over and over.
+static void prv_run_workload(void) {
+  for (int round = 0; round < WORKLOAD_NUM_ROUNDS; round++) {
+    for (int i = 0; i < WORKLOAD_NUM_FILES; i += 3) {
+      char name[16];
+      prv_file_name(name, sizeof(name), i);
+      const int fd = pfs_open(name, OP_FLAG_READ, 0, 0);
+      cl_assert(fd >= 0);
+      uint8_t data[8];
+      cl_assert_equal_i(pfs_read(fd, data, sizeof(data)), sizeof(data));
+      cl_assert_equal_i(data[0], i);
+      pfs_close(fd);
+    }
+
+    SettingsFile file;
+    cl_assert_equal_i(settings_file_open(&file, "workload_settings", 4096), S_SUCCESS);
+    for (int i = 0; i < WORKLOAD_NUM_SETTINGS; i += 4) {
+      uint32_t value;
+      cl_assert_equal_i(settings_file_get(&file, &i, sizeof(i), &value, sizeof(value)),
+                        S_SUCCESS);
+      cl_assert_equal_i(value, i * 3);
+    }
+    int count = 0;
+    settings_file_each(&file, prv_count_record, &count);
+    cl_assert_equal_i(count, WORKLOAD_NUM_SETTINGS);
+    settings_file_close(&file);
+  }
+}
+
+static uint32_t prv_count_workload_reads(bool use_cache) {
+  prv_setup_workload();
+  fake_spi_flash_enable_read_cache(use_cache);
+  const uint32_t start_reads = fake_flash_read_count();
+  prv_run_workload();
+  const uint32_t num_reads = fake_flash_read_count() - start_reads;
+  fake_spi_flash_enable_read_cache(false);
+  fake_spi_flash_cleanup();
+  return num_reads;
+}
+
+void test_flash_cache__pfs_and_settings_workload(void) {
+  const uint32_t uncached_reads = prv_count_workload_reads(false);
+  const uint32_t cached_reads = prv_count_workload_reads(true);
+  printf("Flash read transactions for %d rounds of PFS and SettingsFile reads: "
+         "%u without the read cache, %u with %d lines\n", WORKLOAD_NUM_ROUNDS,
+         uncached_reads, cached_reads, CONFIG_FLASH_READ_CACHE_NUM_LINES);
+  cl_assert(cached_reads * 4 < uncached_reads);
+}
@@ -0,0 +1,375 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "applib/graphics/graphics.h"
+#include "applib/graphics/bitblt.h"
+#include "applib/graphics/bitblt_private.h"
+#include "applib/graphics/8_bit/framebuffer.h"
+#include "pbl/util/math.h"
+#include "pbl/util/size.h"
+
+#include "clar.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+// Stubs
+////////////////////////////////////
+#include "graphics_common_stubs.h"
+#include "stubs_applib_resource.h"
+#include "test_graphics.h"
+
+// Reference
+////////////////////////////////////
+
+//! The per pixel implementation of bitblt_bitmap_into_bitmap_tiled_8bit_to_8bit() that the span
+//! procs replaced, which the tests expect the same pixels from
+static void prv_reference_8bit_to_8bit(GBitmap *dest_bitmap, const GBitmap *src_bitmap,
+                                       GRect dest_rect, GPoint src_origin_offset,
+                                       GCompOp compositing_mode, GColor8 tint_color) {
+  GColor8 tint_luminance_lookup_table[GCOLOR8_COMPONENT_NUM_VALUES] = {};
+  if (compositing_mode == GCompOpTintLuminance) {
+    gcolor_tint_luminance_lookup_table_init(tint_color, tint_luminance_lookup_table);
+  }
+
+  const int16_t dest_begin_y = dest_rect.origin.y;
+  const int16_t dest_end_y = grect_get_max_y(&dest_rect);
+  const int16_t src_begin_y = src_bitmap->bounds.origin.y;
+  const int16_t src_end_y = grect_get_max_y(&src_bitmap->bounds);
+  int16_t src_y = src_begin_y + src_origin_offset.y;
+  for (int16_t dest_y = dest_begin_y; dest_y < dest_end_y; ++dest_y, ++src_y) {
+    if (src_y >= src_end_y) {
+      src_y = src_begin_y;
+    }
+
+    const GBitmapDataRowInfo dest_row_info = gbitmap_get_data_row_info(dest_bitmap, dest_y);
+    uint8_t *dest = dest_row_info.data;
+    const int16_t dest_delta_begin_x = MAX(dest_row_info.min_x - dest_rect.origin.x, 0);
+    const int16_t dest_begin_x = dest_delta_begin_x ? dest_row_info.min_x : dest_rect.origin.x;
+    const int16_t dest_end_x = MIN(grect_get_max_x(&dest_rect), dest_row_info.max_x + 1);
+    if (dest_end_x < dest_begin_x) {
+      continue;
+    }
+
+    const GBitmapDataRowInfo src_row_info = gbitmap_get_data_row_info(src_bitmap, src_y);
+    const uint8_t *src = src_row_info.data;
+    const int16_t src_initial_x = src_bitmap->bounds.origin.x + dest_delta_begin_x;
+    const int16_t src_begin_x = MAX(src_row_info.min_x, src_bitmap->bounds.origin.x);
+    const int16_t src_end_x = MIN(grect_get_max_x(&src_bitmap->bounds),
+                                  src_row_info.max_x + 1);
+
+    int16_t src_x = src_initial_x + src_origin_offset.x;
+    for (int16_t dest_x = dest_begin_x; dest_x < dest_end_x; ++dest_x, ++src_x) {
+      if (!WITHIN(src_x, src_begin_x, src_end_x - 1)) {
+        if (!WITHIN(src_x, src_bitmap->bounds.origin.x,
+                    grect_get_max_x(&src_bitmap->bounds) - 1)) {
+          src_x = src_bitmap->bounds.origin.x +
+            ((src_x - src_bitmap->bounds.origin.x) % src_bitmap->bounds.size.w);
+        } else {
+          continue;
+        }
+      }
+      const GColor8 src_color = (GColor8)src[src_x];
+      switch (compositing_mode) {
+        case GCompOpAssign:
+        case GCompOpAssignInverted:
+        case GCompOpAnd:
+        case GCompOpOr:
+        case GCompOpClear:
+          dest[dest_x] = src_color.argb;
+          break;
+        case GCompOpTint: {
+          GColor8 actual_color = tint_color;
+          actual_color.a = src_color.a;
+          dest[dest_x] = gcolor_alpha_blend(actual_color, (GColor8)dest[dest_x]).argb;
+          break;
+        }
+        case GCompOpTintLuminance: {
+          const GColor8 actual_color =
+              gcolor_perform_lookup_using_color_luminance_and_multiply_alpha(
+                  src_color, tint_luminance_lookup_table);
+          dest[dest_x] = gcolor_alpha_blend(actual_color, (GColor8)dest[dest_x]).argb;
+          break;
+        }
+        case GCompOpSet:
+        default:
+          dest[dest_x] = gcolor_alpha_blend(src_color, (GColor8)dest[dest_x]).argb;
+          break;
+      }
+    }
+  }
+}
+
+// Helpers
+////////////////////////////////////
+
+#define MAX_SIZE (64)
+
+typedef struct TestBitmap {
+  GBitmap bitmap;
+  //! Tiling can read up to a row before the first packed row of a circular bitmap
+  uint8_t data[MAX_SIZE + (MAX_SIZE * MAX_SIZE)];
+  GBitmapDataRowInfoInternal row_infos[MAX_SIZE];
+} TestBitmap;
+
+static uint32_t s_seed;
+
+static uint32_t prv_rand(void) {
+  s_seed = (s_seed * 1103515245) + 12345;
+  return s_seed >> 16;
+}
+
+static int16_t prv_rand_range(int16_t min, int16_t max) {
+  return min + (int16_t)(prv_rand() % (max - min + 1));
+}
+
+//! Random colors, with alphas that are mostly opaque or transparent like in sprites
+static uint8_t prv_rand_color(void) {
+  static const uint8_t s_alphas[] = { 0, 0, 0, 1, 2, 3, 3, 3 };
+  return (s_alphas[prv_rand() % ARRAY_LENGTH(s_alphas)] << 6) | (prv_rand() & 0x3f);
+}
+
+//! Sets up a bitmap of size with random content. Circular bitmaps get rows of random width that
+//! are packed in memory like the framebuffer of round displays.
+static void prv_init_bitmap(TestBitmap *test_bitmap, GSize size, bool circular) {
+  *test_bitmap = (TestBitmap) {
+    .bitmap = {
+      .addr = test_bitmap->data,
+      .row_size_bytes = size.w,
+      .info.format = circular ? GBitmapFormat8BitCircular : GBitmapFormat8Bit,
+      .info.version = GBITMAP_VERSION_CURRENT,
+      .bounds = { GPointZero, size },
+    },
+  };
+  uint32_t offset = circular ? MAX_SIZE : 0;
+  for (int16_t y = 0; y < size.h; y++) {
+    uint16_t min_x = 0;
+    uint16_t max_x = size.w - 1;
+    if (circular) {
+      min_x = prv_rand_range(0, size.w / 2);
+      max_x = prv_rand_range(min_x, size.w - 1);
+    }
+    test_bitmap->row_infos[y] = (GBitmapDataRowInfoInternal) {
+      .offset = offset - min_x,
+      .min_x = min_x,
+      .max_x = max_x,
+    };
+    offset += circular ? (max_x - min_x + 1) : size.w;
+  }
+  if (circular) {
+    test_bitmap->bitmap.data_row_infos = test_bitmap->row_infos;
+  }
+  for (uint32_t i = 0; i < sizeof(test_bitmap->data); i++) {
+    test_bitmap->data[i] = prv_rand_color();
+  }
+}
+
+static const GCompOp s_compositing_modes[] = {
+  GCompOpAssign, GCompOpAssignInverted, GCompOpOr, GCompOpAnd, GCompOpClear, GCompOpSet,
+  GCompOpTint, GCompOpTintLuminance,
+};
+
+// Tests
+////////////////////////////////////
+
+void test_bitblt_spans__initialize(void) {
+  s_seed = 1;
+}
+
+void test_bitblt_spans__cleanup(void) {
+}
+
+void test_bitblt_spans__same_pixels_as_per_pixel_reference(void) {
+  static TestBitmap s_src;
+  static TestBitmap s_dest;
+  static TestBitmap s_expected;
+
+  for (int i = 0; i < 4000; i++) {
+    const bool src_circular = (prv_rand() % 4) == 0;
+    const bool dest_circular = (prv_rand() % 4) == 0;
+    prv_init_bitmap(&s_src, GSize(prv_rand_range(1, MAX_SIZE), prv_rand_range(1, 8)),
+                    src_circular);
+    prv_init_bitmap(&s_dest, GSize(prv_rand_range(1, MAX_SIZE), prv_rand_range(1, 8)),
+                    dest_circular);
+    s_expected = s_dest;
+    s_expected.bitmap.addr = s_expected.data;
+    s_expected.bitmap.data_row_infos = dest_circular ? s_expected.row_infos : NULL;
+
+    // Blit a part of the source, as a sub bitmap would, tiled into a part of the destination
+    GBitmap src_bitmap = s_src.bitmap;
+    const GSize src_size = s_src.bitmap.bounds.size;
+    src_bitmap.bounds.origin.x = prv_rand_range(0, src_size.w - 1);
+    src_bitmap.bounds.size.w = prv_rand_range(1, src_size.w - src_bitmap.bounds.origin.x);
+    const GSize dest_size = s_dest.bitmap.bounds.size;
+    GRect dest_rect;
+    dest_rect.origin = GPoint(prv_rand_range(0, dest_size.w - 1),
+                              prv_rand_range(0, dest_size.h - 1));
+    dest_rect.size = GSize(prv_rand_range(0, dest_size.w - dest_rect.origin.x),
+                           prv_rand_range(0, dest_size.h - dest_rect.origin.y));
+    const GPoint src_origin_offset = GPoint(prv_rand_range(0, 3 * src_bitmap.bounds.size.w),
+                                            prv_rand_range(0, src_size.h - 1));
+    const GCompOp compositing_mode =
+        s_compositing_modes[prv_rand() % ARRAY_LENGTH(s_compositing_modes)];
+    const GColor8 tint_color = (GColor8) { .argb = prv_rand_color() };
+
+    prv_reference_8bit_to_8bit(&s_expected.bitmap, &src_bitmap, dest_rect, src_origin_offset,
+                               compositing_mode, tint_color);
+    bitblt_bitmap_into_bitmap_tiled_8bit_to_8bit(&s_dest.bitmap, &src_bitmap, dest_rect,
+                                                 src_origin_offset, compositing_mode, tint_color);
+    cl_assert_equal_m(s_dest.data, s_expected.data, sizeof(s_dest.data));
+  }
+}
+
+//! A bitmap drawn into itself, shifted by up to a few pixels either way, gets the same pixels as
+//! from the per pixel loop. That includes the pixels that are repeated when it is drawn further
+//! right, where copying from left to right reads pixels that have already been overwritten.
+void test_bitblt_spans__draw_into_itself(void) {
+  static TestBitmap s_bitmap;
+  static TestBitmap s_expected;
+
+  for (int i = 0; i < 2000; i++) {
+    const bool circular = (prv_rand() % 4) == 0;
+    prv_init_bitmap(&s_bitmap, GSize(prv_rand_range(1, MAX_SIZE), prv_rand_range(1, 8)),
+                    circular);
+    s_expected = s_bitmap;
+    s_expected.bitmap.addr = s_expected.data;
+    s_expected.bitmap.data_row_infos = circular ? s_expected.row_infos : NULL;
+
+    const GSize size = s_bitmap.bitmap.bounds.size;
+    GRect src_bounds;
+    src_bounds.origin = GPoint(prv_rand_range(0, size.w - 1), prv_rand_range(0, size.h - 1));
+    src_bounds.size = GSize(prv_rand_range(1, size.w - src_bounds.origin.x),
+                            prv_rand_range(1, size.h - src_bounds.origin.y));
+    GRect dest_rect = src_bounds;
+    dest_rect.origin.x += prv_rand_range(-5, 5);
+    dest_rect.origin.y += prv_rand_range(-1, 1);
+    grect_clip(&dest_rect, &s_bitmap.bitmap.bounds);
+    const GCompOp compositing_mode =
+        s_compositing_modes[prv_rand() % ARRAY_LENGTH(s_compositing_modes)];
+    const GColor8 tint_color = (GColor8) { .argb = prv_rand_color() };
+
+    GBitmap expected_src_bitmap = s_expected.bitmap;
+    expected_src_bitmap.bounds = src_bounds;
+    prv_reference_8bit_to_8bit(&s_expected.bitmap, &expected_src_bitmap, dest_rect, GPointZero,
+                               compositing_mode, tint_color);
+    GBitmap src_bitmap = s_bitmap.bitmap;
+    src_bitmap.bounds = src_bounds;
+    bitblt_bitmap_into_bitmap_tiled_8bit_to_8bit(&s_bitmap.bitmap, &src_bitmap, dest_rect,
+                                                 GPointZero, compositing_mode, tint_color);
+    cl_assert_equal_m(s_bitmap.data, s_expected.data, sizeof(s_bitmap.data));
+  }
+}
+
+// Benchmark
+////////////////////////////////////
+
+#define BENCHMARK_NUM_FRAMES (100)
+
+typedef struct BenchmarkFormat {
+  const char *name;
+  GBitmapFormat format;
+} BenchmarkFormat;
+
+static const BenchmarkFormat s_benchmark_formats[] = {
+  { "1-bit", GBitmapFormat1Bit },
+  { "2-bit palette", GBitmapFormat2BitPalette },
+  { "8-bit", GBitmapFormat8Bit },
+  { "8-bit circular", GBitmapFormat8BitCircular },
+};
+
+static const char *s_benchmark_mode_names[] = {
+  [GCompOpAssign] = "Assign",
+  [GCompOpSet] = "Set",
+  [GCompOpTint] = "Tint",
+  [GCompOpTintLuminance] = "TintLuminance",
+};
+
+static const GCompOp s_benchmark_modes[] = {
+  GCompOpAssign, GCompOpSet, GCompOpTint, GCompOpTintLuminance,
+};
+
+typedef void (*BlitFunc)(GBitmap *dest_bitmap, const GBitmap *src_bitmap, GRect dest_rect,
+                         GPoint src_origin_offset, GCompOp compositing_mode, GColor tint_color);
+
+static double prv_rows_per_second(BlitFunc blit, GBitmap *dest_bitmap, const GBitmap *src_bitmap,
+                                  GCompOp compositing_mode) {
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  for (int frame = 0; frame < BENCHMARK_NUM_FRAMES; frame++) {
+    blit(dest_bitmap, src_bitmap, dest_bitmap->bounds, GPointZero, compositing_mode,
+         GColorRed);
+  }
+  gettimeofday(&end, NULL);
+  const double seconds = (end.tv_sec - start.tv_sec) + ((end.tv_usec - start.tv_usec) / 1e6);
+  return (seconds > 0) ? (BENCHMARK_NUM_FRAMES * dest_bitmap->bounds.size.h) / seconds : 0.0;
+}
+
+//! A full screen blit of each source format into the framebuffer, the way the compositor copies
+//! app framebuffers and apps draw full screen images
+void test_bitblt_spans__benchmark_rows_per_second(void) {
+  static uint8_t s_dest_data[DISP_ROWS * DISP_COLS];
+  static uint8_t s_src_data[DISP_ROWS * DISP_COLS];
+  static GBitmapDataRowInfoInternal s_row_infos[DISP_ROWS];
+  static const GColor s_palette[4] = {
+    { .argb = GColorBlackARGB8 }, { .argb = GColorClearARGB8 }, { .argb = GColorRedARGB8 },
+    { .argb = GColorWhiteARGB8 },
+  };
+
+  // Mostly opaque or transparent blocks with semi transparent edges, like a sprite sheet
+  for (int y = 0; y < DISP_ROWS; y++) {
+    for (int x = 0; x < DISP_COLS; x++) {
+      const uint8_t alpha = ((x % 16) == 0) ? 2 : ((((x / 16) + (y / 16)) % 2) ? 3 : 0);
+      s_src_data[(y * DISP_COLS) + x] = (alpha << 6) | ((x + y) & 0x3f);
+    }
+    // Rows that shrink towards the top and bottom like the framebuffer of a round display
+    const uint16_t inset = ABS((DISP_ROWS / 2) - y) / 4;
+    s_row_infos[y] = (GBitmapDataRowInfoInternal) {
+      .offset = y * DISP_COLS,
+      .min_x = inset,
+      .max_x = DISP_COLS - 1 - inset,
+    };
+  }
+
+  GBitmap dest_bitmap = {
+    .addr = s_dest_data,
+    .row_size_bytes = DISP_COLS,
+    .info.format = GBitmapFormat8Bit,
+    .info.version = GBITMAP_VERSION_CURRENT,
+    .bounds = GRect(0, 0, DISP_COLS, DISP_ROWS),
+  };
+
+  for (unsigned int f = 0; f < ARRAY_LENGTH(s_benchmark_formats); f++) {
+    const GBitmapFormat format = s_benchmark_formats[f].format;
+    GBitmap src_bitmap = {
+      .addr = s_src_data,
+      .row_size_bytes = (format == GBitmapFormat1Bit) ? ((DISP_COLS + 31) / 32) * 4 :
+                        (format == GBitmapFormat2BitPalette) ? (DISP_COLS + 3) / 4 : DISP_COLS,
+      .info.format = format,
+      .info.version = GBITMAP_VERSION_CURRENT,
+      .bounds = GRect(0, 0, DISP_COLS, DISP_ROWS),
+    };
+    if (format == GBitmapFormat8BitCircular) {
+      src_bitmap.data_row_infos = s_row_infos;
+    } else if (format == GBitmapFormat2BitPalette) {
+      src_bitmap.palette = (GColor *)s_palette;
+    }
+    const bool is_8bit = (format == GBitmapFormat8Bit) || (format == GBitmapFormat8BitCircular);
+
+    for (unsigned int m = 0; m < ARRAY_LENGTH(s_benchmark_modes); m++) {
+      const GCompOp mode = s_benchmark_modes[m];
+      const double rows_per_second =
+          prv_rows_per_second(bitblt_bitmap_into_bitmap_tiled, &dest_bitmap, &src_bitmap, mode);
+      if (is_8bit) {
+        const double reference_rows_per_second =
+            prv_rows_per_second(prv_reference_8bit_to_8bit, &dest_bitmap, &src_bitmap, mode);
+        printf("%-15s %-14s %10.0f rows/s (per pixel: %10.0f rows/s, %.1fx)\n",
+               s_benchmark_formats[f].name, s_benchmark_mode_names[mode], rows_per_second,
+               reference_rows_per_second, rows_per_second / reference_rows_per_second);
+      } else {
+        printf("%-15s %-14s %10.0f rows/s\n", s_benchmark_formats[f].name,
+               s_benchmark_mode_names[mode], rows_per_second);
+      }
+    }
+  }
+}
@@ -44,3 +44,28 @@ void test_framebuffer_${BIT_DEPTH_NAME}__framebuffer_clear(void) {
 
   cl_assert(framebuffer.is_dirty == true);
 }
+
+void test_framebuffer_${BIT_DEPTH_NAME}__dirty_rects_are_tracked_apart(void) {
+  framebuffer_init(&framebuffer, &(GSize) { DISP_COLS, DISP_ROWS });
+  cl_assert(!framebuffer_is_dirty(&framebuffer));
+
+  framebuffer_mark_dirty_rect(&framebuffer, GRect(2, 4, 10, 10));
+  framebuffer_mark_dirty_rect(&framebuffer, GRect(DISP_COLS - 12, DISP_ROWS - 6, 20, 20));
+  cl_assert(framebuffer_is_dirty(&framebuffer));
+  cl_assert_equal_i(framebuffer.dirty_region.num_rects, 2);
+
+  // rects are clipped to the framebuffer and dirty_rect is their bounding box
+  const GRect expected_corner = GRect(DISP_COLS - 12, DISP_ROWS - 6, 12, 6);
+  cl_assert(!memcmp(&framebuffer.dirty_region.rects[1], &expected_corner, sizeof(GRect)));
+  const GRect expected_bounds = GRect(2, 4, DISP_COLS - 2, DISP_ROWS - 4);
+  cl_assert(!memcmp(&framebuffer.dirty_rect, &expected_bounds, sizeof(GRect)));
+
+  framebuffer_reset_dirty(&framebuffer);
+  cl_assert(!framebuffer_is_dirty(&framebuffer));
+  cl_assert_equal_i(framebuffer.dirty_region.num_rects, 0);
+
+  framebuffer_dirty_all(&framebuffer);
+  cl_assert_equal_i(framebuffer.dirty_region.num_rects, 1);
+  const GRect expected_all = GRect(0, 0, DISP_COLS, DISP_ROWS);
+  cl_assert(!memcmp(&framebuffer.dirty_region.rects[0], &expected_all, sizeof(GRect)));
+}
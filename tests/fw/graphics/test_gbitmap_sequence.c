@@ -11,6 +11,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <sys/time.h>
 #include <time.h>
 
 // Test files are Creative Commons 0 (ie. Public Domain) from
@@ -330,3 +331,141 @@ void test_gbitmap_sequence__1bit_to_1bit_notification(void) {
     cl_check(gbitmap_pbi_eq(bitmap, filename_buffer));
   }
 }
+
+static uint64_t prv_now_us(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ((uint64_t)tv.tv_sec * 1000000) + tv.tv_usec;
+}
+
+static GBitmapSequence *prv_create_sequence(const char *apng_name, uint32_t play_count,
+                                            uint32_t frame_cache_budget) {
+  uint32_t resource_id = sys_resource_load_file_as_resource(TEST_IMAGES_PATH, apng_name);
+  cl_assert(resource_id != UINT32_MAX);
+  GBitmapSequence *bitmap_sequence = gbitmap_sequence_create_with_resource(resource_id);
+  cl_assert(bitmap_sequence);
+  gbitmap_sequence_set_play_count(bitmap_sequence, play_count);
+  if (frame_cache_budget) {
+    cl_assert(gbitmap_sequence_set_frame_cache_budget(bitmap_sequence, frame_cache_budget));
+  }
+  return bitmap_sequence;
+}
+
+// Plays a sequence with and without cached frames, every frame of every loop has to match
+static void prv_check_frame_cache(const char *apng_name, uint32_t frame_cache_budget) {
+  const uint32_t num_loops = 3;
+  GBitmapSequence *decoded = prv_create_sequence(apng_name, num_loops, 0);
+  GBitmapSequence *cached = prv_create_sequence(apng_name, num_loops, frame_cache_budget);
+
+  const GSize size = gbitmap_sequence_get_bitmap_size(decoded);
+  GBitmap *decoded_bitmap = gbitmap_create_blank(size, GBitmapFormat8Bit);
+  GBitmap *cached_bitmap = gbitmap_create_blank(size, GBitmapFormat8Bit);
+  cl_assert(decoded_bitmap && cached_bitmap);
+
+  const uint32_t num_frames = gbitmap_sequence_get_total_num_frames(decoded);
+  for (uint32_t i = 0; i < num_frames * num_loops; i++) {
+    uint32_t decoded_delay_ms;
+    uint32_t cached_delay_ms;
+    cl_assert(gbitmap_sequence_update_bitmap_next_frame(decoded, decoded_bitmap,
+                                                        &decoded_delay_ms));
+    cl_assert(gbitmap_sequence_update_bitmap_next_frame(cached, cached_bitmap,
+                                                        &cached_delay_ms));
+    cl_assert_equal_i(cached_delay_ms, decoded_delay_ms);
+    cl_assert_equal_m(cached_bitmap->addr, decoded_bitmap->addr,
+                      cached_bitmap->row_size_bytes * size.h);
+  }
+  // Both played all their loops
+  cl_assert(!gbitmap_sequence_update_bitmap_next_frame(decoded, decoded_bitmap, NULL));
+  cl_assert(!gbitmap_sequence_update_bitmap_next_frame(cached, cached_bitmap, NULL));
+
+  const GBitmapSequenceFrameCache *frame_cache = cached->png_decoder_data.frame_cache;
+  printf("%s: %"PRIu32" frames from the cache, %"PRIu32" decoded, %"PRIu32" of %"PRIu32" bytes\n",
+         apng_name, frame_cache->stats.hits, frame_cache->stats.misses, frame_cache->used_bytes,
+         frame_cache->budget_bytes);
+  cl_assert(frame_cache->used_bytes <= frame_cache_budget);
+  cl_assert(frame_cache->stats.hits > 0);
+
+  gbitmap_destroy(decoded_bitmap);
+  gbitmap_destroy(cached_bitmap);
+  gbitmap_sequence_destroy(decoded);
+  gbitmap_sequence_destroy(cached);
+}
+
+void test_gbitmap_sequence__frame_cache_draws_like_decoding(void) {
+  const uint32_t unlimited_budget = 1024 * 1024;
+  const char *apng_names[] = {
+    "test_gbitmap_sequence__color_2bit_bouncing_ball.apng",
+    "test_gbitmap_sequence__color_8bit_bounds.apng",
+    "test_gbitmap_sequence__color_8bit_fight.apng",
+    "test_gbitmap_sequence__color_8bit_yoshi.apng",
+  };
+  for (int i = 0; i < ARRAY_LENGTH(apng_names); i++) {
+    prv_check_frame_cache(apng_names[i], unlimited_budget);
+  }
+  // Only some of the frames fit, the rest are decoded on every loop
+  prv_check_frame_cache("test_gbitmap_sequence__color_8bit_yoshi.apng", 64 * 1024);
+}
+
+void test_gbitmap_sequence__frame_cache_all_frames_after_first_loop(void) {
+  GBitmapSequence *bitmap_sequence =
+      prv_create_sequence("test_gbitmap_sequence__color_8bit_fight.apng", 3, 1024 * 1024);
+  GBitmap *bitmap = gbitmap_create_blank(gbitmap_sequence_get_bitmap_size(bitmap_sequence),
+                                         GBitmapFormat8Bit);
+  const uint32_t num_frames = gbitmap_sequence_get_total_num_frames(bitmap_sequence);
+  const GBitmapSequenceFrameCache *frame_cache =
+      bitmap_sequence->png_decoder_data.frame_cache;
+
+  while (gbitmap_sequence_update_bitmap_next_frame(bitmap_sequence, bitmap, NULL)) {}
+  cl_assert_equal_i(frame_cache->stats.misses, num_frames);
+  cl_assert_equal_i(frame_cache->stats.hits, 2 * num_frames);
+
+  // A budget below what's cached starts over, no budget frees the frames
+  cl_assert(gbitmap_sequence_set_frame_cache_budget(bitmap_sequence, 1024));
+  frame_cache = bitmap_sequence->png_decoder_data.frame_cache;
+  cl_assert_equal_i(frame_cache->stats.hits, 0);
+  cl_assert(frame_cache->used_bytes <= 1024);
+  cl_assert(gbitmap_sequence_set_frame_cache_budget(bitmap_sequence, 0));
+  cl_assert(!bitmap_sequence->png_decoder_data.frame_cache);
+
+  // Sequences that aren't palettized can't be cached
+  GBitmapSequence *gray_sequence =
+      prv_create_sequence("test_gbitmap_sequence__1bit_to_1bit_notification.apng", 2, 0);
+  cl_assert(!gbitmap_sequence_set_frame_cache_budget(gray_sequence, 1024 * 1024));
+
+  gbitmap_destroy(bitmap);
+  gbitmap_sequence_destroy(bitmap_sequence);
+  gbitmap_sequence_destroy(gray_sequence);
+}
+
+// Plays a long sequence a few times over, with and without cached frames
+void test_gbitmap_sequence__frame_cache_ms_per_frame(void) {
+  const uint32_t num_loops = 4;
+  for (int use_cache = 0; use_cache < 2; use_cache++) {
+    GBitmapSequence *bitmap_sequence =
+        prv_create_sequence("test_gbitmap_sequence__color_8bit_fight.apng", num_loops,
+                            use_cache ? 1024 * 1024 : 0);
+    GBitmap *bitmap = gbitmap_create_blank(gbitmap_sequence_get_bitmap_size(bitmap_sequence),
+                                           GBitmapFormat8Bit);
+    const uint32_t num_frames = gbitmap_sequence_get_total_num_frames(bitmap_sequence);
+
+    printf("%s:", use_cache ? "cached " : "decoded");
+    for (uint32_t loop = 0; loop < num_loops; loop++) {
+      const uint64_t start_us = prv_now_us();
+      for (uint32_t frame = 0; frame < num_frames; frame++) {
+        cl_assert(gbitmap_sequence_update_bitmap_next_frame(bitmap_sequence, bitmap, NULL));
+      }
+      const uint64_t elapsed_us = prv_now_us() - start_us;
+      printf(" loop %"PRIu32" %3"PRIu64".%03"PRIu64" ms/frame,", loop + 1,
+             elapsed_us / num_frames / 1000, (elapsed_us / num_frames) % 1000);
+    }
+    printf("\n");
+
+    if (use_cache) {
+      const GBitmapSequenceFrameCache *frame_cache =
+          bitmap_sequence->png_decoder_data.frame_cache;
+      cl_assert_equal_i(frame_cache->stats.hits, (num_loops - 1) * num_frames);
+    }
+    gbitmap_destroy(bitmap);
+    gbitmap_sequence_destroy(bitmap_sequence);
+  }
+}
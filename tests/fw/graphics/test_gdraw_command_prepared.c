@@ -0,0 +1,403 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clar.h"
+
+#include "applib/graphics/framebuffer.h"
+#include "applib/graphics/gdraw_command_prepared.h"
+#include "applib/graphics/gdraw_command_private.h"
+#include "applib/graphics/gdraw_command_transforms.h"
+#include "applib/graphics/graphics.h"
+#include "applib/graphics/gtypes.h"
+#include "applib/ui/animation_interpolate.h"
+#include "pbl/util/size.h"
+
+#include "util.h"
+#include "test_graphics.h"
+#include "8bit/test_framebuffer.h"
+#include "weather_app_resources.h"
+
+// Stubs
+////////////////////////////////////
+#include "stubs_applib_resource.h"
+#include "stubs_app_state.h"
+#include "stubs_heap.h"
+#include "stubs_logging.h"
+#include "stubs_memory_layout.h"
+#include "stubs_passert.h"
+#include "stubs_pbl_malloc.h"
+#include "stubs_resources.h"
+#include "stubs_syscalls.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+InterpolateInt64Function animation_private_current_interpolate_override(void) {
+  return NULL;
+}
+
+static FrameBuffer *fb = NULL;
+static GContext s_ctx;
+
+// Setup
+void test_gdraw_command_prepared__initialize(void) {
+  fb = malloc(sizeof(FrameBuffer));
+  framebuffer_init(fb, &(GSize) {DISP_COLS, DISP_ROWS});
+  test_graphics_context_init(&s_ctx, fb);
+}
+
+// Teardown
+void test_gdraw_command_prepared__cleanup(void) {
+  free(fb);
+}
+
+///////////////////////////////////////////////////////////
+// Helpers
+
+//! Adds a command to the list the cursor points into and moves the cursor past it
+static GDrawCommand *prv_add_command(uint8_t **cursor, const GDrawCommand *command,
+                                     const GPoint *points) {
+  GDrawCommand *result = (GDrawCommand *)*cursor;
+  *result = *command;
+  memcpy(result->points, points, command->num_points * sizeof(GPoint));
+  *cursor += gdraw_command_get_data_size(result);
+  return result;
+}
+
+//! An image with every kind of command: concave, open and precise paths, circles, hidden and
+//! translucent commands and some that reach out of the image
+static GDrawCommandImage *prv_create_image(void) {
+  GDrawCommandImage *image = malloc(2048);
+  *image = (GDrawCommandImage) {
+    .version = 1,
+    .size = GSize(80, 80),
+  };
+  uint8_t *cursor = (uint8_t *)image->command_list.commands;
+  uint16_t num_commands = 0;
+
+  const GPoint star[] = {
+    {40, 2}, {48, 28}, {76, 28}, {54, 44}, {62, 72}, {40, 55}, {18, 72}, {26, 44}, {4, 28},
+    {32, 28},
+  };
+  prv_add_command(&cursor, &(GDrawCommand) {
+    .type = GDrawCommandTypePath,
+    .fill_color = GColorRed,
+    .stroke_color = GColorBlack,
+    .stroke_width = 2,
+    .num_points = ARRAY_LENGTH(star),
+  }, star);
+  num_commands++;
+
+  // GPointPrecise raw values, in eighths of a pixel
+  const GPoint precise_quad[] = {
+    {10 * 8 + 3, 50 * 8 + 5}, {35 * 8 + 7, 45 * 8 + 1}, {30 * 8 + 2, 78 * 8 + 6},
+    {6 * 8 + 4, 70 * 8},
+  };
+  prv_add_command(&cursor, &(GDrawCommand) {
+    .type = GDrawCommandTypePrecisePath,
+    .fill_color = GColorCobaltBlue,
+    .stroke_color = GColorYellow,
+    .stroke_width = 3,
+    .path_open = true,
+    .num_points = ARRAY_LENGTH(precise_quad),
+  }, precise_quad);
+  num_commands++;
+
+  const GPoint center = {60, 60};
+  prv_add_command(&cursor, &(GDrawCommand) {
+    .type = GDrawCommandTypeCircle,
+    .fill_color = GColorGreen,
+    .stroke_color = GColorOxfordBlue,
+    .stroke_width = 3,
+    .radius = 14,
+    .num_points = 1,
+  }, &center);
+  num_commands++;
+
+  const GPoint dot = {12, 12};
+  prv_add_command(&cursor, &(GDrawCommand) {
+    .type = GDrawCommandTypeCircle,
+    .stroke_color = GColorPurple,
+    .stroke_width = 4,
+    .num_points = 1,
+  }, &dot);
+  num_commands++;
+
+  const GPoint zigzag[] = {
+    {-10, 30}, {20, 10}, {30, 40}, {45, 5}, {70, 45}, {90, 20}, {85, 75}, {-5, 60},
+  };
+  prv_add_command(&cursor, &(GDrawCommand) {
+    .type = GDrawCommandTypePath,
+    //! Translucent, blended with what's underneath
+    .fill_color = (GColor8) { .argb = (GColorOrangeARGB8 & 0x3f) | (2 << 6) },
+    .num_points = ARRAY_LENGTH(zigzag),
+  }, zigzag);
+  num_commands++;
+
+  const GPoint hidden[] = {{0, 0}, {79, 0}, {79, 79}, {0, 79}};
+  prv_add_command(&cursor, &(GDrawCommand) {
+    .type = GDrawCommandTypePath,
+    .hidden = true,
+    .fill_color = GColorBlack,
+    .num_points = ARRAY_LENGTH(hidden),
+  }, hidden);
+  num_commands++;
+
+  const GPoint outline[] = {{5, 5}, {75, 8}, {70, 76}, {3, 70}};
+  prv_add_command(&cursor, &(GDrawCommand) {
+    .type = GDrawCommandTypePath,
+    .stroke_color = GColorBlack,
+    .stroke_width = 1,
+    .path_open = true,
+    .num_points = ARRAY_LENGTH(outline),
+  }, outline);
+  num_commands++;
+
+  image->command_list.num_commands = num_commands;
+  cl_assert(gdraw_command_image_get_data_size(image) <= 2048);
+  return image;
+}
+
+//! Fills the framebuffer with stripes, so the pixels around the commands have to be kept
+static void prv_fill_background(void) {
+  for (int i = 0; i < FRAMEBUFFER_SIZE_BYTES; i++) {
+    fb->buffer[i] = (i % 7) ? GColorWhiteARGB8 : GColorCobaltBlueARGB8;
+  }
+}
+
+static uint64_t prv_now_us(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ((uint64_t)tv.tv_sec * 1000000) + tv.tv_usec;
+}
+
+//! Draws a scaled copy of the image the way it's drawn without a prepared form
+static void prv_draw_expected(GContext *ctx, GDrawCommandImage *image, GPoint offset,
+                              GSize size, uint8_t *pixels_out) {
+  GDrawCommandImage *scaled = gdraw_command_image_clone(image);
+  gdraw_command_image_scale(scaled, size);
+  prv_fill_background();
+  gdraw_command_image_draw(ctx, scaled, offset);
+  memcpy(pixels_out, fb->buffer, FRAMEBUFFER_SIZE_BYTES);
+  gdraw_command_image_destroy(scaled);
+}
+
+static void prv_draw_prepared(GContext *ctx, GDrawCommandImage *image, GPoint offset,
+                              GSize size, GDrawCommandPrepared *prepared, uint8_t *pixels_out) {
+  prv_fill_background();
+  gdraw_command_image_draw_prepared(ctx, image, offset, size, prepared);
+  memcpy(pixels_out, fb->buffer, FRAMEBUFFER_SIZE_BYTES);
+}
+
+///////////////////////////////////////////////////////////
+// Tests
+
+static const GPoint s_offsets[] = {
+  { 0, 0 },
+  { 31, 47 },
+  { -20, -13 },
+  { 100, 140 },
+};
+
+static const GRect s_clip_boxes[] = {
+  { { 0, 0 }, { DISP_COLS, DISP_ROWS } },
+  { { 3, 5 }, { 61, 33 } },
+  { { 40, 60 }, { 30, 90 } },
+};
+
+static uint8_t s_expected[FRAMEBUFFER_SIZE_BYTES];
+static uint8_t s_actual[FRAMEBUFFER_SIZE_BYTES];
+
+#define NUM_IMAGES (3)
+
+static void prv_create_images(GDrawCommandImage *images[NUM_IMAGES]) {
+  images[0] = prv_create_image();
+  images[1] = weather_app_resource_create_sun();
+  images[2] = weather_app_resource_create_cloud();
+}
+
+static void prv_destroy_images(GDrawCommandImage *images[NUM_IMAGES]) {
+  for (int i = 0; i < NUM_IMAGES; i++) {
+    gdraw_command_image_destroy(images[i]);
+  }
+}
+
+void test_gdraw_command_prepared__draws_like_the_list(void) {
+  GContext *ctx = &s_ctx;
+  GDrawCommandImage *images[NUM_IMAGES];
+  prv_create_images(images);
+
+  for (int i = 0; i < NUM_IMAGES; i++) {
+    GDrawCommandImage *image = images[i];
+    const GSize native_size = gdraw_command_image_get_bounds_size(image);
+    const GSize sizes[] = {
+      native_size,
+      GSize(native_size.w * 2, native_size.h * 2),
+      GSize(native_size.w / 2, (native_size.h * 3) / 4),
+    };
+    GDrawCommandPrepared *prepared = gdraw_command_prepared_create(16 * 1024);
+    cl_assert(prepared);
+
+    uint32_t num_draws = 0;
+    for (int antialiased = 0; antialiased < 2; antialiased++) {
+      for (unsigned int s = 0; s < ARRAY_LENGTH(sizes); s++) {
+        for (unsigned int o = 0; o < ARRAY_LENGTH(s_offsets); o++) {
+          for (unsigned int c = 0; c < ARRAY_LENGTH(s_clip_boxes); c++) {
+            graphics_context_set_antialiased(ctx, antialiased);
+            ctx->draw_state.clip_box = s_clip_boxes[c];
+            ctx->draw_state.drawing_box = GRect(0, 0, DISP_COLS, DISP_ROWS);
+
+            prv_draw_expected(ctx, image, s_offsets[o], sizes[s], s_expected);
+            prv_draw_prepared(ctx, image, s_offsets[o], sizes[s], prepared, s_actual);
+            cl_assert_equal_m(s_actual, s_expected, FRAMEBUFFER_SIZE_BYTES);
+            num_draws++;
+          }
+        }
+      }
+    }
+
+    // Only new sizes and antialiasing modes prepared the list again, not offsets or clip boxes
+    cl_assert_equal_i(prepared->stats.prepares, 2 * ARRAY_LENGTH(sizes));
+    cl_assert_equal_i(prepared->stats.hits, num_draws);
+    cl_assert_equal_i(prepared->stats.fallbacks, 0);
+    gdraw_command_prepared_destroy(prepared);
+  }
+
+  prv_destroy_images(images);
+}
+
+void test_gdraw_command_prepared__invalidated_on_change(void) {
+  GContext *ctx = &s_ctx;
+  graphics_context_set_antialiased(ctx, true);
+  GDrawCommandImage *image = prv_create_image();
+  const GSize size = gdraw_command_image_get_bounds_size(image);
+  GDrawCommandPrepared *prepared = gdraw_command_prepared_create(16 * 1024);
+
+  prv_draw_prepared(ctx, image, GPointZero, size, prepared, s_actual);
+  prv_draw_prepared(ctx, image, GPointZero, size, prepared, s_actual);
+  cl_assert_equal_i(prepared->stats.prepares, 1);
+
+  // Changing a command of the list prepares it again
+  GDrawCommandList *list = gdraw_command_image_get_command_list(image);
+  gdraw_command_set_fill_color(gdraw_command_list_get_command(list, 0), GColorIslamicGreen);
+  gdraw_command_set_point(gdraw_command_list_get_command(list, 2), 0, GPoint(30, 62));
+  gdraw_command_set_hidden(gdraw_command_list_get_command(list, 5), false);
+  prv_draw_expected(ctx, image, GPointZero, size, s_expected);
+  prv_draw_prepared(ctx, image, GPointZero, size, prepared, s_actual);
+  cl_assert_equal_m(s_actual, s_expected, FRAMEBUFFER_SIZE_BYTES);
+  cl_assert_equal_i(prepared->stats.prepares, 2);
+
+  // So does drawing another list
+  GDrawCommandImage *sun = weather_app_resource_create_sun();
+  prv_draw_expected(ctx, sun, GPointZero, size, s_expected);
+  prv_draw_prepared(ctx, sun, GPointZero, size, prepared, s_actual);
+  cl_assert_equal_m(s_actual, s_expected, FRAMEBUFFER_SIZE_BYTES);
+  cl_assert_equal_i(prepared->stats.prepares, 3);
+
+  gdraw_command_prepared_invalidate(prepared);
+  prv_draw_prepared(ctx, sun, GPointZero, size, prepared, s_actual);
+  cl_assert_equal_m(s_actual, s_expected, FRAMEBUFFER_SIZE_BYTES);
+  cl_assert_equal_i(prepared->stats.prepares, 4);
+  cl_assert_equal_i(prepared->stats.hits, 5);
+
+  gdraw_command_prepared_destroy(prepared);
+  gdraw_command_image_destroy(sun);
+  gdraw_command_image_destroy(image);
+}
+
+void test_gdraw_command_prepared__too_large_lists_draw_as_usual(void) {
+  GContext *ctx = &s_ctx;
+  graphics_context_set_antialiased(ctx, true);
+  GDrawCommandImage *image = prv_create_image();
+  const GSize size = GSize(120, 100);
+  GDrawCommandPrepared *prepared = gdraw_command_prepared_create(64);
+
+  prv_draw_expected(ctx, image, GPoint(7, 9), size, s_expected);
+  for (int i = 0; i < 3; i++) {
+    prv_draw_prepared(ctx, image, GPoint(7, 9), size, prepared, s_actual);
+    cl_assert_equal_m(s_actual, s_expected, FRAMEBUFFER_SIZE_BYTES);
+  }
+
+  // It's only tried once
+  cl_assert_equal_i(prepared->stats.prepares, 1);
+  cl_assert_equal_i(prepared->stats.fallbacks, 3);
+  cl_assert_equal_i(prepared->stats.hits, 0);
+
+  gdraw_command_prepared_destroy(prepared);
+  gdraw_command_image_destroy(image);
+}
+
+void test_gdraw_command_prepared__frames(void) {
+  GContext *ctx = &s_ctx;
+  graphics_context_set_antialiased(ctx, true);
+  GDrawCommandImage *image = prv_create_image();
+
+  // A sequence of one frame with the commands of the image
+  const size_t list_size = gdraw_command_list_get_data_size(&image->command_list);
+  GDrawCommandSequence *sequence = malloc(sizeof(GDrawCommandSequence) +
+                                          sizeof(GDrawCommandFrame) + list_size);
+  *sequence = (GDrawCommandSequence) {
+    .version = 1,
+    .size = image->size,
+    .num_frames = 1,
+  };
+  GDrawCommandFrame *frame = &sequence->frames[0];
+  frame->duration = 33;
+  memcpy(&frame->command_list, &image->command_list, list_size);
+
+  GDrawCommandPrepared *prepared = gdraw_command_prepared_create(16 * 1024);
+  const GSize size = GSize(100, 60);
+  prv_draw_expected(ctx, image, GPoint(5, 20), size, s_expected);
+  prv_fill_background();
+  gdraw_command_frame_draw_prepared(ctx, sequence, frame, GPoint(5, 20), size, prepared);
+  cl_assert_equal_m(fb->buffer, s_expected, FRAMEBUFFER_SIZE_BYTES);
+  cl_assert_equal_i(prepared->stats.hits, 1);
+
+  gdraw_command_prepared_destroy(prepared);
+  free(sequence);
+  gdraw_command_image_destroy(image);
+}
+
+// Draws the images over and over like an animation does, with and without their prepared forms
+void test_gdraw_command_prepared__draws_per_second(void) {
+  GContext *ctx = &s_ctx;
+  graphics_context_set_antialiased(ctx, true);
+  GDrawCommandImage *images[NUM_IMAGES];
+  prv_create_images(images);
+  GDrawCommandPrepared *prepared[NUM_IMAGES];
+  for (int i = 0; i < NUM_IMAGES; i++) {
+    prepared[i] = gdraw_command_prepared_create(16 * 1024);
+  }
+  const int num_frames = 300;
+
+  uint64_t elapsed_us[2];
+  for (int use_prepared = 0; use_prepared < 2; use_prepared++) {
+    const uint64_t start_us = prv_now_us();
+    for (int frame = 0; frame < num_frames; frame++) {
+      for (int i = 0; i < NUM_IMAGES; i++) {
+        const GPoint offset = GPoint(i * 30, frame % 60);
+        if (use_prepared) {
+          gdraw_command_image_draw_prepared(ctx, images[i], offset,
+                                            gdraw_command_image_get_bounds_size(images[i]),
+                                            prepared[i]);
+        } else {
+          gdraw_command_image_draw(ctx, images[i], offset);
+        }
+      }
+    }
+    elapsed_us[use_prepared] = MAX(prv_now_us() - start_us, 1);
+  }
+
+  const uint64_t num_draws = num_frames * NUM_IMAGES;
+  printf("%"PRIu64" draws: %"PRIu64" draws/sec from the lists, %"PRIu64" draws/sec prepared\n",
+         num_draws, (num_draws * 1000000) / elapsed_us[0], (num_draws * 1000000) / elapsed_us[1]);
+
+  // Every image was prepared once, the offsets didn't matter
+  for (int i = 0; i < NUM_IMAGES; i++) {
+    cl_assert_equal_i(prepared[i]->stats.prepares, 1);
+    cl_assert_equal_i(prepared[i]->stats.hits, num_frames);
+    gdraw_command_prepared_destroy(prepared[i]);
+  }
+  prv_destroy_images(images);
+}
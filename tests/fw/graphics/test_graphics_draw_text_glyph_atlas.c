@@ -0,0 +1,319 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clar.h"
+#include "fixtures/load_test_resources.h"
+
+#include "applib/fonts/fonts_private.h"
+#include "applib/graphics/framebuffer.h"
+#include "applib/graphics/graphics.h"
+#include "applib/graphics/gtypes.h"
+#include "applib/graphics/text.h"
+#include "applib/graphics/text_render.h"
+#include "applib/graphics/text_resources.h"
+#include "resource/resource_ids.auto.h"
+#include "pbl/util/size.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+// Helper Functions
+////////////////////////////////////
+#include "test_graphics.h"
+#include "8bit/test_framebuffer.h"
+#include "util.h"
+
+///////////////////////////////////////////////////////////
+// Stubs
+#include "stubs_analytics.h"
+#include "stubs_app_state.h"
+#include "stubs_applib_resource.h"
+#include "stubs_bootbits.h"
+#include "stubs_heap.h"
+#include "stubs_logging.h"
+#include "stubs_memory_layout.h"
+#include "stubs_mutex.h"
+#include "stubs_passert.h"
+#include "stubs_pbl_malloc.h"
+#include "stubs_print.h"
+#include "stubs_prompt.h"
+#include "stubs_serial.h"
+#include "stubs_sleep.h"
+#include "stubs_syscall_internal.h"
+#include "stubs_syscalls.h"
+#include "stubs_system_reset.h"
+#include "stubs_task_watchdog.h"
+#include "stubs_ui_window.h"
+#include "stubs_unobstructed_area.h"
+
+///////////////////////////////////////////////////////////
+// Fakes
+#include "fake_gbitmap_get_data_row.h"
+#include "fake_pebble_tasks.h"
+
+static FrameBuffer *fb = NULL;
+static GContext s_ctx;
+static GlyphAtlas s_glyph_atlas;
+
+#define NUM_FONTS (3)
+static FontInfo s_fonts[NUM_FONTS];
+
+// Setup
+void test_graphics_draw_text_glyph_atlas__initialize(void) {
+  s_fake_data_row_handling = false;
+  fb = malloc(sizeof(FrameBuffer));
+  framebuffer_init(fb, &(GSize) {DISP_COLS, DISP_ROWS});
+
+  fake_spi_flash_init(0, 0x1000000);
+  pfs_init(false);
+  pfs_format(true /* write erase headers */);
+  load_resource_fixture_in_flash(RESOURCES_FIXTURE_PATH, SYSTEM_RESOURCES_FIXTURE_NAME,
+                                 false /* is_next */);
+  resource_init();
+
+  const uint32_t font_ids[NUM_FONTS] = {
+    RESOURCE_ID_GOTHIC_14, RESOURCE_ID_GOTHIC_24_BOLD, RESOURCE_ID_GOTHIC_28,
+  };
+  for (int i = 0; i < NUM_FONTS; i++) {
+    memset(&s_fonts[i], 0, sizeof(s_fonts[i]));
+    cl_assert(text_resources_init_font(0, font_ids[i], 0, &s_fonts[i]));
+  }
+
+  test_graphics_context_init(&s_ctx, fb);
+  text_resources_init_glyph_atlas(&s_glyph_atlas);
+}
+
+// Teardown
+void test_graphics_draw_text_glyph_atlas__cleanup(void) {
+  s_fake_data_row_handling = false;
+  free(fb);
+}
+
+///////////////////////////////////////////////////////////
+// Helpers
+
+static void prv_set_glyph_atlas(GContext *ctx, bool use_atlas) {
+  ctx->font_cache.glyph_atlas = use_atlas ? &s_glyph_atlas : NULL;
+}
+
+//! Fills the framebuffer with stripes, so the pixels around the glyphs have to be kept
+static void prv_fill_background(void) {
+  for (int i = 0; i < FRAMEBUFFER_SIZE_BYTES; i++) {
+    fb->buffer[i] = (i % 7) ? GColorWhiteARGB8 : GColorCobaltBlueARGB8;
+  }
+}
+
+static void prv_draw(GContext *ctx, const char *text, FontInfo *font, GRect box,
+                     uint8_t *pixels_out) {
+  prv_fill_background();
+  graphics_draw_text(ctx, text, font, box, GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
+  memcpy(pixels_out, fb->buffer, FRAMEBUFFER_SIZE_BYTES);
+}
+
+static uint64_t prv_now_us(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ((uint64_t)tv.tv_sec * 1000000) + tv.tv_usec;
+}
+
+///////////////////////////////////////////////////////////
+// Tests
+
+static const char *s_texts[] = {
+  "12:45",
+  "The quick brown fox jumps over the lazy dog. 0123456789 !?@#$%&*()[]{}",
+  "Grüße aus Zürich, ça va? ¡Olé! Ærøskøbing",
+  "Messages can get long and wrap over a number of lines, some of which get clipped",
+};
+
+static const GRect s_boxes[] = {
+  { { 0, 0 }, { DISP_COLS, DISP_ROWS } },
+  { { -7, -9 }, { DISP_COLS, DISP_ROWS } },
+  { { 13, 40 }, { 120, 200 } },
+};
+
+static const GRect s_clip_boxes[] = {
+  { { 0, 0 }, { DISP_COLS, DISP_ROWS } },
+  { { 3, 5 }, { 61, 33 } },
+  { { 20, 40 }, { 100, 60 } },
+};
+
+static const GColor8 s_text_colors[] = {
+  { .argb = GColorBlackARGB8 },
+  { .argb = GColorRedARGB8 },
+  //! Translucent, blended with what's underneath
+  { .argb = (GColorRedARGB8 & 0x3f) | (2 << 6) },
+  { .argb = GColorClearARGB8 },
+};
+
+static const GCompOp s_compositing_modes[] = { GCompOpAssign, GCompOpSet };
+
+static uint8_t s_expected[FRAMEBUFFER_SIZE_BYTES];
+static uint8_t s_actual[FRAMEBUFFER_SIZE_BYTES];
+
+void test_graphics_draw_text_glyph_atlas__draws_like_the_glyph_bits(void) {
+  GContext *ctx = &s_ctx;
+  int num_draws = 0;
+
+  for (int data_rows = 0; data_rows < 2; data_rows++) {
+    // The second time around only part of each row is drawable, like on a round display
+    s_fake_data_row_handling = (data_rows == 1);
+    for (int font = 0; font < NUM_FONTS; font++) {
+      for (unsigned int t = 0; t < ARRAY_LENGTH(s_texts); t++) {
+        for (unsigned int b = 0; b < ARRAY_LENGTH(s_boxes); b++) {
+          for (unsigned int c = 0; c < ARRAY_LENGTH(s_clip_boxes); c++) {
+            for (unsigned int color = 0; color < ARRAY_LENGTH(s_text_colors); color++) {
+              for (unsigned int m = 0; m < ARRAY_LENGTH(s_compositing_modes); m++) {
+                ctx->draw_state.clip_box = s_clip_boxes[c];
+                ctx->draw_state.drawing_box = GRect(0, 0, DISP_COLS, DISP_ROWS);
+                ctx->draw_state.text_color = s_text_colors[color];
+                ctx->draw_state.compositing_mode = s_compositing_modes[m];
+
+                prv_set_glyph_atlas(ctx, false);
+                prv_draw(ctx, s_texts[t], &s_fonts[font], s_boxes[b], s_expected);
+                prv_set_glyph_atlas(ctx, true);
+                prv_draw(ctx, s_texts[t], &s_fonts[font], s_boxes[b], s_actual);
+                cl_assert_equal_m(s_actual, s_expected, FRAMEBUFFER_SIZE_BYTES);
+                num_draws++;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // All the fonts didn't fit, so the atlas started over along the way
+  printf("%d draws: %"PRIu32" glyphs from the atlas, %"PRIu32" expanded, %"PRIu32" resets\n",
+         num_draws, s_glyph_atlas.stats.hits, s_glyph_atlas.stats.misses,
+         s_glyph_atlas.stats.resets);
+  cl_assert(s_glyph_atlas.stats.hits > 0);
+  cl_assert(s_glyph_atlas.stats.resets > 0);
+}
+
+void test_graphics_draw_text_glyph_atlas__only_system_latin_glyphs(void) {
+  GContext *ctx = &s_ctx;
+  prv_set_glyph_atlas(ctx, true);
+
+  cl_assert(text_resources_get_atlas_glyph(&ctx->font_cache, 'a', &s_fonts[0]));
+  cl_assert(text_resources_get_atlas_glyph(&ctx->font_cache, 0xE9 /* é */, &s_fonts[0]));
+  cl_assert_equal_i(s_glyph_atlas.stats.misses, 2);
+  cl_assert(text_resources_get_atlas_glyph(&ctx->font_cache, 'a', &s_fonts[0]));
+  cl_assert_equal_i(s_glyph_atlas.stats.hits, 1);
+
+  // Glyphs from language packs can change
+  cl_assert(!text_resources_get_atlas_glyph(&ctx->font_cache, 0x4E50 /* 乐 */, &s_fonts[0]));
+
+  // So can the fonts of apps
+  FontInfo app_font = s_fonts[0];
+  app_font.base.app_num = 1;
+  cl_assert(!text_resources_get_atlas_glyph(&ctx->font_cache, 'a', &app_font));
+
+  // Contexts without an atlas draw every glyph from its bits
+  prv_set_glyph_atlas(ctx, false);
+  cl_assert(!text_resources_get_atlas_glyph(&ctx->font_cache, 'a', &s_fonts[0]));
+}
+
+void test_graphics_draw_text_glyph_atlas__app_allocates_atlas_on_first_use(void) {
+  GContext *ctx = &s_ctx;
+  prv_set_glyph_atlas(ctx, false);
+  const GRect box = { { 0, 0 }, { DISP_COLS, DISP_ROWS } };
+
+  // The kernel's contexts that don't have an atlas don't get one
+  graphics_draw_text(ctx, "12:45", &s_fonts[0], box, GTextOverflowModeWordWrap,
+                     GTextAlignmentLeft, NULL);
+  cl_assert_equal_p(ctx->font_cache.glyph_atlas, NULL);
+
+  s_app_state_get_graphics_context = ctx;
+  stub_pebble_tasks_set_current(PebbleTask_App);
+
+  // Neither does the app until it draws a glyph that goes in the atlas
+  graphics_draw_text(ctx, "\xe4\xb9\x90" /* 乐 */, &s_fonts[0], box, GTextOverflowModeWordWrap,
+                     GTextAlignmentLeft, NULL);
+  cl_assert_equal_p(ctx->font_cache.glyph_atlas, NULL);
+
+  graphics_draw_text(ctx, "12:45", &s_fonts[0], box, GTextOverflowModeWordWrap,
+                     GTextAlignmentLeft, NULL);
+  GlyphAtlas *atlas = ctx->font_cache.glyph_atlas;
+  cl_assert(atlas);
+  cl_assert_equal_i(atlas->stats.misses, 5);
+  cl_assert_equal_i(atlas->stats.hits, 0);
+
+  // Later draws use the same atlas
+  graphics_draw_text(ctx, "12:45", &s_fonts[0], box, GTextOverflowModeWordWrap,
+                     GTextAlignmentLeft, NULL);
+  cl_assert_equal_p(ctx->font_cache.glyph_atlas, atlas);
+  cl_assert_equal_i(atlas->stats.hits, 5);
+
+  stub_pebble_tasks_set_current(PebbleTask_KernelMain);
+  s_app_state_get_graphics_context = NULL;
+  prv_set_glyph_atlas(ctx, false);
+  free(atlas);
+}
+
+// Apps that don't get an atlas, like third-party ones, keep drawing the glyphs from their bits
+void test_graphics_draw_text_glyph_atlas__app_without_atlas(void) {
+  GContext *ctx = &s_ctx;
+  prv_set_glyph_atlas(ctx, false);
+  const GRect box = { { 0, 0 }, { DISP_COLS, DISP_ROWS } };
+
+  prv_draw(ctx, "12:45", &s_fonts[0], box, s_expected);
+
+  s_app_state_get_graphics_context = ctx;
+  stub_pebble_tasks_set_current(PebbleTask_App);
+  app_state_get_text_render_state()->glyph_atlas_unavailable = true;
+
+  prv_draw(ctx, "12:45", &s_fonts[0], box, s_actual);
+  cl_assert_equal_p(ctx->font_cache.glyph_atlas, NULL);
+  cl_assert_equal_m(s_actual, s_expected, FRAMEBUFFER_SIZE_BYTES);
+
+  app_state_get_text_render_state()->glyph_atlas_unavailable = false;
+  stub_pebble_tasks_set_current(PebbleTask_KernelMain);
+  s_app_state_get_graphics_context = NULL;
+}
+
+// Draws the glyphs of a clock face and a status bar over and over, with and without the atlas
+void test_graphics_draw_text_glyph_atlas__glyphs_per_second(void) {
+  static const char *s_clock_glyphs = "0123456789:APM Mon Tue Wed 12 Oct 100%";
+  GContext *ctx = &s_ctx;
+  graphics_context_set_text_color(ctx, GColorBlack);
+  const int num_frames = 200;
+  const int glyph_w = 16;
+  const int glyph_h = 30;
+
+  uint64_t elapsed_us[2];
+  unsigned int num_glyphs = 0;
+  for (int use_atlas = 0; use_atlas < 2; use_atlas++) {
+    prv_set_glyph_atlas(ctx, use_atlas);
+    // Warm up the glyph cache and the atlas, only drawing is measured
+    for (const char *c = s_clock_glyphs; *c; c++) {
+      render_glyph(ctx, *c, &s_fonts[2], GRect(0, 0, glyph_w, glyph_h));
+    }
+
+    num_glyphs = 0;
+    const uint64_t start_us = prv_now_us();
+    for (int frame = 0; frame < num_frames; frame++) {
+      int x = 0;
+      int y = 0;
+      for (const char *c = s_clock_glyphs; *c; c++) {
+        render_glyph(ctx, *c, &s_fonts[(frame + y) % NUM_FONTS], GRect(x, y, glyph_w, glyph_h));
+        num_glyphs++;
+        x += glyph_w;
+        if (x + glyph_w > DISP_COLS) {
+          x = 0;
+          y += glyph_h;
+        }
+      }
+    }
+    elapsed_us[use_atlas] = MAX(prv_now_us() - start_us, 1);
+  }
+
+  printf("%u glyphs: %"PRIu64" glyphs/sec from their bits, %"PRIu64" glyphs/sec from the atlas\n",
+         num_glyphs, (num_glyphs * (uint64_t)1000000) / elapsed_us[0],
+         (num_glyphs * (uint64_t)1000000) / elapsed_us[1]);
+
+  // Every glyph after the warm up came from the atlas
+  cl_assert_equal_i(s_glyph_atlas.stats.resets, 0);
+  cl_assert(s_glyph_atlas.stats.hits >= num_glyphs - s_glyph_atlas.stats.misses);
+}
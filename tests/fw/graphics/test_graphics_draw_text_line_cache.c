@@ -0,0 +1,315 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clar.h"
+#include "fixtures/load_test_resources.h"
+
+#include "applib/fonts/fonts_private.h"
+#include "applib/graphics/framebuffer.h"
+#include "applib/graphics/graphics.h"
+#include "applib/graphics/gtypes.h"
+#include "applib/graphics/text.h"
+#include "applib/graphics/text_layout_private.h"
+#include "applib/graphics/text_resources.h"
+#include "resource/resource_ids.auto.h"
+#include "pbl/util/size.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Helper Functions
+////////////////////////////////////
+#include "test_graphics.h"
+#include "8bit/test_framebuffer.h"
+#include "util.h"
+
+///////////////////////////////////////////////////////////
+// Stubs
+#include "stubs_analytics.h"
+#include "stubs_app_state.h"
+#include "stubs_applib_resource.h"
+#include "stubs_bootbits.h"
+#include "stubs_heap.h"
+#include "stubs_logging.h"
+#include "stubs_memory_layout.h"
+#include "stubs_mutex.h"
+#include "stubs_passert.h"
+#include "stubs_pbl_malloc.h"
+#include "stubs_pebble_tasks.h"
+#include "stubs_print.h"
+#include "stubs_prompt.h"
+#include "stubs_serial.h"
+#include "stubs_sleep.h"
+#include "stubs_syscall_internal.h"
+#include "stubs_syscalls.h"
+#include "stubs_system_reset.h"
+#include "stubs_task_watchdog.h"
+#include "stubs_ui_window.h"
+#include "stubs_unobstructed_area.h"
+
+///////////////////////////////////////////////////////////
+// Fakes
+#include "fake_gbitmap_get_data_row.h"
+
+//! Counts the glyph metric lookups done to lay out and draw text
+static uint32_t s_glyph_metric_lookups;
+
+int8_t text_resources_get_glyph_horiz_advance(FontCache *font_cache, const Codepoint codepoint,
+                                              FontInfo *font_info) {
+  s_glyph_metric_lookups++;
+  const GlyphData *glyph = text_resources_get_glyph(font_cache, codepoint, font_info);
+  return glyph ? glyph->header.horiz_advance : 0;
+}
+
+static FrameBuffer *fb = NULL;
+static GContext s_ctx;
+static FontInfo s_font_info;
+
+// Setup
+void test_graphics_draw_text_line_cache__initialize(void) {
+  s_fake_data_row_handling = false;
+  fb = malloc(sizeof(FrameBuffer));
+  framebuffer_init(fb, &(GSize) {DISP_COLS, DISP_ROWS});
+
+  fake_spi_flash_init(0, 0x1000000);
+  pfs_init(false);
+  pfs_format(true /* write erase headers */);
+  load_resource_fixture_in_flash(RESOURCES_FIXTURE_PATH, SYSTEM_RESOURCES_FIXTURE_NAME,
+                                 false /* is_next */);
+  resource_init();
+
+  memset(&s_font_info, 0, sizeof(s_font_info));
+  cl_assert(text_resources_init_font(0, RESOURCE_ID_GOTHIC_18_BOLD, 0, &s_font_info));
+
+  test_graphics_context_init(&s_ctx, fb);
+  graphics_context_set_text_color(&s_ctx, GColorBlack);
+}
+
+// Teardown
+void test_graphics_draw_text_line_cache__cleanup(void) {
+  free(fb);
+}
+
+///////////////////////////////////////////////////////////
+// Helpers
+
+//! What every call cost before the lines were cached: all of them are laid out again
+static void prv_forget_lines(GContext *ctx) {
+  memset(&ctx->text_draw_state.line_cache, 0, sizeof(ctx->text_draw_state.line_cache));
+}
+
+static void prv_set_clip_box(GContext *ctx, GRect clip_box) {
+  ctx->draw_state.clip_box = clip_box;
+  ctx->draw_state.drawing_box = GRect(0, 0, DISP_COLS, DISP_ROWS);
+}
+
+//! Draws text into a cleared framebuffer and keeps a copy of the result
+static void prv_draw(GContext *ctx, const char *text, GRect box, GTextOverflowMode overflow_mode,
+                     GTextAlignment alignment, GTextLayoutCacheRef layout, uint8_t *pixels_out) {
+  memset(fb->buffer, GColorWhiteARGB8, FRAMEBUFFER_SIZE_BYTES);
+  graphics_draw_text(ctx, text, &s_font_info, box, overflow_mode, alignment, layout);
+  memcpy(pixels_out, fb->buffer, FRAMEBUFFER_SIZE_BYTES);
+}
+
+///////////////////////////////////////////////////////////
+// Tests
+
+static const char *s_texts[] = {
+  "Text Clipping",
+  "The quick brown fox jumps over the lazy dog while the cat watches from the window sill",
+  "Supercalifragilisticexpialidocious words need hyphens",
+  "Line one\nLine two\n\nLine four after an empty line\n",
+  "   Leading and trailing spaces   ",
+  "Messages can get long. This one has enough words in it to wrap over more lines than the "
+  "line cache keeps, so that drawing the end of it has to lay the text out again. It goes on "
+  "and on for a while longer, just to be sure.",
+};
+
+static const GSize s_box_sizes[] = {
+  { 30, 40 }, { 72, 32 }, { 72, 1000 }, { 140, 50 }, { DISP_COLS, DISP_ROWS },
+};
+
+static const GRect s_clip_boxes[] = {
+  { { 0, 0 }, { DISP_COLS, DISP_ROWS } },
+  { { 0, 0 }, { DISP_COLS, 30 } },
+  { { 20, 40 }, { 100, 60 } },
+};
+
+static const GTextOverflowMode s_overflow_modes[] = {
+  GTextOverflowModeWordWrap, GTextOverflowModeTrailingEllipsis, GTextOverflowModeFill,
+};
+
+static const GTextAlignment s_alignments[] = {
+  GTextAlignmentLeft, GTextAlignmentCenter, GTextAlignmentRight,
+};
+
+static uint8_t s_expected[FRAMEBUFFER_SIZE_BYTES];
+static uint8_t s_actual[FRAMEBUFFER_SIZE_BYTES];
+
+void test_graphics_draw_text_line_cache__draws_like_a_fresh_layout(void) {
+  GContext *ctx = &s_ctx;
+  GTextLayoutCacheRef layout;
+  graphics_text_layout_cache_init(&layout);
+
+  for (unsigned int t = 0; t < ARRAY_LENGTH(s_texts); t++) {
+    for (unsigned int b = 0; b < ARRAY_LENGTH(s_box_sizes); b++) {
+      for (unsigned int o = 0; o < ARRAY_LENGTH(s_overflow_modes); o++) {
+        for (unsigned int a = 0; a < ARRAY_LENGTH(s_alignments); a++) {
+          const char *text = s_texts[t];
+          const GTextOverflowMode overflow_mode = s_overflow_modes[o];
+          const GTextAlignment alignment = s_alignments[a];
+          const GRect box = { GPoint(4, 6), s_box_sizes[b] };
+          const GRect moved_box = { GPoint(-3, 22), s_box_sizes[b] };
+
+          // The size doesn't change once the lines are cached
+          prv_set_clip_box(ctx, s_clip_boxes[0]);
+          prv_forget_lines(ctx);
+          const GSize expected_size = graphics_text_layout_get_max_used_size(
+              ctx, text, &s_font_info, box, overflow_mode, alignment, NULL);
+          const GSize size = graphics_text_layout_get_max_used_size(
+              ctx, text, &s_font_info, box, overflow_mode, alignment, NULL);
+          cl_assert_equal_i(size.w, expected_size.w);
+          cl_assert_equal_i(size.h, expected_size.h);
+
+          for (unsigned int c = 0; c < ARRAY_LENGTH(s_clip_boxes); c++) {
+            // Starting with what a smaller clip box cached, at another position on screen
+            prv_set_clip_box(ctx, s_clip_boxes[(c + 1) % ARRAY_LENGTH(s_clip_boxes)]);
+            prv_forget_lines(ctx);
+            prv_draw(ctx, text, moved_box, overflow_mode, alignment, NULL, s_actual);
+
+            // Drawn twice, the second time with the lines the first time cached
+            prv_set_clip_box(ctx, s_clip_boxes[c]);
+            prv_draw(ctx, text, box, overflow_mode, alignment, layout, s_actual);
+            prv_draw(ctx, text, box, overflow_mode, alignment, layout, s_actual);
+            const GSize cached_max_used_size = layout->max_used_size;
+
+            // Compared with laying out everything again
+            prv_forget_lines(ctx);
+            prv_draw(ctx, text, box, overflow_mode, alignment, layout, s_expected);
+            cl_assert_equal_m(s_actual, s_expected, FRAMEBUFFER_SIZE_BYTES);
+            cl_assert_equal_i(cached_max_used_size.w, layout->max_used_size.w);
+            cl_assert_equal_i(cached_max_used_size.h, layout->max_used_size.h);
+          }
+        }
+      }
+    }
+  }
+
+  graphics_text_layout_cache_deinit(&layout);
+}
+
+///////////////////////////////////////////////////////////
+// Benchmarks
+
+#define NUM_FRAMES (10)
+
+typedef struct {
+  GRect box;
+  GTextOverflowMode overflow_mode;
+} ClippingScene;
+
+//! The boxes of the test_graphics_draw_text clipping scenes, on screen within the clip box of
+//! their 80x40 layer at (40, 40)
+static const ClippingScene s_clipping_scenes[] = {
+  { { { -44, 0 }, { 72, 32 } }, GTextOverflowModeTrailingEllipsis },
+  { { { 0, -25 }, { 100, 32 } }, GTextOverflowModeTrailingEllipsis },
+  { { { 4, -18 }, { 72, 32 } }, GTextOverflowModeTrailingEllipsis },
+  { { { 4, 20 }, { 72, 32 } }, GTextOverflowModeTrailingEllipsis },
+  { { { -44, 4 }, { 72, 32 } }, GTextOverflowModeTrailingEllipsis },
+  { { { 34, 4 }, { 72, 32 } }, GTextOverflowModeTrailingEllipsis },
+  { { { 4, -18 }, { 72, 32 } }, GTextOverflowModeWordWrap },
+  { { { 4, -46 }, { 72, 50 } }, GTextOverflowModeWordWrap },
+  { { { 4, 20 }, { 72, 32 } }, GTextOverflowModeWordWrap },
+  { { { 4, -10 }, { 72, 50 } }, GTextOverflowModeWordWrap },
+  { { { -44, 4 }, { 72, 32 } }, GTextOverflowModeWordWrap },
+  { { { 34, 4 }, { 72, 32 } }, GTextOverflowModeWordWrap },
+};
+
+static uint32_t prv_run_clipping_scenes(bool cache_lines) {
+  GContext *ctx = &s_ctx;
+  const GRect layer_frame = GRect(40, 40, 80, 40);
+  s_glyph_metric_lookups = 0;
+  for (int frame = 0; frame < NUM_FRAMES; frame++) {
+    for (unsigned int i = 0; i < ARRAY_LENGTH(s_clipping_scenes); i++) {
+      if (!cache_lines) {
+        prv_forget_lines(ctx);
+      }
+      ctx->draw_state.clip_box = layer_frame;
+      ctx->draw_state.drawing_box = layer_frame;
+      graphics_draw_text(ctx, "Text Clipping", &s_font_info, s_clipping_scenes[i].box,
+                         s_clipping_scenes[i].overflow_mode, GTextAlignmentCenter, NULL);
+    }
+  }
+  return s_glyph_metric_lookups;
+}
+
+//! A notification body in a text layer that asks for its content size every frame
+static uint32_t prv_run_notification(bool cache_lines) {
+  GContext *ctx = &s_ctx;
+  GTextLayoutCacheRef layout;
+  graphics_text_layout_cache_init(&layout);
+  const char *body = "Running late, the train is stuck outside the station. Start without me "
+                     "and I'll catch up with you at the restaurant.";
+  const GRect box = GRect(0, 0, DISP_COLS - 10, 2000);
+  s_glyph_metric_lookups = 0;
+  for (int frame = 0; frame < NUM_FRAMES; frame++) {
+    if (!cache_lines) {
+      prv_forget_lines(ctx);
+      // The layout would be refreshed on a change of the box origin anyway
+      layout->hash = 0;
+    }
+    prv_set_clip_box(ctx, GRect(0, 0, DISP_COLS, DISP_ROWS));
+    const GSize size = graphics_text_layout_get_max_used_size(
+        ctx, body, &s_font_info, box, GTextOverflowModeWordWrap, GTextAlignmentLeft, layout);
+    graphics_draw_text(ctx, body, &s_font_info, GRect(5, 30, box.size.w, size.h),
+                       GTextOverflowModeWordWrap, GTextAlignmentLeft, layout);
+  }
+  graphics_text_layout_cache_deinit(&layout);
+  return s_glyph_metric_lookups;
+}
+
+//! The visible rows of a menu with titles and subtitles, redrawn as the selection moves
+static uint32_t prv_run_menu(bool cache_lines) {
+  GContext *ctx = &s_ctx;
+  static const char *s_rows[][2] = {
+    { "Alarms", "2 enabled" },
+    { "Notifications", "Vibrate, 5 min" },
+    { "Quiet Time", "Off until 22:00" },
+    { "Display", "Backlight, timeout" },
+  };
+  const int16_t row_height = 56;
+  s_glyph_metric_lookups = 0;
+  for (int frame = 0; frame < NUM_FRAMES; frame++) {
+    if (!cache_lines) {
+      prv_forget_lines(ctx);
+    }
+    prv_set_clip_box(ctx, GRect(0, 0, DISP_COLS, DISP_ROWS));
+    for (unsigned int row = 0; row < ARRAY_LENGTH(s_rows); row++) {
+      const int16_t y = 4 + (row * row_height);
+      graphics_draw_text(ctx, s_rows[row][0], &s_font_info, GRect(6, y, DISP_COLS - 12, 24),
+                         GTextOverflowModeTrailingEllipsis, GTextAlignmentLeft, NULL);
+      graphics_draw_text(ctx, s_rows[row][1], &s_font_info, GRect(6, y + 24, DISP_COLS - 12, 24),
+                         GTextOverflowModeTrailingEllipsis, GTextAlignmentLeft, NULL);
+    }
+  }
+  return s_glyph_metric_lookups;
+}
+
+void test_graphics_draw_text_line_cache__glyph_metric_lookups(void) {
+  static const struct {
+    const char *name;
+    uint32_t (*run)(bool cache_lines);
+  } s_benchmarks[] = {
+    { "clipping scenes", prv_run_clipping_scenes },
+    { "notification", prv_run_notification },
+    { "menu", prv_run_menu },
+  };
+
+  for (unsigned int i = 0; i < ARRAY_LENGTH(s_benchmarks); i++) {
+    const uint32_t uncached = s_benchmarks[i].run(false /* cache_lines */);
+    const uint32_t cached = s_benchmarks[i].run(true /* cache_lines */);
+    printf("%-16s %d frames: %6"PRIu32" glyph metric lookups laying out every call, "
+           "%6"PRIu32" with cached lines\n", s_benchmarks[i].name, NUM_FRAMES, uncached, cached);
+    cl_assert(cached * 3 < uncached * 2);
+  }
+}
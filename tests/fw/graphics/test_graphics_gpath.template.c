@@ -6,10 +6,13 @@
 #include "applib/graphics/gtypes.h"
 #include "applib/graphics/graphics.h"
 #include "applib/graphics/gpath.h"
+#include "pbl/util/size.h"
 #include "pbl/util/trig.h"
 #include "applib/ui/ui.h"
 
+#include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 
 // Helper Functions
 ////////////////////////////////////
@@ -444,3 +447,118 @@ void test_graphics_gpath_8bit__clipping_aa(void) {
   // Safety
   s_path_angle = 0;
 }
+
+#define MAX_POLYGON_POINTS (64)
+
+//! Fills in the points of a polygon around the origin. With a smaller inner radius every other
+//! point is pulled in to make a star, with a step > 1 the outline skips ahead and crosses itself.
+static void prv_polygon_path_info(GPathInfo *info, uint32_t num_points, int16_t outer_radius,
+                                  int16_t inner_radius, uint32_t step) {
+  static GPoint s_points[MAX_POLYGON_POINTS];
+  for (uint32_t i = 0; i < num_points; i++) {
+    const int32_t angle = (i * step * TRIG_MAX_ANGLE) / num_points;
+    const int32_t radius = (i % 2) ? inner_radius : outer_radius;
+    s_points[i] = GPoint((sin_lookup(angle) * radius) / TRIG_MAX_RATIO,
+                         (-cos_lookup(angle) * radius) / TRIG_MAX_RATIO);
+  }
+  *info = (GPathInfo) { .num_points = num_points, .points = s_points };
+}
+
+//! A grid of regular polygons, stars and self-crossing outlines of 4 to 64 points, some of them
+//! hanging off the edges of the clip box
+static void prv_polygons_update_proc(Layer *layer, GContext *ctx) {
+  static const uint32_t s_num_points[] = { 4, 5, 6, 7, 8, 12, 16, 24, 32, 64 };
+  graphics_context_set_fill_color(ctx, GColorBlack);
+  int cell = 0;
+  for (unsigned int i = 0; i < ARRAY_LENGTH(s_num_points); i++) {
+    for (int shape = 0; shape < 3; shape++, cell++) {
+      const uint32_t num_points = s_num_points[i];
+      GPathInfo info;
+      prv_polygon_path_info(&info, num_points, 20, (shape == 1) ? 9 : 20,
+                            (shape == 2) ? ((num_points - 1) / 2) : 1);
+      GPath path;
+      gpath_init(&path, &info);
+      gpath_move_to(&path, GPoint(((cell % 6) * 38) + 8, ((cell / 6) * 46) + 14));
+      gpath_rotate_to(&path, (cell * TRIG_MAX_ANGLE) / 17);
+      gpath_draw_filled(ctx, &path);
+    }
+  }
+}
+
+//! The reference images were drawn by the filler that intersected every edge with every scanline,
+//! before it was replaced by the active edge table
+void test_graphics_gpath_8bit__filled_polygons(void) {
+  GContext ctx;
+
+  test_graphics_context_init(&ctx, fb);
+  ctx.draw_state.clip_box = GRect(0, 0, DISP_COLS, DISP_ROWS - 20);
+  prv_polygons_update_proc(NULL, &ctx);
+  cl_check(gbitmap_pbi_eq(&ctx.dest_bitmap, "gpath_filled_polygons.8bit.pbi"));
+
+  test_graphics_context_init(&ctx, fb);
+  ctx.draw_state.clip_box = GRect(0, 0, DISP_COLS, DISP_ROWS - 20);
+  graphics_context_set_antialiased(&ctx, true);
+  prv_polygons_update_proc(NULL, &ctx);
+  cl_check(gbitmap_pbi_eq(&ctx.dest_bitmap, "gpath_filled_polygons_aa.8bit.pbi"));
+}
+
+//! Every benchmark is run in rounds, the fastest round counts so other load on the host doesn't
+#define BENCHMARK_NUM_ROUNDS (10)
+#define BENCHMARK_NUM_FRAMES (360)
+
+static void prv_count_spans_cb(GContext *ctx, int16_t y, Fixed_S16_3 x_range_begin,
+                               Fixed_S16_3 x_range_end, Fixed_S16_3 delta_begin,
+                               Fixed_S16_3 delta_end, void *user_data) {
+  (*(uint32_t *)user_data)++;
+}
+
+//! Fills the path while spinning it around, or only finds its spans if count_spans is given
+static double prv_polygons_per_second(GContext *ctx, GPath *path, uint32_t *count_spans) {
+  double best_seconds = 0.0;
+  for (int round = 0; round < BENCHMARK_NUM_ROUNDS; round++) {
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+    for (int frame = 0; frame < BENCHMARK_NUM_FRAMES; frame++) {
+      gpath_rotate_to(path, (frame * TRIG_MAX_ANGLE) / 360);
+      if (count_spans) {
+        gpath_draw_filled_with_cb(ctx, path, prv_count_spans_cb, count_spans);
+      } else {
+        gpath_draw_filled(ctx, path);
+      }
+    }
+    gettimeofday(&end, NULL);
+    const double seconds = (end.tv_sec - start.tv_sec) + ((end.tv_usec - start.tv_usec) / 1e6);
+    if ((round == 0) || (seconds < best_seconds)) {
+      best_seconds = seconds;
+    }
+  }
+  return (best_seconds > 0) ? BENCHMARK_NUM_FRAMES / best_seconds : 0.0;
+}
+
+//! Icon and screen sized stars, like the hands and backgrounds of a watchface, spinning around
+void test_graphics_gpath_8bit__filled_polygons_per_second(void) {
+  static const uint32_t s_num_points[] = { 4, 8, 16, 32, 64 };
+  static const int16_t s_radii[] = { 10, DISP_COLS / 2 };
+  for (unsigned int r = 0; r < ARRAY_LENGTH(s_radii); r++) {
+    for (unsigned int i = 0; i < ARRAY_LENGTH(s_num_points); i++) {
+      GPathInfo info;
+      prv_polygon_path_info(&info, s_num_points[i], s_radii[r], (s_radii[r] * 2) / 3, 1);
+      GPath path;
+      gpath_init(&path, &info);
+      gpath_move_to(&path, GPoint(DISP_COLS / 2, DISP_ROWS / 2));
+
+      GContext ctx;
+      test_graphics_context_init(&ctx, fb);
+      uint32_t num_spans = 0;
+      const double scan_polygons_per_second = prv_polygons_per_second(&ctx, &path, &num_spans);
+      const double polygons_per_second = prv_polygons_per_second(&ctx, &path, NULL);
+      graphics_context_set_antialiased(&ctx, true);
+      const double aa_polygons_per_second = prv_polygons_per_second(&ctx, &path, NULL);
+      printf("radius %3"PRId16", %2"PRIu32" points: %8.0f polygons/sec scanned, "
+             "%8.0f polygons/sec filled, %8.0f polygons/sec antialiased\n", s_radii[r],
+             s_num_points[i], scan_polygons_per_second, polygons_per_second,
+             aa_polygons_per_second);
+      cl_assert(num_spans > 0);
+    }
+  }
+}
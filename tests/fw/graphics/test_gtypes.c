@@ -5,6 +5,7 @@
 
 #include "clar.h"
 #include "pebble_asserts.h"
+#include "pbl/util/size.h"
 
 #include <stdio.h>
 
@@ -165,3 +166,86 @@ void test_gtypes__color_fallback(void) {
 #error "unknown platform"
 #endif
 }
+
+static bool prv_region_covers_grect(const GDirtyRegion *region, const GRect *rect) {
+  for (int y = rect->origin.y; y < rect->origin.y + rect->size.h; y++) {
+    for (int x = rect->origin.x; x < rect->origin.x + rect->size.w; x++) {
+      const GPoint point = GPoint(x, y);
+      bool covered = false;
+      for (unsigned int i = 0; i < region->num_rects; i++) {
+        covered |= grect_contains_point(&region->rects[i], &point);
+      }
+      if (!covered) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void test_gtypes__gdirty_region_keeps_rects_apart(void) {
+  GDirtyRegion region = {};
+  gdirty_region_add(&region, &GRect(0, 0, 10, 10));
+  gdirty_region_add(&region, &GRect(100, 100, 10, 10));
+  gdirty_region_add(&region, &GRect(50, 0, 0, 10));
+  cl_assert_equal_i(region.num_rects, 2);
+  cl_assert_equal_i(gdirty_region_get_area(&region), 200);
+
+  const GRect bounds = gdirty_region_get_bounds(&region);
+  cl_assert_equal_grect(bounds, GRect(0, 0, 110, 110));
+
+  cl_assert(gdirty_region_overlaps_grect(&region, &GRect(105, 105, 20, 20)));
+  cl_assert(!gdirty_region_overlaps_grect(&region, &GRect(20, 20, 50, 50)));
+
+  gdirty_region_reset(&region);
+  cl_assert_equal_i(region.num_rects, 0);
+  cl_assert_equal_grect(gdirty_region_get_bounds(&region), GRectZero);
+}
+
+void test_gtypes__gdirty_region_merges_free_unions(void) {
+  GDirtyRegion region = {};
+  // Contained in what's there already
+  gdirty_region_add(&region, &GRect(0, 0, 20, 20));
+  gdirty_region_add(&region, &GRect(5, 5, 5, 5));
+  cl_assert_equal_i(region.num_rects, 1);
+
+  // Side by side, the union covers nothing extra
+  gdirty_region_add(&region, &GRect(20, 0, 20, 20));
+  cl_assert_equal_i(region.num_rects, 1);
+  cl_assert_equal_grect(region.rects[0], GRect(0, 0, 40, 20));
+
+  // Negative sizes are standardized, this one covers the whole region
+  gdirty_region_add(&region, &GRect(50, 30, -60, -40));
+  cl_assert_equal_i(region.num_rects, 1);
+  cl_assert_equal_grect(region.rects[0], GRect(-10, -10, 60, 40));
+}
+
+void test_gtypes__gdirty_region_merges_cheapest_pair_when_full(void) {
+  GDirtyRegion region = {};
+  GRect added[GDIRTY_REGION_MAX_RECTS + 4];
+  for (unsigned int i = 0; i < ARRAY_LENGTH(added); i++) {
+    // A diagonal of small squares, neighbors are the cheapest to merge
+    added[i] = GRect(i * 20, i * 20, 4, 4);
+    gdirty_region_add(&region, &added[i]);
+    cl_assert(region.num_rects <= GDIRTY_REGION_MAX_RECTS);
+  }
+  cl_assert_equal_i(region.num_rects, GDIRTY_REGION_MAX_RECTS);
+
+  // Nothing got lost and the region stays well below its bounding box
+  for (unsigned int i = 0; i < ARRAY_LENGTH(added); i++) {
+    cl_assert(prv_region_covers_grect(&region, &added[i]));
+  }
+  const GRect bounds = gdirty_region_get_bounds(&region);
+  cl_assert(gdirty_region_get_area(&region) * 4 < (uint32_t)(bounds.size.w * bounds.size.h));
+}
+
+void test_gtypes__gdirty_region_add_region(void) {
+  GDirtyRegion region = {};
+  GDirtyRegion other = {};
+  gdirty_region_add(&region, &GRect(0, 0, 10, 10));
+  gdirty_region_add(&other, &GRect(0, 10, 10, 10));
+  gdirty_region_add(&other, &GRect(200, 0, 10, 10));
+  gdirty_region_add_region(&region, &other);
+  cl_assert_equal_i(region.num_rects, 2);
+  cl_assert_equal_i(gdirty_region_get_area(&region), 300);
+}
@@ -2,12 +2,21 @@
 /* SPDX-License-Identifier: Apache-2.0 */
 
 #include "applib/graphics/gbitmap_png.h"
+#include "tinflate.h"
 
 #include "clar.h"
 #include "util.h"
 
+#include <pbl/util/list.h>
+#include <pbl/util/size.h>
+
 #include <string.h>
 #include <stdio.h>
+#include <sys/time.h>
+
+// Fakes
+////////////////////////////////////
+#include "fake_resource_syscalls.h"
 
 // Stubs
 ////////////////////////////////////
@@ -17,9 +26,76 @@
 #include "stubs_resources.h"
 #include "stubs_syscalls.h"
 #include "stubs_passert.h"
-#include "stubs_pbl_malloc.h"
 #include "stubs_logging.h"
 
+// Heap
+////////////////////////////////////
+// The applib_malloc_task override sends the applib allocations to the task heap as well, so the
+// bytes allocated while decoding can be counted. Bitmaps of the test helpers are malloc'ed and
+// can get freed here too, those aren't counted.
+
+typedef struct HeapAllocation {
+  ListNode node;
+  void *ptr;
+  size_t bytes;
+} HeapAllocation;
+
+static HeapAllocation *s_heap_allocations;
+static size_t s_heap_bytes;
+static size_t s_heap_peak_bytes;
+
+static bool prv_heap_allocation_filter(ListNode *node, void *ptr) {
+  return ((HeapAllocation *)node)->ptr == ptr;
+}
+
+void *task_malloc(size_t bytes) {
+  void *ptr = malloc(bytes);
+  if (ptr) {
+    HeapAllocation *allocation = malloc(sizeof(HeapAllocation));
+    *allocation = (HeapAllocation) { .ptr = ptr, .bytes = bytes };
+    s_heap_allocations = (HeapAllocation *)list_prepend((ListNode *)s_heap_allocations,
+                                                        &allocation->node);
+    s_heap_bytes += bytes;
+    s_heap_peak_bytes = MAX(s_heap_peak_bytes, s_heap_bytes);
+  }
+  return ptr;
+}
+
+void *task_zalloc(size_t bytes) {
+  void *ptr = task_malloc(bytes);
+  if (ptr) {
+    memset(ptr, 0, bytes);
+  }
+  return ptr;
+}
+
+void task_free(void *ptr) {
+  HeapAllocation *allocation =
+      (HeapAllocation *)list_find((ListNode *)s_heap_allocations, prv_heap_allocation_filter, ptr);
+  if (allocation) {
+    s_heap_bytes -= allocation->bytes;
+    list_remove(&allocation->node, (ListNode **)&s_heap_allocations, NULL);
+    free(allocation);
+  }
+  free(ptr);
+}
+
+//! Starts measuring the peak from the bytes that are allocated right now
+static void prv_heap_reset_peak(void) {
+  s_heap_peak_bytes = s_heap_bytes;
+}
+
+//! The munmap_or_free stub frees with free(), so the pixels are freed here to count them
+static void prv_bitmap_destroy(GBitmap *bitmap) {
+  task_free(bitmap->addr);
+  bitmap->info.is_bitmap_heap_allocated = false;
+  gbitmap_destroy(bitmap);
+}
+
+void test_png__cleanup(void) {
+  fake_resource_syscalls_cleanup();
+}
+
 // Tests
 ////////////////////////////////////
 
@@ -194,3 +270,137 @@ void test_png__color_256_colors_check(void) {
   cl_assert(gbitmap_pbi_eq(bitmap, TEST_PBI_FILE_FMT(raw)));
   cl_assert_equal_i(gbitmap_get_format(bitmap), GBitmapFormat8Bit);
 }
+
+// PNG resources are decoded without loading them, streaming the image data
+////////////////////////////////////
+
+static const struct {
+  const char *png;
+  const char *pbi;
+} s_resource_images[] = {
+  { "test_png__color_1_bit.1bitpalette.png", "test_png__color_1_bit.1bitpalette.pbi" },
+  { "test_png__color_1_bit_transparent.1bitpalette.png",
+    "test_png__color_1_bit_transparent.1bitpalette.pbi" },
+  { "test_png__color_2_bit.2bitpalette.png", "test_png__color_2_bit.2bitpalette.pbi" },
+  { "test_png__color_4_bit.4bitpalette.png", "test_png__color_4_bit.4bitpalette.pbi" },
+  { "test_png__color_8_bit.8bit.png", "test_png__color_8_bit.8bit.pbi" },
+  { "test_png__color_8_bit_transparent.8bit.png", "test_png__color_8_bit_transparent.8bit.pbi" },
+  { "test_png__color_256_colors_check.raw.png", "test_png__color_256_colors_check.raw.pbi" },
+  { "test_png__greyscale_1_bit_transparent.1bitpalette.png",
+    "test_png__greyscale_1_bit_transparent.1bitpalette.pbi" },
+  { "test_png__greyscale_2_bit.2bitpalette.png", "test_png__greyscale_2_bit.2bitpalette.pbi" },
+  { "test_png__greyscale_4_bit_transparent.4bitpalette.png",
+    "test_png__greyscale_4_bit_transparent.4bitpalette.pbi" },
+};
+
+//! Decodes a PNG resource the way it was done before streaming: load it, then decode the data
+static GBitmap *prv_create_with_loaded_png_resource(uint32_t resource_id) {
+  const size_t png_size = sys_resource_size(0, resource_id);
+  uint8_t *png_data = task_malloc(png_size);
+  cl_assert_equal_i(sys_resource_load_range(0, resource_id, 0, png_data, png_size), png_size);
+  GBitmap *bitmap = gbitmap_create_from_png_data(png_data, png_size);
+  task_free(png_data);
+  return bitmap;
+}
+
+static uint64_t prv_now_us(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ((uint64_t)tv.tv_sec * 1000000) + tv.tv_usec;
+}
+
+// Tests PNG resources decoded by streaming their image data
+// Result:
+//   - gbitmap matches the PNG decoded from its loaded data, and the platform loaded PNG
+void test_png__resource_matches_data(void) {
+  for (unsigned int i = 0; i < ARRAY_LENGTH(s_resource_images); i++) {
+    const uint32_t resource_id = sys_resource_load_file_as_resource(TEST_IMAGES_PATH,
+                                                                    s_resource_images[i].png);
+    cl_assert(resource_id != UINT32_MAX);
+
+    GBitmap *expected = prv_create_with_loaded_png_resource(resource_id);
+    GBitmap *bitmap = gbitmap_create_with_resource_system(0, resource_id);
+    cl_assert(bitmap);
+    cl_assert_equal_i(gbitmap_get_format(bitmap), gbitmap_get_format(expected));
+    cl_assert(gbitmap_eq(bitmap, expected, s_resource_images[i].png));
+    cl_assert(gbitmap_pbi_eq(bitmap, s_resource_images[i].pbi));
+
+    prv_bitmap_destroy(expected);
+    prv_bitmap_destroy(bitmap);
+  }
+}
+
+// Tests truncated PNG resources fail to decode
+// Result:
+//   - no gbitmap and nothing left allocated
+void test_png__resource_truncated(void) {
+  uint8_t *png_data = NULL;
+  const size_t png_size = load_file("test_png__color_8_bit.8bit.png", &png_data);
+  const char *path = "test_png__resource_truncated.png";
+  FILE *file = fopen(path, "wb");
+  cl_assert(file);
+  // Cut into the image data
+  fwrite(png_data, 1, png_size - 500, file);
+  fclose(file);
+  free(png_data);
+
+  const uint32_t resource_id = sys_resource_load_file_as_resource(NULL, path);
+  const size_t heap_bytes = s_heap_bytes;
+  cl_assert(!gbitmap_create_with_resource_system(0, resource_id));
+  cl_assert_equal_i(s_heap_bytes, heap_bytes);
+  remove(path);
+}
+
+// Measures the heap needed to decode PNG resources, loading them first and streaming them
+// Result:
+//   - streaming doesn't need the memory for the compressed PNG
+void test_png__resource_peak_memory(void) {
+  for (unsigned int i = 0; i < ARRAY_LENGTH(s_resource_images); i++) {
+    const uint32_t resource_id = sys_resource_load_file_as_resource(TEST_IMAGES_PATH,
+                                                                    s_resource_images[i].png);
+    const size_t png_size = sys_resource_size(0, resource_id);
+
+    prv_heap_reset_peak();
+    const size_t heap_bytes = s_heap_bytes;
+    GBitmap *loaded = prv_create_with_loaded_png_resource(resource_id);
+    const size_t loaded_peak_bytes = s_heap_peak_bytes - heap_bytes;
+    prv_bitmap_destroy(loaded);
+
+    prv_heap_reset_peak();
+    GBitmap *streamed = gbitmap_create_with_resource_system(0, resource_id);
+    const size_t streamed_peak_bytes = s_heap_peak_bytes - heap_bytes;
+    prv_bitmap_destroy(streamed);
+
+    printf("%s (%zu bytes): peak heap %zu bytes loaded, %zu bytes streamed\n",
+           s_resource_images[i].png, png_size, loaded_peak_bytes, streamed_peak_bytes);
+    // All that streaming needs on top is the buffer the image data is read into, and the palette
+    // as it gets converted before the image data is inflated
+    const size_t max_palette_size = 256 * sizeof(GColor8);
+    cl_assert(streamed_peak_bytes + png_size <=
+              loaded_peak_bytes + TINF_SOURCE_BUFFER_SIZE + max_palette_size);
+  }
+}
+
+// Decodes the largest test PNG over and over, loading it first and streaming it
+void test_png__resource_images_per_second(void) {
+  const uint32_t resource_id =
+      sys_resource_load_file_as_resource(TEST_IMAGES_PATH,
+                                         "test_png__color_256_colors_check.raw.png");
+  const int num_images = 200;
+
+  uint64_t elapsed_us[2];
+  for (int streamed = 0; streamed < 2; streamed++) {
+    const uint64_t start_us = prv_now_us();
+    for (int i = 0; i < num_images; i++) {
+      GBitmap *bitmap = streamed ? gbitmap_create_with_resource_system(0, resource_id) :
+                                   prv_create_with_loaded_png_resource(resource_id);
+      cl_assert(bitmap);
+      prv_bitmap_destroy(bitmap);
+    }
+    elapsed_us[streamed] = MAX(prv_now_us() - start_us, 1);
+  }
+
+  printf("%d images: %"PRIu64" images/sec loaded, %"PRIu64" images/sec streamed\n",
+         num_images, (num_images * (uint64_t)1000000) / elapsed_us[0],
+         (num_images * (uint64_t)1000000) / elapsed_us[1]);
+}
@@ -135,6 +135,9 @@ void test_message_handler(const uint8_t *data, size_t length,
 void test_alt_message_handler(const uint8_t *data, size_t length,
                               AppInboxConsumerInfo *consumer_info) {}
 void test_alt_dropped_handler(uint32_t num_dropped_messages) {}
+void test_batched_message_handler(const uint8_t *data, size_t length,
+                                  AppInboxConsumerInfo *consumer_info) {}
+void test_batched_dropped_handler(uint32_t num_dropped_messages) {}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Tests
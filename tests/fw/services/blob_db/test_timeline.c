@@ -967,16 +967,14 @@ void test_timeline__two_iterators(void) {
   timeline_init(&head);
   cl_assert_equal_i(timeline_iter_init(&iterator1, &state1, &head, TimelineIterDirectionFuture,
     1421178000), 0);
-  // should have one alloc for each node in list, + 1 for the current timelineitem
-  cl_assert_equal_i(fake_pbl_malloc_num_net_allocs(),
-                    init_net_allocs + ARRAY_LENGTH(s_items) + 1);
+  // all nodes in the list fit in one node pool slab, + 1 for the current timelineitem
+  cl_assert_equal_i(fake_pbl_malloc_num_net_allocs(), init_net_allocs + 1 + 1);
 
   // second iterator should not alloc any more memory
   cl_assert_equal_i(timeline_iter_init(&iterator2, &state2, &head, TimelineIterDirectionFuture,
     1421178000), 0);
-  // should have one alloc for each node in list, + 1 for the current timelineitem
-  cl_assert_equal_i(fake_pbl_malloc_num_net_allocs(),
-                    init_net_allocs + ARRAY_LENGTH(s_items) + 2);
+  // the nodes are shared, so only the second current timelineitem is added
+  cl_assert_equal_i(fake_pbl_malloc_num_net_allocs(), init_net_allocs + 1 + 2);
 
   // deinit should free all the memory
   timeline_iter_deinit(&iterator1, &state1, &head);
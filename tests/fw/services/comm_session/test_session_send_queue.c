@@ -6,6 +6,7 @@
 #include "pbl/services/comm_session/session_internal.h"
 #include "pbl/services/comm_session/session_send_queue.h"
 #include "pbl/util/math.h"
+#include "pbl/util/size.h"
 
 extern void comm_session_send_queue_cleanup(CommSession *session);
 
@@ -50,7 +51,13 @@ static const uint8_t *prv_get_read_pointer(const TestSendJob *sb) {
   return (sb->data + sb->consumed_length);
 }
 
+//! Number of times a job was looked at while walking the queue
+static int s_get_length_count;
+//! Number of bytes the jobs copied out
+static size_t s_copied_bytes;
+
 static size_t prv_send_job_impl_get_length(const SessionSendQueueJob *send_job) {
+  ++s_get_length_count;
   return prv_get_length((TestSendJob *)send_job);
 }
 
@@ -61,6 +68,7 @@ size_t prv_send_job_impl_copy(const SessionSendQueueJob *send_job, int start_off
   const size_t length_after_offset = (length_remaining - start_offset);
   const size_t length_to_copy = MIN(length_after_offset, length);
   memcpy(data_out, prv_get_read_pointer(sb) + start_offset, length_to_copy);
+  s_copied_bytes += length_to_copy;
   return length_to_copy;
 }
 
@@ -71,6 +79,14 @@ size_t prv_send_job_impl_get_read_pointer(const SessionSendQueueJob *send_job,
   return prv_get_length(sb);
 }
 
+size_t prv_send_job_impl_get_read_pointer_at_offset(const SessionSendQueueJob *send_job,
+                                                    uint32_t start_offset,
+                                                    const uint8_t **data_out) {
+  TestSendJob *sb = (TestSendJob *)send_job;
+  *data_out = prv_get_read_pointer(sb) + start_offset;
+  return prv_get_length(sb) - start_offset;
+}
+
 void prv_send_job_impl_consume(const SessionSendQueueJob *send_job, size_t length) {
   TestSendJob *sb = (TestSendJob *)send_job;
   sb->consumed_length += length;
@@ -87,6 +103,7 @@ static const SessionSendJobImpl s_test_job_impl = {
   .get_length = prv_send_job_impl_get_length,
   .copy = prv_send_job_impl_copy,
   .get_read_pointer = prv_send_job_impl_get_read_pointer,
+  .get_read_pointer_at_offset = prv_send_job_impl_get_read_pointer_at_offset,
   .consume = prv_send_job_impl_consume,
   .free = prv_send_job_impl_free,
 };
@@ -114,6 +131,8 @@ static const uint8_t TEST_DATA[] = {0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
 void test_session_send_queue__initialize(void) {
   s_valid_session = &s_session;
   s_free_count = 0;
+  s_get_length_count = 0;
+  s_copied_bytes = 0;
   fake_kernel_malloc_init();
   fake_kernel_malloc_enable_stats(true);
   fake_kernel_malloc_mark();
@@ -285,3 +304,217 @@ void test_session_send_queue__session_closed_when_add_is_called(void) {
   cl_assert(!job);
   cl_assert_equal_i(s_free_count, 1);
 }
+
+void test_session_send_queue__get_length_is_kept_up_to_date(void) {
+  int num_jobs = 3;
+  prv_add_jobs(num_jobs);
+  cl_assert_equal_i(num_jobs * sizeof(TEST_DATA),
+                    comm_session_send_queue_get_length(s_valid_session));
+
+  // Asking for the length doesn't walk the jobs:
+  s_get_length_count = 0;
+  comm_session_send_queue_get_length(s_valid_session);
+  cl_assert_equal_i(s_get_length_count, 0);
+
+  comm_session_send_queue_consume(s_valid_session, sizeof(TEST_DATA) + 2);
+  cl_assert_equal_i((num_jobs - 1) * sizeof(TEST_DATA) - 2,
+                    comm_session_send_queue_get_length(s_valid_session));
+
+  comm_session_send_queue_consume(s_valid_session, UINT32_MAX);
+  cl_assert_equal_i(0, comm_session_send_queue_get_length(s_valid_session));
+
+  prv_add_jobs(num_jobs);
+  comm_session_send_queue_cleanup(s_valid_session);
+  cl_assert_equal_i(0, comm_session_send_queue_get_length(s_valid_session));
+}
+
+void test_session_send_queue__get_segments_empty_queue(void) {
+  SessionSendQueueSegment segments[2];
+  cl_assert_equal_i(0, comm_session_send_queue_get_segments(s_valid_session, 0, 10,
+                                                           segments, ARRAY_LENGTH(segments)));
+}
+
+void test_session_send_queue__get_segments_overlapping_multiple_jobs_with_offset(void) {
+  int num_jobs = 3;
+  prv_add_jobs(num_jobs);
+
+  SessionSendQueueSegment segments[4];
+  const int offset = 1;
+  const size_t length = 2 * sizeof(TEST_DATA);
+  cl_assert_equal_i(3, comm_session_send_queue_get_segments(s_valid_session, offset, length,
+                                                           segments, ARRAY_LENGTH(segments)));
+  cl_assert_equal_i(segments[0].length, sizeof(TEST_DATA) - offset);
+  cl_assert_equal_m(segments[0].data, TEST_DATA + offset, sizeof(TEST_DATA) - offset);
+  cl_assert_equal_i(segments[1].length, sizeof(TEST_DATA));
+  cl_assert_equal_m(segments[1].data, TEST_DATA, sizeof(TEST_DATA));
+  cl_assert_equal_i(segments[2].length, offset);
+  cl_assert_equal_m(segments[2].data, TEST_DATA, offset);
+
+  // The segments point into the jobs, nothing got copied:
+  cl_assert_equal_i(s_copied_bytes, 0);
+}
+
+void test_session_send_queue__get_segments_limited_by_max_segments(void) {
+  int num_jobs = 3;
+  prv_add_jobs(num_jobs);
+
+  SessionSendQueueSegment segments[2];
+  cl_assert_equal_i(2, comm_session_send_queue_get_segments(s_valid_session, 0, UINT32_MAX,
+                                                           segments, ARRAY_LENGTH(segments)));
+  cl_assert_equal_i(segments[0].length + segments[1].length, 2 * sizeof(TEST_DATA));
+}
+
+void test_session_send_queue__get_segments_offset_beyond_end(void) {
+  int num_jobs = 3;
+  prv_add_jobs(num_jobs);
+
+  SessionSendQueueSegment segments[2];
+  cl_assert_equal_i(0, comm_session_send_queue_get_segments(s_valid_session,
+                                                           num_jobs * sizeof(TEST_DATA), 1,
+                                                           segments, ARRAY_LENGTH(segments)));
+}
+
+static SessionSendQueueJob *prv_add_counting_job(uint8_t *next_byte, size_t length) {
+  uint8_t data[length];
+  for (size_t i = 0; i < length; ++i) {
+    data[i] = (*next_byte)++;
+  }
+  SessionSendQueueJob *job = prv_create_test_job(data, length);
+  comm_session_send_queue_add_job(s_valid_session, &job);
+  cl_assert(job);
+  return job;
+}
+
+void test_session_send_queue__copy_at_random_offsets_while_consuming(void) {
+  // Every byte is its index into the stream of bytes sent, modulo 256:
+  uint8_t next_byte = 0;
+  for (int i = 0; i < 20; ++i) {
+    prv_add_counting_job(&next_byte, 1 + (i * 7) % 23);
+  }
+
+  uint8_t stream_start = 0;
+  srand(42);
+  while (comm_session_send_queue_get_length(s_valid_session)) {
+    const size_t queue_length = comm_session_send_queue_get_length(s_valid_session);
+    for (int i = 0; i < 8; ++i) {
+      const uint32_t offset = rand() % queue_length;
+      uint8_t data_out[16];
+      const size_t copied = comm_session_send_queue_copy(s_valid_session, offset,
+                                                         sizeof(data_out), data_out);
+      cl_assert_equal_i(copied, MIN(sizeof(data_out), queue_length - offset));
+      for (size_t j = 0; j < copied; ++j) {
+        cl_assert_equal_i(data_out[j], (uint8_t)(stream_start + offset + j));
+      }
+    }
+    const size_t consumed = MIN(queue_length, 1 + (rand() % 17));
+    comm_session_send_queue_consume(s_valid_session, consumed);
+    stream_start += consumed;
+  }
+  cl_assert_equal_i(s_free_count, 20);
+}
+
+typedef enum {
+  TransmitPathCopy,
+  TransmitPathSegments,
+} TransmitPath;
+
+typedef struct {
+  int job_visits;
+  size_t copied_bytes;
+  int packets;
+} TransmitStats;
+
+// Sends 1MB the way a transport with a window of packets in flight does: the packets in the window
+// are read at increasing offsets, the oldest packet gets acked and consumed and the next is read.
+static TransmitStats prv_transmit_1mb(TransmitPath path) {
+  const size_t total_length = 1024 * 1024;
+  const size_t job_length = 1000;
+  const size_t packet_length = 155;
+  const int window_size = 4;
+  const int max_queued_jobs = 8;
+
+  s_get_length_count = 0;
+  s_copied_bytes = 0;
+
+  uint8_t next_byte = 0;
+  uint8_t stream_start = 0;
+  size_t added_length = 0;
+  size_t sent_length = 0;
+  size_t in_flight_length = 0;
+  int in_flight_packets = 0;
+  int packets = 0;
+  while (sent_length < total_length) {
+    // Keep the app side ahead of the transport:
+    while ((added_length < total_length) &&
+           (comm_session_send_queue_get_length(s_valid_session) < max_queued_jobs * job_length)) {
+      const size_t length = MIN(job_length, total_length - added_length);
+      prv_add_counting_job(&next_byte, length);
+      added_length += length;
+    }
+
+    // Fill up the window:
+    while ((in_flight_packets < window_size) &&
+           (in_flight_length < comm_session_send_queue_get_length(s_valid_session))) {
+      uint8_t packet[packet_length];
+      size_t length;
+      if (path == TransmitPathCopy) {
+        length = comm_session_send_queue_copy(s_valid_session, in_flight_length,
+                                              packet_length, packet);
+      } else {
+        SessionSendQueueSegment segments[4];
+        const size_t num_segments =
+            comm_session_send_queue_get_segments(s_valid_session, in_flight_length,
+                                                 packet_length, segments,
+                                                 ARRAY_LENGTH(segments));
+        length = 0;
+        for (size_t i = 0; i < num_segments; ++i) {
+          // A real transport would hand these to the radio, just check them here:
+          for (size_t j = 0; j < segments[i].length; ++j) {
+            packet[length + j] = segments[i].data[j];
+          }
+          length += segments[i].length;
+        }
+      }
+      cl_assert(length > 0);
+      cl_assert_equal_i(packet[0], (uint8_t)(stream_start + in_flight_length));
+      cl_assert_equal_i(packet[length - 1],
+                        (uint8_t)(stream_start + in_flight_length + length - 1));
+      in_flight_length += length;
+      ++in_flight_packets;
+      ++packets;
+    }
+
+    // Oldest packet gets acked:
+    const size_t acked_length = MIN(packet_length, in_flight_length);
+    comm_session_send_queue_consume(s_valid_session, acked_length);
+    stream_start += acked_length;
+    in_flight_length -= acked_length;
+    --in_flight_packets;
+    sent_length += acked_length;
+  }
+
+  return (const TransmitStats) {
+    .job_visits = s_get_length_count,
+    .copied_bytes = s_copied_bytes,
+    .packets = packets,
+  };
+}
+
+void test_session_send_queue__job_visits_and_copies_per_mb(void) {
+  const TransmitStats copy_stats = prv_transmit_1mb(TransmitPathCopy);
+  const TransmitStats segment_stats = prv_transmit_1mb(TransmitPathSegments);
+  printf("\nPer MB sent in %d packets:\n", copy_stats.packets);
+  printf("  copy:     %d job visits, %zu bytes copied by the queue\n",
+         copy_stats.job_visits, copy_stats.copied_bytes);
+  printf("  segments: %d job visits, %zu bytes copied by the queue\n",
+         segment_stats.job_visits, segment_stats.copied_bytes);
+
+  cl_assert_equal_i(copy_stats.copied_bytes, 1024 * 1024);
+  cl_assert_equal_i(segment_stats.copied_bytes, 0);
+
+  // Reading a packet starts at the job the previous one ended in, rather than at the head of the
+  // queue, and the queue length isn't summed up anymore, so there's only a handful of job visits
+  // per packet (including those by consume and add_job):
+  cl_assert(copy_stats.job_visits < 4 * copy_stats.packets);
+  cl_assert(segment_stats.job_visits < 4 * segment_stats.packets);
+}
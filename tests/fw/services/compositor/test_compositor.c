@@ -63,13 +63,17 @@ bool animation_destroy(Animation *animation) {
 static int s_app_window_render_count;
 FrameBuffer* app_state_get_framebuffer(void) {
   // Not a great proxy for app rendering but good enough. The compositor fetches the app
-  // framebuffer once per app render (via compositor_get_app_framebuffer_as_bitmap() on the
-  // fast path where the app framebuffer matches the display), so this increments once per render.
+  // framebuffer once per app render in compositor_render_app(), so this increments once per
+  // render.
   ++s_app_window_render_count;
 
   return compositor_get_framebuffer();
 }
 
+const PebbleProcessMd *app_manager_get_current_app_md(void) {
+  return NULL;
+}
+
 void app_manager_get_framebuffer_size(GSize *size) {
   *size = (GSize) {DISP_COLS, DISP_ROWS};
 }
@@ -0,0 +1,239 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "clar.h"
+
+#include "applib/graphics/framebuffer.h"
+#include "applib/graphics/gcontext.h"
+#include "applib/graphics/gtypes.h"
+#include "drivers/display/display.h"
+#include "kernel/events.h"
+#include "kernel/ui/modals/modal_manager.h"
+#include "pbl/services/compositor/compositor.h"
+#include "process_management/pebble_process_md.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Stubs
+///////////////////////////////////////////////////////////
+
+#include "stubs_compiled_with_legacy2_sdk.h"
+#include "stubs_gbitmap.h"
+#include "stubs_logging.h"
+#include "stubs_passert.h"
+#include "stubs_pbl_malloc.h"
+#include "stubs_timeline_peek.h"
+
+Animation *animation_create(void) {
+  return (Animation *)(uintptr_t)1;
+}
+
+bool animation_schedule(Animation *animation) {
+  return true;
+}
+
+bool animation_set_auto_destroy(Animation *animation, bool auto_destroy) {
+  return true;
+}
+
+bool animation_set_implementation(Animation *animation,
+                                  const AnimationImplementation *implementation) {
+  return true;
+}
+
+bool animation_is_scheduled(Animation *animation_h) {
+  return false;
+}
+
+bool animation_unschedule(Animation *animation) {
+  return true;
+}
+
+bool animation_destroy(Animation *animation) {
+  return true;
+}
+
+AnimationPrivate *animation_private_animation_find(Animation *handle) {
+  return NULL;
+}
+
+void compositor_dot_transition_app_to_app_init(Animation *animation) {
+}
+
+bool compositor_dot_transition_app_to_app_update_func(
+    GContext *ctx, Animation *animation, uint32_t distance_normalized) {
+  return true;
+}
+
+Window *modal_manager_get_top_window(void) {
+  return NULL;
+}
+
+void modal_manager_render(GContext *ctx) {
+}
+
+ModalProperty modal_manager_get_properties(void) {
+  return ModalPropertyDefault;
+}
+
+GContext *kernel_ui_get_graphics_context(void) {
+  static GContext s_context;
+  return &s_context;
+}
+
+GDrawState graphics_context_get_drawing_state(GContext *ctx) {
+  return (GDrawState) { };
+}
+
+void graphics_context_set_drawing_state(GContext *ctx, GDrawState draw_state) {
+}
+
+void event_put(PebbleEvent *event) {
+}
+
+bool process_manager_send_event_to_process(PebbleTask task, PebbleEvent *event) {
+  return true;
+}
+
+void launcher_task_add_callback(void (*callback)(void *data), void *data) {
+}
+
+// Fakes that count the work done to get a frame to the display
+///////////////////////////////////////////////////////////
+
+static FrameBuffer s_app_framebuffer;
+static PebbleProcessMd s_app_md;
+
+const PebbleProcessMd *app_manager_get_current_app_md(void) {
+  return &s_app_md;
+}
+
+FrameBuffer *app_state_get_framebuffer(void) {
+  return &s_app_framebuffer;
+}
+
+void app_manager_get_framebuffer_size(GSize *size) {
+  *size = (GSize) { DISP_COLS, DISP_ROWS };
+}
+
+static uint32_t s_pixels_copied;
+
+void bitblt_bitmap_into_bitmap(GBitmap *dest_bitmap, const GBitmap *src_bitmap, GPoint dest_offset,
+                               GCompOp compositing_mode, GColor tint_color) {
+  const GRect *src = &src_bitmap->bounds;
+  for (int y = 0; y < src->size.h; y++) {
+    const uint8_t *src_row = (const uint8_t *)src_bitmap->addr +
+                             ((src->origin.y + y) * src_bitmap->row_size_bytes) + src->origin.x;
+    uint8_t *dest_row = (uint8_t *)dest_bitmap->addr +
+                        ((dest_offset.y + y) * dest_bitmap->row_size_bytes) + dest_offset.x;
+    memcpy(dest_row, src_row, src->size.w);
+  }
+  s_pixels_copied += src->size.w * src->size.h;
+}
+
+static uint32_t s_rows_flushed;
+
+void display_update(NextRowCallback nrcb, UpdateCompleteCallback uccb) {
+  DisplayRow row;
+  while (nrcb(&row)) {
+    s_rows_flushed++;
+  }
+  uccb();
+}
+
+bool display_update_in_progress(void) {
+  return false;
+}
+
+// Watchface workload
+///////////////////////////////////////////////////////////
+
+#define NUM_FRAMES (60)
+
+//! A seconds hand ticking near the top right corner, a battery icon at the bottom left and the
+//! time that changes once a minute.
+static const GRect s_seconds_rect = { { DISP_COLS - 48, 8 }, { 40, 40 } };
+static const GRect s_battery_rect = { { 8, DISP_ROWS - 20 }, { 24, 12 } };
+static const GRect s_time_rect = { { 20, (DISP_ROWS / 2) - 20 }, { DISP_COLS - 40, 40 } };
+
+//! Draws into the app framebuffer and marks what changed, like an app render would
+static void prv_app_draw(const GRect *rect, uint8_t color) {
+  GBitmap bitmap = framebuffer_get_as_bitmap(&s_app_framebuffer, &s_app_framebuffer.size);
+  for (int y = rect->origin.y; y < rect->origin.y + rect->size.h; y++) {
+    memset((uint8_t *)bitmap.addr + (y * bitmap.row_size_bytes) + rect->origin.x, color,
+           rect->size.w);
+  }
+  framebuffer_mark_dirty_rect(&s_app_framebuffer, *rect);
+}
+
+//! Draws into the app framebuffer without marking it as dirty, like a third-party app that
+//! doesn't call layer_mark_dirty() can
+static void prv_app_draw_unmarked(const GRect *rect, uint8_t color) {
+  const GRect saved_dirty_rect = s_app_framebuffer.dirty_rect;
+  const GDirtyRegion saved_dirty_region = s_app_framebuffer.dirty_region;
+  prv_app_draw(rect, color);
+  s_app_framebuffer.dirty_rect = saved_dirty_rect;
+  s_app_framebuffer.dirty_region = saved_dirty_region;
+}
+
+static void prv_run_watchface(bool track_damage) {
+  framebuffer_init(&s_app_framebuffer, &(GSize) { DISP_COLS, DISP_ROWS });
+  framebuffer_clear(&s_app_framebuffer);
+  compositor_init();
+  compositor_transition(NULL);
+  compositor_app_render_ready();
+
+  s_pixels_copied = 0;
+  s_rows_flushed = 0;
+  for (int frame = 0; frame < NUM_FRAMES; frame++) {
+    prv_app_draw(&s_seconds_rect, frame);
+    prv_app_draw(&s_battery_rect, frame / 10);
+    if (frame == 0) {
+      prv_app_draw(&s_time_rect, 0xc0);
+    } else if (s_app_md.is_unprivileged) {
+      prv_app_draw_unmarked(&s_time_rect, frame);
+    }
+    if (!track_damage) {
+      // What every frame cost before the damage was tracked: the whole app framebuffer is copied
+      // and flushed
+      framebuffer_dirty_all(&s_app_framebuffer);
+      compositor_invalidate_framebuffer();
+    }
+    compositor_app_render_ready();
+
+    // The compositor framebuffer always ends up with what the app drew
+    FrameBuffer *fb = compositor_get_framebuffer();
+    cl_assert_equal_m(fb->buffer, s_app_framebuffer.buffer, framebuffer_get_size_bytes(fb));
+  }
+}
+
+// Tests
+///////////////////////////////////////////////////////////
+
+void test_compositor_damage__initialize(void) {
+  s_app_md = (PebbleProcessMd) { .process_type = ProcessTypeWatchface };
+}
+
+void test_compositor_damage__watchface_pixels_copied_and_rows_flushed(void) {
+  prv_run_watchface(false /* track_damage */);
+  const uint32_t full_pixels_copied = s_pixels_copied;
+  const uint32_t full_rows_flushed = s_rows_flushed;
+
+  prv_run_watchface(true /* track_damage */);
+  printf("Watchface, %d frames: %u pixels copied and %u rows flushed for full frames, "
+         "%u pixels copied and %u rows flushed with dirty rects\n", NUM_FRAMES,
+         full_pixels_copied, full_rows_flushed, s_pixels_copied, s_rows_flushed);
+
+  cl_assert_equal_i(full_pixels_copied, NUM_FRAMES * DISP_COLS * DISP_ROWS);
+  cl_assert(s_pixels_copied * 10 < full_pixels_copied);
+  cl_assert(s_rows_flushed * 2 < full_rows_flushed);
+}
+
+void test_compositor_damage__third_party_app_copies_full_frames(void) {
+  // The watchface redraws the time every frame without marking it as dirty, every frame still
+  // reaches the display as a whole
+  s_app_md.is_unprivileged = true;
+  prv_run_watchface(true /* track_damage */);
+  cl_assert_equal_i(s_pixels_copied, NUM_FRAMES * DISP_COLS * DISP_ROWS);
+}
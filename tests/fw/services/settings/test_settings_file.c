@@ -971,3 +971,223 @@ void test_settings_file__rewrite_filtered_oom(void) {
   verify(&file, key, key_len, val, val_len);
   settings_file_close(&file);
 }
+
+#define TXN_NUM_KEYS 20
+
+static void prv_txn_key_val(int i, const char *prefix, char *key, char *val) {
+  snprintf(key, 8, "txn%02d", i);
+  snprintf(val, 8, "%s%02d", prefix, i);
+}
+
+//! Checks that either every key has the value with the given prefix or, if
+//! prefix is NULL, that none of them exist
+static bool prv_txn_keys_match(SettingsFile *file, int first, int last, const char *prefix) {
+  for (int i = first; i < last; i++) {
+    char key[8];
+    char val[8];
+    prv_txn_key_val(i, prefix ? prefix : "", key, val);
+    const int len = settings_file_get_len(file, key, strlen(key));
+    if (!prefix) {
+      if (len != 0) {
+        return false;
+      }
+      continue;
+    }
+    char val_out[8] = {};
+    if ((len != (int)strlen(val)) ||
+        (settings_file_get(file, key, strlen(key), val_out, len) != S_SUCCESS) ||
+        (strcmp(val, val_out) != 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void prv_txn_set_all(SettingsFile *file, int first, int last, const char *prefix) {
+  for (int i = first; i < last; i++) {
+    char key[8];
+    char val[8];
+    prv_txn_key_val(i, prefix, key, val);
+    cl_must_pass(settings_file_set(file, key, strlen(key), val, strlen(val)));
+  }
+}
+
+void test_settings_file__transaction(void) {
+  printf("\nTesting batched writes...\n");
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_file_txn", 4096));
+  prv_txn_set_all(&file, 0, TXN_NUM_KEYS, "old");
+
+  cl_must_pass(settings_file_begin_transaction(&file));
+  // replace half the keys, add as many new ones and delete one
+  prv_txn_set_all(&file, TXN_NUM_KEYS / 2, TXN_NUM_KEYS + (TXN_NUM_KEYS / 2), "tmp");
+  prv_txn_set_all(&file, TXN_NUM_KEYS / 2, TXN_NUM_KEYS + (TXN_NUM_KEYS / 2), "new");
+  cl_must_pass(settings_file_delete(&file, "txn00", 5));
+
+  // nothing changes until the transaction is committed
+  cl_assert(prv_txn_keys_match(&file, 0, TXN_NUM_KEYS, "old"));
+  cl_assert(prv_txn_keys_match(&file, TXN_NUM_KEYS, TXN_NUM_KEYS + (TXN_NUM_KEYS / 2), NULL));
+  cl_must_pass(settings_file_commit_transaction(&file));
+
+  for (int reopen = 0; reopen < 2; reopen++) {
+    cl_assert_equal_b(settings_file_exists(&file, "txn00", 5), false);
+    cl_assert(prv_txn_keys_match(&file, 1, TXN_NUM_KEYS / 2, "old"));
+    cl_assert(prv_txn_keys_match(&file, TXN_NUM_KEYS / 2, TXN_NUM_KEYS + (TXN_NUM_KEYS / 2),
+                                 "new"));
+    settings_file_close(&file);
+    cl_must_pass(settings_file_open(&file, "test_file_txn", 4096));
+  }
+
+  // aborted transactions leave no trace
+  cl_must_pass(settings_file_begin_transaction(&file));
+  prv_txn_set_all(&file, 0, TXN_NUM_KEYS, "abc");
+  settings_file_abort_transaction(&file);
+  cl_assert(prv_txn_keys_match(&file, 1, TXN_NUM_KEYS / 2, "old"));
+
+  settings_file_close(&file);
+}
+
+void test_settings_file__transaction_replace_last_op(void) {
+  printf("\nTesting batched writes which replace the latest operation...\n");
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_file_txn_last", 4096));
+
+  cl_must_pass(settings_file_begin_transaction(&file));
+  prv_txn_set_all(&file, 0, 2, "tmp");
+  prv_txn_set_all(&file, 1, 2, "new");
+  prv_txn_set_all(&file, 2, 3, "new");
+  prv_txn_set_all(&file, 0, 1, "new");
+  cl_must_pass(settings_file_commit_transaction(&file));
+
+  cl_assert(prv_txn_keys_match(&file, 0, 3, "new"));
+  settings_file_close(&file);
+}
+
+void test_settings_file__transaction_write_count(void) {
+  printf("\nTesting that batched writes need fewer flash writes...\n");
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_file_txn_writes", 8192));
+  prv_txn_set_all(&file, 0, TXN_NUM_KEYS, "old");
+
+  uint32_t start_writes = fake_flash_write_count();
+  prv_txn_set_all(&file, 0, TXN_NUM_KEYS, "new");
+  const uint32_t unbatched_writes = fake_flash_write_count() - start_writes;
+
+  start_writes = fake_flash_write_count();
+  cl_must_pass(settings_file_begin_transaction(&file));
+  prv_txn_set_all(&file, 0, TXN_NUM_KEYS, "txn");
+  cl_must_pass(settings_file_commit_transaction(&file));
+  const uint32_t batched_writes = fake_flash_write_count() - start_writes;
+
+  printf("Flash writes to replace %d records: %"PRIu32" one by one, %"PRIu32" batched\n",
+         TXN_NUM_KEYS, unbatched_writes, batched_writes);
+  cl_assert(batched_writes * 2 < unbatched_writes);
+  cl_assert(prv_txn_keys_match(&file, 0, TXN_NUM_KEYS, "txn"));
+  settings_file_close(&file);
+}
+
+void test_settings_file__transaction_compacts_once(void) {
+  printf("\nTesting that a batch which doesn't fit compacts the file first...\n");
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_file_txn_compact", 1024));
+  // fill the file up with dead records
+  while (file.used_space + file.dead_space + 64 < file.max_space_total) {
+    prv_txn_set_all(&file, 0, 1, "old");
+  }
+  const int dead_space = file.dead_space;
+  cl_assert(dead_space > 0);
+
+  cl_must_pass(settings_file_begin_transaction(&file));
+  prv_txn_set_all(&file, 0, TXN_NUM_KEYS, "new");
+  cl_must_pass(settings_file_commit_transaction(&file));
+
+  // only the one record which was replaced by the batch is dead now
+  cl_assert(file.dead_space < dead_space);
+  cl_assert(prv_txn_keys_match(&file, 0, TXN_NUM_KEYS, "new"));
+
+  // a batch which can't fit at all is rejected without writing anything
+  cl_must_pass(settings_file_begin_transaction(&file));
+  for (int i = 0; i < 16; i++) {
+    char key[8];
+    char val[8];
+    prv_txn_key_val(i, "big", key, val);
+    uint8_t big_val[100];
+    memset(big_val, i, sizeof(big_val));
+    cl_must_pass(settings_file_set(&file, key, strlen(key), big_val, sizeof(big_val)));
+  }
+  cl_assert_equal_i(settings_file_commit_transaction(&file), E_OUT_OF_STORAGE);
+  cl_assert(prv_txn_keys_match(&file, 0, TXN_NUM_KEYS, "new"));
+
+  settings_file_close(&file);
+}
+
+static RecordResult prv_commit_transaction_aborting_after_bytes(int after_n_bytes) {
+  fake_spi_flash_init(0, 0x1000000);
+  fake_rtc_init(0, 1388563200);
+  pfs_init(false);
+
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "test_file_txn_atomic", 4096));
+  prv_txn_set_all(&file, 0, TXN_NUM_KEYS, "old");
+
+  jmp_buf jmp;
+  if (setjmp(jmp)) {
+    // Simulate a reboot, then make sure that we either see all of the batch or
+    // none of it
+    fake_spi_flash_force_future_failure(0, NULL);
+    extern void pfs_reset_all_state(void);
+    pfs_reset_all_state();
+    pfs_init(false);
+
+    SettingsFile file_new;
+    cl_must_pass(settings_file_open(&file_new, "test_file_txn_atomic", 4096));
+    RecordResult result;
+    if (prv_txn_keys_match(&file_new, 0, TXN_NUM_KEYS, "old")) {
+      cl_assert(prv_txn_keys_match(&file_new, TXN_NUM_KEYS, 2 * TXN_NUM_KEYS, NULL));
+      result = RecordResultOld;
+    } else {
+      cl_assert(prv_txn_keys_match(&file_new, 0, 2 * TXN_NUM_KEYS, "new"));
+      result = RecordResultNew;
+    }
+
+    // The file has to be usable afterwards
+    prv_txn_set_all(&file_new, 0, TXN_NUM_KEYS, "end");
+    cl_assert(prv_txn_keys_match(&file_new, 0, TXN_NUM_KEYS, "end"));
+    settings_file_close(&file_new);
+    return result;
+  }
+
+  cl_must_pass(settings_file_begin_transaction(&file));
+  prv_txn_set_all(&file, 0, 2 * TXN_NUM_KEYS, "new");
+
+  fake_spi_flash_force_future_failure(after_n_bytes, &jmp);
+  cl_must_pass(settings_file_commit_transaction(&file));
+  fake_spi_flash_force_future_failure(0, NULL);
+
+  cl_assert(prv_txn_keys_match(&file, 0, 2 * TXN_NUM_KEYS, "new"));
+  settings_file_close(&file);
+  return RecordResultEnd;
+}
+
+void test_settings_file__transaction_atomic(void) {
+  printf("\nTesting if batched writes are atomic...\n");
+  bool have_hit_old_value = false;
+  bool have_hit_new_value = false;
+  bool have_hit_end = false;
+  // Abort the commit at every few bytes until it manages to complete
+  for (int i = 1; !have_hit_end; i += 3) {
+    switch (prv_commit_transaction_aborting_after_bytes(i)) {
+      case RecordResultOld:
+        have_hit_old_value = true;
+        break;
+      case RecordResultNew:
+        have_hit_new_value = true;
+        break;
+      case RecordResultEnd:
+        have_hit_end = true;
+        break;
+    }
+  }
+  cl_assert(have_hit_old_value);
+  cl_assert(have_hit_new_value);
+}
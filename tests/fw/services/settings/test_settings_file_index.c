@@ -0,0 +1,216 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "pbl/services/settings/settings_file.h"
+#include "pbl/services/settings/settings_raw_iter.h"
+
+#include "clar.h"
+
+#include "pbl/services/filesystem/pfs.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+// Stubs
+////////////////////////////////////
+#include "stubs_analytics.h"
+#include "stubs_logging.h"
+#include "stubs_mutex.h"
+#include "stubs_passert.h"
+#include "stubs_pbl_malloc.h"
+#include "stubs_pebble_tasks.h"
+#include "stubs_print.h"
+#include "stubs_prompt.h"
+#include "stubs_rand_ptr.h"
+#include "stubs_serial.h"
+#include "stubs_sleep.h"
+#include "stubs_system_reset.h"
+#include "stubs_task_watchdog.h"
+#include "fake_rtc.h"
+#include "fake_spi_flash.h"
+
+// Tests
+////////////////////////////////////
+
+#define NUM_RECORDS 1000
+#define FILE_MAX_USED_SPACE (64 * 1024)
+
+extern uint32_t settings_raw_iter_prv_get_num_record_searches(void);
+
+void test_settings_file_index__initialize(void) {
+  fake_spi_flash_init(0, 0x1000000);
+  pfs_init(false);
+}
+
+void test_settings_file_index__cleanup(void) {
+  stub_pbl_malloc_set_kernel_malloc_should_fail(false);
+}
+
+static void prv_key_val(int i, char *key, char *val) {
+  snprintf(key, 8, "key%04d", i);
+  snprintf(val, 8, "val%04d", i);
+}
+
+static void prv_fill(SettingsFile *file, int num_records) {
+  char key[8];
+  char val[8];
+  for (int i = 0; i < num_records; i++) {
+    prv_key_val(i, key, val);
+    cl_must_pass(settings_file_set(file, key, strlen(key), val, strlen(val)));
+  }
+}
+
+static void prv_verify_value(SettingsFile *file, int i, const char *expected_val) {
+  char key[8];
+  char val[8];
+  prv_key_val(i, key, val);
+  if (!expected_val) {
+    cl_assert_equal_i(settings_file_get_len(file, key, strlen(key)), 0);
+    cl_assert_equal_b(settings_file_exists(file, key, strlen(key)), false);
+    return;
+  }
+  char val_out[8] = {};
+  cl_assert_equal_i(settings_file_get_len(file, key, strlen(key)), strlen(expected_val));
+  cl_must_pass(settings_file_get(file, key, strlen(key), val_out, strlen(expected_val)));
+  cl_assert_equal_s(val_out, expected_val);
+}
+
+//! Looks up every key in a pseudo random order
+//! @return the number of flash reads it took
+static uint32_t prv_lookup_all(SettingsFile *file) {
+  const uint32_t start_reads = fake_flash_read_count();
+  char key[8];
+  char val[8];
+  for (int i = 0; i < NUM_RECORDS; i++) {
+    const int record = (i * 619) % NUM_RECORDS;
+    prv_key_val(record, key, val);
+    char val_out[8] = {};
+    cl_must_pass(settings_file_get(file, key, strlen(key), val_out, strlen(val)));
+    cl_assert_equal_s(val_out, val);
+  }
+  return fake_flash_read_count() - start_reads;
+}
+
+void test_settings_file_index__lookup_benchmark(void) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "index_benchmark", FILE_MAX_USED_SPACE));
+  prv_fill(&file, NUM_RECORDS);
+  cl_assert(file.index);
+  cl_assert_equal_i(file.index_len, NUM_RECORDS);
+
+  uint32_t start_searches = settings_raw_iter_prv_get_num_record_searches();
+  const uint32_t indexed_reads = prv_lookup_all(&file);
+  const uint32_t indexed_searches = settings_raw_iter_prv_get_num_record_searches() -
+                                    start_searches;
+
+  // Drop the index to measure what a lookup costs when scanning the file
+  kernel_free(file.index);
+  file.index = NULL;
+  file.index_len = file.index_capacity = 0;
+
+  start_searches = settings_raw_iter_prv_get_num_record_searches();
+  const uint32_t scanned_reads = prv_lookup_all(&file);
+  const uint32_t scanned_searches = settings_raw_iter_prv_get_num_record_searches() -
+                                    start_searches;
+
+  printf("Flash reads for %d lookups in a %d record file: %"PRIu32" indexed, %"PRIu32" scanned\n",
+         NUM_RECORDS, NUM_RECORDS, indexed_reads, scanned_reads);
+  cl_assert_equal_i(indexed_searches, 0);
+  cl_assert(scanned_searches > (NUM_RECORDS * NUM_RECORDS) / 4);
+  cl_assert(indexed_reads * 20 < scanned_reads);
+
+  settings_file_close(&file);
+}
+
+void test_settings_file_index__maintained_by_set_and_delete(void) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "index_set_delete", FILE_MAX_USED_SPACE));
+  prv_fill(&file, NUM_RECORDS);
+
+  // overwrite every third record and delete every fifth one
+  for (int i = 0; i < NUM_RECORDS; i += 3) {
+    char key[8];
+    char val[8];
+    prv_key_val(i, key, val);
+    cl_must_pass(settings_file_set(&file, key, strlen(key), "new", 3));
+  }
+  for (int i = 0; i < NUM_RECORDS; i += 5) {
+    char key[8];
+    char val[8];
+    prv_key_val(i, key, val);
+    cl_must_pass(settings_file_delete(&file, key, strlen(key)));
+  }
+
+  // deleted records stick around as tombstones, overwritten ones don't
+  cl_assert(file.index);
+  cl_assert_equal_i(file.index_len, NUM_RECORDS);
+
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < NUM_RECORDS; i++) {
+      char key[8];
+      char val[8];
+      prv_key_val(i, key, val);
+      if ((i % 5) == 0) {
+        prv_verify_value(&file, i, NULL);
+      } else if ((i % 3) == 0) {
+        prv_verify_value(&file, i, "new");
+      } else {
+        prv_verify_value(&file, i, val);
+      }
+    }
+
+    // the index has to be rebuilt correctly after compaction
+    cl_must_pass(settings_file_compact(&file));
+    cl_assert(file.index);
+    cl_assert_equal_i(file.index_len, NUM_RECORDS - (NUM_RECORDS / 5));
+  }
+
+  settings_file_close(&file);
+  cl_assert(!file.index);
+}
+
+void test_settings_file_index__rebuilt_on_open(void) {
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "index_reopen", FILE_MAX_USED_SPACE));
+  prv_fill(&file, NUM_RECORDS);
+  settings_file_close(&file);
+
+  cl_must_pass(settings_file_open(&file, "index_reopen", FILE_MAX_USED_SPACE));
+  cl_assert(file.index);
+  cl_assert_equal_i(file.index_len, NUM_RECORDS);
+  for (int i = 0; i < file.index_len - 1; i++) {
+    cl_assert(file.index[i].key_hash <= file.index[i + 1].key_hash);
+  }
+
+  char key[8];
+  char val[8];
+  for (int i = 0; i < NUM_RECORDS; i++) {
+    prv_key_val(i, key, val);
+    prv_verify_value(&file, i, val);
+  }
+  settings_file_close(&file);
+}
+
+void test_settings_file_index__falls_back_without_index(void) {
+  // Opening the file without enough memory for the index still works
+  SettingsFile file;
+  cl_must_pass(settings_file_open(&file, "index_fallback", FILE_MAX_USED_SPACE));
+  prv_fill(&file, 100);
+  settings_file_close(&file);
+
+  stub_pbl_malloc_set_kernel_malloc_should_fail(true);
+  cl_must_pass(settings_file_open(&file, "index_fallback", FILE_MAX_USED_SPACE));
+  stub_pbl_malloc_set_kernel_malloc_should_fail(false);
+  cl_assert(!file.index);
+
+  char key[8];
+  char val[8];
+  prv_key_val(42, key, val);
+  cl_must_pass(settings_file_set(&file, key, strlen(key), "new", 3));
+  for (int i = 0; i < 100; i++) {
+    prv_key_val(i, key, val);
+    prv_verify_value(&file, i, (i == 42) ? "new" : val);
+  }
+  settings_file_close(&file);
+}
@@ -67,6 +67,7 @@ static void stub_evented_timer_callback(void* data) {
 
 
 void test_evented_timer__initialize(void) {
+  evented_timer_init();
   s_times_callback_executed = 0;
 
   s_last_event = (PebbleEvent) { 0 };
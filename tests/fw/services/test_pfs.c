@@ -1,6 +1,7 @@
 /* SPDX-FileCopyrightText: 2024 Google LLC */
 /* SPDX-License-Identifier: Apache-2.0 */
 
+#include <inttypes.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -51,8 +52,11 @@ static uint32_t num_pages(void) {
   return pfs_get_size() / PFS_SECTOR_SIZE;
 }
 
+extern void test_enable_name_index(bool enabled);
+
 void test_pfs__initialize(void) {
   fake_spi_flash_init(0, 0x1000000);
+  test_enable_name_index(true);
   pfs_init(false);
   pfs_format(true /* write erase headers */);
 
@@ -994,3 +998,195 @@ void test_pfs__doesnt_give_out_fd_zero(void) {
     cl_assert(fd > 0);
   }
 }
+
+static uint32_t prv_flash_reads_per_open(int num_files, int num_opens) {
+  char file_name[20];
+  const uint32_t start_reads = fake_flash_read_count();
+  for (int i = 0; i < num_opens; i++) {
+    snprintf(file_name, sizeof(file_name), "lookup%d", (i * num_files) / num_opens);
+    int fd = pfs_open(file_name, OP_FLAG_READ, 0, 0);
+    cl_assert(fd >= 0);
+    pfs_close(fd);
+  }
+  return (fake_flash_read_count() - start_reads) / num_opens;
+}
+
+void test_pfs__name_index_lookup(void) {
+  const int num_files = 500;
+  const int num_opens = 50;
+  char file_name[20];
+
+  for (int i = 0; i < num_files; i++) {
+    snprintf(file_name, sizeof(file_name), "lookup%d", i);
+    int fd = pfs_open(file_name, OP_FLAG_WRITE, FILE_TYPE_STATIC, 10);
+    cl_assert(fd >= 0);
+    cl_assert_equal_i(pfs_write(fd, file_name, 10), 10);
+    cl_assert_equal_i(pfs_close(fd), S_SUCCESS);
+  }
+
+  // reboot so that none of the files are sitting in the fd cache
+  pfs_init(false);
+  const uint32_t indexed_reads = prv_flash_reads_per_open(num_files, num_opens);
+
+  // the index must follow files around as they are removed and re-created
+  cl_assert_equal_i(pfs_remove("lookup0"), S_SUCCESS);
+  cl_assert_equal_i(pfs_open("lookup0", OP_FLAG_READ, 0, 0), E_DOES_NOT_EXIST);
+  int fd = pfs_open("lookup0", OP_FLAG_WRITE, FILE_TYPE_STATIC, 10);
+  cl_assert(fd >= 0);
+  pfs_close(fd);
+
+  test_enable_name_index(false);
+  pfs_init(false);
+  const uint32_t scanned_reads = prv_flash_reads_per_open(num_files, num_opens);
+
+  printf("Flash reads per pfs_open() with %d files: %"PRIu32" indexed, %"PRIu32" scanned\n",
+         num_files, indexed_reads, scanned_reads);
+  cl_assert(indexed_reads <= 12);
+  cl_assert(indexed_reads * 10 < scanned_reads);
+}
+
+static uint32_t prv_random_reads(int fd, int file_size, int num_reads, uint8_t *expected) {
+  uint32_t seed = 0x1234;
+  const uint32_t start_reads = fake_flash_read_count();
+  for (int i = 0; i < num_reads; i++) {
+    seed = (seed * 1103515245) + 12345;
+    const int offset = (seed >> 8) % file_size;
+    uint8_t read_byte;
+    cl_assert_equal_i(pfs_seek(fd, offset, FSeekSet), offset);
+    cl_assert_equal_i(pfs_read(fd, &read_byte, sizeof(read_byte)), sizeof(read_byte));
+    cl_assert_equal_i(read_byte, expected[offset]);
+  }
+  return fake_flash_read_count() - start_reads;
+}
+
+void test_pfs__page_cache_fragmented_random_reads(void) {
+  // fill the filesystem leaving a hole every other page so the next large file
+  // is badly fragmented
+  char file_small[20];
+  for (int i = 0; i < num_pages(); i++) {
+    snprintf(file_small, sizeof(file_small), "frag%d", i);
+    int fd = pfs_open(file_small, OP_FLAG_WRITE, FILE_TYPE_STATIC, 10);
+    cl_assert(fd >= 0);
+    cl_assert_equal_i(pfs_close(fd), S_SUCCESS);
+    if ((i & 0x1) == 0) {
+      cl_assert_equal_i(pfs_remove(file_small), S_SUCCESS);
+    }
+  }
+
+  const int file_size = 150 * PFS_SECTOR_SIZE;
+  uint8_t *data = malloc(file_size);
+  for (int i = 0; i < file_size; i++) {
+    data[i] = (i * 7) + (i / PFS_SECTOR_SIZE);
+  }
+  int fd = pfs_open("fragmented", OP_FLAG_WRITE, FILE_TYPE_STATIC, file_size);
+  cl_assert(fd >= 0);
+  cl_assert_equal_i(pfs_write(fd, data, file_size), file_size);
+  pfs_close(fd);
+
+  const int num_reads = 200;
+  fd = pfs_open("fragmented", OP_FLAG_READ, 0, 0);
+  cl_assert(fd >= 0);
+  const uint32_t chained_reads = prv_random_reads(fd, file_size, num_reads, data);
+  pfs_close(fd);
+
+  fd = pfs_open("fragmented", OP_FLAG_READ | OP_FLAG_USE_PAGE_CACHE, 0, 0);
+  cl_assert(fd >= 0);
+  // the first read builds the page cache, after that each read is a single flash read
+  prv_random_reads(fd, file_size, 1, data);
+  const uint32_t cached_reads = prv_random_reads(fd, file_size, num_reads, data);
+  pfs_close(fd);
+
+  printf("Flash reads for %d random reads of a fragmented file: %"PRIu32" cached, "
+         "%"PRIu32" following the page chain\n", num_reads, cached_reads, chained_reads);
+  cl_assert_equal_i(cached_reads, num_reads);
+  cl_assert(cached_reads * 10 < chained_reads);
+
+  // sequential reads must hop across runs using the cache as well
+  fd = pfs_open("fragmented", OP_FLAG_READ | OP_FLAG_USE_PAGE_CACHE, 0, 0);
+  uint8_t *read_back = malloc(file_size);
+  cl_assert_equal_i(pfs_read(fd, read_back, file_size), file_size);
+  cl_assert_equal_m(read_back, data, file_size);
+  pfs_close(fd);
+
+  free(read_back);
+  free(data);
+}
+
+extern void test_get_erase_count_range(uint32_t *min_count, uint32_t *max_count);
+
+//! Page flags are read straight from flash in unit tests so only count the operations which are
+//! slow on real hardware
+static uint32_t prv_flash_ops(void) {
+  return fake_flash_write_count() + fake_flash_erase_count();
+}
+
+typedef struct {
+  uint32_t worst_write_ops;
+  uint32_t erase_count_spread;
+} GCWorkloadResult;
+
+//! Replays a settings-file style workload: a set of long lived files scattered over the whole
+//! filesystem plus a few hot files which are rewritten over and over again.
+static GCWorkloadResult prv_run_gc_workload(bool background_gc) {
+  char file_name[20];
+  uint8_t buf[PFS_SECTOR_SIZE];
+  memset(buf, 0x5a, sizeof(buf));
+
+  // leave long lived files on every other page so garbage collection has to copy data around
+  for (int i = 0; i < (num_pages() * 8) / 10; i++) {
+    snprintf(file_name, sizeof(file_name), "cold%d", i);
+    int fd = pfs_open(file_name, OP_FLAG_WRITE, FILE_TYPE_STATIC, 10);
+    cl_assert(fd >= 0);
+    pfs_close(fd);
+    if ((i & 0x1) == 0) {
+      cl_assert_equal_i(pfs_remove(file_name), S_SUCCESS);
+    }
+  }
+
+  GCWorkloadResult result = {};
+  const int num_hot_files = 8;
+  const int hot_file_size = 3 * PFS_SECTOR_SIZE;
+  for (int i = 0; i < num_hot_files; i++) {
+    snprintf(file_name, sizeof(file_name), "hot%d", i);
+    int fd = pfs_open(file_name, OP_FLAG_WRITE, FILE_TYPE_STATIC, hot_file_size);
+    cl_assert(fd >= 0);
+    pfs_close(fd);
+  }
+
+  for (int i = 0; i < (num_pages() * 2) / 3; i++) {
+    snprintf(file_name, sizeof(file_name), "hot%d", i % num_hot_files);
+
+    const uint32_t start_ops = prv_flash_ops();
+    int fd = pfs_open(file_name, OP_FLAG_OVERWRITE | OP_FLAG_WRITE, FILE_TYPE_STATIC,
+                      hot_file_size);
+    cl_assert(fd >= 0);
+    for (int written = 0; written < hot_file_size; written += sizeof(buf)) {
+      cl_assert_equal_i(pfs_write(fd, buf, sizeof(buf)), sizeof(buf));
+    }
+    cl_assert_equal_i(pfs_close(fd), S_SUCCESS);
+    result.worst_write_ops = MAX(result.worst_write_ops, prv_flash_ops() - start_ops);
+
+    // the system task gets to run whenever the writer is idle
+    while (background_gc && pfs_gc_incremental_step()) {}
+  }
+
+  uint32_t min_erase_count, max_erase_count;
+  test_get_erase_count_range(&min_erase_count, &max_erase_count);
+  result.erase_count_spread = max_erase_count - min_erase_count;
+  return result;
+}
+
+void test_pfs__background_gc_write_latency(void) {
+  const GCWorkloadResult inline_gc = prv_run_gc_workload(false);
+
+  test_pfs__cleanup();
+  test_pfs__initialize();
+  const GCWorkloadResult background_gc = prv_run_gc_workload(true);
+
+  printf("Worst case flash ops per file rewrite: %"PRIu32" inline GC, %"PRIu32" background GC\n",
+         inline_gc.worst_write_ops, background_gc.worst_write_ops);
+  printf("Erase count spread: %"PRIu32" inline GC, %"PRIu32" background GC\n",
+         inline_gc.erase_count_spread, background_gc.erase_count_spread);
+  cl_assert(background_gc.worst_write_ops * 4 < inline_gc.worst_write_ops);
+  cl_assert(background_gc.erase_count_spread <= inline_gc.erase_count_spread);
+}
@@ -221,6 +221,9 @@ void event_service_clear_process_subscriptions(void) {
 void evented_timer_clear_process_timers(PebbleTask task) {
 }
 
+void timeline_process_cleanup(PebbleTask task) {
+}
+
 void launcher_task_add_callback(void (*callback)(void *data), void *data) {
   callback(data);
 }
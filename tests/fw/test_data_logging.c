@@ -14,7 +14,10 @@
 #include "pbl/services/comm_session/session_send_buffer.h"
 #include "pbl/services/comm_session/session_transport.h"
 
+#include "pbl/services/activity/activity_algorithm.h"
+
 #include "pbl/services/data_logging/data_logging_service.h"
+#include "pbl/services/data_logging/dls_encoding.h"
 #include "pbl/services/data_logging/dls_private.h"
 #include "pbl/services/data_logging/dls_list.h"
 #include "pbl/services/data_logging/dls_storage.h"
@@ -88,9 +91,12 @@ static DataLoggingSendDataMessage s_prev_send_data_hdr;
 static uint8_t s_prev_send_data[COMM_MAX_OUTBOUND_PAYLOAD_SIZE];
 static uint32_t s_prev_send_data_bytes;
 
+static void prv_phone_receive(const uint8_t *data, unsigned int data_length);
+
 static void prv_transport_sent_data_cb(uint16_t endpoint_id,
                                        const uint8_t* data, unsigned int data_length) {
   PBL_LOG_INFO("Received %d bytes of data from watch", data_length);
+  prv_phone_receive(data, data_length);
   if (data_length >= sizeof(s_prev_send_data_hdr)) {
     memcpy(&s_prev_send_data_hdr, data, sizeof(s_prev_send_data_hdr));
     data_length -= sizeof(s_prev_send_data_hdr);
@@ -105,6 +111,264 @@ static void prv_transport_sent_data_cb(uint16_t endpoint_id,
 }
 
 
+// ----------------------------------------------------------------------------------------
+// Phone side of the endpoint. It acks every data message it gets (nacks one, if asked to), with
+// the ack arriving after the message has gone over a link of limited bandwidth and the phone took
+// a while to reply. Only active between prv_phone_start() and prv_phone_stop().
+
+#define LINK_BYTES_PER_SECOND (4000)
+#define PHONE_REPLY_LATENCY_MS (100)
+#define PHONE_MAX_REPLIES (8)
+
+typedef struct {
+  uint32_t time_ms;
+  DataLoggingEndpointCmd command;
+  uint8_t session_id;
+  bool has_sequence;
+  uint8_t sequence;
+} PhoneReply;
+
+typedef struct {
+  bool active;
+  uint8_t item_type;
+  uint16_t item_size;
+  //! Everything that has been received, decoded
+  uint8_t *data;
+  uint32_t num_bytes;
+  uint32_t capacity;
+
+  //! Nack the data message with this index (counting all received), -1 for none
+  int nack_index;
+  //! Drop data until the session gets opened again, after a nack
+  bool dropping;
+
+  uint32_t now_ms;
+  uint32_t link_free_ms;
+  PhoneReply replies[PHONE_MAX_REPLIES];
+  int num_replies;
+
+  uint32_t num_messages;
+  uint32_t num_bytes_on_air;
+  uint32_t num_encoded_messages;
+  int max_messages_in_flight;
+} PhoneState;
+
+static PhoneState s_phone;
+
+static uint32_t prv_phone_decode_delta_varint(const uint8_t *in, uint32_t in_size,
+                                              uint8_t *out, uint32_t out_size) {
+  uint32_t in_pos = 0;
+  uint32_t out_pos = 0;
+  int64_t value = 0;
+  while (in_pos < in_size) {
+    uint64_t zigzag = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+      cl_assert(in_pos < in_size);
+      byte = in[in_pos++];
+      zigzag |= (uint64_t)(byte & 0x7f) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    value += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+
+    cl_assert(out_pos + s_phone.item_size <= out_size);
+    memcpy(&out[out_pos], &value, s_phone.item_size);
+    out_pos += s_phone.item_size;
+  }
+  return out_pos;
+}
+
+static uint32_t prv_phone_read_length(const uint8_t *in, uint32_t *in_pos, uint32_t length) {
+  if (length == 15) {
+    uint8_t byte;
+    do {
+      byte = in[(*in_pos)++];
+      length += byte;
+    } while (byte == 255);
+  }
+  return length;
+}
+
+static uint32_t prv_phone_decode_lz4(const uint8_t *in, uint32_t in_size,
+                                     uint8_t *out, uint32_t out_size) {
+  uint32_t in_pos = 0;
+  uint32_t out_pos = 0;
+  while (in_pos < in_size) {
+    const uint8_t token = in[in_pos++];
+    const uint32_t num_literals = prv_phone_read_length(in, &in_pos, token >> 4);
+    cl_assert(in_pos + num_literals <= in_size);
+    cl_assert(out_pos + num_literals <= out_size);
+    memcpy(&out[out_pos], &in[in_pos], num_literals);
+    in_pos += num_literals;
+    out_pos += num_literals;
+    if (in_pos == in_size) {
+      // The last sequence has no match
+      break;
+    }
+
+    cl_assert(in_pos + 2 <= in_size);
+    const uint32_t offset = in[in_pos] | (in[in_pos + 1] << 8);
+    in_pos += 2;
+    cl_assert(offset > 0 && offset <= out_pos);
+    const uint32_t match_length = prv_phone_read_length(in, &in_pos, token & 0xf) + 4;
+    cl_assert(out_pos + match_length <= out_size);
+    for (uint32_t i = 0; i < match_length; ++i, ++out_pos) {
+      out[out_pos] = out[out_pos - offset];
+    }
+  }
+  return out_pos;
+}
+
+static void prv_phone_reply(DataLoggingEndpointCmd command, uint8_t session_id,
+                            bool has_sequence, uint8_t sequence) {
+  cl_assert(s_phone.num_replies < PHONE_MAX_REPLIES);
+  s_phone.replies[s_phone.num_replies++] = (PhoneReply) {
+    .time_ms = s_phone.link_free_ms + PHONE_REPLY_LATENCY_MS,
+    .command = command,
+    .session_id = session_id,
+    .has_sequence = has_sequence,
+    .sequence = sequence,
+  };
+}
+
+static void prv_phone_receive_data(uint8_t session_id, const uint8_t *bytes, uint32_t num_bytes,
+                                   uint32_t crc32) {
+  cl_assert(s_phone.num_bytes + num_bytes <= s_phone.capacity);
+  cl_assert_equal_i(legacy_defective_checksum_memory(bytes, num_bytes), crc32);
+  memcpy(&s_phone.data[s_phone.num_bytes], bytes, num_bytes);
+  s_phone.num_bytes += num_bytes;
+}
+
+static void prv_phone_receive(const uint8_t *data, unsigned int data_length) {
+  if (!s_phone.active) {
+    return;
+  }
+
+  // Everything takes its turn on the link
+  s_phone.link_free_ms = MAX(s_phone.link_free_ms, s_phone.now_ms) +
+      ((data_length + sizeof(PebbleProtocolHeader)) * 1000) / LINK_BYTES_PER_SECOND;
+
+  switch (data[0]) {
+    case DataLoggingEndpointCmdOpen:
+      s_phone.dropping = false;
+      prv_phone_reply(DataLoggingEndpointCmdAck, data[1], false, 0);
+      return;
+    case DataLoggingEndpointCmdData:
+    {
+      DataLoggingSendDataMessage hdr;
+      memcpy(&hdr, data, sizeof(hdr));
+      prv_phone_receive_data(hdr.session_id, &data[sizeof(hdr)], data_length - sizeof(hdr),
+                             hdr.crc32);
+      prv_phone_reply(DataLoggingEndpointCmdAck, hdr.session_id, false, 0);
+      break;
+    }
+    case DataLoggingEndpointCmdWindowedData:
+    {
+      DataLoggingSendWindowedDataMessage hdr;
+      memcpy(&hdr, data, sizeof(hdr));
+      const uint8_t *bytes = &data[sizeof(hdr)];
+      const uint32_t num_bytes = data_length - sizeof(hdr);
+      const int index = s_phone.num_messages;
+      if (s_phone.dropping) {
+        break;
+      }
+      if (index == s_phone.nack_index) {
+        s_phone.dropping = true;
+        prv_phone_reply(DataLoggingEndpointCmdNack, hdr.session_id, false, 0);
+        break;
+      }
+
+      uint8_t decoded[DLS_ENDPOINT_MAX_ENCODED_READ_SIZE];
+      uint32_t num_decoded_bytes = 0;
+      switch (hdr.encoding) {
+        case DataLoggingEncodingRaw:
+          memcpy(decoded, bytes, num_bytes);
+          num_decoded_bytes = num_bytes;
+          break;
+        case DataLoggingEncodingDeltaVarint:
+          num_decoded_bytes = prv_phone_decode_delta_varint(bytes, num_bytes, decoded,
+                                                            sizeof(decoded));
+          ++s_phone.num_encoded_messages;
+          break;
+        case DataLoggingEncodingLZ4:
+          num_decoded_bytes = prv_phone_decode_lz4(bytes, num_bytes, decoded, sizeof(decoded));
+          ++s_phone.num_encoded_messages;
+          break;
+        default:
+          cl_fail("Unknown encoding");
+      }
+      cl_assert_equal_i(num_decoded_bytes, hdr.num_bytes);
+      cl_assert_equal_i(num_decoded_bytes % s_phone.item_size, 0);
+      prv_phone_receive_data(hdr.session_id, decoded, num_decoded_bytes, hdr.crc32);
+      prv_phone_reply(DataLoggingEndpointCmdAck, hdr.session_id, true, hdr.sequence);
+      break;
+    }
+    default:
+      return;
+  }
+
+  ++s_phone.num_messages;
+  s_phone.num_bytes_on_air += data_length + sizeof(PebbleProtocolHeader);
+  s_phone.max_messages_in_flight = MAX(s_phone.max_messages_in_flight, s_phone.num_replies);
+}
+
+static void prv_phone_start(DataLoggingItemType item_type, uint16_t item_size,
+                            uint32_t capacity, bool windowed) {
+  free(s_phone.data);
+  s_phone = (PhoneState) {
+    .active = true,
+    .item_type = item_type,
+    .item_size = item_size,
+    .data = malloc(capacity),
+    .capacity = capacity,
+    .nack_index = -1,
+  };
+  fake_comm_session_set_capabilities(windowed ? ~0 : ~CommSessionDataLoggingWindowSupport);
+  // The real send buffer doesn't fail right away when it's full either
+  fake_comm_session_set_send_next_when_full(true);
+}
+
+//! Lets the phone reply to everything it got, until the watch has nothing left to send
+static void prv_phone_run(void) {
+  fake_comm_session_process_send_next();
+  while (s_phone.num_replies > 0) {
+    const PhoneReply reply = s_phone.replies[0];
+    memmove(&s_phone.replies[0], &s_phone.replies[1],
+            --s_phone.num_replies * sizeof(PhoneReply));
+    s_phone.now_ms = MAX(s_phone.now_ms, reply.time_ms);
+
+    const uint8_t msg[] = { ~DLS_ENDPOINT_CMD_MASK | reply.command, reply.session_id,
+                            reply.sequence };
+    data_logging_protocol_msg_callback(s_session, msg, reply.has_sequence ? 3 : 2);
+    fake_system_task_callbacks_invoke_pending();
+    fake_comm_session_process_send_next();
+  }
+}
+
+//! Creates a session and lets the phone ack its opening
+static DataLoggingSessionRef prv_phone_create_session(uint32_t tag, DataLoggingItemType item_type,
+                                                      uint16_t item_size, bool buffered) {
+  Uuid system_uuid = UUID_SYSTEM;
+  const PebbleProcessMd *md = sys_process_manager_get_current_process_md();
+  DataLoggingSessionRef logging_session =
+      (DataLoggingSessionRef)dls_create(tag, item_type, item_size, buffered, false /*resume*/,
+                                        buffered ? &md->uuid : &system_uuid);
+  cl_assert(logging_session);
+  fake_system_task_callbacks_invoke_pending();
+  prv_phone_run();
+  return logging_session;
+}
+
+//! Sends everything logged to the session to the phone
+static void prv_phone_drain_session(DataLoggingSessionRef logging_session) {
+  s_phone.now_ms = 0;
+  s_phone.link_free_ms = 0;
+  dls_private_send_session(logging_session, true /*empty*/);
+  prv_phone_run();
+}
+
+
 // ----------------------------------------------------------------------------------------
 // Setup
 static void prv_init_fake_flash(void) {
@@ -202,12 +466,17 @@ void test_data_logging__initialize(void) {
   Transport *transport = fake_transport_create(TransportDestinationSystem, NULL,
                                                prv_transport_sent_data_cb);
   s_session = fake_transport_set_connected(transport, true /* connected */);
+
+  // Most tests talk to the phone without windowed data messages
+  fake_comm_session_set_capabilities(~CommSessionDataLoggingWindowSupport);
 }
 
 // ----------------------------------------------------------------------------------------
 void test_data_logging__cleanup(void) {
   regular_timer_deinit();
   fake_comm_session_cleanup();
+  free(s_phone.data);
+  s_phone = (PhoneState) {};
 }
 
 // ----------------------------------------------------------------------------------------
@@ -610,3 +879,403 @@ void test_data_logging__send_session_small(void) {
 }
 
 
+
+// ----------------------------------------------------------------------------------------
+// Log the data and have the phone take it with windowed data messages
+static void prv_windowed_endpoint_test(DataLoggingItemType item_type, bool buffered,
+                                       const int item_size, const int num_items,
+                                       const uint8_t *data) {
+  const int num_bytes = item_size * num_items;
+  prv_phone_start(item_type, item_size, num_bytes, true /* windowed */);
+  DataLoggingSessionRef logging_session = prv_phone_create_session(0, item_type, item_size,
+                                                                   buffered);
+
+  prv_data_log_chain(logging_session, (uint8_t *)data, item_size, num_items);
+  prv_phone_drain_session(logging_session);
+
+  cl_assert_equal_i(s_phone.num_bytes, num_bytes);
+  cl_assert_equal_m(s_phone.data, data, num_bytes);
+  cl_assert_equal_i(dls_test_get_num_bytes(logging_session), 0);
+}
+
+// ----------------------------------------------------------------------------------------
+void test_data_logging__send_session_windowed(void) {
+  const int item_size = 90;
+  const int num_items = 100;
+  uint8_t *data;
+  prv_get_random_buffer(&data, item_size * num_items);
+
+  prv_windowed_endpoint_test(DATA_LOGGING_BYTE_ARRAY, true /* buffered */, item_size, num_items,
+                             data);
+  cl_assert_equal_i(s_phone.max_messages_in_flight, DLS_ENDPOINT_MAX_MESSAGES_IN_FLIGHT);
+  free(data);
+}
+
+// ----------------------------------------------------------------------------------------
+void test_data_logging__send_session_windowed_large(void) {
+  const int item_size = DLS_ENDPOINT_MAX_PAYLOAD;
+  const int num_items = 20;
+  uint8_t *data;
+  prv_get_random_buffer(&data, item_size * num_items);
+
+  prv_windowed_endpoint_test(DATA_LOGGING_BYTE_ARRAY, false /* buffered */, item_size, num_items,
+                             data);
+  // Items that big never take less than a message each
+  cl_assert_equal_i(s_phone.num_messages, num_items);
+  free(data);
+}
+
+// ----------------------------------------------------------------------------------------
+void test_data_logging__send_session_windowed_encoded_ints(void) {
+  // A slow random walk, with some big jumps in between
+  const int num_items = 3000;
+  int16_t *data = malloc(num_items * sizeof(int16_t));
+  int16_t value = -100;
+  for (int i = 0; i < num_items; ++i) {
+    value += (i % 500 == 0) ? 20000 : (rand() % 7) - 3;
+    data[i] = value;
+  }
+
+  prv_windowed_endpoint_test(DATA_LOGGING_INT, true /* buffered */, sizeof(int16_t), num_items,
+                             (uint8_t *)data);
+  cl_assert_equal_i(s_phone.num_encoded_messages, s_phone.num_messages);
+  // Most deltas fit into a single byte
+  cl_assert(s_phone.num_bytes_on_air < num_items * sizeof(int16_t) * 6 / 10);
+  free(data);
+}
+
+// ----------------------------------------------------------------------------------------
+void test_data_logging__send_session_windowed_encoded_byte_arrays(void) {
+  // Records that mostly repeat the ones before them
+  const int item_size = 40;
+  const int num_items = 200;
+  uint8_t *data = malloc(item_size * num_items);
+  for (int i = 0; i < num_items; ++i) {
+    for (int j = 0; j < item_size; ++j) {
+      data[i * item_size + j] = (j < 4) ? i : (j % 8);
+    }
+  }
+
+  prv_windowed_endpoint_test(DATA_LOGGING_BYTE_ARRAY, true /* buffered */, item_size, num_items,
+                             data);
+  cl_assert_equal_i(s_phone.num_encoded_messages, s_phone.num_messages);
+  cl_assert(s_phone.num_bytes_on_air < item_size * num_items / 4);
+  free(data);
+}
+
+// ----------------------------------------------------------------------------------------
+// The phone nacks a message while others are in flight. It drops the ones after it, so they
+// have to be sent again once the session has been reopened.
+void test_data_logging__send_session_windowed_nack(void) {
+  const int item_size = 100;
+  const int num_items = 60;
+  const int num_bytes = item_size * num_items;
+  uint8_t *data;
+  prv_get_random_buffer(&data, num_bytes);
+
+  prv_phone_start(DATA_LOGGING_BYTE_ARRAY, item_size, num_bytes, true /* windowed */);
+  DataLoggingSessionRef logging_session = prv_phone_create_session(0, DATA_LOGGING_BYTE_ARRAY,
+                                                                   item_size, true /* buffered */);
+  s_phone.nack_index = 1;
+
+  prv_data_log_chain(logging_session, data, item_size, num_items);
+  prv_phone_drain_session(logging_session);
+
+  cl_assert_equal_i(s_phone.num_bytes, num_bytes);
+  cl_assert_equal_m(s_phone.data, data, num_bytes);
+  cl_assert_equal_i(dls_test_get_num_bytes(logging_session), 0);
+  free(data);
+}
+
+// ----------------------------------------------------------------------------------------
+// A day of minute data the way the activity service logs it: one AlgMinuteDLSRecord every 15
+// minutes, plus a session of the steps of every minute.
+
+typedef struct {
+  uint32_t num_messages;
+  uint32_t num_bytes_on_air;
+  uint32_t drain_time_ms;
+} DrainStats;
+
+static uint32_t s_sim_rand;
+
+static uint32_t prv_sim_rand(uint32_t range) {
+  s_sim_rand = s_sim_rand * 1103515245 + 12345;
+  return (s_sim_rand >> 16) % range;
+}
+
+static void prv_simulate_minute(int minute, AlgMinuteDLSSample *sample, uint16_t *steps) {
+  const int hour = minute / 60;
+  const bool asleep = (hour < 7 || hour >= 23);
+  const bool walking = ((minute >= 8 * 60 && minute < 8 * 60 + 25) ||
+                        (minute >= 12 * 60 + 30 && minute < 12 * 60 + 50) ||
+                        (minute >= 18 * 60 && minute < 18 * 60 + 40));
+  // The heart rate gets measured every 10 minutes, and continuously while working out
+  const bool hr_measured = walking || (minute % 10 == 0);
+
+  AlgMinuteDLSSample s = {
+    .base = {
+      .orientation = asleep ? 0x22 : 0x40 + prv_sim_rand(4),
+      .light = asleep ? 0 : 20 + prv_sim_rand(10),
+    },
+    .resting_calories = 1,
+  };
+  if (walking) {
+    s.base.steps = 95 + prv_sim_rand(20);
+    s.base.vmc = 3000 + prv_sim_rand(2000);
+    s.base.active = true;
+    s.active_calories = 4;
+    s.distance_cm = s.base.steps * 70;
+    s.heart_rate_zone = 1;
+  } else if (!asleep && prv_sim_rand(8) == 0) {
+    s.base.steps = prv_sim_rand(30);
+    s.base.vmc = 200 + prv_sim_rand(800);
+    s.distance_cm = s.base.steps * 60;
+  } else {
+    s.base.vmc = asleep ? prv_sim_rand(40) : prv_sim_rand(300);
+  }
+  if (hr_measured) {
+    s.heart_rate_bpm = walking ? 110 + prv_sim_rand(15) : (asleep ? 52 : 68) + prv_sim_rand(6);
+    s.heart_rate_total_weight_x100 = 100 + prv_sim_rand(200);
+  }
+  *sample = s;
+  *steps = s.base.steps;
+}
+
+static void prv_simulate_day(bool windowed, DrainStats *stats) {
+  const int minutes_per_day = 24 * 60;
+  const int num_records = minutes_per_day / ALG_MINUTES_PER_DLS_RECORD;
+  AlgMinuteDLSRecord *records = calloc(num_records, sizeof(AlgMinuteDLSRecord));
+  uint16_t *steps = calloc(minutes_per_day, sizeof(uint16_t));
+  s_sim_rand = 42;
+  for (int minute = 0; minute < minutes_per_day; ++minute) {
+    AlgMinuteDLSRecord *record = &records[minute / ALG_MINUTES_PER_DLS_RECORD];
+    record->hdr = (AlgMinuteRecordHdr) {
+      .version = ALG_DLS_MINUTES_RECORD_VERSION,
+      .time_utc = 1790000000 + (minute / ALG_MINUTES_PER_DLS_RECORD) * 15 * 60,
+      .time_local_offset_15_min = -28,
+      .sample_size = sizeof(AlgMinuteDLSSample),
+      .num_samples = ALG_MINUTES_PER_DLS_RECORD,
+    };
+    prv_simulate_minute(minute, &record->samples[minute % ALG_MINUTES_PER_DLS_RECORD],
+                        &steps[minute]);
+  }
+
+  *stats = (DrainStats) {};
+
+  // The minute records, logged one at a time as they fill up
+  prv_phone_start(DATA_LOGGING_BYTE_ARRAY, sizeof(AlgMinuteDLSRecord),
+                  num_records * sizeof(AlgMinuteDLSRecord), windowed);
+  DataLoggingSessionRef logging_session =
+      prv_phone_create_session(DlsSystemTagActivityMinuteData, DATA_LOGGING_BYTE_ARRAY,
+                               sizeof(AlgMinuteDLSRecord), false /* buffered */);
+  for (int i = 0; i < num_records; ++i) {
+    data_logging_log(logging_session, &records[i], 1);
+    fake_system_task_callbacks_invoke_pending();
+  }
+  prv_phone_drain_session(logging_session);
+  cl_assert_equal_i(s_phone.num_bytes, num_records * sizeof(AlgMinuteDLSRecord));
+  cl_assert_equal_m(s_phone.data, records, s_phone.num_bytes);
+  stats->num_messages += s_phone.num_messages;
+  stats->num_bytes_on_air += s_phone.num_bytes_on_air;
+  stats->drain_time_ms += s_phone.now_ms;
+
+  // The steps of every minute
+  prv_phone_start(DATA_LOGGING_UINT, sizeof(uint16_t), minutes_per_day * sizeof(uint16_t),
+                  windowed);
+  logging_session = prv_phone_create_session(1, DATA_LOGGING_UINT, sizeof(uint16_t),
+                                             true /* buffered */);
+  prv_data_log_chain(logging_session, (uint8_t *)steps, sizeof(uint16_t), minutes_per_day);
+  prv_phone_drain_session(logging_session);
+  cl_assert_equal_i(s_phone.num_bytes, minutes_per_day * sizeof(uint16_t));
+  cl_assert_equal_m(s_phone.data, steps, s_phone.num_bytes);
+  stats->num_messages += s_phone.num_messages;
+  stats->num_bytes_on_air += s_phone.num_bytes_on_air;
+  stats->drain_time_ms += s_phone.now_ms;
+
+  printf("\n%s: %"PRIu32" data messages, %"PRIu32" bytes on air, drained in %"PRIu32" ms\n",
+         windowed ? "Windowed" : "Legacy", stats->num_messages, stats->num_bytes_on_air,
+         stats->drain_time_ms);
+
+  free(records);
+  free(steps);
+}
+
+void test_data_logging__simulate_day_of_activity_data(void) {
+  DrainStats legacy;
+  prv_simulate_day(false /* windowed */, &legacy);
+
+  // Start over with empty storage and a phone that takes windowed data
+  test_data_logging__cleanup();
+  test_data_logging__initialize();
+  DrainStats windowed;
+  prv_simulate_day(true /* windowed */, &windowed);
+
+  cl_assert(windowed.num_bytes_on_air * 2 < legacy.num_bytes_on_air);
+  cl_assert(windowed.drain_time_ms * 2 < legacy.drain_time_ms);
+}
+
+// ----------------------------------------------------------------------------------------
+// Files written before the larger chunks were introduced must still be read correctly
+void test_data_logging__recover_version_0_file(void) {
+  // The version 0 file layout: a header followed by chunks with a 1 byte header each
+  struct PACKED {
+    uint8_t version;
+    uint8_t comm_session_id;
+    uint32_t timestamp;
+    uint32_t tag;
+    Uuid app_uuid;
+    uint8_t item_type;
+    uint16_t item_size;
+  } file_hdr = {
+    .version = 0x20,
+    .comm_session_id = 3,
+    .timestamp = 1790000000,
+    .tag = 1234,
+    .app_uuid = UUID_SYSTEM,
+    .item_type = DATA_LOGGING_UINT,
+    .item_size = 1,
+  };
+  const int chunk_size = 100;
+  const int num_chunks = 10;
+  uint8_t *data;
+  const uint32_t crc = prv_get_random_buffer(&data, chunk_size * num_chunks);
+
+  char name[DLS_FILE_NAME_MAX_LEN];
+  concat_str_int(DLS_FILE_NAME_PREFIX, file_hdr.comm_session_id, name, sizeof(name));
+  int fd = pfs_open(name, OP_FLAG_WRITE | OP_FLAG_READ, FILE_TYPE_STATIC,
+                    DLS_FILE_INIT_SIZE_BYTES);
+  cl_assert(fd >= 0);
+  cl_assert_equal_i(pfs_write(fd, &file_hdr, sizeof(file_hdr)), sizeof(file_hdr));
+  // A chunk that has already been consumed, followed by the ones that haven't
+  const uint8_t consumed_chunk_hdr = chunk_size;
+  cl_assert_equal_i(pfs_write(fd, &consumed_chunk_hdr, 1), 1);
+  cl_assert_equal_i(pfs_write(fd, data, chunk_size), chunk_size);
+  for (int i = 0; i < num_chunks; ++i) {
+    const uint8_t chunk_hdr = 0x80 | chunk_size;
+    cl_assert_equal_i(pfs_write(fd, &chunk_hdr, 1), 1);
+    cl_assert_equal_i(pfs_write(fd, &data[i * chunk_size], chunk_size), chunk_size);
+  }
+  pfs_close(fd);
+
+  // Rebuild the list from flash
+  dls_list_remove_all();
+  regular_timer_deinit();
+  regular_timer_init();
+  dls_init();
+  fake_system_task_callbacks_invoke_pending();
+
+  DataLoggingSession *logging_session = dls_list_get_next(NULL);
+  cl_assert(logging_session != NULL);
+  cl_assert_equal_i(dls_test_get_tag(logging_session), file_hdr.tag);
+  cl_assert_equal_i(dls_test_get_num_bytes(logging_session), chunk_size * num_chunks);
+  prv_check_session_data(logging_session, crc, chunk_size * num_chunks);
+  free(data);
+}
+
+// ----------------------------------------------------------------------------------------
+// Files with the larger chunks get their own name prefix, so firmware that only knows the
+// version 0 layout never picks them up
+void test_data_logging__version_1_file_name(void) {
+  DataLoggingSessionRef logging_session = data_logging_create(1234, DATA_LOGGING_UINT, 1, false);
+  cl_assert(logging_session);
+  fake_system_task_callbacks_invoke_pending();
+  prv_log_random_data(logging_session, 1, 100);
+  fake_system_task_callbacks_invoke_pending();
+
+  const uint8_t comm_session_id = ((DataLoggingSession *)logging_session)->comm.session_id;
+  char name[DLS_FILE_NAME_MAX_LEN];
+  concat_str_int(DLS_FILE_NAME_PREFIX, comm_session_id, name, sizeof(name));
+  cl_assert(pfs_open(name, OP_FLAG_READ, FILE_TYPE_STATIC, 0) < 0);
+
+  concat_str_int(DLS_V1_FILE_NAME_PREFIX, comm_session_id, name, sizeof(name));
+  int fd = pfs_open(name, OP_FLAG_READ, FILE_TYPE_STATIC, 0);
+  cl_assert(fd >= 0);
+  uint8_t version;
+  cl_assert_equal_i(pfs_read(fd, &version, sizeof(version)), sizeof(version));
+  cl_assert_equal_i(version, 0x21);
+  pfs_close(fd);
+
+  // The session is still found by name after a reboot
+  dls_list_remove_all();
+  regular_timer_deinit();
+  regular_timer_init();
+  dls_init();
+  fake_system_task_callbacks_invoke_pending();
+
+  DataLoggingSession *recovered = dls_list_get_next(NULL);
+  cl_assert(recovered != NULL);
+  cl_assert_equal_i(dls_test_get_tag(recovered), 1234);
+  cl_assert_equal_i(dls_test_get_num_bytes(recovered), 100);
+}
+
+// ----------------------------------------------------------------------------------------
+// Firmware from before the larger chunks doesn't see the newer files, so after running it, one of
+// its files can have the same session id as one of them. Both sessions must be restored.
+void test_data_logging__recover_reused_session_id(void) {
+  DataLoggingSessionRef logging_session = data_logging_create(1234, DATA_LOGGING_UINT, 1, false);
+  cl_assert(logging_session);
+  fake_system_task_callbacks_invoke_pending();
+  const uint32_t v1_crc = prv_log_random_data(logging_session, 1, 100);
+  fake_system_task_callbacks_invoke_pending();
+  const uint8_t comm_session_id = ((DataLoggingSession *)logging_session)->comm.session_id;
+
+  // What the older firmware would have written, see recover_version_0_file
+  struct PACKED {
+    uint8_t version;
+    uint8_t comm_session_id;
+    uint32_t timestamp;
+    uint32_t tag;
+    Uuid app_uuid;
+    uint8_t item_type;
+    uint16_t item_size;
+  } file_hdr = {
+    .version = 0x20,
+    .comm_session_id = comm_session_id,
+    .timestamp = 1790000000,
+    .tag = 5678,
+    .app_uuid = UUID_SYSTEM,
+    .item_type = DATA_LOGGING_UINT,
+    .item_size = 1,
+  };
+  const int chunk_size = 50;
+  uint8_t *data;
+  const uint32_t v0_crc = prv_get_random_buffer(&data, chunk_size);
+  char name[DLS_FILE_NAME_MAX_LEN];
+  concat_str_int(DLS_FILE_NAME_PREFIX, comm_session_id, name, sizeof(name));
+  int fd = pfs_open(name, OP_FLAG_WRITE | OP_FLAG_READ, FILE_TYPE_STATIC,
+                    DLS_FILE_INIT_SIZE_BYTES);
+  cl_assert(fd >= 0);
+  cl_assert_equal_i(pfs_write(fd, &file_hdr, sizeof(file_hdr)), sizeof(file_hdr));
+  const uint8_t chunk_hdr = 0x80 | chunk_size;
+  cl_assert_equal_i(pfs_write(fd, &chunk_hdr, 1), 1);
+  cl_assert_equal_i(pfs_write(fd, data, chunk_size), chunk_size);
+  pfs_close(fd);
+  free(data);
+
+  // Rebuild the list from flash, twice: the ids have to stay apart after moving one
+  for (int boot = 0; boot < 2; boot++) {
+    dls_list_remove_all();
+    regular_timer_deinit();
+    regular_timer_init();
+    dls_init();
+    fake_system_task_callbacks_invoke_pending();
+
+    DataLoggingSession *first = dls_list_get_next(NULL);
+    cl_assert(first != NULL);
+    DataLoggingSession *second = dls_list_get_next(first);
+    cl_assert(second != NULL);
+    cl_assert(dls_list_get_next(second) == NULL);
+    cl_assert(dls_test_get_session_id(first) != dls_test_get_session_id(second));
+
+    DataLoggingSession *v1_session = (dls_test_get_tag(first) == 1234) ? first : second;
+    DataLoggingSession *v0_session = (v1_session == first) ? second : first;
+    cl_assert_equal_i(dls_test_get_tag(v0_session), file_hdr.tag);
+    cl_assert_equal_i(dls_test_get_num_bytes(v1_session), 100);
+    cl_assert_equal_i(dls_test_get_num_bytes(v0_session), chunk_size);
+    if (boot == 1) {
+      prv_check_session_data(v1_session, v1_crc, 100);
+      prv_check_session_data(v0_session, v0_crc, chunk_size);
+    }
+  }
+}
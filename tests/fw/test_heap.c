@@ -2,6 +2,8 @@
 /* SPDX-License-Identifier: Apache-2.0 */
 
 #include "pbl/util/heap.h"
+#include "pbl/util/math.h"
+#include "pbl/util/size.h"
 
 #include "applib/app_heap_util.h"
 
@@ -15,8 +17,10 @@
 #include "stubs_worker_state.h"
 
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 #define BLOCK_SIZE  sizeof(unsigned long)
 
@@ -332,3 +336,314 @@ void test_heap__fuzz_on_free(void) {
   prv_alloc_and_test_fuzz_on_free(true);
   prv_alloc_and_test_fuzz_on_free(false);
 }
+
+// Allocator benchmark
+///////////////////////////////////////////////////////////
+
+#define TRACE_HEAP_SIZE (64 * 1024)
+#define TRACE_MAX_LIVE 1024
+#define TRACE_NUM_ALLOCS 200000
+
+typedef struct {
+  //! Slot the allocation is stored in
+  uint16_t slot;
+  bool is_free;
+  uint16_t size;
+} TraceOp;
+
+static uint32_t s_trace_seed;
+
+static uint32_t prv_trace_rand(void) {
+  s_trace_seed = (s_trace_seed * 1103515245) + 12345;
+  return (s_trace_seed >> 8);
+}
+
+//! Generates a trace of a UI pushing and popping windows (a frame buffer sized bitmap, the window
+//! and its layers which live until the window is popped) while timeline nodes are created and
+//! short lived strings come and go.
+//! @return the number of ops in the trace
+static int prv_generate_trace(TraceOp *trace) {
+  int free_at[TRACE_MAX_LIVE];
+  bool in_use[TRACE_MAX_LIVE] = {};
+  s_trace_seed = 42;
+
+  int num_ops = 0;
+  int window_pop_at = 0;
+  for (int t = 0; t < TRACE_NUM_ALLOCS; t++) {
+    for (int slot = 0; slot < TRACE_MAX_LIVE; slot++) {
+      if (in_use[slot] && (free_at[slot] <= t)) {
+        in_use[slot] = false;
+        trace[num_ops++] = (TraceOp) { .slot = slot, .is_free = true };
+      }
+    }
+
+    int size;
+    int lifetime;
+    const uint32_t kind = prv_trace_rand() % 100;
+    if (t == window_pop_at) {
+      window_pop_at = t + 500 + (prv_trace_rand() % 2000);
+      size = 2048 + (prv_trace_rand() % 2048);
+      lifetime = window_pop_at - t;
+    } else if (kind < 10) {
+      // windows and layers
+      size = 128 + (prv_trace_rand() % 256);
+      lifetime = 200 + (prv_trace_rand() % 800);
+    } else if (kind < 50) {
+      // timeline nodes
+      size = 40;
+      lifetime = 100 + (prv_trace_rand() % 1400);
+    } else {
+      // strings and other short lived buffers
+      size = 8 + (prv_trace_rand() % 120);
+      lifetime = 1 + (prv_trace_rand() % 50);
+    }
+
+    for (int slot = 0; slot < TRACE_MAX_LIVE; slot++) {
+      if (!in_use[slot]) {
+        in_use[slot] = true;
+        free_at[slot] = t + lifetime;
+        trace[num_ops++] = (TraceOp) { .slot = slot, .size = size };
+        break;
+      }
+    }
+  }
+  return num_ops;
+}
+
+extern uint32_t heap_prv_get_num_blocks_searched(void);
+
+//! The first-fit allocator heap.c was before it got segregated free lists, as the baseline for the
+//! benchmark. It uses the same block layout: blocks are measured in words including a one word
+//! header, small blocks are searched for from the start of the heap and large ones from its end
+//! and the first block of the heap keeps the size of the last one.
+typedef struct {
+  uint16_t prev_size;
+  bool is_allocated:1;
+  uint16_t size:15;
+} FirstFitBlock;
+
+_Static_assert(sizeof(FirstFitBlock) <= sizeof(unsigned long), "FirstFitBlock too large");
+
+//! Allocations of at least this many words are placed at the end of the heap
+#define FIRST_FIT_LARGE_SIZE (256 / sizeof(unsigned long))
+
+typedef struct {
+  unsigned long *begin;
+  unsigned long *end;
+  unsigned int current_size;
+  unsigned int high_water_mark;
+  uint32_t num_blocks_searched;
+} FirstFitHeap;
+
+static FirstFitBlock *prv_first_fit_block(unsigned long *ptr) {
+  return (FirstFitBlock *)ptr;
+}
+
+static void prv_first_fit_init(FirstFitHeap *heap, void *start, size_t size) {
+  const size_t num_words = MIN(size / sizeof(unsigned long), 0x7FFF);
+  *heap = (FirstFitHeap) {
+    .begin = start,
+    .end = (unsigned long *)start + num_words,
+  };
+  *prv_first_fit_block(heap->begin) = (FirstFitBlock) {
+    .prev_size = num_words,
+    .size = num_words,
+  };
+}
+
+//! Updates the prev_size of the block after ptr, which is the first block if ptr is the last one
+static void prv_first_fit_update_next(FirstFitHeap *heap, unsigned long *ptr) {
+  unsigned long *next = ptr + prv_first_fit_block(ptr)->size;
+  prv_first_fit_block((next == heap->end) ? heap->begin : next)->prev_size =
+      prv_first_fit_block(ptr)->size;
+}
+
+static void *prv_first_fit_malloc(FirstFitHeap *heap, size_t nbytes) {
+  const unsigned long n_units = ((nbytes + sizeof(unsigned long) - 1) / sizeof(unsigned long)) + 1;
+  const bool is_large = (n_units >= FIRST_FIT_LARGE_SIZE);
+
+  unsigned long *ptr = is_large ? (heap->end - prv_first_fit_block(heap->begin)->prev_size) :
+                                  heap->begin;
+  while ((!is_large || (ptr > heap->begin)) && (ptr < heap->end)) {
+    heap->num_blocks_searched++;
+    const FirstFitBlock *block = prv_first_fit_block(ptr);
+    if (!block->is_allocated && (block->size >= n_units)) {
+      break;
+    }
+    ptr = is_large ? (ptr - block->prev_size) : (ptr + block->size);
+  }
+  FirstFitBlock *block = prv_first_fit_block(ptr);
+  if ((ptr == heap->end) || block->is_allocated || (block->size < n_units)) {
+    return NULL;
+  }
+
+  // Only split off the rest if it can hold a header and a word of data
+  if (block->size >= n_units + 2) {
+    const unsigned long first_part_size = is_large ? (block->size - n_units) : n_units;
+    unsigned long *second_ptr = ptr + first_part_size;
+    *prv_first_fit_block(second_ptr) = (FirstFitBlock) {
+      .prev_size = first_part_size,
+      .size = block->size - first_part_size,
+    };
+    block->size = first_part_size;
+    prv_first_fit_update_next(heap, second_ptr);
+    if (is_large) {
+      ptr = second_ptr;
+      block = prv_first_fit_block(ptr);
+    }
+  }
+  block->is_allocated = true;
+
+  heap->current_size += block->size * sizeof(unsigned long);
+  heap->high_water_mark = MAX(heap->high_water_mark, heap->current_size);
+  return ptr + 1;
+}
+
+static void prv_first_fit_free(FirstFitHeap *heap, void *data) {
+  unsigned long *ptr = (unsigned long *)data - 1;
+  FirstFitBlock *block = prv_first_fit_block(ptr);
+  cl_assert(block->is_allocated);
+  block->is_allocated = false;
+  heap->current_size -= block->size * sizeof(unsigned long);
+
+  if (ptr != heap->begin) {
+    unsigned long *prev = ptr - block->prev_size;
+    if (!prv_first_fit_block(prev)->is_allocated) {
+      prv_first_fit_block(prev)->size += block->size;
+      ptr = prev;
+      block = prv_first_fit_block(ptr);
+    }
+  }
+  unsigned long *next = ptr + block->size;
+  if ((next != heap->end) && !prv_first_fit_block(next)->is_allocated) {
+    block->size += prv_first_fit_block(next)->size;
+  }
+  prv_first_fit_update_next(heap, ptr);
+}
+
+static void prv_first_fit_calc_totals(FirstFitHeap *heap, unsigned int *free_bytes,
+                                      unsigned int *max_free) {
+  *free_bytes = 0;
+  *max_free = 0;
+  for (unsigned long *ptr = heap->begin; ptr < heap->end; ptr += prv_first_fit_block(ptr)->size) {
+    const FirstFitBlock *block = prv_first_fit_block(ptr);
+    if (!block->is_allocated) {
+      *free_bytes += block->size * sizeof(unsigned long);
+      *max_free = MAX(*max_free, block->size * sizeof(unsigned long));
+    }
+  }
+}
+
+//! Fragmentation is sampled this often while replaying the trace
+#define TRACE_SAMPLE_INTERVAL 1000
+
+typedef struct {
+  //! Only printed, wall-clock time is too noisy to assert on
+  double ns_per_op;
+  double blocks_searched_per_malloc;
+  //! Average of the sampled fragmentation of the free space, in percent
+  double avg_fragmentation;
+  int max_fragmentation;
+  unsigned int high_water_mark;
+} TraceResult;
+
+static TraceResult prv_replay_trace(const TraceOp *trace, int num_ops, bool first_fit) {
+  void *heap_space = malloc(TRACE_HEAP_SIZE);
+  cl_assert(heap_space != NULL);
+  Heap heap;
+  FirstFitHeap first_fit_heap;
+  if (first_fit) {
+    prv_first_fit_init(&first_fit_heap, heap_space, TRACE_HEAP_SIZE);
+  } else {
+    heap_init(&heap, heap_space, heap_space + TRACE_HEAP_SIZE, false);
+  }
+  void *live[TRACE_MAX_LIVE] = {};
+
+  TraceResult result = {};
+  int num_mallocs = 0;
+  int num_samples = 0;
+  int64_t total_fragmentation = 0;
+  uint64_t elapsed_us = 0;
+  const uint32_t start_blocks_searched = heap_prv_get_num_blocks_searched();
+  for (int start = 0; start < num_ops; start += TRACE_SAMPLE_INTERVAL) {
+    const int end = MIN(start + TRACE_SAMPLE_INTERVAL, num_ops);
+    struct timeval start_time;
+    gettimeofday(&start_time, NULL);
+    for (int i = start; i < end; i++) {
+      void **slot = &live[trace[i].slot];
+      if (trace[i].is_free) {
+        if (first_fit) {
+          prv_first_fit_free(&first_fit_heap, *slot);
+        } else {
+          heap_free(&heap, *slot, 0);
+        }
+      } else {
+        *slot = first_fit ? prv_first_fit_malloc(&first_fit_heap, trace[i].size) :
+                            heap_malloc(&heap, trace[i].size, 0);
+        cl_assert(*slot);
+        num_mallocs++;
+      }
+    }
+    struct timeval end_time;
+    gettimeofday(&end_time, NULL);
+    elapsed_us += ((end_time.tv_sec - start_time.tv_sec) * 1000000) +
+                  (end_time.tv_usec - start_time.tv_usec);
+
+    unsigned int used, free_bytes, max_free;
+    if (first_fit) {
+      prv_first_fit_calc_totals(&first_fit_heap, &free_bytes, &max_free);
+    } else {
+      heap_calc_totals(&heap, &used, &free_bytes, &max_free);
+    }
+    const int fragmentation = 100 - ((max_free * 100) / free_bytes);
+    total_fragmentation += fragmentation;
+    result.max_fragmentation = MAX(result.max_fragmentation, fragmentation);
+    num_samples++;
+  }
+  const uint32_t blocks_searched = first_fit ? first_fit_heap.num_blocks_searched :
+      (heap_prv_get_num_blocks_searched() - start_blocks_searched);
+
+  result.ns_per_op = (elapsed_us * 1000.0) / num_ops;
+  result.blocks_searched_per_malloc = (double)blocks_searched / num_mallocs;
+  result.avg_fragmentation = (double)total_fragmentation / num_samples;
+  result.high_water_mark = first_fit ? first_fit_heap.high_water_mark : heap.high_water_mark;
+
+  free(heap_space);
+  return result;
+}
+
+void test_heap__trace_benchmark(void) {
+  TraceOp *trace = malloc(2 * TRACE_NUM_ALLOCS * sizeof(TraceOp));
+  const int num_ops = prv_generate_trace(trace);
+
+  const TraceResult first_fit = prv_replay_trace(trace, num_ops, true /* first_fit */);
+  const TraceResult segregated = prv_replay_trace(trace, num_ops, false /* first_fit */);
+
+  printf("Allocator trace, %d ops:\n"
+         "              ns/op  blocks/malloc  avg fragmentation  max fragmentation  high water\n",
+         num_ops);
+  const struct {
+    const char *name;
+    const TraceResult *result;
+  } rows[] = {
+    { "first-fit ", &first_fit },
+    { "segregated", &segregated },
+  };
+  for (unsigned int i = 0; i < ARRAY_LENGTH(rows); i++) {
+    const TraceResult *r = rows[i].result;
+    printf("  %s  %7.1f  %13.1f  %16.1f%%  %16d%%  %10u\n", rows[i].name, r->ns_per_op,
+           r->blocks_searched_per_malloc, r->avg_fragmentation, r->max_fragmentation,
+           r->high_water_mark);
+  }
+
+  cl_assert(segregated.blocks_searched_per_malloc < 4);
+  cl_assert(segregated.blocks_searched_per_malloc * 20 < first_fit.blocks_searched_per_malloc);
+  cl_assert(segregated.avg_fragmentation < first_fit.avg_fragmentation + 1);
+  cl_assert(segregated.max_fragmentation <= first_fit.max_fragmentation);
+  // Blocks are handed out whole when the rest would be too small to split off, which fits that
+  // are better than first-fit's do a little more often
+  cl_assert(segregated.high_water_mark <
+            first_fit.high_water_mark + (first_fit.high_water_mark / 100));
+
+  free(trace);
+}
@@ -34,6 +34,7 @@
 #include "stubs_syscalls.h"
 #include "stubs_task.h"
 #include "stubs_tick.h"
+#include "stubs_timeline.h"
 #include "stubs_watchface.h"
 #include "stubs_worker_manager.h"
 #include "stubs_worker_state.h"
@@ -2,6 +2,7 @@
 /* SPDX-License-Identifier: Apache-2.0 */
 
 #include "applib/graphics/utf8.h"
+#include "pbl/util/hash.h"
 #include "utf8_test_data.h"
 
 #include "clar.h"
@@ -77,6 +78,26 @@ void test_utf8__emoji_codepoints(void) {
   cl_assert(utf8_is_valid_string("😃"));
 }
 
+void test_utf8__get_bounds_and_hash(void) {
+  bool success = false;
+  uint32_t text_hash = 0;
+  const Utf8Bounds bounds = utf8_get_bounds_and_hash(&success, s_valid_test_string, &text_hash);
+  cl_assert(success);
+  cl_assert_equal_p(bounds.end, s_valid_test_string + strlen(s_valid_test_string));
+  cl_assert_equal_i(text_hash, hash((const uint8_t *)s_valid_test_string,
+                                    strlen(s_valid_test_string)));
+
+  text_hash = 0;
+  utf8_get_bounds_and_hash(&success, "", &text_hash);
+  cl_assert(success);
+  cl_assert_equal_i(text_hash, hash((const uint8_t *)"", 0));
+
+  text_hash = 0;
+  utf8_get_bounds_and_hash(&success, s_malformed_test_string, &text_hash);
+  cl_assert(!success);
+  cl_assert_equal_i(text_hash, 0);
+}
+
 void test_utf8__copy_single_byte_char(void) {
   utf8_t dest[5];
   memset(dest, 0, 5);
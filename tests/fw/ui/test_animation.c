@@ -84,6 +84,9 @@ void graphics_context_set_drawing_state(GContext *ctx, GDrawState draw_state) {
 void window_schedule_render(struct Window *window) {
 }
 
+void window_schedule_render_rect(struct Window *window, const GRect *rect) {
+}
+
 TimerID animation_service_test_get_timer_id(void);
 
 
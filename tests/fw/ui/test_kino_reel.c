@@ -7,12 +7,15 @@
 #include "applib/ui/kino/kino_reel_gbitmap_sequence.h"
 #include "applib/ui/kino/kino_reel_pdci.h"
 #include "applib/ui/kino/kino_reel_pdcs.h"
+#include "applib/graphics/gdraw_command_private.h"
+#include "pbl/util/size.h"
 #include "util/graphics.h"
 
 #include "clar.h"
 
 // Fakes
 ////////////////////////////////////
+#include "fake_pebble_tasks.h"
 #include "fake_resource_syscalls.h"
 
 // Stubs
@@ -27,13 +30,20 @@
 #include "stubs_memory_layout.h"
 #include "stubs_passert.h"
 #include "stubs_pbl_malloc.h"
-#include "stubs_pebble_tasks.h"
 #include "stubs_resources.h"
 #include "stubs_ui_window.h"
 #include "stubs_unobstructed_area.h"
 
 void framebuffer_clear(FrameBuffer* f) {}
 void graphics_context_move_draw_box(GContext* ctx, GPoint offset) {}
+
+static int s_num_fill_span_calls;
+void gpath_fill_spans_with_cb(GContext *ctx, GPath *path, GPathDrawFilledCallback cb,
+                              void *user_data) {
+  s_num_fill_span_calls++;
+}
+
+void gpath_draw_filled_spans(GContext *ctx, const GPathFilledSpan *spans, uint32_t num_spans) {}
 typedef uint16_t ResourceId;
 const uint8_t *resource_get_builtin_bytes(ResAppNum app_num, uint32_t resource_id,
                                           uint32_t *num_bytes_out) { return NULL; }
@@ -47,6 +57,7 @@ static FrameBuffer *fb = NULL;
 
 // Setup
 void test_kino_reel__initialize(void) {
+  s_num_fill_span_calls = 0;
   fb = malloc(sizeof(FrameBuffer));
   fb->size = (GSize) {DISP_COLS, DISP_ROWS};
 }
@@ -94,6 +105,27 @@ void test_kino_reel__resource_gbitmap_sequence(void) {
   kino_reel_draw(kino_reel, &ctx, GPointZero);
 }
 
+void test_kino_reel__resource_gbitmap_sequence_frame_cache(void) {
+  uint32_t resource_id = sys_resource_load_file_as_resource(
+      TEST_IMAGES_PATH, "test_kino_reel__resource_gbitmap_sequence.apng");
+  cl_assert(resource_id != UINT32_MAX);
+
+  // Animations played by the app keep their decoded frames
+  stub_pebble_tasks_set_current(PebbleTask_App);
+  KinoReel *kino_reel = kino_reel_create_with_resource(resource_id);
+  const GBitmapSequenceFrameCache *frame_cache =
+      kino_reel_get_gbitmap_sequence(kino_reel)->png_decoder_data.frame_cache;
+  cl_assert(frame_cache);
+  cl_assert_equal_i(frame_cache->budget_bytes, CONFIG_APNG_FRAME_CACHE_SIZE);
+  kino_reel_destroy(kino_reel);
+
+  // ... the ones played by the kernel don't
+  stub_pebble_tasks_set_current(PebbleTask_KernelMain);
+  kino_reel = kino_reel_create_with_resource(resource_id);
+  cl_assert_equal_p(kino_reel_get_gbitmap_sequence(kino_reel)->png_decoder_data.frame_cache, NULL);
+  kino_reel_destroy(kino_reel);
+}
+
 void test_kino_reel__resource_pdci(void) {
   // Test loading PDCI Kino Reel
   uint32_t resource_id = sys_resource_load_file_as_resource(
@@ -106,6 +138,48 @@ void test_kino_reel__resource_pdci(void) {
   cl_assert_equal_i(kino_reel_get_data_size(kino_reel), 192);
 }
 
+//! An image of a single filled triangle
+static GDrawCommandImage *prv_create_triangle_image(void) {
+  const GPoint points[] = {{2, 2}, {20, 4}, {8, 18}};
+  GDrawCommandImage *image = malloc(sizeof(GDrawCommandImage) + sizeof(GDrawCommand) +
+                                    sizeof(points));
+  *image = (GDrawCommandImage) {
+    .version = 1,
+    .size = GSize(24, 24),
+    .command_list.num_commands = 1,
+  };
+  GDrawCommand *command = &image->command_list.commands[0];
+  *command = (GDrawCommand) {
+    .type = GDrawCommandTypePath,
+    .fill_color = GColorRed,
+    .num_points = ARRAY_LENGTH(points),
+  };
+  memcpy(command->points, points, sizeof(points));
+  return image;
+}
+
+void test_kino_reel__pdci_draws_prepared_on_app_task(void) {
+  GContext ctx = {};
+
+  // Images drawn by the app are prepared on the first draw only
+  stub_pebble_tasks_set_current(PebbleTask_App);
+  KinoReel *kino_reel = kino_reel_pdci_create(prv_create_triangle_image(), true);
+  kino_reel_draw(kino_reel, &ctx, GPointZero);
+  const int num_fill_span_calls = s_num_fill_span_calls;
+  cl_assert(num_fill_span_calls > 0);
+  kino_reel_draw(kino_reel, &ctx, GPoint(10, 10));
+  cl_assert_equal_i(s_num_fill_span_calls, num_fill_span_calls);
+  kino_reel_destroy(kino_reel);
+
+  // ... the ones drawn by the kernel aren't
+  stub_pebble_tasks_set_current(PebbleTask_KernelMain);
+  s_num_fill_span_calls = 0;
+  kino_reel = kino_reel_pdci_create(prv_create_triangle_image(), true);
+  kino_reel_draw(kino_reel, &ctx, GPointZero);
+  cl_assert_equal_i(s_num_fill_span_calls, 0);
+  kino_reel_destroy(kino_reel);
+}
+
 void test_kino_reel__resource_pdcs(void) {
   // Test loading PDCS Kino Reel
   uint32_t resource_id = sys_resource_load_file_as_resource(
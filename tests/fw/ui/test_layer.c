@@ -45,6 +45,9 @@ void graphics_context_set_drawing_state(GContext *ctx, GDrawState draw_state) {
 void window_schedule_render(struct Window *window) {
 }
 
+void window_schedule_render_rect(struct Window *window, const GRect *rect) {
+}
+
 void recognizer_destroy(Recognizer *recognizer) {}
 
 void recognizer_add_to_list(Recognizer *recognizer, RecognizerList *list) {}
@@ -35,6 +35,9 @@ void graphics_context_set_drawing_state(GContext *ctx, GDrawState draw_state) {
 void window_schedule_render(struct Window *window) {
 }
 
+void window_schedule_render_rect(struct Window *window, const GRect *rect) {
+}
+
 static bool s_process_manager_compiled_with_legacy2_sdk;
 
 bool process_manager_compiled_with_legacy2_sdk(void) {
@@ -31,6 +31,7 @@ void graphics_draw_bitmap_in_rect(GContext* ctx, const GBitmap *src_bitmap, cons
 }
 bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {return false;}
 void window_schedule_render(struct Window *window) {}
+void window_schedule_render_rect(struct Window *window, const GRect *rect) {}
 void window_set_click_config_provider_with_context(
     struct Window *window, ClickConfigProvider click_config_provider, void *context) {}
 void window_set_click_context(ButtonId button_id, void *context) {}
@@ -0,0 +1,263 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "applib/ui/layer_private.h"
+#include "applib/ui/option_menu_window.h"
+#include "applib/ui/window_private.h"
+#include "process_state/app_state/app_state.h"
+#include "resource/resource.h"
+#include "resource/resource_ids.auto.h"
+#include "pbl/services/timeline/timeline_resources.h"
+#include "pbl/util/size.h"
+
+#include "clar.h"
+
+#include <stdio.h>
+
+// Fakes
+/////////////////////
+
+#include "fake_app_state.h"
+#include "fake_content_indicator.h"
+#include "fake_graphics_context.h"
+#include "fake_pebble_tasks.h"
+#include "fixtures/load_test_resources.h"
+
+// Stubs
+/////////////////////
+
+#include "stubs_analytics.h"
+#include "stubs_animation_timing.h"
+#include "stubs_app_install_manager.h"
+#include "stubs_app_state.h"
+#include "stubs_app_timer.h"
+#include "stubs_bootbits.h"
+#include "stubs_buffer.h"
+#include "stubs_click.h"
+#include "stubs_compiled_with_legacy2_sdk.h"
+#include "stubs_event_service_client.h"
+#include "stubs_heap.h"
+#include "stubs_logging.h"
+#include "stubs_memory_layout.h"
+#include "stubs_mutex.h"
+#include "stubs_passert.h"
+#include "stubs_pbl_malloc.h"
+#include "stubs_print.h"
+#include "stubs_process_manager.h"
+#include "stubs_prompt.h"
+#include "stubs_serial.h"
+#include "stubs_shell_prefs.h"
+#include "stubs_sleep.h"
+#include "stubs_syscalls.h"
+#include "stubs_task_watchdog.h"
+#include "stubs_unobstructed_area.h"
+#include "stubs_vibes.h"
+#include "stubs_window_manager.h"
+#include "stubs_window_stack.h"
+
+// Counting update_procs
+/////////////////////
+
+#define MAX_COUNTED_LAYERS (32)
+
+typedef struct CountedLayer {
+  const Layer *layer;
+  LayerUpdateProc update_proc;
+} CountedLayer;
+
+static CountedLayer s_counted_layers[MAX_COUNTED_LAYERS];
+static unsigned int s_num_counted_layers;
+static unsigned int s_update_proc_calls;
+//! Pixels within the clip box of the update_procs that were called, the most they could touch
+static uint32_t s_pixels_touched;
+
+static void prv_counting_update_proc(Layer *layer, GContext *ctx) {
+  s_update_proc_calls++;
+  s_pixels_touched += ctx->draw_state.clip_box.size.w * ctx->draw_state.clip_box.size.h;
+  for (unsigned int i = 0; i < s_num_counted_layers; i++) {
+    if (s_counted_layers[i].layer == layer) {
+      s_counted_layers[i].update_proc(layer, ctx);
+      return;
+    }
+  }
+  cl_fail("update_proc of an unknown layer");
+}
+
+static bool prv_count_update_proc(Layer *layer, void *context) {
+  if (layer->update_proc && (layer->update_proc != prv_counting_update_proc)) {
+    cl_assert(s_num_counted_layers < MAX_COUNTED_LAYERS);
+    s_counted_layers[s_num_counted_layers++] = (CountedLayer) {
+      .layer = layer,
+      .update_proc = layer->update_proc,
+    };
+    layer->update_proc = prv_counting_update_proc;
+  }
+  return true;
+}
+
+// Menu and status bar scene
+/////////////////////
+
+#define NUM_ROWS (8)
+
+static OptionMenu s_option_menu;
+
+static uint16_t prv_get_num_rows(OptionMenu *option_menu, void *context) {
+  return NUM_ROWS;
+}
+
+static void prv_draw_row(OptionMenu *option_menu, GContext *ctx, const Layer *cell_layer,
+                         const GRect *cell_frame, uint32_t row, bool selected, void *context) {
+  static const char *s_titles[NUM_ROWS] = {
+    "Alarms", "Timeline", "Notifications", "Health", "Display", "Quiet Time", "System", "About",
+  };
+  option_menu_system_draw_row(option_menu, ctx, cell_layer, cell_frame, s_titles[row], selected,
+                              context);
+}
+
+static void prv_scene_init(void) {
+  fake_graphics_context_init();
+  s_app_state_framebuffer = fake_graphics_context_get_framebuffer();
+  gdirty_region_reset(app_state_get_render_damage());
+  s_num_counted_layers = 0;
+
+  option_menu_init(&s_option_menu);
+  option_menu_configure(&s_option_menu, &(OptionMenuConfig) {
+    .title = "Settings",
+    .status_colors = { GColorWhite, GColorBlack },
+    .highlight_colors = { PBL_IF_COLOR_ELSE(GColorCobaltBlue, GColorBlack), GColorWhite },
+  });
+  option_menu_set_callbacks(&s_option_menu, &(OptionMenuCallbacks) {
+    .draw_row = prv_draw_row,
+    .get_num_rows = prv_get_num_rows,
+  }, NULL);
+  window_set_on_screen(&s_option_menu.window, true, true);
+  layer_process_tree(&s_option_menu.window.layer, NULL, prv_count_update_proc);
+}
+
+typedef enum SceneFrame {
+  SceneFrame_Initial,
+  SceneFrame_StatusText,
+  SceneFrame_SelectNext,
+  SceneFrame_SelectNextAgain,
+  SceneFrame_StatusTextAgain,
+  SceneFrameCount,
+} SceneFrame;
+
+static const char *s_frame_names[SceneFrameCount] = {
+  [SceneFrame_Initial] = "initial render",
+  [SceneFrame_StatusText] = "status bar text",
+  [SceneFrame_SelectNext] = "select next row",
+  [SceneFrame_SelectNextAgain] = "select next row",
+  [SceneFrame_StatusTextAgain] = "status bar text",
+};
+
+static void prv_scene_update(SceneFrame frame) {
+  switch (frame) {
+    case SceneFrame_Initial:
+      break;
+    case SceneFrame_StatusText:
+      status_bar_layer_set_info_text(&s_option_menu.status_layer, "1/8");
+      break;
+    case SceneFrame_SelectNext:
+    case SceneFrame_SelectNextAgain:
+      menu_layer_set_selected_next(&s_option_menu.menu_layer, false /* up */, MenuRowAlignNone,
+                                   false /* animated */);
+      break;
+    case SceneFrame_StatusTextAgain:
+      status_bar_layer_set_info_text(&s_option_menu.status_layer, "3/8");
+      break;
+    case SceneFrameCount:
+      break;
+  }
+}
+
+typedef struct SceneStats {
+  unsigned int update_proc_calls[SceneFrameCount];
+  uint32_t pixels_touched[SceneFrameCount];
+  uint8_t framebuffers[SceneFrameCount][FRAMEBUFFER_SIZE_BYTES];
+} SceneStats;
+
+static SceneStats s_full_stats;
+static SceneStats s_damage_stats;
+
+//! Renders the scene frame by frame the way the app event loop does, either redrawing the whole
+//! window or only the damage scheduled since the last frame
+static void prv_run_scene(bool damage_only, SceneStats *stats) {
+  prv_scene_init();
+  Window *window = &s_option_menu.window;
+  GContext *ctx = fake_graphics_context_get_context();
+  GDirtyRegion *damage = app_state_get_render_damage();
+
+  for (SceneFrame frame = 0; frame < SceneFrameCount; frame++) {
+    prv_scene_update(frame);
+
+    s_update_proc_calls = 0;
+    s_pixels_touched = 0;
+    if (damage_only) {
+      const GRect damage_bounds = gdirty_region_get_bounds(damage);
+      window_render_rect(window, ctx, &damage_bounds);
+    } else {
+      window_render(window, ctx);
+    }
+    gdirty_region_reset(damage);
+
+    stats->update_proc_calls[frame] = s_update_proc_calls;
+    stats->pixels_touched[frame] = s_pixels_touched;
+    memcpy(stats->framebuffers[frame], fake_graphics_context_get_framebuffer()->buffer,
+           FRAMEBUFFER_SIZE_BYTES);
+  }
+}
+
+// Setup
+/////////////////////
+
+void test_window_render_damage__initialize(void) {
+  fake_app_state_init();
+  load_system_resources_fixture();
+  stub_pebble_tasks_set_current(PebbleTask_App);
+}
+
+void test_window_render_damage__cleanup(void) {
+  stub_pebble_tasks_set_current(PebbleTask_KernelMain);
+}
+
+// Tests
+/////////////////////
+
+void test_window_render_damage__menu_and_status_bar(void) {
+  prv_run_scene(false /* damage_only */, &s_full_stats);
+  prv_run_scene(true /* damage_only */, &s_damage_stats);
+
+  for (SceneFrame frame = 0; frame < SceneFrameCount; frame++) {
+    printf("%-16s update_proc calls: %2u full, %2u damage only; "
+           "pixels touched: %6"PRIu32" full, %6"PRIu32" damage only\n", s_frame_names[frame],
+           s_full_stats.update_proc_calls[frame], s_damage_stats.update_proc_calls[frame],
+           s_full_stats.pixels_touched[frame], s_damage_stats.pixels_touched[frame]);
+
+    // Redrawing only the damage ends up with the same pixels as redrawing everything
+    cl_assert_equal_m(s_damage_stats.framebuffers[frame], s_full_stats.framebuffers[frame],
+                      FRAMEBUFFER_SIZE_BYTES);
+  }
+
+  cl_assert_equal_i(s_damage_stats.update_proc_calls[SceneFrame_Initial],
+                    s_full_stats.update_proc_calls[SceneFrame_Initial]);
+  cl_assert_equal_i(s_damage_stats.pixels_touched[SceneFrame_Initial],
+                    s_full_stats.pixels_touched[SceneFrame_Initial]);
+
+  // Updating the status bar doesn't redraw the menu
+  const SceneFrame status_frames[] = { SceneFrame_StatusText, SceneFrame_StatusTextAgain };
+  for (unsigned int i = 0; i < ARRAY_LENGTH(status_frames); i++) {
+    const SceneFrame frame = status_frames[i];
+    cl_assert(s_damage_stats.update_proc_calls[frame] < s_full_stats.update_proc_calls[frame]);
+    cl_assert(s_damage_stats.pixels_touched[frame] * 4 < s_full_stats.pixels_touched[frame]);
+  }
+
+  // Moving the selection doesn't redraw the status bar
+  const SceneFrame select_frames[] = { SceneFrame_SelectNext, SceneFrame_SelectNextAgain };
+  for (unsigned int i = 0; i < ARRAY_LENGTH(select_frames); i++) {
+    const SceneFrame frame = select_frames[i];
+    cl_assert(s_damage_stats.update_proc_calls[frame] < s_full_stats.update_proc_calls[frame]);
+    cl_assert(s_damage_stats.pixels_touched[frame] < s_full_stats.pixels_touched[frame]);
+  }
+}
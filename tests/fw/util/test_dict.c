@@ -8,9 +8,11 @@
 
 #include "clar.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
 #include <strings.h>
+#include <sys/time.h>
 
 // Stubs
 ///////////////////////////////////////////////////////////
@@ -378,3 +380,243 @@ void test_dict__merge(void) {
     cl_assert(has_tuple[DATA_IDX] == true);
   }
 }
+
+// Index & in-place merge
+///////////////////////////////////////////////////////////
+
+#define NUM_SYNC_KEYS (60)
+#define NUM_SYNC_UPDATES (20)
+
+static uint32_t prv_sync_key(int i) {
+  // Mix of small consecutive keys, like most apps use, and hash-like ones:
+  return (i % 2) ? (uint32_t)i : (0x9e3779b9 * i);
+}
+
+static uint32_t prv_write_sync_dict(uint8_t *buffer, uint32_t size, int num_keys,
+                                    int32_t value, const char *string) {
+  DictionaryIterator iter;
+  dict_write_begin(&iter, buffer, size);
+  for (int i = 0; i < num_keys; ++i) {
+    if (i % 3) {
+      cl_assert_equal_i(dict_write_int32(&iter, prv_sync_key(i), value + i), DICT_OK);
+    } else {
+      cl_assert_equal_i(dict_write_cstring(&iter, prv_sync_key(i), string), DICT_OK);
+    }
+  }
+  return dict_write_end(&iter);
+}
+
+void test_dict__index_find(void) {
+  uint8_t buffer[1024];
+  const uint32_t size = prv_write_sync_dict(buffer, sizeof(buffer), NUM_SYNC_KEYS, 0, "abc");
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, buffer, size);
+
+  const uint32_t storage_size = dict_index_calc_storage_size(&iter);
+  cl_assert(storage_size >= 2 * NUM_SYNC_KEYS * sizeof(uint16_t));
+  uint16_t storage[storage_size / sizeof(uint16_t)];
+
+  DictionaryIndex index;
+  DictionaryIndex linear_index;
+  DictionaryIndex small_index;
+  cl_assert_equal_i(dict_index_init(&index, &iter, storage, storage_size), DICT_OK);
+  cl_assert_equal_i(dict_index_init(&linear_index, &iter, NULL, 0), DICT_OK);
+  cl_assert_equal_i(dict_index_init(&small_index, &iter, storage, storage_size - 1),
+                    DICT_NOT_ENOUGH_STORAGE);
+
+  for (int i = 0; i < NUM_SYNC_KEYS; ++i) {
+    Tuple *tuple = dict_find(&iter, prv_sync_key(i));
+    cl_assert(tuple);
+    cl_assert_equal_p(dict_index_find(&index, prv_sync_key(i)), tuple);
+    cl_assert_equal_p(dict_index_find(&linear_index, prv_sync_key(i)), tuple);
+    cl_assert_equal_p(dict_index_find(&small_index, prv_sync_key(i)), tuple);
+  }
+  cl_assert_equal_p(dict_index_find(&index, 0x12345678), NULL);
+  cl_assert_equal_p(dict_index_find(&index, NUM_SYNC_KEYS + 1), NULL);
+}
+
+void test_dict__index_find_duplicate_keys(void) {
+  uint8_t buffer[64];
+  DictionaryIterator iter;
+  dict_write_begin(&iter, buffer, sizeof(buffer));
+  dict_write_uint8(&iter, SOME_UINT8_KEY, 1);
+  dict_write_uint8(&iter, SOME_UINT8_KEY, 2);
+  const uint32_t size = dict_write_end(&iter);
+  dict_read_begin_from_buffer(&iter, buffer, size);
+
+  uint16_t storage[dict_index_calc_storage_size(&iter) / sizeof(uint16_t)];
+  DictionaryIndex index;
+  cl_assert_equal_i(dict_index_init(&index, &iter, storage, sizeof(storage)), DICT_OK);
+  cl_assert_equal_p(dict_index_find(&index, SOME_UINT8_KEY), dict_find(&iter, SOME_UINT8_KEY));
+  cl_assert_equal_i(dict_index_find(&index, SOME_UINT8_KEY)->value->uint8, 1);
+}
+
+static int s_num_updated_keys;
+static int s_num_unchanged_keys;
+static const uint8_t *s_dest_buffer;
+static size_t s_dest_buffer_size;
+
+static void in_place_update_key_callback(const uint32_t key, const Tuple *new_tuple,
+                                         const Tuple *old_tuple, void *context) {
+  if (new_tuple == old_tuple) {
+    // Not updated, still in the dictionary with its original value
+    ++s_num_unchanged_keys;
+    cl_assert((const uint8_t *)new_tuple >= s_dest_buffer &&
+              (const uint8_t *)new_tuple < s_dest_buffer + s_dest_buffer_size);
+    if (new_tuple->type == TUPLE_CSTRING) {
+      cl_assert_equal_s(new_tuple->value->cstring, "abc");
+    }
+    return;
+  }
+  ++s_num_updated_keys;
+  if (new_tuple->type == TUPLE_INT) {
+    cl_assert_equal_i(new_tuple->value->int32, old_tuple->value->int32 + 1000);
+  } else {
+    cl_assert_equal_s(new_tuple->value->cstring, "xyz");
+    cl_assert_equal_s(old_tuple->value->cstring, "abc");
+  }
+  // The old value is a copy, outside of the dictionary:
+  cl_assert((const uint8_t *)old_tuple < s_dest_buffer ||
+            (const uint8_t *)old_tuple >= s_dest_buffer + s_dest_buffer_size);
+}
+
+static void merge_counting_callback(const uint32_t key, const Tuple *new_tuple,
+                                    const Tuple *old_tuple, void *context) {
+  ++s_num_updated_keys;
+}
+
+void test_dict__merge_in_place(void) {
+  uint8_t dest_buffer[1024];
+  const uint32_t dest_size = prv_write_sync_dict(dest_buffer, sizeof(dest_buffer),
+                                                 NUM_SYNC_KEYS, 0, "abc");
+  uint8_t source_buffer[256];
+  const uint32_t source_size = prv_write_sync_dict(source_buffer, sizeof(source_buffer),
+                                                   NUM_SYNC_UPDATES, 1000, "xyz");
+  uint8_t expected_buffer[1024];
+  memcpy(expected_buffer, dest_buffer, dest_size);
+  memcpy(expected_buffer + sizeof(Dictionary), source_buffer + sizeof(Dictionary),
+         source_size - sizeof(Dictionary));
+
+  DictionaryIterator dest_iter;
+  DictionaryIterator source_iter;
+  dict_read_begin_from_buffer(&dest_iter, dest_buffer, dest_size);
+  dict_read_begin_from_buffer(&source_iter, source_buffer, source_size);
+  s_num_updated_keys = 0;
+  s_num_unchanged_keys = 0;
+  s_dest_buffer = dest_buffer;
+  s_dest_buffer_size = sizeof(dest_buffer);
+
+  uint32_t size = sizeof(dest_buffer);
+  cl_assert_equal_i(dict_merge(&dest_iter, &size, &source_iter, true,
+                               in_place_update_key_callback, NULL), DICT_OK);
+  // Every key of the merged dictionary gets called back, the ones which didn't change as well:
+  cl_assert_equal_i(s_num_updated_keys, NUM_SYNC_UPDATES);
+  cl_assert_equal_i(s_num_unchanged_keys, NUM_SYNC_KEYS - NUM_SYNC_UPDATES);
+  cl_assert_equal_i(size, dest_size);
+  // The updated tuples are the first ones of dest, so that's where the new values are:
+  cl_assert_equal_m(dest_buffer, expected_buffer, dest_size);
+
+  // Reading still works:
+  cl_assert_equal_i(dict_find(&dest_iter, prv_sync_key(1))->value->int32, 1001);
+  cl_assert_equal_i(dict_find(&dest_iter, prv_sync_key(NUM_SYNC_KEYS - 1))->value->int32,
+                    NUM_SYNC_KEYS - 1);
+}
+
+void test_dict__merge_in_place_size_changed(void) {
+  uint8_t dest_buffer[1024];
+  const uint32_t dest_size = prv_write_sync_dict(dest_buffer, sizeof(dest_buffer),
+                                                 NUM_SYNC_KEYS, 0, "abc");
+  uint8_t source_buffer[256];
+  DictionaryIterator source_iter;
+  dict_write_begin(&source_iter, source_buffer, sizeof(source_buffer));
+  dict_write_cstring(&source_iter, prv_sync_key(0), "longer");
+  const uint32_t source_size = dict_write_end(&source_iter);
+
+  DictionaryIterator dest_iter;
+  dict_read_begin_from_buffer(&dest_iter, dest_buffer, dest_size);
+  dict_read_begin_from_buffer(&source_iter, source_buffer, source_size);
+  s_num_updated_keys = 0;
+
+  // Falls back to rewriting the dictionary, which moves (and calls back for) every key:
+  uint32_t size = sizeof(dest_buffer);
+  cl_assert_equal_i(dict_merge(&dest_iter, &size, &source_iter, true,
+                               merge_counting_callback, NULL), DICT_OK);
+  cl_assert_equal_i(s_num_updated_keys, NUM_SYNC_KEYS);
+  cl_assert_equal_i(size, dest_size + strlen("longer") - strlen("abc"));
+  cl_assert_equal_s(dict_find(&dest_iter, prv_sync_key(0))->value->cstring, "longer");
+  cl_assert_equal_i(dict_find(&dest_iter, prv_sync_key(1))->value->int32, 1);
+}
+
+static double prv_elapsed_us(const struct timeval *start) {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return ((now.tv_sec - start->tv_sec) * 1e6) + (now.tv_usec - start->tv_usec);
+}
+
+void test_dict__benchmark(void) {
+  const int num_iterations = 2000;
+  uint8_t dest_buffer[1024];
+  const uint32_t dest_size = prv_write_sync_dict(dest_buffer, sizeof(dest_buffer),
+                                                 NUM_SYNC_KEYS, 0, "abc");
+  DictionaryIterator dest_iter;
+  dict_read_begin_from_buffer(&dest_iter, dest_buffer, dest_size);
+
+  // Lookups of every key:
+  uint16_t storage[dict_index_calc_storage_size(&dest_iter) / sizeof(uint16_t)];
+  DictionaryIndex index;
+  dict_index_init(&index, &dest_iter, storage, sizeof(storage));
+  struct timeval start;
+  uint32_t checksum = 0;
+  gettimeofday(&start, NULL);
+  for (int n = 0; n < num_iterations; ++n) {
+    for (int i = 0; i < NUM_SYNC_KEYS; ++i) {
+      checksum += dict_find(&dest_iter, prv_sync_key(i))->length;
+    }
+  }
+  const double find_us = prv_elapsed_us(&start);
+  gettimeofday(&start, NULL);
+  for (int n = 0; n < num_iterations; ++n) {
+    for (int i = 0; i < NUM_SYNC_KEYS; ++i) {
+      checksum -= dict_index_find(&index, prv_sync_key(i))->length;
+    }
+  }
+  const double index_find_us = prv_elapsed_us(&start);
+  cl_assert_equal_i(checksum, 0);
+
+  // Merging updates of a third of the keys, the way AppSync does for every message:
+  uint8_t source_buffer[512];
+  const uint32_t source_size = prv_write_sync_dict(source_buffer, sizeof(source_buffer),
+                                                   NUM_SYNC_UPDATES, 1000, "xyz");
+  DictionaryIterator source_iter;
+  dict_read_begin_from_buffer(&source_iter, source_buffer, source_size);
+  gettimeofday(&start, NULL);
+  for (int n = 0; n < num_iterations; ++n) {
+    uint32_t size = sizeof(dest_buffer);
+    cl_assert_equal_i(dict_merge(&dest_iter, &size, &source_iter, true,
+                                 merge_counting_callback, NULL), DICT_OK);
+  }
+  const double merge_in_place_us = prv_elapsed_us(&start);
+
+  const uint32_t grown_source_size = prv_write_sync_dict(source_buffer, sizeof(source_buffer),
+                                                         NUM_SYNC_UPDATES, 1000, "xyzw");
+  dict_read_begin_from_buffer(&source_iter, source_buffer, grown_source_size);
+  gettimeofday(&start, NULL);
+  for (int n = 0; n < num_iterations; ++n) {
+    // Alternate between the two, so the size changes every time:
+    const uint32_t size_before = dict_size(&dest_iter);
+    uint32_t size = sizeof(dest_buffer);
+    cl_assert_equal_i(dict_merge(&dest_iter, &size, &source_iter, true,
+                                 merge_counting_callback, NULL), DICT_OK);
+    cl_assert(size != size_before);
+    dict_read_begin_from_buffer(&source_iter, source_buffer,
+                                prv_write_sync_dict(source_buffer, sizeof(source_buffer),
+                                                    NUM_SYNC_UPDATES, 1000,
+                                                    (n % 2) ? "xyzw" : "xyz"));
+  }
+  const double merge_us = prv_elapsed_us(&start);
+
+  printf("%d keys, %d iterations: dict_find %.0f us, dict_index_find %.0f us\n",
+         NUM_SYNC_KEYS, num_iterations, find_us, index_find_us);
+  printf("Merging %d keys: %.0f us in place, %.0f us rewriting\n",
+         NUM_SYNC_UPDATES, merge_in_place_us, merge_us);
+}
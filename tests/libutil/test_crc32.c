@@ -8,7 +8,13 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
+
+extern uint32_t crc32_prv_nybble(uint32_t crc, const void *data, size_t length);
+extern uint32_t crc32_prv_slice_by_4(uint32_t crc, const void *data, size_t length);
+extern uint32_t crc32_prv_slice_by_8(uint32_t crc, const void *data, size_t length);
 
 #define assert_equal_hex(A, B) \
   do { \
@@ -27,6 +33,7 @@
 static uint32_t crc;
 
 void test_crc32__initialize(void) {
+  crc32_set_backend(NULL);
   crc = crc32(0, NULL, 0);
 }
 
@@ -71,3 +78,139 @@ void test_crc32__null_residue(void) {
   crc = crc32(crc, data, 4);
   assert_equal_hex(crc, CRC32_RESIDUE);
 }
+
+// Software engines
+///////////////////////////////////////////////////////////
+
+typedef uint32_t (*Crc32Engine)(uint32_t crc, const void *data, size_t length);
+
+static const struct {
+  const char *name;
+  Crc32Engine engine;
+} s_engines[] = {
+  { "nybble", crc32_prv_nybble },
+  { "slice-by-4", crc32_prv_slice_by_4 },
+  { "slice-by-8", crc32_prv_slice_by_8 },
+  { "crc32", crc32 },
+};
+
+#define NUM_ENGINES (sizeof(s_engines) / sizeof(s_engines[0]))
+#define MAX_LENGTH (300)
+#define MAX_OFFSET (8)
+
+static void prv_fill_random(uint8_t *buffer, size_t length) {
+  uint32_t seed = 1;
+  for (size_t i = 0; i < length; i++) {
+    seed = (seed * 1103515245) + 12345;
+    buffer[i] = seed >> 16;
+  }
+}
+
+void test_crc32__engines_standard_check(void) {
+  for (unsigned int i = 0; i < NUM_ENGINES; i++) {
+    assert_equal_hex(s_engines[i].engine(CRC32_INIT, "123456789", 9), 0xCBF43926);
+  }
+}
+
+void test_crc32__engines_match_for_all_lengths_and_alignments(void) {
+  uint8_t buffer[MAX_OFFSET + MAX_LENGTH];
+  prv_fill_random(buffer, sizeof(buffer));
+
+  for (size_t offset = 0; offset < MAX_OFFSET; offset++) {
+    for (size_t length = 0; length <= MAX_LENGTH; length++) {
+      const uint32_t expected = crc32_prv_nybble(CRC32_INIT, &buffer[offset], length);
+      for (unsigned int i = 1; i < NUM_ENGINES; i++) {
+        assert_equal_hex(s_engines[i].engine(CRC32_INIT, &buffer[offset], length), expected);
+      }
+    }
+  }
+}
+
+void test_crc32__engines_match_when_chunked(void) {
+  uint8_t buffer[MAX_LENGTH];
+  prv_fill_random(buffer, sizeof(buffer));
+  const uint32_t expected = crc32_prv_nybble(CRC32_INIT, buffer, sizeof(buffer));
+
+  for (size_t chunk_size = 1; chunk_size <= 17; chunk_size++) {
+    for (unsigned int i = 1; i < NUM_ENGINES; i++) {
+      uint32_t running = CRC32_INIT;
+      for (size_t offset = 0; offset < sizeof(buffer); offset += chunk_size) {
+        const size_t length =
+            (sizeof(buffer) - offset < chunk_size) ? sizeof(buffer) - offset : chunk_size;
+        running = s_engines[i].engine(running, &buffer[offset], length);
+      }
+      assert_equal_hex(running, expected);
+    }
+  }
+}
+
+void test_crc32__benchmark(void) {
+  const size_t length = 256 * 1024;
+  uint8_t *buffer = malloc(length);
+  prv_fill_random(buffer, length);
+
+  uint32_t expected = 0;
+  for (unsigned int i = 0; i < NUM_ENGINES - 1; i++) {
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+    uint32_t result = 0;
+    for (int round = 0; round < 8; round++) {
+      result = s_engines[i].engine(CRC32_INIT, buffer, length);
+    }
+    gettimeofday(&end, NULL);
+    const double seconds = (end.tv_sec - start.tv_sec) + ((end.tv_usec - start.tv_usec) / 1e6);
+    printf("crc32 %-10s: %7.1f MB/s\n", s_engines[i].name,
+           (seconds > 0) ? (8 * length) / (seconds * 1024 * 1024) : 0.0);
+
+    if (i == 0) {
+      expected = result;
+    }
+    assert_equal_hex(result, expected);
+  }
+  free(buffer);
+}
+
+// Hardware backend
+///////////////////////////////////////////////////////////
+
+static int s_num_backend_calls;
+static bool s_backend_busy;
+
+static bool prv_backend_update(uint32_t *crc, const void *data, size_t length) {
+  s_num_backend_calls++;
+  if (s_backend_busy) {
+    return false;
+  }
+  // Stands in for the peripheral
+  *crc = crc32_prv_nybble(*crc, data, length);
+  return true;
+}
+
+static const Crc32Backend s_backend = {
+  .min_length = 16,
+  .update = prv_backend_update,
+};
+
+void test_crc32__backend(void) {
+  uint8_t buffer[64];
+  prv_fill_random(buffer, sizeof(buffer));
+  const uint32_t expected = crc32(CRC32_INIT, buffer, sizeof(buffer));
+
+  s_num_backend_calls = 0;
+  s_backend_busy = false;
+  crc32_set_backend(&s_backend);
+
+  // short buffers stay in software
+  crc = crc32(crc, buffer, 8);
+  cl_assert_equal_i(s_num_backend_calls, 0);
+  crc = crc32(crc, &buffer[8], sizeof(buffer) - 8);
+  cl_assert_equal_i(s_num_backend_calls, 1);
+  assert_equal_hex(crc, expected);
+
+  // falls back to software when the peripheral is busy
+  s_backend_busy = true;
+  assert_equal_hex(crc32(CRC32_INIT, buffer, sizeof(buffer)), expected);
+  cl_assert_equal_i(s_num_backend_calls, 2);
+
+  assert_equal_hex(crc32(0, NULL, 0), CRC32_INIT);
+}
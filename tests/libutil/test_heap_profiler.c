@@ -0,0 +1,169 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "pbl/util/heap_profiler.h"
+
+#include "pbl/util/size.h"
+
+#include "clar.h"
+
+#include <string.h>
+
+// Stubs
+///////////////////////////////////////////////////////////
+
+static uint32_t s_time_ms;
+
+static uint32_t prv_get_time_ms(void) {
+  return s_time_ms;
+}
+
+// Tests
+///////////////////////////////////////////////////////////
+
+#define NUM_SITES (8)
+
+static HeapProfilerSite s_sites[NUM_SITES];
+static HeapProfiler s_profiler;
+
+void test_heap_profiler__initialize(void) {
+  s_time_ms = 1000;
+  memset(s_sites, 0xff, sizeof(s_sites));
+  heap_profiler_init(&s_profiler, s_sites, NUM_SITES, prv_get_time_ms);
+}
+
+void test_heap_profiler__counts_per_site(void) {
+  const uint32_t a = heap_profiler_record_alloc(&s_profiler, 0x08001000, 100);
+  const uint32_t b = heap_profiler_record_alloc(&s_profiler, 0x08001000, 50);
+  const uint32_t c = heap_profiler_record_alloc(&s_profiler, 0x08002000, 8);
+  cl_assert_equal_i(s_profiler.num_used_sites, 2);
+
+  heap_profiler_record_free(&s_profiler, 0x08001000, 100, a);
+  const uint32_t d = heap_profiler_record_alloc(&s_profiler, 0x08001000, 20);
+
+  const HeapProfilerSite *site = heap_profiler_find_site(&s_profiler, 0x08001000);
+  cl_assert(site);
+  cl_assert_equal_i(site->num_allocs, 3);
+  cl_assert_equal_i(site->num_frees, 1);
+  cl_assert_equal_i(site->total_bytes, 170);
+  cl_assert_equal_i(site->live_bytes, 70);
+  cl_assert_equal_i(site->peak_live_bytes, 150);
+
+  site = heap_profiler_find_site(&s_profiler, 0x08002000);
+  cl_assert(site);
+  cl_assert_equal_i(site->num_allocs, 1);
+  cl_assert_equal_i(site->live_bytes, 8);
+
+  cl_assert_equal_p(heap_profiler_find_site(&s_profiler, 0x08003000), NULL);
+
+  heap_profiler_record_free(&s_profiler, 0x08001000, 50, b);
+  heap_profiler_record_free(&s_profiler, 0x08002000, 8, c);
+  heap_profiler_record_free(&s_profiler, 0x08001000, 20, d);
+  cl_assert_equal_i(heap_profiler_find_site(&s_profiler, 0x08001000)->live_bytes, 0);
+  cl_assert_equal_i(heap_profiler_find_site(&s_profiler, 0x08002000)->live_bytes, 0);
+}
+
+void test_heap_profiler__lifetime_buckets(void) {
+  cl_assert_equal_i(heap_profiler_get_lifetime_bucket(0), 0);
+  cl_assert_equal_i(heap_profiler_get_lifetime_bucket(9), 0);
+  cl_assert_equal_i(heap_profiler_get_lifetime_bucket(10), 1);
+  cl_assert_equal_i(heap_profiler_get_lifetime_bucket(999), 2);
+  cl_assert_equal_i(heap_profiler_get_lifetime_bucket(1000), 3);
+  cl_assert_equal_i(heap_profiler_get_lifetime_bucket(99999), 4);
+  cl_assert_equal_i(heap_profiler_get_lifetime_bucket(100000), 5);
+  cl_assert_equal_i(heap_profiler_get_lifetime_bucket(UINT32_MAX), 5);
+
+  const uint32_t lifetimes_ms[] = { 5, 50, 500, 5000, 50000, 500000, 7 };
+  for (unsigned int i = 0; i < ARRAY_LENGTH(lifetimes_ms); i++) {
+    const uint32_t alloc_time = heap_profiler_record_alloc(&s_profiler, 0x08001000, 16);
+    s_time_ms += lifetimes_ms[i];
+    heap_profiler_record_free(&s_profiler, 0x08001000, 16, alloc_time);
+  }
+
+  const HeapProfilerSite *site = heap_profiler_find_site(&s_profiler, 0x08001000);
+  const uint16_t expected[HEAP_PROFILER_NUM_LIFETIME_BUCKETS] = { 2, 1, 1, 1, 1, 1 };
+  cl_assert_equal_m(site->lifetime_histogram, expected, sizeof(expected));
+}
+
+void test_heap_profiler__table_full(void) {
+  for (uintptr_t i = 1; i <= NUM_SITES; i++) {
+    heap_profiler_record_alloc(&s_profiler, i * 0x100, 4);
+  }
+  cl_assert_equal_i(s_profiler.num_used_sites, NUM_SITES);
+  cl_assert_equal_i(s_profiler.num_dropped, 0);
+
+  // new sites are only counted, known ones are still recorded
+  const uint32_t alloc_time = heap_profiler_record_alloc(&s_profiler, 0x08001000, 4);
+  cl_assert(alloc_time != 0);
+  heap_profiler_record_free(&s_profiler, 0x08001000, 4, alloc_time);
+  heap_profiler_record_alloc(&s_profiler, 0x100, 4);
+  cl_assert_equal_i(s_profiler.num_dropped, 1);
+  cl_assert_equal_i(heap_profiler_find_site(&s_profiler, 0x100)->num_allocs, 2);
+
+  // allocations with an unknown PC aren't recorded either
+  heap_profiler_record_alloc(&s_profiler, 0, 4);
+  cl_assert_equal_i(s_profiler.num_dropped, 2);
+}
+
+void test_heap_profiler__frees_from_before_reset(void) {
+  const uint32_t old_alloc_time = heap_profiler_record_alloc(&s_profiler, 0x08001000, 32);
+  s_time_ms += 100;
+  heap_profiler_reset(&s_profiler);
+  cl_assert_equal_i(s_profiler.num_used_sites, 0);
+
+  const uint32_t alloc_time = heap_profiler_record_alloc(&s_profiler, 0x08001000, 16);
+  heap_profiler_record_free(&s_profiler, 0x08001000, 32, old_alloc_time);
+  // never recorded, e.g. made while no profiler was attached
+  heap_profiler_record_free(&s_profiler, 0x08001000, 32, 0);
+
+  const HeapProfilerSite *site = heap_profiler_find_site(&s_profiler, 0x08001000);
+  cl_assert_equal_i(site->num_frees, 0);
+  cl_assert_equal_i(site->live_bytes, 16);
+
+  heap_profiler_record_free(&s_profiler, 0x08001000, 16, alloc_time);
+  cl_assert_equal_i(site->num_frees, 1);
+  cl_assert_equal_i(site->live_bytes, 0);
+}
+
+void test_heap_profiler__serialize(void) {
+  const uint32_t alloc_time = heap_profiler_record_alloc(&s_profiler, 0x08001000, 24);
+  heap_profiler_record_alloc(&s_profiler, 0x08002000, 12);
+  s_time_ms += 2000;
+  heap_profiler_record_free(&s_profiler, 0x08001000, 24, alloc_time);
+  s_time_ms += 500;
+
+  const size_t size = heap_profiler_get_serialized_size(&s_profiler);
+  cl_assert_equal_i(size, sizeof(HeapProfilerHeader) + (2 * sizeof(HeapProfilerSiteRecord)));
+
+  uint8_t buffer[size];
+  cl_assert_equal_i(heap_profiler_serialize(&s_profiler, buffer, size - 1), 0);
+  cl_assert_equal_i(heap_profiler_serialize(&s_profiler, buffer, size), size);
+
+  HeapProfilerHeader header;
+  memcpy(&header, buffer, sizeof(header));
+  cl_assert_equal_i(header.magic, HEAP_PROFILER_MAGIC);
+  cl_assert_equal_i(header.version, HEAP_PROFILER_VERSION);
+  cl_assert_equal_i(header.num_lifetime_buckets, HEAP_PROFILER_NUM_LIFETIME_BUCKETS);
+  cl_assert_equal_i(header.num_sites, 2);
+  cl_assert_equal_i(header.num_dropped, 0);
+  cl_assert_equal_i(header.duration_ms, 2500);
+
+  bool found = false;
+  for (unsigned int i = 0; i < header.num_sites; i++) {
+    HeapProfilerSiteRecord record;
+    memcpy(&record, &buffer[sizeof(header) + (i * sizeof(record))], sizeof(record));
+    if (record.pc == 0x08001000) {
+      found = true;
+      cl_assert_equal_i(record.num_allocs, 1);
+      cl_assert_equal_i(record.num_frees, 1);
+      cl_assert_equal_i(record.total_bytes, 24);
+      cl_assert_equal_i(record.live_bytes, 0);
+      cl_assert_equal_i(record.peak_live_bytes, 24);
+      cl_assert_equal_i(record.lifetime_histogram[3], 1);
+    } else {
+      cl_assert_equal_i(record.pc, 0x08002000);
+      cl_assert_equal_i(record.live_bytes, 12);
+    }
+  }
+  cl_assert(found);
+}
@@ -0,0 +1,357 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#include "pbl/util/object_pool.h"
+
+#include "pbl/util/heap.h"
+#include "pbl/util/size.h"
+
+#include "clar.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Stubs
+///////////////////////////////////////////////////////////
+
+static int s_num_slab_allocs;
+static int s_num_slab_frees;
+static bool s_slab_alloc_should_fail;
+static uintptr_t s_last_slab_alloc_pc;
+
+static void *prv_slab_alloc(size_t bytes, uintptr_t client_pc) {
+  if (s_slab_alloc_should_fail) {
+    return NULL;
+  }
+  s_num_slab_allocs++;
+  s_last_slab_alloc_pc = client_pc;
+  return malloc(bytes);
+}
+
+static void prv_slab_free(void *ptr) {
+  s_num_slab_frees++;
+  free(ptr);
+}
+
+// Tests
+///////////////////////////////////////////////////////////
+
+typedef struct {
+  ListNode node;
+  uint32_t value;
+  uint8_t flag;
+} TestObject;
+
+#define OBJECTS_PER_SLAB (4)
+
+static ObjectPool s_pool;
+
+void test_object_pool__initialize(void) {
+  s_num_slab_allocs = 0;
+  s_num_slab_frees = 0;
+  s_slab_alloc_should_fail = false;
+  s_last_slab_alloc_pc = 0;
+  object_pool_init(&s_pool, "test", sizeof(TestObject), OBJECTS_PER_SLAB, prv_slab_alloc,
+                   prv_slab_free, OBJECT_POOL_NO_STATS_KEY);
+}
+
+void test_object_pool__alloc_and_free(void) {
+  TestObject *objects[OBJECTS_PER_SLAB * 2];
+  for (int i = 0; i < (int)ARRAY_LENGTH(objects); i++) {
+    objects[i] = object_pool_alloc(&s_pool);
+    cl_assert(objects[i]);
+    cl_assert_equal_i((uintptr_t)objects[i] % sizeof(unsigned long), 0);
+    objects[i]->value = i;
+    objects[i]->flag = i;
+  }
+  cl_assert_equal_i(s_pool.num_slabs, 2);
+  cl_assert_equal_i(s_num_slab_allocs, 2);
+  cl_assert_equal_i(s_pool.num_allocated, ARRAY_LENGTH(objects));
+  cl_assert_equal_i(s_pool.high_water_mark, ARRAY_LENGTH(objects));
+
+  // objects don't overlap
+  for (int i = 0; i < (int)ARRAY_LENGTH(objects); i++) {
+    cl_assert_equal_i(objects[i]->value, i);
+    cl_assert_equal_i(objects[i]->flag, i);
+  }
+
+  // freed objects get reused before a new slab is allocated
+  object_pool_free(&s_pool, objects[1]);
+  object_pool_free(&s_pool, objects[5]);
+  TestObject *a = object_pool_alloc(&s_pool);
+  TestObject *b = object_pool_alloc(&s_pool);
+  cl_assert((a == objects[1] && b == objects[5]) || (a == objects[5] && b == objects[1]));
+  cl_assert_equal_i(s_num_slab_allocs, 2);
+
+  // the first slab that empties is kept as the spare
+  for (int i = 0; i < OBJECTS_PER_SLAB; i++) {
+    object_pool_free(&s_pool, objects[i]);
+  }
+  cl_assert_equal_i(s_num_slab_frees, 0);
+  cl_assert_equal_i(s_pool.num_slabs, 2);
+  cl_assert(s_pool.spare_slab);
+
+  // any further empty slab is given back
+  for (int i = OBJECTS_PER_SLAB; i < (int)ARRAY_LENGTH(objects); i++) {
+    object_pool_free(&s_pool, objects[i]);
+  }
+  cl_assert_equal_i(s_num_slab_frees, 1);
+  cl_assert_equal_i(s_pool.num_slabs, 1);
+  cl_assert_equal_p(s_pool.slabs, NULL);
+  cl_assert_equal_i(s_pool.num_allocated, 0);
+  cl_assert_equal_i(s_pool.high_water_mark, ARRAY_LENGTH(objects));
+
+  object_pool_free(&s_pool, NULL);
+}
+
+void test_object_pool__alloc_fails(void) {
+  TestObject *objects[OBJECTS_PER_SLAB];
+  for (int i = 0; i < OBJECTS_PER_SLAB; i++) {
+    objects[i] = object_pool_alloc(&s_pool);
+  }
+
+  s_slab_alloc_should_fail = true;
+  cl_assert_equal_p(object_pool_alloc(&s_pool), NULL);
+  cl_assert_equal_i(s_pool.num_allocated, OBJECTS_PER_SLAB);
+
+  // a free object can still be handed out without a new slab
+  object_pool_free(&s_pool, objects[2]);
+  cl_assert_equal_p(object_pool_alloc(&s_pool), objects[2]);
+
+  for (int i = 0; i < OBJECTS_PER_SLAB; i++) {
+    object_pool_free(&s_pool, objects[i]);
+  }
+  cl_assert_equal_i(s_pool.num_slabs, 1);
+
+  // the spare slab is handed out again without calling slab_alloc
+  cl_assert(object_pool_alloc(&s_pool));
+  cl_assert_equal_i(s_pool.num_slabs, 1);
+  cl_assert_equal_p(s_pool.spare_slab, NULL);
+}
+
+void test_object_pool__no_slab_churn_at_slab_boundary(void) {
+  TestObject *objects[OBJECTS_PER_SLAB];
+  for (int i = 0; i < OBJECTS_PER_SLAB; i++) {
+    objects[i] = object_pool_alloc(&s_pool);
+  }
+
+  // an object that keeps getting created and destroyed right after a full slab reuses the spare
+  TestObject *first = object_pool_alloc(&s_pool);
+  object_pool_free(&s_pool, first);
+  for (int i = 0; i < 100; i++) {
+    TestObject *object = object_pool_alloc(&s_pool);
+    cl_assert_equal_p(object, first);
+    object_pool_free(&s_pool, object);
+  }
+  cl_assert_equal_i(s_num_slab_allocs, 2);
+  cl_assert_equal_i(s_num_slab_frees, 0);
+  cl_assert_equal_i(s_pool.num_slabs, 2);
+
+  for (int i = 0; i < OBJECTS_PER_SLAB; i++) {
+    object_pool_free(&s_pool, objects[i]);
+  }
+  cl_assert_equal_i(s_num_slab_frees, 1);
+  cl_assert_equal_i(s_pool.num_slabs, 1);
+}
+
+static bool prv_count_pools(ObjectPool *pool, void *context) {
+  if ((pool == &s_pool) && (strcmp(pool->name, "test") == 0)) {
+    (*(int *)context)++;
+  }
+  return true;
+}
+
+void test_object_pool__registered_once(void) {
+  // re-initializing doesn't register the pool again
+  object_pool_init(&s_pool, "test", sizeof(TestObject), OBJECTS_PER_SLAB, prv_slab_alloc,
+                   prv_slab_free, OBJECT_POOL_NO_STATS_KEY);
+  int count = 0;
+  object_pool_each(prv_count_pools, &count);
+  cl_assert_equal_i(count, 1);
+}
+
+static void * __attribute__((noinline)) prv_alloc_from_call_site(void) {
+  return object_pool_alloc(&s_pool);
+}
+
+void test_object_pool__slab_attributed_to_caller(void) {
+  void *object = prv_alloc_from_call_site();
+  // the slab is allocated on behalf of the function calling object_pool_alloc()
+  const uintptr_t call_site = (uintptr_t)prv_alloc_from_call_site;
+  cl_assert(s_last_slab_alloc_pc > call_site);
+  cl_assert(s_last_slab_alloc_pc < call_site + 64);
+  object_pool_free(&s_pool, object);
+}
+
+void test_object_pool__deinit(void) {
+  for (int i = 0; i < OBJECTS_PER_SLAB; i++) {
+    object_pool_alloc(&s_pool);
+  }
+  cl_assert_equal_i(s_pool.num_slabs, 1);
+
+  void *object = object_pool_alloc(&s_pool);
+  object_pool_free(&s_pool, object);
+  cl_assert(s_pool.spare_slab);
+
+  // the slabs went away with their heap, the pool forgets about them and is no longer reported
+  void *slab = s_pool.slabs;
+  void *spare_slab = s_pool.spare_slab;
+  object_pool_deinit(&s_pool);
+  free(slab);
+  free(spare_slab);
+  cl_assert_equal_p(s_pool.slabs, NULL);
+  cl_assert_equal_p(s_pool.spare_slab, NULL);
+  cl_assert_equal_i(s_pool.num_slabs, 0);
+  cl_assert_equal_i(s_pool.num_allocated, 0);
+  int count = 0;
+  object_pool_each(prv_count_pools, &count);
+  cl_assert_equal_i(count, 0);
+  object_pool_deinit(&s_pool);
+
+  // and can be set up again
+  object_pool_init(&s_pool, "test", sizeof(TestObject), OBJECTS_PER_SLAB, prv_slab_alloc,
+                   prv_slab_free, OBJECT_POOL_NO_STATS_KEY);
+  object_pool_each(prv_count_pools, &count);
+  cl_assert_equal_i(count, 1);
+  cl_assert(object_pool_alloc(&s_pool));
+}
+
+static int s_lock_depth;
+static int s_num_locks;
+
+static void prv_lock(void *context) {
+  cl_assert_equal_p(context, &s_lock_depth);
+  s_lock_depth++;
+  s_num_locks++;
+}
+
+static void prv_unlock(void *context) {
+  cl_assert_equal_p(context, &s_lock_depth);
+  cl_assert(s_lock_depth > 0);
+  s_lock_depth--;
+}
+
+static bool prv_check_locked(ObjectPool *pool, void *context) {
+  cl_assert_equal_i(s_lock_depth, 1);
+  return true;
+}
+
+void test_object_pool__lock(void) {
+  s_lock_depth = 0;
+  s_num_locks = 0;
+  object_pool_set_lock_impl((ObjectPoolLockImpl) {
+    .lock_function = prv_lock,
+    .unlock_function = prv_unlock,
+    .lock_context = &s_lock_depth,
+  });
+
+  object_pool_init(&s_pool, "test", sizeof(TestObject), OBJECTS_PER_SLAB, prv_slab_alloc,
+                   prv_slab_free, OBJECT_POOL_NO_STATS_KEY);
+  void *object = object_pool_alloc(&s_pool);
+  object_pool_free(&s_pool, object);
+  // the pool is walked with the lock held
+  object_pool_each(prv_check_locked, NULL);
+  // including when an allocation fails
+  s_slab_alloc_should_fail = true;
+  for (int i = 0; i < OBJECTS_PER_SLAB; i++) {
+    cl_assert(object_pool_alloc(&s_pool));
+  }
+  cl_assert_equal_p(object_pool_alloc(&s_pool), NULL);
+  object_pool_deinit(&s_pool);
+  cl_assert_equal_i(s_num_locks, 10);
+  cl_assert_equal_i(s_lock_depth, 0);
+
+  object_pool_set_lock_impl((ObjectPoolLockImpl) {});
+}
+
+// Timeline workload
+///////////////////////////////////////////////////////////
+
+#define WORKLOAD_HEAP_SIZE (32 * 1024)
+#define WORKLOAD_NUM_CYCLES (200)
+#define WORKLOAD_MAX_NODES (300)
+#define WORKLOAD_NUM_BUFFERS (32)
+
+//! Same layout as the TimelineNode in timeline.c
+typedef struct {
+  ListNode node;
+  int index;
+  uint8_t id[16];
+  int32_t timestamp;
+  uint16_t duration;
+  bool all_day;
+} WorkloadNode;
+
+static Heap s_heap;
+static uint32_t s_seed;
+
+static void *prv_heap_slab_alloc(size_t bytes, uintptr_t client_pc) {
+  return heap_malloc(&s_heap, bytes, client_pc);
+}
+
+static void prv_heap_slab_free(void *ptr) {
+  heap_free(&s_heap, ptr, 0);
+}
+
+static uint32_t prv_rand(void) {
+  s_seed = (s_seed * 1103515245) + 12345;
+  return s_seed >> 16;
+}
+
+//! Opens and closes the timeline over and over. Every open allocates a node per pin, and while
+//! the timeline is open other allocations that outlive it (pin layouts, cached items) come and go.
+//! @return how fragmented the free space of the heap is after the last close, in percent
+static int prv_run_timeline_workload(bool use_pool) {
+  uint8_t *heap_space = malloc(WORKLOAD_HEAP_SIZE);
+  heap_init(&s_heap, heap_space, heap_space + WORKLOAD_HEAP_SIZE, false);
+  ObjectPool pool;
+  object_pool_init(&pool, "timeline_workload", sizeof(WorkloadNode), 16, prv_heap_slab_alloc,
+                   prv_heap_slab_free, OBJECT_POOL_NO_STATS_KEY);
+  s_seed = 1;
+
+  void *buffers[WORKLOAD_NUM_BUFFERS] = {};
+  for (int cycle = 0; cycle < WORKLOAD_NUM_CYCLES; cycle++) {
+    WorkloadNode *nodes[WORKLOAD_MAX_NODES];
+    const int num_nodes = (WORKLOAD_MAX_NODES / 3) + (prv_rand() % (WORKLOAD_MAX_NODES * 2 / 3));
+    for (int i = 0; i < num_nodes; i++) {
+      nodes[i] = use_pool ? object_pool_alloc(&pool) :
+                            heap_malloc(&s_heap, sizeof(WorkloadNode), 0);
+      cl_assert(nodes[i]);
+
+      if ((prv_rand() % 8) == 0) {
+        const int slot = prv_rand() % WORKLOAD_NUM_BUFFERS;
+        if (buffers[slot]) {
+          heap_free(&s_heap, buffers[slot], 0);
+        }
+        buffers[slot] = heap_malloc(&s_heap, 32 + (prv_rand() % 224), 0);
+        cl_assert(buffers[slot]);
+      }
+    }
+
+    for (int i = 0; i < num_nodes; i++) {
+      if (use_pool) {
+        object_pool_free(&pool, nodes[i]);
+      } else {
+        heap_free(&s_heap, nodes[i], 0);
+      }
+    }
+  }
+  // Only the spare slab is left once the timeline is closed
+  cl_assert_equal_i(pool.num_slabs, use_pool ? 1 : 0);
+  object_pool_deinit(&pool);
+
+  unsigned int used, free_bytes, max_free;
+  heap_calc_totals(&s_heap, &used, &free_bytes, &max_free);
+  free(heap_space);
+  return 100 - ((max_free * 100) / free_bytes);
+}
+
+void test_object_pool__timeline_workload_fragmentation(void) {
+  const int heap_fragmentation = prv_run_timeline_workload(false);
+  const int pool_fragmentation = prv_run_timeline_workload(true);
+  printf("Free heap fragmented after %d timeline open/close cycles: "
+         "%d%% with a malloc per node, %d%% with an object pool\n",
+         WORKLOAD_NUM_CYCLES, heap_fragmentation, pool_fragmentation);
+  cl_assert(pool_fragmentation < heap_fragmentation);
+}
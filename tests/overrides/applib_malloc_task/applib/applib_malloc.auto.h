@@ -0,0 +1,14 @@
+/* SPDX-FileCopyrightText: 2026 Core Devices LLC */
+/* SPDX-License-Identifier: Apache-2.0 */
+
+#pragma once
+
+// Sends the applib allocations to the task heap, so fake_pbl_malloc.h can track them
+#include "kernel/pbl_malloc.h"
+
+#define applib_zalloc(size) task_zalloc(size)
+#define applib_type_zalloc(Type) task_zalloc(sizeof(Type))
+#define applib_type_malloc(Type) task_malloc(sizeof(Type))
+#define applib_type_size(Type) sizeof(Type)
+#define applib_malloc(size) task_malloc(size)
+#define applib_free(ptr) task_free(ptr)
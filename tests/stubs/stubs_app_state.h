@@ -84,6 +84,28 @@ Layer** kernel_applib_get_layer_tree_stack(void) {
   return s_layer_tree_stack;
 }
 
+static LayerTreeLevel s_layer_tree_levels[LAYER_TREE_STACK_SIZE];
+
+LayerTreeLevel *app_state_get_layer_tree_levels(void) {
+  return s_layer_tree_levels;
+}
+
+LayerTreeLevel *kernel_applib_get_layer_tree_levels(void) {
+  return s_layer_tree_levels;
+}
+
+static GDirtyRegion s_render_damage;
+
+GDirtyRegion *app_state_get_render_damage(void) {
+  return &s_render_damage;
+}
+
+static bool s_full_render_required;
+
+bool *app_state_get_full_render_required(void) {
+  return &s_full_render_required;
+}
+
 static WindowStack s_window_stack;
 
 WindowStack *app_state_get_window_stack(void) {
@@ -11,6 +11,8 @@ volatile const int FrameBuffer_MaxY = DISP_ROWS;
 
 void WEAK framebuffer_mark_dirty_rect(FrameBuffer *f, GRect rect) {}
 
+bool WEAK framebuffer_is_dirty(FrameBuffer *f) { return f->is_dirty; }
+
 void WEAK framebuffer_init(FrameBuffer *f, const GSize *size) { f->size = *size; }
 
 GSize WEAK framebuffer_get_size(FrameBuffer *f) { return f->size; }
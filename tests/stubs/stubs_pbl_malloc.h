@@ -26,6 +26,10 @@ void *task_malloc_check(size_t bytes) {
   return malloc(bytes);
 }
 
+void *task_malloc_check_with_pc(size_t bytes, uintptr_t client_pc) {
+  return malloc(bytes);
+}
+
 void *task_zalloc(size_t bytes) {
   void *ptr = task_malloc(bytes);
   memset(ptr, 0, bytes);
@@ -96,6 +100,10 @@ void *kernel_malloc_check(size_t bytes) {
   return malloc(bytes);
 }
 
+void *kernel_malloc_check_with_pc(size_t bytes, uintptr_t client_pc) {
+  return malloc(bytes);
+}
+
 void *kernel_zalloc(size_t bytes) {
   void *ptr = kernel_malloc(bytes);
   memset(ptr, 0, bytes);
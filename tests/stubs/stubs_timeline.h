@@ -10,6 +10,8 @@
 void WEAK timeline_invoke_action(const TimelineItem *item, const TimelineItemAction *action,
                                  const AttributeList *attributes) {}
 
+void WEAK timeline_process_cleanup(PebbleTask task) {}
+
 bool WEAK timeline_add_missed_call_pin(TimelineItem *pin, uint32_t uid) {
   return true;
 }
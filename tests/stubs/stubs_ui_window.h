@@ -6,3 +6,5 @@
 #include "applib/ui/window_private.h"
 
 void window_schedule_render(Window *window) {}
+
+void window_schedule_render_rect(Window *window, const GRect *rect) {}
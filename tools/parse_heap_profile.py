@@ -0,0 +1,122 @@
+# SPDX-FileCopyrightText: 2026 Core Devices LLC
+# SPDX-License-Identifier: Apache-2.0
+
+"""Symbolizes a kernel heap profile captured with "heap profile export".
+
+The input is either a console log containing the "HPRF:" hex lines or the raw binary profile.
+Sites are printed sorted by the number of bytes they allocated.
+"""
+
+import argparse
+import os
+import struct
+import sh
+import sys
+
+HEADER_FORMAT = "<IBBHII"
+HEADER_MAGIC = 0x46525048
+HEADER_VERSION = 1
+HEX_LINE_PREFIX = "HPRF:"
+
+LIFETIME_BUCKET_LABELS = ["<10ms", "<100ms", "<1s", "<10s", "<100s", ">=100s"]
+
+root_path = os.path.join(os.path.dirname(sys.argv[0]), "..")
+
+
+def get_filename_linenumber(elf_path, pc):
+    try:
+        line = sh.arm_none_eabi_addr2line("0x%08x" % pc, exe=elf_path)
+    except:
+        return ("?", 0)
+
+    line = line.strip()
+
+    index = line.rfind(":")
+    filename = line[:index]
+    linenumber = line[index + 1 :]
+    if ":" not in filename:
+        filename = os.path.relpath(filename, root_path)
+
+    return (filename, linenumber)
+
+
+def read_profile(in_file):
+    with open(in_file, "rb") as f:
+        data = f.read()
+
+    # Console log, collect the hex lines wherever they are in the line. The magic reads "HPRF" as
+    # well so a raw binary profile is only assumed when there are no hex lines
+    profile = b""
+    for line in data.decode("utf-8", errors="replace").splitlines():
+        index = line.find(HEX_LINE_PREFIX)
+        if index >= 0:
+            profile += bytes.fromhex(line[index + len(HEX_LINE_PREFIX) :].strip())
+    return profile if profile else data
+
+
+def parse_profile(profile):
+    header_size = struct.calcsize(HEADER_FORMAT)
+    magic, version, num_buckets, num_sites, num_dropped, duration_ms = struct.unpack_from(
+        HEADER_FORMAT, profile
+    )
+    if magic != HEADER_MAGIC:
+        raise Exception("Not a heap profile, magic is 0x%08x" % magic)
+    if version != HEADER_VERSION:
+        raise Exception("Unsupported heap profile version %u" % version)
+
+    site_format = "<6I%uH" % num_buckets
+    site_size = struct.calcsize(site_format)
+    sites = []
+    for i in range(num_sites):
+        values = struct.unpack_from(site_format, profile, header_size + (i * site_size))
+        sites.append(
+            {
+                "pc": values[0],
+                "num_allocs": values[1],
+                "num_frees": values[2],
+                "total_bytes": values[3],
+                "live_bytes": values[4],
+                "peak_live_bytes": values[5],
+                "lifetimes": values[6:],
+            }
+        )
+    return (duration_ms, num_dropped, sites)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--elf_file", required=True)
+    parser.add_argument("in_file")
+
+    args = parser.parse_args()
+
+    duration_ms, num_dropped, sites = parse_profile(read_profile(args.in_file))
+
+    print("Profiled for %.1f s, %u sites" % (duration_ms / 1000.0, len(sites)))
+    if num_dropped:
+        print(
+            "%u allocations were not recorded, the site table was full or their PC was unknown"
+            % num_dropped
+        )
+    print()
+
+    for site in sorted(sites, key=lambda s: s["total_bytes"], reverse=True):
+        filename, linenumber = get_filename_linenumber(args.elf_file, site["pc"])
+        print("0x%08x %s:%s" % (site["pc"], filename, linenumber))
+        print(
+            "    %u allocs, %u frees, %u bytes, %u live, %u peak live"
+            % (
+                site["num_allocs"],
+                site["num_frees"],
+                site["total_bytes"],
+                site["live_bytes"],
+                site["peak_live_bytes"],
+            )
+        )
+        print(
+            "    lifetimes: "
+            + ", ".join(
+                "%s: %u" % (label, count)
+                for label, count in zip(LIFETIME_BUCKET_LABELS, site["lifetimes"])
+            )
+        )
@@ -402,6 +402,13 @@ def add_clar_test(
         "CONFIG_APP_RAM_4X_SEGMENT_SIZE=65536",
     ]
 
+    # text_resources.h sizes the glyph cache from CONFIG_TEXT_GLYPH_CACHE_*.
+    # Tests don't load a board defconfig, so inject the Kconfig defaults.
+    platform_defines += [
+        "CONFIG_TEXT_GLYPH_CACHE_ENTRIES=128",
+        "CONFIG_TEXT_GLYPH_CACHE_BITMAPS=32",
+    ]
+
     # flash_region.h selects a per-chip header from CONFIG_FLASH_*. Tests
     # don't load a board defconfig, so inject the right one based on which
     # flash chip the simulated platform expects.